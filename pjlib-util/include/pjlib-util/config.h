@@ -220,6 +220,21 @@
 #endif
 
 
+/**
+ * Macro PJ_SCANNER_USE_SIMD is defined and non-zero (by default yes)
+ * will let the scanner classify 16 or 32 characters at a time with SIMD
+ * instructions when looking for the end of a token, e.g. in pj_scan_get(),
+ * pj_scan_get_until(), pj_scan_get_until_chr(), and when skipping
+ * whitespaces. The instruction set is selected at run-time (SSSE3 or AVX2
+ * on x86, NEON on ARM64), falling back to the byte by byte scanning when
+ * none is available. Each #pj_cis_t grows by 36 bytes to keep the
+ * lookup table.
+ */
+#ifndef PJ_SCANNER_USE_SIMD
+#  define PJ_SCANNER_USE_SIMD                       1
+#endif
+
+
 
 /* **************************************************************************
  * STUN CLIENT CONFIGURATION
@@ -59,17 +59,29 @@ typedef struct pj_cis_t
 {
     pj_cis_elem_t   *cis_buf;       /**< Pointer to buffer.     */
     int              cis_id;        /**< Id.                    */
+#if defined(PJ_SCANNER_USE_SIMD) && PJ_SCANNER_USE_SIMD != 0
+    pj_uint8_t       vec_tbl[32];   /**< Lookup table for SIMD.  */
+    int              vec_valid;     /**< vec_tbl is up to date.  */
+#endif
 } pj_cis_t;
 
 
 /**
  * Set the membership of the specified character.
  * Note that this is a macro, and arguments may be evaluated more than once.
+ * Modifying the specification with this macro (or #PJ_CIS_CLR()) stops
+ * the SIMD scanning for it, until it's modified with one of the pj_cis_*()
+ * functions.
  *
  * @param cis       Pointer to character input specification.
  * @param c         The character.
  */
-#define PJ_CIS_SET(cis,c)   ((cis)->cis_buf[(int)(c)] |= (1 << (cis)->cis_id))
+#if defined(PJ_SCANNER_USE_SIMD) && PJ_SCANNER_USE_SIMD != 0
+#   define PJ_CIS_SET(cis,c) ((cis)->vec_valid = 0, \
+                              (cis)->cis_buf[(int)(c)] |= (1 << (cis)->cis_id))
+#else
+#   define PJ_CIS_SET(cis,c) ((cis)->cis_buf[(int)(c)] |= (1 << (cis)->cis_id))
+#endif
 
 /**
  * Remove the membership of the specified character.
@@ -78,7 +90,12 @@ typedef struct pj_cis_t
  * @param cis       Pointer to character input specification.
  * @param c         The character to be removed from the membership.
  */
-#define PJ_CIS_CLR(cis,c)   ((cis)->cis_buf[(int)c] &= ~(1 << (cis)->cis_id))
+#if defined(PJ_SCANNER_USE_SIMD) && PJ_SCANNER_USE_SIMD != 0
+#   define PJ_CIS_CLR(cis,c) ((cis)->vec_valid = 0, \
+                              (cis)->cis_buf[(int)c] &= ~(1 << (cis)->cis_id))
+#else
+#   define PJ_CIS_CLR(cis,c) ((cis)->cis_buf[(int)c] &= ~(1 << (cis)->cis_id))
+#endif
 
 /**
  * Check the membership of the specified character.
@@ -46,17 +46,29 @@ typedef int pj_cis_buf_t;
 typedef struct pj_cis_t
 {
     PJ_CIS_ELEM_TYPE    cis_buf[256];   /**< Internal buffer.   */
+#if defined(PJ_SCANNER_USE_SIMD) && PJ_SCANNER_USE_SIMD != 0
+    pj_uint8_t          vec_tbl[32];    /**< Lookup table for SIMD. */
+    int                 vec_valid;      /**< vec_tbl is up to date. */
+#endif
 } pj_cis_t;
 
 
 /**
  * Set the membership of the specified character.
  * Note that this is a macro, and arguments may be evaluated more than once.
+ * Modifying the specification with this macro (or #PJ_CIS_CLR()) stops
+ * the SIMD scanning for it, until it's modified with one of the pj_cis_*()
+ * functions.
  *
  * @param cis       Pointer to character input specification.
  * @param c         The character.
  */
-#define PJ_CIS_SET(cis,c)   ((cis)->cis_buf[(int)(c)] = 1)
+#if defined(PJ_SCANNER_USE_SIMD) && PJ_SCANNER_USE_SIMD != 0
+#   define PJ_CIS_SET(cis,c) ((cis)->vec_valid = 0, \
+                              (cis)->cis_buf[(int)(c)] = 1)
+#else
+#   define PJ_CIS_SET(cis,c) ((cis)->cis_buf[(int)(c)] = 1)
+#endif
 
 /**
  * Remove the membership of the specified character.
@@ -65,7 +77,12 @@ typedef struct pj_cis_t
  * @param cis       Pointer to character input specification.
  * @param c         The character to be removed from the membership.
  */
-#define PJ_CIS_CLR(cis,c)   ((cis)->cis_buf[(int)c] = 0)
+#if defined(PJ_SCANNER_USE_SIMD) && PJ_SCANNER_USE_SIMD != 0
+#   define PJ_CIS_CLR(cis,c) ((cis)->vec_valid = 0, \
+                              (cis)->cis_buf[(int)c] = 0)
+#else
+#   define PJ_CIS_CLR(cis,c) ((cis)->cis_buf[(int)c] = 0)
+#endif
 
 /**
  * Check the membership of the specified character.
@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 2025 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+
+#if INCLUDE_SCANNER_TEST
+
+#include <pjlib-util/scanner.h>
+#include <pjlib.h>
+
+#define THIS_FILE   "scanner_test.c"
+
+/* Number of random specifications and buffers to try. The buffers are
+ * long enough to go through the 32 bytes SIMD loop, the 16 bytes loop and
+ * the byte by byte tail.
+ */
+enum
+{
+    SPEC_COUNT  = 40,
+    BUF_COUNT   = 50,
+    BUF_LEN     = 100
+};
+
+static int syntax_err_cnt;
+
+static void on_syntax_error(pj_scanner *scanner)
+{
+    PJ_UNUSED_ARG(scanner);
+    ++syntax_err_cnt;
+}
+
+/* Fill the buffer mostly with members of the specification, so that
+ * there are runs of various lengths.
+ */
+static void fill_buf(char *buf, unsigned len, const pj_bool_t member[256])
+{
+    unsigned i;
+
+    for (i = 0; i < len; ++i) {
+        int c = pj_rand() & 0xFF;
+
+        if ((pj_rand() % 16) != 0) {
+            unsigned n;
+            for (n = 0; n < 256 && !member[c]; ++n)
+                c = (c + 1) & 0xFF;
+        }
+        buf[i] = (char)c;
+    }
+}
+
+/* Compare the scanner functions with a plain loop over the membership
+ * array, at every starting position of the buffer.
+ */
+static int check_spec(const pj_cis_t *cis, const pj_bool_t member[256])
+{
+    char buf[BUF_LEN + 1];
+    unsigned n, start, len;
+
+    for (n = 0; n < BUF_COUNT; ++n) {
+        len = (unsigned)(pj_rand() % BUF_LEN) + 1;
+        fill_buf(buf, len, member);
+        buf[len] = '\0';
+
+        for (start = 0; start < len; ++start) {
+            pj_scanner scanner;
+            pj_str_t out;
+            unsigned span, cspan;
+
+            for (span = start; span < len && member[(pj_uint8_t)buf[span]];
+                 ++span)
+                ;
+            for (cspan = start; cspan < len &&
+                                !member[(pj_uint8_t)buf[cspan]]; ++cspan)
+                ;
+
+            pj_scan_init(&scanner, buf + start, len - start, 0,
+                         &on_syntax_error);
+
+            pj_scan_peek(&scanner, cis, &out);
+            PJ_TEST_EQ(out.slen, span - start, NULL, return -10);
+
+            pj_scan_peek_until(&scanner, cis, &out);
+            PJ_TEST_EQ(out.slen, cspan - start, NULL, return -20);
+
+            if (span > start) {
+                pj_scan_get(&scanner, cis, &out);
+                PJ_TEST_EQ(out.slen, span - start, NULL, return -30);
+                PJ_TEST_EQ(scanner.curptr, buf + span, NULL, return -31);
+            } else {
+                pj_scan_get_until(&scanner, cis, &out);
+                PJ_TEST_EQ(out.slen, cspan - start, NULL, return -40);
+                PJ_TEST_EQ(scanner.curptr, buf + cspan, NULL, return -41);
+            }
+
+            pj_scan_fini(&scanner);
+        }
+    }
+
+    return 0;
+}
+
+static int cis_test(void)
+{
+    unsigned i, c;
+
+    for (i = 0; i < SPEC_COUNT; ++i) {
+        pj_cis_buf_t cis_buf;
+        pj_cis_t cis;
+        pj_bool_t member[256];
+        unsigned n;
+        int rc;
+
+        pj_cis_buf_init(&cis_buf);
+        PJ_TEST_SUCCESS(pj_cis_init(&cis_buf, &cis), NULL, return -100);
+        pj_bzero(member, sizeof(member));
+
+        /* Build a random specification from ranges, including characters
+         * above 0x7F, and occasionally invert it.
+         */
+        for (n = (unsigned)(pj_rand() % 4) + 1; n > 0; --n) {
+            int cstart = (pj_rand() % 255) + 1;
+            int cend = cstart + (pj_rand() % 64) + 1;
+
+            if (cend > 256)
+                cend = 256;
+            pj_cis_add_range(&cis, cstart, cend);
+            for (c = cstart; c < (unsigned)cend; ++c)
+                member[c] = PJ_TRUE;
+        }
+        if (i % 4 == 1) {
+            pj_cis_invert(&cis);
+            for (c = 1; c < 256; ++c)
+                member[c] = !member[c];
+        }
+        if (i % 4 == 2) {
+            pj_cis_del_str(&cis, "aeiou");
+            member['a'] = member['e'] = member['i'] = member['o'] =
+                member['u'] = PJ_FALSE;
+        }
+
+        for (c = 0; c < 256; ++c) {
+            PJ_TEST_EQ(!pj_cis_match(&cis, (pj_uint8_t)c), !member[c],
+                       NULL, return -110);
+        }
+
+        rc = check_spec(&cis, member);
+        if (rc != 0)
+            return rc;
+
+        /* Modifying the specification with the macro must also be
+         * picked up by the scanner.
+         */
+        PJ_CIS_SET(&cis, 'x');
+        member['x'] = PJ_TRUE;
+        rc = check_spec(&cis, member);
+        if (rc != 0)
+            return rc - 1000;
+    }
+
+    return 0;
+}
+
+static int chr_test(void)
+{
+    static const char chars[] = " \t;,>\r\n";
+    char buf[BUF_LEN + 1];
+    pj_bool_t member[256];
+    unsigned n, start, len;
+
+    /* Text that is mostly not in chars */
+    pj_bzero(member, sizeof(member));
+    for (n = 'a'; n <= 'z'; ++n)
+        member[n] = PJ_TRUE;
+
+    for (n = 0; n < BUF_COUNT; ++n) {
+        len = (unsigned)(pj_rand() % BUF_LEN) + 1;
+        fill_buf(buf, len, member);
+        for (start = 0; start < len; ++start) {
+            if (pj_rand() % 8 == 0)
+                buf[start] = chars[pj_rand() % (sizeof(chars)-1)];
+        }
+        buf[len] = '\0';
+
+        for (start = 0; start < len; ++start) {
+            pj_scanner scanner;
+            pj_str_t out;
+            unsigned until, until_ch;
+
+            for (until = start; until < len &&
+                                !memchr(chars, buf[until], sizeof(chars)-1);
+                 ++until)
+                ;
+            for (until_ch = start; until_ch < len && buf[until_ch] != ';';
+                 ++until_ch)
+                ;
+
+            pj_scan_init(&scanner, buf + start, len - start, 0,
+                         &on_syntax_error);
+
+            pj_scan_get_until_chr(&scanner, chars, &out);
+            PJ_TEST_EQ(out.slen, until - start, NULL, return -200);
+
+            pj_scan_fini(&scanner);
+
+            pj_scan_init(&scanner, buf + start, len - start, 0,
+                         &on_syntax_error);
+
+            pj_scan_get_until_ch(&scanner, ';', &out);
+            PJ_TEST_EQ(out.slen, until_ch - start, NULL, return -210);
+
+            pj_scan_fini(&scanner);
+        }
+    }
+
+    return 0;
+}
+
+static int whitespace_test(void)
+{
+    char buf[BUF_LEN + 1];
+    unsigned n, ws;
+
+    for (n = 0; n < BUF_COUNT * 4; ++n) {
+        pj_scanner scanner;
+        unsigned len = (unsigned)(pj_rand() % BUF_LEN) + 1;
+
+        ws = (unsigned)(pj_rand() % len);
+        for (len = 0; len < ws; ++len)
+            buf[len] = (pj_rand() & 1) ? ' ' : '\t';
+        buf[len++] = 'x';
+        buf[len] = '\0';
+
+        pj_scan_init(&scanner, buf, len, PJ_SCAN_AUTOSKIP_WS,
+                     &on_syntax_error);
+        PJ_TEST_EQ(scanner.curptr, buf + ws, NULL, return -300);
+        PJ_TEST_EQ(*scanner.curptr, 'x', NULL, return -301);
+        pj_scan_fini(&scanner);
+
+        /* Whitespace at the end of the input */
+        pj_scan_init(&scanner, buf, ws, PJ_SCAN_AUTOSKIP_WS,
+                     &on_syntax_error);
+        PJ_TEST_EQ(scanner.curptr, buf + ws, NULL, return -310);
+        pj_scan_fini(&scanner);
+    }
+
+    return 0;
+}
+
+int scanner_test(void)
+{
+    int rc;
+
+    pj_srand(0x5ca77e5);
+    syntax_err_cnt = 0;
+
+    rc = cis_test();
+    if (rc != 0)
+        return rc;
+
+    rc = chr_test();
+    if (rc != 0)
+        return rc;
+
+    rc = whitespace_test();
+    if (rc != 0)
+        return rc;
+
+    PJ_TEST_EQ(syntax_err_cnt, 0, NULL, return -400);
+
+    return 0;
+}
+
+#else
+/* To prevent warning about "translation unit is empty"
+ * when this test is disabled.
+ */
+int dummy_scanner_test;
+#endif  /* INCLUDE_SCANNER_TEST */
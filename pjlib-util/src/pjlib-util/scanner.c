@@ -33,6 +33,14 @@
 #define PJ_SCAN_CHECK_EOF(s)            (s != scanner->end)
 
 
+#if defined(PJ_SCANNER_USE_SIMD) && PJ_SCANNER_USE_SIMD != 0
+#  include "scanner_simd.c"
+#else
+#  define SCAN_HAS_SIMD                 0
+#  define scan_simd_init()
+#  define cis_update_vec(cis)
+#endif
+
 #if defined(PJ_SCANNER_USE_BITWISE) && PJ_SCANNER_USE_BITWISE != 0
 #  include "scanner_cis_bitwise.c"
 #else
@@ -40,6 +48,110 @@
 #endif
 
 
+/* Most tokens are short, so the span functions below check the first
+ * characters one by one inline, and only continue with the SIMD kernels
+ * in a separate function when the run is longer than this.
+ */
+#define SCAN_SIMD_MIN_RUN               16
+
+#if SCAN_HAS_SIMD
+static char *cis_span_long(const pj_cis_t *spec, char *s, char *end,
+                           pj_bool_t in_set)
+{
+    if (scan_simd.cis_span && spec->vec_valid)
+        s = (*scan_simd.cis_span)(spec, s, end, in_set);
+    while (s != end && !pj_cis_match(spec, *s) == !in_set)
+        ++s;
+    return s;
+}
+
+static char *chr_cspan_long(const char *chars, pj_size_t nchars,
+                            char *s, char *end)
+{
+    if (scan_simd.chr_span)
+        s = (*scan_simd.chr_span)(chars, nchars, s, end, PJ_FALSE);
+    while (s != end && !memchr(chars, *s, nchars))
+        ++s;
+    return s;
+}
+#endif
+
+/* Skip the characters that are in the specification. */
+PJ_INLINE(char*) cis_span(const pj_cis_t *spec, char *s, char *end)
+{
+#if SCAN_HAS_SIMD
+    char *lim = (end - s > SCAN_SIMD_MIN_RUN) ? s + SCAN_SIMD_MIN_RUN : end;
+
+    while (s != lim && pj_cis_match(spec, *s))
+        ++s;
+    if (s != lim || s == end)
+        return s;
+    return cis_span_long(spec, s, end, PJ_TRUE);
+#else
+    while (s != end && pj_cis_match(spec, *s))
+        ++s;
+    return s;
+#endif
+}
+
+/* Skip the characters that are not in the specification. */
+PJ_INLINE(char*) cis_cspan(const pj_cis_t *spec, char *s, char *end)
+{
+#if SCAN_HAS_SIMD
+    char *lim = (end - s > SCAN_SIMD_MIN_RUN) ? s + SCAN_SIMD_MIN_RUN : end;
+
+    while (s != lim && !pj_cis_match(spec, *s))
+        ++s;
+    if (s != lim || s == end)
+        return s;
+    return cis_span_long(spec, s, end, PJ_FALSE);
+#else
+    while (s != end && !pj_cis_match(spec, *s))
+        ++s;
+    return s;
+#endif
+}
+
+/* Skip the characters that are not in chars. */
+PJ_INLINE(char*) chr_cspan(const char *chars, pj_size_t nchars,
+                           char *s, char *end)
+{
+#if SCAN_HAS_SIMD
+    char *lim = (end - s > SCAN_SIMD_MIN_RUN) ? s + SCAN_SIMD_MIN_RUN : end;
+
+    while (s != lim && !memchr(chars, *s, nchars))
+        ++s;
+    if (s != lim || s == end)
+        return s;
+    return chr_cspan_long(chars, nchars, s, end);
+#else
+    while (s != end && !memchr(chars, *s, nchars))
+        ++s;
+    return s;
+#endif
+}
+
+/* Skip spaces and tabs. Runs of whitespace are mostly one character
+ * long, so check the first two characters before going wide.
+ */
+static char *ws_span(char *s, char *end)
+{
+    if (s == end || !PJ_SCAN_IS_SPACE(*s))
+        return s;
+    ++s;
+    if (s == end || !PJ_SCAN_IS_SPACE(*s))
+        return s;
+
+#if SCAN_HAS_SIMD
+    if (scan_simd.chr_span)
+        s = (*scan_simd.chr_span)(" \t", 2, s, end, PJ_TRUE);
+#endif
+    while (s != end && PJ_SCAN_IS_SPACE(*s))
+        ++s;
+    return s;
+}
+
+
 /* coverity[+kill] */
 static void pj_scan_syntax_err(pj_scanner *scanner)
 {
@@ -56,6 +168,7 @@ PJ_DEF(void) pj_cis_add_range(pj_cis_t *cis, int cstart, int cend)
         PJ_CIS_SET(cis, cstart);
         ++cstart;
     }
+    cis_update_vec(cis);
 }
 
 PJ_DEF(void) pj_cis_add_alpha(pj_cis_t *cis)
@@ -75,6 +188,7 @@ PJ_DEF(void) pj_cis_add_str( pj_cis_t *cis, const char *str)
         PJ_CIS_SET(cis, *str);
         ++str;
     }
+    cis_update_vec(cis);
 }
 
 PJ_DEF(void) pj_cis_add_cis( pj_cis_t *cis, const pj_cis_t *rhs)
@@ -84,6 +198,7 @@ PJ_DEF(void) pj_cis_add_cis( pj_cis_t *cis, const pj_cis_t *rhs)
         if (PJ_CIS_ISSET(rhs, i))
             PJ_CIS_SET(cis, i);
     }
+    cis_update_vec(cis);
 }
 
 PJ_DEF(void) pj_cis_del_range( pj_cis_t *cis, int cstart, int cend)
@@ -92,6 +207,7 @@ PJ_DEF(void) pj_cis_del_range( pj_cis_t *cis, int cstart, int cend)
         PJ_CIS_CLR(cis, cstart);
         cstart++;
     }
+    cis_update_vec(cis);
 }
 
 PJ_DEF(void) pj_cis_del_str( pj_cis_t *cis, const char *str)
@@ -100,6 +216,7 @@ PJ_DEF(void) pj_cis_del_str( pj_cis_t *cis, const char *str)
         PJ_CIS_CLR(cis, *str);
         ++str;
     }
+    cis_update_vec(cis);
 }
 
 PJ_DEF(void) pj_cis_invert( pj_cis_t *cis )
@@ -112,6 +229,7 @@ PJ_DEF(void) pj_cis_invert( pj_cis_t *cis )
         else
             PJ_CIS_SET(cis,i);
     }
+    cis_update_vec(cis);
 }
 
 PJ_DEF(void) pj_scan_init( pj_scanner *scanner, char *bufstart, 
@@ -127,6 +245,8 @@ PJ_DEF(void) pj_scan_init( pj_scanner *scanner, char *bufstart,
     scanner->callback = callback;
     scanner->skip_ws = options;
 
+    scan_simd_init();
+
     if (scanner->skip_ws) 
         pj_scan_skip_whitespace(scanner);
 }
@@ -140,11 +260,7 @@ PJ_DEF(void) pj_scan_fini( pj_scanner *scanner )
 
 PJ_DEF(void) pj_scan_skip_whitespace( pj_scanner *scanner )
 {
-    register char *s = scanner->curptr;
-
-    while (PJ_SCAN_CHECK_EOF(s) && PJ_SCAN_IS_SPACE(*s)) {
-        ++s;
-    }
+    register char *s = ws_span(scanner->curptr, scanner->end);
 
     if (PJ_SCAN_CHECK_EOF(s) && PJ_SCAN_IS_NEWLINE(*s) &&
         (scanner->skip_ws & PJ_SCAN_AUTOSKIP_NEWLINE))
@@ -161,9 +277,7 @@ PJ_DEF(void) pj_scan_skip_whitespace( pj_scanner *scanner )
                 ++scanner->line;
                 scanner->curptr = scanner->start_line = s;
             } else if (PJ_SCAN_IS_SPACE(*s)) {
-                do {
-                    ++s;
-                } while (PJ_SCAN_CHECK_EOF(s) && PJ_SCAN_IS_SPACE(*s));
+                s = ws_span(s, scanner->end);
             } else {
                 break;
             }
@@ -186,13 +300,8 @@ PJ_DEF(void) pj_scan_skip_whitespace( pj_scanner *scanner )
         scanner->start_line = s;
 
         if (PJ_SCAN_CHECK_EOF(s) && PJ_SCAN_IS_SPACE(*s)) {
-            register char *t = s;
-            do {
-                ++t;
-            } while (PJ_SCAN_CHECK_EOF(t) && PJ_SCAN_IS_SPACE(*t));
-
             ++scanner->line;
-            scanner->curptr = t;
+            scanner->curptr = ws_span(s, scanner->end);
         }
     } else {
         scanner->curptr = s;
@@ -226,8 +335,7 @@ PJ_DEF(int) pj_scan_peek( pj_scanner *scanner,
         return -1;
     }
 
-    while (PJ_SCAN_CHECK_EOF(s) && pj_cis_match(spec, *s))
-        ++s;
+    s = cis_span(spec, s, scanner->end);
 
     pj_strset3(out, scanner->curptr, s);
     return *s;
@@ -260,8 +368,7 @@ PJ_DEF(int) pj_scan_peek_until( pj_scanner *scanner,
         return -1;
     }
 
-    while (PJ_SCAN_CHECK_EOF(s) && !pj_cis_match( spec, *s))
-        ++s;
+    s = cis_cspan(spec, s, scanner->end);
 
     pj_strset3(out, scanner->curptr, s);
     return *s;
@@ -280,9 +387,7 @@ PJ_DEF(void) pj_scan_get( pj_scanner *scanner,
         return;
     }
 
-    do {
-        ++s;
-    } while (PJ_SCAN_CHECK_EOF(s) && pj_cis_match(spec, *s));
+    s = cis_span(spec, s+1, scanner->end);
 
     pj_strset3(out, scanner->curptr, s);
 
@@ -331,9 +436,7 @@ PJ_DEF(void) pj_scan_get_unescape( pj_scanner *scanner,
         
         if (pj_cis_match(spec, *s)) {
             char *start = s;
-            do {
-                ++s;
-            } while (PJ_SCAN_CHECK_EOF(s) && pj_cis_match(spec, *s));
+            s = cis_span(spec, s+1, scanner->end);
 
             if (dst != start) pj_memmove(dst, start, s-start);
             dst += (s-start);
@@ -526,9 +629,7 @@ PJ_DEF(void) pj_scan_get_until( pj_scanner *scanner,
         return;
     }
 
-    while (PJ_SCAN_CHECK_EOF(s) && !pj_cis_match(spec, *s)) {
-        ++s;
-    }
+    s = cis_cspan(spec, s, scanner->end);
 
     pj_strset3(out, scanner->curptr, s);
 
@@ -552,9 +653,9 @@ PJ_DEF(void) pj_scan_get_until_ch( pj_scanner *scanner,
         return;
     }
 
-    while (PJ_SCAN_CHECK_EOF(s) && *s != until_char) {
-        ++s;
-    }
+    s = (char*)pj_memchr(s, until_char, scanner->end - s);
+    if (!s)
+        s = scanner->end;
 
     pj_strset3(out, scanner->curptr, s);
 
@@ -580,9 +681,7 @@ PJ_DEF(void) pj_scan_get_until_chr( pj_scanner *scanner,
     }
 
     speclen = strlen(until_spec);
-    while (PJ_SCAN_CHECK_EOF(s) && !memchr(until_spec, *s, speclen)) {
-        ++s;
-    }
+    s = chr_cspan(until_spec, speclen, s, scanner->end);
 
     pj_strset3(out, scanner->curptr, s);
 
@@ -38,6 +38,7 @@ PJ_DEF(pj_status_t) pj_cis_init(pj_cis_buf_t *cis_buf, pj_cis_t *cis)
         if ((cis_buf->use_mask & (1 << i)) == 0) {
             cis->cis_id = i;
             cis_buf->use_mask |= (1 << i);
+            cis_update_vec(cis);
             return PJ_SUCCESS;
         }
     }
@@ -62,6 +63,7 @@ PJ_DEF(pj_status_t) pj_cis_dup( pj_cis_t *new_cis, pj_cis_t *existing)
         else
             PJ_CIS_CLR(new_cis, i);
     }
+    cis_update_vec(new_cis);
 
     return PJ_SUCCESS;
 }
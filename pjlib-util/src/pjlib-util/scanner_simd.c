@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2025 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * THIS FILE IS INCLUDED BY scanner.c.
+ * DO NOT COMPILE THIS FILE ALONE!
+ */
+
+/*
+ * SIMD character classification.
+ *
+ * Each pj_cis_t keeps a 32 bytes lookup table (vec_tbl) indexed by the
+ * low nibble of the character. For character c, bit (c>>4)&7 of
+ * vec_tbl[c&15] is set if c is in the specification and c < 0x80, and the
+ * same bit of vec_tbl[16+(c&15)] is set if c is in the specification and
+ * c >= 0x80. A vector of characters is then classified with two byte
+ * shuffles on the low nibbles and one on the high nibbles.
+ *
+ * The kernels below stop at the first character whose membership differs
+ * from in_set, or when less than a vector is left before the end, in which
+ * case the caller finishes byte by byte.
+ */
+
+typedef char* (*cis_span_func)(const pj_cis_t *cis, char *s, const char *end,
+                               pj_bool_t in_set);
+typedef char* (*chr_span_func)(const char *chars, pj_size_t nchars,
+                               char *s, const char *end, pj_bool_t in_set);
+
+static struct scan_simd
+{
+    pj_bool_t       initialized;
+    cis_span_func   cis_span;
+    chr_span_func   chr_span;
+} scan_simd;
+
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+
+#include <immintrin.h>
+
+#define SCAN_HAS_SIMD   1
+
+__attribute__((target("ssse3")))
+static char *cis_span_ssse3(const pj_cis_t *cis, char *s, const char *end,
+                            pj_bool_t in_set)
+{
+    const __m128i tbl_lo = _mm_loadu_si128((const __m128i*)cis->vec_tbl);
+    const __m128i tbl_hi = _mm_loadu_si128((const __m128i*)
+                                           (cis->vec_tbl + 16));
+    const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+                                       1, 2, 4, 8, 16, 32, 64, -128);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i seven = _mm_set1_epi8(7);
+    const unsigned flip = in_set ? 0 : 0xFFFF;
+
+    while (end - s >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)s);
+        __m128i lo = _mm_and_si128(v, nibble);
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+        __m128i upper = _mm_cmpgt_epi8(hi, seven);
+        __m128i row = _mm_or_si128(
+                        _mm_and_si128(upper, _mm_shuffle_epi8(tbl_hi, lo)),
+                        _mm_andnot_si128(upper, _mm_shuffle_epi8(tbl_lo, lo)));
+        __m128i hit = _mm_and_si128(row, _mm_shuffle_epi8(bits, hi));
+        unsigned miss, stop;
+
+        /* Bit i of miss is set if s[i] is not in the specification */
+        miss = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(hit,
+                                                          _mm_setzero_si128()));
+        stop = miss ^ flip;
+        if (stop)
+            return s + __builtin_ctz(stop);
+        s += 16;
+    }
+    return s;
+}
+
+__attribute__((target("avx2")))
+static char *cis_span_avx2(const pj_cis_t *cis, char *s, const char *end,
+                           pj_bool_t in_set)
+{
+    const __m256i tbl_lo = _mm256_broadcastsi128_si256(
+                             _mm_loadu_si128((const __m128i*)cis->vec_tbl));
+    const __m256i tbl_hi = _mm256_broadcastsi128_si256(
+                             _mm_loadu_si128((const __m128i*)
+                                             (cis->vec_tbl + 16)));
+    const __m256i bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+                                          1, 2, 4, 8, 16, 32, 64, -128,
+                                          1, 2, 4, 8, 16, 32, 64, -128,
+                                          1, 2, 4, 8, 16, 32, 64, -128);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i seven = _mm256_set1_epi8(7);
+    const unsigned flip = in_set ? 0 : 0xFFFFFFFF;
+
+    while (end - s >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)s);
+        __m256i lo = _mm256_and_si256(v, nibble);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+        __m256i row = _mm256_blendv_epi8(_mm256_shuffle_epi8(tbl_lo, lo),
+                                         _mm256_shuffle_epi8(tbl_hi, lo),
+                                         _mm256_cmpgt_epi8(hi, seven));
+        __m256i hit = _mm256_and_si256(row, _mm256_shuffle_epi8(bits, hi));
+        unsigned miss, stop;
+
+        miss = (unsigned)_mm256_movemask_epi8(
+                            _mm256_cmpeq_epi8(hit, _mm256_setzero_si256()));
+        stop = miss ^ flip;
+        if (stop)
+            return s + __builtin_ctz(stop);
+        s += 32;
+    }
+
+    /* The remaining 16..31 bytes */
+    return cis_span_ssse3(cis, s, end, in_set);
+}
+
+__attribute__((target("sse2")))
+static char *chr_span_sse2(const char *chars, pj_size_t nchars,
+                           char *s, const char *end, pj_bool_t in_set)
+{
+    const unsigned flip = in_set ? 0xFFFF : 0;
+
+    while (end - s >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)s);
+        __m128i hit = _mm_setzero_si128();
+        unsigned stop;
+        pj_size_t i;
+
+        for (i = 0; i < nchars; ++i)
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8(chars[i])));
+
+        /* Bit i of stop is set if s[i] is in chars, flipped for in_set */
+        stop = (unsigned)_mm_movemask_epi8(hit) ^ flip;
+        if (stop)
+            return s + __builtin_ctz(stop);
+        s += 16;
+    }
+    return s;
+}
+
+static void scan_simd_select(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        scan_simd.cis_span = &cis_span_avx2;
+        scan_simd.chr_span = &chr_span_sse2;
+    } else if (__builtin_cpu_supports("ssse3")) {
+        scan_simd.cis_span = &cis_span_ssse3;
+        scan_simd.chr_span = &chr_span_sse2;
+    }
+}
+
+
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+
+#include <arm_neon.h>
+
+#define SCAN_HAS_SIMD   1
+
+/* NEON has no movemask. Narrow each 0x00/0xFF lane to a nibble, giving
+ * four bits per character in a 64-bit word.
+ */
+static pj_uint64_t neon_mask(uint8x16_t v)
+{
+    uint8x8_t n = vshrn_n_u16(vreinterpretq_u16_u8(v), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(n), 0);
+}
+
+static char *cis_span_neon(const pj_cis_t *cis, char *s, const char *end,
+                           pj_bool_t in_set)
+{
+    static const pj_uint8_t bit_arr[16] = { 1, 2, 4, 8, 16, 32, 64, 128,
+                                            1, 2, 4, 8, 16, 32, 64, 128 };
+    const uint8x16_t tbl_lo = vld1q_u8(cis->vec_tbl);
+    const uint8x16_t tbl_hi = vld1q_u8(cis->vec_tbl + 16);
+    const uint8x16_t bits = vld1q_u8(bit_arr);
+    const uint8x16_t nibble = vdupq_n_u8(0x0F);
+    const uint8x16_t seven = vdupq_n_u8(7);
+
+    while (end - s >= 16) {
+        uint8x16_t v = vld1q_u8((const pj_uint8_t*)s);
+        uint8x16_t lo = vandq_u8(v, nibble);
+        uint8x16_t hi = vshrq_n_u8(v, 4);
+        uint8x16_t row = vbslq_u8(vcgtq_u8(hi, seven),
+                                  vqtbl1q_u8(tbl_hi, lo),
+                                  vqtbl1q_u8(tbl_lo, lo));
+        uint8x16_t hit = vtstq_u8(row, vqtbl1q_u8(bits, hi));
+        pj_uint64_t stop = neon_mask(in_set ? vmvnq_u8(hit) : hit);
+
+        if (stop)
+            return s + (__builtin_ctzll(stop) >> 2);
+        s += 16;
+    }
+    return s;
+}
+
+static char *chr_span_neon(const char *chars, pj_size_t nchars,
+                           char *s, const char *end, pj_bool_t in_set)
+{
+    while (end - s >= 16) {
+        uint8x16_t v = vld1q_u8((const pj_uint8_t*)s);
+        uint8x16_t hit = vdupq_n_u8(0);
+        pj_uint64_t stop;
+        pj_size_t i;
+
+        for (i = 0; i < nchars; ++i)
+            hit = vorrq_u8(hit, vceqq_u8(v, vdupq_n_u8((pj_uint8_t)chars[i])));
+
+        stop = neon_mask(in_set ? vmvnq_u8(hit) : hit);
+        if (stop)
+            return s + (__builtin_ctzll(stop) >> 2);
+        s += 16;
+    }
+    return s;
+}
+
+static void scan_simd_select(void)
+{
+    /* NEON is mandatory on ARM64 */
+    scan_simd.cis_span = &cis_span_neon;
+    scan_simd.chr_span = &chr_span_neon;
+}
+
+#else
+
+#define SCAN_HAS_SIMD   0
+
+static void scan_simd_select(void)
+{
+}
+
+#endif
+
+
+/* Select the SIMD kernels for this CPU. This is called whenever a
+ * specification or a scanner is initialized, and only does the work
+ * once.
+ */
+static void scan_simd_init(void)
+{
+    if (scan_simd.initialized)
+        return;
+
+    scan_simd_select();
+    scan_simd.initialized = PJ_TRUE;
+}
+
+
+/* Rebuild the lookup table of the specification after it's modified. */
+static void cis_update_vec(pj_cis_t *cis)
+{
+    unsigned c;
+
+    pj_bzero(cis->vec_tbl, sizeof(cis->vec_tbl));
+    for (c = 0; c < 256; ++c) {
+        if (PJ_CIS_ISSET(cis, c)) {
+            cis->vec_tbl[(c & 0x0F) + ((c & 0x80) ? 16 : 0)] |=
+                (pj_uint8_t)(1 << ((c >> 4) & 7));
+        }
+    }
+    cis->vec_valid = 1;
+
+    scan_simd_init();
+}
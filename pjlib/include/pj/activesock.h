@@ -212,6 +212,12 @@ typedef struct pj_activesock_cfg
      * on multiprocessor systems, when the ioqueue is polled by more than
      * one threads.
      *
+     * For datagram sockets, setting this field to more than one also
+     * enables batched receive when the ioqueue supports it (see
+     * PJ_IOQUEUE_DGRAM_BATCH): the pending reads are filled with a single
+     * recvmmsg() call per readiness event and the datagrams are reported
+     * to \a on_data_recvfrom() back to back.
+     *
      * The default value is 1.
      */
     unsigned async_cnt;
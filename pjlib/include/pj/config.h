@@ -441,6 +441,35 @@
 #  define PJ_LOG_USE_STACK_BUFFER   1
 #endif
 
+/**
+ * Default number of messages that can be queued by the asynchronous log
+ * writer (see #pj_log_async_start()). Each entry takes PJ_LOG_MAX_SIZE
+ * bytes.
+ *
+ * Default: 256
+ */
+#ifndef PJ_LOG_ASYNC_QUEUE_SIZE
+#  define PJ_LOG_ASYNC_QUEUE_SIZE   256
+#endif
+
+/**
+ * Calculate hash values with SipHash-1-3, keyed with a random value chosen
+ * when PJLIB is initialized, instead of the classic multiply-by-33 hash.
+ * This processes the key a word at a time and makes it impractical for
+ * remote parties to craft keys that collide in the hash tables. Set this
+ * to zero if the application needs hash values that are the same across
+ * runs. Requires 64-bit integer support.
+ *
+ * Default: 1 if PJ_HAS_INT64 is set
+ */
+#ifndef PJ_HASH_USE_SIPHASH
+#  if defined(PJ_HAS_INT64) && PJ_HAS_INT64!=0
+#    define PJ_HASH_USE_SIPHASH     1
+#  else
+#    define PJ_HASH_USE_SIPHASH     0
+#  endif
+#endif
+
 /**
  * Enable log indentation feature.
  *
@@ -560,6 +589,23 @@
 #endif
 
 
+/**
+ * Maximum number of released pools per size class that the caching pool
+ * keeps in each thread's private cache (magazine), so that creating and
+ * releasing small pools doesn't need to take the caching pool's lock.
+ * Only pools of up to 8 KB are cached this way. The value can be lowered
+ * (or set to zero to disable the feature) at run-time with
+ * pj_caching_pool.magazine_size.
+ *
+ * The feature is not available when PJ_SAFE_POOL is enabled.
+ *
+ * Default: 8
+ */
+#ifndef PJ_CACHING_POOL_MAGAZINE_SIZE
+#   define PJ_CACHING_POOL_MAGAZINE_SIZE 8
+#endif
+
+
 /**
  * Enable timer debugging facility. When this is enabled, application
  * can call pj_timer_heap_dump() to show the contents of the timer
@@ -605,6 +651,28 @@
 #  define PJ_TIMER_USE_LINKED_LIST    0
 #endif
 
+/**
+ * The timer heap implementation used by pj_timer_heap_create(), and the
+ * default value of pj_timer_heap_cfg.type. Set to 1 (PJ_TIMER_HEAP_WHEEL)
+ * to use the hierarchical timing wheel, which has O(1) schedule and cancel
+ * and is suitable for hundreds of thousands of active timers.
+ *
+ * Default: 0 (PJ_TIMER_HEAP_BINARY)
+ */
+#ifndef PJ_TIMER_HEAP_DEFAULT_TYPE
+#  define PJ_TIMER_HEAP_DEFAULT_TYPE  0
+#endif
+
+/**
+ * Default tick resolution of the timing wheel timer heap, in milliseconds.
+ * Timers are rounded up to this resolution.
+ *
+ * Default: 1
+ */
+#ifndef PJ_TIMER_WHEEL_RESOLUTION
+#  define PJ_TIMER_WHEEL_RESOLUTION   1
+#endif
+
 /**
  * Set this to 1 to enable debugging on the group lock. Default: 0
  */
@@ -717,6 +785,9 @@
 /** Using Symbian (deprecated) */
 #define PJ_IOQUEUE_IMP_SYMBIAN      6
 
+/** Using Linux io_uring (experimental, requires Linux 5.11 or later) */
+#define PJ_IOQUEUE_IMP_IO_URING     7
+
 /**
  * I/O queue implementation backend.
  *
@@ -811,6 +882,26 @@
 #endif
 
 
+/**
+ * Maximum number of datagrams to be received or sent with a single
+ * recvmmsg()/sendmmsg() call by the select, epoll, and kqueue ioqueue.
+ * Batching is used when a readiness event is reported on a datagram
+ * socket that has more than one pending recvfrom() or queued sendto()
+ * operation, so applications that keep several read operations pending
+ * (e.g. activesock with async_cnt greater than one) can drain many
+ * datagrams with one system call. Set to 1 to disable batching.
+ *
+ * Default: 16 if recvmmsg()/sendmmsg() are available, otherwise 1.
+ */
+#ifndef PJ_IOQUEUE_DGRAM_BATCH
+#   if defined(PJ_SOCK_HAS_MMSG) && PJ_SOCK_HAS_MMSG!=0
+#       define PJ_IOQUEUE_DGRAM_BATCH   16
+#   else
+#       define PJ_IOQUEUE_DGRAM_BATCH   1
+#   endif
+#endif
+
+
 /**
  * Determine if FD_SETSIZE is changeable/set-able. If so, then we will
  * set it to PJ_IOQUEUE_MAX_HANDLES. Currently we detect this by checking
@@ -34,8 +34,17 @@ PJ_BEGIN_DECL
  * @{
  * A hash table is a dictionary in which keys are mapped to array positions by
  * hash functions. Having the keys of more than one item map to the same 
- * position is called a collision. In this library, we will chain the nodes
- * that have the same key in a list.
+ * position is called a collision. By default, this library chains the
+ * nodes that have the same key in a list. Tables created with
+ * #PJ_HASH_OPEN_ADDRESSING store the entries in a flat array instead,
+ * and grow automatically as entries are added.
+ *
+ * Unless PJ_HASH_USE_SIPHASH is disabled, hash values are calculated with
+ * SipHash-1-3 keyed with a random value chosen by pj_init(), so that
+ * remote parties can't choose keys (such as SIP branch parameters) that
+ * all fall into the same position. Hash values are therefore only
+ * meaningful within the process, and must not be stored or sent to other
+ * processes.
  */
 
 /**
@@ -54,6 +63,25 @@ PJ_BEGIN_DECL
  */
 typedef void *pj_hash_entry_buf[(PJ_HASH_ENTRY_BUF_SIZE+sizeof(void*)-1)/(sizeof(void*))];
 
+/**
+ * Options for #pj_hash_create2().
+ */
+typedef enum pj_hash_option
+{
+    /**
+     * Store the entries in a flat array using open addressing (linear
+     * probing) instead of chaining them in lists. The array is doubled
+     * when it gets three quarters full, so the \a size given to
+     * #pj_hash_create2() is only a hint. The extra memory is allocated
+     * from the pool given to #pj_hash_create2(), hence that pool must be
+     * guarded by the same lock as the hash table. Removing entries while
+     * iterating the table is safe, but adding new entries may invalidate
+     * the iterator.
+     */
+    PJ_HASH_OPEN_ADDRESSING = 1
+
+} pj_hash_option;
+
 /**
  * This is the function that is used by the hash table to calculate hash value
  * of the specified key.
@@ -71,7 +99,7 @@ PJ_DECL(pj_uint32_t) pj_hash_calc(pj_uint32_t hval,
 
 /**
  * Convert the key to lowercase and calculate the hash value. The resulting
- * string is stored in \c result.
+ * string is stored in \c result. Only ASCII letters are converted.
  *
  * @param hval      The initial hash value, normally zero.
  * @param result    Optional. Buffer to store the result, which must be enough
@@ -94,6 +122,20 @@ PJ_DECL(pj_uint32_t) pj_hash_calc_tolower(pj_uint32_t hval,
  */
 PJ_DECL(pj_hash_table_t*) pj_hash_create(pj_pool_t *pool, unsigned size);
 
+/**
+ * Create a hash table with the specified options.
+ *
+ * @param pool      the pool from which the hash table will be allocated
+ *                  from.
+ * @param size      the bucket size, or the expected number of entries for
+ *                  open addressing table.
+ * @param options   bitmask of #pj_hash_option.
+ *
+ * @return the hash table.
+ */
+PJ_DECL(pj_hash_table_t*) pj_hash_create2(pj_pool_t *pool, unsigned size,
+                                          unsigned options);
+
 
 /**
  * Get the value associated with the specified key.
@@ -241,6 +283,14 @@ PJ_DECL(pj_hash_iterator_t*) pj_hash_next( pj_hash_table_t *ht,
 PJ_DECL(void*) pj_hash_this( pj_hash_table_t *ht,
                              pj_hash_iterator_t *it );
 
+/**
+ * Internal PJLIB function to initialize the hash function. With
+ * PJ_HASH_USE_SIPHASH, this picks the random key of the hash, so it must
+ * be called before any hash value is calculated. This is called by
+ * pj_init(), and applications should not need to call it.
+ */
+PJ_DECL(void) pj_hash_init(void);
+
 
 /**
  * @}
@@ -92,6 +92,9 @@ PJ_BEGIN_DECL
  *  - <tt><b>/dev/epoll</b></tt> on Linux (user mode and kernel mode),
  *    a much faster replacement for select() on Linux (and more importantly
  *    doesn't have limitation on number of descriptors).
+ *  - <tt><b>io_uring</b></tt> on Linux 5.11 or later, a completion based
+ *    mechanism where the socket operations are carried out by the kernel
+ *    and the completions are reaped in batches, saving system calls.
  *  - <b>I/O Completion ports</b> on Windows NT/2000/XP, which is the most
  *    efficient way to dispatch events in Windows NT based OSes, and most
  *    importantly, it doesn't have the limit on how many handles to monitor.
@@ -937,14 +940,112 @@ PJ_DECL(pj_status_t) pj_ioqueue_sendto( pj_ioqueue_key_t *key,
  * @param ioqueue        The ioqueue instance.
  *
  * @return          The OS handle associated with the instance.
- *                  For epoll/kqueue this will be a pointer to the file
- *                  descriptor. For all other platforms, this will be a pointer
+ *                  For epoll/kqueue/io_uring this will be a pointer to the
+ *                  file descriptor. For all other platforms, this will be a pointer
  *                  to a platform-specific handle.
  *                  If no handle is available, NULL will be returned.
  */
 PJ_DECL(pj_oshandle_t) pj_ioqueue_get_os_handle( pj_ioqueue_t *ioqueue );
 
 
+/****************************************************************************
+ * IOQUEUE GROUP
+ */
+
+/**
+ * Create a group of ioqueue instances ("shards"). Each shard is a regular
+ * ioqueue with its own polling set (e.g. its own epoll descriptor), so
+ * when every worker thread polls its own shard, the threads do not
+ * contend on a single polling set and key mutexes. Sockets are assigned
+ * to the shards by hash, see #pj_ioqueue_group_select() and
+ * #pj_ioqueue_group_register_sock2().
+ *
+ * Note that the application must poll all shards, typically one worker
+ * thread per shard, otherwise sockets registered to an unpolled shard
+ * will never get their events.
+ *
+ * @param pool          The pool to allocate the group and the shards.
+ * @param shard_cnt     Number of shards, must be at least one.
+ * @param max_fd        The maximum number of handles for each shard.
+ * @param cfg           Optional ioqueue configuration to be applied to
+ *                      all shards.
+ * @param p_grp         Pointer to hold the newly created group.
+ *
+ * @return              PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pj_ioqueue_group_create(pj_pool_t *pool,
+                                             unsigned shard_cnt,
+                                             pj_size_t max_fd,
+                                             const pj_ioqueue_cfg *cfg,
+                                             pj_ioqueue_group_t **p_grp);
+
+/**
+ * Destroy the group and all of its shards.
+ *
+ * @param grp           The ioqueue group.
+ *
+ * @return              PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pj_ioqueue_group_destroy(pj_ioqueue_group_t *grp);
+
+/**
+ * Get the number of shards in the group.
+ *
+ * @param grp           The ioqueue group.
+ *
+ * @return              Number of shards.
+ */
+PJ_DECL(unsigned) pj_ioqueue_group_get_count(pj_ioqueue_group_t *grp);
+
+/**
+ * Get a shard by its index.
+ *
+ * @param grp           The ioqueue group.
+ * @param idx           Shard index, must be less than the shard count.
+ *
+ * @return              The ioqueue instance, or NULL if index is invalid.
+ */
+PJ_DECL(pj_ioqueue_t*) pj_ioqueue_group_get(pj_ioqueue_group_t *grp,
+                                            unsigned idx);
+
+/**
+ * Select a shard for the specified hash value (for example, socket
+ * descriptor or a hash of the remote address). The same hash value always
+ * maps to the same shard.
+ *
+ * @param grp           The ioqueue group.
+ * @param hash          The hash value.
+ *
+ * @return              The ioqueue instance.
+ */
+PJ_DECL(pj_ioqueue_t*) pj_ioqueue_group_select(pj_ioqueue_group_t *grp,
+                                               pj_uint32_t hash);
+
+/**
+ * Register a socket to the shard selected by hashing the socket
+ * descriptor. This is equivalent to calling #pj_ioqueue_register_sock2()
+ * on the shard returned by #pj_ioqueue_group_select().
+ *
+ * @param pool          To allocate the resource for the specified handle.
+ * @param grp           The ioqueue group.
+ * @param sock          The socket.
+ * @param grp_lock      Optional group lock to be assigned to the key.
+ * @param user_data     User data to be associated with the key.
+ * @param cb            Callback to be called when I/O operation completes.
+ * @param key           Pointer to receive the key.
+ *
+ * @return              PJ_SUCCESS on success, or the error code.
+ */
+PJ_DECL(pj_status_t) pj_ioqueue_group_register_sock2(
+                                        pj_pool_t *pool,
+                                        pj_ioqueue_group_t *grp,
+                                        pj_sock_t sock,
+                                        pj_grp_lock_t *grp_lock,
+                                        void *user_data,
+                                        const pj_ioqueue_callback *cb,
+                                        pj_ioqueue_key_t **key);
+
+
 /**
  * @}
  */
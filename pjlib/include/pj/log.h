@@ -132,6 +132,84 @@ typedef void pj_log_func(int level, const char *data, int len);
 PJ_DECL(void) pj_log_write(int level, const char *buffer, int len);
 
 
+/**
+ * Parameters for the asynchronous log writer, see #pj_log_async_start().
+ * Use #pj_log_async_param_default() to initialize this structure.
+ */
+typedef struct pj_log_async_param
+{
+    /**
+     * Number of messages that can be queued before the writer thread
+     * catches up. Each entry takes PJ_LOG_MAX_SIZE bytes, and the value is
+     * rounded up to the next power of two.
+     *
+     * Default: PJ_LOG_ASYNC_QUEUE_SIZE
+     */
+    unsigned            queue_size;
+
+    /**
+     * What to do when the queue is full. When set, the message is dropped
+     * and counted in #pj_log_async_stat.dropped, and a notice with the
+     * number of dropped messages is written once the writer catches up.
+     * Otherwise the logging thread waits until an entry is free.
+     *
+     * Default: PJ_TRUE
+     */
+    pj_bool_t           drop_on_overflow;
+
+    /**
+     * If set, the writer thread appends the messages to this file instead
+     * of calling the log function set with #pj_log_set_log_func(). The
+     * messages taken from the queue in one pass are written to the file
+     * with a single write, and the file is flushed when the queue has been
+     * emptied. The file is not closed by the logging subsystem.
+     *
+     * Default: NULL
+     */
+    pj_oshandle_t       file;
+
+    /**
+     * Size of the buffer used to batch file writes. It is only used when
+     * \a file is set, and is at least PJ_LOG_MAX_SIZE.
+     *
+     * Default: 65536
+     */
+    unsigned            file_buf_size;
+
+} pj_log_async_param;
+
+
+/**
+ * Statistics of the asynchronous log writer.
+ */
+typedef struct pj_log_async_stat
+{
+    /**
+     * Number of messages written by the writer thread.
+     */
+    pj_size_t           written;
+
+    /**
+     * Number of messages dropped because the queue was full.
+     */
+    pj_size_t           dropped;
+
+    /**
+     * Highest number of messages the writer thread found in the queue.
+     */
+    unsigned            max_pending;
+
+} pj_log_async_stat;
+
+
+/**
+ * Initialize the asynchronous log writer parameters with default values.
+ *
+ * @param prm       The parameters to be initialized.
+ */
+PJ_DECL(void) pj_log_async_param_default(pj_log_async_param *prm);
+
+
 #if PJ_LOG_MAX_LEVEL >= 1
 
 /**
@@ -255,6 +333,53 @@ PJ_DECL(void) pj_log_set_color(int level, pj_color_t color);
  */
 PJ_DECL(pj_color_t) pj_log_get_color(int level);
 
+/**
+ * Start writing log messages asynchronously. Once started, #pj_log()
+ * formats the message directly into a free entry of a lock-free queue
+ * and returns, and a dedicated writer thread passes the queued messages
+ * to the log function (or to the file, see #pj_log_async_param), so the
+ * logging threads never wait for the output device.
+ *
+ * Messages logged by the writer thread itself (for example from inside
+ * the log function) are still written synchronously.
+ *
+ * This requires PJ_HAS_THREADS and a compiler with the GCC style
+ * \a __atomic builtins (GCC or clang), otherwise PJ_ENOTSUP is returned
+ * and logging stays synchronous.
+ *
+ * @param pool      Pool to allocate the queue and the writer thread. The
+ *                  pool must stay valid until #pj_log_async_stop() is
+ *                  called.
+ * @param prm       Parameters, or NULL to use the default values.
+ *
+ * @return          PJ_SUCCESS on success, PJ_EEXISTS if the asynchronous
+ *                  writer is already running, or the appropriate error.
+ */
+PJ_DECL(pj_status_t) pj_log_async_start(pj_pool_t *pool,
+                                        const pj_log_async_param *prm);
+
+/**
+ * Stop the asynchronous log writer. The messages still in the queue are
+ * written before this function returns, and later messages are written
+ * synchronously again. Application must call this before releasing the
+ * pool given to #pj_log_async_start() and before pj_shutdown().
+ *
+ * @return          PJ_SUCCESS on success, or PJ_EINVALIDOP if the
+ *                  asynchronous writer is not running.
+ */
+PJ_DECL(pj_status_t) pj_log_async_stop(void);
+
+/**
+ * Get the statistics of the asynchronous log writer. If the writer has
+ * been stopped, the final statistics of the last run are returned.
+ *
+ * @param stat      Structure to receive the statistics.
+ *
+ * @return          PJ_SUCCESS on success, or PJ_EINVALIDOP if the
+ *                  asynchronous writer has never been started.
+ */
+PJ_DECL(pj_status_t) pj_log_async_get_stat(pj_log_async_stat *stat);
+
 /**
  * Internal function to be called by pj_init()
  */
@@ -377,6 +502,26 @@ pj_status_t pj_log_init(void);
  */
 #  define pj_log_get_color(level) 0
 
+/**
+ * Start writing log messages asynchronously.
+ *
+ * @param pool      Pool.
+ * @param prm       Parameters.
+ */
+#  define pj_log_async_start(pool, prm)     PJ_ENOTSUP
+
+/**
+ * Stop the asynchronous log writer.
+ */
+#  define pj_log_async_stop()               PJ_EINVALIDOP
+
+/**
+ * Get the statistics of the asynchronous log writer.
+ *
+ * @param stat      Structure to receive the statistics.
+ */
+#  define pj_log_async_get_stat(stat)       PJ_EINVALIDOP
+
 
 /**
  * Internal.
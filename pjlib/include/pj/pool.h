@@ -888,6 +888,18 @@ PJ_INLINE(void) pj_pool_factory_dump( pj_pool_factory *pf,
  */
 #define PJ_CACHING_POOL_ARRAY_SIZE      16
 
+/**
+ * Internal: list node to link caching pools together.
+ */
+typedef struct pj_caching_pool_node
+{
+    PJ_DECL_LIST_MEMBER(struct pj_caching_pool_node);
+
+    /** The caching pool. */
+    pj_caching_pool    *cp;
+
+} pj_caching_pool_node;
+
 /**
  * Declaration for caching pool. Application doesn't normally need to
  * care about the contents of this struct, it is only provided here because
@@ -902,22 +914,24 @@ struct pj_caching_pool
     /** Current factory's capacity, i.e. number of bytes that are allocated
      *  and available for application in this factory. The factory's
      *  capacity represents the size of all pools kept by this factory
-     *  in it's free list, which will be returned to application when it
-     *  requests to create a new pool.
+     *  in it's free list and in the thread magazines, which will be
+     *  returned to application when it requests to create a new pool.
      */
     pj_size_t       capacity;
 
     /** Maximum size that can be held by this factory. Once the capacity
      *  has exceeded @a max_capacity, further #pj_pool_release() will
      *  flush the pool. If the capacity is still below the @a max_capacity,
-     *  #pj_pool_release() will save the pool to the factory's free list.
+     *  #pj_pool_release() will save the pool to the factory's free list
+     *  or to the thread's magazine.
      */
     pj_size_t       max_capacity;
 
     /**
      * Number of pools currently held by applications. This number gets
      * incremented everytime #pj_pool_create() is called, and gets
-     * decremented when #pj_pool_release() is called.
+     * decremented when #pj_pool_release() is called. Pools kept in the
+     * thread magazines are not counted.
      */
     pj_size_t       used_count;
 
@@ -942,7 +956,8 @@ struct pj_caching_pool
     pj_list         free_list[PJ_CACHING_POOL_ARRAY_SIZE];
 
     /**
-     * List of pools currently allocated by applications.
+     * List of pools currently allocated by applications, including the
+     * released pools that are kept in the thread magazines.
      */
     pj_list         used_list;
 
@@ -955,6 +970,31 @@ struct pj_caching_pool
      * Mutex.
      */
     pj_lock_t      *lock;
+
+    /**
+     * Maximum number of released pools per size class to keep in each
+     * thread's magazine. It is initialized to PJ_CACHING_POOL_MAGAZINE_SIZE
+     * and may only be lowered (e.g. set to zero to disable the magazines)
+     * right after #pj_caching_pool_init(), before any pool is created.
+     * Each magazine takes the value when it is created.
+     */
+    unsigned        magazine_size;
+
+    /**
+     * Internal: thread local storage index of the thread magazine.
+     */
+    long            mag_tls_id;
+
+    /**
+     * Internal: list of thread magazines.
+     */
+    pj_list         mag_list;
+
+    /**
+     * Internal: node in the list of caching pools that have thread
+     * magazines.
+     */
+    pj_caching_pool_node mag_node;
 };
 
 
@@ -982,6 +1022,26 @@ PJ_DECL(void) pj_caching_pool_init( pj_caching_pool *ch_pool,
  */
 PJ_DECL(void) pj_caching_pool_destroy( pj_caching_pool *ch_pool );
 
+/**
+ * Return the pools kept in the calling thread's magazine to the caching
+ * pool's free list, and free the magazine. Threads created with
+ * #pj_thread_create() do this for every caching pool when they exit.
+ * Other threads (e.g. registered with #pj_thread_register()) that create
+ * and release pools should call this before they exit, otherwise the
+ * pools in their magazines are only reclaimed by
+ * #pj_caching_pool_destroy().
+ *
+ * @param ch_pool       The caching pool.
+ */
+PJ_DECL(void) pj_caching_pool_flush_thread( pj_caching_pool *ch_pool );
+
+/**
+ * Flush the calling thread's magazines of all caching pools. This is
+ * called by the thread framework when a thread created with
+ * #pj_thread_create() exits, application normally doesn't need to call it.
+ */
+PJ_DECL(void) pj_caching_pool_on_thread_exit(void);
+
 /**
  * @}   // PJ_CACHING_POOL
  */
@@ -211,6 +211,8 @@ typedef struct pj_pool_block
 
 #define pj_caching_pool_init( cp, pol, mac)
 #define pj_caching_pool_destroy(cp)
+#define pj_caching_pool_flush_thread(cp)
+#define pj_caching_pool_on_thread_exit()
 #define pj_pool_factory_dump(pf, detail)
 
 PJ_END_DECL
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2025 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef __PJ_RING_H__
+#define __PJ_RING_H__
+
+/**
+ * @file ring.h
+ * @brief Bounded lock-free ring buffer.
+ */
+
+#include <pj/types.h>
+
+PJ_BEGIN_DECL
+
+/**
+ * @defgroup PJ_RING Bounded Lock-free Ring Buffer
+ * @ingroup PJ_DS
+ * @{
+ *
+ * The ring is a bounded FIFO queue of fixed size elements, used to hand
+ * items (such as audio frames or pointers) between threads. Elements are
+ * copied in and out of the ring, and all memory is allocated when the
+ * ring is created, so push and pop never allocate.
+ *
+ * Two variants are provided:
+ *  - #PJ_RING_SPSC, for exactly one producer and one consumer at a time.
+ *    This is the cheapest variant, since push and pop only need to
+ *    publish an index.
+ *  - #PJ_RING_MPMC, which allows any number of concurrent producers and
+ *    consumers. Each slot carries a sequence number so that producers and
+ *    consumers only contend on the index they are advancing.
+ *
+ * The producer and consumer indexes live on separate cache lines so that
+ * the two sides don't invalidate each other's cache line on every
+ * operation. The batch functions #pj_ring_push_n() and #pj_ring_pop_n()
+ * claim several slots with a single index update.
+ *
+ * The ring is lock-free when the compiler provides the GCC style
+ * \a __atomic builtins (GCC and clang). On other compilers, or when
+ * PJ_HAS_THREADS is disabled, the operations are serialized with a
+ * mutex (or nothing, without threads) and the API behaves the same.
+ */
+
+/**
+ * Ring variants.
+ */
+typedef enum pj_ring_type
+{
+    /**
+     * Multiple producers and multiple consumers.
+     */
+    PJ_RING_MPMC,
+
+    /**
+     * Single producer and single consumer. The application must make
+     * sure that push and pop are each called by at most one thread at a
+     * time.
+     */
+    PJ_RING_SPSC
+
+} pj_ring_type;
+
+
+/**
+ * Create a ring buffer.
+ *
+ * @param pool          The pool to allocate the ring and its storage.
+ * @param type          The ring variant.
+ * @param capacity      The maximum number of elements in the ring. It is
+ *                      rounded up to the next power of two.
+ * @param elem_size     The size of each element, in bytes.
+ * @param p_ring        Pointer to receive the ring.
+ *
+ * @return              PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pj_ring_create(pj_pool_t *pool,
+                                    pj_ring_type type,
+                                    unsigned capacity,
+                                    unsigned elem_size,
+                                    pj_ring_t **p_ring);
+
+/**
+ * Destroy the ring. The memory is released along with the pool.
+ *
+ * @param ring          The ring.
+ *
+ * @return              PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pj_ring_destroy(pj_ring_t *ring);
+
+/**
+ * Copy an element to the back of the ring.
+ *
+ * @param ring          The ring.
+ * @param elem          The element, which is \a elem_size bytes long.
+ *
+ * @return              PJ_SUCCESS on success, or PJ_ETOOMANY if the ring
+ *                      is full.
+ */
+PJ_DECL(pj_status_t) pj_ring_push(pj_ring_t *ring, const void *elem);
+
+/**
+ * Take the element at the front of the ring.
+ *
+ * @param ring          The ring.
+ * @param elem          Buffer to receive the element, or NULL to just
+ *                      discard it.
+ *
+ * @return              PJ_SUCCESS on success, or PJ_ENOTFOUND if the ring
+ *                      is empty.
+ */
+PJ_DECL(pj_status_t) pj_ring_pop(pj_ring_t *ring, void *elem);
+
+/**
+ * Copy up to \a count consecutive elements to the back of the ring. The
+ * elements that are pushed in one call are consecutive in the ring, even
+ * with concurrent producers.
+ *
+ * @param ring          The ring.
+ * @param elems         Array of \a count elements.
+ * @param count         Number of elements in the array.
+ *
+ * @return              The number of elements pushed, which is less than
+ *                      \a count when the ring doesn't have enough room.
+ */
+PJ_DECL(unsigned) pj_ring_push_n(pj_ring_t *ring, const void *elems,
+                                 unsigned count);
+
+/**
+ * Take up to \a max_count elements from the front of the ring.
+ *
+ * @param ring          The ring.
+ * @param elems         Array to receive the elements, or NULL to just
+ *                      discard them.
+ * @param max_count     Maximum number of elements to take.
+ *
+ * @return              The number of elements taken, zero if the ring
+ *                      is empty.
+ */
+PJ_DECL(unsigned) pj_ring_pop_n(pj_ring_t *ring, void *elems,
+                                unsigned max_count);
+
+/**
+ * Get the number of elements in the ring. When other threads are pushing
+ * or popping, the value is only a snapshot.
+ *
+ * @param ring          The ring.
+ *
+ * @return              Number of elements.
+ */
+PJ_DECL(unsigned) pj_ring_size(pj_ring_t *ring);
+
+/**
+ * Get the capacity of the ring, i.e. the requested capacity rounded up
+ * to power of two.
+ *
+ * @param ring          The ring.
+ *
+ * @return              The capacity.
+ */
+PJ_DECL(unsigned) pj_ring_capacity(const pj_ring_t *ring);
+
+/**
+ * @}
+ */
+
+PJ_END_DECL
+
+#endif  /* __PJ_RING_H__ */
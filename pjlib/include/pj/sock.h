@@ -317,6 +317,11 @@ extern const pj_uint16_t PJ_TCP_NODELAY;
  *  @see pj_SO_REUSEADDR */
 extern const pj_uint16_t PJ_SO_REUSEADDR;
 
+/** Allows several sockets to be bound to the same address and port, with
+ *  the kernel distributing incoming packets among them. The value is
+ *  0xFFFF if the platform does not support it. @see pj_SO_REUSEPORT */
+extern const pj_uint16_t PJ_SO_REUSEPORT;
+
 /** Do not generate SIGPIPE. @see pj_SO_NOSIGPIPE */
 extern const pj_uint16_t PJ_SO_NOSIGPIPE;
 
@@ -356,6 +361,9 @@ extern const pj_uint16_t PJ_IP_DROP_MEMBERSHIP;
     /** Get #PJ_SO_REUSEADDR constant */
     PJ_DECL(pj_uint16_t) pj_SO_REUSEADDR(void);
 
+    /** Get #PJ_SO_REUSEPORT constant */
+    PJ_DECL(pj_uint16_t) pj_SO_REUSEPORT(void);
+
     /** Get #PJ_SO_NOSIGPIPE constant */
     PJ_DECL(pj_uint16_t) pj_SO_NOSIGPIPE(void);
 
@@ -392,6 +400,9 @@ extern const pj_uint16_t PJ_IP_DROP_MEMBERSHIP;
     /** Get #PJ_SO_REUSEADDR constant */
 #   define pj_SO_REUSEADDR() PJ_SO_REUSEADDR
 
+    /** Get #PJ_SO_REUSEPORT constant */
+#   define pj_SO_REUSEPORT() PJ_SO_REUSEPORT
+
     /** Get #PJ_SO_NOSIGPIPE constant */
 #   define pj_SO_NOSIGPIPE() PJ_SO_NOSIGPIPE
 
@@ -677,6 +688,31 @@ typedef struct pj_sockopt_params
     } options[PJ_MAX_SOCKOPT_PARAMS];
 } pj_sockopt_params;
 
+
+/**
+ * This structure describes one datagram to be received with
+ * #pj_sock_recvmmsg() or sent with #pj_sock_sendmmsg().
+ */
+typedef struct pj_sock_mmsg
+{
+    /** The datagram buffer. */
+    void            *buf;
+
+    /** On input, the size of the buffer (receive) or the length of the
+     *  data (send). On return, the number of bytes transferred. */
+    pj_ssize_t       len;
+
+    /** Source address (receive) or destination address (send). May be
+     *  NULL for receive or for connected sockets. */
+    pj_sockaddr_t   *addr;
+
+    /** On input, the length of the address buffer (receive) or of the
+     *  destination address (send). On return, the actual length of the
+     *  source address (receive). */
+    int              addrlen;
+
+} pj_sock_mmsg;
+
 /*****************************************************************************
  *
  * SOCKET ADDRESS MANIPULATION.
@@ -1493,6 +1529,52 @@ PJ_DECL(pj_status_t) pj_sock_sendto(pj_sock_t sockfd,
                                     const pj_sockaddr_t *to,
                                     int tolen);
 
+/**
+ * Receive multiple datagrams from the socket with a single call. On
+ * platforms with recvmmsg() (see PJ_SOCK_HAS_MMSG), this is done with one
+ * system call, otherwise it is emulated with repeated recvfrom() calls.
+ * The function blocks (for blocking sockets) only until the first
+ * datagram is available.
+ *
+ * @param sockfd        The socket descriptor.
+ * @param msgs          Array of datagram descriptors. On input, \a buf,
+ *                      \a len, \a addr, and \a addrlen of each entry
+ *                      describe the receive buffer. On return, \a len and
+ *                      \a addrlen of the received entries are updated.
+ * @param count         On input, the number of entries in \a msgs. On
+ *                      return, the number of datagrams received.
+ * @param flags         Flags (such as pj_MSG_PEEK()).
+ *
+ * @return              PJ_SUCCESS if at least one datagram has been
+ *                      received, or the error code of the first receive
+ *                      (e.g. would block) otherwise.
+ */
+PJ_DECL(pj_status_t) pj_sock_recvmmsg(pj_sock_t sockfd,
+                                      pj_sock_mmsg msgs[],
+                                      unsigned *count,
+                                      unsigned flags);
+
+/**
+ * Transmit multiple datagrams to the socket with a single call. On
+ * platforms with sendmmsg() (see PJ_SOCK_HAS_MMSG), this is done with one
+ * system call, otherwise it is emulated with repeated sendto() calls.
+ *
+ * @param sockfd        Socket descriptor.
+ * @param msgs          Array of datagrams to be sent. On return, \a len
+ *                      of the sent entries is updated with the number of
+ *                      bytes sent.
+ * @param count         On input, the number of entries in \a msgs. On
+ *                      return, the number of datagrams sent.
+ * @param flags         Flags (such as pj_MSG_DONTROUTE()).
+ *
+ * @return              PJ_SUCCESS if at least one datagram has been sent,
+ *                      or the error code of the first send otherwise.
+ */
+PJ_DECL(pj_status_t) pj_sock_sendmmsg(pj_sock_t sockfd,
+                                      pj_sock_mmsg msgs[],
+                                      unsigned *count,
+                                      unsigned flags);
+
 #if PJ_HAS_TCP
 /**
  * The shutdown call causes all or part of a full-duplex connection on the
@@ -70,6 +70,29 @@ PJ_BEGIN_DECL
  */
 typedef int pj_timer_id_t;
 
+/**
+ * Timer heap implementation, to be set in pj_timer_heap_cfg.type.
+ */
+typedef enum pj_timer_heap_type
+{
+    /**
+     * Binary heap of absolute expiration times (the ACE based one). Each
+     * schedule, cancel, and expiration is O(log N), and the timers expire
+     * with millisecond accuracy.
+     */
+    PJ_TIMER_HEAP_BINARY = 0,
+
+    /**
+     * Hierarchical timing wheel. Schedule and cancel are O(1) and expired
+     * timers are collected a whole wheel slot at a time, which suits large
+     * number of mostly cancelled timers such as SIP transaction timers. The
+     * timers are rounded up to the wheel resolution (see
+     * pj_timer_heap_cfg.resolution) so they never expire early.
+     */
+    PJ_TIMER_HEAP_WHEEL = 1
+
+} pj_timer_heap_type;
+
 /** 
  * Forward declaration for pj_timer_entry. 
  */
@@ -149,7 +172,8 @@ typedef struct pj_timer_entry
 
 
 /**
- * Calculate memory size required to create a timer heap.
+ * Calculate memory size required to create a timer heap. The result is
+ * large enough for either implementation in #pj_timer_heap_type.
  *
  * @param count     Number of timer entries to be supported.
  * @return          Memory size requirement in bytes.
@@ -175,6 +199,58 @@ PJ_DECL(pj_status_t) pj_timer_heap_create( pj_pool_t *pool,
                                            pj_size_t count,
                                            pj_timer_heap_t **ht);
 
+/**
+ * Additional settings that can be given during timer heap creation.
+ * Application MUST initialize this structure with #pj_timer_heap_cfg_default().
+ */
+typedef struct pj_timer_heap_cfg
+{
+    /**
+     * The timer heap implementation, see #pj_timer_heap_type.
+     *
+     * Default: PJ_TIMER_HEAP_DEFAULT_TYPE
+     */
+    pj_timer_heap_type type;
+
+    /**
+     * Tick resolution of the timing wheel, in milliseconds. This setting
+     * is ignored by the binary heap implementation.
+     *
+     * Default: PJ_TIMER_WHEEL_RESOLUTION
+     */
+    unsigned resolution;
+
+} pj_timer_heap_cfg;
+
+
+/**
+ * Initialize the timer heap configuration with the default values.
+ *
+ * @param cfg       The configuration to be initialized.
+ */
+PJ_DECL(void) pj_timer_heap_cfg_default(pj_timer_heap_cfg *cfg);
+
+
+/**
+ * Create a timer heap with the specified settings.
+ *
+ * @param pool      The pool where allocations in the timer heap will be 
+ *                  allocated, see pj_timer_heap_create().
+ * @param count     The maximum number of timer entries to be supported 
+ *                  initially.
+ * @param cfg       Optional timer heap configuration. Application must
+ *                  initialize this structure with pj_timer_heap_cfg_default()
+ *                  first. If this is not specified, the default values will
+ *                  be used.
+ * @param ht        Pointer to receive the created timer heap.
+ *
+ * @return          PJ_SUCCESS, or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pj_timer_heap_create2( pj_pool_t *pool,
+                                            pj_size_t count,
+                                            const pj_timer_heap_cfg *cfg,
+                                            pj_timer_heap_t **ht);
+
 /**
  * Destroy the timer heap.
  *
@@ -241,6 +241,11 @@ typedef struct pj_ioqueue_t pj_ioqueue_t;
  */
 typedef struct pj_ioqueue_key_t pj_ioqueue_key_t;
 
+/**
+ * Opaque data type for a group of I/O Queues (shards).
+ */
+typedef struct pj_ioqueue_group_t pj_ioqueue_group_t;
+
 /**
  * Opaque data to identify timer heap.
  */
@@ -261,6 +266,11 @@ typedef PJ_ATOMIC_VALUE_TYPE pj_atomic_value_t;
  */
 typedef struct pj_atomic_queue_t pj_atomic_queue_t;
 
+/**
+ * Opaque data type for ring buffer.
+ */
+typedef struct pj_ring_t pj_ring_t;
+
 /* ************************************************************************* */
 
 /** Thread handle. */
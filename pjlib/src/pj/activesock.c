@@ -643,6 +643,15 @@ static void ioqueue_on_read_complete(pj_ioqueue_key_t *key,
         if (++loop >= asock->max_loop)
             flags |= PJ_IOQUEUE_ALWAYS_ASYNC;
 
+#if PJ_IOQUEUE_DGRAM_BATCH > 1
+        /* With several datagram reads pending, let the ioqueue fill them
+         * in one batch on the next readiness event instead of spending a
+         * recvfrom() per packet here.
+         */
+        if (asock->read_type == TYPE_RECV_FROM && asock->async_count > 1)
+            flags |= PJ_IOQUEUE_ALWAYS_ASYNC;
+#endif
+
         if (asock->read_type == TYPE_RECV) {
             status = pj_ioqueue_recv(key, op_key, r->pkt + r->size, 
                                      &bytes_read, flags);
@@ -23,12 +23,24 @@
 #include <pj/os.h>
 #include <pj/ctype.h>
 #include <pj/assert.h>
+#include <pj/errno.h>
 
 /**
  * The hash multiplier used to calculate hash value.
  */
 #define PJ_HASH_MULTIPLIER      33
 
+/* Open addressing: grow or clean up the table when the live entries plus
+ * the deleted markers take more than 3/4 of the slots.
+ */
+#define OA_MIN_CAPACITY         16
+#define OA_MAX_USED(cap)        ((cap) - ((cap) >> 2))
+
+/* Marker for a deleted slot, so that probing continues past it and
+ * iterators stay valid when entries are removed.
+ */
+#define OA_DELETED              (&oa_deleted_entry)
+
 
 struct pj_hash_entry
 {
@@ -39,55 +51,199 @@ struct pj_hash_entry
     void *value;
 };
 
+/* Slot of an open addressing table. The hash is kept here too so that
+ * probing rarely needs to touch the entry.
+ */
+typedef struct oa_slot
+{
+    pj_hash_entry      *entry;
+    pj_uint32_t         hash;
+} oa_slot;
+
 
 struct pj_hash_table_t
 {
     pj_hash_entry     **table;
     unsigned            count, rows;
     pj_hash_iterator_t  iterator;
+
+    /* Open addressing table */
+    pj_pool_t          *pool;
+    oa_slot            *slots;
+    oa_slot            *spare;          /* For cleaning up in place     */
+    unsigned            mask;           /* Number of slots - 1          */
+    unsigned            used;           /* Live and deleted slots       */
 };
 
+static pj_hash_entry oa_deleted_entry;
 
 
-PJ_DEF(pj_uint32_t) pj_hash_calc(pj_uint32_t hash, const void *key, 
-                                 unsigned keylen)
+#if PJ_HASH_USE_SIPHASH
+
+/* SipHash-1-3 key. It is replaced with a random key by pj_init(). */
+static pj_uint64_t hash_k0 = PJ_UINT64(0x736f6d6570736575);
+static pj_uint64_t hash_k1 = PJ_UINT64(0x646f72616e646f6d);
+
+#define ROTL64(x, b)    (pj_uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND(v0, v1, v2, v3) \
+    do { \
+        v0 += v1; v1 = ROTL64(v1, 13); v1 ^= v0; v0 = ROTL64(v0, 32); \
+        v2 += v3; v3 = ROTL64(v3, 16); v3 ^= v2; \
+        v0 += v3; v3 = ROTL64(v3, 21); v3 ^= v0; \
+        v2 += v1; v1 = ROTL64(v1, 17); v1 ^= v2; v2 = ROTL64(v2, 32); \
+    } while (0)
+
+/* Set the 0x20 bit of the ASCII upper case letters in the word. Bytes
+ * above 0x7F are left alone.
+ */
+static pj_uint64_t word_tolower(pj_uint64_t w)
 {
-    PJ_CHECK_STACK();
+    const pj_uint64_t ones = PJ_UINT64(0x0101010101010101);
+    pj_uint64_t low7 = w & (ones * 0x7F);
+    pj_uint64_t ge_a = low7 + ones * (0x80 - 'A');
+    pj_uint64_t gt_z = low7 + ones * (0x80 - 'Z' - 1);
+    pj_uint64_t upper = ge_a & ~gt_z & ~w & (ones * 0x80);
+
+    return w | (upper >> 2);
+}
 
-    if (keylen==PJ_HASH_KEY_STRING) {
-        const pj_uint8_t *p = (const pj_uint8_t*)key;
-        for ( ; *p; ++p ) {
-            hash = (hash * PJ_HASH_MULTIPLIER) + *p;
+/* Keyed SipHash-1-3 of the key, optionally case folded, with the initial
+ * value mixed into the state so that calls can be chained. The lower
+ * case key is written to result if it's not NULL.
+ */
+static pj_uint32_t hash_calc(pj_uint32_t hval, const void *key,
+                             pj_size_t keylen, pj_bool_t lower,
+                             char *result)
+{
+    const pj_uint8_t *p = (const pj_uint8_t*)key;
+    const pj_uint8_t *end = p + (keylen & ~(pj_size_t)7);
+    pj_uint64_t v0 = hash_k0 ^ PJ_UINT64(0x736f6d6570736575);
+    pj_uint64_t v1 = hash_k1 ^ PJ_UINT64(0x646f72616e646f83);
+    pj_uint64_t v2 = hash_k0 ^ PJ_UINT64(0x6c7967656e657261);
+    pj_uint64_t v3 = hash_k1 ^ PJ_UINT64(0x7465646279746573);
+    pj_uint64_t m, b;
+    unsigned i, left;
+
+    v0 ^= hval;
+
+    for (; p != end; p += 8) {
+        pj_memcpy(&m, p, 8);
+        if (lower) {
+            m = word_tolower(m);
+            if (result) {
+                pj_memcpy(result, &m, 8);
+                result += 8;
+            }
         }
-    } else {
-        const pj_uint8_t *p = (const pj_uint8_t*)key,
-                              *end = p + keylen;
-        for ( ; p!=end; ++p) {
-            hash = (hash * PJ_HASH_MULTIPLIER) + *p;
+        v3 ^= m;
+        SIPROUND(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+
+    b = ((pj_uint64_t)keylen) << 56;
+    left = (unsigned)(keylen & 7);
+    for (i = 0; i < left; ++i) {
+        pj_uint8_t c = p[i];
+        if (lower) {
+            if (c >= 'A' && c <= 'Z')
+                c |= 0x20;
+            if (result)
+                result[i] = (char)c;
         }
+        b |= ((pj_uint64_t)c) << (8 * i);
     }
-    return hash;
+
+    v3 ^= b;
+    SIPROUND(v0, v1, v2, v3);
+    v0 ^= b;
+
+    v2 ^= 0xff;
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+
+    b = v0 ^ v1 ^ v2 ^ v3;
+    return (pj_uint32_t)(b ^ (b >> 32));
 }
 
-PJ_DEF(pj_uint32_t) pj_hash_calc_tolower( pj_uint32_t hval,
-                                          char *result,
-                                          const pj_str_t *key)
+static pj_uint64_t splitmix64(pj_uint64_t *state)
+{
+    pj_uint64_t z = (*state += PJ_UINT64(0x9e3779b97f4a7c15));
+    z = (z ^ (z >> 30)) * PJ_UINT64(0xbf58476d1ce4e5b9);
+    z = (z ^ (z >> 27)) * PJ_UINT64(0x94d049bb133111eb);
+    return z ^ (z >> 31);
+}
+
+/* Internal, called by pj_init() */
+PJ_DEF(void) pj_hash_init(void)
 {
-    long i;
+    pj_timestamp ts;
+    pj_time_val now;
+    pj_uint64_t state;
 
-    for (i=0; i<key->slen; ++i) {
-        int lower = pj_tolower(key->ptr[i]);
-        if (result)
-            result[i] = (char)lower;
+    pj_get_timestamp(&ts);
+    pj_gettimeofday(&now);
 
-        hval = hval * PJ_HASH_MULTIPLIER + lower;
-    }
+    state = ts.u64;
+    state ^= ((pj_uint64_t)now.sec << 32) ^ (pj_uint64_t)now.msec;
+    state ^= (pj_uint64_t)pj_getpid() << 16;
+    state ^= (pj_uint64_t)(pj_size_t)&state;
+    state ^= (pj_uint64_t)(pj_size_t)&hash_k0 << 24;
+
+    hash_k0 = splitmix64(&state);
+    hash_k1 = splitmix64(&state);
+}
+
+#else   /* PJ_HASH_USE_SIPHASH */
 
+static pj_uint32_t hash_calc(pj_uint32_t hval, const void *key,
+                             pj_size_t keylen, pj_bool_t lower,
+                             char *result)
+{
+    const pj_uint8_t *p = (const pj_uint8_t*)key, *end = p + keylen;
+
+    for ( ; p!=end; ++p) {
+        if (lower) {
+            int c = pj_tolower(*p);
+            if (result)
+                *result++ = (char)c;
+            hval = hval * PJ_HASH_MULTIPLIER + c;
+        } else {
+            hval = hval * PJ_HASH_MULTIPLIER + *p;
+        }
+    }
     return hval;
 }
 
+PJ_DEF(void) pj_hash_init(void)
+{
+}
 
-PJ_DEF(pj_hash_table_t*) pj_hash_create(pj_pool_t *pool, unsigned size)
+#endif  /* PJ_HASH_USE_SIPHASH */
+
+
+PJ_DEF(pj_uint32_t) pj_hash_calc(pj_uint32_t hash, const void *key, 
+                                 unsigned keylen)
+{
+    PJ_CHECK_STACK();
+
+    if (keylen==PJ_HASH_KEY_STRING)
+        keylen = (unsigned)pj_ansi_strlen((const char*)key);
+
+    return hash_calc(hash, key, keylen, PJ_FALSE, NULL);
+}
+
+PJ_DEF(pj_uint32_t) pj_hash_calc_tolower( pj_uint32_t hval,
+                                          char *result,
+                                          const pj_str_t *key)
+{
+    return hash_calc(hval, key->ptr, key->slen, PJ_TRUE, result);
+}
+
+
+PJ_DEF(pj_hash_table_t*) pj_hash_create2(pj_pool_t *pool, unsigned size,
+                                         unsigned options)
 {
     pj_hash_table_t *h;
     unsigned table_size;
@@ -95,11 +251,24 @@ PJ_DEF(pj_hash_table_t*) pj_hash_create(pj_pool_t *pool, unsigned size)
     /* Check that PJ_HASH_ENTRY_BUF_SIZE is correct. */
     PJ_ASSERT_RETURN(sizeof(pj_hash_entry)<=PJ_HASH_ENTRY_BUF_SIZE, NULL);
 
-    h = PJ_POOL_ALLOC_T(pool, pj_hash_table_t);
+    h = PJ_POOL_ZALLOC_T(pool, pj_hash_table_t);
     h->count = 0;
 
     PJ_LOG( 6, ("hashtbl", "hash table %p created from pool %s", h, pj_pool_getobjname(pool)));
 
+    if (options & PJ_HASH_OPEN_ADDRESSING) {
+        /* Start with twice the expected number of entries */
+        table_size = OA_MIN_CAPACITY;
+        while (table_size < size * 2 && table_size < 0x40000000)
+            table_size <<= 1;
+
+        h->pool = pool;
+        h->mask = table_size - 1;
+        h->slots = (oa_slot*)pj_pool_calloc(pool, table_size, sizeof(oa_slot));
+        h->spare = (oa_slot*)pj_pool_calloc(pool, table_size, sizeof(oa_slot));
+        return h;
+    }
+
     /* size must be 2^n - 1.
        round-up the size to this rule, except when size is 2^n, then size
        will be round-down to 2^n-1.
@@ -116,69 +285,53 @@ PJ_DEF(pj_hash_table_t*) pj_hash_create(pj_pool_t *pool, unsigned size)
     return h;
 }
 
-static pj_hash_entry **find_entry( pj_pool_t *pool, pj_hash_table_t *ht, 
-                                   const void *key, unsigned keylen,
-                                   void *val, pj_uint32_t *hval,
-                                   void *entry_buf, pj_bool_t lower)
+PJ_DEF(pj_hash_table_t*) pj_hash_create(pj_pool_t *pool, unsigned size)
+{
+    return pj_hash_create2(pool, size, 0);
+}
+
+/* Get the hash value of the key, and also the key length if it's
+ * PJ_HASH_KEY_STRING.
+ */
+static pj_uint32_t get_hash(const void *key, unsigned *keylen,
+                            pj_uint32_t *hval, pj_bool_t lower)
 {
     pj_uint32_t hash;
-    pj_hash_entry **p_entry, *entry;
 
-    if (hval && *hval != 0) {
-        hash = *hval;
-        if (keylen==PJ_HASH_KEY_STRING) {
-            keylen = (unsigned)pj_ansi_strlen((const char*)key);
-        }
-    } else {
-        /* This slightly differs with pj_hash_calc() because we need 
-         * to get the keylen when keylen is PJ_HASH_KEY_STRING.
-         */
-        hash=0;
-        if (keylen==PJ_HASH_KEY_STRING) {
-            const pj_uint8_t *p = (const pj_uint8_t*)key;
-            for ( ; *p; ++p ) {
-                if (lower)
-                    hash = hash * PJ_HASH_MULTIPLIER + pj_tolower(*p);
-                else 
-                    hash = hash * PJ_HASH_MULTIPLIER + *p;
-            }
-            keylen = (unsigned)(p - (const unsigned char*)key);
-        } else {
-            const pj_uint8_t *p = (const pj_uint8_t*)key,
-                                  *end = p + keylen;
-            for ( ; p!=end; ++p) {
-                if (lower)
-                    hash = hash * PJ_HASH_MULTIPLIER + pj_tolower(*p);
-                else
-                    hash = hash * PJ_HASH_MULTIPLIER + *p;
-            }
-        }
+    if (*keylen==PJ_HASH_KEY_STRING)
+        *keylen = (unsigned)pj_ansi_strlen((const char*)key);
 
-        /* Report back the computed hash. */
-        if (hval)
-            *hval = hash;
-    }
+    if (hval && *hval != 0)
+        return *hval;
 
-    /* scan the linked list */
-    for (p_entry = &ht->table[hash & ht->rows], entry=*p_entry; 
-         entry; 
-         p_entry = &entry->next, entry = *p_entry)
-    {
-        if (entry->hash==hash && entry->keylen==keylen &&
-            ((lower && pj_ansi_strnicmp((const char*)entry->key,
-                                        (const char*)key, keylen)==0) ||
-             (!lower && pj_memcmp(entry->key, key, keylen)==0)))
-        {
-            break;
-        }
-    }
+    hash = hash_calc(0, key, *keylen, lower, NULL);
 
-    if (entry || val==NULL)
-        return p_entry;
+    /* Report back the computed hash. */
+    if (hval)
+        *hval = hash;
+
+    return hash;
+}
+
+static pj_bool_t key_equal(const pj_hash_entry *entry, const void *key,
+                           unsigned keylen, pj_bool_t lower)
+{
+    return entry->keylen==keylen &&
+           ((lower && pj_ansi_strnicmp((const char*)entry->key,
+                                       (const char*)key, keylen)==0) ||
+            (!lower && pj_memcmp(entry->key, key, keylen)==0));
+}
+
+/* Create a new entry, from entry_buf if it's specified, otherwise from
+ * the pool.
+ */
+static pj_hash_entry *new_entry(pj_pool_t *pool, pj_hash_table_t *ht,
+                                const void *key, unsigned keylen,
+                                pj_uint32_t hash, void *val,
+                                void *entry_buf)
+{
+    pj_hash_entry *entry;
 
-    /* Entry not found, create a new one. 
-     * If entry_buf is specified, use it. Otherwise allocate from pool.
-     */
     if (entry_buf) {
         entry = (pj_hash_entry*)entry_buf;
     } else {
@@ -201,6 +354,36 @@ static pj_hash_entry **find_entry( pj_pool_t *pool, pj_hash_table_t *ht,
     }
     entry->keylen = keylen;
     entry->value = val;
+
+    return entry;
+}
+
+static pj_hash_entry **find_entry( pj_pool_t *pool, pj_hash_table_t *ht, 
+                                   const void *key, unsigned keylen,
+                                   void *val, pj_uint32_t *hval,
+                                   void *entry_buf, pj_bool_t lower)
+{
+    pj_uint32_t hash;
+    pj_hash_entry **p_entry, *entry;
+
+    hash = get_hash(key, &keylen, hval, lower);
+
+    /* scan the linked list */
+    for (p_entry = &ht->table[hash & ht->rows], entry=*p_entry; 
+         entry; 
+         p_entry = &entry->next, entry = *p_entry)
+    {
+        if (entry->hash==hash && key_equal(entry, key, keylen, lower))
+            break;
+    }
+
+    if (entry || val==NULL)
+        return p_entry;
+
+    /* Entry not found, create a new one. */
+    entry = new_entry(pool, ht, key, keylen, hash, val, entry_buf);
+    if (!entry)
+        return NULL;
     *p_entry = entry;
     
     ++ht->count;
@@ -208,11 +391,150 @@ static pj_hash_entry **find_entry( pj_pool_t *pool, pj_hash_table_t *ht,
     return p_entry;
 }
 
+/* Find the slot of the key in open addressing table. If it's not found,
+ * the slot where it can be inserted is returned in p_free.
+ */
+static oa_slot *oa_find(pj_hash_table_t *ht, const void *key,
+                        unsigned keylen, pj_uint32_t hash, pj_bool_t lower,
+                        oa_slot **p_free)
+{
+    oa_slot *free_slot = NULL;
+    unsigned i = hash & ht->mask;
+
+    for (;;) {
+        oa_slot *slot = &ht->slots[i];
+
+        if (slot->entry == NULL) {
+            if (p_free)
+                *p_free = free_slot ? free_slot : slot;
+            return NULL;
+        }
+
+        if (slot->entry == OA_DELETED) {
+            if (!free_slot)
+                free_slot = slot;
+        } else if (slot->hash == hash &&
+                   key_equal(slot->entry, key, keylen, lower))
+        {
+            return slot;
+        }
+
+        i = (i + 1) & ht->mask;
+    }
+}
+
+/* Move the live entries to a clean array, doubling the number of slots
+ * if the table is at least half full. Otherwise the spare array of the
+ * same size is used, so that deleting and inserting don't keep allocating
+ * from the pool.
+ */
+static pj_status_t oa_rehash(pj_hash_table_t *ht)
+{
+    oa_slot *old_slots = ht->slots, *new_slots;
+    unsigned old_cap = ht->mask + 1, new_cap = old_cap, i;
+
+    if (ht->count + 1 >= old_cap / 2) {
+        PJ_ASSERT_RETURN(old_cap < 0x40000000, PJ_ETOOMANY);
+        new_cap = old_cap * 2;
+        new_slots = (oa_slot*)pj_pool_calloc(ht->pool, new_cap,
+                                             sizeof(oa_slot));
+        ht->spare = (oa_slot*)pj_pool_calloc(ht->pool, new_cap,
+                                             sizeof(oa_slot));
+        if (!new_slots || !ht->spare)
+            return PJ_ENOMEM;
+        PJ_LOG(6, ("hashtbl", "%p: grown to %u slots", ht, new_cap));
+    } else {
+        new_slots = ht->spare;
+        pj_bzero(new_slots, new_cap * sizeof(oa_slot));
+        ht->spare = old_slots;
+    }
+
+    for (i = 0; i < old_cap; ++i) {
+        unsigned j;
+
+        if (old_slots[i].entry == NULL || old_slots[i].entry == OA_DELETED)
+            continue;
+
+        for (j = old_slots[i].hash & (new_cap - 1);
+             new_slots[j].entry;
+             j = (j + 1) & (new_cap - 1))
+            ;
+        new_slots[j] = old_slots[i];
+    }
+
+    ht->slots = new_slots;
+    ht->mask = new_cap - 1;
+    ht->used = ht->count;
+
+    return PJ_SUCCESS;
+}
+
+static void *oa_get(pj_hash_table_t *ht, const void *key, unsigned keylen,
+                    pj_uint32_t *hval, pj_bool_t lower)
+{
+    pj_uint32_t hash = get_hash(key, &keylen, hval, lower);
+    oa_slot *slot = oa_find(ht, key, keylen, hash, lower, NULL);
+
+    return slot ? slot->entry->value : NULL;
+}
+
+static void oa_set(pj_pool_t *pool, pj_hash_table_t *ht,
+                   const void *key, unsigned keylen, pj_uint32_t hval,
+                   void *value, void *entry_buf, pj_bool_t lower)
+{
+    pj_uint32_t hash = get_hash(key, &keylen, &hval, lower);
+    oa_slot *slot, *free_slot;
+    pj_hash_entry *entry;
+
+    slot = oa_find(ht, key, keylen, hash, lower, &free_slot);
+    if (slot) {
+        if (value == NULL) {
+            /* delete entry */
+            PJ_LOG(6, ("hashtbl", "%p: p_entry %p deleted", ht,
+                       slot->entry));
+            slot->entry = OA_DELETED;
+            --ht->count;
+        } else {
+            /* overwrite */
+            slot->entry->value = value;
+            PJ_LOG(6, ("hashtbl", "%p: p_entry %p value set to %p", ht, 
+                       slot->entry, value));
+        }
+        return;
+    }
+
+    if (value == NULL)
+        return;
+
+    /* Make room first when a new slot is going to be taken */
+    if (free_slot->entry == NULL &&
+        ht->used + 1 > OA_MAX_USED(ht->mask + 1))
+    {
+        if (oa_rehash(ht) != PJ_SUCCESS)
+            return;
+        oa_find(ht, key, keylen, hash, lower, &free_slot);
+    }
+
+    entry = new_entry(pool, ht, key, keylen, hash, value, entry_buf);
+    if (!entry)
+        return;
+
+    if (free_slot->entry == NULL)
+        ++ht->used;
+    free_slot->entry = entry;
+    free_slot->hash = hash;
+    ++ht->count;
+}
+
 PJ_DEF(void *) pj_hash_get( pj_hash_table_t *ht,
                             const void *key, unsigned keylen,
                             pj_uint32_t *hval)
 {
     pj_hash_entry *entry;
+
+    if (ht->slots)
+        return oa_get(ht, key, keylen, hval, PJ_FALSE);
+
     entry = *find_entry( NULL, ht, key, keylen, NULL, hval, NULL, PJ_FALSE);
     return entry ? entry->value : NULL;
 }
@@ -222,6 +544,10 @@ PJ_DEF(void *) pj_hash_get_lower( pj_hash_table_t *ht,
                                   pj_uint32_t *hval)
 {
     pj_hash_entry *entry;
+
+    if (ht->slots)
+        return oa_get(ht, key, keylen, hval, PJ_TRUE);
+
     entry = *find_entry( NULL, ht, key, keylen, NULL, hval, NULL, PJ_TRUE);
     return entry ? entry->value : NULL;
 }
@@ -232,9 +558,14 @@ static void hash_set( pj_pool_t *pool, pj_hash_table_t *ht,
 {
     pj_hash_entry **p_entry;
 
+    if (ht->slots) {
+        oa_set(pool, ht, key, keylen, hval, value, entry_buf, lower);
+        return;
+    }
+
     p_entry = find_entry( pool, ht, key, keylen, value, &hval, entry_buf,
                           lower);
-    if (*p_entry) {
+    if (p_entry && *p_entry) {
         if (value == NULL) {
             /* delete entry */
             PJ_LOG(6, ("hashtbl", "%p: p_entry %p deleted", ht, *p_entry));
@@ -286,12 +617,33 @@ PJ_DEF(unsigned) pj_hash_count( pj_hash_table_t *ht )
     return ht->count;
 }
 
+/* Move the iterator to the next live slot of open addressing table */
+static pj_hash_iterator_t *oa_next(pj_hash_table_t *ht,
+                                   pj_hash_iterator_t *it)
+{
+    for (++it->index; it->index <= ht->mask; ++it->index) {
+        pj_hash_entry *entry = ht->slots[it->index].entry;
+        if (entry && entry != OA_DELETED) {
+            it->entry = entry;
+            return it;
+        }
+    }
+
+    it->entry = NULL;
+    return NULL;
+}
+
 PJ_DEF(pj_hash_iterator_t*) pj_hash_first( pj_hash_table_t *ht,
                                            pj_hash_iterator_t *it )
 {
     it->index = 0;
     it->entry = NULL;
 
+    if (ht->slots) {
+        it->index = (pj_uint32_t)-1;
+        return oa_next(ht, it);
+    }
+
     for (; it->index <= ht->rows; ++it->index) {
         it->entry = ht->table[it->index];
         if (it->entry) {
@@ -305,6 +657,9 @@ PJ_DEF(pj_hash_iterator_t*) pj_hash_first( pj_hash_table_t *ht,
 PJ_DEF(pj_hash_iterator_t*) pj_hash_next( pj_hash_table_t *ht, 
                                           pj_hash_iterator_t *it )
 {
+    if (ht->slots)
+        return oa_next(ht, it);
+
     it->entry = it->entry->next;
     if (it->entry) {
         return it;
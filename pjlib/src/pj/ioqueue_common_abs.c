@@ -194,6 +194,201 @@ PJ_INLINE(int) key_has_pending_connect(pj_ioqueue_key_t *key)
 #endif
 
 
+#if PJ_IOQUEUE_DGRAM_BATCH > 1
+/* Check if more than one pending read on a datagram key can be served
+ * with a single pj_sock_recvmmsg().
+ */
+PJ_INLINE(int) key_has_read_batch(pj_ioqueue_key_t *key)
+{
+    struct read_operation *op = key->read_list.next;
+
+    return key->fd_type == pj_SOCK_DGRAM() &&
+           op != &key->read_list && op->next != &key->read_list &&
+           op->op != PJ_IOQUEUE_OP_READ &&
+           op->next->op != PJ_IOQUEUE_OP_READ &&
+           op->next->flags == op->flags;
+}
+
+/* Check if more than one queued write on a datagram key can be flushed
+ * with a single pj_sock_sendmmsg().
+ */
+PJ_INLINE(int) key_has_write_batch(pj_ioqueue_key_t *key)
+{
+    struct write_operation *op = key->write_list.next;
+
+    return key->fd_type == pj_SOCK_DGRAM() &&
+           op != &key->write_list && op->next != &key->write_list &&
+           op->next->flags == op->flags;
+}
+
+/* Call the read/write callback of the completed operations. Key's mutex
+ * must be held on entry and will be released.
+ */
+static void call_batch_callbacks(pj_ioqueue_key_t *h,
+                                 pj_bool_t is_read,
+                                 unsigned cnt,
+                                 pj_ioqueue_op_key_t *op_key[],
+                                 const pj_ssize_t bytes[])
+{
+    pj_bool_t has_lock;
+    unsigned i;
+
+    /* Unlock; from this point we don't need to hold key's mutex
+     * (unless concurrency is disabled, which in this case we should
+     * hold the mutex while calling the callback) */
+    if (h->allow_concurrent) {
+        /* concurrency may be changed while we're in the callback, so
+         * save it to a flag.
+         */
+        has_lock = PJ_FALSE;
+        pj_ioqueue_unlock_key(h);
+        PJ_RACE_ME(5);
+    } else {
+        has_lock = PJ_TRUE;
+    }
+
+    /* Call the callbacks in the order the data was received/sent. */
+    for (i = 0; i < cnt; ++i) {
+        if (IS_CLOSING(h))
+            break;
+
+        if (is_read && h->cb.on_read_complete) {
+            (*h->cb.on_read_complete)(h, op_key[i], bytes[i]);
+        } else if (!is_read && h->cb.on_write_complete) {
+            (*h->cb.on_write_complete)(h, op_key[i], bytes[i]);
+        }
+    }
+
+    if (has_lock) {
+        pj_ioqueue_unlock_key(h);
+    }
+}
+
+/* Receive datagrams for up to PJ_IOQUEUE_DGRAM_BATCH pending read
+ * operations with one pj_sock_recvmmsg(). Key's mutex must be held on
+ * entry and will be released.
+ */
+static void dispatch_read_batch(pj_ioqueue_t *ioqueue, pj_ioqueue_key_t *h)
+{
+    struct read_operation *read_op[PJ_IOQUEUE_DGRAM_BATCH];
+    pj_ioqueue_op_key_t *op_key[PJ_IOQUEUE_DGRAM_BATCH];
+    pj_sock_mmsg msgs[PJ_IOQUEUE_DGRAM_BATCH];
+    pj_ssize_t bytes_read[PJ_IOQUEUE_DGRAM_BATCH];
+    struct read_operation *op;
+    unsigned i, cnt = 0, flags;
+    pj_status_t rc;
+
+    flags = h->read_list.next->flags;
+    for (op = h->read_list.next;
+         op != &h->read_list && cnt < PJ_IOQUEUE_DGRAM_BATCH &&
+         op->op != PJ_IOQUEUE_OP_READ && op->flags == flags;
+         op = op->next)
+    {
+        read_op[cnt] = op;
+        op_key[cnt] = (pj_ioqueue_op_key_t*)op;
+        msgs[cnt].buf = op->buf;
+        msgs[cnt].len = op->size;
+        if (op->op == PJ_IOQUEUE_OP_RECV_FROM && op->rmt_addr &&
+            op->rmt_addrlen)
+        {
+            msgs[cnt].addr = op->rmt_addr;
+            msgs[cnt].addrlen = *op->rmt_addrlen;
+        } else {
+            msgs[cnt].addr = NULL;
+            msgs[cnt].addrlen = 0;
+        }
+        ++cnt;
+    }
+
+    rc = pj_sock_recvmmsg(h->fd, msgs, &cnt, flags);
+    if (rc != PJ_SUCCESS) {
+        /* Report the error to the first operation only, like the single
+         * read dispatch does. The rest stay pending.
+         */
+        cnt = 1;
+        bytes_read[0] = -rc;
+    } else {
+        for (i = 0; i < cnt; ++i) {
+            bytes_read[i] = msgs[i].len;
+            if (msgs[i].addr)
+                *read_op[i]->rmt_addrlen = msgs[i].addrlen;
+        }
+    }
+
+    for (i = 0; i < cnt; ++i) {
+        pj_list_erase(read_op[i]);
+        read_op[i]->op = PJ_IOQUEUE_OP_NONE;
+    }
+
+    /* Clear fdset if there is no pending read. */
+    if (pj_list_empty(&h->read_list))
+        ioqueue_remove_from_set(ioqueue, h, READABLE_EVENT);
+
+    call_batch_callbacks(h, PJ_TRUE, cnt, op_key, bytes_read);
+}
+
+/* Send up to PJ_IOQUEUE_DGRAM_BATCH queued datagrams with one
+ * pj_sock_sendmmsg(). Key's mutex must be held on entry and will be
+ * released.
+ */
+static void dispatch_write_batch(pj_ioqueue_t *ioqueue, pj_ioqueue_key_t *h)
+{
+    struct write_operation *write_op[PJ_IOQUEUE_DGRAM_BATCH];
+    pj_ioqueue_op_key_t *op_key[PJ_IOQUEUE_DGRAM_BATCH];
+    pj_sock_mmsg msgs[PJ_IOQUEUE_DGRAM_BATCH];
+    pj_ssize_t written[PJ_IOQUEUE_DGRAM_BATCH];
+    struct write_operation *op;
+    unsigned i, cnt = 0, flags;
+    pj_status_t rc;
+
+    flags = h->write_list.next->flags;
+    for (op = h->write_list.next;
+         op != &h->write_list && cnt < PJ_IOQUEUE_DGRAM_BATCH &&
+         op->flags == flags;
+         op = op->next)
+    {
+        write_op[cnt] = op;
+        op_key[cnt] = (pj_ioqueue_op_key_t*)op;
+        msgs[cnt].buf = op->buf;
+        msgs[cnt].len = op->size;
+        if (op->op == PJ_IOQUEUE_OP_SEND_TO) {
+            msgs[cnt].addr = &op->rmt_addr;
+            msgs[cnt].addrlen = op->rmt_addrlen;
+        } else {
+            msgs[cnt].addr = NULL;
+            msgs[cnt].addrlen = 0;
+        }
+        ++cnt;
+    }
+
+    rc = pj_sock_sendmmsg(h->fd, msgs, &cnt, flags);
+    if (rc != PJ_SUCCESS) {
+        /* Report the error to the first operation only, like the single
+         * write dispatch does. The rest stay queued.
+         */
+        pj_assert(rc > 0);
+        cnt = 1;
+        written[0] = -rc;
+    } else {
+        for (i = 0; i < cnt; ++i)
+            written[i] = msgs[i].len;
+    }
+
+    for (i = 0; i < cnt; ++i) {
+        pj_list_erase(write_op[i]);
+        write_op[i]->written = written[i];
+        write_op[i]->op = PJ_IOQUEUE_OP_NONE;
+    }
+
+    /* Clear operation if there's no more data to send. */
+    if (pj_list_empty(&h->write_list))
+        ioqueue_remove_from_set(ioqueue, h, WRITEABLE_EVENT);
+
+    call_batch_callbacks(h, PJ_FALSE, cnt, op_key, written);
+}
+#endif  /* PJ_IOQUEUE_DGRAM_BATCH > 1 */
+
+
 /*
  * ioqueue_dispatch_event()
  *
@@ -298,6 +493,12 @@ pj_bool_t ioqueue_dispatch_write_event( pj_ioqueue_t *ioqueue,
 
     } else 
 #endif /* PJ_HAS_TCP */
+#if PJ_IOQUEUE_DGRAM_BATCH > 1
+    if (key_has_write_batch(h)) {
+        /* Flush multiple queued datagrams at once. */
+        dispatch_write_batch(ioqueue, h);
+    } else
+#endif
     if (key_has_pending_write(h)) {
         /* Socket is writable. */
         struct write_operation *write_op;
@@ -500,6 +701,12 @@ pj_bool_t ioqueue_dispatch_read_event( pj_ioqueue_t *ioqueue,
     }
     else
 #   endif
+#if PJ_IOQUEUE_DGRAM_BATCH > 1
+    if (key_has_read_batch(h)) {
+        /* Receive datagrams for multiple pending reads at once. */
+        dispatch_read_batch(ioqueue, h);
+    } else
+#endif
     if (key_has_pending_read(h)) {
         struct read_operation *read_op;
         pj_ssize_t bytes_read;
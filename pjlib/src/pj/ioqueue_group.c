@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2025 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <pj/ioqueue.h>
+#include <pj/assert.h>
+#include <pj/errno.h>
+#include <pj/log.h>
+#include <pj/pool.h>
+
+#define THIS_FILE   "ioqueue_group.c"
+
+/*
+ * ioqueue group is a set of independent ioqueue instances (shards), each
+ * with its own polling set. It doesn't depend on the ioqueue backend.
+ */
+struct pj_ioqueue_group_t
+{
+    unsigned             shard_cnt;
+    pj_ioqueue_t       **shard;
+};
+
+
+PJ_DEF(pj_status_t) pj_ioqueue_group_create(pj_pool_t *pool,
+                                            unsigned shard_cnt,
+                                            pj_size_t max_fd,
+                                            const pj_ioqueue_cfg *cfg,
+                                            pj_ioqueue_group_t **p_grp)
+{
+    pj_ioqueue_group_t *grp;
+    unsigned i;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(pool && shard_cnt && p_grp, PJ_EINVAL);
+
+    grp = PJ_POOL_ZALLOC_T(pool, pj_ioqueue_group_t);
+    grp->shard = (pj_ioqueue_t**)
+                 pj_pool_calloc(pool, shard_cnt, sizeof(pj_ioqueue_t*));
+
+    for (i = 0; i < shard_cnt; ++i) {
+        status = pj_ioqueue_create2(pool, max_fd, cfg, &grp->shard[i]);
+        if (status != PJ_SUCCESS) {
+            PJ_PERROR(2,(THIS_FILE, status,
+                         "Error creating ioqueue shard %d", i));
+            pj_ioqueue_group_destroy(grp);
+            return status;
+        }
+        grp->shard_cnt = i + 1;
+    }
+
+    PJ_LOG(4,(THIS_FILE, "ioqueue group created with %d %s shards",
+              shard_cnt, pj_ioqueue_name()));
+
+    *p_grp = grp;
+    return PJ_SUCCESS;
+}
+
+
+PJ_DEF(pj_status_t) pj_ioqueue_group_destroy(pj_ioqueue_group_t *grp)
+{
+    unsigned i;
+
+    PJ_ASSERT_RETURN(grp, PJ_EINVAL);
+
+    for (i = 0; i < grp->shard_cnt; ++i) {
+        if (grp->shard[i]) {
+            pj_ioqueue_destroy(grp->shard[i]);
+            grp->shard[i] = NULL;
+        }
+    }
+    grp->shard_cnt = 0;
+
+    return PJ_SUCCESS;
+}
+
+
+PJ_DEF(unsigned) pj_ioqueue_group_get_count(pj_ioqueue_group_t *grp)
+{
+    PJ_ASSERT_RETURN(grp, 0);
+    return grp->shard_cnt;
+}
+
+
+PJ_DEF(pj_ioqueue_t*) pj_ioqueue_group_get(pj_ioqueue_group_t *grp,
+                                           unsigned idx)
+{
+    PJ_ASSERT_RETURN(grp && idx < grp->shard_cnt, NULL);
+    return grp->shard[idx];
+}
+
+
+PJ_DEF(pj_ioqueue_t*) pj_ioqueue_group_select(pj_ioqueue_group_t *grp,
+                                              pj_uint32_t hash)
+{
+    PJ_ASSERT_RETURN(grp && grp->shard_cnt, NULL);
+
+    /* Scramble the value (Knuth's multiplicative hash) so that sequential
+     * values such as socket descriptors don't all land on few shards when
+     * the shard count shares a factor with the allocation pattern.
+     */
+    hash *= 2654435761U;
+    return grp->shard[(hash >> 16) % grp->shard_cnt];
+}
+
+
+PJ_DEF(pj_status_t) pj_ioqueue_group_register_sock2(
+                                        pj_pool_t *pool,
+                                        pj_ioqueue_group_t *grp,
+                                        pj_sock_t sock,
+                                        pj_grp_lock_t *grp_lock,
+                                        void *user_data,
+                                        const pj_ioqueue_callback *cb,
+                                        pj_ioqueue_key_t **key)
+{
+    pj_ioqueue_t *ioq;
+
+    PJ_ASSERT_RETURN(grp && grp->shard_cnt, PJ_EINVAL);
+
+    ioq = pj_ioqueue_group_select(grp, (pj_uint32_t)(pj_ssize_t)sock);
+    return pj_ioqueue_register_sock2(pool, ioq, sock, grp_lock, user_data,
+                                     cb, key);
+}
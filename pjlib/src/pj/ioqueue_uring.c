@@ -0,0 +1,1904 @@
+/*
+ * Copyright (C) 2025 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+/*
+ * ioqueue_uring.c
+ *
+ * This is the implementation of IOQueue framework using Linux io_uring.
+ * Unlike the select/epoll/kqueue backends which are readiness based, this
+ * backend is completion based (similar to the IOCP backend): every pending
+ * operation is submitted to the kernel as an SQE and its result is reported
+ * back as a CQE, so no extra recv()/send() system call is needed once the
+ * socket becomes ready.
+ *
+ * System calls are amortized in two ways:
+ *  - SQEs produced by callbacks which run inside pj_ioqueue_poll() (e.g.
+ *    re-arming a read) are not submitted one by one, but are flushed with
+ *    a single io_uring_enter() after the whole batch of CQEs has been
+ *    dispatched. The same io_uring_enter() call also waits for the next
+ *    completions.
+ *  - up to PJ_IOQUEUE_MAX_EVENTS_IN_SINGLE_POLL CQEs are reaped from the
+ *    completion ring without any system call.
+ *
+ * The ring is accessed with raw system calls, so liburing is not needed.
+ * Linux 5.11 or later is required (IORING_FEAT_EXT_ARG).
+ */
+#include <pj/ioqueue.h>
+#include <pj/os.h>
+#include <pj/lock.h>
+#include <pj/log.h>
+#include <pj/list.h>
+#include <pj/math.h>
+#include <pj/pool.h>
+#include <pj/string.h>
+#include <pj/assert.h>
+#include <pj/errno.h>
+#include <pj/sock.h>
+#include <pj/compat/socket.h>
+
+#define THIS_FILE   "ioq_uring"
+
+/* Only build when the backend is io_uring. */
+#if PJ_IOQUEUE_IMP == PJ_IOQUEUE_IMP_IO_URING
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+
+#if 0
+#  define TRACE_(args) PJ_LOG(3,args)
+#else
+#  define TRACE_(args)
+#endif
+
+/* Minimum and maximum number of submission queue entries. The actual size
+ * is derived from max_fd.
+ */
+#define MIN_SQ_ENTRIES      64
+#define MAX_SQ_ENTRIES      4096
+
+/* Timeout for cancelling pending operations in ioqueue destroy.
+ * As cancellation of io_uring operation is asynchronous, destroy may need
+ * to wait for the maximum time specified here.
+ */
+#define TIMEOUT_CANCEL_OP   5000
+
+/* user_data of internal SQEs whose completion should be ignored
+ * (e.g: IORING_OP_ASYNC_CANCEL).
+ */
+#define IGNORED_USER_DATA   0
+
+/*
+ * Pending operation.
+ * As io_uring may still own the operation after the application considers
+ * it finished (e.g: cancellation is asynchronous), we cannot use the
+ * operation key provided by app (pj_ioqueue_op_key_t.internal__) to store
+ * the operation parameters.
+ */
+struct pending_op
+{
+    PJ_DECL_LIST_MEMBER(struct pending_op);
+    pj_ioqueue_key_t       *key;
+    pj_ioqueue_op_key_t    *app_op_key;
+    pj_ioqueue_operation_e  op;
+    pj_bool_t               submitted;
+    pj_bool_t               cancelled;
+
+    /* Next write in the key's write queue. */
+    struct pending_op      *next_write;
+
+    /* Parameters */
+    char                   *buf;
+    pj_size_t               size;
+    pj_ssize_t              written;
+    unsigned                flags;
+    struct msghdr           msg;
+    struct iovec            iov;
+    pj_sockaddr             addr;
+    socklen_t               addrlen;
+    pj_sockaddr_t          *app_addr;
+    int                    *app_addrlen;
+    pj_sock_t              *accept_fd;
+    pj_sockaddr_t          *local_addr;
+};
+
+/*
+ * Structure for individual socket.
+ */
+struct pj_ioqueue_key_t
+{
+    PJ_DECL_LIST_MEMBER(struct pj_ioqueue_key_t);
+
+    pj_pool_t          *pool;
+    pj_ioqueue_t       *ioqueue;
+    pj_sock_t           fd;
+    int                 fd_type;
+    void               *user_data;
+    pj_ioqueue_callback cb;
+    pj_bool_t           allow_concurrent;
+    pj_grp_lock_t      *grp_lock;
+    pj_bool_t           closing;
+
+#if PJ_HAS_TCP
+    int                 connecting;
+    struct pending_op  *connect_op;
+#endif
+
+    /* Write queue. Only the head of the queue is submitted to the kernel,
+     * as io_uring does not guarantee the order of concurrent sends on
+     * the same socket.
+     */
+    struct pending_op  *write_head;
+    struct pending_op  *write_tail;
+
+    struct pending_op   pending_list;
+    struct pending_op   free_pending_list;
+};
+
+/*
+ * io_uring submission and completion rings.
+ */
+struct uring_sq
+{
+    unsigned           *khead;
+    unsigned           *ktail;
+    unsigned           *kring_mask;
+    unsigned           *kring_entries;
+    unsigned           *array;
+    struct io_uring_sqe *sqes;
+    unsigned            sqe_tail;
+    void               *ring_ptr;
+    size_t              ring_sz;
+    size_t              sqes_sz;
+};
+
+struct uring_cq
+{
+    unsigned           *khead;
+    unsigned           *ktail;
+    unsigned           *kring_mask;
+    struct io_uring_cqe *cqes;
+    void               *ring_ptr;
+    size_t              ring_sz;
+};
+
+/*
+ * IO Queue structure.
+ */
+struct pj_ioqueue_t
+{
+    pj_pool_t          *pool;
+    pj_ioqueue_cfg      cfg;
+    pj_lock_t          *lock;
+    pj_bool_t           auto_delete_lock;
+    pj_size_t           max_fd;
+
+    int                 ring_fd;
+    unsigned            features;
+    struct uring_sq     sq;
+    struct uring_cq     cq;
+    pj_lock_t          *sq_lock;
+    pj_lock_t          *cq_lock;
+
+    /* Thread local flag, set while the thread is dispatching completions
+     * of this ioqueue. Submissions made by such thread are flushed after
+     * the whole batch has been dispatched.
+     */
+    long                dispatch_tls_id;
+
+    pj_ioqueue_key_t    active_list;
+    pj_ioqueue_key_t    free_list;
+};
+
+/* The operation of a pending op key is stored in the first slot of
+ * op_key->internal__, and the pending op pointer in the last slot.
+ */
+#define OPKEY_OPERATION(op_key) \
+            ((pj_ioqueue_operation_e)(pj_ssize_t)(op_key)->internal__[0])
+#define SET_OPKEY_OPERATION(op_key, operation) \
+            (op_key)->internal__[0] = (void*)(pj_ssize_t)(operation)
+#define PENDING_OP_POS(op_key)  (PJ_ARRAY_SIZE(op_key->internal__) - 1)
+
+/* Prototypes of internal functions */
+static void key_on_destroy(void *data);
+static void increment_counter(pj_ioqueue_key_t *key);
+static void decrement_counter(pj_ioqueue_key_t *key);
+static void flush_sq(pj_ioqueue_t *ioqueue, pj_bool_t force);
+
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit,
+                              unsigned min_complete, unsigned flags,
+                              const void *arg, size_t argsz)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+                        flags, arg, argsz);
+}
+
+static struct pending_op* get_pending_op(pj_ioqueue_op_key_t *op_key)
+{
+    return (struct pending_op*)
+           (op_key->internal__[PENDING_OP_POS(op_key)]);
+}
+
+/*
+ * pj_ioqueue_name()
+ */
+PJ_DEF(const char*) pj_ioqueue_name(void)
+{
+    return "io_uring";
+}
+
+PJ_DEF(void) pj_ioqueue_cfg_default(pj_ioqueue_cfg *cfg)
+{
+    pj_bzero(cfg, sizeof(*cfg));
+    cfg->epoll_flags = PJ_IOQUEUE_DEFAULT_EPOLL_FLAGS;
+    cfg->default_concurrency = PJ_IOQUEUE_DEFAULT_ALLOW_CONCURRENCY;
+}
+
+/* Map the submission and completion rings. */
+static pj_status_t map_rings(pj_ioqueue_t *ioqueue,
+                             const struct io_uring_params *p)
+{
+    struct uring_sq *sq = &ioqueue->sq;
+    struct uring_cq *cq = &ioqueue->cq;
+    char *sq_ptr, *cq_ptr;
+    unsigned i;
+
+    sq->ring_sz = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+    cq->ring_sz = p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        if (cq->ring_sz > sq->ring_sz)
+            sq->ring_sz = cq->ring_sz;
+        cq->ring_sz = sq->ring_sz;
+    }
+
+    sq->ring_ptr = mmap(NULL, sq->ring_sz, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ioqueue->ring_fd,
+                        IORING_OFF_SQ_RING);
+    if (sq->ring_ptr == MAP_FAILED) {
+        sq->ring_ptr = NULL;
+        return PJ_RETURN_OS_ERROR(pj_get_native_os_error());
+    }
+
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        cq->ring_ptr = sq->ring_ptr;
+    } else {
+        cq->ring_ptr = mmap(NULL, cq->ring_sz, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, ioqueue->ring_fd,
+                            IORING_OFF_CQ_RING);
+        if (cq->ring_ptr == MAP_FAILED) {
+            cq->ring_ptr = NULL;
+            return PJ_RETURN_OS_ERROR(pj_get_native_os_error());
+        }
+    }
+
+    sq->sqes_sz = p->sq_entries * sizeof(struct io_uring_sqe);
+    sq->sqes = (struct io_uring_sqe*)
+               mmap(NULL, sq->sqes_sz, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ioqueue->ring_fd,
+                    IORING_OFF_SQES);
+    if (sq->sqes == MAP_FAILED) {
+        sq->sqes = NULL;
+        return PJ_RETURN_OS_ERROR(pj_get_native_os_error());
+    }
+
+    sq_ptr = (char*)sq->ring_ptr;
+    sq->khead = (unsigned*)(sq_ptr + p->sq_off.head);
+    sq->ktail = (unsigned*)(sq_ptr + p->sq_off.tail);
+    sq->kring_mask = (unsigned*)(sq_ptr + p->sq_off.ring_mask);
+    sq->kring_entries = (unsigned*)(sq_ptr + p->sq_off.ring_entries);
+    sq->array = (unsigned*)(sq_ptr + p->sq_off.array);
+    sq->sqe_tail = *sq->ktail;
+
+    /* SQE slots are used in ring order, so the indirection array can be
+     * filled once.
+     */
+    for (i=0; i<p->sq_entries; ++i)
+        sq->array[i] = i;
+
+    cq_ptr = (char*)cq->ring_ptr;
+    cq->khead = (unsigned*)(cq_ptr + p->cq_off.head);
+    cq->ktail = (unsigned*)(cq_ptr + p->cq_off.tail);
+    cq->kring_mask = (unsigned*)(cq_ptr + p->cq_off.ring_mask);
+    cq->cqes = (struct io_uring_cqe*)(cq_ptr + p->cq_off.cqes);
+
+    return PJ_SUCCESS;
+}
+
+/* Unmap rings and close the io_uring instance. */
+static void close_ring(pj_ioqueue_t *ioqueue)
+{
+    if (ioqueue->sq.sqes) {
+        munmap(ioqueue->sq.sqes, ioqueue->sq.sqes_sz);
+        ioqueue->sq.sqes = NULL;
+    }
+    if (ioqueue->cq.ring_ptr && ioqueue->cq.ring_ptr != ioqueue->sq.ring_ptr)
+        munmap(ioqueue->cq.ring_ptr, ioqueue->cq.ring_sz);
+    ioqueue->cq.ring_ptr = NULL;
+    if (ioqueue->sq.ring_ptr) {
+        munmap(ioqueue->sq.ring_ptr, ioqueue->sq.ring_sz);
+        ioqueue->sq.ring_ptr = NULL;
+    }
+    if (ioqueue->ring_fd >= 0) {
+        close(ioqueue->ring_fd);
+        ioqueue->ring_fd = -1;
+    }
+}
+
+/*
+ * pj_ioqueue_create()
+ */
+PJ_DEF(pj_status_t) pj_ioqueue_create( pj_pool_t *pool,
+                                       pj_size_t max_fd,
+                                       pj_ioqueue_t **p_ioqueue)
+{
+    return pj_ioqueue_create2(pool, max_fd, NULL, p_ioqueue);
+}
+
+/*
+ * pj_ioqueue_create2()
+ */
+PJ_DEF(pj_status_t) pj_ioqueue_create2(pj_pool_t *pool,
+                                       pj_size_t max_fd,
+                                       const pj_ioqueue_cfg *cfg,
+                                       pj_ioqueue_t **p_ioqueue)
+{
+    pj_ioqueue_t *ioqueue;
+    struct io_uring_params params;
+    unsigned entries;
+    pj_size_t i;
+    pj_status_t rc;
+
+    PJ_ASSERT_RETURN(pool && p_ioqueue && max_fd > 0, PJ_EINVAL);
+
+    /* Check that sizeof(pj_ioqueue_op_key_t) makes sense: we store the
+     * operation at the start and the pending op pointer at the end of
+     * internal__.
+     */
+    PJ_ASSERT_RETURN(PJ_ARRAY_SIZE(((pj_ioqueue_op_key_t*)0)->internal__) >= 2,
+                     PJ_EBUG);
+
+    ioqueue = PJ_POOL_ZALLOC_T(pool, pj_ioqueue_t);
+    ioqueue->pool = pool;
+    ioqueue->ring_fd = -1;
+    ioqueue->dispatch_tls_id = -1;
+    if (cfg)
+        pj_memcpy(&ioqueue->cfg, cfg, sizeof(*cfg));
+    else
+        pj_ioqueue_cfg_default(&ioqueue->cfg);
+
+    /* Size the submission queue after the number of handles, as most
+     * handles will have at least one pending read at any time.
+     */
+    for (entries = MIN_SQ_ENTRIES;
+         entries < max_fd * 2 && entries < MAX_SQ_ENTRIES;
+         entries <<= 1)
+    {
+    }
+
+    pj_bzero(&params, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 4;
+
+    ioqueue->ring_fd = sys_io_uring_setup(entries, &params);
+    if (ioqueue->ring_fd < 0) {
+        rc = PJ_RETURN_OS_ERROR(pj_get_native_os_error());
+        PJ_PERROR(1, (THIS_FILE, rc, "io_uring_setup() error"));
+        return rc;
+    }
+    ioqueue->features = params.features;
+
+    /* Waiting with timeout requires IORING_FEAT_EXT_ARG (Linux 5.11) */
+    if ((params.features & IORING_FEAT_EXT_ARG) == 0) {
+        PJ_LOG(1, (THIS_FILE, "io_uring: kernel does not support "
+                              "IORING_FEAT_EXT_ARG"));
+        close_ring(ioqueue);
+        return PJ_ENOTSUP;
+    }
+
+    rc = map_rings(ioqueue, &params);
+    if (rc != PJ_SUCCESS)
+        goto on_error;
+
+    rc = pj_lock_create_simple_mutex(pool, "ioq_sq", &ioqueue->sq_lock);
+    if (rc != PJ_SUCCESS)
+        goto on_error;
+
+    rc = pj_lock_create_simple_mutex(pool, "ioq_cq", &ioqueue->cq_lock);
+    if (rc != PJ_SUCCESS)
+        goto on_error;
+
+    rc = pj_lock_create_recursive_mutex(pool, "ioq%p", &ioqueue->lock);
+    if (rc != PJ_SUCCESS)
+        goto on_error;
+    ioqueue->auto_delete_lock = PJ_TRUE;
+
+    rc = pj_thread_local_alloc(&ioqueue->dispatch_tls_id);
+    if (rc != PJ_SUCCESS)
+        goto on_error;
+
+    /*
+     * Create and initialize key pools.
+     */
+    pj_list_init(&ioqueue->active_list);
+    pj_list_init(&ioqueue->free_list);
+
+    /* Preallocate keys according to max_fd setting, and put them
+     * in free_list.
+     */
+    for (i=0; i<max_fd; ++i) {
+        pj_ioqueue_key_t *key;
+
+        key = PJ_POOL_ZALLOC_T(pool, pj_ioqueue_key_t);
+        key->fd = PJ_INVALID_SOCKET;
+
+        /* Initialize pending op lists */
+        pj_list_init(&key->pending_list);
+        pj_list_init(&key->free_pending_list);
+
+        pj_list_push_back(&ioqueue->free_list, key);
+    }
+    ioqueue->max_fd = max_fd;
+
+    PJ_LOG(4, (THIS_FILE, "io_uring I/O Queue created (%p), sq=%u, cq=%u",
+               ioqueue, params.sq_entries, params.cq_entries));
+
+    *p_ioqueue = ioqueue;
+    return PJ_SUCCESS;
+
+on_error:
+    if (ioqueue->dispatch_tls_id != -1)
+        pj_thread_local_free(ioqueue->dispatch_tls_id);
+    if (ioqueue->lock)
+        pj_lock_destroy(ioqueue->lock);
+    if (ioqueue->cq_lock)
+        pj_lock_destroy(ioqueue->cq_lock);
+    if (ioqueue->sq_lock)
+        pj_lock_destroy(ioqueue->sq_lock);
+    close_ring(ioqueue);
+    return rc;
+}
+
+/*
+ * pj_ioqueue_destroy()
+ */
+PJ_DEF(pj_status_t) pj_ioqueue_destroy( pj_ioqueue_t *ioqueue )
+{
+    pj_ioqueue_key_t *key, *next;
+    pj_time_val stop;
+
+    PJ_CHECK_STACK();
+    PJ_ASSERT_RETURN(ioqueue, PJ_EINVAL);
+
+    pj_lock_acquire(ioqueue->lock);
+
+    /* Destroy active keys */
+    key = ioqueue->active_list.next;
+    while (key != &ioqueue->active_list) {
+        next = key->next;
+        pj_ioqueue_unregister(key);
+        key = next;
+    }
+
+    pj_lock_release(ioqueue->lock);
+
+    /* Wait cancelling pending ops. */
+    pj_gettickcount(&stop);
+    stop.msec += TIMEOUT_CANCEL_OP;
+    pj_time_val_normalize(&stop);
+
+    while (1) {
+        pj_time_val timeout = {0, 100};
+        pj_size_t pending_key_cnt;
+
+        pending_key_cnt = ioqueue->max_fd - pj_list_size(&ioqueue->free_list);
+        if (!pending_key_cnt)
+            break;
+
+        pj_ioqueue_poll(ioqueue, &timeout);
+
+        pj_gettickcount(&timeout);
+        if (PJ_TIME_VAL_GTE(timeout, stop)) {
+            PJ_LOG(3, (THIS_FILE, "Warning, io_uring destroy timeout in "
+                       "waiting for cancelling ops, after %dms, "
+                       "pending keys=%d",
+                       TIMEOUT_CANCEL_OP, (int)pending_key_cnt));
+            break;
+        }
+    }
+
+    close_ring(ioqueue);
+
+    pj_thread_local_free(ioqueue->dispatch_tls_id);
+    pj_lock_destroy(ioqueue->cq_lock);
+    pj_lock_destroy(ioqueue->sq_lock);
+
+    if (ioqueue->auto_delete_lock)
+        pj_lock_destroy(ioqueue->lock);
+
+    return PJ_SUCCESS;
+}
+
+
+PJ_DEF(pj_status_t) pj_ioqueue_set_default_concurrency(pj_ioqueue_t *ioqueue,
+                                                       pj_bool_t allow)
+{
+    PJ_ASSERT_RETURN(ioqueue != NULL, PJ_EINVAL);
+    ioqueue->cfg.default_concurrency = allow;
+    return PJ_SUCCESS;
+}
+
+/*
+ * pj_ioqueue_set_lock()
+ */
+PJ_DEF(pj_status_t) pj_ioqueue_set_lock( pj_ioqueue_t *ioqueue,
+                                         pj_lock_t *lock,
+                                         pj_bool_t auto_delete )
+{
+    PJ_ASSERT_RETURN(ioqueue && lock, PJ_EINVAL);
+
+    if (ioqueue->auto_delete_lock) {
+        pj_lock_destroy(ioqueue->lock);
+    }
+
+    ioqueue->lock = lock;
+    ioqueue->auto_delete_lock = auto_delete;
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * pj_ioqueue_register_sock2()
+ */
+PJ_DEF(pj_status_t) pj_ioqueue_register_sock2(pj_pool_t *pool,
+                                              pj_ioqueue_t *ioqueue,
+                                              pj_sock_t sock,
+                                              pj_grp_lock_t *grp_lock,
+                                              void *user_data,
+                                              const pj_ioqueue_callback *cb,
+                                              pj_ioqueue_key_t **key )
+{
+    pj_ioqueue_key_t *rec;
+    pj_uint32_t value;
+    int optlen;
+    pj_status_t status;
+
+    PJ_UNUSED_ARG(pool);
+    PJ_ASSERT_RETURN(ioqueue && sock != PJ_INVALID_SOCKET && cb && key,
+                     PJ_EINVAL);
+
+    pj_lock_acquire(ioqueue->lock);
+
+    /* Verify that there is a free key */
+    if (pj_list_empty(&ioqueue->free_list)) {
+        pj_lock_release(ioqueue->lock);
+        return PJ_ETOOMANY;
+    }
+
+    /* Get the key record from the free list. */
+    rec = ioqueue->free_list.next;
+
+    /* Create pool for this key */
+    rec->pool = pj_pool_create(ioqueue->pool->factory, "key%p",
+                               512, 512, NULL);
+    if (!rec->pool) {
+        pj_lock_release(ioqueue->lock);
+        return PJ_ENOMEM;
+    }
+
+    /* Move key from free list to active list */
+    pj_list_erase(rec);
+    pj_list_push_back(&ioqueue->active_list, rec);
+
+    pj_lock_release(ioqueue->lock);
+
+    /* Build the key for this socket. */
+    rec->ioqueue = ioqueue;
+    rec->fd = sock;
+    rec->user_data = user_data;
+    rec->closing = 0;
+    rec->write_head = rec->write_tail = NULL;
+    pj_memcpy(&rec->cb, cb, sizeof(pj_ioqueue_callback));
+#if PJ_HAS_TCP
+    rec->connecting = 0;
+    rec->connect_op = NULL;
+#endif
+
+    /* Get socket type. Partial writes are only retried on stream socket. */
+    optlen = sizeof(rec->fd_type);
+    status = pj_sock_getsockopt(sock, pj_SOL_SOCKET(), pj_SO_TYPE(),
+                                &rec->fd_type, &optlen);
+    if (status != PJ_SUCCESS)
+        rec->fd_type = pj_SOCK_STREAM();
+
+    /* Set concurrency for this handle */
+    status = pj_ioqueue_set_concurrency(rec, ioqueue->cfg.default_concurrency);
+    if (status != PJ_SUCCESS)
+        goto on_error;
+
+    /* Set socket to nonblocking, for the immediate operations. */
+    value = 1;
+    if (ioctl(sock, FIONBIO, &value)) {
+        status = pj_get_netos_error();
+        goto on_error;
+    }
+
+    /* Create group lock if not specified */
+    if (!grp_lock) {
+        status = pj_grp_lock_create_w_handler(rec->pool, NULL, rec,
+                                              &key_on_destroy, &grp_lock);
+    } else {
+        status = pj_grp_lock_add_handler(grp_lock, rec->pool, rec,
+                                         &key_on_destroy);
+    }
+    if (status != PJ_SUCCESS)
+        goto on_error;
+
+    rec->grp_lock = grp_lock;
+
+    /* Set initial reference count to 1 */
+    increment_counter(rec);
+
+    TRACE_((THIS_FILE, "REG key %p", rec));
+
+    /* Finally */
+    *key = rec;
+    return PJ_SUCCESS;
+
+on_error:
+    key_on_destroy(rec);
+    return status;
+}
+
+
+/*
+ * pj_ioqueue_register_sock()
+ */
+PJ_DEF(pj_status_t) pj_ioqueue_register_sock( pj_pool_t *pool,
+                                              pj_ioqueue_t *ioqueue,
+                                              pj_sock_t sock,
+                                              void *user_data,
+                                              const pj_ioqueue_callback *cb,
+                                              pj_ioqueue_key_t **key )
+{
+    return pj_ioqueue_register_sock2(pool, ioqueue, sock, NULL, user_data, cb,
+                                     key);
+}
+
+
+/*
+ * pj_ioqueue_get_user_data()
+ */
+PJ_DEF(void*) pj_ioqueue_get_user_data( pj_ioqueue_key_t *key )
+{
+    PJ_ASSERT_RETURN(key, NULL);
+    return key->user_data;
+}
+
+/*
+ * pj_ioqueue_set_user_data()
+ */
+PJ_DEF(pj_status_t) pj_ioqueue_set_user_data( pj_ioqueue_key_t *key,
+                                              void *user_data,
+                                              void **old_data )
+{
+    PJ_ASSERT_RETURN(key, PJ_EINVAL);
+
+    if (old_data)
+        *old_data = key->user_data;
+
+    key->user_data = user_data;
+    return PJ_SUCCESS;
+}
+
+
+static void key_on_destroy(void *data)
+{
+    pj_ioqueue_key_t *key = (pj_ioqueue_key_t*)data;
+    pj_ioqueue_t *ioqueue = key->ioqueue;
+
+    /* Reset pool & keys */
+    key->grp_lock = NULL;
+    key->fd = PJ_INVALID_SOCKET;
+    pj_pool_safe_release(&key->pool);
+
+    /* Reset free pending lists */
+    pj_assert(pj_list_empty(&key->pending_list));
+    pj_list_init(&key->pending_list);
+    pj_list_init(&key->free_pending_list);
+
+    /* Return key to free list */
+    pj_lock_acquire(ioqueue->lock);
+    pj_list_erase(key);
+    pj_list_push_back(&ioqueue->free_list, key);
+
+    TRACE_((THIS_FILE, "FREE key %p", key));
+
+    pj_lock_release(ioqueue->lock);
+}
+
+
+/* Increment the key's reference counter. */
+static void increment_counter(pj_ioqueue_key_t *key)
+{
+    pj_grp_lock_add_ref_dbg(key->grp_lock, "ioqueue", 0);
+}
+
+
+/* Decrement the key's reference counter, and when the counter reach zero,
+ * destroy the key.
+ */
+static void decrement_counter(pj_ioqueue_key_t *key)
+{
+    pj_grp_lock_dec_ref_dbg(key->grp_lock, "ioqueue", 0);
+}
+
+/* Allocate pending op. Key must have been locked by caller. */
+static struct pending_op *alloc_pending_op(pj_ioqueue_key_t *key,
+                                           pj_ioqueue_op_key_t *op_key,
+                                           pj_ioqueue_operation_e operation)
+{
+    struct pending_op *op;
+
+    if (pj_list_empty(&key->free_pending_list)) {
+        op = PJ_POOL_ZALLOC_T(key->pool, struct pending_op);
+        if (!op)
+            return NULL;
+        pj_list_init(op);
+    } else {
+        op = key->free_pending_list.next;
+        pj_list_erase(op);
+    }
+    pj_list_push_back(&key->pending_list, op);
+    increment_counter(key);
+
+    /* Init the pending op */
+    op->key = key;
+    op->app_op_key = op_key;
+    op->op = operation;
+    op->submitted = PJ_FALSE;
+    op->cancelled = PJ_FALSE;
+    op->next_write = NULL;
+    op->written = 0;
+    op->app_addr = NULL;
+    op->app_addrlen = NULL;
+    op->accept_fd = NULL;
+    op->local_addr = NULL;
+
+    /* Link app op key to pending-op */
+    if (op_key)
+        op_key->internal__[PENDING_OP_POS(op_key)] = op;
+
+    TRACE_((THIS_FILE, "ALLOC   op key %p op %p", key, op));
+
+    return op;
+}
+
+static void release_pending_op(pj_ioqueue_key_t *key, struct pending_op *op)
+{
+    pj_assert(key && op);
+
+    pj_ioqueue_lock_key(key);
+    op->app_op_key = NULL;
+    op->op = PJ_IOQUEUE_OP_NONE;
+    pj_list_erase(op);
+    pj_list_push_back(&key->free_pending_list, op);
+    decrement_counter(key);
+    pj_ioqueue_unlock_key(key);
+
+    TRACE_((THIS_FILE, "RELEASE op key %p op %p", key, op));
+}
+
+/* Check whether calling thread is dispatching completions of the
+ * ioqueue.
+ */
+static pj_bool_t in_dispatch(pj_ioqueue_t *ioqueue)
+{
+    return pj_thread_local_get(ioqueue->dispatch_tls_id) != NULL;
+}
+
+/* Submit pending SQEs to the kernel. Unless forced, submission is deferred
+ * when calling thread is dispatching completions, as the SQEs will be
+ * flushed in one go afterwards.
+ */
+static void flush_sq(pj_ioqueue_t *ioqueue, pj_bool_t force)
+{
+    unsigned to_submit;
+    int rc;
+
+    if (!force && in_dispatch(ioqueue))
+        return;
+
+    to_submit = __atomic_load_n(ioqueue->sq.ktail, __ATOMIC_ACQUIRE) -
+                __atomic_load_n(ioqueue->sq.khead, __ATOMIC_ACQUIRE);
+    if (to_submit == 0)
+        return;
+
+    do {
+        rc = sys_io_uring_enter(ioqueue->ring_fd, to_submit, 0, 0, NULL, 0);
+    } while (rc < 0 && errno == EINTR);
+
+    /* On EAGAIN/EBUSY the SQEs stay in the ring and will be submitted on
+     * the next io_uring_enter().
+     */
+    if (rc < 0 && errno != EAGAIN && errno != EBUSY) {
+        PJ_PERROR(4, (THIS_FILE, PJ_RETURN_OS_ERROR(errno),
+                      "io_uring_enter() submit error"));
+    }
+}
+
+/* Get a free SQE, sq_lock must be held. */
+static struct io_uring_sqe *get_sqe(pj_ioqueue_t *ioqueue)
+{
+    struct uring_sq *sq = &ioqueue->sq;
+    unsigned head, retry;
+
+    for (retry = 0; retry < 3; ++retry) {
+        head = __atomic_load_n(sq->khead, __ATOMIC_ACQUIRE);
+        if (sq->sqe_tail - head < *sq->kring_entries) {
+            struct io_uring_sqe *sqe;
+
+            sqe = &sq->sqes[sq->sqe_tail & *sq->kring_mask];
+            pj_bzero(sqe, sizeof(*sqe));
+            return sqe;
+        }
+
+        /* Submission ring is full, make some room. */
+        flush_sq(ioqueue, PJ_TRUE);
+    }
+    return NULL;
+}
+
+/* Publish the SQE obtained from get_sqe(), sq_lock must be held. */
+static void commit_sqe(pj_ioqueue_t *ioqueue)
+{
+    ++ioqueue->sq.sqe_tail;
+    __atomic_store_n(ioqueue->sq.ktail, ioqueue->sq.sqe_tail,
+                     __ATOMIC_RELEASE);
+}
+
+/* Prepare and submit SQE for the pending op. Key must have been locked. */
+static pj_status_t submit_op(pj_ioqueue_key_t *key, struct pending_op *op)
+{
+    pj_ioqueue_t *ioqueue = key->ioqueue;
+    struct io_uring_sqe *sqe;
+
+    pj_lock_acquire(ioqueue->sq_lock);
+
+    sqe = get_sqe(ioqueue);
+    if (!sqe) {
+        pj_lock_release(ioqueue->sq_lock);
+        return PJ_ETOOMANY;
+    }
+
+    sqe->fd = (int)key->fd;
+    sqe->user_data = (pj_uint64_t)(pj_size_t)op;
+
+    switch (op->op) {
+    case PJ_IOQUEUE_OP_RECV:
+        sqe->opcode = IORING_OP_RECV;
+        sqe->addr = (pj_uint64_t)(pj_size_t)op->buf;
+        sqe->len = (unsigned)op->size;
+        sqe->msg_flags = op->flags;
+        break;
+    case PJ_IOQUEUE_OP_RECV_FROM:
+        op->iov.iov_base = op->buf;
+        op->iov.iov_len = op->size;
+        pj_bzero(&op->msg, sizeof(op->msg));
+        op->msg.msg_name = &op->addr;
+        op->msg.msg_namelen = sizeof(op->addr);
+        op->msg.msg_iov = &op->iov;
+        op->msg.msg_iovlen = 1;
+        sqe->opcode = IORING_OP_RECVMSG;
+        sqe->addr = (pj_uint64_t)(pj_size_t)&op->msg;
+        sqe->len = 1;
+        sqe->msg_flags = op->flags;
+        break;
+    case PJ_IOQUEUE_OP_SEND:
+        sqe->opcode = IORING_OP_SEND;
+        sqe->addr = (pj_uint64_t)(pj_size_t)(op->buf + op->written);
+        sqe->len = (unsigned)(op->size - op->written);
+        sqe->msg_flags = op->flags | MSG_NOSIGNAL;
+        break;
+    case PJ_IOQUEUE_OP_SEND_TO:
+        op->iov.iov_base = op->buf + op->written;
+        op->iov.iov_len = op->size - op->written;
+        pj_bzero(&op->msg, sizeof(op->msg));
+        op->msg.msg_name = &op->addr;
+        op->msg.msg_namelen = op->addrlen;
+        op->msg.msg_iov = &op->iov;
+        op->msg.msg_iovlen = 1;
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->addr = (pj_uint64_t)(pj_size_t)&op->msg;
+        sqe->len = 1;
+        sqe->msg_flags = op->flags | MSG_NOSIGNAL;
+        break;
+#if PJ_HAS_TCP
+    case PJ_IOQUEUE_OP_ACCEPT:
+        op->addrlen = sizeof(op->addr);
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->addr = (pj_uint64_t)(pj_size_t)&op->addr;
+        sqe->addr2 = (pj_uint64_t)(pj_size_t)&op->addrlen;
+        break;
+    case PJ_IOQUEUE_OP_CONNECT:
+        /* Connect is initiated with non-blocking connect(), we only need
+         * to wait until the socket is writable.
+         */
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->poll32_events = POLLOUT;
+        break;
+#endif
+    default:
+        pj_assert(!"Invalid operation");
+        pj_lock_release(ioqueue->sq_lock);
+        return PJ_EBUG;
+    }
+
+    commit_sqe(ioqueue);
+    op->submitted = PJ_TRUE;
+
+    pj_lock_release(ioqueue->sq_lock);
+
+    flush_sq(ioqueue, PJ_FALSE);
+
+    return PJ_SUCCESS;
+}
+
+/* Submit IORING_OP_ASYNC_CANCEL for a submitted op. */
+static void submit_cancel(pj_ioqueue_t *ioqueue, struct pending_op *op)
+{
+    struct io_uring_sqe *sqe;
+
+    pj_lock_acquire(ioqueue->sq_lock);
+    sqe = get_sqe(ioqueue);
+    if (sqe) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = (pj_uint64_t)(pj_size_t)op;
+        sqe->user_data = IGNORED_USER_DATA;
+        commit_sqe(ioqueue);
+    } else {
+        PJ_LOG(3, (THIS_FILE, "Unable to cancel op %p, submission queue "
+                              "is full", op));
+    }
+    pj_lock_release(ioqueue->sq_lock);
+}
+
+/* Remove op from write queue and submit the next write, if any.
+ * Key must have been locked.
+ */
+static void finish_write(pj_ioqueue_key_t *key, struct pending_op *op)
+{
+    struct pending_op *prev = NULL, *it;
+
+    for (it = key->write_head; it && it != op; it = it->next_write)
+        prev = it;
+    if (!it)
+        return;
+
+    if (prev)
+        prev->next_write = op->next_write;
+    else
+        key->write_head = op->next_write;
+    if (key->write_tail == op)
+        key->write_tail = prev;
+    op->next_write = NULL;
+
+    it = key->write_head;
+    if (it && !it->submitted && !key->closing) {
+        pj_status_t status = submit_op(key, it);
+        if (status != PJ_SUCCESS) {
+            PJ_PERROR(3, (THIS_FILE, status, "Error submitting queued write "
+                          "of key %p", key));
+        }
+    }
+}
+
+/* Cancel a pending op, without calling the callback. Key must have been
+ * locked. Op that has not been submitted is released immediately, otherwise
+ * it will be released when its completion arrives.
+ */
+static void cancel_op(pj_ioqueue_key_t *key, struct pending_op *op)
+{
+    if (op->cancelled)
+        return;
+
+    op->cancelled = PJ_TRUE;
+
+    if (op->op == PJ_IOQUEUE_OP_SEND || op->op == PJ_IOQUEUE_OP_SEND_TO)
+        finish_write(key, op);
+#if PJ_HAS_TCP
+    if (op == key->connect_op) {
+        key->connect_op = NULL;
+        key->connecting = 0;
+    }
+#endif
+
+    if (op->submitted)
+        submit_cancel(key->ioqueue, op);
+    else
+        release_pending_op(key, op);
+}
+
+/* Cancel all pending ops of the key, key must have been locked. */
+static void cancel_all_pending_op(pj_ioqueue_key_t *key)
+{
+    struct pending_op *op, *next;
+
+    op = key->pending_list.next;
+    while (op != &key->pending_list) {
+        next = op->next;
+        if (op->app_op_key && get_pending_op(op->app_op_key) == op)
+            SET_OPKEY_OPERATION(op->app_op_key, PJ_IOQUEUE_OP_NONE);
+        cancel_op(key, op);
+        op = next;
+    }
+}
+
+/*
+ * pj_ioqueue_unregister()
+ */
+PJ_DEF(pj_status_t) pj_ioqueue_unregister( pj_ioqueue_key_t *key )
+{
+    PJ_ASSERT_RETURN(key, PJ_EINVAL);
+
+    /* Best effort to avoid double key-unregistration */
+    if (!key->grp_lock || key->closing)
+        return PJ_SUCCESS;
+
+    pj_ioqueue_lock_key(key);
+
+    /* Mark key as closing before closing handle. */
+    key->closing = 1;
+
+    /* Cancel all pending I/O operations (asynchronously). The ops
+     * will be released when their completions arrive.
+     */
+    cancel_all_pending_op(key);
+    flush_sq(key->ioqueue, PJ_TRUE);
+
+    /* io_uring holds its own reference to the file of any in-flight op,
+     * so it is safe to close the socket now.
+     */
+    pj_sock_close(key->fd);
+
+    /* Reset callbacks */
+    key->cb.on_accept_complete = NULL;
+    key->cb.on_connect_complete = NULL;
+    key->cb.on_read_complete = NULL;
+    key->cb.on_write_complete = NULL;
+
+    pj_ioqueue_unlock_key(key);
+
+    TRACE_((THIS_FILE, "UNREG key %p ref cnt %d",
+            key, pj_grp_lock_get_ref(key->grp_lock)));
+
+    /* Decrement reference counter to destroy the key.
+     * If the key has pending op, it will be destroyed only after the op is
+     * cancelled (asynchronously).
+     */
+    decrement_counter(key);
+
+    return PJ_SUCCESS;
+}
+
+/*
+ * Process the completion of an op. Returns non-zero if a callback has
+ * been called.
+ */
+static int dispatch_op(pj_ioqueue_t *ioqueue, struct pending_op *op, int res)
+{
+    pj_ioqueue_key_t *key = op->key;
+    pj_ioqueue_op_key_t *op_key = op->app_op_key;
+    pj_ioqueue_operation_e operation = op->op;
+    pj_bool_t has_lock;
+
+    /* Transient error, resubmit. */
+    if (res == -EAGAIN || res == -EINTR) {
+        pj_status_t status = PJ_ECANCELLED;
+
+        pj_ioqueue_lock_key(key);
+        if (!op->cancelled && !key->closing)
+            status = submit_op(key, op);
+        pj_ioqueue_unlock_key(key);
+        if (status == PJ_SUCCESS)
+            return 0;
+    }
+
+    /* Partial write on stream socket: send the remaining. */
+    if (res > 0 && operation == PJ_IOQUEUE_OP_SEND &&
+        key->fd_type != pj_SOCK_DGRAM() &&
+        op->written + res < (pj_ssize_t)op->size)
+    {
+        pj_status_t status = PJ_ECANCELLED;
+
+        pj_ioqueue_lock_key(key);
+        op->written += res;
+        if (!op->cancelled && !key->closing)
+            status = submit_op(key, op);
+        pj_ioqueue_unlock_key(key);
+        if (status == PJ_SUCCESS)
+            return 0;
+        res = 0;
+    }
+
+    /* We shouldn't call callbacks if key is quitting or op is cancelled. */
+    if (op->cancelled || key->closing) {
+#if PJ_HAS_TCP
+        if (operation == PJ_IOQUEUE_OP_ACCEPT && res >= 0)
+            close(res);
+#endif
+        release_pending_op(key, op);
+        return 0;
+    }
+
+    /* If concurrency is disabled, lock the key
+     * (and save the lock status to local var since app may change
+     * concurrency setting while in the callback) */
+    if (key->allow_concurrent == PJ_FALSE) {
+        pj_ioqueue_lock_key(key);
+        has_lock = PJ_TRUE;
+    } else {
+        has_lock = PJ_FALSE;
+    }
+
+    /* Now that we get the lock, check again that key is not closing */
+    if (op->cancelled || key->closing) {
+        if (has_lock)
+            pj_ioqueue_unlock_key(key);
+#if PJ_HAS_TCP
+        if (operation == PJ_IOQUEUE_OP_ACCEPT && res >= 0)
+            close(res);
+#endif
+        release_pending_op(key, op);
+        return 0;
+    }
+
+    /* Increment reference counter to prevent this key from being
+     * deleted
+     */
+    increment_counter(key);
+
+    /* Carry out the callback */
+    switch (operation) {
+    case PJ_IOQUEUE_OP_RECV:
+    case PJ_IOQUEUE_OP_RECV_FROM:
+        if (operation == PJ_IOQUEUE_OP_RECV_FROM && res >= 0 &&
+            op->app_addrlen)
+        {
+            int len = PJ_MIN((int)op->msg.msg_namelen, *op->app_addrlen);
+            if (op->app_addr)
+                pj_memcpy(op->app_addr, &op->addr, len);
+            *op->app_addrlen = (int)op->msg.msg_namelen;
+        }
+        SET_OPKEY_OPERATION(op_key, PJ_IOQUEUE_OP_NONE);
+        if (key->cb.on_read_complete) {
+            key->cb.on_read_complete(key, op_key, res >= 0 ? res :
+                                     -PJ_STATUS_FROM_OS(-res));
+        }
+        break;
+
+    case PJ_IOQUEUE_OP_SEND:
+    case PJ_IOQUEUE_OP_SEND_TO:
+        pj_ioqueue_lock_key(key);
+        finish_write(key, op);
+        pj_ioqueue_unlock_key(key);
+
+        SET_OPKEY_OPERATION(op_key, PJ_IOQUEUE_OP_NONE);
+        if (key->cb.on_write_complete) {
+            key->cb.on_write_complete(key, op_key, res >= 0 ?
+                                      op->written + res :
+                                      -PJ_STATUS_FROM_OS(-res));
+        }
+        break;
+
+#if PJ_HAS_TCP
+    case PJ_IOQUEUE_OP_ACCEPT:
+        {
+            pj_status_t status = PJ_SUCCESS;
+            pj_sock_t newsock = PJ_INVALID_SOCKET;
+
+            if (res >= 0) {
+                newsock = res;
+                if (op->app_addrlen) {
+                    int len = PJ_MIN((int)op->addrlen, *op->app_addrlen);
+                    if (op->app_addr)
+                        pj_memcpy(op->app_addr, &op->addr, len);
+                    *op->app_addrlen = (int)op->addrlen;
+                }
+                if (op->local_addr) {
+                    status = pj_sock_getsockname(newsock, op->local_addr,
+                                                 op->app_addrlen);
+                    if (status != PJ_SUCCESS) {
+                        pj_sock_close(newsock);
+                        newsock = PJ_INVALID_SOCKET;
+                    }
+                }
+            } else {
+                status = PJ_STATUS_FROM_OS(-res);
+            }
+            if (op->accept_fd)
+                *op->accept_fd = newsock;
+
+            SET_OPKEY_OPERATION(op_key, PJ_IOQUEUE_OP_NONE);
+            if (key->cb.on_accept_complete)
+                key->cb.on_accept_complete(key, op_key, newsock, status);
+            else if (newsock != PJ_INVALID_SOCKET)
+                pj_sock_close(newsock);
+        }
+        break;
+
+    case PJ_IOQUEUE_OP_CONNECT:
+        {
+            pj_status_t status;
+
+            pj_ioqueue_lock_key(key);
+            key->connecting = 0;
+            key->connect_op = NULL;
+            pj_ioqueue_unlock_key(key);
+
+            if (res < 0) {
+                status = PJ_STATUS_FROM_OS(-res);
+            } else {
+                int value;
+                int vallen = sizeof(value);
+                status = pj_sock_getsockopt(key->fd, SOL_SOCKET, SO_ERROR,
+                                            &value, &vallen);
+                if (status == PJ_SUCCESS && value != 0)
+                    status = PJ_STATUS_FROM_OS(value);
+            }
+
+            if (key->cb.on_connect_complete)
+                key->cb.on_connect_complete(key, status);
+        }
+        break;
+#endif
+
+    default:
+        pj_assert(!"Invalid operation");
+        break;
+    }
+
+    if (has_lock)
+        pj_ioqueue_unlock_key(key);
+
+    release_pending_op(key, op);
+    decrement_counter(key);
+
+    return 1;
+}
+
+/* Reap completions from the completion ring. */
+static unsigned reap_cqes(pj_ioqueue_t *ioqueue, struct io_uring_cqe cqes[],
+                          unsigned max_cnt)
+{
+    struct uring_cq *cq = &ioqueue->cq;
+    unsigned head, tail, cnt = 0;
+
+    pj_lock_acquire(ioqueue->cq_lock);
+
+    head = *cq->khead;
+    tail = __atomic_load_n(cq->ktail, __ATOMIC_ACQUIRE);
+    while (head != tail && cnt < max_cnt) {
+        cqes[cnt++] = cq->cqes[head & *cq->kring_mask];
+        ++head;
+    }
+    __atomic_store_n(cq->khead, head, __ATOMIC_RELEASE);
+
+    pj_lock_release(ioqueue->cq_lock);
+
+    return cnt;
+}
+
+/*
+ * pj_ioqueue_poll()
+ *
+ * Poll for events.
+ */
+PJ_DEF(int) pj_ioqueue_poll( pj_ioqueue_t *ioqueue, const pj_time_val *timeout)
+{
+    struct io_uring_cqe cqes[PJ_IOQUEUE_MAX_EVENTS_IN_SINGLE_POLL];
+    unsigned i, cnt;
+    int event_count = 0;
+    void *prev_dispatch;
+
+    PJ_CHECK_STACK();
+    PJ_ASSERT_RETURN(ioqueue, -PJ_EINVAL);
+
+    cnt = reap_cqes(ioqueue, cqes, PJ_ARRAY_SIZE(cqes));
+    if (cnt == 0) {
+        struct io_uring_getevents_arg arg;
+        struct __kernel_timespec ts;
+        unsigned to_submit;
+        int rc;
+
+        /* Submit any pending SQEs and wait for completions in one call. */
+        if (timeout) {
+            ts.tv_sec = timeout->sec;
+            ts.tv_nsec = timeout->msec * 1000000L;
+        } else {
+            ts.tv_sec = 9;
+            ts.tv_nsec = 0;
+        }
+        pj_bzero(&arg, sizeof(arg));
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = (pj_uint64_t)(pj_size_t)&ts;
+
+        to_submit = __atomic_load_n(ioqueue->sq.ktail, __ATOMIC_ACQUIRE) -
+                    __atomic_load_n(ioqueue->sq.khead, __ATOMIC_ACQUIRE);
+
+        rc = sys_io_uring_enter(ioqueue->ring_fd, to_submit, 1,
+                                IORING_ENTER_GETEVENTS |
+                                IORING_ENTER_EXT_ARG,
+                                &arg, sizeof(arg));
+        if (rc < 0 && errno != ETIME && errno != EINTR &&
+            errno != EAGAIN && errno != EBUSY)
+        {
+            pj_status_t status = PJ_RETURN_OS_ERROR(errno);
+            PJ_PERROR(4, (THIS_FILE, status, "io_uring_enter() error"));
+            return -status;
+        }
+
+        cnt = reap_cqes(ioqueue, cqes, PJ_ARRAY_SIZE(cqes));
+        if (cnt == 0)
+            return 0;
+    }
+
+    /* Mark this thread as dispatching, so that SQEs submitted from
+     * the callbacks are flushed together after the loop.
+     */
+    prev_dispatch = pj_thread_local_get(ioqueue->dispatch_tls_id);
+    pj_thread_local_set(ioqueue->dispatch_tls_id, ioqueue);
+
+    for (i=0; i<cnt; ++i) {
+        struct pending_op *op;
+
+        if (cqes[i].user_data == IGNORED_USER_DATA)
+            continue;
+
+        op = (struct pending_op*)(pj_size_t)cqes[i].user_data;
+        event_count += dispatch_op(ioqueue, op, cqes[i].res);
+    }
+
+    pj_thread_local_set(ioqueue->dispatch_tls_id, prev_dispatch);
+
+    if (!prev_dispatch)
+        flush_sq(ioqueue, PJ_TRUE);
+
+    /* Return number of events. */
+    return event_count;
+}
+
+/* Check that op_key is not currently used by a pending op. */
+static pj_bool_t op_key_is_busy(pj_ioqueue_op_key_t *op_key)
+{
+    return OPKEY_OPERATION(op_key) != PJ_IOQUEUE_OP_NONE;
+}
+
+/* Common routine to schedule read operation. */
+static pj_status_t schedule_read(pj_ioqueue_key_t *key,
+                                 pj_ioqueue_op_key_t *op_key,
+                                 pj_ioqueue_operation_e operation,
+                                 void *buffer,
+                                 pj_ssize_t length,
+                                 pj_uint32_t flags,
+                                 pj_sockaddr_t *addr,
+                                 int *addrlen)
+{
+    struct pending_op *op;
+    pj_status_t status;
+
+    pj_ioqueue_lock_key(key);
+
+    /* Check again. Handle may have been closed after the previous check
+     * in multithreaded app.
+     */
+    if (key->closing) {
+        pj_ioqueue_unlock_key(key);
+        return PJ_ECANCELLED;
+    }
+
+    op = alloc_pending_op(key, op_key, operation);
+    if (!op) {
+        pj_ioqueue_unlock_key(key);
+        return PJ_ENOMEM;
+    }
+
+    op->buf = (char*)buffer;
+    op->size = length;
+    op->flags = flags;
+    op->app_addr = addr;
+    op->app_addrlen = addrlen;
+
+    /* Set the operation before the submission as the completion may be
+     * dispatched by another thread right away.
+     */
+    SET_OPKEY_OPERATION(op_key, operation);
+
+    status = submit_op(key, op);
+    if (status != PJ_SUCCESS) {
+        SET_OPKEY_OPERATION(op_key, PJ_IOQUEUE_OP_NONE);
+        release_pending_op(key, op);
+        pj_ioqueue_unlock_key(key);
+        return status;
+    }
+
+    pj_ioqueue_unlock_key(key);
+
+    return PJ_EPENDING;
+}
+
+/*
+ * pj_ioqueue_recv()
+ *
+ * Reads are always submitted to the ring (regardless of
+ * PJ_IOQUEUE_ALWAYS_ASYNC), so that re-arming the read from the callback
+ * does not cost a recv() system call which would fail with EAGAIN most of
+ * the time.
+ */
+PJ_DEF(pj_status_t) pj_ioqueue_recv(  pj_ioqueue_key_t *key,
+                                      pj_ioqueue_op_key_t *op_key,
+                                      void *buffer,
+                                      pj_ssize_t *length,
+                                      pj_uint32_t flags )
+{
+    PJ_CHECK_STACK();
+    PJ_ASSERT_RETURN(key && op_key && buffer && length, PJ_EINVAL);
+
+    /* Check key is not closing */
+    if (key->closing)
+        return PJ_ECANCELLED;
+
+    if (op_key_is_busy(op_key))
+        return PJ_EBUSY;
+
+    flags &= ~(PJ_IOQUEUE_ALWAYS_ASYNC);
+
+    return schedule_read(key, op_key, PJ_IOQUEUE_OP_RECV, buffer, *length,
+                         flags, NULL, NULL);
+}
+
+/*
+ * pj_ioqueue_recvfrom()
+ */
+PJ_DEF(pj_status_t) pj_ioqueue_recvfrom( pj_ioqueue_key_t *key,
+                                         pj_ioqueue_op_key_t *op_key,
+                                         void *buffer,
+                                         pj_ssize_t *length,
+                                         pj_uint32_t flags,
+                                         pj_sockaddr_t *addr,
+                                         int *addrlen)
+{
+    PJ_CHECK_STACK();
+    PJ_ASSERT_RETURN(key && op_key && buffer && length, PJ_EINVAL);
+
+    /* Check key is not closing */
+    if (key->closing)
+        return PJ_ECANCELLED;
+
+    if (op_key_is_busy(op_key))
+        return PJ_EBUSY;
+
+    flags &= ~(PJ_IOQUEUE_ALWAYS_ASYNC);
+
+    return schedule_read(key, op_key, PJ_IOQUEUE_OP_RECV_FROM, buffer,
+                         *length, flags, addr, addrlen);
+}
+
+/*
+ * pj_ioqueue_send()
+ */
+PJ_DEF(pj_status_t) pj_ioqueue_send(  pj_ioqueue_key_t *key,
+                                      pj_ioqueue_op_key_t *op_key,
+                                      const void *data,
+                                      pj_ssize_t *length,
+                                      pj_uint32_t flags )
+{
+    return pj_ioqueue_sendto(key, op_key, data, length, flags, NULL, 0);
+}
+
+
+/*
+ * pj_ioqueue_sendto()
+ */
+PJ_DEF(pj_status_t) pj_ioqueue_sendto( pj_ioqueue_key_t *key,
+                                       pj_ioqueue_op_key_t *op_key,
+                                       const void *data,
+                                       pj_ssize_t *length,
+                                       pj_uint32_t flags,
+                                       const pj_sockaddr_t *addr,
+                                       int addrlen)
+{
+    struct pending_op *op;
+    pj_ioqueue_operation_e operation;
+    pj_status_t status;
+
+    PJ_CHECK_STACK();
+    PJ_ASSERT_RETURN(key && op_key && data && length, PJ_EINVAL);
+
+    /* Check key is not closing */
+    if (key->closing)
+        return PJ_ECANCELLED;
+
+    /* We can not use PJ_IOQUEUE_ALWAYS_ASYNC for socket write. */
+    flags &= ~(PJ_IOQUEUE_ALWAYS_ASYNC);
+
+    /* Fast track:
+     *   Try to send data immediately, only if there's no pending write,
+     *   to preserve the order of the data.
+     */
+    if (key->write_head == NULL) {
+        pj_ssize_t sent = *length;
+
+        if (addr)
+            status = pj_sock_sendto(key->fd, data, &sent, flags,
+                                    addr, addrlen);
+        else
+            status = pj_sock_send(key->fd, data, &sent, flags);
+
+        if (status == PJ_SUCCESS) {
+            *length = sent;
+            return PJ_SUCCESS;
+        } else if (status != PJ_STATUS_FROM_OS(PJ_BLOCKING_ERROR_VAL)) {
+            return status;
+        }
+    }
+
+    /* Schedule asynchronous send. */
+    if (op_key_is_busy(op_key))
+        return PJ_EBUSY;
+
+    PJ_ASSERT_RETURN(!addr || addrlen <= (int)sizeof(pj_sockaddr),
+                     PJ_EINVAL);
+
+    operation = addr ? PJ_IOQUEUE_OP_SEND_TO : PJ_IOQUEUE_OP_SEND;
+
+    pj_ioqueue_lock_key(key);
+
+    if (key->closing) {
+        pj_ioqueue_unlock_key(key);
+        return PJ_ECANCELLED;
+    }
+
+    op = alloc_pending_op(key, op_key, operation);
+    if (!op) {
+        pj_ioqueue_unlock_key(key);
+        return PJ_ENOMEM;
+    }
+
+    op->buf = (char*)data;
+    op->size = *length;
+    op->flags = flags;
+    if (addr) {
+        pj_memcpy(&op->addr, addr, addrlen);
+        op->addrlen = addrlen;
+    }
+
+    SET_OPKEY_OPERATION(op_key, operation);
+
+    /* Queue the write, only the head of the queue is in progress. */
+    if (key->write_tail)
+        key->write_tail->next_write = op;
+    else
+        key->write_head = op;
+    key->write_tail = op;
+
+    if (key->write_head != op && key->write_head->submitted) {
+        pj_ioqueue_unlock_key(key);
+        return PJ_EPENDING;
+    }
+    op = key->write_head;
+
+    status = submit_op(key, op);
+    if (status != PJ_SUCCESS) {
+        if (op->app_op_key == op_key) {
+            finish_write(key, op);
+            SET_OPKEY_OPERATION(op_key, PJ_IOQUEUE_OP_NONE);
+            release_pending_op(key, op);
+            pj_ioqueue_unlock_key(key);
+            return status;
+        }
+        /* Failed to submit an earlier queued write. Our write stays
+         * queued and will be retried with the next write.
+         */
+        PJ_PERROR(3, (THIS_FILE, status, "Error submitting queued write "
+                      "of key %p", key));
+    }
+
+    pj_ioqueue_unlock_key(key);
+
+    return PJ_EPENDING;
+}
+
+#if PJ_HAS_TCP
+/*
+ * pj_ioqueue_accept()
+ */
+PJ_DEF(pj_status_t) pj_ioqueue_accept( pj_ioqueue_key_t *key,
+                                       pj_ioqueue_op_key_t *op_key,
+                                       pj_sock_t *new_sock,
+                                       pj_sockaddr_t *local,
+                                       pj_sockaddr_t *remote,
+                                       int *addrlen)
+{
+    struct pending_op *op;
+    pj_status_t status;
+
+    PJ_CHECK_STACK();
+    PJ_ASSERT_RETURN(key && op_key && new_sock, PJ_EINVAL);
+
+    /* Check key is not closing */
+    if (key->closing)
+        return PJ_ECANCELLED;
+
+    if (op_key_is_busy(op_key))
+        return PJ_EBUSY;
+
+    /* See if there is a new connection immediately available. */
+    status = pj_sock_accept(key->fd, new_sock, remote, addrlen);
+    if (status == PJ_SUCCESS) {
+        /* Yes! New socket is available! */
+        if (local && addrlen) {
+            status = pj_sock_getsockname(*new_sock, local, addrlen);
+            if (status != PJ_SUCCESS) {
+                pj_sock_close(*new_sock);
+                *new_sock = PJ_INVALID_SOCKET;
+                return status;
+            }
+        }
+        return PJ_SUCCESS;
+    } else if (status != PJ_STATUS_FROM_OS(PJ_BLOCKING_ERROR_VAL)) {
+        return status;
+    }
+
+    /* No connection is immediately available. Schedule accept. */
+    pj_ioqueue_lock_key(key);
+
+    if (key->closing) {
+        pj_ioqueue_unlock_key(key);
+        return PJ_ECANCELLED;
+    }
+
+    op = alloc_pending_op(key, op_key, PJ_IOQUEUE_OP_ACCEPT);
+    if (!op) {
+        pj_ioqueue_unlock_key(key);
+        return PJ_ENOMEM;
+    }
+
+    op->accept_fd = new_sock;
+    op->app_addr = remote;
+    op->app_addrlen = addrlen;
+    op->local_addr = local;
+
+    SET_OPKEY_OPERATION(op_key, PJ_IOQUEUE_OP_ACCEPT);
+
+    status = submit_op(key, op);
+    if (status != PJ_SUCCESS) {
+        SET_OPKEY_OPERATION(op_key, PJ_IOQUEUE_OP_NONE);
+        release_pending_op(key, op);
+        pj_ioqueue_unlock_key(key);
+        return status;
+    }
+
+    pj_ioqueue_unlock_key(key);
+
+    return PJ_EPENDING;
+}
+
+/*
+ * pj_ioqueue_connect()
+ */
+PJ_DEF(pj_status_t) pj_ioqueue_connect( pj_ioqueue_key_t *key,
+                                        const pj_sockaddr_t *addr,
+                                        int addrlen )
+{
+    struct pending_op *op;
+    pj_status_t status;
+
+    PJ_CHECK_STACK();
+    PJ_ASSERT_RETURN(key && addr && addrlen, PJ_EINVAL);
+
+    /* Check key is not closing */
+    if (key->closing)
+        return PJ_ECANCELLED;
+
+    /* Check if socket has not been marked for connecting */
+    if (key->connecting != 0)
+        return PJ_EPENDING;
+
+    status = pj_sock_connect(key->fd, addr, addrlen);
+    if (status == PJ_SUCCESS) {
+        /* Connected! */
+        return PJ_SUCCESS;
+    } else if (status != PJ_STATUS_FROM_OS(PJ_BLOCKING_CONNECT_ERROR_VAL)) {
+        return status;
+    }
+
+    /* Pending! Wait until the socket is writable. */
+    pj_ioqueue_lock_key(key);
+
+    if (key->closing) {
+        pj_ioqueue_unlock_key(key);
+        return PJ_ECANCELLED;
+    }
+
+    op = alloc_pending_op(key, NULL, PJ_IOQUEUE_OP_CONNECT);
+    if (!op) {
+        pj_ioqueue_unlock_key(key);
+        return PJ_ENOMEM;
+    }
+
+    key->connecting = 1;
+    key->connect_op = op;
+
+    status = submit_op(key, op);
+    if (status != PJ_SUCCESS) {
+        key->connecting = 0;
+        key->connect_op = NULL;
+        release_pending_op(key, op);
+        pj_ioqueue_unlock_key(key);
+        return status;
+    }
+
+    pj_ioqueue_unlock_key(key);
+
+    return PJ_EPENDING;
+}
+#endif  /* PJ_HAS_TCP */
+
+
+PJ_DEF(void) pj_ioqueue_op_key_init( pj_ioqueue_op_key_t *op_key,
+                                     pj_size_t size )
+{
+    pj_bzero(op_key, size);
+}
+
+PJ_DEF(pj_bool_t) pj_ioqueue_is_pending( pj_ioqueue_key_t *key,
+                                         pj_ioqueue_op_key_t *op_key )
+{
+    PJ_UNUSED_ARG(key);
+    return op_key_is_busy(op_key);
+}
+
+/*
+ * pj_ioqueue_post_completion()
+ *
+ * As with the other backends, the callback is called from this function.
+ * The op is cancelled in the kernel and its completion will be ignored.
+ */
+PJ_DEF(pj_status_t) pj_ioqueue_post_completion( pj_ioqueue_key_t *key,
+                                                pj_ioqueue_op_key_t *op_key,
+                                                pj_ssize_t bytes_status )
+{
+    struct pending_op *op;
+    pj_ioqueue_operation_e operation;
+
+    PJ_ASSERT_RETURN(key && op_key, PJ_EINVAL);
+
+    pj_ioqueue_lock_key(key);
+
+    op = get_pending_op(op_key);
+    if (!op_key_is_busy(op_key) || !op || op->key != key ||
+        op->app_op_key != op_key || op->cancelled)
+    {
+#if PJ_HAS_TCP
+        /* Clear connecting operation. */
+        if (key->connect_op)
+            cancel_op(key, key->connect_op);
+        flush_sq(key->ioqueue, PJ_TRUE);
+#endif
+        pj_ioqueue_unlock_key(key);
+        return PJ_EINVALIDOP;
+    }
+
+    operation = op->op;
+    SET_OPKEY_OPERATION(op_key, PJ_IOQUEUE_OP_NONE);
+    cancel_op(key, op);
+    flush_sq(key->ioqueue, PJ_TRUE);
+
+    pj_ioqueue_unlock_key(key);
+
+    switch (operation) {
+    case PJ_IOQUEUE_OP_RECV:
+    case PJ_IOQUEUE_OP_RECV_FROM:
+        if (key->cb.on_read_complete)
+            (*key->cb.on_read_complete)(key, op_key, bytes_status);
+        break;
+    case PJ_IOQUEUE_OP_SEND:
+    case PJ_IOQUEUE_OP_SEND_TO:
+        if (key->cb.on_write_complete)
+            (*key->cb.on_write_complete)(key, op_key, bytes_status);
+        break;
+#if PJ_HAS_TCP
+    case PJ_IOQUEUE_OP_ACCEPT:
+        if (key->cb.on_accept_complete) {
+            (*key->cb.on_accept_complete)(key, op_key, PJ_INVALID_SOCKET,
+                                          (pj_status_t)bytes_status);
+        }
+        break;
+#endif
+    default:
+        break;
+    }
+
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(pj_status_t) pj_ioqueue_clear_key( pj_ioqueue_key_t *key )
+{
+    PJ_ASSERT_RETURN(key, PJ_EINVAL);
+
+    pj_ioqueue_lock_key(key);
+    cancel_all_pending_op(key);
+    flush_sq(key->ioqueue, PJ_TRUE);
+    pj_ioqueue_unlock_key(key);
+
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(pj_status_t) pj_ioqueue_set_concurrency(pj_ioqueue_key_t *key,
+                                               pj_bool_t allow)
+{
+    PJ_ASSERT_RETURN(key, PJ_EINVAL);
+
+    /* PJ_IOQUEUE_HAS_SAFE_UNREG must be enabled if concurrency is
+     * disabled.
+     */
+    PJ_ASSERT_RETURN(allow || PJ_IOQUEUE_HAS_SAFE_UNREG, PJ_EINVAL);
+
+    key->allow_concurrent = allow;
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(pj_status_t) pj_ioqueue_lock_key(pj_ioqueue_key_t *key)
+{
+    PJ_ASSERT_RETURN(key && key->grp_lock, PJ_EINVAL);
+    return pj_grp_lock_acquire(key->grp_lock);
+}
+
+PJ_DEF(pj_status_t) pj_ioqueue_trylock_key(pj_ioqueue_key_t *key)
+{
+    PJ_ASSERT_RETURN(key && key->grp_lock, PJ_EINVAL);
+    return pj_grp_lock_tryacquire(key->grp_lock);
+}
+
+PJ_DEF(pj_status_t) pj_ioqueue_unlock_key(pj_ioqueue_key_t *key)
+{
+    PJ_ASSERT_RETURN(key && key->grp_lock, PJ_EINVAL);
+    return pj_grp_lock_release(key->grp_lock);
+}
+
+PJ_DEF(pj_oshandle_t) pj_ioqueue_get_os_handle( pj_ioqueue_t *ioqueue )
+{
+    return ioqueue ? (pj_oshandle_t)&ioqueue->ring_fd : NULL;
+}
+
+
+#endif /* PJ_IOQUEUE_IMP == PJ_IOQUEUE_IMP_IO_URING */
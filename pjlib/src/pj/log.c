@@ -20,10 +20,32 @@
 #include <pj/log.h>
 #include <pj/string.h>
 #include <pj/os.h>
+#include <pj/assert.h>
+#include <pj/errno.h>
+#include <pj/file_io.h>
+#include <pj/pool.h>
+#include <pj/ring.h>
 #include <pj/compat/stdarg.h>
 
+#define THIS_FILE       "log.c"
+
+PJ_DEF(void) pj_log_async_param_default(pj_log_async_param *prm)
+{
+    pj_bzero(prm, sizeof(*prm));
+    prm->queue_size = PJ_LOG_ASYNC_QUEUE_SIZE;
+    prm->drop_on_overflow = PJ_TRUE;
+    prm->file_buf_size = 65536;
+}
+
 #if PJ_LOG_MAX_LEVEL >= 1
 
+/* The asynchronous writer needs threads and the __atomic builtins */
+#if PJ_HAS_THREADS && (defined(__GNUC__) || defined(__clang__))
+#   define LOG_HAS_ASYNC    1
+#else
+#   define LOG_HAS_ASYNC    0
+#endif
+
 #if 0
 PJ_DEF_DATA(int) pj_log_max_level = PJ_LOG_MAX_LEVEL;
 #else
@@ -335,30 +357,17 @@ static pj_bool_t is_logging_suspended(void)
     }
 }
 
-PJ_DEF(void) pj_log( const char *sender, int level, 
-                     const char *format, va_list marker)
+/* Format the message with the current decoration into log_buffer, which
+ * is PJ_LOG_MAX_SIZE bytes long. Logging must have been suspended by the
+ * caller. Returns the message length.
+ */
+static int log_format(char *log_buffer, const char *sender, int *level,
+                      const char *format, va_list marker)
 {
     pj_time_val now;
     pj_parsed_time ptime;
     char *pre;
-#if PJ_LOG_USE_STACK_BUFFER
-    char log_buffer[PJ_LOG_MAX_SIZE];
-#endif
-    int saved_level, len, print_len;
-
-    PJ_CHECK_STACK();
-
-    if (level > pj_log_max_level)
-        return;
-
-    if (is_logging_suspended())
-        return;
-
-    /* Temporarily disable logging for this thread. Some of PJLIB APIs that
-     * this function calls below will recursively call the logging function 
-     * back, hence it will cause infinite recursive calls if we allow that.
-     */
-    suspend_logging(&saved_level);
+    int len, print_len;
 
     /* Get current date/time. */
     pj_gettimeofday(&now);
@@ -368,7 +377,7 @@ PJ_DEF(void) pj_log( const char *sender, int level,
     if (log_decor & PJ_LOG_HAS_LEVEL_TEXT) {
         static const char *ltexts[] = { "FATAL:", "ERROR:", " WARN:", 
                               " INFO:", "DEBUG:", "TRACE:", "DETRC:"};
-        pj_ansi_strxcpy(pre, ltexts[level], PJ_LOG_MAX_SIZE);
+        pj_ansi_strxcpy(pre, ltexts[*level], PJ_LOG_MAX_SIZE);
         pre += 6;
     }
     if (log_decor & PJ_LOG_HAS_DAY_NAME) {
@@ -461,18 +470,18 @@ PJ_DEF(void) pj_log( const char *sender, int level,
     len = (int)(pre - log_buffer);
 
     /* Print the whole message to the string log_buffer. */
-    print_len = pj_ansi_vsnprintf(pre, sizeof(log_buffer)-len, format, 
+    print_len = pj_ansi_vsnprintf(pre, PJ_LOG_MAX_SIZE-len, format, 
                                   marker);
     if (print_len < 0) {
-        level = 1;
-        print_len = pj_ansi_snprintf(pre, sizeof(log_buffer)-len, 
+        *level = 1;
+        print_len = pj_ansi_snprintf(pre, PJ_LOG_MAX_SIZE-len, 
                                      "<logging error: msg too long>");
     }
-    if (print_len < 0 || print_len >= (int)(sizeof(log_buffer)-len)) {
-        print_len = sizeof(log_buffer) - len - 1;
+    if (print_len < 0 || print_len >= (int)(PJ_LOG_MAX_SIZE-len)) {
+        print_len = PJ_LOG_MAX_SIZE - len - 1;
     }
     len = len + print_len;
-    if (len >= 0 && len < (int)sizeof(log_buffer)-2) {
+    if (len >= 0 && len < PJ_LOG_MAX_SIZE-2) {
         if (log_decor & PJ_LOG_HAS_CR) {
             log_buffer[len++] = '\r';
         }
@@ -481,15 +490,416 @@ PJ_DEF(void) pj_log( const char *sender, int level,
         }
         log_buffer[len] = '\0';
     } else {
-        len = sizeof(log_buffer)-1;
+        len = PJ_LOG_MAX_SIZE-1;
         if (log_decor & PJ_LOG_HAS_CR) {
-            log_buffer[sizeof(log_buffer)-3] = '\r';
+            log_buffer[PJ_LOG_MAX_SIZE-3] = '\r';
         }
         if (log_decor & PJ_LOG_HAS_NEWLINE) {
-            log_buffer[sizeof(log_buffer)-2] = '\n';
+            log_buffer[PJ_LOG_MAX_SIZE-2] = '\n';
+        }
+        log_buffer[PJ_LOG_MAX_SIZE-1] = '\0';
+    }
+
+    return len;
+}
+
+/*
+ * Asynchronous log writer.
+ *
+ * Every queue entry holds one formatted message. The indexes of the entries
+ * travel between two lock-free rings: logging threads take a free entry,
+ * format the message straight into it and queue it to the writer thread,
+ * which writes it and gives the entry back. The writer only sleeps on the
+ * semaphore after announcing it in "sleeping", so logging threads don't
+ * need to touch the semaphore while the writer is busy.
+ */
+#if LOG_HAS_ASYNC
+
+/* Number of entries the writer takes from the queue in one go */
+#define LOG_ASYNC_BATCH     32
+
+#define ATOMIC_LOAD(p)      __atomic_load_n(p, __ATOMIC_SEQ_CST)
+#define ATOMIC_STORE(p, v)  __atomic_store_n(p, v, __ATOMIC_SEQ_CST)
+#define ATOMIC_INC(p)       __atomic_add_fetch(p, 1, __ATOMIC_SEQ_CST)
+#define ATOMIC_DEC(p)       __atomic_sub_fetch(p, 1, __ATOMIC_SEQ_CST)
+#define FULL_FENCE()        __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+typedef struct log_entry
+{
+    int                  level;
+    int                  len;
+    char                 buf[PJ_LOG_MAX_SIZE];
+} log_entry;
+
+typedef struct log_async
+{
+    pj_log_async_param   prm;
+    log_entry           *entries;
+    pj_ring_t           *free_q;        /* Indexes of free entries      */
+    pj_ring_t           *pending_q;     /* Indexes of queued messages   */
+    pj_sem_t            *sem;
+    pj_thread_t         *thread;
+    int                  sleeping;      /* Writer is about to wait      */
+    int                  quit;
+    char                *file_buf;
+    unsigned             file_len;
+    log_entry            notice;        /* For the "dropped" message    */
+    pj_size_t            dropped_reported;
+    pj_log_async_stat    stat;
+} log_async;
+
+static log_async *g_async;
+
+/* Number of threads inside log_async_put(), so that pj_log_async_stop()
+ * knows when nobody uses the queue anymore.
+ */
+static int g_async_users;
+
+/* Statistics of the last asynchronous writer */
+static pj_log_async_stat g_async_last_stat;
+static pj_bool_t g_async_has_stat;
+
+static void log_async_wake(log_async *la)
+{
+    int sleeping = 1;
+
+    /* Pairs with the fence in the writer thread: either the writer sees
+     * the message, or we see that it's sleeping.
+     */
+    FULL_FENCE();
+    if (__atomic_load_n(&la->sleeping, __ATOMIC_RELAXED) &&
+        __atomic_compare_exchange_n(&la->sleeping, &sleeping, 0, 0,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+    {
+        pj_sem_post(la->sem);
+    }
+}
+
+/* Queue the message to the writer thread. Returns PJ_FALSE if the caller
+ * should write the message itself.
+ */
+static pj_bool_t log_async_put(const char *sender, int level,
+                               const char *format, va_list marker)
+{
+    log_async *la;
+    log_entry *e;
+    unsigned idx;
+
+    if (__atomic_load_n(&g_async, __ATOMIC_RELAXED) == NULL)
+        return PJ_FALSE;
+
+    ATOMIC_INC(&g_async_users);
+    la = ATOMIC_LOAD(&g_async);
+    if (la == NULL ||
+        (pj_thread_is_registered() && pj_thread_this() == la->thread))
+    {
+        ATOMIC_DEC(&g_async_users);
+        return PJ_FALSE;
+    }
+
+    while (pj_ring_pop(la->free_q, &idx) != PJ_SUCCESS) {
+        if (la->prm.drop_on_overflow) {
+            __atomic_add_fetch(&la->stat.dropped, 1, __ATOMIC_RELAXED);
+            ATOMIC_DEC(&g_async_users);
+            return PJ_TRUE;
         }
-        log_buffer[sizeof(log_buffer)-1] = '\0';
+        log_async_wake(la);
+        pj_thread_sleep(1);
+    }
+
+    e = &la->entries[idx];
+    e->level = level;
+    e->len = log_format(e->buf, sender, &e->level, format, marker);
+
+    /* Can't fail, the ring has room for all entries */
+    pj_ring_push(la->pending_q, &idx);
+    log_async_wake(la);
+
+    ATOMIC_DEC(&g_async_users);
+    return PJ_TRUE;
+}
+
+static void log_async_flush(log_async *la)
+{
+    pj_ssize_t size = la->file_len;
+
+    if (size == 0)
+        return;
+
+    pj_file_write(la->prm.file, la->file_buf, &size);
+    pj_file_flush(la->prm.file);
+    la->file_len = 0;
+}
+
+static void log_async_write(log_async *la, const log_entry *e)
+{
+    if (la->prm.file) {
+        if (la->file_len + e->len > la->prm.file_buf_size)
+            log_async_flush(la);
+        pj_memcpy(la->file_buf + la->file_len, e->buf, e->len);
+        la->file_len += e->len;
+    } else if (log_writer) {
+        (*log_writer)(e->level, e->buf, e->len);
     }
+}
+
+static int log_format2(char *log_buffer, const char *sender, int *level,
+                       const char *format, ...)
+{
+    va_list arg;
+    int len;
+
+    va_start(arg, format);
+    len = log_format(log_buffer, sender, level, format, arg);
+    va_end(arg);
+    return len;
+}
+
+/* Tell about the messages dropped since the last notice */
+static void log_async_report_dropped(log_async *la)
+{
+    pj_size_t dropped;
+    int saved_level;
+
+    dropped = __atomic_load_n(&la->stat.dropped, __ATOMIC_RELAXED);
+    if (dropped == la->dropped_reported)
+        return;
+
+    suspend_logging(&saved_level);
+    la->notice.level = 2;
+    la->notice.len = log_format2(la->notice.buf, THIS_FILE,
+                                 &la->notice.level,
+                                 "Log queue full, %lu message(s) dropped",
+                                 (unsigned long)
+                                 (dropped - la->dropped_reported));
+    resume_logging(&saved_level);
+
+    log_async_write(la, &la->notice);
+    la->dropped_reported = dropped;
+}
+
+static int log_async_thread(void *arg)
+{
+    log_async *la = (log_async*)arg;
+    unsigned idx[LOG_ASYNC_BATCH];
+
+    for (;;) {
+        unsigned i, n, pending;
+        int quit;
+
+        /* Nothing is queued anymore once quit is set, so the queue is
+         * drained when the pop below comes back empty.
+         */
+        quit = ATOMIC_LOAD(&la->quit);
+
+        n = pj_ring_pop_n(la->pending_q, idx, LOG_ASYNC_BATCH);
+        if (n == 0) {
+            log_async_report_dropped(la);
+            if (la->prm.file)
+                log_async_flush(la);
+
+            if (quit)
+                break;
+
+            ATOMIC_STORE(&la->sleeping, 1);
+            FULL_FENCE();
+            if (pj_ring_size(la->pending_q) == 0 && !ATOMIC_LOAD(&la->quit))
+                pj_sem_wait(la->sem);
+            ATOMIC_STORE(&la->sleeping, 0);
+            continue;
+        }
+
+        pending = n + pj_ring_size(la->pending_q);
+        if (pending > la->stat.max_pending)
+            la->stat.max_pending = pending;
+
+        for (i = 0; i < n; ++i) {
+            log_async_write(la, &la->entries[idx[i]]);
+            pj_ring_push(la->free_q, &idx[i]);
+        }
+        __atomic_add_fetch(&la->stat.written, n, __ATOMIC_RELAXED);
+    }
+
+    return 0;
+}
+
+static void log_async_destroy(log_async *la)
+{
+    if (la->thread)
+        pj_thread_destroy(la->thread);
+    if (la->sem)
+        pj_sem_destroy(la->sem);
+    if (la->pending_q)
+        pj_ring_destroy(la->pending_q);
+    if (la->free_q)
+        pj_ring_destroy(la->free_q);
+}
+
+PJ_DEF(pj_status_t) pj_log_async_start(pj_pool_t *pool,
+                                       const pj_log_async_param *prm)
+{
+    pj_log_async_param def_prm;
+    log_async *la;
+    unsigned i, count;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(pool, PJ_EINVAL);
+
+    if (!prm) {
+        pj_log_async_param_default(&def_prm);
+        prm = &def_prm;
+    }
+    PJ_ASSERT_RETURN(prm->queue_size, PJ_EINVAL);
+
+    if (ATOMIC_LOAD(&g_async))
+        return PJ_EEXISTS;
+
+    la = PJ_POOL_ZALLOC_T(pool, log_async);
+    pj_memcpy(&la->prm, prm, sizeof(*prm));
+
+    status = pj_ring_create(pool, PJ_RING_MPMC, prm->queue_size,
+                            sizeof(unsigned), &la->free_q);
+    if (status != PJ_SUCCESS)
+        goto on_error;
+
+    count = pj_ring_capacity(la->free_q);
+    status = pj_ring_create(pool, PJ_RING_MPMC, count, sizeof(unsigned),
+                            &la->pending_q);
+    if (status != PJ_SUCCESS)
+        goto on_error;
+
+    la->entries = (log_entry*)pj_pool_alloc(pool, count * sizeof(log_entry));
+    for (i = 0; i < count; ++i)
+        pj_ring_push(la->free_q, &i);
+
+    if (prm->file) {
+        if (la->prm.file_buf_size < PJ_LOG_MAX_SIZE)
+            la->prm.file_buf_size = PJ_LOG_MAX_SIZE;
+        la->file_buf = (char*)pj_pool_alloc(pool, la->prm.file_buf_size);
+    }
+
+    status = pj_sem_create(pool, "logasync", 0, count + 1, &la->sem);
+    if (status != PJ_SUCCESS)
+        goto on_error;
+
+    status = pj_thread_create(pool, "logwriter", &log_async_thread, la,
+                              0, 0, &la->thread);
+    if (status != PJ_SUCCESS)
+        goto on_error;
+
+    ATOMIC_STORE(&g_async, la);
+    return PJ_SUCCESS;
+
+on_error:
+    log_async_destroy(la);
+    return status;
+}
+
+PJ_DEF(pj_status_t) pj_log_async_stop(void)
+{
+    log_async *la = ATOMIC_LOAD(&g_async);
+
+    if (!la || !__atomic_compare_exchange_n(&g_async, &la, NULL, 0,
+                                            __ATOMIC_SEQ_CST,
+                                            __ATOMIC_SEQ_CST))
+    {
+        return PJ_EINVALIDOP;
+    }
+
+    /* New messages are written synchronously from now on. Wait for the
+     * threads that are still putting messages into the queue, then let
+     * the writer drain the queue and quit.
+     */
+    while (ATOMIC_LOAD(&g_async_users))
+        pj_thread_sleep(1);
+
+    ATOMIC_STORE(&la->quit, 1);
+    pj_sem_post(la->sem);
+    pj_thread_join(la->thread);
+
+    g_async_last_stat = la->stat;
+    g_async_has_stat = PJ_TRUE;
+
+    log_async_destroy(la);
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(pj_status_t) pj_log_async_get_stat(pj_log_async_stat *stat)
+{
+    log_async *la;
+
+    PJ_ASSERT_RETURN(stat, PJ_EINVAL);
+
+    ATOMIC_INC(&g_async_users);
+    la = ATOMIC_LOAD(&g_async);
+    if (la) {
+        stat->written = __atomic_load_n(&la->stat.written,
+                                        __ATOMIC_RELAXED);
+        stat->dropped = __atomic_load_n(&la->stat.dropped,
+                                        __ATOMIC_RELAXED);
+        stat->max_pending = la->stat.max_pending;
+    } else if (g_async_has_stat) {
+        *stat = g_async_last_stat;
+    }
+    ATOMIC_DEC(&g_async_users);
+
+    return (la || g_async_has_stat) ? PJ_SUCCESS : PJ_EINVALIDOP;
+}
+
+#else   /* LOG_HAS_ASYNC */
+
+PJ_DEF(pj_status_t) pj_log_async_start(pj_pool_t *pool,
+                                       const pj_log_async_param *prm)
+{
+    PJ_UNUSED_ARG(pool);
+    PJ_UNUSED_ARG(prm);
+    return PJ_ENOTSUP;
+}
+
+PJ_DEF(pj_status_t) pj_log_async_stop(void)
+{
+    return PJ_EINVALIDOP;
+}
+
+PJ_DEF(pj_status_t) pj_log_async_get_stat(pj_log_async_stat *stat)
+{
+    PJ_UNUSED_ARG(stat);
+    return PJ_EINVALIDOP;
+}
+
+#endif  /* LOG_HAS_ASYNC */
+
+PJ_DEF(void) pj_log( const char *sender, int level, 
+                     const char *format, va_list marker)
+{
+#if PJ_LOG_USE_STACK_BUFFER
+    char log_buffer[PJ_LOG_MAX_SIZE];
+#endif
+    int saved_level, len;
+
+    PJ_CHECK_STACK();
+
+    if (level > pj_log_max_level)
+        return;
+
+    if (is_logging_suspended())
+        return;
+
+    /* Temporarily disable logging for this thread. Some of PJLIB APIs that
+     * this function calls below will recursively call the logging function 
+     * back, hence it will cause infinite recursive calls if we allow that.
+     */
+    suspend_logging(&saved_level);
+
+#if LOG_HAS_ASYNC
+    /* Hand the message to the writer thread, if it's running */
+    if (log_async_put(sender, level, format, marker)) {
+        resume_logging(&saved_level);
+        return;
+    }
+#endif
+
+    len = log_format(log_buffer, sender, &level, format, marker);
 
     /* It should be safe to resume logging at this point. Application can
      * recursively call the logging function inside the callback.
@@ -31,6 +31,7 @@
 #include <pj/rand.h>
 #include <pj/string.h>
 #include <pj/guid.h>
+#include <pj/hash.h>
 #include <pj/except.h>
 #include <pj/errno.h>
 
@@ -235,6 +236,9 @@ PJ_DEF(pj_status_t) pj_init(void)
     }
 #endif
 
+    /* Random key for the hash function. Needs the timestamp. */
+    pj_hash_init();
+
     /* Flag PJLIB as initialized */
     ++initialized;
     pj_assert(initialized == 1);
@@ -712,6 +716,9 @@ static void *thread_main(void *param)
     /* Call user's entry! */
     result = (void*)(long)(*rec->proc)(rec->arg);
 
+    /* Give back the pools cached by this thread */
+    pj_caching_pool_on_thread_exit();
+
     /* Done. */
     PJ_LOG(6,(rec->obj_name, "Thread quitting"));
 
@@ -21,6 +21,7 @@
 #include <pj/log.h>
 #include <pj/string.h>
 #include <pj/guid.h>
+#include <pj/hash.h>
 #include <pj/rand.h>
 #include <pj/assert.h>
 #include <pj/errno.h>
@@ -226,6 +227,9 @@ PJ_DEF(pj_status_t) pj_init(void)
     }
 #endif
 
+    /* Random key for the hash function. Needs the timestamp. */
+    pj_hash_init();
+
     /* Flag PJLIB as initialized */
     ++initialized;
     pj_assert(initialized == 1);
@@ -558,6 +562,9 @@ static DWORD WINAPI thread_main(void *param)
 
     result = (*rec->proc)(rec->arg);
 
+    /* Give back the pools cached by this thread */
+    pj_caching_pool_on_thread_exit();
+
     PJ_LOG(6,(rec->obj_name, "Thread quitting"));
 #if defined(PJ_OS_HAS_CHECK_STACK) && PJ_OS_HAS_CHECK_STACK!=0
     PJ_LOG(5,(rec->obj_name, "Thread stack max usage=%u by %s:%d", 
@@ -50,6 +50,74 @@ static pj_size_t pool_sizes[PJ_CACHING_POOL_ARRAY_SIZE] =
  */
 #define START_SIZE  5
 
+/* Thread magazines: each thread keeps a few released pools of the small
+ * size classes (up to pool_sizes[MAG_MAX_IDX]) to be reused without taking
+ * the caching pool's lock. Magazines are refilled from and spilled to the
+ * free lists in batches. The used count is then updated atomically, which
+ * needs compiler support.
+ */
+#define MAG_MAX_IDX     START_SIZE
+#define MAG_CACHED      0x100
+
+#if PJ_HAS_THREADS && PJ_CACHING_POOL_MAGAZINE_SIZE > 0 && !PJ_SAFE_POOL && \
+    (defined(__GNUC__) || defined(__clang__))
+#   define CPOOL_HAS_MAGAZINE   1
+#   define USED_COUNT_INC(cp)   __atomic_add_fetch(&(cp)->used_count, 1, \
+                                                   __ATOMIC_RELAXED)
+#   define USED_COUNT_DEC(cp)   __atomic_sub_fetch(&(cp)->used_count, 1, \
+                                                   __ATOMIC_RELAXED)
+#else
+#   define CPOOL_HAS_MAGAZINE   0
+#   define USED_COUNT_INC(cp)   ++(cp)->used_count
+#   define USED_COUNT_DEC(cp)   --(cp)->used_count
+#endif
+
+#if CPOOL_HAS_MAGAZINE
+typedef struct cpool_magazine
+{
+    PJ_DECL_LIST_MEMBER(struct cpool_magazine);
+
+    /** Maximum number of pools in each size class, from magazine_size. */
+    unsigned     size;
+
+    /** Number of pools in each size class. */
+    unsigned     cnt[MAG_MAX_IDX+1];
+
+    /** The pools, used as a stack. */
+    pj_pool_t   *pool[MAG_MAX_IDX+1][PJ_CACHING_POOL_MAGAZINE_SIZE];
+} cpool_magazine;
+
+/* Caching pools that have thread magazines, so that the magazines of an
+ * exiting thread can be flushed. Protected by pj_enter_critical_section().
+ */
+static pj_caching_pool_node mag_cpool_list = { &mag_cpool_list,
+                                               &mag_cpool_list, NULL };
+
+/* Free capacity accounting. The capacity counts the pools kept in the free
+ * lists and in the thread magazines, and the magazines update it without
+ * the lock.
+ */
+#   define CAPACITY_ADD(cp,sz)  __atomic_add_fetch(&(cp)->capacity, sz, \
+                                                   __ATOMIC_RELAXED)
+#   define CAPACITY_SUB(cp,sz)  __atomic_sub_fetch(&(cp)->capacity, sz, \
+                                                   __ATOMIC_RELAXED)
+#else
+#   define CAPACITY_ADD(cp,sz)  ((cp)->capacity += (sz))
+#   define CAPACITY_SUB(cp,sz)  ((cp)->capacity -= (sz))
+#endif
+
+/* Add a released pool to the free capacity, unless that would exceed
+ * max_capacity, in which case the pool must be destroyed instead.
+ */
+static pj_bool_t capacity_reserve(pj_caching_pool *cp, pj_size_t size)
+{
+    if (CAPACITY_ADD(cp, size) > cp->max_capacity) {
+        CAPACITY_SUB(cp, size);
+        return PJ_FALSE;
+    }
+    return PJ_TRUE;
+}
+
 
 PJ_DEF(void) pj_caching_pool_init( pj_caching_pool *cp, 
                                    const pj_pool_factory_policy *policy,
@@ -90,6 +158,22 @@ PJ_DEF(void) pj_caching_pool_init( pj_caching_pool *cp,
     /* This mostly serves to silent coverity warning about unchecked 
      * return value. There's not much we can do if it fails. */
     PJ_ASSERT_ON_FAIL(status==PJ_SUCCESS, return);
+
+    pj_list_init(&cp->mag_list);
+    pj_list_init(&cp->mag_node);
+    cp->mag_node.cp = cp;
+    cp->mag_tls_id = -1;
+#if CPOOL_HAS_MAGAZINE
+    if (pj_thread_local_alloc(&cp->mag_tls_id) == PJ_SUCCESS) {
+        cp->magazine_size = PJ_CACHING_POOL_MAGAZINE_SIZE;
+
+        pj_enter_critical_section();
+        pj_list_push_back(&mag_cpool_list, &cp->mag_node);
+        pj_leave_critical_section();
+    } else {
+        cp->mag_tls_id = -1;
+    }
+#endif
 }
 
 PJ_DEF(void) pj_caching_pool_destroy( pj_caching_pool *cp )
@@ -99,6 +183,15 @@ PJ_DEF(void) pj_caching_pool_destroy( pj_caching_pool *cp )
 
     PJ_CHECK_STACK();
 
+#if CPOOL_HAS_MAGAZINE
+    if (!pj_list_empty(&cp->mag_node)) {
+        pj_enter_critical_section();
+        pj_list_erase(&cp->mag_node);
+        pj_list_init(&cp->mag_node);
+        pj_leave_critical_section();
+    }
+#endif
+
     /* Delete all pool in free list */
     for (i=0; i < PJ_CACHING_POOL_ARRAY_SIZE; ++i) {
         pj_pool_t *next;
@@ -115,18 +208,167 @@ PJ_DEF(void) pj_caching_pool_destroy( pj_caching_pool *cp )
     while (pool != (pj_pool_t*) &cp->used_list) {
         pj_pool_t *next = pool->next;
         pj_list_erase(pool);
-        PJ_LOG(4,(pool->obj_name, 
-                  "Pool is not released by application, releasing now"));
+        if (((pj_ssize_t)pool->factory_data & MAG_CACHED) == 0) {
+            PJ_LOG(4,(pool->obj_name, 
+                      "Pool is not released by application, releasing now"));
+        }
         pj_pool_destroy_int(pool);
         pool = next;
     }
 
+#if CPOOL_HAS_MAGAZINE
+    /* Delete the thread magazines, their pools have been deleted above */
+    while (!pj_list_empty(&cp->mag_list)) {
+        cpool_magazine *mag = (cpool_magazine*)cp->mag_list.next;
+        pj_list_erase(mag);
+        (*cp->factory.policy.block_free)(&cp->factory, mag, sizeof(*mag));
+    }
+    if (cp->mag_tls_id != -1) {
+        pj_thread_local_free(cp->mag_tls_id);
+        cp->mag_tls_id = -1;
+    }
+#endif
+
     if (cp->lock) {
         pj_lock_destroy(cp->lock);
         pj_lock_create_null_mutex(NULL, "cachingpool", &cp->lock);
     }
 }
 
+#if CPOOL_HAS_MAGAZINE
+/* Get the calling thread's magazine, creating it on first use. */
+static cpool_magazine *get_magazine(pj_caching_pool *cp)
+{
+    cpool_magazine *mag;
+
+    /* Magazines are disabled, or the application doesn't want any pool
+     * to be cached.
+     */
+    if (cp->mag_tls_id == -1)
+        return NULL;
+
+    mag = (cpool_magazine*) pj_thread_local_get(cp->mag_tls_id);
+    if (mag)
+        return mag;
+
+    if (cp->magazine_size == 0 || cp->max_capacity == 0)
+        return NULL;
+
+    mag = (cpool_magazine*)
+          (*cp->factory.policy.block_alloc)(&cp->factory, sizeof(*mag));
+    if (!mag)
+        return NULL;
+    pj_bzero(mag, sizeof(*mag));
+    mag->size = cp->magazine_size < PJ_CACHING_POOL_MAGAZINE_SIZE ?
+                cp->magazine_size : PJ_CACHING_POOL_MAGAZINE_SIZE;
+
+    if (pj_thread_local_set(cp->mag_tls_id, mag) != PJ_SUCCESS) {
+        (*cp->factory.policy.block_free)(&cp->factory, mag, sizeof(*mag));
+        return NULL;
+    }
+
+    pj_lock_acquire(cp->lock);
+    pj_list_push_back(&cp->mag_list, mag);
+    pj_lock_release(cp->lock);
+
+    return mag;
+}
+
+/* Move up to half a magazine of pools from the free list to the magazine.
+ * The pools move to the used list, marked as cached. They stay counted in
+ * the free capacity.
+ */
+static void refill_magazine(pj_caching_pool *cp, cpool_magazine *mag,
+                            unsigned idx)
+{
+    unsigned batch = (mag->size + 1) / 2;
+
+    pj_lock_acquire(cp->lock);
+    while (mag->cnt[idx] < batch && !pj_list_empty(&cp->free_list[idx])) {
+        pj_pool_t *pool = (pj_pool_t*) cp->free_list[idx].next;
+
+        pj_list_erase(pool);
+        pool->factory_data = (void*)(pj_ssize_t)(idx | MAG_CACHED);
+        pj_list_insert_before(&cp->used_list, pool);
+        mag->pool[idx][mag->cnt[idx]++] = pool;
+    }
+    pj_lock_release(cp->lock);
+}
+
+/* Move the oldest pools of a magazine back to the free list. The caller
+ * must hold the lock. The free capacity doesn't change.
+ */
+static void spill_pools(pj_caching_pool *cp, cpool_magazine *mag,
+                        unsigned idx, unsigned cnt)
+{
+    unsigned i;
+
+    for (i = 0; i < cnt; ++i) {
+        pj_pool_t *pool = mag->pool[idx][i];
+
+        pj_list_erase(pool);
+        pool->factory_data = (void*)(pj_ssize_t)idx;
+        pj_list_insert_after(&cp->free_list[idx], pool);
+    }
+
+    mag->cnt[idx] -= cnt;
+    pj_memmove(&mag->pool[idx][0], &mag->pool[idx][cnt],
+               mag->cnt[idx] * sizeof(pj_pool_t*));
+}
+
+/* Move the older half of a full magazine back to the free list. */
+static void spill_magazine(pj_caching_pool *cp, cpool_magazine *mag,
+                           unsigned idx)
+{
+    pj_lock_acquire(cp->lock);
+    spill_pools(cp, mag, idx, (mag->cnt[idx] + 1) / 2);
+    pj_lock_release(cp->lock);
+}
+#endif  /* CPOOL_HAS_MAGAZINE */
+
+PJ_DEF(void) pj_caching_pool_flush_thread(pj_caching_pool *cp)
+{
+#if CPOOL_HAS_MAGAZINE
+    cpool_magazine *mag;
+    unsigned idx;
+
+    PJ_ASSERT_ON_FAIL(cp, return);
+
+    if (cp->mag_tls_id == -1)
+        return;
+
+    mag = (cpool_magazine*) pj_thread_local_get(cp->mag_tls_id);
+    if (!mag)
+        return;
+
+    pj_lock_acquire(cp->lock);
+    for (idx = 0; idx <= MAG_MAX_IDX; ++idx)
+        spill_pools(cp, mag, idx, mag->cnt[idx]);
+    pj_list_erase(mag);
+    pj_lock_release(cp->lock);
+
+    pj_thread_local_set(cp->mag_tls_id, NULL);
+    (*cp->factory.policy.block_free)(&cp->factory, mag, sizeof(*mag));
+#else
+    PJ_UNUSED_ARG(cp);
+#endif
+}
+
+PJ_DEF(void) pj_caching_pool_on_thread_exit(void)
+{
+#if CPOOL_HAS_MAGAZINE
+    pj_caching_pool_node *node;
+
+    pj_enter_critical_section();
+    for (node = mag_cpool_list.next; node != &mag_cpool_list;
+         node = node->next)
+    {
+        pj_caching_pool_flush_thread(node->cp);
+    }
+    pj_leave_critical_section();
+#endif
+}
+
 static pj_pool_t* cpool_create_pool(pj_pool_factory *pf, 
                                     const char *name, 
                                     pj_size_t initial_size, 
@@ -140,8 +382,6 @@ static pj_pool_t* cpool_create_pool(pj_pool_factory *pf,
 
     PJ_CHECK_STACK();
 
-    pj_lock_acquire(cp->lock);
-
     /* Use pool factory's policy when callback is NULL */
     if (callback == NULL) {
         callback = pf->policy.callback;
@@ -166,6 +406,30 @@ static pj_pool_t* cpool_create_pool(pj_pool_factory *pf,
             ;
     }
 
+#if CPOOL_HAS_MAGAZINE
+    /* Try the thread's magazine first. */
+    if (idx <= MAG_MAX_IDX) {
+        cpool_magazine *mag = get_magazine(cp);
+
+        if (mag && mag->cnt[idx] == 0)
+            refill_magazine(cp, mag, idx);
+
+        if (mag && mag->cnt[idx]) {
+            pool = mag->pool[idx][--mag->cnt[idx]];
+            CAPACITY_SUB(cp, pj_pool_get_capacity(pool));
+            pj_pool_init_int(pool, name, increment_sz, alignment, callback);
+            pool->factory_data = (void*) (pj_ssize_t) idx;
+            USED_COUNT_INC(cp);
+
+            PJ_LOG(6, (pool->obj_name, "pool reused from magazine, size=%lu",
+                       (unsigned long)pool->capacity));
+            return pool;
+        }
+    }
+#endif
+
+    pj_lock_acquire(cp->lock);
+
     /* Check whether there's a pool in the list. */
     if (idx==PJ_CACHING_POOL_ARRAY_SIZE || pj_list_empty(&cp->free_list[idx])) {
         /* No pool is available. */
@@ -190,11 +454,7 @@ static pj_pool_t* cpool_create_pool(pj_pool_factory *pf,
         pj_pool_init_int(pool, name, increment_sz, alignment, callback);
 
         /* Update pool manager's free capacity. */
-        if (cp->capacity > pj_pool_get_capacity(pool)) {
-            cp->capacity -= pj_pool_get_capacity(pool);
-        } else {
-            cp->capacity = 0;
-        }
+        CAPACITY_SUB(cp, pj_pool_get_capacity(pool));
 
         PJ_LOG(6, (pool->obj_name, "pool reused, size=%lu",
                    (unsigned long)pool->capacity));
@@ -207,7 +467,7 @@ static pj_pool_t* cpool_create_pool(pj_pool_factory *pf,
     pool->factory_data = (void*) (pj_ssize_t) idx;
 
     /* Increment used count. */
-    ++cp->used_count;
+    USED_COUNT_INC(cp);
 
     pj_lock_release(cp->lock);
     return pool;
@@ -223,6 +483,38 @@ static void cpool_release_pool( pj_pool_factory *pf, pj_pool_t *pool)
 
     PJ_ASSERT_ON_FAIL(pf && pool, return);
 
+#if CPOOL_HAS_MAGAZINE
+    /* Keep the pool in the thread's magazine if it's small enough. */
+    i = (unsigned) (unsigned long) (pj_ssize_t) pool->factory_data;
+    pj_assert((i & MAG_CACHED) == 0);
+    if (i <= MAG_MAX_IDX &&
+        pj_pool_get_capacity(pool) <= pool_sizes[PJ_CACHING_POOL_ARRAY_SIZE-1])
+    {
+        cpool_magazine *mag = get_magazine(cp);
+
+        if (mag && mag->size) {
+            USED_COUNT_DEC(cp);
+            pj_pool_reset(pool);
+
+            /* Pools in the magazines count against max_capacity too */
+            if (!capacity_reserve(cp, pj_pool_get_capacity(pool))) {
+                pj_lock_acquire(cp->lock);
+                pj_list_erase(pool);
+                pj_pool_destroy_int(pool);
+                pj_lock_release(cp->lock);
+                return;
+            }
+
+            if (mag->cnt[i] >= mag->size)
+                spill_magazine(cp, mag, i);
+
+            pool->factory_data = (void*)(pj_ssize_t)(i | MAG_CACHED);
+            mag->pool[i][mag->cnt[i]++] = pool;
+            return;
+        }
+    }
+#endif
+
     pj_lock_acquire(cp->lock);
 
 #if PJ_SAFE_POOL
@@ -238,17 +530,14 @@ static void cpool_release_pool( pj_pool_factory *pf, pj_pool_t *pool)
     pj_list_erase(pool);
 
     /* Decrement used count. */
-    --cp->used_count;
+    USED_COUNT_DEC(cp);
 
     pool_capacity = pj_pool_get_capacity(pool);
 
-    /* Destroy the pool if the size is greater than our size or if the total
-     * capacity in our recycle list (plus the size of the pool) exceeds 
-     * maximum capacity.
-   . */
-    if (pool_capacity > pool_sizes[PJ_CACHING_POOL_ARRAY_SIZE-1] ||
-        cp->capacity + pool_capacity > cp->max_capacity)
-    {
+    /* Destroy the pool if the size is greater than our size. The maximum
+     * capacity is checked below, once the pool has been reset.
+     */
+    if (pool_capacity > pool_sizes[PJ_CACHING_POOL_ARRAY_SIZE-1]) {
         pj_pool_destroy_int(pool);
         pj_lock_release(cp->lock);
         return;
@@ -277,8 +566,14 @@ static void cpool_release_pool( pj_pool_factory *pf, pj_pool_t *pool)
         return;
     }
 
+    /* The magazines may have taken the remaining capacity meanwhile */
+    if (!capacity_reserve(cp, pool_capacity)) {
+        pj_pool_destroy_int(pool);
+        pj_lock_release(cp->lock);
+        return;
+    }
+
     pj_list_insert_after(&cp->free_list[i], pool);
-    cp->capacity += pool_capacity;
 
     pj_lock_release(cp->lock);
 }
@@ -294,6 +589,13 @@ static void cpool_dump_status(pj_pool_factory *factory, pj_bool_t detail )
     PJ_LOG(3,("cachpool", "   Capacity=%lu, max_capacity=%lu, used_cnt=%lu",
               (unsigned long)cp->capacity, (unsigned long)cp->max_capacity,
               (unsigned long)cp->used_count));
+#if CPOOL_HAS_MAGAZINE
+    if (!pj_list_empty(&cp->mag_list)) {
+        PJ_LOG(3,("cachpool", "   Thread magazines=%lu, size=%u",
+                  (unsigned long)pj_list_size(&cp->mag_list),
+                  cp->magazine_size));
+    }
+#endif
     if (detail) {
         pj_pool_t *pool = (pj_pool_t*) cp->used_list.next;
         pj_size_t total_used = 0, total_capacity = 0;
@@ -303,6 +605,12 @@ static void cpool_dump_status(pj_pool_factory *factory, pj_bool_t detail )
             pj_pool_block *block = pool->block_list.next;
             unsigned nblocks = 0;
 
+            /* Skip pools cached in the thread magazines */
+            if ((pj_ssize_t)pool->factory_data & MAG_CACHED) {
+                pool = pool->next;
+                continue;
+            }
+
             while (block != &pool->block_list) {
 #if 0
                 PJ_LOG(6, ("cachpool", "   %16s block %u, size %ld",
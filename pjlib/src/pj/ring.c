@@ -0,0 +1,387 @@
+/*
+ * Copyright (C) 2025 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <pj/ring.h>
+#include <pj/assert.h>
+#include <pj/errno.h>
+#include <pj/lock.h>
+#include <pj/pool.h>
+#include <pj/string.h>
+
+#define THIS_FILE           "ring.c"
+
+/* Assumed cache line size, used to keep the producer and consumer
+ * indexes apart.
+ */
+#define CACHE_LINE          64
+
+/* Element slots are aligned to this. */
+#define SLOT_ALIGN          8
+#define ALIGN_UP(v, a)      (((v) + (a) - 1) & ~((a) - 1))
+
+/* MPMC slots start with the sequence number, padded to SLOT_ALIGN. */
+#define SEQ_SIZE            ALIGN_UP(sizeof(pj_size_t), SLOT_ALIGN)
+
+#if PJ_HAS_THREADS && (defined(__GNUC__) || defined(__clang__))
+#   define RING_LOCK_FREE   1
+#   define LOAD_RLX(p)      __atomic_load_n(p, __ATOMIC_RELAXED)
+#   define LOAD_ACQ(p)      __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#   define STORE_REL(p, v)  __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#   define CAS(p, pexp, v)  __atomic_compare_exchange_n(p, pexp, v, 1, \
+                                                        __ATOMIC_RELAXED, \
+                                                        __ATOMIC_RELAXED)
+#else
+/* Operations are serialized by ring->lock (if any), plain accesses will
+ * do.
+ */
+#   define RING_LOCK_FREE   0
+#   define LOAD_RLX(p)      (*(p))
+#   define LOAD_ACQ(p)      (*(p))
+#   define STORE_REL(p, v)  (*(p) = (v))
+#   define CAS(p, pexp, v)  (*(p) == *(pexp) ? (*(p) = (v), 1) : \
+                                                (*(pexp) = *(p), 0))
+#endif
+
+#if !RING_LOCK_FREE && PJ_HAS_THREADS
+#   define RING_LOCK(r)     pj_lock_acquire((r)->lock)
+#   define RING_UNLOCK(r)   pj_lock_release((r)->lock)
+#else
+#   define RING_LOCK(r)
+#   define RING_UNLOCK(r)
+#endif
+
+struct pj_ring_t
+{
+    /* Read-only after creation */
+    pj_ring_type         type;
+    pj_size_t            mask;
+    unsigned             elem_size;
+    unsigned             slot_size;
+    char                *slots;
+    pj_lock_t           *lock;
+    char                 pad0[CACHE_LINE];
+
+    /* Producer side. The SPSC producer keeps the last seen head here to
+     * avoid reading the consumer's cache line on every push.
+     */
+    pj_size_t            tail;
+    pj_size_t            head_cache;
+    char                 pad1[CACHE_LINE - 2*sizeof(pj_size_t)];
+
+    /* Consumer side */
+    pj_size_t            head;
+    pj_size_t            tail_cache;
+    char                 pad2[CACHE_LINE - 2*sizeof(pj_size_t)];
+};
+
+#define SLOT(r, pos)        ((r)->slots + ((pos) & (r)->mask) * (r)->slot_size)
+#define SLOT_SEQ(slot)      ((pj_size_t*)(slot))
+
+
+PJ_DEF(pj_status_t) pj_ring_create(pj_pool_t *pool,
+                                   pj_ring_type type,
+                                   unsigned capacity,
+                                   unsigned elem_size,
+                                   pj_ring_t **p_ring)
+{
+    pj_ring_t *ring;
+    pj_size_t cap, i;
+
+    PJ_ASSERT_RETURN(pool && capacity && elem_size && p_ring, PJ_EINVAL);
+    PJ_ASSERT_RETURN(type == PJ_RING_MPMC || type == PJ_RING_SPSC,
+                     PJ_EINVAL);
+    PJ_ASSERT_RETURN(capacity <= 0x40000000, PJ_ETOOBIG);
+
+    for (cap = 1; cap < capacity; cap <<= 1)
+        ;
+
+    ring = (pj_ring_t*)pj_pool_aligned_alloc(pool, CACHE_LINE,
+                                             sizeof(pj_ring_t));
+    PJ_ASSERT_RETURN(ring, PJ_ENOMEM);
+    pj_bzero(ring, sizeof(pj_ring_t));
+
+    ring->type = type;
+    ring->mask = cap - 1;
+    ring->elem_size = elem_size;
+    ring->slot_size = ALIGN_UP(elem_size, SLOT_ALIGN);
+    if (type == PJ_RING_MPMC)
+        ring->slot_size += SEQ_SIZE;
+
+    ring->slots = (char*)pj_pool_aligned_alloc(pool, CACHE_LINE,
+                                               cap * ring->slot_size);
+    PJ_ASSERT_RETURN(ring->slots, PJ_ENOMEM);
+
+    /* Slot i is free for the producer at position i */
+    if (type == PJ_RING_MPMC) {
+        for (i = 0; i < cap; ++i)
+            *SLOT_SEQ(SLOT(ring, i)) = i;
+    }
+
+#if !RING_LOCK_FREE && PJ_HAS_THREADS
+    {
+        pj_status_t status;
+
+        status = pj_lock_create_simple_mutex(pool, "ring%p", &ring->lock);
+        if (status != PJ_SUCCESS)
+            return status;
+    }
+#endif
+
+    *p_ring = ring;
+    return PJ_SUCCESS;
+}
+
+
+PJ_DEF(pj_status_t) pj_ring_destroy(pj_ring_t *ring)
+{
+    PJ_ASSERT_RETURN(ring, PJ_EINVAL);
+
+    if (ring->lock) {
+        pj_lock_destroy(ring->lock);
+        ring->lock = NULL;
+    }
+    return PJ_SUCCESS;
+}
+
+
+static unsigned spsc_push_n(pj_ring_t *ring, const char *src, unsigned count)
+{
+    pj_size_t tail = LOAD_RLX(&ring->tail);
+    pj_size_t room = ring->mask + 1 - (tail - ring->head_cache);
+    unsigned i;
+
+    if (room < count) {
+        ring->head_cache = LOAD_ACQ(&ring->head);
+        room = ring->mask + 1 - (tail - ring->head_cache);
+        if (room < count)
+            count = (unsigned)room;
+    }
+
+    for (i = 0; i < count; ++i) {
+        pj_memcpy(SLOT(ring, tail + i), src, ring->elem_size);
+        src += ring->elem_size;
+    }
+
+    if (count)
+        STORE_REL(&ring->tail, tail + count);
+
+    return count;
+}
+
+
+static unsigned spsc_pop_n(pj_ring_t *ring, char *dst, unsigned count)
+{
+    pj_size_t head = LOAD_RLX(&ring->head);
+    pj_size_t avail = ring->tail_cache - head;
+    unsigned i;
+
+    if (avail < count) {
+        ring->tail_cache = LOAD_ACQ(&ring->tail);
+        avail = ring->tail_cache - head;
+        if (avail < count)
+            count = (unsigned)avail;
+    }
+
+    if (dst) {
+        for (i = 0; i < count; ++i) {
+            pj_memcpy(dst, SLOT(ring, head + i), ring->elem_size);
+            dst += ring->elem_size;
+        }
+    }
+
+    if (count)
+        STORE_REL(&ring->head, head + count);
+
+    return count;
+}
+
+
+/* MPMC push/pop follow Dmitry Vyukov's bounded queue: the sequence of a
+ * slot tells whether it's free for the producer at position pos
+ * (seq == pos) or holds an element for the consumer at position pos
+ * (seq == pos + 1). A batch checks the sequences of consecutive slots,
+ * then claims all of them with a single CAS on the index.
+ */
+static unsigned mpmc_push_n(pj_ring_t *ring, const char *src, unsigned count)
+{
+    pj_size_t pos = LOAD_RLX(&ring->tail);
+    unsigned i, n;
+
+    for (;;) {
+        pj_size_t seq = 0;
+
+        for (n = 0; n < count; ++n) {
+            seq = LOAD_ACQ(SLOT_SEQ(SLOT(ring, pos + n)));
+            if (seq != pos + n)
+                break;
+        }
+
+        if (n == 0) {
+            /* Slot still holds an element from the previous round */
+            if ((pj_ssize_t)(seq - pos) < 0)
+                return 0;
+
+            /* Another producer has claimed it, retry with the new tail */
+            pos = LOAD_RLX(&ring->tail);
+            continue;
+        }
+
+        if (CAS(&ring->tail, &pos, pos + n))
+            break;
+    }
+
+    for (i = 0; i < n; ++i) {
+        char *slot = SLOT(ring, pos + i);
+
+        pj_memcpy(slot + SEQ_SIZE, src, ring->elem_size);
+        src += ring->elem_size;
+        STORE_REL(SLOT_SEQ(slot), pos + i + 1);
+    }
+
+    return n;
+}
+
+
+static unsigned mpmc_pop_n(pj_ring_t *ring, char *dst, unsigned count)
+{
+    pj_size_t pos = LOAD_RLX(&ring->head);
+    unsigned i, n;
+
+    for (;;) {
+        pj_size_t seq = 0;
+
+        for (n = 0; n < count; ++n) {
+            seq = LOAD_ACQ(SLOT_SEQ(SLOT(ring, pos + n)));
+            if (seq != pos + n + 1)
+                break;
+        }
+
+        if (n == 0) {
+            /* Slot hasn't been filled yet */
+            if ((pj_ssize_t)(seq - (pos + 1)) < 0)
+                return 0;
+
+            pos = LOAD_RLX(&ring->head);
+            continue;
+        }
+
+        if (CAS(&ring->head, &pos, pos + n))
+            break;
+    }
+
+    for (i = 0; i < n; ++i) {
+        char *slot = SLOT(ring, pos + i);
+
+        if (dst) {
+            pj_memcpy(dst, slot + SEQ_SIZE, ring->elem_size);
+            dst += ring->elem_size;
+        }
+        /* Free for the producer in the next round */
+        STORE_REL(SLOT_SEQ(slot), pos + i + ring->mask + 1);
+    }
+
+    return n;
+}
+
+
+PJ_DEF(unsigned) pj_ring_push_n(pj_ring_t *ring, const void *elems,
+                                unsigned count)
+{
+    unsigned n;
+
+    PJ_ASSERT_RETURN(ring && (elems || !count), 0);
+
+    if (count > ring->mask + 1)
+        count = (unsigned)(ring->mask + 1);
+    if (count == 0)
+        return 0;
+
+    RING_LOCK(ring);
+    if (ring->type == PJ_RING_MPMC)
+        n = mpmc_push_n(ring, (const char*)elems, count);
+    else
+        n = spsc_push_n(ring, (const char*)elems, count);
+    RING_UNLOCK(ring);
+
+    return n;
+}
+
+
+PJ_DEF(unsigned) pj_ring_pop_n(pj_ring_t *ring, void *elems,
+                               unsigned max_count)
+{
+    unsigned n;
+
+    PJ_ASSERT_RETURN(ring, 0);
+
+    if (max_count > ring->mask + 1)
+        max_count = (unsigned)(ring->mask + 1);
+    if (max_count == 0)
+        return 0;
+
+    RING_LOCK(ring);
+    if (ring->type == PJ_RING_MPMC)
+        n = mpmc_pop_n(ring, (char*)elems, max_count);
+    else
+        n = spsc_pop_n(ring, (char*)elems, max_count);
+    RING_UNLOCK(ring);
+
+    return n;
+}
+
+
+PJ_DEF(pj_status_t) pj_ring_push(pj_ring_t *ring, const void *elem)
+{
+    PJ_ASSERT_RETURN(ring && elem, PJ_EINVAL);
+    return pj_ring_push_n(ring, elem, 1) ? PJ_SUCCESS : PJ_ETOOMANY;
+}
+
+
+PJ_DEF(pj_status_t) pj_ring_pop(pj_ring_t *ring, void *elem)
+{
+    PJ_ASSERT_RETURN(ring, PJ_EINVAL);
+    return pj_ring_pop_n(ring, elem, 1) ? PJ_SUCCESS : PJ_ENOTFOUND;
+}
+
+
+PJ_DEF(unsigned) pj_ring_size(pj_ring_t *ring)
+{
+    pj_size_t head, tail;
+
+    PJ_ASSERT_RETURN(ring, 0);
+
+    RING_LOCK(ring);
+    /* Read head first, so that a concurrent pop can't make the result
+     * negative.
+     */
+    head = LOAD_ACQ(&ring->head);
+    tail = LOAD_ACQ(&ring->tail);
+    RING_UNLOCK(ring);
+
+    if ((pj_ssize_t)(tail - head) <= 0)
+        return 0;
+    if (tail - head > ring->mask + 1)
+        return (unsigned)(ring->mask + 1);
+    return (unsigned)(tail - head);
+}
+
+
+PJ_DEF(unsigned) pj_ring_capacity(const pj_ring_t *ring)
+{
+    PJ_ASSERT_RETURN(ring, 0);
+    return (unsigned)(ring->mask + 1);
+}
@@ -174,6 +174,11 @@ const pj_uint16_t PJ_SO_RCVBUF  = SO_RCVBUF;
 const pj_uint16_t PJ_SO_SNDBUF  = SO_SNDBUF;
 const pj_uint16_t PJ_TCP_NODELAY= TCP_NODELAY;
 const pj_uint16_t PJ_SO_REUSEADDR= SO_REUSEADDR;
+#ifdef SO_REUSEPORT
+const pj_uint16_t PJ_SO_REUSEPORT = SO_REUSEPORT;
+#else
+const pj_uint16_t PJ_SO_REUSEPORT = 0xFFFF;
+#endif
 #ifdef SO_NOSIGPIPE
 const pj_uint16_t PJ_SO_NOSIGPIPE = SO_NOSIGPIPE;
 #else
@@ -16,11 +16,19 @@
  * along with this program; if not, write to the Free Software
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
  */
+#if defined(PJ_LINUX) || defined(__linux__)
+    /* Needed for recvmmsg()/sendmmsg() */
+#   ifndef _GNU_SOURCE
+#       define _GNU_SOURCE
+#   endif
+#endif
+
 #include <pj/sock.h>
 #include <pj/assert.h>
 #include <pj/ctype.h>
 #include <pj/errno.h>
 #include <pj/ip_helper.h>
+#include <pj/math.h>
 #include <pj/os.h>
 #include <pj/pool.h>
 #include <pj/addr_resolv.h>
@@ -1411,6 +1419,172 @@ PJ_DEF(pj_status_t) pj_sock_socketpair(int family,
 #endif
 
 
+#if defined(PJ_SOCK_HAS_MMSG) && PJ_SOCK_HAS_MMSG != 0
+
+/* Max number of datagrams passed to a single recvmmsg()/sendmmsg() call */
+#define MAX_MMSG    64
+
+PJ_DEF(pj_status_t) pj_sock_recvmmsg(pj_sock_t sock,
+                                     pj_sock_mmsg msgs[],
+                                     unsigned *count,
+                                     unsigned flags)
+{
+    struct mmsghdr hdr[MAX_MMSG];
+    struct iovec iov[MAX_MMSG];
+    unsigned i, cnt;
+    int rc;
+
+    PJ_CHECK_STACK();
+    PJ_ASSERT_RETURN(msgs && count && *count, PJ_EINVAL);
+
+    cnt = PJ_MIN(*count, MAX_MMSG);
+    *count = 0;
+
+    pj_bzero(hdr, cnt * sizeof(hdr[0]));
+    for (i = 0; i < cnt; ++i) {
+        iov[i].iov_base = msgs[i].buf;
+        iov[i].iov_len = msgs[i].len;
+        hdr[i].msg_hdr.msg_iov = &iov[i];
+        hdr[i].msg_hdr.msg_iovlen = 1;
+        if (msgs[i].addr) {
+            hdr[i].msg_hdr.msg_name = msgs[i].addr;
+            hdr[i].msg_hdr.msg_namelen = msgs[i].addrlen;
+        }
+    }
+
+    /* Only wait for the first datagram on blocking sockets */
+    rc = recvmmsg(sock, hdr, cnt, flags | MSG_WAITFORONE, NULL);
+    if (rc < 0)
+        return PJ_RETURN_OS_ERROR(pj_get_native_netos_error());
+
+    for (i = 0; i < (unsigned)rc; ++i) {
+        msgs[i].len = hdr[i].msg_len;
+        if (msgs[i].addr) {
+            msgs[i].addrlen = hdr[i].msg_hdr.msg_namelen;
+            PJ_SOCKADDR_RESET_LEN(msgs[i].addr);
+        }
+    }
+
+    *count = rc;
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(pj_status_t) pj_sock_sendmmsg(pj_sock_t sock,
+                                     pj_sock_mmsg msgs[],
+                                     unsigned *count,
+                                     unsigned flags)
+{
+    struct mmsghdr hdr[MAX_MMSG];
+    struct iovec iov[MAX_MMSG];
+    unsigned i, cnt;
+    int rc;
+
+    PJ_CHECK_STACK();
+    PJ_ASSERT_RETURN(msgs && count && *count, PJ_EINVAL);
+
+    cnt = PJ_MIN(*count, MAX_MMSG);
+    *count = 0;
+
+#ifdef MSG_NOSIGNAL
+    /* Suppress SIGPIPE, as in pj_sock_sendto() */
+    flags |= MSG_NOSIGNAL;
+#endif
+
+    pj_bzero(hdr, cnt * sizeof(hdr[0]));
+    for (i = 0; i < cnt; ++i) {
+        iov[i].iov_base = msgs[i].buf;
+        iov[i].iov_len = msgs[i].len;
+        hdr[i].msg_hdr.msg_iov = &iov[i];
+        hdr[i].msg_hdr.msg_iovlen = 1;
+        if (msgs[i].addr) {
+            hdr[i].msg_hdr.msg_name = msgs[i].addr;
+            hdr[i].msg_hdr.msg_namelen = msgs[i].addrlen;
+        }
+    }
+
+    rc = sendmmsg(sock, hdr, cnt, flags);
+    if (rc < 0)
+        return PJ_RETURN_OS_ERROR(pj_get_native_netos_error());
+
+    for (i = 0; i < (unsigned)rc; ++i)
+        msgs[i].len = hdr[i].msg_len;
+
+    *count = rc;
+    return PJ_SUCCESS;
+}
+
+#else   /* PJ_SOCK_HAS_MMSG */
+
+PJ_DEF(pj_status_t) pj_sock_recvmmsg(pj_sock_t sock,
+                                     pj_sock_mmsg msgs[],
+                                     unsigned *count,
+                                     unsigned flags)
+{
+    unsigned i, cnt;
+    pj_status_t status = PJ_SUCCESS;
+
+    PJ_CHECK_STACK();
+    PJ_ASSERT_RETURN(msgs && count && *count, PJ_EINVAL);
+
+    cnt = *count;
+    *count = 0;
+
+    for (i = 0; i < cnt; ++i) {
+        status = pj_sock_recvfrom(sock, msgs[i].buf, &msgs[i].len, flags,
+                                  msgs[i].addr,
+                                  (msgs[i].addr ? &msgs[i].addrlen : NULL));
+        if (status != PJ_SUCCESS)
+            break;
+
+        ++(*count);
+
+#ifdef MSG_DONTWAIT
+        /* Don't block waiting for the subsequent datagrams */
+        flags |= MSG_DONTWAIT;
+#else
+        /* Without non-blocking flag we can't tell whether the next
+         * recvfrom() would block, so only receive one datagram.
+         */
+        break;
+#endif
+    }
+
+    return (*count) ? PJ_SUCCESS : status;
+}
+
+PJ_DEF(pj_status_t) pj_sock_sendmmsg(pj_sock_t sock,
+                                     pj_sock_mmsg msgs[],
+                                     unsigned *count,
+                                     unsigned flags)
+{
+    unsigned i, cnt;
+    pj_status_t status = PJ_SUCCESS;
+
+    PJ_CHECK_STACK();
+    PJ_ASSERT_RETURN(msgs && count && *count, PJ_EINVAL);
+
+    cnt = *count;
+    *count = 0;
+
+    for (i = 0; i < cnt; ++i) {
+        if (msgs[i].addr) {
+            status = pj_sock_sendto(sock, msgs[i].buf, &msgs[i].len, flags,
+                                    msgs[i].addr, msgs[i].addrlen);
+        } else {
+            status = pj_sock_send(sock, msgs[i].buf, &msgs[i].len, flags);
+        }
+        if (status != PJ_SUCCESS)
+            break;
+
+        ++(*count);
+    }
+
+    return (*count) ? PJ_SUCCESS : status;
+}
+
+#endif  /* PJ_SOCK_HAS_MMSG */
+
+
 /* Check IP address type. */
 PJ_DEF(pj_bool_t) pj_check_addr_type(const pj_sockaddr *addr, unsigned type)
 {
@@ -1659,6 +1833,11 @@ PJ_DEF(pj_uint16_t) pj_SO_REUSEADDR(void)
     return PJ_SO_REUSEADDR;
 }
 
+PJ_DEF(pj_uint16_t) pj_SO_REUSEPORT(void)
+{
+    return PJ_SO_REUSEPORT;
+}
+
 PJ_DEF(pj_uint16_t) pj_SO_NOSIGPIPE(void)
 {
     return PJ_SO_NOSIGPIPE;
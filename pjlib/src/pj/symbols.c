@@ -77,6 +77,7 @@ PJ_EXPORT_SYMBOL(pj_create_unique_string)
  */
 PJ_EXPORT_SYMBOL(pj_hash_calc)
 PJ_EXPORT_SYMBOL(pj_hash_create)
+PJ_EXPORT_SYMBOL(pj_hash_create2)
 PJ_EXPORT_SYMBOL(pj_hash_get)
 PJ_EXPORT_SYMBOL(pj_hash_set)
 PJ_EXPORT_SYMBOL(pj_hash_count)
@@ -123,6 +124,7 @@ PJ_EXPORT_SYMBOL(pj_list_search)
  * log.h
  */
 PJ_EXPORT_SYMBOL(pj_log_write)
+PJ_EXPORT_SYMBOL(pj_log_async_param_default)
 #if PJ_LOG_MAX_LEVEL >= 1
 PJ_EXPORT_SYMBOL(pj_log_set_log_func)
 PJ_EXPORT_SYMBOL(pj_log_get_log_func)
@@ -130,6 +132,9 @@ PJ_EXPORT_SYMBOL(pj_log_set_level)
 PJ_EXPORT_SYMBOL(pj_log_get_level)
 PJ_EXPORT_SYMBOL(pj_log_set_decor)
 PJ_EXPORT_SYMBOL(pj_log_get_decor)
+PJ_EXPORT_SYMBOL(pj_log_async_start)
+PJ_EXPORT_SYMBOL(pj_log_async_stop)
+PJ_EXPORT_SYMBOL(pj_log_async_get_stat)
 PJ_EXPORT_SYMBOL(pj_log_1)
 #endif
 #if PJ_LOG_MAX_LEVEL >= 2
@@ -223,6 +228,7 @@ PJ_EXPORT_SYMBOL(pj_pool_init_int)
 PJ_EXPORT_SYMBOL(pj_pool_destroy_int)
 PJ_EXPORT_SYMBOL(pj_caching_pool_init)
 PJ_EXPORT_SYMBOL(pj_caching_pool_destroy)
+PJ_EXPORT_SYMBOL(pj_caching_pool_flush_thread)
 
 /*
  * rand.h
@@ -244,6 +250,18 @@ PJ_EXPORT_SYMBOL(pj_rbtree_erase)
 PJ_EXPORT_SYMBOL(pj_rbtree_max_height)
 PJ_EXPORT_SYMBOL(pj_rbtree_min_height)
 
+/*
+ * ring.h
+ */
+PJ_EXPORT_SYMBOL(pj_ring_create)
+PJ_EXPORT_SYMBOL(pj_ring_destroy)
+PJ_EXPORT_SYMBOL(pj_ring_push)
+PJ_EXPORT_SYMBOL(pj_ring_pop)
+PJ_EXPORT_SYMBOL(pj_ring_push_n)
+PJ_EXPORT_SYMBOL(pj_ring_pop_n)
+PJ_EXPORT_SYMBOL(pj_ring_size)
+PJ_EXPORT_SYMBOL(pj_ring_capacity)
+
 /*
  * sock.h
  */
@@ -336,6 +354,8 @@ PJ_EXPORT_SYMBOL(pj_ansi_strxcat)
  */
 PJ_EXPORT_SYMBOL(pj_timer_heap_mem_size)
 PJ_EXPORT_SYMBOL(pj_timer_heap_create)
+PJ_EXPORT_SYMBOL(pj_timer_heap_cfg_default)
+PJ_EXPORT_SYMBOL(pj_timer_heap_create2)
 PJ_EXPORT_SYMBOL(pj_timer_entry_init)
 PJ_EXPORT_SYMBOL(pj_timer_heap_schedule)
 PJ_EXPORT_SYMBOL(pj_timer_heap_cancel)
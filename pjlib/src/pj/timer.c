@@ -45,6 +45,26 @@
 
 #define DEFAULT_MAX_TIMED_OUT_PER_POLL  (64)
 
+/* Timing wheel geometry: 256 slots on the first level and 64 slots on each
+ * of the upper four levels, covering 2^32 ticks. Timers farther than that
+ * are parked in the last level and re-inserted when it cascades.
+ */
+#define WHEEL_LEVELS    5
+#define WHEEL_L0_BITS   8
+#define WHEEL_LN_BITS   6
+#define WHEEL_L0_SIZE   (1 << WHEEL_L0_BITS)
+#define WHEEL_LN_SIZE   (1 << WHEEL_LN_BITS)
+#define WHEEL_L0_MASK   (WHEEL_L0_SIZE - 1)
+#define WHEEL_LN_MASK   (WHEEL_LN_SIZE - 1)
+#define WHEEL_SLOTS     (WHEEL_L0_SIZE + (WHEEL_LEVELS-1) * WHEEL_LN_SIZE)
+#define WHEEL_SHIFT(l)  (WHEEL_L0_BITS + ((l)-1) * WHEEL_LN_BITS)
+#define WHEEL_SLOT(l,i) (WHEEL_L0_SIZE + ((l)-1) * WHEEL_LN_SIZE + (i))
+#define WHEEL_LEVEL(s)  ((s) < WHEEL_L0_SIZE ? 0 : \
+                         1 + ((s) - WHEEL_L0_SIZE) / WHEEL_LN_SIZE)
+#define WHEEL_MAX_TICKS ((((pj_uint64_t)1) << WHEEL_SHIFT(WHEEL_LEVELS)) - 1)
+
+#define TIME_VAL_MSEC(t) ((pj_int64_t)(t).sec * 1000 + (t).msec)
+
 /* Enable this to raise assertion in order to catch bug of timer entry
  * which has been deallocated without being cancelled. If disabled,
  * the timer heap will simply remove the destroyed entry (and print log)
@@ -105,6 +125,7 @@ typedef struct pj_timer_entry_dup
 #define GET_TIMER(ht, node) &ht->timer_dups[node->_timer_id]
 #define GET_ENTRY(node) node->entry
 #define GET_FIELD(node, _timer_id) node->dup._timer_id
+#define WHEEL_NODE(ht, id) (&(ht)->timer_dups[id])
 
 #else
 
@@ -113,6 +134,7 @@ typedef pj_timer_entry pj_timer_entry_dup;
 #define GET_TIMER(ht, node) node
 #define GET_ENTRY(node) node
 #define GET_FIELD(node, _timer_id) node->_timer_id
+#define WHEEL_NODE(ht, id) ((ht)->heap[id])
 
 #endif
 
@@ -181,6 +203,35 @@ struct pj_timer_heap_t
     /** Callback to be called when a timer expires. */
     pj_timer_heap_callback *callback;
 
+    /** The implementation type. */
+    pj_timer_heap_type type;
+
+    /**
+     * The timing wheel, only used by PJ_TIMER_HEAP_WHEEL. In this mode
+     * the <heap> array is indexed by timer id instead of heap slot (and
+     * only used when PJ_TIMER_USE_COPY is disabled), while <timer_ids>
+     * holds the wheel slot where the timer resides.
+     */
+    struct {
+        /** Tick resolution, in msec. */
+        unsigned         res;
+
+        /** The time (in msec) of tick zero. */
+        pj_int64_t       base;
+
+        /** Current tick. All the ticks before this have been processed. */
+        pj_uint64_t      cur;
+
+        /** Number of timers in each level. */
+        pj_size_t        cnt[WHEEL_LEVELS];
+
+        /** First timer id of each slot, or zero if the slot is empty. */
+        pj_timer_id_t   *head;
+
+        /** Circular list links, indexed by timer id. */
+        pj_timer_id_t   *next;
+        pj_timer_id_t   *prev;
+    } wheel;
 };
 
 
@@ -299,9 +350,241 @@ static void reheap_up( pj_timer_heap_t *ht, pj_timer_entry_dup *moved_node,
 }
 
 
+/* Convert time to timing wheel tick, rounding up for expiration time so
+ * that the timer never fires early.
+ */
+static pj_uint64_t wheel_tick(pj_timer_heap_t *ht, const pj_time_val *t,
+                              pj_bool_t round_up)
+{
+    pj_int64_t msec = TIME_VAL_MSEC(*t) - ht->wheel.base;
+
+    if (msec <= 0)
+        return 0;
+    if (round_up)
+        msec += ht->wheel.res - 1;
+    return (pj_uint64_t)msec / ht->wheel.res;
+}
+
+static void wheel_link(pj_timer_heap_t *ht, pj_timer_id_t id,
+                       pj_uint64_t tick)
+{
+    pj_uint64_t delta;
+    unsigned level, slot;
+    pj_timer_id_t head;
+
+    if (tick < ht->wheel.cur)
+        tick = ht->wheel.cur;
+    delta = tick - ht->wheel.cur;
+
+    if (delta < WHEEL_L0_SIZE) {
+        level = 0;
+        slot = (unsigned)(tick & WHEEL_L0_MASK);
+    } else {
+        for (level = 1; level < WHEEL_LEVELS-1; ++level) {
+            if (delta < (((pj_uint64_t)1) << WHEEL_SHIFT(level+1)))
+                break;
+        }
+        if (delta > WHEEL_MAX_TICKS)
+            tick = ht->wheel.cur + WHEEL_MAX_TICKS;
+        slot = WHEEL_SLOT(level, (unsigned)(tick >> WHEEL_SHIFT(level)) &
+                                 WHEEL_LN_MASK);
+    }
+
+    /* Append to the slot's circular list */
+    head = ht->wheel.head[slot];
+    if (head == 0) {
+        ht->wheel.head[slot] = id;
+        ht->wheel.next[id] = ht->wheel.prev[id] = id;
+    } else {
+        pj_timer_id_t tail = ht->wheel.prev[head];
+        ht->wheel.next[tail] = id;
+        ht->wheel.prev[id] = tail;
+        ht->wheel.next[id] = head;
+        ht->wheel.prev[head] = id;
+    }
+    ht->timer_ids[id] = slot;
+    ht->wheel.cnt[level]++;
+}
+
+static void wheel_unlink(pj_timer_heap_t *ht, pj_timer_id_t id)
+{
+    unsigned slot = (unsigned)ht->timer_ids[id];
+    pj_timer_id_t next = ht->wheel.next[id];
+
+    if (next == id) {
+        ht->wheel.head[slot] = 0;
+    } else {
+        pj_timer_id_t prev = ht->wheel.prev[id];
+        ht->wheel.next[prev] = next;
+        ht->wheel.prev[next] = prev;
+        if (ht->wheel.head[slot] == id)
+            ht->wheel.head[slot] = next;
+    }
+    ht->wheel.cnt[WHEEL_LEVEL(slot)]--;
+}
+
+/* Move the timers in the specified upper level slot down the wheel. */
+static unsigned wheel_cascade(pj_timer_heap_t *ht, unsigned level,
+                              unsigned idx)
+{
+    unsigned slot = WHEEL_SLOT(level, idx);
+    pj_timer_id_t first = ht->wheel.head[slot];
+    pj_timer_id_t id = first;
+
+    if (first == 0)
+        return idx;
+
+    ht->wheel.head[slot] = 0;
+    do {
+        pj_timer_id_t next = ht->wheel.next[id];
+
+        ht->wheel.cnt[level]--;
+        wheel_link(ht, id, wheel_tick(ht, &WHEEL_NODE(ht, id)->_timer_value,
+                                      PJ_TRUE));
+        id = next;
+    } while (id != first);
+
+    return idx;
+}
+
+/* Advance the wheel to (at most) the specified tick. */
+static void wheel_advance(pj_timer_heap_t *ht, pj_uint64_t now_tick)
+{
+    if (ht->wheel.cnt[0] == 0) {
+        /* Skip the empty first level in one go */
+        pj_uint64_t next = (ht->wheel.cur | WHEEL_L0_MASK) + 1;
+        ht->wheel.cur = (now_tick < next) ? now_tick : next;
+    } else {
+        ht->wheel.cur++;
+    }
+
+    if ((ht->wheel.cur & WHEEL_L0_MASK) == 0) {
+        unsigned level;
+
+        for (level = 1; level < WHEEL_LEVELS; ++level) {
+            unsigned idx = (unsigned)(ht->wheel.cur >> WHEEL_SHIFT(level)) &
+                           WHEEL_LN_MASK;
+            if (wheel_cascade(ht, level, idx) != 0)
+                break;
+        }
+    }
+}
+
+/* Get the id of the first expired timer, or zero if none has expired. The
+ * whole slot of the current tick expires at once, so this is O(1) per timer
+ * except when advancing over empty ticks.
+ */
+static pj_timer_id_t wheel_expired(pj_timer_heap_t *ht, const pj_time_val *now)
+{
+    pj_uint64_t now_tick = wheel_tick(ht, now, PJ_FALSE);
+
+    while (ht->wheel.cur <= now_tick) {
+        pj_timer_id_t id;
+
+        id = ht->wheel.head[ht->wheel.cur & WHEEL_L0_MASK];
+        if (id)
+            return id;
+
+        if (ht->wheel.cur == now_tick)
+            break;
+
+        if (ht->cur_size == 0) {
+            ht->wheel.cur = now_tick;
+            break;
+        }
+        wheel_advance(ht, now_tick);
+    }
+    return 0;
+}
+
+/* Get the time when the wheel needs to be polled next. This may be earlier
+ * than the earliest timer when the upper levels need to be cascaded.
+ */
+static void wheel_next_time(pj_timer_heap_t *ht, pj_time_val *t)
+{
+    pj_uint64_t tick = (pj_uint64_t)-1;
+    pj_int64_t msec;
+
+    if (ht->wheel.cnt[0]) {
+        unsigned k;
+        for (k = 0; k < WHEEL_L0_SIZE; ++k) {
+            if (ht->wheel.head[(ht->wheel.cur + k) & WHEEL_L0_MASK]) {
+                tick = ht->wheel.cur + k;
+                break;
+            }
+        }
+    }
+    if (ht->cur_size > ht->wheel.cnt[0]) {
+        pj_uint64_t next = (ht->wheel.cur | WHEEL_L0_MASK) + 1;
+        if (next < tick)
+            tick = next;
+    }
+
+    msec = ht->wheel.base + (pj_int64_t)(tick * ht->wheel.res);
+    t->sec = (long)(msec / 1000);
+    t->msec = (long)(msec % 1000);
+}
+
+/* Get the exact earliest expiration time: the first non-empty slot of each
+ * level holds the earliest timer of that level.
+ */
+static void wheel_earliest_time(pj_timer_heap_t *ht, pj_time_val *t)
+{
+    pj_bool_t found = PJ_FALSE;
+    unsigned level;
+
+    for (level = 0; level < WHEEL_LEVELS; ++level) {
+        unsigned size, first, k;
+
+        if (ht->wheel.cnt[level] == 0)
+            continue;
+
+        if (level == 0) {
+            size = WHEEL_L0_SIZE;
+            first = (unsigned)ht->wheel.cur;
+        } else {
+            /* Current slot of the upper level has been cascaded, anything
+             * in it belongs to the next round.
+             */
+            size = WHEEL_LN_SIZE;
+            first = (unsigned)(ht->wheel.cur >> WHEEL_SHIFT(level)) + 1;
+        }
+
+        for (k = 0; k < size; ++k) {
+            unsigned idx = (first + k) & (size - 1);
+            unsigned slot = level ? WHEEL_SLOT(level, idx) : idx;
+            pj_timer_id_t id = ht->wheel.head[slot];
+
+            if (id == 0)
+                continue;
+
+            do {
+                pj_timer_entry_dup *node = WHEEL_NODE(ht, id);
+                if (!found || PJ_TIME_VAL_LT(node->_timer_value, *t)) {
+                    *t = node->_timer_value;
+                    found = PJ_TRUE;
+                }
+                id = ht->wheel.next[id];
+            } while (id != ht->wheel.head[slot]);
+            break;
+        }
+    }
+}
+
+
+/* Remove the node at the specified heap slot, or, for the timing wheel,
+ * the node with the specified timer id.
+ */
 static pj_timer_entry_dup * remove_node( pj_timer_heap_t *ht, size_t slot)
 {
-    pj_timer_entry_dup *removed_node = ht->heap[slot];
+    pj_timer_entry_dup *removed_node;
+
+    if (ht->type == PJ_TIMER_HEAP_WHEEL) {
+        removed_node = WHEEL_NODE(ht, slot);
+        wheel_unlink(ht, (pj_timer_id_t)slot);
+    } else {
+        removed_node = ht->heap[slot];
+    }
 
     // Return this timer id to the freelist.
     push_freelist( ht, GET_FIELD(removed_node, _timer_id) );
@@ -335,6 +618,9 @@ static pj_timer_entry_dup * remove_node( pj_timer_heap_t *ht, size_t slot)
     }
     GET_FIELD(removed_node, _timer_id) = -1;
 
+    if (ht->type == PJ_TIMER_HEAP_WHEEL)
+        return removed_node;
+
 #if !PJ_TIMER_USE_LINKED_LIST
     // Only try to reheapify if we're not deleting the last entry.
 
@@ -404,7 +690,7 @@ static pj_status_t grow_heap(pj_timer_heap_t *ht)
 
     memcpy(new_timer_dups, ht->timer_dups,
            ht->max_size * sizeof(pj_timer_entry_dup));
-    for (i = 0; i < ht->cur_size; i++) {
+    for (i = 0; ht->type == PJ_TIMER_HEAP_BINARY && i < ht->cur_size; i++) {
         int idx = (int)(ht->heap[i] - ht->timer_dups);
         // Point to the address in the new array
         pj_assert(idx >= 0 && idx < (int)ht->max_size);
@@ -445,6 +731,23 @@ static pj_status_t grow_heap(pj_timer_heap_t *ht)
     for (i = ht->max_size; i < new_size; i++)
         ht->timer_ids[i] = -((pj_timer_id_t) (i + 1));
 
+    // Grow the timing wheel links.
+    if (ht->type == PJ_TIMER_HEAP_WHEEL) {
+        pj_timer_id_t *new_next, *new_prev;
+
+        new_next = (pj_timer_id_t*)
+                   pj_pool_alloc(ht->pool, new_size * sizeof(pj_timer_id_t));
+        new_prev = (pj_timer_id_t*)
+                   pj_pool_alloc(ht->pool, new_size * sizeof(pj_timer_id_t));
+        if (!new_next || !new_prev)
+            return PJ_ENOMEM;
+
+        memcpy(new_next, ht->wheel.next, ht->max_size*sizeof(pj_timer_id_t));
+        memcpy(new_prev, ht->wheel.prev, ht->max_size*sizeof(pj_timer_id_t));
+        ht->wheel.next = new_next;
+        ht->wheel.prev = new_prev;
+    }
+
     ht->max_size = new_size;
 
     return PJ_SUCCESS;
@@ -480,6 +783,27 @@ static pj_status_t insert_node(pj_timer_heap_t *ht,
 
     timer_copy->_timer_value = *future_time;
 
+    if (ht->type == PJ_TIMER_HEAP_WHEEL) {
+#if !PJ_TIMER_USE_COPY
+        ht->heap[new_node->_timer_id] = timer_copy;
+#endif
+        if (ht->cur_size == 0) {
+            /* Catch up with current time while the wheel is empty */
+            pj_time_val now;
+            pj_uint64_t now_tick;
+
+            pj_gettickcount(&now);
+            now_tick = wheel_tick(ht, &now, PJ_FALSE);
+            if (now_tick > ht->wheel.cur)
+                ht->wheel.cur = now_tick;
+        }
+        wheel_link(ht, new_node->_timer_id,
+                   wheel_tick(ht, future_time, PJ_TRUE));
+        ht->cur_size++;
+
+        return PJ_SUCCESS;
+    }
+
 #if !PJ_TIMER_USE_LINKED_LIST
     reheap_up(ht, timer_copy, ht->cur_size, HEAP_PARENT(ht->cur_size));
 #else
@@ -533,6 +857,7 @@ static int cancel( pj_timer_heap_t *ht,
                    unsigned flags)
 {
     long timer_node_slot;
+    pj_timer_entry_dup *timer_node;
 
     PJ_CHECK_STACK();
 
@@ -552,9 +877,16 @@ static int cancel( pj_timer_heap_t *ht,
         return 0;
     }
 
-    if (entry != GET_ENTRY(ht->heap[timer_node_slot])) {
+    if (ht->type == PJ_TIMER_HEAP_WHEEL) {
+        timer_node = WHEEL_NODE(ht, entry->_timer_id);
+        timer_node_slot = entry->_timer_id;
+    } else {
+        timer_node = ht->heap[timer_node_slot];
+    }
+
+    if (entry != GET_ENTRY(timer_node)) {
         if ((flags & F_DONT_ASSERT) == 0)
-            pj_assert(entry == GET_ENTRY(ht->heap[timer_node_slot]));
+            pj_assert(entry == GET_ENTRY(timer_node));
         entry->_timer_id = -1;
         return 0;
     } else {
@@ -580,7 +912,19 @@ PJ_DEF(pj_size_t) pj_timer_heap_mem_size(pj_size_t count)
            (count+2) * (sizeof(pj_timer_entry_dup*)+sizeof(pj_timer_id_t)+
            sizeof(pj_timer_entry_dup)) +
            /* lock, pool etc: */
-           132;
+           132 +
+           /* timing wheel slots and links, as the wheel may be selected
+            * at run time with pj_timer_heap_cfg:
+            */
+           WHEEL_SLOTS * sizeof(pj_timer_id_t) +
+           (count+2) * 2 * sizeof(pj_timer_id_t);
+}
+
+PJ_DEF(void) pj_timer_heap_cfg_default(pj_timer_heap_cfg *cfg)
+{
+    pj_bzero(cfg, sizeof(*cfg));
+    cfg->type = (pj_timer_heap_type)PJ_TIMER_HEAP_DEFAULT_TYPE;
+    cfg->resolution = PJ_TIMER_WHEEL_RESOLUTION;
 }
 
 /*
@@ -589,14 +933,31 @@ PJ_DEF(pj_size_t) pj_timer_heap_mem_size(pj_size_t count)
 PJ_DEF(pj_status_t) pj_timer_heap_create( pj_pool_t *pool,
                                           pj_size_t size,
                                           pj_timer_heap_t **p_heap)
+{
+    return pj_timer_heap_create2(pool, size, NULL, p_heap);
+}
+
+PJ_DEF(pj_status_t) pj_timer_heap_create2( pj_pool_t *pool,
+                                           pj_size_t size,
+                                           const pj_timer_heap_cfg *cfg,
+                                           pj_timer_heap_t **p_heap)
 {
     pj_timer_heap_t *ht;
+    pj_timer_heap_cfg dflt_cfg;
     pj_size_t i;
 
     PJ_ASSERT_RETURN(pool && p_heap, PJ_EINVAL);
 
     *p_heap = NULL;
 
+    if (!cfg) {
+        pj_timer_heap_cfg_default(&dflt_cfg);
+        cfg = &dflt_cfg;
+    }
+    PJ_ASSERT_RETURN(cfg->type == PJ_TIMER_HEAP_BINARY ||
+                     (cfg->type == PJ_TIMER_HEAP_WHEEL && cfg->resolution),
+                     PJ_EINVAL);
+
     /* Magic? */
     size += 2;
 
@@ -611,6 +972,7 @@ PJ_DEF(pj_status_t) pj_timer_heap_create( pj_pool_t *pool,
     ht->max_entries_per_poll = DEFAULT_MAX_TIMED_OUT_PER_POLL;
     ht->timer_ids_freelist = 1;
     ht->pool = pool;
+    ht->type = cfg->type;
 
     /* Lock. */
     ht->lock = NULL;
@@ -647,6 +1009,24 @@ PJ_DEF(pj_status_t) pj_timer_heap_create( pj_pool_t *pool,
     pj_list_init(&ht->head_list);
 #endif
 
+    if (ht->type == PJ_TIMER_HEAP_WHEEL) {
+        pj_time_val now;
+
+        ht->wheel.res = cfg->resolution;
+        pj_gettickcount(&now);
+        ht->wheel.base = TIME_VAL_MSEC(now);
+
+        ht->wheel.head = (pj_timer_id_t*)
+                         pj_pool_calloc(pool, WHEEL_SLOTS,
+                                        sizeof(pj_timer_id_t));
+        ht->wheel.next = (pj_timer_id_t*)
+                         pj_pool_alloc(pool, sizeof(pj_timer_id_t) * size);
+        ht->wheel.prev = (pj_timer_id_t*)
+                         pj_pool_alloc(pool, sizeof(pj_timer_id_t) * size);
+        if (!ht->wheel.head || !ht->wheel.next || !ht->wheel.prev)
+            return PJ_ENOMEM;
+    }
+
     *p_heap = ht;
     return PJ_SUCCESS;
 }
@@ -859,7 +1239,6 @@ PJ_DEF(unsigned) pj_timer_heap_poll( pj_timer_heap_t *ht,
                                      pj_time_val *next_delay )
 {
     pj_time_val now;
-    pj_time_val min_time_node = {0,0};
     unsigned count;
     pj_timer_id_t slot = 0;
 
@@ -875,25 +1254,30 @@ PJ_DEF(unsigned) pj_timer_heap_poll( pj_timer_heap_t *ht,
     count = 0;
     pj_gettickcount(&now);
 
-    if (ht->cur_size) {
-#if PJ_TIMER_USE_LINKED_LIST
-        slot = ht->timer_ids[GET_FIELD(ht->head_list.next, _timer_id)];
-#endif
-        min_time_node = ht->heap[slot]->_timer_value;
-    }
-
-    while ( ht->cur_size && 
-            PJ_TIME_VAL_LTE(min_time_node, now) &&
-            count < ht->max_entries_per_poll ) 
+    while ( ht->cur_size && count < ht->max_entries_per_poll ) 
     {
-        pj_timer_entry_dup *node = remove_node(ht, slot);
-        pj_timer_entry *entry = GET_ENTRY(node);
+        pj_timer_entry_dup *node;
+        pj_timer_entry *entry;
         /* Avoid re-use of this timer until the callback is done. */
         ///Not necessary, even causes problem (see also #2176).
         ///pj_timer_id_t node_timer_id = pop_freelist(ht);
         pj_grp_lock_t *grp_lock;
         pj_bool_t valid = PJ_TRUE;
 
+        if (ht->type == PJ_TIMER_HEAP_WHEEL) {
+            slot = wheel_expired(ht, &now);
+            if (slot == 0)
+                break;
+        } else {
+#if PJ_TIMER_USE_LINKED_LIST
+            slot = ht->timer_ids[GET_FIELD(ht->head_list.next, _timer_id)];
+#endif
+            if (!PJ_TIME_VAL_LTE(ht->heap[slot]->_timer_value, now))
+                break;
+        }
+
+        node = remove_node(ht, slot);
+        entry = GET_ENTRY(node);
         ++count;
 
         grp_lock = node->_grp_lock;
@@ -932,17 +1316,15 @@ PJ_DEF(unsigned) pj_timer_heap_poll( pj_timer_heap_t *ht,
         /* Now, the timer is really free for re-use. */
         ///push_freelist(ht, node_timer_id);
 
-        if (ht->cur_size) {
-#if PJ_TIMER_USE_LINKED_LIST
-            slot = ht->timer_ids[GET_FIELD(ht->head_list.next, _timer_id)];
-#endif
-            min_time_node = ht->heap[slot]->_timer_value;
-            /* Update now */
+        /* Update now */
+        if (ht->cur_size)
             pj_gettickcount(&now);
-        }
     }
     if (ht->cur_size && next_delay) {
-        *next_delay = ht->heap[0]->_timer_value;
+        if (ht->type == PJ_TIMER_HEAP_WHEEL)
+            wheel_next_time(ht, next_delay);
+        else
+            *next_delay = ht->heap[0]->_timer_value;
         if (count > 0)
             pj_gettickcount(&now);
         PJ_TIME_VAL_SUB(*next_delay, now);
@@ -971,13 +1353,33 @@ PJ_DEF(pj_status_t) pj_timer_heap_earliest_time( pj_timer_heap_t * ht,
         return PJ_ENOTFOUND;
 
     lock_timer_heap(ht);
-    *timeval = ht->heap[0]->_timer_value;
+    if (ht->type == PJ_TIMER_HEAP_WHEEL)
+        wheel_earliest_time(ht, timeval);
+    else
+        *timeval = ht->heap[0]->_timer_value;
     unlock_timer_heap(ht);
 
     return PJ_SUCCESS;
 }
 
 #if PJ_TIMER_DEBUG
+static void dump_entry(pj_timer_entry_dup *e, const pj_time_val *now)
+{
+    pj_time_val delta;
+
+    if (PJ_TIME_VAL_LTE(e->_timer_value, *now))
+        delta.sec = delta.msec = 0;
+    else {
+        delta = e->_timer_value;
+        PJ_TIME_VAL_SUB(delta, *now);
+    }
+
+    PJ_LOG(3,(THIS_FILE, "    %d\t%d\t%d.%03d\t%s:%d",
+              GET_FIELD(e, _timer_id), GET_FIELD(e, id),
+              (int)delta.sec, (int)delta.msec,
+              e->src_file, e->src_line));
+}
+
 PJ_DEF(void) pj_timer_heap_dump(pj_timer_heap_t *ht)
 {
     lock_timer_heap(ht);
@@ -989,9 +1391,8 @@ PJ_DEF(void) pj_timer_heap_dump(pj_timer_heap_t *ht)
     if (ht->cur_size) {
 #if PJ_TIMER_USE_LINKED_LIST
         pj_timer_entry_dup *tmp_dup;
-#else
-        unsigned i;
 #endif
+        unsigned i;
         pj_time_val now;
 
         PJ_LOG(3,(THIS_FILE, "  Entries: "));
@@ -1000,34 +1401,26 @@ PJ_DEF(void) pj_timer_heap_dump(pj_timer_heap_t *ht)
 
         pj_gettickcount(&now);
 
+        if (ht->type == PJ_TIMER_HEAP_WHEEL) {
+            for (i=1; i<(unsigned)ht->max_size; ++i) {
+                if (ht->timer_ids[i] >= 0)
+                    dump_entry(WHEEL_NODE(ht, i), &now);
+            }
+        } else {
 #if !PJ_TIMER_USE_LINKED_LIST
-        for (i=0; i<(unsigned)ht->cur_size; ++i)
-        {
-            pj_timer_entry_dup *e = ht->heap[i];
+            for (i=0; i<(unsigned)ht->cur_size; ++i)
+                dump_entry(ht->heap[i], &now);
 #else
-        for (tmp_dup = ht->head_list.next; tmp_dup != &ht->head_list;
-             tmp_dup = tmp_dup->next)
-        {
-            pj_timer_entry_dup *e = tmp_dup;
-#endif
-
-            pj_time_val delta;
-
-            if (PJ_TIME_VAL_LTE(e->_timer_value, now))
-                delta.sec = delta.msec = 0;
-            else {
-                delta = e->_timer_value;
-                PJ_TIME_VAL_SUB(delta, now);
+            PJ_UNUSED_ARG(i);
+            for (tmp_dup = ht->head_list.next; tmp_dup != &ht->head_list;
+                 tmp_dup = tmp_dup->next)
+            {
+                dump_entry(tmp_dup, &now);
             }
-
-            PJ_LOG(3,(THIS_FILE, "    %d\t%d\t%d.%03d\t%s:%d",
-                      GET_FIELD(e, _timer_id), GET_FIELD(e, id),
-                      (int)delta.sec, (int)delta.msec,
-                      e->src_file, e->src_line));
+#endif
         }
     }
 
     unlock_timer_heap(ht);
 }
 #endif
-
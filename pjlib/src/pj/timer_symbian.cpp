@@ -310,6 +310,26 @@ PJ_DEF(pj_status_t) pj_timer_heap_create( pj_pool_t *pool,
     return PJ_SUCCESS;
 }
 
+PJ_DEF(void) pj_timer_heap_cfg_default(pj_timer_heap_cfg *cfg)
+{
+    pj_bzero(cfg, sizeof(*cfg));
+    cfg->type = (pj_timer_heap_type)PJ_TIMER_HEAP_DEFAULT_TYPE;
+    cfg->resolution = PJ_TIMER_WHEEL_RESOLUTION;
+}
+
+/*
+ * Timers are driven by Symbian's active objects, hence the implementation
+ * type setting is ignored.
+ */
+PJ_DEF(pj_status_t) pj_timer_heap_create2( pj_pool_t *pool,
+                                           pj_size_t size,
+                                           const pj_timer_heap_cfg *cfg,
+                                           pj_timer_heap_t **p_heap)
+{
+    PJ_UNUSED_ARG(cfg);
+    return pj_timer_heap_create(pool, size, p_heap);
+}
+
 PJ_DEF(void) pj_timer_heap_destroy( pj_timer_heap_t *ht )
 {
     /* Cancel and delete pending active objects */
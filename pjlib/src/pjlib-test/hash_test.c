@@ -20,22 +20,28 @@
 #include <pj/rand.h>
 #include <pj/log.h>
 #include <pj/pool.h>
+#include <pj/ctype.h>
+#include <pj/os.h>
+#include <pj/string.h>
 #include "test.h"
 
+#define THIS_FILE   "hash_test.c"
+
 #if INCLUDE_HASH_TEST
 
 #define HASH_COUNT  31
-#define THIS_FILE   "hash_test.c"
 
 
-static int hash_test_with_key(pj_pool_t *pool, unsigned char key)
+static int hash_test_with_key(pj_pool_t *pool, unsigned options,
+                              unsigned char key)
 {
     pj_hash_table_t *ht;
     unsigned value = 0x12345;
     pj_hash_iterator_t it_buf, *it;
     unsigned *entry;
 
-    PJ_TEST_NOT_NULL( (ht=pj_hash_create(pool, HASH_COUNT)), NULL, return -10);
+    PJ_TEST_NOT_NULL( (ht=pj_hash_create2(pool, HASH_COUNT, options)), NULL,
+                      return -10);
 
     pj_hash_set(pool, ht, &key, sizeof(key), 0, &value);
 
@@ -61,7 +67,7 @@ static int hash_test_with_key(pj_pool_t *pool, unsigned char key)
 }
 
 
-static int hash_collision_test(pj_pool_t *pool)
+static int hash_collision_test(pj_pool_t *pool, unsigned options)
 {
     enum {
         COUNT = HASH_COUNT * 4
@@ -71,7 +77,8 @@ static int hash_collision_test(pj_pool_t *pool)
     unsigned char *values;
     unsigned i;
 
-    PJ_TEST_NOT_NULL((ht=pj_hash_create(pool, HASH_COUNT)), NULL, return -200);
+    PJ_TEST_NOT_NULL((ht=pj_hash_create2(pool, HASH_COUNT, options)), NULL,
+                     return -200);
 
     values = (unsigned char*) pj_pool_alloc(pool, COUNT);
 
@@ -101,34 +108,269 @@ static int hash_collision_test(pj_pool_t *pool)
 }
 
 
+/* Case insensitive keys, precalculated hash values and chaining */
+static int hash_lower_test(pj_pool_t *pool, unsigned options)
+{
+    pj_str_t upper = pj_str("z9hG4bK-Branch.ABCDEFGHIJKLMNOPQRSTUVWXYZ$INVITE");
+    pj_str_t lower = pj_str("z9hg4bk-branch.abcdefghijklmnopqrstuvwxyz$invite");
+    char result[64];
+    pj_hash_table_t *ht;
+    pj_uint32_t hval, hval2;
+    int value = 1;
+
+    hval = pj_hash_calc_tolower(0, result, &upper);
+    PJ_TEST_EQ(pj_memcmp(result, lower.ptr, lower.slen), 0, NULL,
+               return -300);
+    PJ_TEST_EQ(hval, pj_hash_calc(0, lower.ptr, (unsigned)lower.slen), NULL,
+               return -310);
+    PJ_TEST_EQ(hval, pj_hash_calc_tolower(0, NULL, &lower), NULL,
+               return -320);
+    PJ_TEST_EQ(pj_hash_calc(0, "abc", PJ_HASH_KEY_STRING),
+               pj_hash_calc(0, "abc", 3), NULL, return -330);
+
+    /* The initial value changes the result */
+    hval2 = pj_hash_calc(hval, lower.ptr, (unsigned)lower.slen);
+    PJ_TEST_NEQ(hval2, hval, NULL, return -340);
+
+    ht = pj_hash_create2(pool, HASH_COUNT, options);
+    PJ_TEST_NOT_NULL(ht, NULL, return -350);
+
+    pj_hash_set_lower(pool, ht, upper.ptr, (unsigned)upper.slen, 0, &value);
+    PJ_TEST_EQ(pj_hash_get_lower(ht, lower.ptr, (unsigned)lower.slen, NULL),
+               &value, NULL, return -360);
+    hval2 = 0;
+    PJ_TEST_EQ(pj_hash_get_lower(ht, upper.ptr, (unsigned)upper.slen, &hval2),
+               &value, NULL, return -370);
+    PJ_TEST_EQ(hval2, hval, NULL, return -380);
+    PJ_TEST_EQ(pj_hash_get(ht, upper.ptr, (unsigned)upper.slen, &hval),
+               &value, NULL, return -390);
+
+    pj_hash_set_lower(NULL, ht, lower.ptr, (unsigned)lower.slen, hval, NULL);
+    PJ_TEST_EQ(pj_hash_count(ht), 0, NULL, return -400);
+    PJ_TEST_EQ(pj_hash_get_lower(ht, upper.ptr, (unsigned)upper.slen, NULL),
+               NULL, NULL, return -410);
+
+    return 0;
+}
+
+/* Insert and remove many entries, with pool-less entries and removal
+ * while iterating.
+ */
+static int hash_churn_test(pj_pool_t *pool, unsigned options)
+{
+    enum { COUNT = 1000, ROUNDS = 20 };
+    pj_hash_table_t *ht;
+    pj_hash_entry_buf *bufs;
+    pj_hash_iterator_t it_buf, *it;
+    unsigned *keys;
+    pj_size_t used;
+    unsigned i, r, n;
+
+    ht = pj_hash_create2(pool, 16, options);
+    PJ_TEST_NOT_NULL(ht, NULL, return -500);
+
+    bufs = (pj_hash_entry_buf*)pj_pool_calloc(pool, COUNT,
+                                              sizeof(pj_hash_entry_buf));
+    keys = (unsigned*)pj_pool_calloc(pool, COUNT, sizeof(unsigned));
+
+    used = 0;
+    for (r = 0; r < ROUNDS; ++r) {
+        for (i = 0; i < COUNT; ++i) {
+            keys[i] = r * COUNT + i;
+            pj_hash_set_np(ht, &keys[i], sizeof(keys[i]), 0, bufs[i],
+                           &keys[i]);
+        }
+        PJ_TEST_EQ(pj_hash_count(ht), COUNT, NULL, return -510);
+
+        for (i = 0; i < COUNT; ++i) {
+            PJ_TEST_EQ(pj_hash_get(ht, &keys[i], sizeof(keys[i]), NULL),
+                       &keys[i], NULL, return -520);
+        }
+
+        /* Remove odd keys with pj_hash_set(), then the rest while
+         * iterating.
+         */
+        for (i = 1; i < COUNT; i += 2)
+            pj_hash_set(NULL, ht, &keys[i], sizeof(keys[i]), 0, NULL);
+        PJ_TEST_EQ(pj_hash_count(ht), COUNT/2, NULL, return -530);
+
+        n = 0;
+        it = pj_hash_first(ht, &it_buf);
+        while (it) {
+            unsigned *key = (unsigned*)pj_hash_this(ht, it);
+            pj_hash_iterator_t *next = pj_hash_next(ht, it);
+
+            PJ_TEST_EQ(*key % 2, 0, NULL, return -540);
+            pj_hash_set(NULL, ht, key, sizeof(*key), 0, NULL);
+            ++n;
+            it = next;
+        }
+        PJ_TEST_EQ(n, COUNT/2, NULL, return -550);
+        PJ_TEST_EQ(pj_hash_count(ht), 0, NULL, return -560);
+
+        /* The table must not keep allocating once it has grown */
+        if (r == 1)
+            used = pj_pool_get_used_size(pool);
+    }
+    PJ_TEST_EQ(pj_pool_get_used_size(pool), used, NULL, return -570);
+
+    return 0;
+}
+
+
 /*
  * Hash table test.
  */
 int hash_test(void)
 {
+    static const unsigned options[] = { 0, PJ_HASH_OPEN_ADDRESSING };
     pj_pool_t *pool = pj_pool_create(mem, "hash", 512, 512, NULL);
-    int rc;
-    unsigned i;
+    int rc = 0;
+    unsigned i, j;
 
-    /* Test to fill in each row in the table */
-    for (i=0; i<=HASH_COUNT; ++i) {
-        rc = hash_test_with_key(pool, (unsigned char)i);
-        if (rc != 0) {
-            pj_pool_release(pool);
-            return rc;
+    for (j=0; j<PJ_ARRAY_SIZE(options) && rc==0; ++j) {
+        /* Test to fill in each row in the table */
+        for (i=0; i<=HASH_COUNT && rc==0; ++i) {
+            rc = hash_test_with_key(pool, options[j], (unsigned char)i);
         }
-    }
 
-    /* Collision test */
-    rc = hash_collision_test(pool);
-    if (rc != 0) {
-        pj_pool_release(pool);
-        return rc;
+        /* Collision test */
+        if (rc == 0)
+            rc = hash_collision_test(pool, options[j]);
+
+        if (rc == 0)
+            rc = hash_lower_test(pool, options[j]);
+
+        if (rc == 0)
+            rc = hash_churn_test(pool, options[j]);
     }
 
     pj_pool_release(pool);
-    return 0;
+    return rc;
 }
 
 #endif  /* INCLUDE_HASH_TEST */
 
+
+#if INCLUDE_HASH_PERF_TEST
+
+#define PERF_KEY_LEN    44
+#define PERF_COUNT      100000
+
+/* The classic multiply-by-33 hash, for comparison */
+static pj_uint32_t hash33_tolower(pj_uint32_t hval, const char *key,
+                                  unsigned keylen)
+{
+    unsigned i;
+    for (i=0; i<keylen; ++i)
+        hval = hval * 33 + pj_tolower(key[i]);
+    return hval;
+}
+
+/* Transaction-like keys: branch parameter followed by the method */
+static char *create_keys(pj_pool_t *pool)
+{
+    char *keys = (char*)pj_pool_alloc(pool, PERF_COUNT * PERF_KEY_LEN);
+    unsigned i;
+
+    for (i=0; i<PERF_COUNT; ++i) {
+        char *key = keys + i*PERF_KEY_LEN;
+        pj_ansi_snprintf(key, PERF_KEY_LEN, "z9hG4bKPj%08x-%08x-%06u$INVITE",
+                         pj_rand(), pj_rand(), i);
+        pj_memset(key + pj_ansi_strlen(key), ' ',
+                  PERF_KEY_LEN - pj_ansi_strlen(key));
+    }
+    return keys;
+}
+
+static int bench_table(pj_pool_t *pool, const char *keys, unsigned options,
+                       unsigned size, const char *title)
+{
+    pj_hash_table_t *ht;
+    pj_hash_entry_buf *bufs;
+    pj_timestamp t0, t1, t2, t3;
+    unsigned i;
+
+    ht = pj_hash_create2(pool, size, options);
+    PJ_TEST_NOT_NULL(ht, NULL, return -10);
+    bufs = (pj_hash_entry_buf*)pj_pool_alloc(pool, PERF_COUNT *
+                                             sizeof(pj_hash_entry_buf));
+
+    pj_get_timestamp(&t0);
+    for (i=0; i<PERF_COUNT; ++i) {
+        pj_hash_set_np_lower(ht, keys + i*PERF_KEY_LEN, PERF_KEY_LEN, 0,
+                             bufs[i], (void*)(keys + i*PERF_KEY_LEN));
+    }
+    pj_get_timestamp(&t1);
+    for (i=0; i<PERF_COUNT; ++i) {
+        const char *key = keys + i*PERF_KEY_LEN;
+        PJ_TEST_EQ(pj_hash_get_lower(ht, key, PERF_KEY_LEN, NULL), key,
+                   NULL, return -20);
+    }
+    pj_get_timestamp(&t2);
+    for (i=0; i<PERF_COUNT; ++i) {
+        pj_hash_set_lower(NULL, ht, keys + i*PERF_KEY_LEN, PERF_KEY_LEN, 0,
+                          NULL);
+    }
+    pj_get_timestamp(&t3);
+    PJ_TEST_EQ(pj_hash_count(ht), 0, NULL, return -30);
+
+    PJ_LOG(3,(THIS_FILE, "..%s: insert %u ns, lookup %u ns, remove %u ns",
+              title,
+              (unsigned)(pj_elapsed_nanosec(&t0, &t1) / PERF_COUNT),
+              (unsigned)(pj_elapsed_nanosec(&t1, &t2) / PERF_COUNT),
+              (unsigned)(pj_elapsed_nanosec(&t2, &t3) / PERF_COUNT)));
+    return 0;
+}
+
+/*
+ * Hash function and hash table benchmark with 100k transaction-like keys.
+ */
+int hash_perf_test(void)
+{
+    pj_pool_t *pool;
+    pj_timestamp t0, t1, t2;
+    pj_uint32_t sum = 0;
+    char *keys;
+    unsigned i;
+    int rc;
+
+    pool = pj_pool_create(mem, "hashperf", 64000, 64000, NULL);
+    PJ_TEST_NOT_NULL(pool, NULL, return -1);
+
+    keys = create_keys(pool);
+
+    PJ_LOG(3,(THIS_FILE, "Benchmarking hash with %d keys of %d bytes..",
+              PERF_COUNT, PERF_KEY_LEN));
+
+    pj_get_timestamp(&t0);
+    for (i=0; i<PERF_COUNT; ++i)
+        sum += hash33_tolower(0, keys + i*PERF_KEY_LEN, PERF_KEY_LEN);
+    pj_get_timestamp(&t1);
+    for (i=0; i<PERF_COUNT; ++i) {
+        pj_str_t key;
+        key.ptr = keys + i*PERF_KEY_LEN;
+        key.slen = PERF_KEY_LEN;
+        sum += pj_hash_calc_tolower(0, NULL, &key);
+    }
+    pj_get_timestamp(&t2);
+
+    PJ_LOG(3,(THIS_FILE, "..hash33 %u ns/key, pj_hash_calc_tolower %u ns/key "
+              "(%x)",
+              (unsigned)(pj_elapsed_nanosec(&t0, &t1) / PERF_COUNT),
+              (unsigned)(pj_elapsed_nanosec(&t1, &t2) / PERF_COUNT),
+              sum & 0xF));
+
+    /* Chained table sized like the default transaction table, and open
+     * addressing table starting small.
+     */
+    rc = bench_table(pool, keys, 0, 1023, "chained, 1023 rows");
+    if (rc == 0)
+        rc = bench_table(pool, keys, PJ_HASH_OPEN_ADDRESSING, 1023,
+                         "open addressing");
+
+    pj_pool_release(pool);
+    return rc;
+}
+
+#endif  /* INCLUDE_HASH_PERF_TEST */
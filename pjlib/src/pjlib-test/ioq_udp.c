@@ -189,7 +189,8 @@ static int compliance_test(const pj_ioqueue_cfg *cfg)
     ioque_name = pj_str((char*)pj_ioqueue_name());
     if (pj_strncmp(&ioque_name, pj_cstr(&ioqueue_type, "epoll"), 5) == 0 ||
         pj_strncmp(&ioque_name, pj_cstr(&ioqueue_type, "kqueue"), 6) == 0 ||
-        pj_strncmp(&ioque_name, pj_cstr(&ioqueue_type, "iocp"), 4) == 0) {
+        pj_strncmp(&ioque_name, pj_cstr(&ioqueue_type, "iocp"), 4) == 0 ||
+        pj_strncmp(&ioque_name, pj_cstr(&ioqueue_type, "io_uring"), 8) == 0) {
       if (pj_ioqueue_get_os_handle(ioque) == NULL) {
         PJ_LOG(1,(
           THIS_FILE,
@@ -1176,6 +1177,122 @@ on_error:
     return -1;
 }
 
+/*
+ * group_test()
+ * Register sockets to an ioqueue group and check that each socket's
+ * completion is delivered by polling the shard it was assigned to.
+ */
+#define GRP_SHARD_CNT   3
+#define GRP_SOCK_CNT    6
+
+static int group_test(void)
+{
+    pj_pool_t *pool;
+    pj_ioqueue_group_t *grp = NULL;
+    pj_sock_t ssock[GRP_SOCK_CNT], csock = PJ_INVALID_SOCKET;
+    pj_ioqueue_key_t *key[GRP_SOCK_CNT];
+    pj_ioqueue_op_key_t read_op[GRP_SOCK_CNT];
+    char buf[GRP_SOCK_CNT][16];
+    unsigned i, j;
+    int rc = 0;
+
+    for (i=0; i<GRP_SOCK_CNT; ++i) {
+        ssock[i] = PJ_INVALID_SOCKET;
+        key[i] = NULL;
+    }
+
+    pool = pj_pool_create(mem, "grptest", 4000, 4000, NULL);
+    if (!pool)
+        return -700;
+
+    if (pj_ioqueue_group_create(pool, GRP_SHARD_CNT, GRP_SOCK_CNT, NULL,
+                                &grp) != PJ_SUCCESS)
+    {
+        rc = -710; goto on_return;
+    }
+    if (pj_ioqueue_group_get_count(grp) != GRP_SHARD_CNT) {
+        rc = -715; goto on_return;
+    }
+
+    if (pj_sock_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0, &csock)) {
+        rc = -720; goto on_return;
+    }
+
+    for (i=0; i<GRP_SOCK_CNT; ++i) {
+        pj_ssize_t size = sizeof(buf[i]);
+        pj_status_t status;
+
+        if (app_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0, -1, &ssock[i])) {
+            rc = -730; goto on_return;
+        }
+        if (pj_ioqueue_group_register_sock2(pool, grp, ssock[i], NULL, NULL,
+                                            &test_cb, &key[i]) != PJ_SUCCESS)
+        {
+            rc = -740; goto on_return;
+        }
+        pj_ioqueue_op_key_init(&read_op[i], sizeof(read_op[i]));
+        status = pj_ioqueue_recv(key[i], &read_op[i], buf[i], &size, 0);
+        if (status != PJ_EPENDING) {
+            rc = -750; goto on_return;
+        }
+    }
+
+    for (i=0; i<GRP_SOCK_CNT; ++i) {
+        pj_ioqueue_t *ioq;
+        pj_sockaddr_in addr;
+        int addrlen = sizeof(addr);
+        pj_ssize_t size = 4;
+        pj_time_val timeout = {0, 0};
+        pj_timestamp t0, t1;
+
+        /* Find the shard the socket was assigned to */
+        ioq = pj_ioqueue_group_select(grp, (pj_uint32_t)(pj_ssize_t)ssock[i]);
+
+        pj_sock_getsockname(ssock[i], &addr, &addrlen);
+        addr.sin_addr = pj_inet_addr2("127.0.0.1");
+        if (pj_sock_sendto(csock, "grp", &size, 0, &addr, addrlen)) {
+            rc = -760; goto on_return;
+        }
+
+        /* Other shards must not report the completion */
+        callback_read_key = NULL;
+        for (j=0; j<GRP_SHARD_CNT; ++j) {
+            pj_ioqueue_t *other = pj_ioqueue_group_get(grp, j);
+            if (other != ioq)
+                pj_ioqueue_poll(other, &timeout);
+        }
+        if (callback_read_key != NULL) {
+            rc = -770; goto on_return;
+        }
+
+        pj_get_timestamp(&t0);
+        do {
+            timeout.msec = 10;
+            pj_ioqueue_poll(ioq, &timeout);
+            pj_get_timestamp(&t1);
+        } while (callback_read_key == NULL &&
+                 pj_elapsed_msec(&t0, &t1) < 1000);
+
+        if (callback_read_key != key[i] || callback_read_size != 4) {
+            rc = -780; goto on_return;
+        }
+    }
+
+on_return:
+    for (i=0; i<GRP_SOCK_CNT; ++i) {
+        if (key[i])
+            pj_ioqueue_unregister(key[i]);
+        else if (ssock[i] != PJ_INVALID_SOCKET)
+            pj_sock_close(ssock[i]);
+    }
+    if (csock != PJ_INVALID_SOCKET)
+        pj_sock_close(csock);
+    if (grp)
+        pj_ioqueue_group_destroy(grp);
+    pj_pool_release(pool);
+    return rc;
+}
+
 static int udp_ioqueue_test_imp(const pj_ioqueue_cfg *cfg)
 {
     int status;
@@ -1294,6 +1411,10 @@ int udp_ioqueue_test()
     }
 #endif
 
+    PJ_LOG(3, (THIS_FILE, "..%s ioqueue group test", pj_ioqueue_name()));
+    rc = group_test();
+    if (rc) return rc;
+
     return 0;
 }
 
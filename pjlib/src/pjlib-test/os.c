@@ -19,6 +19,9 @@
 #include "test.h"
 #include <pj/log.h>
 #include <pj/os.h>
+#include <pj/file_access.h>
+#include <pj/file_io.h>
+#include <pj/pool.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -232,6 +235,178 @@ int log_test(void)
     return 0;
 }
 
+#if INCLUDE_LOG_ASYNC_TEST
+
+#define LOG_ASYNC_THREADS       4
+#define LOG_ASYNC_MSGS          2000
+#define LOG_ASYNC_FILE          "logasync.txt"
+
+static struct log_async_cap
+{
+    unsigned    count;
+    unsigned    notices;
+    unsigned    notice_dropped;
+    int         last_seq[LOG_ASYNC_THREADS];
+    unsigned    out_of_order;
+    pj_bool_t   slow;
+} cap;
+
+/* Called by the writer thread only */
+static void log_async_write(int level, const char *buffer, int len)
+{
+    int tid, seq;
+    unsigned long dropped;
+
+    PJ_UNUSED_ARG(level);
+    PJ_UNUSED_ARG(len);
+
+    if (sscanf(buffer, "t%d m%d", &tid, &seq) == 2 &&
+        tid >= 0 && tid < LOG_ASYNC_THREADS)
+    {
+        if (seq <= cap.last_seq[tid])
+            ++cap.out_of_order;
+        cap.last_seq[tid] = seq;
+        ++cap.count;
+    } else if (sscanf(buffer, "Log queue full, %lu", &dropped) == 1) {
+        ++cap.notices;
+        cap.notice_dropped += (unsigned)dropped;
+    }
+
+    if (cap.slow)
+        pj_thread_sleep(0);
+}
+
+static int log_async_worker(void *arg)
+{
+    int tid = (int)(pj_ssize_t)arg;
+    int i;
+
+    for (i = 0; i < LOG_ASYNC_MSGS; ++i)
+        PJ_LOG(3,(THIS_FILE, "t%d m%d", tid, i));
+
+    return 0;
+}
+
+/* Log from several threads at once and check what comes out of the
+ * writer thread.
+ */
+static int log_async_mt(pj_pool_t *pool, pj_bool_t drop)
+{
+    enum { TOTAL = LOG_ASYNC_THREADS * LOG_ASYNC_MSGS };
+    pj_log_async_param prm;
+    pj_log_async_stat stat;
+    pj_thread_t *threads[LOG_ASYNC_THREADS];
+    unsigned i;
+
+    pj_bzero(&cap, sizeof(cap));
+    for (i = 0; i < LOG_ASYNC_THREADS; ++i)
+        cap.last_seq[i] = -1;
+    cap.slow = drop;
+
+    pj_log_async_param_default(&prm);
+    prm.queue_size = drop ? 4 : 16;
+    prm.drop_on_overflow = drop;
+    PJ_TEST_SUCCESS(pj_log_async_start(pool, &prm), NULL, return -10);
+    PJ_TEST_EQ(pj_log_async_start(pool, &prm), PJ_EEXISTS, NULL,
+               { pj_log_async_stop(); return -15; });
+
+    for (i = 0; i < LOG_ASYNC_THREADS; ++i) {
+        PJ_TEST_SUCCESS(pj_thread_create(pool, "logasync", &log_async_worker,
+                                         (void*)(pj_ssize_t)i, 0, 0,
+                                         &threads[i]),
+                        NULL, { pj_log_async_stop(); return -20; });
+    }
+    for (i = 0; i < LOG_ASYNC_THREADS; ++i) {
+        pj_thread_join(threads[i]);
+        pj_thread_destroy(threads[i]);
+    }
+
+    PJ_TEST_SUCCESS(pj_log_async_stop(), NULL, return -30);
+    PJ_TEST_EQ(pj_log_async_stop(), PJ_EINVALIDOP, NULL, return -35);
+    PJ_TEST_SUCCESS(pj_log_async_get_stat(&stat), NULL, return -40);
+
+    PJ_TEST_EQ(cap.out_of_order, 0, "messages reordered", return -50);
+    PJ_TEST_EQ(stat.written + stat.dropped, TOTAL, NULL,
+               return -60);
+    PJ_TEST_EQ(cap.count, stat.written, NULL, return -70);
+    PJ_TEST_EQ(cap.notice_dropped, stat.dropped, NULL, return -80);
+    if (!drop) {
+        PJ_TEST_EQ(stat.dropped, 0, NULL, return -90);
+    }
+    PJ_TEST_LTE(stat.max_pending, prm.queue_size, NULL, return -100);
+
+    return 0;
+}
+
+/* Batched file output */
+static int log_async_file(pj_pool_t *pool)
+{
+    enum { COUNT = 1000, LEN = 7 };
+    pj_log_async_param prm;
+    pj_oshandle_t fd;
+    unsigned i;
+    int rc = 0;
+
+    PJ_TEST_SUCCESS(pj_file_open(pool, LOG_ASYNC_FILE, PJ_O_WRONLY, &fd),
+                    NULL, return -200);
+
+    pj_log_async_param_default(&prm);
+    prm.queue_size = 32;
+    prm.drop_on_overflow = PJ_FALSE;
+    prm.file = fd;
+    /* Force a few flushes in the middle of a batch */
+    prm.file_buf_size = PJ_LOG_MAX_SIZE;
+    PJ_TEST_SUCCESS(pj_log_async_start(pool, &prm), NULL,
+                    { rc = -210; goto on_return; });
+
+    pj_log_set_decor(PJ_LOG_HAS_NEWLINE);
+    for (i = 0; i < COUNT; ++i)
+        PJ_LOG(3,(THIS_FILE, "m%05u", i));
+
+    PJ_TEST_SUCCESS(pj_log_async_stop(), NULL, rc = -220);
+
+on_return:
+    pj_file_close(fd);
+    if (rc == 0) {
+        PJ_TEST_EQ(pj_file_size(LOG_ASYNC_FILE), COUNT * LEN, NULL,
+                   rc = -230);
+    }
+    pj_file_delete(LOG_ASYNC_FILE);
+    return rc;
+}
+
+int log_async_test(void)
+{
+    pj_log_func *old_func = pj_log_get_log_func();
+    unsigned old_decor = pj_log_get_decor();
+    int old_level = pj_log_get_level();
+    pj_pool_t *pool;
+    int rc;
+
+    pool = pj_pool_create(mem, "logasync", 4000, 4000, NULL);
+    if (!pool)
+        return -1;
+
+    pj_log_set_log_func(&log_async_write);
+    pj_log_set_decor(0);
+    pj_log_set_level(3);
+
+    rc = log_async_mt(pool, PJ_FALSE);
+    if (rc == 0)
+        rc = log_async_mt(pool, PJ_TRUE);
+    if (rc == 0)
+        rc = log_async_file(pool);
+
+    pj_log_set_log_func(old_func);
+    pj_log_set_decor(old_decor);
+    pj_log_set_level(old_level);
+    pj_pool_release(pool);
+
+    return rc;
+}
+
+#endif  /* INCLUDE_LOG_ASYNC_TEST */
+
 int os_test(void)
 {
     const pj_sys_info *si;
@@ -352,6 +352,75 @@ static int pool_buf_test(void)
 }
 
 
+#if PJ_HAS_POOL_ALT_API == 0
+/* Create and release pools, as a thread would. */
+static int magazine_worker(void *arg)
+{
+    pj_caching_pool *cp = (pj_caching_pool*)arg;
+    pj_pool_t *pools[16];
+    unsigned i, round;
+
+    for (round = 0; round < 4; ++round) {
+        for (i = 0; i < PJ_ARRAY_SIZE(pools); ++i) {
+            pools[i] = pj_pool_create(&cp->factory, "mag", 1000, 0, NULL);
+            if (!pools[i])
+                return -1;
+        }
+        for (i = 0; i < PJ_ARRAY_SIZE(pools); ++i)
+            pj_pool_release(pools[i]);
+    }
+
+    return 0;
+}
+
+/* Test that pools cached in the thread magazines count against the
+ * maximum capacity and are given back when the thread exits.
+ */
+static int magazine_test(void)
+{
+    enum { MAX_CAP = 4 * 1024 };
+    pj_caching_pool cp;
+    pj_pool_t *pool = NULL;
+    pj_thread_t *thread;
+    int rc = 0;
+
+    PJ_LOG(3,("test", "...magazine_test()"));
+
+    /* The cache keeps no more than max_capacity */
+    pj_caching_pool_init(&cp, NULL, MAX_CAP);
+    PJ_TEST_EQ(magazine_worker(&cp), 0, NULL, { rc = -300; goto on_return; });
+    PJ_TEST_LTE(cp.capacity, MAX_CAP, "magazines exceed max_capacity",
+                { rc = -310; goto on_return; });
+
+    /* The calling thread's magazine can be flushed */
+    pj_caching_pool_flush_thread(&cp);
+    PJ_TEST_TRUE(pj_list_empty(&cp.mag_list), NULL,
+                 { rc = -320; goto on_return; });
+    pj_caching_pool_destroy(&cp);
+
+    /* The magazine of an exiting thread is given back */
+    pj_caching_pool_init(&cp, NULL, 1024 * 1024);
+    pool = pj_pool_create(mem, "magthread", 512, 512, NULL);
+    PJ_TEST_SUCCESS(pj_thread_create(pool, "magthread", &magazine_worker,
+                                     &cp, 0, 0, &thread),
+                    NULL, { rc = -330; goto on_return; });
+    pj_thread_join(thread);
+    pj_thread_destroy(thread);
+
+    PJ_TEST_TRUE(pj_list_empty(&cp.mag_list), "magazine not flushed",
+                 { rc = -340; goto on_return; });
+    PJ_TEST_EQ(cp.used_count, 0, NULL, { rc = -350; goto on_return; });
+    PJ_TEST_GT(cp.capacity, 0, "pools not returned to the free list",
+               { rc = -360; goto on_return; });
+
+on_return:
+    pj_caching_pool_destroy(&cp);
+    if (pool)
+        pj_pool_release(pool);
+    return rc;
+}
+#endif  //PJ_HAS_POOL_ALT_API == 0
+
 int pool_test(void)
 {
     enum { LOOP = 2 };
@@ -385,6 +454,10 @@ int pool_test(void)
     rc = pool_buf_test();
     if (rc != 0)
         return rc;
+
+    rc = magazine_test();
+    if (rc != 0)
+        return rc;
 #endif  //PJ_HAS_POOL_ALT_API == 0
 
     PJ_UNUSED_ARG(loop);
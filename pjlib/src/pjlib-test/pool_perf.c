@@ -117,6 +117,107 @@ static int pool_test_malloc_free()
 
 #endif /* PJ_SYMBIAN */
 
+/*
+ * Multi-threaded create/release of short-lived pools, similar to what
+ * SIP transactions and transmit buffers do.
+ */
+#define MT_MAX_THREADS      8
+#define MT_ITERATIONS       100000
+#define MT_POOLS_HELD       4
+
+static int pool_mt_worker(void *arg)
+{
+    pj_pool_factory *pf = (pj_pool_factory*)arg;
+    pj_pool_t *pools[MT_POOLS_HELD];
+    unsigned i, j;
+
+    for (i=0; i<MT_ITERATIONS/MT_POOLS_HELD; ++i) {
+        for (j=0; j<MT_POOLS_HELD; ++j) {
+            pools[j] = pj_pool_create(pf, "mt", 512 << j, 512, NULL);
+            if (!pools[j])
+                return -1;
+            pj_pool_alloc(pools[j], 64 + j*100);
+        }
+        for (j=0; j<MT_POOLS_HELD; ++j)
+            pj_pool_release(pools[j]);
+    }
+    return 0;
+}
+
+static int pool_mt_bench(unsigned thread_cnt, unsigned magazine_size,
+                         pj_uint32_t *rate)
+{
+    pj_caching_pool cp;
+    pj_pool_t *pool;
+    pj_thread_t *threads[MT_MAX_THREADS];
+    pj_timestamp start, end;
+    pj_uint32_t usec;
+    unsigned i;
+    int rc = 0;
+
+    pool = pj_pool_create(mem, NULL, 512, 512, NULL);
+    if (!pool)
+        return -10;
+
+    pj_caching_pool_init(&cp, NULL, 1024*1024);
+    if (cp.magazine_size > magazine_size)
+        cp.magazine_size = magazine_size;
+
+    pj_get_timestamp(&start);
+    for (i=0; i<thread_cnt; ++i) {
+        if (pj_thread_create(pool, "pool_mt", &pool_mt_worker, &cp.factory,
+                             0, 0, &threads[i]) != PJ_SUCCESS)
+        {
+            thread_cnt = i;
+            rc = -20;
+            break;
+        }
+    }
+    for (i=0; i<thread_cnt; ++i) {
+        pj_thread_join(threads[i]);
+        pj_thread_destroy(threads[i]);
+    }
+    pj_get_timestamp(&end);
+
+    if (cp.used_count != 0) {
+        PJ_LOG(3,(THIS_FILE, "   error: %lu pools not released",
+                  (unsigned long)cp.used_count));
+        rc = -30;
+    }
+    pj_caching_pool_destroy(&cp);
+    pj_pool_release(pool);
+
+    usec = pj_elapsed_usec(&start, &end);
+    if (usec == 0) usec = 1;
+    *rate = (pj_uint32_t)((pj_uint64_t)thread_cnt * MT_ITERATIONS *
+                          1000000 / usec);
+    return rc;
+}
+
+static int pool_mt_perf_test(void)
+{
+    unsigned thread_cnt;
+
+    PJ_LOG(3, (THIS_FILE, "Benchmarking multithreaded pool create/release.."));
+
+    for (thread_cnt=1; thread_cnt<=MT_MAX_THREADS; thread_cnt*=2) {
+        pj_uint32_t rate_lock, rate_mag;
+        int rc;
+
+        rc = pool_mt_bench(thread_cnt, 0, &rate_lock);
+        if (rc == 0)
+            rc = pool_mt_bench(thread_cnt, PJ_CACHING_POOL_MAGAZINE_SIZE,
+                               &rate_mag);
+        if (rc != 0)
+            return rc;
+
+        PJ_LOG(3, (THIS_FILE, "..%d thread(s): %u pools/sec without "
+                              "magazines, %u pools/sec with magazines",
+                   thread_cnt, rate_lock, rate_mag));
+    }
+    return 0;
+}
+
 int pool_perf_test()
 {
     unsigned i;
@@ -185,6 +286,14 @@ int pool_perf_test()
     PJ_LOG(3, (THIS_FILE, "..pool speedup over malloc best=%dx, worst=%dx", 
                           (int)(malloc_time/best),
                           (int)(malloc_time/worst)));
+
+#if PJ_HAS_THREADS
+    if (pool_mt_perf_test())
+        return 8;
+#else
+    PJ_UNUSED_ARG(pool_mt_perf_test);
+#endif
+
     return 0;
 }
 
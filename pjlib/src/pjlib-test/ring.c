@@ -0,0 +1,398 @@
+/*
+ * Copyright (C) 2025 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+/* To prevent warning about "translation unit is empty"
+ * when this test is disabled.
+ */
+int dummy_ring_test;
+
+#if INCLUDE_RING_TEST || INCLUDE_RING_PERF_TEST
+
+#include <pjlib.h>
+
+#define THIS_FILE   "ring.c"
+
+#define MT_MAX_THREADS  4
+#define BATCH           16
+
+/* Element used in the tests. A producer tags its elements with its id
+ * and a per-producer sequence, so consumers can check ordering.
+ */
+typedef struct elem_t
+{
+    pj_uint32_t     prod_id;
+    pj_uint32_t     seq;
+    char            payload[24];
+} elem_t;
+
+static const char *type_name(pj_ring_type type)
+{
+    return type == PJ_RING_MPMC ? "mpmc" : "spsc";
+}
+
+
+#define SENTINEL    0xFFFFFFFF
+
+typedef struct mt_ctx
+{
+    pj_ring_t      *ring;
+    unsigned        item_cnt;       /* Per producer */
+    unsigned        prod_cnt;
+    unsigned        batch;
+} mt_ctx;
+
+typedef struct mt_arg
+{
+    mt_ctx         *ctx;
+    pj_uint32_t     id;
+    unsigned        consumed;
+    unsigned        errors;
+} mt_arg;
+
+static void push_all(mt_ctx *ctx, const elem_t *elems, unsigned cnt)
+{
+    while (cnt) {
+        unsigned n;
+
+        if (ctx->batch == 1 || cnt == 1)
+            n = (pj_ring_push(ctx->ring, elems) == PJ_SUCCESS);
+        else
+            n = pj_ring_push_n(ctx->ring, elems, cnt);
+
+        if (n == 0)
+            pj_thread_sleep(0);
+        elems += n;
+        cnt -= n;
+    }
+}
+
+static int producer_thread(void *p)
+{
+    mt_arg *arg = (mt_arg*)p;
+    mt_ctx *ctx = arg->ctx;
+    elem_t elems[BATCH];
+    unsigned sent = 0;
+
+    pj_bzero(elems, sizeof(elems));
+
+    while (sent < ctx->item_cnt) {
+        unsigned i, n = ctx->batch;
+
+        if (n > ctx->item_cnt - sent)
+            n = ctx->item_cnt - sent;
+
+        for (i = 0; i < n; ++i) {
+            elems[i].prod_id = arg->id;
+            elems[i].seq = sent + i;
+        }
+        push_all(ctx, elems, n);
+        sent += n;
+    }
+    return 0;
+}
+
+/* Consume until a sentinel is received */
+static int consumer_thread(void *p)
+{
+    mt_arg *arg = (mt_arg*)p;
+    mt_ctx *ctx = arg->ctx;
+    pj_uint32_t next_seq[MT_MAX_THREADS];
+    elem_t elems[BATCH];
+
+    pj_bzero(next_seq, sizeof(next_seq));
+
+    for (;;) {
+        unsigned i, n;
+
+        if (ctx->batch == 1)
+            n = (pj_ring_pop(ctx->ring, &elems[0]) == PJ_SUCCESS);
+        else
+            n = pj_ring_pop_n(ctx->ring, elems, ctx->batch);
+
+        if (n == 0) {
+            pj_thread_sleep(0);
+            continue;
+        }
+
+        for (i = 0; i < n; ++i) {
+            elem_t *e = &elems[i];
+
+            if (e->prod_id == SENTINEL) {
+                /* Sentinels are pushed after all other elements, one for
+                 * each consumer. Give the extra ones back.
+                 */
+                for (++i; i < n; ++i) {
+                    if (elems[i].prod_id != SENTINEL)
+                        ++arg->errors;
+                }
+                if (e != &elems[n-1])
+                    push_all(ctx, e + 1, (unsigned)(&elems[n-1] - e));
+                return 0;
+            }
+
+            /* Elements of a producer must come out in order, although
+             * with several consumers each one only sees some of them.
+             */
+            if (e->prod_id >= ctx->prod_cnt || e->seq < next_seq[e->prod_id])
+                ++arg->errors;
+            else
+                next_seq[e->prod_id] = e->seq + 1;
+            ++arg->consumed;
+        }
+    }
+}
+
+/* Run producers and consumers over a ring, and optionally return the
+ * elapsed usec.
+ */
+static int run_mt(pj_pool_t *pool, pj_ring_type type, unsigned capacity,
+                  unsigned prod_cnt, unsigned cons_cnt, unsigned item_cnt,
+                  unsigned batch, pj_uint32_t *p_usec)
+{
+    mt_ctx ctx;
+    mt_arg args[MT_MAX_THREADS * 2];
+    pj_thread_t *threads[MT_MAX_THREADS * 2];
+    elem_t sentinel;
+    pj_timestamp start, end;
+    unsigned i, consumed = 0, errors = 0;
+
+    pj_assert(prod_cnt <= MT_MAX_THREADS && cons_cnt <= MT_MAX_THREADS);
+
+    pj_bzero(&ctx, sizeof(ctx));
+    ctx.item_cnt = item_cnt;
+    ctx.prod_cnt = prod_cnt;
+    ctx.batch = batch;
+
+    PJ_TEST_SUCCESS(pj_ring_create(pool, type, capacity, sizeof(elem_t),
+                                   &ctx.ring), NULL, return -100);
+
+    pj_bzero(args, sizeof(args));
+    pj_get_timestamp(&start);
+    for (i = 0; i < prod_cnt + cons_cnt; ++i) {
+        args[i].ctx = &ctx;
+        args[i].id = (i < prod_cnt) ? i : i - prod_cnt;
+        PJ_TEST_SUCCESS(pj_thread_create(pool, "ring",
+                                         (i < prod_cnt) ? &producer_thread :
+                                                          &consumer_thread,
+                                         &args[i], 0, 0, &threads[i]),
+                        NULL, return -110);
+    }
+
+    for (i = 0; i < prod_cnt; ++i) {
+        pj_thread_join(threads[i]);
+        pj_thread_destroy(threads[i]);
+    }
+
+    /* Producers are done, the sentinels will be the last elements */
+    pj_bzero(&sentinel, sizeof(sentinel));
+    sentinel.prod_id = SENTINEL;
+    for (i = 0; i < cons_cnt; ++i)
+        push_all(&ctx, &sentinel, 1);
+
+    for (i = prod_cnt; i < prod_cnt + cons_cnt; ++i) {
+        pj_thread_join(threads[i]);
+        pj_thread_destroy(threads[i]);
+        consumed += args[i].consumed;
+        errors += args[i].errors;
+    }
+    pj_get_timestamp(&end);
+
+    PJ_TEST_EQ(errors, 0, "out of order elements", return -120);
+    PJ_TEST_EQ(consumed, prod_cnt * item_cnt, NULL, return -121);
+    PJ_TEST_EQ(pj_ring_size(ctx.ring), 0, NULL, return -122);
+
+    pj_ring_destroy(ctx.ring);
+
+    if (p_usec) {
+        *p_usec = pj_elapsed_usec(&start, &end);
+        if (*p_usec == 0)
+            *p_usec = 1;
+    }
+    return 0;
+}
+
+#endif  /* INCLUDE_RING_TEST || INCLUDE_RING_PERF_TEST */
+
+
+#if INCLUDE_RING_TEST
+
+static int ring_basic_test(pj_pool_t *pool, pj_ring_type type)
+{
+    pj_ring_t *ring;
+    elem_t e, elems[BATCH];
+    unsigned i, round, pushed, popped, n;
+
+    PJ_LOG(3,(THIS_FILE, "  %s basic test", type_name(type)));
+
+    /* Capacity is rounded up to power of two */
+    PJ_TEST_SUCCESS(pj_ring_create(pool, type, 5, sizeof(elem_t), &ring),
+                    NULL, return -10);
+    PJ_TEST_EQ(pj_ring_capacity(ring), 8, NULL, return -11);
+    PJ_TEST_EQ(pj_ring_size(ring), 0, NULL, return -12);
+
+    /* Pop from empty ring */
+    PJ_TEST_EQ(pj_ring_pop(ring, &e), PJ_ENOTFOUND, NULL, return -13);
+    PJ_TEST_EQ(pj_ring_pop_n(ring, elems, BATCH), 0, NULL, return -14);
+
+    /* Fill it up */
+    pj_bzero(&e, sizeof(e));
+    for (i = 0; i < 8; ++i) {
+        e.seq = i;
+        PJ_TEST_SUCCESS(pj_ring_push(ring, &e), NULL, return -20);
+    }
+    PJ_TEST_EQ(pj_ring_push(ring, &e), PJ_ETOOMANY, NULL, return -21);
+    PJ_TEST_EQ(pj_ring_push_n(ring, elems, 2), 0, NULL, return -22);
+    PJ_TEST_EQ(pj_ring_size(ring), 8, NULL, return -23);
+
+    /* Drain it in order */
+    for (i = 0; i < 8; ++i) {
+        PJ_TEST_SUCCESS(pj_ring_pop(ring, &e), NULL, return -30);
+        PJ_TEST_EQ(e.seq, i, NULL, return -31);
+    }
+    PJ_TEST_EQ(pj_ring_pop(ring, &e), PJ_ENOTFOUND, NULL, return -32);
+
+    /* Batches of different sizes across many wrap-arounds. */
+    pushed = popped = 0;
+    for (round = 0; round < 1000; ++round) {
+        unsigned want = (round % 5) + 1;
+
+        for (i = 0; i < want; ++i) {
+            pj_bzero(&elems[i], sizeof(elem_t));
+            elems[i].seq = pushed + i;
+        }
+        n = pj_ring_push_n(ring, elems, want);
+        PJ_TEST_LTE(n, want, NULL, return -40);
+        PJ_TEST_LTE(pushed - popped + n, 8, NULL, return -41);
+        if (n < want) {
+            /* Only allowed when the ring is full */
+            PJ_TEST_EQ(pushed - popped + n, 8, NULL, return -42);
+        }
+        pushed += n;
+
+        n = pj_ring_pop_n(ring, elems, (round % 3) + 1);
+        for (i = 0; i < n; ++i) {
+            PJ_TEST_EQ(elems[i].seq, popped + i, NULL, return -43);
+        }
+        popped += n;
+        PJ_TEST_EQ(pj_ring_size(ring), pushed - popped, NULL, return -44);
+    }
+
+    /* Discarding pop */
+    n = pj_ring_size(ring);
+    PJ_TEST_EQ(pj_ring_pop_n(ring, NULL, BATCH), n, NULL, return -50);
+    PJ_TEST_EQ(pj_ring_size(ring), 0, NULL, return -51);
+
+    /* More than the capacity is clamped */
+    PJ_TEST_EQ(pj_ring_push_n(ring, elems, BATCH), 8, NULL, return -52);
+    PJ_TEST_SUCCESS(pj_ring_pop(ring, NULL), NULL, return -53);
+    PJ_TEST_EQ(pj_ring_size(ring), 7, NULL, return -54);
+
+    PJ_TEST_SUCCESS(pj_ring_destroy(ring), NULL, return -60);
+    return 0;
+}
+
+int ring_test(void)
+{
+    pj_pool_t *pool;
+    int rc;
+
+    pool = pj_pool_create(mem, "ring", 4000, 4000, NULL);
+    PJ_TEST_NOT_NULL(pool, NULL, return -1);
+
+    rc = ring_basic_test(pool, PJ_RING_SPSC);
+    if (rc == 0)
+        rc = ring_basic_test(pool, PJ_RING_MPMC);
+
+#if PJ_HAS_THREADS
+    if (rc == 0) {
+        PJ_LOG(3,(THIS_FILE, "  spsc multithreaded test"));
+        rc = run_mt(pool, PJ_RING_SPSC, 64, 1, 1, 50000, 1, NULL);
+    }
+    if (rc == 0) {
+        PJ_LOG(3,(THIS_FILE, "  spsc multithreaded batch test"));
+        rc = run_mt(pool, PJ_RING_SPSC, 64, 1, 1, 50000, BATCH, NULL);
+    }
+    if (rc == 0) {
+        PJ_LOG(3,(THIS_FILE, "  mpmc multithreaded test"));
+        rc = run_mt(pool, PJ_RING_MPMC, 64, 3, 3, 20000, 1, NULL);
+    }
+    if (rc == 0) {
+        PJ_LOG(3,(THIS_FILE, "  mpmc multithreaded batch test"));
+        rc = run_mt(pool, PJ_RING_MPMC, 64, 3, 3, 20000, 5, NULL);
+    }
+#endif
+
+    pj_pool_release(pool);
+    return rc;
+}
+
+#endif  /* INCLUDE_RING_TEST */
+
+
+#if INCLUDE_RING_PERF_TEST
+
+int ring_perf_test(void)
+{
+    struct {
+        pj_ring_type    type;
+        unsigned        prod_cnt;
+        unsigned        cons_cnt;
+        unsigned        batch;
+    } cfg[] = {
+        { PJ_RING_SPSC, 1, 1, 1 },
+        { PJ_RING_SPSC, 1, 1, BATCH },
+        { PJ_RING_MPMC, 1, 1, 1 },
+        { PJ_RING_MPMC, 1, 1, BATCH },
+        { PJ_RING_MPMC, 2, 2, 1 },
+        { PJ_RING_MPMC, 2, 2, BATCH },
+        { PJ_RING_MPMC, 4, 4, 1 },
+        { PJ_RING_MPMC, 4, 4, BATCH },
+    };
+    enum { ITEM_CNT = 1000000 };
+    pj_pool_t *pool;
+    unsigned i;
+    int rc = 0;
+
+    pool = pj_pool_create(mem, "ringperf", 4000, 4000, NULL);
+    PJ_TEST_NOT_NULL(pool, NULL, return -1);
+
+    PJ_LOG(3,(THIS_FILE, "Benchmarking ring throughput (%d byte elements)..",
+              (int)sizeof(elem_t)));
+
+    for (i = 0; i < PJ_ARRAY_SIZE(cfg); ++i) {
+        unsigned item_cnt = ITEM_CNT / cfg[i].prod_cnt;
+        pj_uint32_t usec;
+
+        rc = run_mt(pool, cfg[i].type, 1024, cfg[i].prod_cnt,
+                    cfg[i].cons_cnt, item_cnt, cfg[i].batch, &usec);
+        if (rc != 0)
+            break;
+
+        PJ_LOG(3,(THIS_FILE, "..%s %dP/%dC, batch %2d: %u items/sec",
+                  type_name(cfg[i].type), cfg[i].prod_cnt, cfg[i].cons_cnt,
+                  cfg[i].batch,
+                  (unsigned)((pj_uint64_t)item_cnt * cfg[i].prod_cnt *
+                             1000000 / usec)));
+    }
+
+    pj_pool_release(pool);
+    return rc;
+}
+
+#endif  /* INCLUDE_RING_PERF_TEST */
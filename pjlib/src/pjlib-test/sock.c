@@ -49,6 +49,8 @@
  *  - pj_sock_sendto()
  *  - pj_sock_recv()
  *  - pj_sock_recvfrom()
+ *  - pj_sock_sendmmsg()
+ *  - pj_sock_recvmmsg()
  *  - pj_sock_bind()
  *  - pj_sock_connect()
  *  - pj_sock_listen()
@@ -948,6 +950,109 @@ static int socketpair_test()
     return 0;
 }
 
+/* Send and receive a batch of datagrams with pj_sock_sendmmsg() and
+ * pj_sock_recvmmsg().
+ */
+static int mmsg_test(void)
+{
+    enum { CNT = 4, PKT_LEN = 64 };
+    pj_sock_t cs = PJ_INVALID_SOCKET, ss = PJ_INVALID_SOCKET;
+    pj_sockaddr dstaddr, srcaddr, from[CNT+2];
+    char txbuf[CNT][PKT_LEN], rxbuf[CNT+2][PKT_LEN];
+    pj_sock_mmsg msgs[CNT+2];
+    unsigned i, cnt, received = 0;
+    int addrlen;
+    pj_str_t s;
+    pj_status_t rc;
+
+    PJ_LOG(3,("test", "...mmsg_test()"));
+
+    rc = pj_sock_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0, &ss);
+    if (rc != PJ_SUCCESS) {
+        app_perror("...error: unable to create socket", rc);
+        return -1100;
+    }
+
+    rc = pj_sock_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0, &cs);
+    if (rc != PJ_SUCCESS) {
+        rc = -1110; goto on_return;
+    }
+
+    /* Bind both sockets to loopback with random ports */
+    pj_sockaddr_init(pj_AF_INET(), &dstaddr, pj_cstr(&s, ADDRESS), 0);
+    pj_sockaddr_cp(&srcaddr, &dstaddr);
+    if (pj_sock_bind(ss, &dstaddr, pj_sockaddr_get_len(&dstaddr)) ||
+        pj_sock_bind(cs, &srcaddr, pj_sockaddr_get_len(&srcaddr)))
+    {
+        rc = -1120; goto on_return;
+    }
+
+    addrlen = sizeof(dstaddr);
+    pj_sock_getsockname(ss, &dstaddr, &addrlen);
+    addrlen = sizeof(srcaddr);
+    pj_sock_getsockname(cs, &srcaddr, &addrlen);
+
+    /* Send the batch */
+    for (i = 0; i < CNT; ++i) {
+        pj_memset(txbuf[i], 'a' + i, PKT_LEN);
+        msgs[i].buf = txbuf[i];
+        msgs[i].len = PKT_LEN - i;
+        msgs[i].addr = &dstaddr;
+        msgs[i].addrlen = pj_sockaddr_get_len(&dstaddr);
+    }
+
+    cnt = CNT;
+    rc = pj_sock_sendmmsg(cs, msgs, &cnt, 0);
+    if (rc != PJ_SUCCESS || cnt != CNT) {
+        app_perror("...sendmmsg() error", rc);
+        rc = -1130; goto on_return;
+    }
+    for (i = 0; i < CNT; ++i) {
+        if (msgs[i].len != PKT_LEN - (int)i) {
+            rc = -1140; goto on_return;
+        }
+    }
+
+    /* Receive them, with room for more than was sent. Datagrams may
+     * trickle in over several calls.
+     */
+    while (received < CNT) {
+        for (i = 0; i < CNT+2; ++i) {
+            msgs[i].buf = rxbuf[i];
+            msgs[i].len = PKT_LEN;
+            msgs[i].addr = &from[i];
+            msgs[i].addrlen = sizeof(from[i]);
+        }
+
+        cnt = CNT+2;
+        rc = pj_sock_recvmmsg(ss, msgs, &cnt, 0);
+        if (rc != PJ_SUCCESS || cnt == 0 || received + cnt > CNT) {
+            app_perror("...recvmmsg() error", rc);
+            rc = -1150; goto on_return;
+        }
+
+        for (i = 0; i < cnt; ++i, ++received) {
+            if (msgs[i].len != PKT_LEN - (int)received ||
+                pj_memcmp(rxbuf[i], txbuf[received], msgs[i].len) != 0)
+            {
+                rc = -1160; goto on_return;
+            }
+            if (pj_sockaddr_cmp(&from[i], &srcaddr) != 0) {
+                rc = -1180; goto on_return;
+            }
+        }
+    }
+
+    rc = 0;
+
+on_return:
+    if (cs != PJ_INVALID_SOCKET)
+        pj_sock_close(cs);
+    if (ss != PJ_INVALID_SOCKET)
+        pj_sock_close(ss);
+    return rc;
+}
+
 int sock_test()
 {
     int rc;
@@ -997,6 +1102,10 @@ int sock_test()
     if (rc != 0)
         return rc;
 
+    rc = mmsg_test();
+    if (rc != 0)
+        return rc;
+
     return 0;
 }
 
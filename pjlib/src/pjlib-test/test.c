@@ -179,6 +179,10 @@ static pj_test_stat essential_tests(int argc, char *argv[])
     ADD_TEST( fifobuf_test, 0);
 #endif
 
+#if INCLUDE_RING_TEST
+    ADD_TEST( ring_test, 0);
+#endif
+
 #if INCLUDE_MUTEX_TEST
     ADD_TEST( mutex_test, 0);
 #endif
@@ -252,6 +256,14 @@ static int features_tests(int argc, char *argv[])
     UT_ADD_TEST(&test_app.ut_app, hash_test, 0);
 #endif
 
+#if INCLUDE_HASH_PERF_TEST
+    UT_ADD_TEST(&test_app.ut_app, hash_perf_test, 0);
+#endif
+
+#if INCLUDE_RING_PERF_TEST
+    UT_ADD_TEST(&test_app.ut_app, ring_perf_test, 0);
+#endif
+
     /* GH CI oftent fails with:
 
     07:27:13.217 ...testing frequency accuracy (pls wait)
@@ -291,6 +303,11 @@ static int features_tests(int argc, char *argv[])
     UT_ADD_TEST(&test_app.ut_app, file_test, 0);
 #endif
 
+    /* Replaces the log function, so it can't run with other tests */
+#if INCLUDE_LOG_ASYNC_TEST
+    UT_ADD_TEST(&test_app.ut_app, log_async_test, PJ_TEST_EXCLUSIVE);
+#endif
+
 #if INCLUDE_SOCK_TEST
     UT_ADD_TEST(&test_app.ut_app, sock_test, 0);
 #endif
@@ -58,17 +58,23 @@
 #endif
 
 #define INCLUDE_HASH_TEST           GROUP_DATA_STRUCTURE
+#define INCLUDE_HASH_PERF_TEST      (GROUP_DATA_STRUCTURE && WITH_BENCHMARK)
 #define INCLUDE_POOL_TEST           GROUP_LIBC
 #define INCLUDE_POOL_PERF_TEST      (GROUP_LIBC && WITH_BENCHMARK)
 #define INCLUDE_STRING_TEST         GROUP_DATA_STRUCTURE
 #define INCLUDE_FIFOBUF_TEST        GROUP_DATA_STRUCTURE
 #define INCLUDE_RBTREE_TEST         GROUP_DATA_STRUCTURE
+#define INCLUDE_RING_TEST           GROUP_DATA_STRUCTURE
+#define INCLUDE_RING_PERF_TEST      (PJ_HAS_THREADS && GROUP_DATA_STRUCTURE && \
+                                     WITH_BENCHMARK)
 #define INCLUDE_TIMER_TEST          GROUP_DATA_STRUCTURE
 #define INCLUDE_UNITTEST_TEST       GROUP_DATA_STRUCTURE
 #define INCLUDE_ATOMIC_TEST         GROUP_OS
 #define INCLUDE_MUTEX_TEST          (PJ_HAS_THREADS && GROUP_OS)
 #define INCLUDE_SLEEP_TEST          GROUP_OS
 #define INCLUDE_OS_TEST             GROUP_OS
+#define INCLUDE_LOG_ASYNC_TEST      (PJ_HAS_THREADS && GROUP_OS && \
+                                     GROUP_FILE)
 #define INCLUDE_THREAD_TEST         (PJ_HAS_THREADS && GROUP_OS)
 #define INCLUDE_SOCK_TEST           GROUP_NETWORK
 #define INCLUDE_SOCK_PERF_TEST      (GROUP_NETWORK && WITH_BENCHMARK)
@@ -104,7 +110,9 @@ extern int list_test(void);
 extern int atomic_slist_test(void);
 extern int atomic_slist_mt_test(void);
 extern int hash_test(void);
+extern int hash_perf_test(void);
 extern int log_test(void);
+extern int log_async_test(void);
 extern int os_test(void);
 extern int pool_test(void);
 extern int pool_perf_test(void);
@@ -115,6 +123,8 @@ extern int unittest_parallel_test(void);
 extern int unittest_test(void);
 extern int timer_test(void);
 extern int rbtree_test(void);
+extern int ring_test(void);
+extern int ring_perf_test(void);
 extern int atomic_test(void);
 extern int mutex_test(void);
 extern int sleep_test(void);
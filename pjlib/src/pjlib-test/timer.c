@@ -50,7 +50,12 @@ static void timer_callback(pj_timer_heap_t *ht, pj_timer_entry *e)
     PJ_UNUSED_ARG(e);
 }
 
-static int test_timer_heap(void)
+static const char *get_heap_name(pj_timer_heap_type type)
+{
+    return type == PJ_TIMER_HEAP_WHEEL ? "wheel" : "binary heap";
+}
+
+static int test_timer_heap(pj_timer_heap_type type)
 {
     int i, j;
     pj_timer_entry *entry;
@@ -61,8 +66,9 @@ static int test_timer_heap(void)
     int err=0;
     pj_size_t size;
     unsigned count;
+    pj_timer_heap_cfg cfg;
 
-    PJ_LOG(3,("test", "...Basic test"));
+    PJ_LOG(3,("test", "...Basic test (%s)", get_heap_name(type)));
 
     size = pj_timer_heap_mem_size(MAX_COUNT)+MAX_COUNT*sizeof(pj_timer_entry);
     pool = pj_pool_create( mem, NULL, size, 4000, NULL);
@@ -79,7 +85,9 @@ static int test_timer_heap(void)
     for (i=0; i<MAX_COUNT; ++i) {
         entry[i].cb = &timer_callback;
     }
-    status = pj_timer_heap_create(pool, MAX_COUNT, &timer);
+    pj_timer_heap_cfg_default(&cfg);
+    cfg.type = type;
+    status = pj_timer_heap_create2(pool, MAX_COUNT, &cfg, &timer);
     if (status != PJ_SUCCESS) {
         app_perror("...error: unable to create timer heap", status);
         return -30;
@@ -467,7 +475,7 @@ static int cancel_worker(void *arg)
 }
 #endif
 
-static int timer_stress_test(void)
+static int timer_stress_test(pj_timer_heap_type type)
 {
     unsigned count = 0, n_sched = 0, n_cancel = 0, n_poll = 0;
     int i;
@@ -483,13 +491,14 @@ static int timer_stress_test(void)
     pj_thread_t **poll_threads = NULL;
     pj_thread_t **cancel_threads = NULL;
     struct thread_param tparam = {0};
+    pj_timer_heap_cfg cfg;
 #if SIMULATE_CRASH
     pj_timer_entry *entry;
     pj_pool_t *tmp_pool;
     pj_time_val delay = {0};
 #endif
 
-    PJ_LOG(3,("test", "...Stress test"));
+    PJ_LOG(3,("test", "...Stress test (%s)", get_heap_name(type)));
 
     pool = pj_pool_create( mem, NULL, 128, 128, NULL);
     if (!pool) {
@@ -502,7 +511,9 @@ static int timer_stress_test(void)
      * Initially we only create a fraction of what's required,
      * to test the timer heap growth algorithm.
      */
-    status = pj_timer_heap_create(pool, ST_ENTRY_COUNT/64, &timer);
+    pj_timer_heap_cfg_default(&cfg);
+    cfg.type = type;
+    status = pj_timer_heap_create2(pool, ST_ENTRY_COUNT/64, &cfg, &timer);
     if (status != PJ_SUCCESS) {
         app_perror("...error: unable to create timer heap", status);
         err = -20;
@@ -947,15 +958,170 @@ static int timer_bench_test(void)
     return err;
 }
 
+/*
+ * Compare the timer heap implementations with increasing number of active
+ * timers. The timers are spread over CMP_MAX_DELAY_MS, similar to SIP
+ * transaction timers, then all cancelled. The expiry benchmark schedules
+ * them again within CMP_EXPIRE_MS and polls until all have expired.
+ */
+#define CMP_MAX_DELAY_MS    32000
+#define CMP_EXPIRE_MS       500
+
+static unsigned cmp_rate(pj_timestamp *freq, pj_timestamp *elapsed,
+                         unsigned count)
+{
+    if (elapsed->u64 == 0)
+        return 0;
+    return (unsigned)(freq->u64 * count / elapsed->u64);
+}
+
+static int timer_cmp_bench(pj_timer_heap_type type, unsigned count,
+                           pj_timestamp *freq)
+{
+    pj_pool_t *pool;
+    pj_timer_heap_t *timer;
+    pj_timer_heap_cfg cfg;
+    pj_timer_entry *entries;
+    pj_timestamp t1, t2, t_sched, t_cancel, t_poll;
+    char sched_str[64], cancel_str[64], poll_str[64], count_str[64];
+    unsigned i, polled;
+    int err = 0;
+
+    pool = pj_pool_create(mem, NULL, 4000, 64000, NULL);
+    if (!pool)
+        return -400;
+
+    pj_timer_heap_cfg_default(&cfg);
+    cfg.type = type;
+    if (pj_timer_heap_create2(pool, count, &cfg, &timer) != PJ_SUCCESS) {
+        err = -410;
+        goto on_return;
+    }
+    pj_timer_heap_set_max_timed_out_per_poll(timer, count);
+
+    entries = (pj_timer_entry*)pj_pool_calloc(pool, count, sizeof(*entries));
+    if (!entries) {
+        err = -420;
+        goto on_return;
+    }
+    for (i = 0; i < count; ++i)
+        pj_timer_entry_init(&entries[i], 0, NULL, &timer_callback);
+
+    /* Schedule */
+    pj_get_timestamp(&t1);
+    for (i = 0; i < count; ++i) {
+        pj_time_val delay;
+
+        delay.sec = 0;
+        delay.msec = pj_rand() % CMP_MAX_DELAY_MS + 1000;
+        pj_time_val_normalize(&delay);
+        if (pj_timer_heap_schedule(timer, &entries[i], &delay)) {
+            err = -430;
+            goto on_return;
+        }
+    }
+    pj_get_timestamp(&t2);
+    t_sched = t2;
+    pj_sub_timestamp(&t_sched, &t1);
+
+    /* Cancel in random-ish order */
+    pj_get_timestamp(&t1);
+    for (i = 0; i < count; ++i) {
+        unsigned idx = (unsigned)(((pj_uint64_t)i * 7919) % count);
+        if (pj_timer_heap_cancel(timer, &entries[idx]) != 1) {
+            err = -440;
+            goto on_return;
+        }
+    }
+    pj_get_timestamp(&t2);
+    t_cancel = t2;
+    pj_sub_timestamp(&t_cancel, &t1);
+
+    /* Expire */
+    for (i = 0; i < count; ++i) {
+        pj_time_val delay;
+
+        delay.sec = 0;
+        delay.msec = pj_rand() % CMP_EXPIRE_MS;
+        if (pj_timer_heap_schedule(timer, &entries[i], &delay)) {
+            err = -450;
+            goto on_return;
+        }
+    }
+
+    t_poll.u64 = 0;
+    polled = 0;
+    for (i = 0; i < CMP_EXPIRE_MS * 4 && pj_timer_heap_count(timer); ++i) {
+        pj_get_timestamp(&t1);
+        polled += pj_timer_heap_poll(timer, NULL);
+        pj_get_timestamp(&t2);
+        pj_add_timestamp(&t_poll, &t2);
+        pj_sub_timestamp(&t_poll, &t1);
+        pj_thread_sleep(1);
+    }
+    if (polled != count) {
+        PJ_LOG(3,(THIS_FILE, "....error: only %u of %u timers expired",
+                  polled, count));
+        err = -460;
+        goto on_return;
+    }
+
+    get_format_num(count, count_str);
+    get_format_num(cmp_rate(freq, &t_sched, count), sched_str);
+    get_format_num(cmp_rate(freq, &t_cancel, count), cancel_str);
+    get_format_num(cmp_rate(freq, &t_poll, count), poll_str);
+    PJ_LOG(3,(THIS_FILE, "    %-11s %9s timers: schedule %11s, "
+              "cancel %11s, expire %11s ent/sec",
+              get_heap_name(type), count_str, sched_str, cancel_str,
+              poll_str));
+
+on_return:
+    pj_pool_release(pool);
+    return err;
+}
+
+static int timer_cmp_bench_test(void)
+{
+    unsigned counts[] = { 10000, 100000, 1000000 };
+    pj_timer_heap_type types[] = { PJ_TIMER_HEAP_BINARY, PJ_TIMER_HEAP_WHEEL };
+    pj_timestamp freq;
+    unsigned i, j;
+    int rc;
+
+    PJ_LOG(3,("test", "...Benchmark test: binary heap vs wheel"));
+
+    if (pj_get_timestamp_freq(&freq) != PJ_SUCCESS) {
+        PJ_LOG(3,("test", "...error: unable to get timestamp freq"));
+        return -300;
+    }
+
+    for (i = 0; i < PJ_ARRAY_SIZE(counts); ++i) {
+        for (j = 0; j < PJ_ARRAY_SIZE(types); ++j) {
+            rc = timer_cmp_bench(types[j], counts[i], &freq);
+            if (rc != 0)
+                return rc;
+        }
+    }
+    return 0;
+}
+
 int timer_test()
 {
     int rc;
 
-    rc = test_timer_heap();
+    rc = test_timer_heap(PJ_TIMER_HEAP_BINARY);
     if (rc != 0)
         return rc;
 
-    rc = timer_stress_test();
+    rc = test_timer_heap(PJ_TIMER_HEAP_WHEEL);
+    if (rc != 0)
+        return rc;
+
+    rc = timer_stress_test(PJ_TIMER_HEAP_BINARY);
+    if (rc != 0)
+        return rc;
+
+    rc = timer_stress_test(PJ_TIMER_HEAP_WHEEL);
     if (rc != 0)
         return rc;
 
@@ -963,9 +1129,14 @@ int timer_test()
     rc = timer_bench_test();
     if (rc != 0)
         return rc;
+
+    rc = timer_cmp_bench_test();
+    if (rc != 0)
+        return rc;
 #else
     /* Avoid unused warning */
     PJ_UNUSED_ARG(timer_bench_test);
+    PJ_UNUSED_ARG(timer_cmp_bench_test);
 #endif
 
     return 0;
@@ -29,6 +29,8 @@ extern const pj_uint8_t pjmedia_linear2ulaw_tab[16384];
 extern const pj_uint8_t pjmedia_linear2alaw_tab[16384];
 extern const pj_int16_t pjmedia_ulaw2linear_tab[256];
 extern const pj_int16_t pjmedia_alaw2linear_tab[256];
+extern const pj_uint8_t pjmedia_alaw2ulaw_tab[256];
+extern const pj_uint8_t pjmedia_ulaw2alaw_tab[256];
 
 
 /**
@@ -74,7 +76,7 @@ extern const pj_int16_t pjmedia_alaw2linear_tab[256];
  * @return          8-bit U-Law value.
  */
 #define pjmedia_alaw2ulaw(aval)         \
-            pjmedia_linear2ulaw(pjmedia_alaw2linear(aval))
+            pjmedia_alaw2ulaw_tab[aval]
 
 /**
  * Convert 8-bit U-Law value to 8-bit A-Law value.
@@ -83,7 +85,7 @@ extern const pj_int16_t pjmedia_alaw2linear_tab[256];
  * @return          8-bit A-Law value.
  */
 #define pjmedia_ulaw2alaw(uval)         \
-            pjmedia_linear2alaw(pjmedia_ulaw2linear(uval))
+            pjmedia_ulaw2alaw_tab[uval]
 
 
 #else
@@ -141,19 +143,18 @@ PJ_DECL(unsigned char) pjmedia_ulaw2alaw(unsigned char uval);
 /**
  * Encode 16-bit linear PCM data to 8-bit U-Law data.
  *
+ * This and the other bulk conversion functions below give the same result
+ * as converting each sample with the macros/functions above. The encoding
+ * and decoding functions use SIMD instructions when #PJMEDIA_G711_USE_SIMD
+ * is enabled and the CPU supports them. The source and destination buffers
+ * must not overlap.
+ *
  * @param dst       Destination buffer for 8-bit U-Law data.
  * @param src       Source, 16-bit linear PCM data.
  * @param count     Number of samples.
  */
-PJ_INLINE(void) pjmedia_ulaw_encode(pj_uint8_t *dst, const pj_int16_t *src, 
-                                    pj_size_t count)
-{
-    const pj_int16_t *end = src + count;
-    
-    while (src < end) {
-        *dst++ = pjmedia_linear2ulaw(*src++);
-    }
-}
+PJ_DECL(void) pjmedia_ulaw_encode(pj_uint8_t *dst, const pj_int16_t *src,
+                                  pj_size_t count);
 
 /**
  * Encode 16-bit linear PCM data to 8-bit A-Law data.
@@ -162,15 +163,8 @@ PJ_INLINE(void) pjmedia_ulaw_encode(pj_uint8_t *dst, const pj_int16_t *src,
  * @param src       Source, 16-bit linear PCM data.
  * @param count     Number of samples.
  */
-PJ_INLINE(void) pjmedia_alaw_encode(pj_uint8_t *dst, const pj_int16_t *src, 
-                                    pj_size_t count)
-{
-    const pj_int16_t *end = src + count;
-    
-    while (src < end) {
-        *dst++ = pjmedia_linear2alaw(*src++);
-    }
-}
+PJ_DECL(void) pjmedia_alaw_encode(pj_uint8_t *dst, const pj_int16_t *src,
+                                  pj_size_t count);
 
 /**
  * Decode 8-bit U-Law data to 16-bit linear PCM data.
@@ -179,15 +173,8 @@ PJ_INLINE(void) pjmedia_alaw_encode(pj_uint8_t *dst, const pj_int16_t *src,
  * @param src       Source, 8-bit U-Law data.
  * @param len       Encoded frame/source length in bytes.
  */
-PJ_INLINE(void) pjmedia_ulaw_decode(pj_int16_t *dst, const pj_uint8_t *src, 
-                                    pj_size_t len)
-{
-    const pj_uint8_t *end = src + len;
-    
-    while (src < end) {
-        *dst++ = pjmedia_ulaw2linear(*src++);
-    }
-}
+PJ_DECL(void) pjmedia_ulaw_decode(pj_int16_t *dst, const pj_uint8_t *src,
+                                  pj_size_t len);
 
 /**
  * Decode 8-bit A-Law data to 16-bit linear PCM data.
@@ -196,15 +183,78 @@ PJ_INLINE(void) pjmedia_ulaw_decode(pj_int16_t *dst, const pj_uint8_t *src,
  * @param src       Source, 8-bit A-Law data.
  * @param len       Encoded frame/source length in bytes.
  */
-PJ_INLINE(void) pjmedia_alaw_decode(pj_int16_t *dst, const pj_uint8_t *src, 
-                                    pj_size_t len)
-{
-    const pj_uint8_t *end = src + len;
-    
-    while (src < end) {
-        *dst++ = pjmedia_alaw2linear(*src++);
-    }
-}
+PJ_DECL(void) pjmedia_alaw_decode(pj_int16_t *dst, const pj_uint8_t *src,
+                                  pj_size_t len);
+
+/**
+ * Convert 8-bit A-Law data to 8-bit U-Law data, without going through
+ * 16-bit PCM.
+ *
+ * @param dst       Destination buffer for 8-bit U-Law data.
+ * @param src       Source, 8-bit A-Law data.
+ * @param count     Number of samples.
+ */
+PJ_DECL(void) pjmedia_alaw_to_ulaw(pj_uint8_t *dst, const pj_uint8_t *src,
+                                   pj_size_t count);
+
+/**
+ * Convert 8-bit U-Law data to 8-bit A-Law data, without going through
+ * 16-bit PCM.
+ *
+ * @param dst       Destination buffer for 8-bit A-Law data.
+ * @param src       Source, 8-bit U-Law data.
+ * @param count     Number of samples.
+ */
+PJ_DECL(void) pjmedia_ulaw_to_alaw(pj_uint8_t *dst, const pj_uint8_t *src,
+                                   pj_size_t count);
+
+/**
+ * Enable or disable the SIMD implementation of the bulk conversion
+ * functions. This is mainly useful to compare the performance and the
+ * output of the SIMD and the portable C implementations. The setting is
+ * process wide.
+ *
+ * @param enable    PJ_TRUE to select the best implementation for the CPU,
+ *                  PJ_FALSE to use the portable C one.
+ *
+ * @return          PJ_SUCCESS, or PJ_ENOTSUP if SIMD is requested but
+ *                  no SIMD implementation is available.
+ */
+PJ_DECL(pj_status_t) pjmedia_g711_enable_simd(pj_bool_t enable);
+
+/**
+ * Enumerate the implementations of the bulk conversion functions that can
+ * run on this CPU, best first. The portable C implementation is always the
+ * last one. This is mainly useful to test each implementation with
+ * #pjmedia_g711_set_impl().
+ *
+ * @param count     On input, the maximum number of names. On output, the
+ *                  number of names returned.
+ * @param names     Array to receive the implementation names.
+ *
+ * @return          PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_g711_enum_impl(unsigned *count,
+                                           const char *names[]);
+
+/**
+ * Select the implementation of the bulk conversion functions by name.
+ *
+ * @param name      The implementation name, as returned by
+ *                  #pjmedia_g711_enum_impl().
+ *
+ * @return          PJ_SUCCESS, or PJ_ENOTSUP if the implementation is not
+ *                  available on this CPU.
+ */
+PJ_DECL(pj_status_t) pjmedia_g711_set_impl(const char *name);
+
+/**
+ * Get the name of the bulk conversion implementation currently in use,
+ * e.g. "avx2", "ssse3", "neon", or "c".
+ *
+ * @return          The implementation name.
+ */
+PJ_DECL(const char*) pjmedia_g711_get_impl_name(void);
 
 PJ_END_DECL
 
@@ -204,8 +204,19 @@ enum pjmedia_conf_option
                                      microphone device.                     */
     PJMEDIA_CONF_NO_DEVICE = 2, /**< Do not create sound device.            */
     PJMEDIA_CONF_SMALL_FILTER=4,/**< Use small filter table when resampling */
-    PJMEDIA_CONF_USE_LINEAR=8   /**< Use linear resampling instead of filter
+    PJMEDIA_CONF_USE_LINEAR=8,  /**< Use linear resampling instead of filter
                                      based.                                 */
+    PJMEDIA_CONF_FANOUT=16      /**< Group the ports that receive the same
+                                     mix, e.g. the passive listeners of a
+                                     broadcast, and mix the signal once per
+                                     group. The streams of a group that use
+                                     the same codec settings also share one
+                                     encoding of the signal, see
+                                     #pjmedia_stream_put_frame_from(). Only
+                                     ports with the same clock rate, ptime
+                                     and channel count as the bridge are
+                                     grouped, and they must not modify the
+                                     frame given to their put_frame().      */
 };
 
 /**
@@ -284,6 +295,26 @@ typedef struct pjmedia_conf_param
      * the pjsua2 level using the pjsua2::MediaConfig::confThreads parameter.
      */
     unsigned worker_threads;
+
+    /**
+     * Maximum number of active speakers to be mixed in each frame, or zero
+     * to mix every transmitting port, which is the classic behavior.
+     *
+     * When non-zero, the bridge selects in each frame the loudest ports
+     * whose level is above #PJMEDIA_CONF_SPEAKER_THRESHOLD, up to this
+     * number, and mixes them once into a shared bus. The frame of each
+     * listener is derived from the bus by removing the speakers it is
+     * not connected to, typically itself. The other ports are not heard
+     * in that frame. The mixing cost then grows with the number of
+     * speakers rather than with the number of connections, which makes
+     * large conferences with mostly silent participants much cheaper.
+     *
+     * The maximum value is 32. This value is ignored by the switch board
+     * backend (PJMEDIA_CONF_SWITCH_BOARD_BACKEND).
+     *
+     * Default: #PJMEDIA_CONF_MAX_SPEAKERS
+     */
+    unsigned max_speakers;
 } pjmedia_conf_param;
 
 
@@ -297,6 +328,7 @@ PJ_INLINE(void) pjmedia_conf_param_default(pjmedia_conf_param *param)
 #if defined(PJMEDIA_CONF_THREADS) && PJMEDIA_CONF_THREADS > 1
     param->worker_threads = PJMEDIA_CONF_THREADS-1;
 #endif
+    param->max_speakers = PJMEDIA_CONF_MAX_SPEAKERS;
 }
 
 /**
@@ -178,6 +178,56 @@
 #   define PJMEDIA_CONF_THREADS  1
 #endif
 
+/**
+ * Default maximum number of active speakers mixed by the conference bridge
+ * in each frame, see pjmedia_conf_param.max_speakers. Zero mixes every
+ * transmitting port.
+ *
+ * Default: 0
+ */
+#ifndef PJMEDIA_CONF_MAX_SPEAKERS
+#   define PJMEDIA_CONF_MAX_SPEAKERS        0
+#endif
+
+/**
+ * Minimum signal level for a port to be selected as an active speaker
+ * when pjmedia_conf_param.max_speakers is set. The level is the average
+ * absolute sample value of the frame, after the RX level adjustment, and
+ * is smoothed over a few frames so that speakers are not dropped between
+ * words.
+ *
+ * Default: PJMEDIA_SILENCE_DET_THRESHOLD
+ */
+#ifndef PJMEDIA_CONF_SPEAKER_THRESHOLD
+#   define PJMEDIA_CONF_SPEAKER_THRESHOLD   PJMEDIA_SILENCE_DET_THRESHOLD
+#endif
+
+/**
+ * Specify whether the audio mixing kernels (see @ref PJMEDIA_MIX) used by
+ * the conference bridge may use SIMD instructions. When enabled, the
+ * kernels are selected at run-time according to the features of the CPU
+ * (SSE2 or AVX2 on x86, NEON on ARM64), falling back to the portable C
+ * implementation when none is available.
+ *
+ * Default: 1 (enabled)
+ */
+#ifndef PJMEDIA_MIX_USE_SIMD
+#   define PJMEDIA_MIX_USE_SIMD             1
+#endif
+
+/**
+ * Specify whether the bulk G.711 conversion functions in alaw_ulaw.h
+ * (used by the G.711 codec and the WAV writer) may use SIMD instructions.
+ * When enabled, the implementation is selected at run-time according to
+ * the features of the CPU (SSSE3 or AVX2 on x86, NEON on ARM64). The
+ * result is identical to the per-sample conversion.
+ *
+ * Default: 1 (enabled)
+ */
+#ifndef PJMEDIA_G711_USE_SIMD
+#   define PJMEDIA_G711_USE_SIMD            1
+#endif
+
 
 /*
  * Types of sound stream backends.
@@ -1350,6 +1400,29 @@
 #endif
 
 
+/**
+ * Maximum number of RTP packets that the UDP media transport reads from
+ * the socket and reports at once, when the attached stream accepts
+ * batches of packets (see \a rtp_batch_cb in
+ * #pjmedia_transport_attach_param). The packets already queued on the
+ * socket are read with #pj_sock_recvmmsg(), and the stream then handles
+ * them with a single jitter buffer lock acquisition. Each UDP transport
+ * using batches allocates this many packet buffers of
+ * #PJMEDIA_MAX_MRU bytes.
+ *
+ * Set to 1 to disable batching.
+ *
+ * Default: 8 if recvmmsg() is available, otherwise 1.
+ */
+#ifndef PJMEDIA_TRANSPORT_UDP_RX_BATCH
+#   if defined(PJ_SOCK_HAS_MMSG) && PJ_SOCK_HAS_MMSG!=0
+#       define PJMEDIA_TRANSPORT_UDP_RX_BATCH       8
+#   else
+#       define PJMEDIA_TRANSPORT_UDP_RX_BATCH       1
+#   endif
+#endif
+
+
 /**
  * Transport info (pjmedia_transport_info) contains a socket info and list
  * of transport specific info, since transports can be chained together 
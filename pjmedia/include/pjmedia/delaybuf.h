@@ -70,6 +70,8 @@ typedef enum pjmedia_delay_buf_flag
     /**
      * Use simple FIFO mechanism for the delay buffer, i.e.
      * without WSOLA for expanding and shrinking audio samples.
+     * The frames are handed between the putting and getting threads
+     * through a lock-free ring, without taking the delay buffer lock.
      */
     PJMEDIA_DELAY_BUF_SIMPLE_FIFO = 1
 
@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2025 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef __PJMEDIA_MIX_H__
+#define __PJMEDIA_MIX_H__
+
+
+/**
+ * @file mix.h
+ * @brief Audio mixing kernels.
+ */
+#include <pjmedia/types.h>
+
+
+/**
+ * @defgroup PJMEDIA_MIX Audio Mixing Kernels
+ * @ingroup PJMEDIA_FRAME_OP
+ * @brief Sample level operations used by the conference bridge
+ * @{
+ *
+ * These functions implement the per-sample work of the conference bridge:
+ * applying a level adjustment with saturation, measuring the signal level,
+ * accumulating frames into a 32bit mixing buffer, and converting the mixing
+ * buffer back to 16bit samples.
+ *
+ * Level adjustments are expressed the same way as in the conference
+ * bridge, i.e. 128 is the normal level, and the adjusted sample is
+ * (sample * adj) >> 7, saturated to 16bit.
+ *
+ * When #PJMEDIA_MIX_USE_SIMD is enabled, the implementation is selected
+ * once at run-time according to the features of the CPU. All
+ * implementations produce identical results.
+ */
+
+
+PJ_BEGIN_DECL
+
+
+/**
+ * Enable or disable the SIMD implementation of the mixing kernels. This is
+ * mainly useful to compare the performance and the output of the SIMD and
+ * the portable C implementations. The setting is process wide, and should
+ * not be changed while a conference bridge is running.
+ *
+ * @param enable        PJ_TRUE to select the best implementation for
+ *                      the CPU, PJ_FALSE to use the portable C one.
+ *
+ * @return              PJ_SUCCESS, or PJ_ENOTSUP if SIMD is requested but
+ *                      no SIMD implementation is available.
+ */
+PJ_DECL(pj_status_t) pjmedia_mix_enable_simd(pj_bool_t enable);
+
+
+/**
+ * Enumerate the implementations of the mixing kernels that can run on this
+ * CPU, best first. The portable C implementation is always the last one.
+ * This is mainly useful to test each implementation with
+ * #pjmedia_mix_set_impl().
+ *
+ * @param count         On input, the maximum number of names. On output,
+ *                      the number of names returned.
+ * @param names         Array to receive the implementation names.
+ *
+ * @return              PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_mix_enum_impl(unsigned *count,
+                                          const char *names[]);
+
+
+/**
+ * Select the implementation of the mixing kernels by name. The same
+ * restrictions as #pjmedia_mix_enable_simd() apply.
+ *
+ * @param name          The implementation name, as returned by
+ *                      #pjmedia_mix_enum_impl().
+ *
+ * @return              PJ_SUCCESS, or PJ_ENOTSUP if the implementation
+ *                      is not available on this CPU.
+ */
+PJ_DECL(pj_status_t) pjmedia_mix_set_impl(const char *name);
+
+
+/**
+ * Get the name of the implementation currently in use, e.g. "avx2",
+ * "sse2", "neon", or "c".
+ *
+ * @return              The implementation name.
+ */
+PJ_DECL(const char*) pjmedia_mix_get_impl_name(void);
+
+
+/**
+ * Apply level adjustment to the samples, and calculate the sum of the
+ * absolute value of the adjusted samples.
+ *
+ * @param dst           Destination buffer, may be the same as src.
+ * @param src           Source samples.
+ * @param count         Number of samples.
+ * @param adj           Level adjustment, 128 is the normal level.
+ *
+ * @return              Sum of the absolute value of the adjusted samples.
+ */
+PJ_DECL(pj_uint32_t) pjmedia_mix_adjust(pj_int16_t *dst,
+                                        const pj_int16_t *src,
+                                        unsigned count,
+                                        unsigned adj);
+
+
+/**
+ * Calculate the sum of the absolute value of the samples.
+ *
+ * @param src           The samples.
+ * @param count         Number of samples.
+ *
+ * @return              Sum of the absolute value of the samples.
+ */
+PJ_DECL(pj_uint32_t) pjmedia_mix_level(const pj_int16_t *src,
+                                       unsigned count);
+
+
+/**
+ * Initialize the mixing buffer with the samples of the first frame.
+ *
+ * @param mix_buf       The 32bit mixing buffer.
+ * @param src           Source samples.
+ * @param count         Number of samples.
+ */
+PJ_DECL(void) pjmedia_mix_copy(pj_int32_t *mix_buf,
+                               const pj_int16_t *src,
+                               unsigned count);
+
+
+/**
+ * Add the samples to the mixing buffer, and find the minimum and
+ * maximum value of the mixing buffer afterwards.
+ *
+ * @param mix_buf       The 32bit mixing buffer.
+ * @param src           Source samples.
+ * @param count         Number of samples.
+ * @param p_min         Receives the minimum value of the mixing buffer,
+ *                      or zero if all values are positive.
+ * @param p_max         Receives the maximum value of the mixing buffer,
+ *                      or zero if all values are negative.
+ */
+PJ_DECL(void) pjmedia_mix_add(pj_int32_t *mix_buf,
+                              const pj_int16_t *src,
+                              unsigned count,
+                              pj_int32_t *p_min,
+                              pj_int32_t *p_max);
+
+
+/**
+ * Subtract the samples from the mixing buffer, and find the minimum and
+ * maximum value of the mixing buffer afterwards. This is used to remove
+ * a frame that was previously added with #pjmedia_mix_add().
+ *
+ * @param mix_buf       The 32bit mixing buffer.
+ * @param src           Samples to subtract.
+ * @param count         Number of samples.
+ * @param p_min         Receives the minimum value of the mixing buffer,
+ *                      or zero if all values are positive.
+ * @param p_max         Receives the maximum value of the mixing buffer,
+ *                      or zero if all values are negative.
+ */
+PJ_DECL(void) pjmedia_mix_sub(pj_int32_t *mix_buf,
+                              const pj_int16_t *src,
+                              unsigned count,
+                              pj_int32_t *p_min,
+                              pj_int32_t *p_max);
+
+
+/**
+ * Apply level adjustment to the mixing buffer and convert it to 16bit
+ * samples with saturation, and calculate the sum of the absolute value
+ * of the resulting samples.
+ *
+ * @param dst           Destination buffer. This may point to the start of
+ *                      the mixing buffer itself, in which case the
+ *                      conversion is done in place.
+ * @param mix_buf       The 32bit mixing buffer.
+ * @param count         Number of samples.
+ * @param adj           Level adjustment, 128 is the normal level.
+ *
+ * @return              Sum of the absolute value of the 16bit samples.
+ */
+PJ_DECL(pj_uint32_t) pjmedia_mix_clamp(pj_int16_t *dst,
+                                       const pj_int32_t *mix_buf,
+                                       unsigned count,
+                                       unsigned adj);
+
+
+PJ_END_DECL
+
+
+/**
+ * @}
+ */
+
+
+#endif  /* __PJMEDIA_MIX_H__ */
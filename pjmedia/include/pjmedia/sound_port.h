@@ -79,7 +79,17 @@ enum pjmedia_snd_port_option
      *
      * This option is not applicable for encoded/non-PCM format.
      */
-    PJMEDIA_SND_PORT_USE_SW_CLOCK  = 2
+    PJMEDIA_SND_PORT_USE_SW_CLOCK  = 2,
+
+    /**
+     * When PJMEDIA_SND_PORT_USE_SW_CLOCK is used, hand the frames between
+     * the sound device and the clock thread through simple FIFO delay
+     * buffers (see #PJMEDIA_DELAY_BUF_SIMPLE_FIFO), which don't take a
+     * lock. Since simple FIFO doesn't compensate clock drift, this is
+     * only suitable when the sound device and the system clock don't
+     * drift apart, e.g. for null or virtual sound devices.
+     */
+    PJMEDIA_SND_PORT_SW_CLOCK_SIMPLE_FIFO = 4
 };
 
 /**
@@ -216,6 +216,51 @@ PJ_DECL(pj_status_t) pjmedia_stream_get_port(pjmedia_stream *stream,
                                              pjmedia_port **p_port );
 
 
+/**
+ * Check whether two streams encode audio the same way, i.e. they use the
+ * same codec with the same clock rate, channel count, frames per packet,
+ * VAD setting and encoding format parameters. The payload encoded by one
+ * of such streams can be transmitted by the other, see
+ * #pjmedia_stream_put_frame_from().
+ *
+ * @param stream1       The first stream.
+ * @param stream2       The second stream.
+ *
+ * @return              PJ_TRUE if the streams encode audio the same way.
+ */
+PJ_DECL(pj_bool_t) pjmedia_stream_is_enc_compatible(
+                                        const pjmedia_stream *stream1,
+                                        const pjmedia_stream *stream2);
+
+
+/**
+ * Transmit an audio frame like the put_frame() of the stream port, but
+ * reuse the payload that another stream has just encoded from the very
+ * same frame instead of encoding it again. This lets an application that
+ * sends the same audio to many streams, such as the conference bridge
+ * with #PJMEDIA_CONF_FANOUT, encode the audio once per codec setting.
+ *
+ * The encoded payload is reused only if enc_stream transmitted a frame
+ * with the same buffer and timestamp as its last frame, otherwise the
+ * frame is encoded as usual. The RTP packetization, statistics and DTMF
+ * handling are still done by this stream. The two streams must be
+ * compatible according to #pjmedia_stream_is_enc_compatible(). Note that
+ * the encoder of this stream is not run while the payload is reused, so
+ * with a codec that keeps state between frames the first frames encoded
+ * by this stream afterwards may be slightly distorted.
+ *
+ * @param stream        The media stream.
+ * @param frame         The audio frame to transmit.
+ * @param enc_stream    The stream that has just transmitted the frame,
+ *                      or NULL to just encode the frame.
+ *
+ * @return              PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_stream_put_frame_from(pjmedia_stream *stream,
+                                                   pjmedia_frame *frame,
+                                                   pjmedia_stream *enc_stream);
+
+
 /**
  * Get the media transport object associated with this stream.
  *
@@ -83,6 +83,9 @@ typedef struct pjmedia_stream_common
 
     pj_mutex_t              *jb_mutex;
     pjmedia_jbuf            *jb;            /**< Jitter buffer.             */
+    pj_bool_t                rx_batch;      /**< Handling a batch of RTP?   */
+    pj_bool_t                rx_batch_locked;/**< jb_mutex kept locked over
+                                                 the batch?                 */
     char                     jb_last_frm;   /**< Last frame type from jb    */
     unsigned                 jb_last_frm_cnt;/**< Last JB frame type counter*/
 
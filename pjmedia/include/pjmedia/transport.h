@@ -668,6 +668,23 @@ struct pjmedia_transport_attach_param
      */
     void (*rtp_cb2)(pjmedia_tp_cb_param *param);
 
+    /**
+     * Optional callback to be called when several RTP packets are
+     * received on the transport at once, e.g: read with a single
+     * recvmmsg() call. Transports that do not support batching ignore
+     * it, and transports that do may still report single packets with
+     * #rtp_cb2, so #rtp_cb2 must be set too. The \a rem_switch field
+     * is checked for each packet, in order.
+     *
+     * Adapters that install their own #rtp_cb2 on the member transport
+     * must clear this field (or replace it with their own batch
+     * callback), otherwise packets would bypass the adapter.
+     *
+     * @param param     Array of received packets.
+     * @param count     Number of packets in the array.
+     */
+    void (*rtp_batch_cb)(pjmedia_tp_cb_param *param, unsigned count);
+
 };
 
 /**
@@ -0,0 +1,773 @@
+/*
+ * Copyright (C) 2025 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <pjmedia/alaw_ulaw.h>
+#include <pjmedia/errno.h>
+#include <pj/assert.h>
+#include <pj/log.h>
+#include <pj/string.h>
+
+#define THIS_FILE       "alaw_ulaw_bulk.c"
+
+/* The SIMD kernels compute the companding arithmetically, and must give
+ * the same result as the per-sample conversion in use. The lookup tables
+ * drop the two lowest bits of the sample before encoding and have no
+ * special case for U-Law zero, while the reference functions in
+ * alaw_ulaw.c use the full sample, bias negative A-Law samples by 8, and
+ * decode U-Law zero as zero.
+ */
+#if defined(PJMEDIA_HAS_ALAW_ULAW_TABLE) && PJMEDIA_HAS_ALAW_ULAW_TABLE!=0
+#   define ENC_MASK             0xFFFC
+#   define ALAW_NEG_BIAS        0
+#   define ULAW_ZERO_IS_ZERO    0
+#else
+#   define ENC_MASK             0xFFFF
+#   define ALAW_NEG_BIAS        8
+#   define ULAW_ZERO_IS_ZERO    1
+#endif
+
+
+typedef void (*g711_encode_func)(pj_uint8_t *dst, const pj_int16_t *src,
+                                 pj_size_t count);
+typedef void (*g711_decode_func)(pj_int16_t *dst, const pj_uint8_t *src,
+                                 pj_size_t count);
+
+struct g711_impl
+{
+    const char          *name;
+    g711_encode_func     ulaw_encode;
+    g711_encode_func     alaw_encode;
+    g711_decode_func     ulaw_decode;
+    g711_decode_func     alaw_decode;
+};
+
+
+/*
+ * Portable C implementation. The SIMD kernels use these for the samples
+ * left over after the last full vector.
+ */
+static void ulaw_encode_c(pj_uint8_t *dst, const pj_int16_t *src,
+                          pj_size_t count)
+{
+    pj_size_t i;
+
+    for (i = 0; i < count; ++i)
+        dst[i] = pjmedia_linear2ulaw(src[i]);
+}
+
+static void alaw_encode_c(pj_uint8_t *dst, const pj_int16_t *src,
+                          pj_size_t count)
+{
+    pj_size_t i;
+
+    for (i = 0; i < count; ++i)
+        dst[i] = pjmedia_linear2alaw(src[i]);
+}
+
+static void ulaw_decode_c(pj_int16_t *dst, const pj_uint8_t *src,
+                          pj_size_t count)
+{
+    pj_size_t i;
+
+    for (i = 0; i < count; ++i)
+        dst[i] = (pj_int16_t) pjmedia_ulaw2linear(src[i]);
+}
+
+static void alaw_decode_c(pj_int16_t *dst, const pj_uint8_t *src,
+                          pj_size_t count)
+{
+    pj_size_t i;
+
+    for (i = 0; i < count; ++i)
+        dst[i] = (pj_int16_t) pjmedia_alaw2linear(src[i]);
+}
+
+static const struct g711_impl g711_c =
+{
+    "c", &ulaw_encode_c, &alaw_encode_c, &ulaw_decode_c, &alaw_decode_c
+};
+
+
+#if defined(PJMEDIA_G711_USE_SIMD) && PJMEDIA_G711_USE_SIMD != 0 && \
+    (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+
+#include <immintrin.h>
+
+#define G711_HAS_SIMD   1
+
+/*
+ * SSSE3 and AVX2 implementation. Samples are processed in 16bit lanes.
+ * The segment is looked up with PSHUFB, and the per-lane shifts, which
+ * SSE has no instruction for, are done by multiplying with a power of two
+ * also looked up with PSHUFB.
+ *
+ * For encoding, mulhi(p, 1 << (13 - seg)) is p >> (seg + 3).
+ */
+#define SSSE3_FN    __attribute__((target("ssse3"))) static
+#define AVX2_FN     __attribute__((target("avx2"))) static
+
+/* 16bit lookup tables, indexed by the segment */
+#define ULAW_SHIFT_TAB  8192, 4096, 2048, 1024, 512, 256, 128, 64
+#define ALAW_SHIFT_TAB  4096, 4096, 2048, 1024, 512, 256, 128, 64
+#define ALAW_EXP_TAB    1, 1, 2, 4, 8, 16, 32, 64
+#define ULAW_EXP_TAB    1, 2, 4, 8, 16, 32, 64, 128
+
+/* 8bit lookup tables of the segment, for the low and the high nibble of
+ * p >> 8
+ */
+#define SEG_LO_TAB      0, 1, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4
+#define SEG_HI_TAB      0, 5, 6, 6, 7, 7, 7, 7, 0, 0, 0, 0, 0, 0, 0, 0
+
+/* PSHUFB index to fetch the 16bit table entry of each lane's segment */
+SSSE3_FN __m128i tab_idx_ssse3(__m128i seg)
+{
+    __m128i idx = _mm_slli_epi16(seg, 1);
+
+    idx = _mm_or_si128(idx, _mm_slli_epi16(idx, 8));
+    return _mm_or_si128(idx, _mm_set1_epi16(0x0100));
+}
+
+/* Segment of the magnitude p, i.e. the bit length of p >> 8, looked up
+ * with PSHUFB for each nibble. p must be in 0..32767.
+ */
+SSSE3_FN __m128i seg_ssse3(__m128i p)
+{
+    const __m128i lo_tab = _mm_setr_epi8(SEG_LO_TAB);
+    const __m128i hi_tab = _mm_setr_epi8(SEG_HI_TAB);
+    const __m128i nibble = _mm_set1_epi16(0x0F);
+    __m128i lo, hi;
+
+    lo = _mm_shuffle_epi8(lo_tab, _mm_and_si128(_mm_srli_epi16(p, 8),
+                                                nibble));
+    hi = _mm_shuffle_epi8(hi_tab, _mm_srli_epi16(p, 12));
+    return _mm_max_epu8(lo, hi);
+}
+
+/* Encode 8 samples to U-Law, the codes are in the low byte of each lane */
+SSSE3_FN __m128i ulaw_enc8_ssse3(__m128i x)
+{
+    const __m128i tab = _mm_setr_epi16(ULAW_SHIFT_TAB);
+    __m128i neg, p, seg, mant;
+
+    x = _mm_and_si128(x, _mm_set1_epi16((short)ENC_MASK));
+    neg = _mm_srai_epi16(x, 15);
+
+    /* Biased magnitude. Saturating to 32767 gives the same code as the
+     * clip of the reference implementation.
+     */
+    p = _mm_max_epi16(x, _mm_subs_epi16(_mm_setzero_si128(), x));
+    p = _mm_adds_epi16(p, _mm_set1_epi16(0x84));
+
+    seg = seg_ssse3(p);
+    mant = _mm_mulhi_epu16(p, _mm_shuffle_epi8(tab, tab_idx_ssse3(seg)));
+    mant = _mm_and_si128(mant, _mm_set1_epi16(0x0F));
+
+    return _mm_xor_si128(_mm_or_si128(_mm_slli_epi16(seg, 4), mant),
+                         _mm_xor_si128(_mm_set1_epi16(0xFF),
+                                       _mm_and_si128(neg,
+                                                     _mm_set1_epi16(0x80))));
+}
+
+/* Encode 8 samples to A-Law, the codes are in the low byte of each lane */
+SSSE3_FN __m128i alaw_enc8_ssse3(__m128i x)
+{
+    const __m128i tab = _mm_setr_epi16(ALAW_SHIFT_TAB);
+    __m128i neg, p, seg, mant;
+
+    x = _mm_and_si128(x, _mm_set1_epi16((short)ENC_MASK));
+    neg = _mm_srai_epi16(x, 15);
+
+    /* Magnitude as unsigned, with the bias of the negative samples, then
+     * limited to 32767.
+     */
+    p = _mm_subs_epu16(_mm_sub_epi16(_mm_setzero_si128(), x),
+                       _mm_set1_epi16(ALAW_NEG_BIAS));
+    p = _mm_or_si128(_mm_and_si128(neg, p), _mm_andnot_si128(neg, x));
+    p = _mm_sub_epi16(p, _mm_srli_epi16(p, 15));
+
+    seg = seg_ssse3(p);
+    mant = _mm_mulhi_epu16(p, _mm_shuffle_epi8(tab, tab_idx_ssse3(seg)));
+    mant = _mm_and_si128(mant, _mm_set1_epi16(0x0F));
+
+    return _mm_xor_si128(_mm_or_si128(_mm_slli_epi16(seg, 4), mant),
+                         _mm_xor_si128(_mm_set1_epi16(0xD5),
+                                       _mm_and_si128(neg,
+                                                     _mm_set1_epi16(0x80))));
+}
+
+/* Decode 8 U-Law codes, given in the low byte of each lane */
+SSSE3_FN __m128i ulaw_dec8_ssse3(__m128i u)
+{
+    const __m128i tab = _mm_setr_epi16(ULAW_EXP_TAB);
+    __m128i v, exp, t, sign;
+
+    v = _mm_xor_si128(u, _mm_set1_epi16(0xFF));
+    exp = _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi16(7));
+    t = _mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0x0F)), 3);
+    t = _mm_add_epi16(t, _mm_set1_epi16(0x84));
+    t = _mm_mullo_epi16(t, _mm_shuffle_epi8(tab, tab_idx_ssse3(exp)));
+    t = _mm_sub_epi16(t, _mm_set1_epi16(0x84));
+
+    sign = _mm_cmpgt_epi16(v, _mm_set1_epi16(0x7F));
+    t = _mm_sub_epi16(_mm_xor_si128(t, sign), sign);
+#if ULAW_ZERO_IS_ZERO
+    t = _mm_andnot_si128(_mm_cmpeq_epi16(u, _mm_setzero_si128()), t);
+#endif
+    return t;
+}
+
+/* Decode 8 A-Law codes, given in the low byte of each lane */
+SSSE3_FN __m128i alaw_dec8_ssse3(__m128i a)
+{
+    const __m128i tab = _mm_setr_epi16(ALAW_EXP_TAB);
+    __m128i v, seg, t, sign;
+
+    v = _mm_xor_si128(a, _mm_set1_epi16(0x55));
+    seg = _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi16(7));
+    t = _mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0x0F)), 4);
+    t = _mm_add_epi16(t, _mm_set1_epi16(8));
+    t = _mm_add_epi16(t, _mm_andnot_si128(_mm_cmpeq_epi16(seg,
+                                                  _mm_setzero_si128()),
+                                          _mm_set1_epi16(0x100)));
+    t = _mm_mullo_epi16(t, _mm_shuffle_epi8(tab, tab_idx_ssse3(seg)));
+
+    sign = _mm_cmpgt_epi16(_mm_set1_epi16(0x80), v);
+    return _mm_sub_epi16(_mm_xor_si128(t, sign), sign);
+}
+
+#define ENCODE_SSSE3(NAME, ENC8)                                        \
+SSSE3_FN void NAME##_ssse3(pj_uint8_t *dst, const pj_int16_t *src,     \
+                           pj_size_t count)                             \
+{                                                                       \
+    pj_size_t i;                                                        \
+    for (i = 0; i + 16 <= count; i += 16) {                             \
+        __m128i a = _mm_loadu_si128((const __m128i*)(src + i));         \
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i + 8));     \
+        _mm_storeu_si128((__m128i*)(dst + i),                           \
+                         _mm_packus_epi16(ENC8(a), ENC8(b)));           \
+    }                                                                   \
+    NAME##_c(dst + i, src + i, count - i);                              \
+}
+
+#define DECODE_SSSE3(NAME, DEC8)                                        \
+SSSE3_FN void NAME##_ssse3(pj_int16_t *dst, const pj_uint8_t *src,     \
+                           pj_size_t count)                             \
+{                                                                       \
+    const __m128i zero = _mm_setzero_si128();                           \
+    pj_size_t i;                                                        \
+    for (i = 0; i + 16 <= count; i += 16) {                             \
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));         \
+        _mm_storeu_si128((__m128i*)(dst + i),                           \
+                         DEC8(_mm_unpacklo_epi8(v, zero)));             \
+        _mm_storeu_si128((__m128i*)(dst + i + 8),                       \
+                         DEC8(_mm_unpackhi_epi8(v, zero)));             \
+    }                                                                   \
+    NAME##_c(dst + i, src + i, count - i);                              \
+}
+
+ENCODE_SSSE3(ulaw_encode, ulaw_enc8_ssse3)
+ENCODE_SSSE3(alaw_encode, alaw_enc8_ssse3)
+DECODE_SSSE3(ulaw_decode, ulaw_dec8_ssse3)
+DECODE_SSSE3(alaw_decode, alaw_dec8_ssse3)
+
+
+static const struct g711_impl g711_ssse3 =
+{
+    "ssse3", &ulaw_encode_ssse3, &alaw_encode_ssse3, &ulaw_decode_ssse3,
+    &alaw_decode_ssse3
+};
+
+
+/* The AVX2 versions of the above, 16 samples at a time. PSHUFB works
+ * within each 128bit half, so the tables are repeated in both halves.
+ */
+AVX2_FN __m256i tab_idx_avx2(__m256i seg)
+{
+    __m256i idx = _mm256_slli_epi16(seg, 1);
+
+    idx = _mm256_or_si256(idx, _mm256_slli_epi16(idx, 8));
+    return _mm256_or_si256(idx, _mm256_set1_epi16(0x0100));
+}
+
+AVX2_FN __m256i seg_avx2(__m256i p)
+{
+    const __m256i lo_tab = _mm256_setr_epi8(SEG_LO_TAB, SEG_LO_TAB);
+    const __m256i hi_tab = _mm256_setr_epi8(SEG_HI_TAB, SEG_HI_TAB);
+    const __m256i nibble = _mm256_set1_epi16(0x0F);
+    __m256i lo, hi;
+
+    lo = _mm256_shuffle_epi8(lo_tab, _mm256_and_si256(_mm256_srli_epi16(p, 8),
+                                                      nibble));
+    hi = _mm256_shuffle_epi8(hi_tab, _mm256_srli_epi16(p, 12));
+    return _mm256_max_epu8(lo, hi);
+}
+
+AVX2_FN __m256i ulaw_enc16_avx2(__m256i x)
+{
+    const __m256i tab = _mm256_setr_epi16(ULAW_SHIFT_TAB, ULAW_SHIFT_TAB);
+    __m256i neg, p, seg, mant;
+
+    x = _mm256_and_si256(x, _mm256_set1_epi16((short)ENC_MASK));
+    neg = _mm256_srai_epi16(x, 15);
+
+    p = _mm256_max_epi16(x, _mm256_subs_epi16(_mm256_setzero_si256(), x));
+    p = _mm256_adds_epi16(p, _mm256_set1_epi16(0x84));
+
+    seg = seg_avx2(p);
+    mant = _mm256_mulhi_epu16(p, _mm256_shuffle_epi8(tab,
+                                                     tab_idx_avx2(seg)));
+    mant = _mm256_and_si256(mant, _mm256_set1_epi16(0x0F));
+
+    return _mm256_xor_si256(_mm256_or_si256(_mm256_slli_epi16(seg, 4), mant),
+                            _mm256_xor_si256(_mm256_set1_epi16(0xFF),
+                                    _mm256_and_si256(neg,
+                                                _mm256_set1_epi16(0x80))));
+}
+
+AVX2_FN __m256i alaw_enc16_avx2(__m256i x)
+{
+    const __m256i tab = _mm256_setr_epi16(ALAW_SHIFT_TAB, ALAW_SHIFT_TAB);
+    __m256i neg, p, seg, mant;
+
+    x = _mm256_and_si256(x, _mm256_set1_epi16((short)ENC_MASK));
+    neg = _mm256_srai_epi16(x, 15);
+
+    p = _mm256_subs_epu16(_mm256_sub_epi16(_mm256_setzero_si256(), x),
+                          _mm256_set1_epi16(ALAW_NEG_BIAS));
+    p = _mm256_blendv_epi8(x, p, neg);
+    p = _mm256_sub_epi16(p, _mm256_srli_epi16(p, 15));
+
+    seg = seg_avx2(p);
+    mant = _mm256_mulhi_epu16(p, _mm256_shuffle_epi8(tab,
+                                                     tab_idx_avx2(seg)));
+    mant = _mm256_and_si256(mant, _mm256_set1_epi16(0x0F));
+
+    return _mm256_xor_si256(_mm256_or_si256(_mm256_slli_epi16(seg, 4), mant),
+                            _mm256_xor_si256(_mm256_set1_epi16(0xD5),
+                                    _mm256_and_si256(neg,
+                                                _mm256_set1_epi16(0x80))));
+}
+
+AVX2_FN __m256i ulaw_dec16_avx2(__m256i u)
+{
+    const __m256i tab = _mm256_setr_epi16(ULAW_EXP_TAB, ULAW_EXP_TAB);
+    __m256i v, exp, t, sign;
+
+    v = _mm256_xor_si256(u, _mm256_set1_epi16(0xFF));
+    exp = _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi16(7));
+    t = _mm256_slli_epi16(_mm256_and_si256(v, _mm256_set1_epi16(0x0F)), 3);
+    t = _mm256_add_epi16(t, _mm256_set1_epi16(0x84));
+    t = _mm256_mullo_epi16(t, _mm256_shuffle_epi8(tab, tab_idx_avx2(exp)));
+    t = _mm256_sub_epi16(t, _mm256_set1_epi16(0x84));
+
+    sign = _mm256_cmpgt_epi16(v, _mm256_set1_epi16(0x7F));
+    t = _mm256_sub_epi16(_mm256_xor_si256(t, sign), sign);
+#if ULAW_ZERO_IS_ZERO
+    t = _mm256_andnot_si256(_mm256_cmpeq_epi16(u, _mm256_setzero_si256()), t);
+#endif
+    return t;
+}
+
+AVX2_FN __m256i alaw_dec16_avx2(__m256i a)
+{
+    const __m256i tab = _mm256_setr_epi16(ALAW_EXP_TAB, ALAW_EXP_TAB);
+    __m256i v, seg, t, sign;
+
+    v = _mm256_xor_si256(a, _mm256_set1_epi16(0x55));
+    seg = _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi16(7));
+    t = _mm256_slli_epi16(_mm256_and_si256(v, _mm256_set1_epi16(0x0F)), 4);
+    t = _mm256_add_epi16(t, _mm256_set1_epi16(8));
+    t = _mm256_add_epi16(t, _mm256_andnot_si256(
+                                _mm256_cmpeq_epi16(seg,
+                                                   _mm256_setzero_si256()),
+                                _mm256_set1_epi16(0x100)));
+    t = _mm256_mullo_epi16(t, _mm256_shuffle_epi8(tab, tab_idx_avx2(seg)));
+
+    sign = _mm256_cmpgt_epi16(_mm256_set1_epi16(0x80), v);
+    return _mm256_sub_epi16(_mm256_xor_si256(t, sign), sign);
+}
+
+/* PACKUS interleaves the 128bit halves of its operands, the permutation
+ * puts the 32 codes back in order.
+ */
+#define PACK_AVX2(a, b) \
+            _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8)
+
+#define ENCODE_AVX2(NAME, ENC16)                                        \
+AVX2_FN void NAME##_avx2(pj_uint8_t *dst, const pj_int16_t *src,       \
+                         pj_size_t count)                               \
+{                                                                       \
+    pj_size_t i;                                                        \
+    for (i = 0; i + 32 <= count; i += 32) {                             \
+        __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));      \
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i + 16)); \
+        _mm256_storeu_si256((__m256i*)(dst + i),                        \
+                            PACK_AVX2(ENC16(a), ENC16(b)));             \
+    }                                                                   \
+    NAME##_ssse3(dst + i, src + i, count - i);                          \
+}
+
+#define DECODE_AVX2(NAME, DEC16)                                        \
+AVX2_FN void NAME##_avx2(pj_int16_t *dst, const pj_uint8_t *src,       \
+                         pj_size_t count)                               \
+{                                                                       \
+    pj_size_t i;                                                        \
+    for (i = 0; i + 32 <= count; i += 32) {                             \
+        __m128i a = _mm_loadu_si128((const __m128i*)(src + i));         \
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i + 16));    \
+        _mm256_storeu_si256((__m256i*)(dst + i),                        \
+                            DEC16(_mm256_cvtepu8_epi16(a)));            \
+        _mm256_storeu_si256((__m256i*)(dst + i + 16),                   \
+                            DEC16(_mm256_cvtepu8_epi16(b)));            \
+    }                                                                   \
+    NAME##_ssse3(dst + i, src + i, count - i);                          \
+}
+
+ENCODE_AVX2(ulaw_encode, ulaw_enc16_avx2)
+ENCODE_AVX2(alaw_encode, alaw_enc16_avx2)
+DECODE_AVX2(ulaw_decode, ulaw_dec16_avx2)
+DECODE_AVX2(alaw_decode, alaw_dec16_avx2)
+
+
+static const struct g711_impl g711_avx2 =
+{
+    "avx2", &ulaw_encode_avx2, &alaw_encode_avx2, &ulaw_decode_avx2,
+    &alaw_decode_avx2
+};
+
+#define G711_MAX_SIMD   2
+
+/* Get the SIMD implementations supported by the CPU, best first */
+static unsigned g711_enum_simd(const struct g711_impl *impl[])
+{
+    unsigned cnt = 0;
+
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        impl[cnt++] = &g711_avx2;
+    if (__builtin_cpu_supports("ssse3"))
+        impl[cnt++] = &g711_ssse3;
+    return cnt;
+}
+
+
+#elif defined(PJMEDIA_G711_USE_SIMD) && PJMEDIA_G711_USE_SIMD != 0 && \
+      defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+
+#include <arm_neon.h>
+
+#define G711_HAS_SIMD   1
+
+/*
+ * NEON implementation. NEON has per-lane shifts and leading zero count,
+ * so the segment and the shifts are computed directly.
+ */
+
+/* Segment of the magnitude p, p must be in 0..32767 */
+static uint16x8_t seg_neon(uint16x8_t p)
+{
+    return vqsubq_u16(vdupq_n_u16(8), vclzq_u16(p));
+}
+
+static uint16x8_t ulaw_enc8_neon(int16x8_t x)
+{
+    uint16x8_t neg, p, seg, mant;
+    int16x8_t shift;
+
+    x = vandq_s16(x, vdupq_n_s16((short)ENC_MASK));
+    neg = vreinterpretq_u16_s16(vshrq_n_s16(x, 15));
+
+    p = vreinterpretq_u16_s16(vqaddq_s16(vqabsq_s16(x), vdupq_n_s16(0x84)));
+    seg = seg_neon(p);
+    shift = vnegq_s16(vreinterpretq_s16_u16(vaddq_u16(seg, vdupq_n_u16(3))));
+    mant = vandq_u16(vshlq_u16(p, shift), vdupq_n_u16(0x0F));
+
+    return veorq_u16(vorrq_u16(vshlq_n_u16(seg, 4), mant),
+                     veorq_u16(vdupq_n_u16(0xFF),
+                               vandq_u16(neg, vdupq_n_u16(0x80))));
+}
+
+static uint16x8_t alaw_enc8_neon(int16x8_t x)
+{
+    uint16x8_t neg, p, seg, mant;
+    int16x8_t shift;
+
+    x = vandq_s16(x, vdupq_n_s16((short)ENC_MASK));
+    neg = vreinterpretq_u16_s16(vshrq_n_s16(x, 15));
+
+    p = vqsubq_u16(vreinterpretq_u16_s16(vnegq_s16(x)),
+                   vdupq_n_u16(ALAW_NEG_BIAS));
+    p = vbslq_u16(neg, p, vreinterpretq_u16_s16(x));
+    p = vminq_u16(p, vdupq_n_u16(0x7FFF));
+
+    seg = seg_neon(p);
+    shift = vreinterpretq_s16_u16(vmaxq_u16(vaddq_u16(seg, vdupq_n_u16(3)),
+                                            vdupq_n_u16(4)));
+    mant = vandq_u16(vshlq_u16(p, vnegq_s16(shift)), vdupq_n_u16(0x0F));
+
+    return veorq_u16(vorrq_u16(vshlq_n_u16(seg, 4), mant),
+                     veorq_u16(vdupq_n_u16(0xD5),
+                               vandq_u16(neg, vdupq_n_u16(0x80))));
+}
+
+static int16x8_t ulaw_dec8_neon(uint16x8_t u)
+{
+    uint16x8_t v, exp, t, sign;
+    int16x8_t r;
+
+    v = veorq_u16(u, vdupq_n_u16(0xFF));
+    exp = vandq_u16(vshrq_n_u16(v, 4), vdupq_n_u16(7));
+    t = vshlq_n_u16(vandq_u16(v, vdupq_n_u16(0x0F)), 3);
+    t = vaddq_u16(t, vdupq_n_u16(0x84));
+    t = vshlq_u16(t, vreinterpretq_s16_u16(exp));
+    r = vreinterpretq_s16_u16(vsubq_u16(t, vdupq_n_u16(0x84)));
+
+    sign = vtstq_u16(v, vdupq_n_u16(0x80));
+    r = vbslq_s16(sign, vnegq_s16(r), r);
+#if ULAW_ZERO_IS_ZERO
+    r = vbicq_s16(r, vreinterpretq_s16_u16(vceqq_u16(u, vdupq_n_u16(0))));
+#endif
+    return r;
+}
+
+static int16x8_t alaw_dec8_neon(uint16x8_t a)
+{
+    uint16x8_t v, seg, t, sign;
+    int16x8_t r;
+
+    v = veorq_u16(a, vdupq_n_u16(0x55));
+    seg = vandq_u16(vshrq_n_u16(v, 4), vdupq_n_u16(7));
+    t = vshlq_n_u16(vandq_u16(v, vdupq_n_u16(0x0F)), 4);
+    t = vaddq_u16(t, vdupq_n_u16(8));
+    t = vaddq_u16(t, vandq_u16(vtstq_u16(seg, seg), vdupq_n_u16(0x100)));
+    t = vshlq_u16(t, vreinterpretq_s16_u16(vqsubq_u16(seg, vdupq_n_u16(1))));
+    r = vreinterpretq_s16_u16(t);
+
+    sign = vtstq_u16(v, vdupq_n_u16(0x80));
+    return vbslq_s16(sign, r, vnegq_s16(r));
+}
+
+#define ENCODE_NEON(NAME, ENC8)                                         \
+static void NAME##_neon(pj_uint8_t *dst, const pj_int16_t *src,        \
+                        pj_size_t count)                                \
+{                                                                       \
+    pj_size_t i;                                                        \
+    for (i = 0; i + 16 <= count; i += 16) {                             \
+        uint8x8_t a = vmovn_u16(ENC8(vld1q_s16(src + i)));              \
+        uint8x8_t b = vmovn_u16(ENC8(vld1q_s16(src + i + 8)));          \
+        vst1q_u8(dst + i, vcombine_u8(a, b));                           \
+    }                                                                   \
+    NAME##_c(dst + i, src + i, count - i);                              \
+}
+
+#define DECODE_NEON(NAME, DEC8)                                         \
+static void NAME##_neon(pj_int16_t *dst, const pj_uint8_t *src,        \
+                        pj_size_t count)                                \
+{                                                                       \
+    pj_size_t i;                                                        \
+    for (i = 0; i + 16 <= count; i += 16) {                             \
+        uint8x16_t v = vld1q_u8(src + i);                               \
+        vst1q_s16(dst + i, DEC8(vmovl_u8(vget_low_u8(v))));             \
+        vst1q_s16(dst + i + 8, DEC8(vmovl_u8(vget_high_u8(v))));        \
+    }                                                                   \
+    NAME##_c(dst + i, src + i, count - i);                              \
+}
+
+ENCODE_NEON(ulaw_encode, ulaw_enc8_neon)
+ENCODE_NEON(alaw_encode, alaw_enc8_neon)
+DECODE_NEON(ulaw_decode, ulaw_dec8_neon)
+DECODE_NEON(alaw_decode, alaw_dec8_neon)
+
+
+static const struct g711_impl g711_neon =
+{
+    "neon", &ulaw_encode_neon, &alaw_encode_neon, &ulaw_decode_neon,
+    &alaw_decode_neon
+};
+
+#define G711_MAX_SIMD   1
+
+static unsigned g711_enum_simd(const struct g711_impl *impl[])
+{
+    /* NEON is mandatory on ARM64 */
+    impl[0] = &g711_neon;
+    return 1;
+}
+
+
+#else
+
+#define G711_HAS_SIMD   0
+#define G711_MAX_SIMD   0
+
+static unsigned g711_enum_simd(const struct g711_impl *impl[])
+{
+    PJ_UNUSED_ARG(impl);
+    return 0;
+}
+
+#endif
+
+
+/* Get all the implementations that can run on this CPU, best first */
+static unsigned g711_enum(const struct g711_impl *impl[G711_MAX_SIMD+1])
+{
+    unsigned cnt = g711_enum_simd(impl);
+
+    impl[cnt++] = &g711_c;
+    return cnt;
+}
+
+/* Get the best SIMD implementation, or NULL if there is none */
+static const struct g711_impl *g711_select(void)
+{
+    const struct g711_impl *impl[G711_MAX_SIMD+1];
+
+    return g711_enum(impl) > 1 ? impl[0] : NULL;
+}
+
+
+/* The implementation in use. This starts with the C implementation and
+ * is switched to the SIMD one on first use, unless the application has
+ * chosen explicitly with pjmedia_g711_enable_simd().
+ */
+static const struct g711_impl *g711 = &g711_c;
+static pj_bool_t g711_initialized;
+
+static void g711_init(void)
+{
+    const struct g711_impl *impl = g711_select();
+
+    if (impl)
+        g711 = impl;
+    g711_initialized = PJ_TRUE;
+}
+
+#define G711_INIT()     if (!g711_initialized) g711_init()
+
+
+PJ_DEF(pj_status_t) pjmedia_g711_enable_simd(pj_bool_t enable)
+{
+    const struct g711_impl *impl = enable ? g711_select() : &g711_c;
+
+    if (!impl)
+        return PJ_ENOTSUP;
+
+    g711 = impl;
+    g711_initialized = PJ_TRUE;
+
+    PJ_LOG(4,(THIS_FILE, "G.711 companding uses %s implementation",
+              g711->name));
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(pj_status_t) pjmedia_g711_enum_impl(unsigned *count,
+                                           const char *names[])
+{
+    const struct g711_impl *impl[G711_MAX_SIMD+1];
+    unsigned i, cnt;
+
+    PJ_ASSERT_RETURN(count && names, PJ_EINVAL);
+
+    cnt = g711_enum(impl);
+    if (cnt > *count)
+        cnt = *count;
+    for (i = 0; i < cnt; ++i)
+        names[i] = impl[i]->name;
+    *count = cnt;
+
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(pj_status_t) pjmedia_g711_set_impl(const char *name)
+{
+    const struct g711_impl *impl[G711_MAX_SIMD+1];
+    unsigned i, cnt;
+
+    PJ_ASSERT_RETURN(name, PJ_EINVAL);
+
+    cnt = g711_enum(impl);
+    for (i = 0; i < cnt; ++i) {
+        if (pj_ansi_stricmp(impl[i]->name, name) == 0)
+            break;
+    }
+    if (i == cnt)
+        return PJ_ENOTSUP;
+
+    g711 = impl[i];
+    g711_initialized = PJ_TRUE;
+
+    PJ_LOG(4,(THIS_FILE, "G.711 companding uses %s implementation",
+              g711->name));
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(const char*) pjmedia_g711_get_impl_name(void)
+{
+    G711_INIT();
+    return g711->name;
+}
+
+PJ_DEF(void) pjmedia_ulaw_encode(pj_uint8_t *dst, const pj_int16_t *src,
+                                 pj_size_t count)
+{
+    G711_INIT();
+    (*g711->ulaw_encode)(dst, src, count);
+}
+
+PJ_DEF(void) pjmedia_alaw_encode(pj_uint8_t *dst, const pj_int16_t *src,
+                                 pj_size_t count)
+{
+    G711_INIT();
+    (*g711->alaw_encode)(dst, src, count);
+}
+
+PJ_DEF(void) pjmedia_ulaw_decode(pj_int16_t *dst, const pj_uint8_t *src,
+                                 pj_size_t len)
+{
+    G711_INIT();
+    (*g711->ulaw_decode)(dst, src, len);
+}
+
+PJ_DEF(void) pjmedia_alaw_decode(pj_int16_t *dst, const pj_uint8_t *src,
+                                 pj_size_t len)
+{
+    G711_INIT();
+    (*g711->alaw_decode)(dst, src, len);
+}
+
+/* Transcoding is a single table lookup per sample when the lookup tables
+ * are in use, which the SIMD instructions can't improve on.
+ */
+PJ_DEF(void) pjmedia_alaw_to_ulaw(pj_uint8_t *dst, const pj_uint8_t *src,
+                                  pj_size_t count)
+{
+    pj_size_t i;
+
+    for (i = 0; i < count; ++i)
+        dst[i] = pjmedia_alaw2ulaw(src[i]);
+}
+
+PJ_DEF(void) pjmedia_ulaw_to_alaw(pj_uint8_t *dst, const pj_uint8_t *src,
+                                  pj_size_t count)
+{
+    pj_size_t i;
+
+    for (i = 0; i < count; ++i)
+        dst[i] = pjmedia_ulaw2alaw(src[i]);
+}
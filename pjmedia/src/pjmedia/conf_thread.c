@@ -25,17 +25,20 @@
 #include <pjmedia/alaw_ulaw.h>
 #include <pjmedia/delaybuf.h>
 #include <pjmedia/errno.h>
+#include <pjmedia/mix.h>
 #include <pjmedia/port.h>
 #include <pjmedia/resample.h>
 #include <pjmedia/silencedet.h>
 #include <pjmedia/sound_port.h>
 #include <pjmedia/stereo.h>
+#include <pjmedia/stream.h>
 #include <pj/array.h>
 #include <pj/assert.h>
 #include <pj/log.h>
 #include <pj/pool.h>
 #include <pj/string.h>
 #include <pj/atomic_slist.h>
+#include <pj/ring.h>
 
 #if PJMEDIA_CONF_BACKEND == PJMEDIA_CONF_PARALLEL_BRIDGE_BACKEND
 
@@ -157,15 +160,13 @@ static FILE *fhnd_rec;
 /**
  * src port RX buffer to mix audiodata at the dest side
  */
-typedef struct PJ_ATOMIC_SLIST_ALIGN_PREFIX rx_buffer_slist_node {
-    PJ_DECL_ATOMIC_SLIST_MEMBER(struct rx_buffer_slist_node);
-
+typedef struct rx_buffer_entry {
     pj_int16_t         *rx_frame_buf;/**< source data to mix                 */
     unsigned            listener_adj_level; /**< adjustment level for current
                                              * TX from current RX port       */
     struct conf_port   *rx_port;     /**< source (RX) port (for debuging)    */
 
-} PJ_ATOMIC_SLIST_ALIGN_SUFFIX rx_buffer_slist_node;
+} rx_buffer_entry;
 
 
 
@@ -188,6 +189,14 @@ struct conf_port
                                              adjustment.                    */
     unsigned             transmitter_cnt;/**<Number of transmitters.        */
 
+    /* Fan-out group (PJMEDIA_CONF_FANOUT). The members of a group are sent
+     * the signal mixed for the group leader, which links them together
+     * with fanout_next.
+     */
+    SLOT_TYPE            fanout_leader; /**< Group leader, or INVALID_SLOT
+                                             if the port mixes its own.     */
+    SLOT_TYPE            fanout_next;   /**< Next member of the group.      */
+
     /* Shortcut for port info. */
     unsigned             sampling_rate; /**< Port's sampling rate.          */
     unsigned             samples_per_frame; /**< Port's samples per frame.  */
@@ -303,8 +312,6 @@ struct conf_port
                                          * conf->rx_frame_buf_cap used in
                                          * parallel bridge implementation.
                                          */
-    pj_lock_t           *tx_lock;       /**< Lock to protect memory 
-                                         * allocation                      */
 
     pj_timestamp         last_timestamp;/**< last transmited packet
                                          * timestamp. We set this when
@@ -317,13 +324,13 @@ struct conf_port
                                          * that mixed data into this port's 
                                          * mix_buf during the current tick.*/
 
-    pj_atomic_slist     *buff_to_mix;    /**< queue to mix TX (source) data 
-                                          * for current RX (listener) port */
+    pj_ring_t           *buff_to_mix;    /**< queue to mix TX (source) data 
+                                          * for current RX (listener) port.
+                                          * Entries are copied in, so no
+                                          * node allocation is needed.     */
     pj_atomic_t         *requests_to_mix;/**< counter of requests to data 
                                           * mixing used to monopolize 
                                           * mixing operation on RX side    */
-    pj_atomic_slist     *free_node_cache;/**< cache of currently unused 
-                                          * nodes for buff_to_mix          */
 
 #ifdef CONF_DEBUG_EX
     SLOT_TYPE            slot;          /**< SLOT for debug purpose        */
@@ -424,6 +431,41 @@ struct pjmedia_conf
                                            * has data in mix_buf to
                                            * return sound playback frame    */
 
+    /* Active speaker mixing (pjmedia_conf_param.max_speakers). Instead of
+     * mixing every transmitter into every listener, the loudest speakers
+     * of the frame are summed once into spk_bus, and each listener takes
+     * the bus minus the speakers it is not connected to. The per-port
+     * arrays are indexed by slot, bit k of the masks refers to spk_slot[k].
+     * The RX threads only record the levels in spk_cand[], the speakers
+     * are selected by a single thread once all ports have been read.
+     */
+    unsigned             max_speakers;    /**< Max speakers, 0 to mix all.  */
+    unsigned             spk_cnt;         /**< Speakers in current frame.   */
+    SLOT_TYPE           *spk_slot;        /**< Slots of the speakers.       */
+    pj_uint32_t         *spk_sel_level;   /**< Levels of the speakers.      */
+    pj_int16_t         **spk_frame;       /**< Frames of the speakers, i.e.
+                                           * their rx_frame_buf             */
+    pj_int32_t          *spk_bus;         /**< Sum of all speakers.         */
+    pj_int32_t           spk_bus_min;     /**< Minimum value of spk_bus.    */
+    pj_int32_t           spk_bus_max;     /**< Maximum value of spk_bus.    */
+    pj_uint32_t         *spk_level;       /**< Smoothed RX level, per slot. */
+    pj_uint32_t         *spk_cand;        /**< Level of the port if it is a
+                                           * candidate in current frame,
+                                           * zero otherwise, per slot.      */
+    pj_uint32_t         *spk_mask;        /**< Speakers heard, per listener.*/
+    pj_uint32_t         *spk_adj_mask;    /**< Speakers heard with level
+                                           * adjustment, per listener.      */
+    unsigned            *spk_adj;         /**< The adjustments, max_speakers
+                                           * entries per listener.          */
+
+    /* Fan-out of identical mixes (PJMEDIA_CONF_FANOUT). The groups are
+     * rebuilt by the clock thread whenever the connections have changed.
+     */
+    pj_bool_t            fanout_dirty;    /**< Groups need to be rebuilt.   */
+    pj_uint64_t         *fanout_hash;     /**< Connections hash, per slot.  */
+    unsigned            *fanout_mark;     /**< Scratch array, per slot.     */
+    SLOT_TYPE           *fanout_tab;      /**< Hash table of group leaders. */
+    unsigned             fanout_tab_mask; /**< Hash table size minus one.   */
 };
 
 
@@ -448,6 +490,11 @@ static void perform_get_frame(pjmedia_conf *conf);
 static int conf_thread(void *arg);
 
 /* mix and perhaps transmit data for listener from conf_port */
+static void speaker_select(pjmedia_conf *conf);
+static void speaker_mix_listener(pjmedia_conf *conf,
+                                 struct conf_port *listener,
+                                 SLOT_TYPE listener_slot,
+                                 const pj_timestamp *timestamp);
 static void  mix_and_transmit(pjmedia_conf *conf, struct conf_port *listener, 
                               SLOT_TYPE listener_slot,
                               unsigned listener_adj_level, 
@@ -545,6 +592,7 @@ static void handle_op_queue(pjmedia_conf *conf)
             pj_assert(!"Invalid sync-op in conference");
             break;
         }
+        conf->fanout_dirty = PJ_TRUE;
         if (conf->cb) {
             pjmedia_conf_op_info info = { 0 };
 
@@ -601,7 +649,6 @@ static pj_status_t create_conf_port( pj_pool_t *parent_pool,
     pj_pool_t *pool = NULL;
     char pname[PJ_MAX_OBJ_NAME];
     pj_status_t status = PJ_SUCCESS;
-    rx_buffer_slist_node *free_node;
 
     /* Make sure pool name is NULL terminated */
     pj_assert(name);
@@ -655,6 +702,10 @@ static pj_status_t create_conf_port( pj_pool_t *parent_pool,
     conf_port->tx_adj_level = NORMAL_LEVEL;
     conf_port->rx_adj_level = NORMAL_LEVEL;
 
+    /* Not in a fan-out group */
+    conf_port->fanout_leader = INVALID_SLOT;
+    conf_port->fanout_next = INVALID_SLOT;
+
     /* Create transmit flag array */
     conf_port->listener_slots = (SLOT_TYPE*) pj_pool_zalloc(pool, 
                                           conf->max_ports * sizeof(SLOT_TYPE));
@@ -827,17 +878,20 @@ static pj_status_t create_conf_port( pj_pool_t *parent_pool,
     */
     conf_port->last_timestamp.u64 = (pj_uint64_t)-1;
 
-    if (conf->is_parallel) {
+    /* Active speaker mode also needs the frames of all ports at once */
+    if (conf->is_parallel || conf->max_speakers) {
         CONF_CHECK_NOT_NULL(conf_port->rx_frame_buf = (pj_int16_t*)pj_pool_zalloc(pool, conf->rx_frame_buf_cap), 
                          {status = PJ_ENOMEM;goto on_return;});
-        CONF_CHECK_SUCCESS(status=pj_lock_create_simple_mutex(pool, "tx_lock", &conf_port->tx_lock), goto on_return);
     }
 
-    CONF_CHECK_SUCCESS(status=pj_atomic_slist_create(pool, &conf_port->free_node_cache), goto on_return);
-    CONF_CHECK_NOT_NULL(free_node = pj_atomic_slist_calloc(pool, 1, sizeof(rx_buffer_slist_node)), 
-                     {status = PJ_ENOMEM;goto on_return;});
-    CONF_CHECK_SUCCESS(status=pj_atomic_slist_push(conf_port->free_node_cache, free_node), goto on_return);
-    CONF_CHECK_SUCCESS(status=pj_atomic_slist_create(pool, &conf_port->buff_to_mix), goto on_return);
+    /* Each transmitter queues at most one entry per tick to this port, so
+     * max_ports entries are enough. Without worker threads the entry is
+     * mixed right after it's queued.
+     */
+    CONF_CHECK_SUCCESS(status=pj_ring_create(pool, PJ_RING_MPMC,
+                                             conf->is_parallel ? conf->max_ports : 1,
+                                             sizeof(rx_buffer_entry),
+                                             &conf_port->buff_to_mix), goto on_return);
     CONF_CHECK_SUCCESS(status=pj_atomic_create(pool, 0, &conf_port->requests_to_mix), goto on_return);
 
     /* Done */
@@ -1009,6 +1063,77 @@ PJ_DEF(pj_status_t) pjmedia_conf_create( pj_pool_t *pool,
     return pjmedia_conf_create2(pool, &param, p_conf);
 }
 
+/*
+ * Allocate the active speaker mixing state.
+ */
+static pj_status_t create_speakers(pj_pool_t *pool, pjmedia_conf *conf,
+                                   unsigned max_speakers)
+{
+    unsigned max_ports = conf->max_ports;
+
+    conf->max_speakers = max_speakers;
+
+    CONF_CHECK_NOT_NULL(conf->spk_slot = (SLOT_TYPE*)
+                        pj_pool_calloc(pool, max_speakers, sizeof(SLOT_TYPE)),
+                        return PJ_ENOMEM);
+    CONF_CHECK_NOT_NULL(conf->spk_sel_level = (pj_uint32_t*)
+                        pj_pool_calloc(pool, max_speakers, sizeof(pj_uint32_t)),
+                        return PJ_ENOMEM);
+    CONF_CHECK_NOT_NULL(conf->spk_frame = (pj_int16_t**)
+                        pj_pool_calloc(pool, max_speakers, sizeof(pj_int16_t*)),
+                        return PJ_ENOMEM);
+    CONF_CHECK_NOT_NULL(conf->spk_bus = (pj_int32_t*)
+                        pj_pool_calloc(pool, conf->samples_per_frame,
+                                       sizeof(pj_int32_t)),
+                        return PJ_ENOMEM);
+    CONF_CHECK_NOT_NULL(conf->spk_level = (pj_uint32_t*)
+                        pj_pool_calloc(pool, max_ports, sizeof(pj_uint32_t)),
+                        return PJ_ENOMEM);
+    CONF_CHECK_NOT_NULL(conf->spk_cand = (pj_uint32_t*)
+                        pj_pool_calloc(pool, max_ports, sizeof(pj_uint32_t)),
+                        return PJ_ENOMEM);
+    CONF_CHECK_NOT_NULL(conf->spk_mask = (pj_uint32_t*)
+                        pj_pool_calloc(pool, max_ports, sizeof(pj_uint32_t)),
+                        return PJ_ENOMEM);
+    CONF_CHECK_NOT_NULL(conf->spk_adj_mask = (pj_uint32_t*)
+                        pj_pool_calloc(pool, max_ports, sizeof(pj_uint32_t)),
+                        return PJ_ENOMEM);
+    CONF_CHECK_NOT_NULL(conf->spk_adj = (unsigned*)
+                        pj_pool_calloc(pool, max_ports * max_speakers,
+                                       sizeof(unsigned)),
+                        return PJ_ENOMEM);
+
+    return PJ_SUCCESS;
+}
+
+/*
+ * Allocate the fan-out grouping state.
+ */
+static pj_status_t create_fanout(pj_pool_t *pool, pjmedia_conf *conf)
+{
+    unsigned max_ports = conf->max_ports;
+    unsigned tab_size = 2;
+
+    /* Keep the hash table at most half full */
+    while (tab_size < max_ports * 2)
+        tab_size <<= 1;
+
+    CONF_CHECK_NOT_NULL(conf->fanout_hash = (pj_uint64_t*)
+                        pj_pool_calloc(pool, max_ports, sizeof(pj_uint64_t)),
+                        return PJ_ENOMEM);
+    CONF_CHECK_NOT_NULL(conf->fanout_mark = (unsigned*)
+                        pj_pool_calloc(pool, max_ports, sizeof(unsigned)),
+                        return PJ_ENOMEM);
+    CONF_CHECK_NOT_NULL(conf->fanout_tab = (SLOT_TYPE*)
+                        pj_pool_calloc(pool, tab_size, sizeof(SLOT_TYPE)),
+                        return PJ_ENOMEM);
+
+    conf->fanout_tab_mask = tab_size - 1;
+    conf->fanout_dirty = PJ_TRUE;
+
+    return PJ_SUCCESS;
+}
+
 PJ_DEF(pj_status_t) pjmedia_conf_create2(pj_pool_t *pool_, 
                                          pjmedia_conf_param *param, 
                                          pjmedia_conf **p_conf)
@@ -1024,6 +1149,8 @@ PJ_DEF(pj_status_t) pjmedia_conf_create2(pj_pool_t *pool_,
     PJ_ASSERT_RETURN(param->samples_per_frame > 0, PJ_EINVAL);
     /* Can only accept 16bits per sample, for now.. */
     PJ_ASSERT_RETURN(param->bits_per_sample == 16, PJ_EINVAL);
+    /* The speakers of a frame are tracked in 32bit masks */
+    PJ_ASSERT_RETURN(param->max_speakers <= 32, PJ_EINVAL);
 
 #if defined(CONF_DEBUG_EX) || defined(CONF_DEBUG)
     pj_log_set_level(5);
@@ -1054,6 +1181,18 @@ PJ_DEF(pj_status_t) pjmedia_conf_create2(pj_pool_t *pool_,
     conf->threads = param->worker_threads + 1;
     conf->is_parallel = (param->worker_threads>0);
 
+    if (param->max_speakers) {
+        status = create_speakers(pool, conf, param->max_speakers);
+        if (status != PJ_SUCCESS)
+            goto on_return;
+    }
+
+    if (conf->options & PJMEDIA_CONF_FANOUT) {
+        status = create_fanout(pool, conf);
+        if (status != PJ_SUCCESS)
+            goto on_return;
+    }
+
     /* loading and storing a properly aligned pointer should be atomic 
      * at the processor level and not require mutex protection 
      */
@@ -1728,6 +1867,8 @@ PJ_DEF(pj_status_t) pjmedia_conf_configure_port( pjmedia_conf *conf,
     if (rx != PJMEDIA_PORT_NO_CHANGE)
         conf_port->rx_setting = rx;
 
+    conf->fanout_dirty = PJ_TRUE;
+
     pj_mutex_unlock(conf->mutex);
 
     return PJ_SUCCESS;
@@ -2384,6 +2525,11 @@ static pj_status_t op_remove_port(pjmedia_conf *conf,
     }
 
     pj_assert( !is_port_connected( conf_port ) );
+
+    /* Don't let the next port in this slot inherit the speaker level */
+    if (conf->spk_level)
+        conf->spk_level[port] = 0;
+
     /* Remove the port. */
     //pj_mutex_lock(conf->mutex);
     conf->ports[port] = NULL;
@@ -2459,13 +2605,8 @@ static void destroy_conf_port( struct conf_port *conf_port )
         }
     }
 
-    if (conf_port->tx_lock != NULL)
-        pj_lock_destroy(conf_port->tx_lock);
-
-    if (conf_port->free_node_cache)
-        pj_atomic_slist_destroy(conf_port->free_node_cache);
     if (conf_port->buff_to_mix)
-        pj_atomic_slist_destroy(conf_port->buff_to_mix);
+        pj_ring_destroy(conf_port->buff_to_mix);
     if (conf_port->requests_to_mix)
         pj_atomic_destroy(conf_port->requests_to_mix);
 
@@ -2682,6 +2823,7 @@ PJ_DEF(pj_status_t) pjmedia_conf_adjust_tx_level( pjmedia_conf *conf,
 
     /* Set normalized adjustment level. */
     conf_port->tx_adj_level = adj_level + NORMAL_LEVEL;
+    conf->fanout_dirty = PJ_TRUE;
 
     /* Unlock mutex */
     pj_mutex_unlock(conf->mutex);
@@ -2733,6 +2875,7 @@ PJ_DEF(pj_status_t) pjmedia_conf_adjust_conn_level( pjmedia_conf *conf,
     } 
     /* Set normalized adjustment level. */
     src_port->listener_adj_level[i] = adj_level + NORMAL_LEVEL;
+    conf->fanout_dirty = PJ_TRUE;
 
     pj_mutex_unlock(conf->mutex);
     return PJ_SUCCESS;
@@ -2898,9 +3041,8 @@ static pj_status_t write_port(pjmedia_conf *conf, struct conf_port *cport,
                               pjmedia_frame_type *frm_type)
 {
     pj_int16_t *buf;
-    pj_int32_t *mix_buf;
     unsigned samples_per_frame;
-    unsigned j, ts;
+    unsigned ts;
     pj_status_t status;
     pj_int32_t adj_level;
     pj_int32_t tx_level;
@@ -2996,56 +3138,16 @@ static pj_status_t write_port(pjmedia_conf *conf, struct conf_port *cport,
     adj_level = cport->tx_adj_level * cport->mix_adj;
     adj_level >>= 7;
 
-    tx_level = 0;
-    
-    /* Loops that support the MSVS Auto-Vectorizer feature must at least 
-     * not use global variables (create local copies of such variables) and 
-     * as a general rule not contains control flow-for example, "if" or "?:".
-     * All math functions support the Auto-Vectorizer feature.
-     * 
-     * You can specify the /Qvec-report (Auto-Vectorizer Reporting Level) 
-     * command-line option to report either successfully vectorized loops 
-     * only-/Qvec-report:1-or both successfully and unsuccessfully vectorized 
-     * loops-/Qvec-report:2).
-     * 
-     * See more: https://learn.microsoft.com/en-us/cpp/parallel/auto-parallelization-and-auto-vectorization?view=msvc-170&redirectedfrom=MSDN
-     * 
-     * Here we create local copies to automatically vectorize the main loops.
-     */
-
     buf = (pj_int16_t*) cport->mix_buf;
-    mix_buf = cport->mix_buf;
     samples_per_frame = conf->samples_per_frame;
 
-    if (adj_level != NORMAL_LEVEL) {
-        //loop vectorized
-        for (j=0; j<samples_per_frame; ++j) {
-            pj_int32_t itemp = mix_buf[j];
-
-            /* Adjust the level */
-            /*itemp = itemp * adj_level / NORMAL_LEVEL;*/
-            itemp = (itemp * adj_level) >> 7;
-
-            /* Clip the signal if it's too loud */
-            if (itemp > MAX_LEVEL) itemp = MAX_LEVEL;
-            else if (itemp < MIN_LEVEL) itemp = MIN_LEVEL;
-
-            /* Put back in the buffer. */
-            buf[j] = (pj_int16_t) itemp;
-
-            //auto-vectorizing compatible:
-            tx_level += abs(buf[j]);
-            //prevent auto-vectorizing:
-            //tx_level += (buf[j]>=0? buf[j] : -buf[j]);
-        }
-    } else {
-        //loop vectorized
-        for (j=0; j<samples_per_frame; ++j) {
-            buf[j] = (pj_int16_t) mix_buf[j];
-            tx_level += abs(buf[j]);
-            //tx_level += (buf[j]>=0? buf[j] : -buf[j]);
-        }
-    }
+    /* Adjust the level, clip the signal if it's too loud, and put it back
+     * in the buffer as 16bit samples. The mixing kernels use SIMD
+     * instructions when the CPU has them (see PJMEDIA_MIX_USE_SIMD), which
+     * is where the SIMD_ALIGNMENT of the buffers pays off.
+     */
+    tx_level = pjmedia_mix_clamp(buf, cport->mix_buf, samples_per_frame,
+                                 adj_level);
 
     tx_level /= samples_per_frame;
 
@@ -3176,6 +3278,245 @@ static inline pj_int16_t *get_read_buffer(struct conf_port *conf_port, pjmedia_f
         return (pj_int16_t *)frame->buf;  // sequential conference bridge
 }
 
+/*
+ * Hash of a connection, the hash of a listener is the sum of the hashes of
+ * its connections so it doesn't depend on the order of the connections.
+ */
+static pj_uint64_t fanout_hash_conn(SLOT_TYPE src_slot, unsigned adj_level)
+{
+    pj_uint64_t x = ((pj_uint64_t)src_slot << 32) | adj_level;
+
+    x += PJ_UINT64(0x9E3779B97F4A7C15);
+    x = (x ^ (x >> 30)) * PJ_UINT64(0xBF58476D1CE4E5B9);
+    x = (x ^ (x >> 27)) * PJ_UINT64(0x94D049BB133111EB);
+    return x ^ (x >> 31);
+}
+
+/*
+ * Check whether the port can be put in a fan-out group. The members are
+ * sent the frame of the leader as is, so the port must not need any
+ * conversion. Port zero is never grouped since its signal is returned to
+ * the sound device.
+ */
+static pj_bool_t fanout_eligible(pjmedia_conf *conf, SLOT_TYPE slot,
+                                 const struct conf_port *cport)
+{
+    return slot != 0 && !cport->is_new &&
+           cport->tx_setting == PJMEDIA_PORT_ENABLE &&
+           cport->transmitter_cnt != 0 &&
+           cport->port != NULL && cport->port->put_frame != NULL &&
+           cport->delay_buf == NULL &&
+           cport->sampling_rate == conf->sampling_rate &&
+           cport->samples_per_frame == conf->samples_per_frame &&
+           cport->channel_count == conf->channel_count;
+}
+
+/*
+ * Group the listeners that receive the same mix, i.e. that have the same
+ * transmitters with the same connection levels, and the same TX level.
+ * This runs in the clock thread while the worker threads are idle.
+ */
+static void update_fanout(pjmedia_conf *conf)
+{
+    SLOT_TYPE i;
+    unsigned j, ngroup = 0, nmember = 0;
+
+    conf->fanout_dirty = PJ_FALSE;
+
+    for (i = 0; i < conf->max_ports; ++i) {
+        struct conf_port *cport = conf->ports[i];
+
+        if (!cport)
+            continue;
+        cport->fanout_leader = INVALID_SLOT;
+        cport->fanout_next = INVALID_SLOT;
+        conf->fanout_hash[i] = 0;
+    }
+
+    for (i = 0; i < conf->max_ports; ++i) {
+        struct conf_port *src = conf->ports[i];
+
+        if (!src)
+            continue;
+        for (j = 0; j < src->listener_cnt; ++j) {
+            conf->fanout_hash[src->listener_slots[j]] +=
+                fanout_hash_conn(i, src->listener_adj_level[j]);
+        }
+    }
+
+    /* Find the leader with the same hash, or make the port a leader */
+    pj_memset(conf->fanout_tab, 0xFF,
+              (conf->fanout_tab_mask + 1) * sizeof(SLOT_TYPE));
+
+    for (i = 0; i < conf->max_ports; ++i) {
+        struct conf_port *cport = conf->ports[i];
+        unsigned h;
+
+        if (!cport || !fanout_eligible(conf, i, cport))
+            continue;
+
+        h = (unsigned)conf->fanout_hash[i] & conf->fanout_tab_mask;
+        for (;;) {
+            SLOT_TYPE leader_slot = conf->fanout_tab[h];
+            struct conf_port *leader;
+
+            if (leader_slot == INVALID_SLOT) {
+                conf->fanout_tab[h] = i;
+                break;
+            }
+
+            leader = conf->ports[leader_slot];
+            if (conf->fanout_hash[leader_slot] == conf->fanout_hash[i] &&
+                leader->transmitter_cnt == cport->transmitter_cnt &&
+                leader->tx_adj_level == cport->tx_adj_level)
+            {
+                cport->fanout_leader = leader_slot;
+                break;
+            }
+
+            h = (h + 1) & conf->fanout_tab_mask;
+        }
+    }
+
+    /* Don't trust the hash alone: every transmitter of a member must also
+     * transmit to the leader with the same level. Since both have the same
+     * number of transmitters, they then have the same connections.
+     */
+    for (i = 0; i < conf->max_ports; ++i) {
+        struct conf_port *src = conf->ports[i];
+
+        if (!src || src->listener_cnt == 0)
+            continue;
+
+        for (j = 0; j < src->listener_cnt; ++j) {
+            conf->fanout_mark[src->listener_slots[j]] =
+                src->listener_adj_level[j] + 1;
+        }
+
+        for (j = 0; j < src->listener_cnt; ++j) {
+            struct conf_port *listener = conf->ports[src->listener_slots[j]];
+
+            if (listener->fanout_leader != INVALID_SLOT &&
+                conf->fanout_mark[listener->fanout_leader] !=
+                    src->listener_adj_level[j] + 1)
+            {
+                listener->fanout_leader = INVALID_SLOT;
+            }
+        }
+
+        for (j = 0; j < src->listener_cnt; ++j)
+            conf->fanout_mark[src->listener_slots[j]] = 0;
+    }
+
+    /* Link the members to their leader */
+    for (i = 0; i < conf->max_ports; ++i) {
+        struct conf_port *cport = conf->ports[i];
+        struct conf_port *leader;
+
+        if (!cport || cport->fanout_leader == INVALID_SLOT)
+            continue;
+
+        leader = conf->ports[cport->fanout_leader];
+        if (leader->fanout_next == INVALID_SLOT)
+            ++ngroup;
+        cport->fanout_next = leader->fanout_next;
+        leader->fanout_next = i;
+        ++nmember;
+    }
+
+    PJ_LOG(5,(THIS_FILE, "Fan-out: %d ports share the mix of %d ports",
+              nmember, ngroup));
+}
+
+/*
+ * Get the stream of a stream port, if it is one.
+ */
+static pjmedia_stream *fanout_get_stream(const struct conf_port *cport)
+{
+    if (cport->port->info.signature != PJMEDIA_SIG_PORT_STREAM)
+        return NULL;
+    return (pjmedia_stream*)cport->port->port_data.pdata;
+}
+
+/* Number of different encodings tracked per group */
+#define FANOUT_MAX_ENC      8
+
+/*
+ * Send the frame just written to the group leader to the group members.
+ * Streams reuse the payload of the first stream in the group that encoded
+ * the frame the same way. This is called by the thread that wrote the
+ * leader.
+ */
+static void write_fanout(pjmedia_conf *conf, struct conf_port *leader,
+                         const pj_timestamp *timestamp,
+                         pjmedia_frame_type frm_type)
+{
+    pjmedia_stream *enc_strm[FANOUT_MAX_ENC];
+    unsigned enc_cnt = 0;
+    SLOT_TYPE slot;
+
+    if (frm_type == PJMEDIA_FRAME_TYPE_AUDIO) {
+        enc_strm[0] = fanout_get_stream(leader);
+        if (enc_strm[0])
+            enc_cnt = 1;
+    }
+
+    slot = leader->fanout_next;
+    while (slot != INVALID_SLOT) {
+        struct conf_port *member = conf->ports[slot];
+        pjmedia_stream *strm, *enc_src = NULL;
+        pjmedia_frame frame;
+        unsigned k;
+
+        slot = member->fanout_next;
+
+        /* The setting may have changed since the groups were built, such
+         * port doesn't need the mixed signal.
+         */
+        if (member->tx_setting != PJMEDIA_PORT_ENABLE) {
+            pjmedia_frame_type type;
+
+            write_port(conf, member, timestamp, &type);
+            continue;
+        }
+
+        pj_bzero(&frame, sizeof(frame));
+        frame.timestamp = *timestamp;
+
+        /* The leader has nothing to transmit, send heart-beat */
+        if (frm_type != PJMEDIA_FRAME_TYPE_AUDIO) {
+            member->tx_level = 0;
+            frame.type = PJMEDIA_FRAME_TYPE_NONE;
+            pjmedia_port_put_frame(member->port, &frame);
+            continue;
+        }
+
+        member->tx_heart_beat = 0;
+        member->tx_level = leader->tx_level;
+
+        frame.type = PJMEDIA_FRAME_TYPE_AUDIO;
+        frame.buf = leader->mix_buf;
+        frame.size = conf->samples_per_frame * BYTES_PER_SAMPLE;
+
+        strm = fanout_get_stream(member);
+        if (!strm) {
+            pjmedia_port_put_frame(member->port, &frame);
+            continue;
+        }
+
+        for (k = 0; k < enc_cnt; ++k) {
+            if (pjmedia_stream_is_enc_compatible(enc_strm[k], strm)) {
+                enc_src = enc_strm[k];
+                break;
+            }
+        }
+        if (!enc_src && enc_cnt < FANOUT_MAX_ENC)
+            enc_strm[enc_cnt++] = strm;
+
+        pjmedia_stream_put_frame_from(strm, &frame, enc_src);
+    }
+}
+
 /*
  * Player callback.
  */
@@ -3274,6 +3615,10 @@ static pj_status_t get_frame(pjmedia_port *this_port,
         pj_log_pop_indent();
     }
 
+    /* Rebuild the fan-out groups after the connections have changed */
+    if (conf->fanout_tab && conf->fanout_dirty)
+        update_fanout(conf);
+
 #ifdef REC_FILE
     if (fhnd_rec == NULL)
         fhnd_rec = fopen(REC_FILE, "wb");
@@ -3393,17 +3738,18 @@ static void perform_get_frame(pjmedia_conf *conf)
     pj_status_t status;
     pj_atomic_value_t i;
     pjmedia_frame *frame = conf->frame;
+    pj_int32_t rc = PJ_TRUE;
 
     while ((i = pj_atomic_dec_and_get(conf->active_ports_idx)) >= 0) {
         pj_int16_t *p_in;
-        unsigned j, samples_per_frame = conf->samples_per_frame;
+        unsigned samples_per_frame = conf->samples_per_frame;
         pj_int32_t cj, listener_cnt;
         pj_int32_t level = 0;
         SLOT_TYPE port_idx = conf->active_ports[i];
         pj_assert(port_idx < conf->max_ports);
         struct conf_port *conf_port = conf->ports[port_idx];
         PJ_ASSERT_ON_FAIL(conf_port, continue);
-        unsigned rx_adj_level = conf_port->rx_adj_level; //for auto-vectorizer
+        unsigned rx_adj_level = conf_port->rx_adj_level;
 
         /* Skip if we're not allowed to receive from this port. */
         if (conf_port->rx_setting == PJMEDIA_PORT_DISABLE) {
@@ -3509,46 +3855,39 @@ static void perform_get_frame(pjmedia_conf *conf)
          * and calculate the average level at the same time.
          */
         if (rx_adj_level != NORMAL_LEVEL) {
-            //loop vectorized
-            for (j=0; j<samples_per_frame; ++j) {
-                /* For the level adjustment, we need to store the sample to
-                 * a temporary 32bit integer value to avoid overflowing the
-                 * 16bit sample storage.
-                 */
-                pj_int32_t itemp;
-
-                itemp = p_in[j];
-                /*itemp = itemp * adj / NORMAL_LEVEL;*/
-                /* bad code (signed/unsigned badness):
-                 *  itemp = (itemp * conf_port->rx_adj_level) >> 7;
-                 */
-                itemp *= rx_adj_level;
-                itemp >>= 7;
-
-                /* Clip the signal if it's too loud */
-                if (itemp > MAX_LEVEL) itemp = MAX_LEVEL;
-                else if (itemp < MIN_LEVEL) itemp = MIN_LEVEL;
-
-                p_in[j] = (pj_int16_t) itemp;
-                level += abs(p_in[j]);
-                //level += (p_in[j]>=0 ? p_in[j] : -p_in[j]);
-            }
+            level = pjmedia_mix_adjust(p_in, p_in, samples_per_frame,
+                                       rx_adj_level);
         } else {
-            //loop vectorized
-            for (j=0; j<samples_per_frame; ++j) {
-                level += abs(p_in[j]);
-                //level += (p_in[j]>=0 ? p_in[j] : -p_in[j]);
-            }
+            level = pjmedia_mix_level(p_in, samples_per_frame);
         }
 
         level /= samples_per_frame;
 
+        /* In active speaker mode just record the level, the speakers are
+         * selected and mixed once all ports have been read. The level
+         * rises immediately but falls slowly, so a speaker stays selected
+         * during short pauses.
+         */
+        if (conf->max_speakers) {
+            pj_uint32_t smoothed = conf->spk_level[port_idx];
+
+            if ((pj_uint32_t)level < smoothed)
+                smoothed = (smoothed * 7 + level) >> 3;
+            else
+                smoothed = level;
+            conf->spk_level[port_idx] = smoothed;
+            conf->spk_cand[port_idx] = smoothed;
+        }
+
         /* Convert level to 8bit complement ulaw */
         level = pjmedia_linear2ulaw(level) ^ 0xff;
 
         /* Put this level to port's last RX level. */
         conf_port->rx_level = level;
 
+        if (conf->max_speakers)
+            continue;
+
         // Ticket #671: Skipping very low audio signal may cause noise 
         // to be generated in the remote end by some hardphones.
         /* Skip processing frame if level is zero */
@@ -3558,11 +3897,17 @@ static void perform_get_frame(pjmedia_conf *conf)
         /* Add the signal to all listeners. */
         for (cj = 0, listener_cnt = conf_port->listener_cnt; cj < listener_cnt; ++cj) {
             struct conf_port *listener;
-            rx_buffer_slist_node *mix_node;
+            rx_buffer_entry mix_entry;
             SLOT_TYPE listener_slot = conf_port->listener_slots[cj];
 
             listener = conf->ports[listener_slot];
 
+            /* Skip if this listener gets the signal of its fan-out group
+             * leader.
+             */
+            if (listener->fanout_leader != INVALID_SLOT)
+                continue;
+
             /* Skip if this listener doesn't want to receive audio */
             if (listener->tx_setting != PJMEDIA_PORT_ENABLE) {
                 TRACE_EX((THIS_FILE, "%s: listener (%.*s, %d, transmitter_cnt=%d) doesn't want to receive audio from the port (%.*s, %u, listener_cnt=%u)",
@@ -3577,24 +3922,11 @@ static void perform_get_frame(pjmedia_conf *conf)
                 continue;
             }
 
-            mix_node = pj_atomic_slist_pop(listener->free_node_cache);
-            pj_assert(mix_node || listener->transmitter_cnt > 1 && conf->is_parallel);
-            pj_assert(conf->is_parallel == (listener->tx_lock != NULL));
-            if (mix_node == NULL && listener->tx_lock) {
-                pj_lock_acquire(listener->tx_lock);
-                /* tx_lock protects listener->pool.
-                 * The only operation that requires lock protection.
-                 */
-                mix_node = pj_atomic_slist_calloc(listener->pool, 1, sizeof(rx_buffer_slist_node));
-                pj_lock_release(listener->tx_lock);
-            }
-
-            PJ_ASSERT_ON_FAIL(mix_node, continue);
-
-            mix_node->rx_frame_buf = p_in;
-            mix_node->rx_port = conf_port;
-            mix_node->listener_adj_level = conf_port->listener_adj_level[cj];
-            pj_atomic_slist_push(listener->buff_to_mix, mix_node);
+            mix_entry.rx_frame_buf = p_in;
+            mix_entry.rx_port = conf_port;
+            mix_entry.listener_adj_level = conf_port->listener_adj_level[cj];
+            status = pj_ring_push(listener->buff_to_mix, &mix_entry);
+            PJ_ASSERT_ON_FAIL(status == PJ_SUCCESS, continue);
 
             if (pj_atomic_inc_and_get(listener->requests_to_mix) == 1) {
                 /* the first mixer appeared here - mix all for this listener! 
@@ -3603,22 +3935,14 @@ static void perform_get_frame(pjmedia_conf *conf)
                  * into this listener's buff_to_mix.
                  */
                 do {
-                    while ((mix_node = pj_atomic_slist_pop(listener->buff_to_mix)) != NULL) {
-
-                        unsigned listener_adj_level = mix_node->listener_adj_level;
-                        struct conf_port *rx_port = mix_node->rx_port;
-                        pj_int16_t *rx_buf = mix_node->rx_frame_buf;
-
-                        /* return node into free_node_cache ASAP, 
-                         * other threads may reuse it now 
-                         */
-                        pj_atomic_slist_push(listener->free_node_cache, mix_node);
+                    while (pj_ring_pop(listener->buff_to_mix, &mix_entry) == PJ_SUCCESS) {
 
                         /* only one thread at time call mix_and_transmit() for the
                          * same listener, no addition lock protection required here */
                         mix_and_transmit(conf,
-                                         listener, listener_slot, listener_adj_level,
-                                         rx_port, rx_buf, 
+                                         listener, listener_slot,
+                                         mix_entry.listener_adj_level,
+                                         mix_entry.rx_port, mix_entry.rx_frame_buf,
                                          &frame->timestamp);
                     }
                 } while (pj_atomic_dec_and_get(listener->requests_to_mix));
@@ -3629,7 +3953,6 @@ static void perform_get_frame(pjmedia_conf *conf)
     } /* loop of all conf ports */
 
     if (conf->is_parallel) {
-        pj_int32_t rc;
         TRACE_EX((THIS_FILE, "%s: timestamp=%llu, ARRIVE AT BARRIER",
                   pj_thread_get_name(pj_thread_this()),
                   frame->timestamp.u64));
@@ -3644,7 +3967,19 @@ static void perform_get_frame(pjmedia_conf *conf)
                   pj_thread_get_name(pj_thread_this()),
                   frame->timestamp.u64,
                   rc));
-        PJ_UNUSED_ARG(rc);
+    }
+
+    /* Active speaker mode: one thread selects the speakers and mixes them
+     * into the bus, the listeners are then derived from it in parallel.
+     */
+    if (conf->max_speakers) {
+        if (rc == PJ_TRUE)
+            speaker_select(conf);
+
+        if (conf->is_parallel) {
+            rc = pj_barrier_wait(conf->barrier, PJ_BARRIER_FLAGS_NO_DELETE);
+            pj_assert(rc == PJ_TRUE || rc == PJ_FALSE);
+        }
     }
 
     /* Step 3
@@ -3655,7 +3990,20 @@ static void perform_get_frame(pjmedia_conf *conf)
         SLOT_TYPE port_idx = conf->active_listener[i];
         struct conf_port *listener = conf->ports[port_idx];
         pjmedia_frame_type frame_type;
+
+        /* Fan-out group members are written along with their leader */
+        if (listener->fanout_leader != INVALID_SLOT)
+            continue;
+
+        if (conf->max_speakers && conf->spk_mask[port_idx]) {
+            speaker_mix_listener(conf, listener, port_idx,
+                                 &frame->timestamp);
+        }
+
         status = write_port(conf, listener, &frame->timestamp, &frame_type);
+
+        if (listener->fanout_next != INVALID_SLOT)
+            write_fanout(conf, listener, &frame->timestamp, frame_type);
 #if 0
         if (status != PJ_SUCCESS) {
             /* bennylp: why do we need this????
@@ -3685,6 +4033,182 @@ static void perform_get_frame(pjmedia_conf *conf)
     }
 }
 
+/*
+ * Count the bits that are set.
+ */
+static unsigned bit_count(pj_uint32_t v)
+{
+    unsigned cnt;
+
+    for (cnt = 0; v; ++cnt)
+        v &= v - 1;
+    return cnt;
+}
+
+/*
+ * Select the loudest ports of the current frame, mix them into the bus,
+ * and find out which speakers each listener hears. Called by one thread
+ * only, after all ports have been read.
+ */
+static void speaker_select(pjmedia_conf *conf)
+{
+    unsigned samples_per_frame = conf->samples_per_frame;
+    pj_uint32_t idx;
+    unsigned k, j;
+
+    conf->spk_cnt = 0;
+
+    for (idx = 0; idx < conf->upper_bound; ++idx) {
+        SLOT_TYPE slot = conf->active_ports[idx];
+        pj_uint32_t level = conf->spk_cand[slot];
+        unsigned min_k;
+
+        conf->spk_cand[slot] = 0;
+        if (level < PJMEDIA_CONF_SPEAKER_THRESHOLD || level == 0)
+            continue;
+
+        if (conf->spk_cnt < conf->max_speakers) {
+            k = conf->spk_cnt++;
+        } else {
+            /* Replace the quietest speaker if this one is louder */
+            for (min_k = 0, k = 1; k < conf->spk_cnt; ++k) {
+                if (conf->spk_sel_level[k] < conf->spk_sel_level[min_k])
+                    min_k = k;
+            }
+            if (level <= conf->spk_sel_level[min_k])
+                continue;
+            k = min_k;
+        }
+
+        conf->spk_slot[k] = slot;
+        conf->spk_sel_level[k] = level;
+        conf->spk_frame[k] = conf->ports[slot]->rx_frame_buf;
+    }
+
+    /* A single 16bit frame can not overflow, so the min/max stay zero
+     * unless there are more speakers.
+     */
+    conf->spk_bus_min = conf->spk_bus_max = 0;
+    if (conf->spk_cnt == 0)
+        return;
+
+    pjmedia_mix_copy(conf->spk_bus, conf->spk_frame[0], samples_per_frame);
+    for (k = 1; k < conf->spk_cnt; ++k) {
+        pjmedia_mix_add(conf->spk_bus, conf->spk_frame[k], samples_per_frame,
+                        &conf->spk_bus_min, &conf->spk_bus_max);
+    }
+
+    for (k = 0; k < conf->spk_cnt; ++k) {
+        struct conf_port *speaker = conf->ports[conf->spk_slot[k]];
+
+        for (j = 0; j < speaker->listener_cnt; ++j) {
+            SLOT_TYPE listener_slot = speaker->listener_slots[j];
+            struct conf_port *listener = conf->ports[listener_slot];
+
+            /* Skip if this listener doesn't want to receive audio, or
+             * if it gets the signal of its fan-out group leader.
+             */
+            if (listener->tx_setting != PJMEDIA_PORT_ENABLE ||
+                listener->fanout_leader != INVALID_SLOT)
+            {
+                continue;
+            }
+
+            conf->spk_mask[listener_slot] |= (1U << k);
+            if (speaker->listener_adj_level[j] != NORMAL_LEVEL) {
+                conf->spk_adj_mask[listener_slot] |= (1U << k);
+                conf->spk_adj[listener_slot * conf->max_speakers + k] =
+                    speaker->listener_adj_level[j];
+            }
+        }
+    }
+}
+
+/*
+ * Build the mixed signal of a listener from the speakers it hears.
+ * Only called for listeners that hear at least one speaker.
+ */
+static void speaker_mix_listener(pjmedia_conf *conf,
+                                 struct conf_port *listener,
+                                 SLOT_TYPE listener_slot,
+                                 const pj_timestamp *timestamp)
+{
+    unsigned samples_per_frame = conf->samples_per_frame;
+    pj_uint32_t mask = conf->spk_mask[listener_slot];
+    pj_uint32_t adj_mask = conf->spk_adj_mask[listener_slot];
+    pj_int32_t *mix_buf = listener->mix_buf;
+    pj_uint32_t missing;
+    pj_int32_t mix_buf_min = 0;
+    pj_int32_t mix_buf_max = 0;
+    unsigned k;
+
+    pj_assert(mask != 0);
+
+    conf->spk_mask[listener_slot] = 0;
+    conf->spk_adj_mask[listener_slot] = 0;
+
+    missing = (conf->spk_cnt == 32 ? 0xFFFFFFFF : (1U << conf->spk_cnt) - 1);
+    missing &= ~mask;
+
+    if (adj_mask == 0 && bit_count(missing) < bit_count(mask)) {
+        /* Take the bus and remove the speakers the listener doesn't
+         * hear, typically the listener itself.
+         */
+        pj_memcpy(mix_buf, conf->spk_bus,
+                  samples_per_frame * sizeof(mix_buf[0]));
+        mix_buf_min = conf->spk_bus_min;
+        mix_buf_max = conf->spk_bus_max;
+
+        for (k = 0; missing; ++k, missing >>= 1) {
+            if (missing & 1) {
+                pjmedia_mix_sub(mix_buf, conf->spk_frame[k],
+                                samples_per_frame,
+                                &mix_buf_min, &mix_buf_max);
+            }
+        }
+    } else {
+        /* Connection level adjustment, or only few speakers heard:
+         * mix them directly.
+         */
+        pj_bool_t first = PJ_TRUE;
+
+        for (k = 0; k < conf->spk_cnt; ++k) {
+            const pj_int16_t *p_in = conf->spk_frame[k];
+
+            if ((mask & (1U << k)) == 0)
+                continue;
+
+            if (adj_mask & (1U << k)) {
+                pjmedia_mix_adjust(listener->adj_level_buf, p_in,
+                        samples_per_frame,
+                        conf->spk_adj[listener_slot * conf->max_speakers + k]);
+                p_in = listener->adj_level_buf;
+            }
+
+            if (first) {
+                pjmedia_mix_copy(mix_buf, p_in, samples_per_frame);
+                first = PJ_FALSE;
+            } else {
+                pjmedia_mix_add(mix_buf, p_in, samples_per_frame,
+                                &mix_buf_min, &mix_buf_max);
+            }
+        }
+    }
+
+    /* There is data to transmit in mix_buf */
+    listener->last_timestamp = *timestamp;
+    listener->mix_adj = NORMAL_LEVEL;
+
+    /* Check if normalization adjustment needed. */
+    if (mix_buf_min < MIN_LEVEL || mix_buf_max > MAX_LEVEL) {
+        if (-mix_buf_min > mix_buf_max)
+            mix_buf_max = -mix_buf_min;
+
+        /* NORMAL_LEVEL * MAX_LEVEL / mix_buf_max; */
+        listener->mix_adj = (MAX_LEVEL<<7) / mix_buf_max;
+    }
+}
+
 static void mix_and_transmit(pjmedia_conf *conf, struct conf_port *listener, 
                              SLOT_TYPE listener_slot,
                              unsigned listener_adj_level, 
@@ -3696,35 +4220,15 @@ static void mix_and_transmit(pjmedia_conf *conf, struct conf_port *listener,
     PJ_UNUSED_ARG(listener_slot);
 
     pj_int16_t *p_in_conn_leveled;
-    unsigned k, samples_per_frame = conf->samples_per_frame;
+    unsigned samples_per_frame = conf->samples_per_frame;
     pj_int32_t *mix_buf = listener->mix_buf;
 
     /* apply connection level, if not normal */
     if (listener_adj_level != NORMAL_LEVEL) {
         /* take the leveled frame */
         p_in_conn_leveled = listener->adj_level_buf;
-        //loop vectorized
-        for (k = 0; k < samples_per_frame; ++k) {
-            /* For the level adjustment, we need to store the sample to
-             * a temporary 32bit integer value to avoid overflowing the
-             * 16bit sample storage.
-             */
-            pj_int32_t itemp;
-
-            itemp = p_in[k];
-            /*itemp = itemp * adj / NORMAL_LEVEL;*/
-            /* bad code (signed/unsigned badness):
-             *  itemp = (itemp * conf_port->listsener_adj_level) >> 7;
-             */
-            itemp *= listener_adj_level;
-            itemp >>= 7;
-
-            /* Clip the signal if it's too loud */
-            if (itemp > MAX_LEVEL) itemp = MAX_LEVEL;
-            else if (itemp < MIN_LEVEL) itemp = MIN_LEVEL;
-
-            p_in_conn_leveled[k] = (pj_int16_t)itemp;
-        }
+        pjmedia_mix_adjust(p_in_conn_leveled, p_in, samples_per_frame,
+                           listener_adj_level);
 
     } else {
         /* take the frame as-is */
@@ -3741,14 +4245,8 @@ static void mix_and_transmit(pjmedia_conf *conf, struct conf_port *listener,
 
         if (listener->last_timestamp.u64 == timestamp->u64) {
             /* this frame is NOT from the first transmitter */
-            //loop vectorized
-            for (k = 0; k < samples_per_frame; ++k) {
-                mix_buf[k] += p_in_conn_leveled[k]; // not the first - sum
-                if (mix_buf[k] < mix_buf_min)
-                    mix_buf_min = mix_buf[k];
-                if (mix_buf[k] > mix_buf_max)
-                    mix_buf_max = mix_buf[k];
-            }
+            pjmedia_mix_add(mix_buf, p_in_conn_leveled, samples_per_frame,
+                            &mix_buf_min, &mix_buf_max);
             TRACE_EX((THIS_FILE, "%s: listener (%.*s, %d, transmitter_cnt=%d) get (sum) audio from the port (%.*s, %d, listener_cnt=%d)",
                 pj_thread_get_name(pj_thread_this()),
                 (int)listener->name.slen,
@@ -3766,15 +4264,11 @@ static void mix_and_transmit(pjmedia_conf *conf, struct conf_port *listener,
             listener->mix_adj = NORMAL_LEVEL;
 
 
-            /* We do not want to reset buffer, we just copy the first frame there. */
-            //loop vectorized
-            for (k = 0; k < samples_per_frame; ++k) {
-                mix_buf[k] = p_in_conn_leveled[k]; // the first - copy
-                if (mix_buf[k] < mix_buf_min)
-                    mix_buf_min = mix_buf[k];
-                if (mix_buf[k] > mix_buf_max)
-                    mix_buf_max = mix_buf[k];
-            }
+            /* We do not want to reset buffer, we just copy the first frame
+             * there. A single 16bit frame can not overflow, so the
+             * min/max stay zero.
+             */
+            pjmedia_mix_copy(mix_buf, p_in_conn_leveled, samples_per_frame);
             TRACE_EX((THIS_FILE, "%s: listener %p (%.*s, %d, transmitter_cnt=%d) get (copy) audio from the port %p (%.*s, %d, listener_cnt=%d)",
                 pj_thread_get_name(pj_thread_this()),
                 listener,
@@ -3814,10 +4308,7 @@ static void mix_and_transmit(pjmedia_conf *conf, struct conf_port *listener,
         /* Reset auto adjustment level for mixed signal. */
         listener->mix_adj = NORMAL_LEVEL;
 
-        //loop vectorized
-        for (k = 0; k < samples_per_frame; ++k) {
-            mix_buf[k] = p_in_conn_leveled[k];  // here copying 16 bit value to 32 bit dst
-        }
+        pjmedia_mix_copy(mix_buf, p_in_conn_leveled, samples_per_frame);
         TRACE_EX((THIS_FILE, "%s: listener %p (%.*s, %d, transmitter_cnt=%d)"
             " get audio from the (only) port %p (%.*s, %d, listener_cnt=%d) last_timestamp=%llu, timestamp=%llu",
             pj_thread_get_name(pj_thread_this()),
@@ -20,11 +20,13 @@
 #include <pjmedia/alaw_ulaw.h>
 #include <pjmedia/delaybuf.h>
 #include <pjmedia/errno.h>
+#include <pjmedia/mix.h>
 #include <pjmedia/port.h>
 #include <pjmedia/resample.h>
 #include <pjmedia/silencedet.h>
 #include <pjmedia/sound_port.h>
 #include <pjmedia/stereo.h>
+#include <pjmedia/stream.h>
 #include <pj/array.h>
 #include <pj/assert.h>
 #include <pj/log.h>
@@ -122,6 +124,14 @@ struct conf_port
                                              adjustment.                    */
     unsigned             transmitter_cnt;/**<Number of transmitters.        */
 
+    /* Fan-out group (PJMEDIA_CONF_FANOUT). The members of a group are sent
+     * the signal mixed for the group leader, which links them together
+     * with fanout_next.
+     */
+    SLOT_TYPE            fanout_leader; /**< Group leader, or INVALID_SLOT
+                                             if the port mixes its own.     */
+    SLOT_TYPE            fanout_next;   /**< Next member of the group.      */
+
     /* Shortcut for port info. */
     unsigned             clock_rate;    /**< Port's clock rate.             */
     unsigned             samples_per_frame; /**< Port's samples per frame.  */
@@ -255,6 +265,36 @@ struct pjmedia_conf
     op_entry             *op_queue;     /**< Queue of operations.           */
     op_entry             *op_queue_free;/**< Queue of free entries.         */
     pjmedia_conf_op_cb    cb;           /**< OP callback.                   */
+
+    /* Active speaker mixing (pjmedia_conf_param.max_speakers). Instead of
+     * mixing every transmitter into every listener, the loudest speakers
+     * of the frame are summed once into spk_bus, and each listener takes
+     * the bus minus the speakers it is not connected to. The per-listener
+     * arrays are indexed by slot, bit k of the masks refers to spk_slot[k].
+     */
+    unsigned              max_speakers; /**< Max speakers, 0 to mix all.    */
+    unsigned              spk_cnt;      /**< Speakers in current frame.     */
+    SLOT_TYPE            *spk_slot;     /**< Slots of the speakers.         */
+    pj_uint32_t          *spk_sel_level;/**< Levels of the speakers.        */
+    pj_int16_t          **spk_frame;    /**< Frames of the speakers.        */
+    pj_int32_t           *spk_bus;      /**< Sum of all speakers.           */
+    pj_int32_t            spk_bus_min;  /**< Minimum value of spk_bus.      */
+    pj_int32_t            spk_bus_max;  /**< Maximum value of spk_bus.      */
+    pj_uint32_t          *spk_level;    /**< Smoothed RX level, per slot.   */
+    pj_uint32_t          *spk_mask;     /**< Speakers heard, per listener.  */
+    pj_uint32_t          *spk_adj_mask; /**< Speakers heard with level
+                                             adjustment, per listener.      */
+    unsigned             *spk_adj;      /**< The adjustments, max_speakers
+                                             entries per listener.          */
+
+    /* Fan-out of identical mixes (PJMEDIA_CONF_FANOUT). The groups are
+     * rebuilt by the clock whenever the connections have changed.
+     */
+    pj_bool_t             fanout_dirty; /**< Groups need to be rebuilt.     */
+    pj_uint64_t          *fanout_hash;  /**< Connections hash, per slot.    */
+    unsigned             *fanout_mark;  /**< Scratch array, per slot.       */
+    SLOT_TYPE            *fanout_tab;   /**< Hash table of group leaders.   */
+    unsigned              fanout_tab_mask;/**< Hash table size minus one.   */
 };
 
 
@@ -360,6 +400,7 @@ static void handle_op_queue(pjmedia_conf *conf)
                 pj_assert(!"Invalid sync-op in conference");
                 break;
         }
+        conf->fanout_dirty = PJ_TRUE;
         if (conf->cb) {
             pjmedia_conf_op_info info = { 0 };
 
@@ -440,6 +481,10 @@ static pj_status_t create_conf_port( pj_pool_t *parent_pool,
     conf_port->tx_adj_level = NORMAL_LEVEL;
     conf_port->rx_adj_level = NORMAL_LEVEL;
 
+    /* Not in a fan-out group */
+    conf_port->fanout_leader = INVALID_SLOT;
+    conf_port->fanout_next = INVALID_SLOT;
+
     /* Create transmit flag array */
     conf_port->listener_slots = (SLOT_TYPE*) pj_pool_zalloc(pool, 
                                           conf->max_ports * sizeof(SLOT_TYPE));
@@ -734,21 +779,10 @@ static pj_status_t create_sound_port( pj_pool_t *pool,
     return PJ_SUCCESS;
 }
 
-PJ_DEF(pj_status_t) pjmedia_conf_create2(pj_pool_t *pool,
-                                         pjmedia_conf_param *param,
-                                         pjmedia_conf **p_conf)
-{
-    PJ_ASSERT_RETURN(param, PJ_EINVAL);
-    return pjmedia_conf_create(pool, 
-                               param->max_slots, param->sampling_rate, 
-                               param->channel_count, param->samples_per_frame, 
-                               param->bits_per_sample, param->options, p_conf);
-}
-
 /*
  * Create conference bridge.
  */
-PJ_DEF(pj_status_t) pjmedia_conf_create( pj_pool_t *pool_,
+PJ_DEF(pj_status_t) pjmedia_conf_create( pj_pool_t *pool,
                                          unsigned max_ports,
                                          unsigned clock_rate,
                                          unsigned channel_count,
@@ -756,15 +790,122 @@ PJ_DEF(pj_status_t) pjmedia_conf_create( pj_pool_t *pool_,
                                          unsigned bits_per_sample,
                                          unsigned options,
                                          pjmedia_conf **p_conf )
+{
+    pjmedia_conf_param param;
+
+    pjmedia_conf_param_default(&param);
+
+    param.max_slots = max_ports;
+    param.sampling_rate = clock_rate;
+    param.channel_count = channel_count;
+    param.samples_per_frame = samples_per_frame;
+    param.bits_per_sample = bits_per_sample;
+    param.options = options;
+
+    return pjmedia_conf_create2(pool, &param, p_conf);
+}
+
+/*
+ * Allocate the active speaker mixing state.
+ */
+static pj_status_t create_speakers(pj_pool_t *pool, pjmedia_conf *conf,
+                                   unsigned max_speakers)
+{
+    unsigned spf = conf->samples_per_frame;
+    unsigned k;
+
+    conf->max_speakers = max_speakers;
+
+    conf->spk_slot = (SLOT_TYPE*)
+                     pj_pool_calloc(pool, max_speakers, sizeof(SLOT_TYPE));
+    conf->spk_sel_level = (pj_uint32_t*)
+                     pj_pool_calloc(pool, max_speakers, sizeof(pj_uint32_t));
+    conf->spk_frame = (pj_int16_t**)
+                     pj_pool_calloc(pool, max_speakers, sizeof(pj_int16_t*));
+    conf->spk_bus = (pj_int32_t*)
+                     pj_pool_calloc(pool, spf, sizeof(pj_int32_t));
+    conf->spk_level = (pj_uint32_t*)
+                     pj_pool_calloc(pool, conf->max_ports, sizeof(pj_uint32_t));
+    conf->spk_mask = (pj_uint32_t*)
+                     pj_pool_calloc(pool, conf->max_ports, sizeof(pj_uint32_t));
+    conf->spk_adj_mask = (pj_uint32_t*)
+                     pj_pool_calloc(pool, conf->max_ports, sizeof(pj_uint32_t));
+    conf->spk_adj = (unsigned*)
+                     pj_pool_calloc(pool, conf->max_ports * max_speakers,
+                                    sizeof(unsigned));
+    if (!conf->spk_slot || !conf->spk_sel_level || !conf->spk_frame ||
+        !conf->spk_bus || !conf->spk_level || !conf->spk_mask ||
+        !conf->spk_adj_mask || !conf->spk_adj)
+    {
+        return PJ_ENOMEM;
+    }
+
+    /* The frames are read into the shared frame buffer of get_frame(),
+     * so the selected speakers need their own copy.
+     */
+    for (k = 0; k < max_speakers; ++k) {
+        conf->spk_frame[k] = (pj_int16_t*)
+                             pj_pool_calloc(pool, spf, sizeof(pj_int16_t));
+        if (!conf->spk_frame[k])
+            return PJ_ENOMEM;
+    }
+
+    return PJ_SUCCESS;
+}
+
+/*
+ * Allocate the fan-out grouping state.
+ */
+static pj_status_t create_fanout(pj_pool_t *pool, pjmedia_conf *conf)
+{
+    unsigned tab_size = 2;
+
+    /* Keep the hash table at most half full */
+    while (tab_size < conf->max_ports * 2)
+        tab_size <<= 1;
+
+    conf->fanout_hash = (pj_uint64_t*)
+                     pj_pool_calloc(pool, conf->max_ports, sizeof(pj_uint64_t));
+    conf->fanout_mark = (unsigned*)
+                     pj_pool_calloc(pool, conf->max_ports, sizeof(unsigned));
+    conf->fanout_tab = (SLOT_TYPE*)
+                     pj_pool_calloc(pool, tab_size, sizeof(SLOT_TYPE));
+    if (!conf->fanout_hash || !conf->fanout_mark || !conf->fanout_tab)
+        return PJ_ENOMEM;
+
+    conf->fanout_tab_mask = tab_size - 1;
+    conf->fanout_dirty = PJ_TRUE;
+
+    return PJ_SUCCESS;
+}
+
+/*
+ * Create conference bridge with the specified parameters.
+ */
+PJ_DEF(pj_status_t) pjmedia_conf_create2(pj_pool_t *pool_,
+                                         pjmedia_conf_param *param,
+                                         pjmedia_conf **p_conf)
 {
     pj_pool_t *pool;
     pjmedia_conf *conf;
     const pj_str_t name = { "Conf", 4 };
+    unsigned max_ports, clock_rate, channel_count;
+    unsigned samples_per_frame, bits_per_sample;
     pj_status_t status;
 
+    PJ_ASSERT_RETURN(param && p_conf, PJ_EINVAL);
+
+    max_ports = param->max_slots;
+    clock_rate = param->sampling_rate;
+    channel_count = param->channel_count;
+    samples_per_frame = param->samples_per_frame;
+    bits_per_sample = param->bits_per_sample;
+
     PJ_ASSERT_RETURN(samples_per_frame > 0, PJ_EINVAL);
     /* Can only accept 16bits per sample, for now.. */
     PJ_ASSERT_RETURN(bits_per_sample == 16, PJ_EINVAL);
+    /* The speakers of a frame are tracked in 32bit masks */
+    PJ_ASSERT_RETURN(param->max_speakers <= 32, PJ_EINVAL);
 
     PJ_LOG(5,(THIS_FILE, "Creating conference bridge with %d ports",
               max_ports));
@@ -785,13 +926,28 @@ PJ_DEF(pj_status_t) pjmedia_conf_create( pj_pool_t *pool_,
                   pj_pool_zalloc(pool, max_ports*sizeof(void*));
     PJ_ASSERT_RETURN(conf->ports, PJ_ENOMEM);
 
-    conf->options = options;
+    conf->options = param->options;
     conf->max_ports = max_ports;
     conf->clock_rate = clock_rate;
     conf->channel_count = channel_count;
     conf->samples_per_frame = samples_per_frame;
     conf->bits_per_sample = bits_per_sample;
 
+    if (param->max_speakers) {
+        status = create_speakers(pool, conf, param->max_speakers);
+        if (status != PJ_SUCCESS) {
+            pj_pool_release(pool);
+            return status;
+        }
+    }
+
+    if (conf->options & PJMEDIA_CONF_FANOUT) {
+        status = create_fanout(pool, conf);
+        if (status != PJ_SUCCESS) {
+            pj_pool_release(pool);
+            return status;
+        }
+    }
     
     /* Create and initialize the master port interface. */
     conf->master_port = PJ_POOL_ZALLOC_T(pool, pjmedia_port);
@@ -1263,6 +1419,8 @@ PJ_DEF(pj_status_t) pjmedia_conf_configure_port( pjmedia_conf *conf,
     if (rx != PJMEDIA_PORT_NO_CHANGE)
         conf_port->rx_setting = rx;
 
+    conf->fanout_dirty = PJ_TRUE;
+
     pj_mutex_unlock(conf->mutex);
 
     return PJ_SUCCESS;
@@ -1912,6 +2070,10 @@ static pj_status_t op_remove_port(pjmedia_conf *conf,
         conf_port->port = NULL;
     }
 
+    /* Don't let the next port in this slot inherit the speaker level */
+    if (conf->spk_level)
+        conf->spk_level[port] = 0;
+
     /* Remove the port. */
     pj_mutex_lock(conf->mutex);
     conf->ports[port] = NULL;
@@ -2143,6 +2305,7 @@ PJ_DEF(pj_status_t) pjmedia_conf_adjust_tx_level( pjmedia_conf *conf,
 
     /* Set normalized adjustment level. */
     conf_port->tx_adj_level = adj_level + NORMAL_LEVEL;
+    conf->fanout_dirty = PJ_TRUE;
 
     /* Unlock mutex */
     pj_mutex_unlock(conf->mutex);
@@ -2194,6 +2357,7 @@ PJ_DEF(pj_status_t) pjmedia_conf_adjust_conn_level( pjmedia_conf *conf,
     } 
     /* Set normalized adjustment level. */
     src_port->listener_adj_level[i] = adj_level + NORMAL_LEVEL;
+    conf->fanout_dirty = PJ_TRUE;
 
     pj_mutex_unlock(conf->mutex);
     return PJ_SUCCESS;
@@ -2359,7 +2523,7 @@ static pj_status_t write_port(pjmedia_conf *conf, struct conf_port *cport,
                               pjmedia_frame_type *frm_type)
 {
     pj_int16_t *buf;
-    unsigned j, ts;
+    unsigned ts;
     pj_status_t status;
     pj_int32_t adj_level;
     pj_int32_t tx_level;
@@ -2445,31 +2609,11 @@ static pj_status_t write_port(pjmedia_conf *conf, struct conf_port *cport,
     adj_level = cport->tx_adj_level * cport->mix_adj;
     adj_level >>= 7;
 
-    tx_level = 0;
-
-    if (adj_level != NORMAL_LEVEL) {
-        for (j=0; j<conf->samples_per_frame; ++j) {
-            pj_int32_t itemp = cport->mix_buf[j];
-
-            /* Adjust the level */
-            /*itemp = itemp * adj_level / NORMAL_LEVEL;*/
-            itemp = (itemp * adj_level) >> 7;
-
-            /* Clip the signal if it's too loud */
-            if (itemp > MAX_LEVEL) itemp = MAX_LEVEL;
-            else if (itemp < MIN_LEVEL) itemp = MIN_LEVEL;
-
-            /* Put back in the buffer. */
-            buf[j] = (pj_int16_t) itemp;
-
-            tx_level += (buf[j]>=0? buf[j] : -buf[j]);
-        }
-    } else {
-        for (j=0; j<conf->samples_per_frame; ++j) {
-            buf[j] = (pj_int16_t) cport->mix_buf[j];
-            tx_level += (buf[j]>=0? buf[j] : -buf[j]);
-        }
-    }
+    /* Adjust the level, clip the signal if it's too loud, and put it back
+     * in the buffer as 16bit samples.
+     */
+    tx_level = pjmedia_mix_clamp(buf, cport->mix_buf, conf->samples_per_frame,
+                                 adj_level);
 
     tx_level /= conf->samples_per_frame;
 
@@ -2592,6 +2736,427 @@ static pj_status_t write_port(pjmedia_conf *conf, struct conf_port *cport,
 }
 
 
+/*
+ * Count the bits that are set.
+ */
+static unsigned bit_count(pj_uint32_t v)
+{
+    unsigned cnt;
+
+    for (cnt = 0; v; ++cnt)
+        v &= v - 1;
+    return cnt;
+}
+
+
+/*
+ * Offer the frame of a port as an active speaker candidate. The level is
+ * the average level of the frame. It rises immediately but falls slowly,
+ * so a speaker stays selected during short pauses.
+ */
+static void speaker_offer(pjmedia_conf *conf, SLOT_TYPE slot,
+                          const pj_int16_t *frame, pj_uint32_t level)
+{
+    pj_uint32_t smoothed = conf->spk_level[slot];
+    unsigned k, min_k;
+
+    if (level < smoothed)
+        level = (smoothed * 7 + level) >> 3;
+    conf->spk_level[slot] = level;
+
+    if (level < PJMEDIA_CONF_SPEAKER_THRESHOLD)
+        return;
+
+    if (conf->spk_cnt < conf->max_speakers) {
+        k = conf->spk_cnt++;
+    } else {
+        /* Replace the quietest speaker if this one is louder */
+        for (min_k = 0, k = 1; k < conf->spk_cnt; ++k) {
+            if (conf->spk_sel_level[k] < conf->spk_sel_level[min_k])
+                min_k = k;
+        }
+        if (level <= conf->spk_sel_level[min_k])
+            return;
+        k = min_k;
+    }
+
+    conf->spk_slot[k] = slot;
+    conf->spk_sel_level[k] = level;
+    pjmedia_copy_samples(conf->spk_frame[k], frame, conf->samples_per_frame);
+}
+
+
+/*
+ * Mix the selected speakers into the bus, and find out which speakers
+ * each listener hears.
+ */
+static void speaker_mix_bus(pjmedia_conf *conf)
+{
+    unsigned spf = conf->samples_per_frame;
+    unsigned k, j;
+
+    /* A single 16bit frame can not overflow, so the min/max stay zero
+     * unless there are more speakers.
+     */
+    conf->spk_bus_min = conf->spk_bus_max = 0;
+    if (conf->spk_cnt == 0)
+        return;
+
+    pjmedia_mix_copy(conf->spk_bus, conf->spk_frame[0], spf);
+    for (k = 1; k < conf->spk_cnt; ++k) {
+        pjmedia_mix_add(conf->spk_bus, conf->spk_frame[k], spf,
+                        &conf->spk_bus_min, &conf->spk_bus_max);
+    }
+
+    for (k = 0; k < conf->spk_cnt; ++k) {
+        struct conf_port *speaker = conf->ports[conf->spk_slot[k]];
+
+        for (j = 0; j < speaker->listener_cnt; ++j) {
+            SLOT_TYPE listener_slot = speaker->listener_slots[j];
+            struct conf_port *listener = conf->ports[listener_slot];
+
+            /* Skip if this listener doesn't want to receive audio, or
+             * if it gets the signal of its fan-out group leader.
+             */
+            if (listener->tx_setting != PJMEDIA_PORT_ENABLE ||
+                listener->fanout_leader != INVALID_SLOT)
+            {
+                continue;
+            }
+
+            conf->spk_mask[listener_slot] |= (1U << k);
+            if (speaker->listener_adj_level[j] != NORMAL_LEVEL) {
+                conf->spk_adj_mask[listener_slot] |= (1U << k);
+                conf->spk_adj[listener_slot * conf->max_speakers + k] =
+                    speaker->listener_adj_level[j];
+            }
+        }
+    }
+}
+
+
+/*
+ * Build the mixed signal of a listener from the speakers it hears.
+ * Returns the number of speakers heard.
+ */
+static unsigned speaker_mix_listener(pjmedia_conf *conf,
+                                     struct conf_port *listener,
+                                     SLOT_TYPE listener_slot)
+{
+    unsigned spf = conf->samples_per_frame;
+    pj_uint32_t mask = conf->spk_mask[listener_slot];
+    pj_uint32_t adj_mask = conf->spk_adj_mask[listener_slot];
+    pj_uint32_t missing;
+    pj_int32_t mix_buf_min = 0;
+    pj_int32_t mix_buf_max = 0;
+    unsigned k;
+
+    conf->spk_mask[listener_slot] = 0;
+    conf->spk_adj_mask[listener_slot] = 0;
+
+    listener->mix_adj = NORMAL_LEVEL;
+
+    if (mask == 0) {
+        pj_bzero(listener->mix_buf, spf * sizeof(listener->mix_buf[0]));
+        return 0;
+    }
+
+    missing = (conf->spk_cnt == 32 ? 0xFFFFFFFF : (1U << conf->spk_cnt) - 1);
+    missing &= ~mask;
+
+    if (adj_mask == 0 && bit_count(missing) < bit_count(mask)) {
+        /* Take the bus and remove the speakers the listener doesn't
+         * hear, typically the listener itself.
+         */
+        pj_memcpy(listener->mix_buf, conf->spk_bus,
+                  spf * sizeof(listener->mix_buf[0]));
+        mix_buf_min = conf->spk_bus_min;
+        mix_buf_max = conf->spk_bus_max;
+
+        for (k = 0; missing; ++k, missing >>= 1) {
+            if (missing & 1) {
+                pjmedia_mix_sub(listener->mix_buf, conf->spk_frame[k], spf,
+                                &mix_buf_min, &mix_buf_max);
+            }
+        }
+    } else {
+        /* Connection level adjustment, or only few speakers heard:
+         * mix them directly.
+         */
+        pj_bool_t first = PJ_TRUE;
+
+        for (k = 0; k < conf->spk_cnt; ++k) {
+            const pj_int16_t *p_in = conf->spk_frame[k];
+
+            if ((mask & (1U << k)) == 0)
+                continue;
+
+            if (adj_mask & (1U << k)) {
+                pjmedia_mix_adjust(listener->adj_level_buf, p_in, spf,
+                        conf->spk_adj[listener_slot * conf->max_speakers + k]);
+                p_in = listener->adj_level_buf;
+            }
+
+            if (first) {
+                pjmedia_mix_copy(listener->mix_buf, p_in, spf);
+                first = PJ_FALSE;
+            } else {
+                pjmedia_mix_add(listener->mix_buf, p_in, spf,
+                                &mix_buf_min, &mix_buf_max);
+            }
+        }
+    }
+
+    /* Check if normalization adjustment needed. */
+    if (mix_buf_min < MIN_LEVEL || mix_buf_max > MAX_LEVEL) {
+        if (-mix_buf_min > mix_buf_max)
+            mix_buf_max = -mix_buf_min;
+
+        /* NORMAL_LEVEL * MAX_LEVEL / mix_buf_max; */
+        listener->mix_adj = (MAX_LEVEL<<7) / mix_buf_max;
+    }
+
+    return bit_count(mask);
+}
+
+
+/*
+ * Hash of a connection, the hash of a listener is the sum of the hashes of
+ * its connections so it doesn't depend on the order of the connections.
+ */
+static pj_uint64_t fanout_hash_conn(SLOT_TYPE src_slot, unsigned adj_level)
+{
+    pj_uint64_t x = ((pj_uint64_t)src_slot << 32) | adj_level;
+
+    x += PJ_UINT64(0x9E3779B97F4A7C15);
+    x = (x ^ (x >> 30)) * PJ_UINT64(0xBF58476D1CE4E5B9);
+    x = (x ^ (x >> 27)) * PJ_UINT64(0x94D049BB133111EB);
+    return x ^ (x >> 31);
+}
+
+/*
+ * Check whether the port can be put in a fan-out group. The members are
+ * sent the frame of the leader as is, so the port must not need any
+ * conversion. Port zero is never grouped since its signal is returned to
+ * the sound device.
+ */
+static pj_bool_t fanout_eligible(pjmedia_conf *conf, SLOT_TYPE slot,
+                                 const struct conf_port *cport)
+{
+    return slot != 0 && !cport->is_new &&
+           cport->tx_setting == PJMEDIA_PORT_ENABLE &&
+           cport->transmitter_cnt != 0 &&
+           cport->port != NULL && cport->port->put_frame != NULL &&
+           cport->delay_buf == NULL &&
+           cport->clock_rate == conf->clock_rate &&
+           cport->samples_per_frame == conf->samples_per_frame &&
+           cport->channel_count == conf->channel_count;
+}
+
+/*
+ * Group the listeners that receive the same mix, i.e. that have the same
+ * transmitters with the same connection levels, and the same TX level.
+ */
+static void update_fanout(pjmedia_conf *conf)
+{
+    SLOT_TYPE i;
+    unsigned j, ngroup = 0, nmember = 0;
+
+    conf->fanout_dirty = PJ_FALSE;
+
+    for (i = 0; i < conf->max_ports; ++i) {
+        struct conf_port *cport = conf->ports[i];
+
+        if (!cport)
+            continue;
+        cport->fanout_leader = INVALID_SLOT;
+        cport->fanout_next = INVALID_SLOT;
+        conf->fanout_hash[i] = 0;
+    }
+
+    for (i = 0; i < conf->max_ports; ++i) {
+        struct conf_port *src = conf->ports[i];
+
+        if (!src)
+            continue;
+        for (j = 0; j < src->listener_cnt; ++j) {
+            conf->fanout_hash[src->listener_slots[j]] +=
+                fanout_hash_conn(i, src->listener_adj_level[j]);
+        }
+    }
+
+    /* Find the leader with the same hash, or make the port a leader */
+    pj_memset(conf->fanout_tab, 0xFF,
+              (conf->fanout_tab_mask + 1) * sizeof(SLOT_TYPE));
+
+    for (i = 0; i < conf->max_ports; ++i) {
+        struct conf_port *cport = conf->ports[i];
+        unsigned h;
+
+        if (!cport || !fanout_eligible(conf, i, cport))
+            continue;
+
+        h = (unsigned)conf->fanout_hash[i] & conf->fanout_tab_mask;
+        for (;;) {
+            SLOT_TYPE leader_slot = conf->fanout_tab[h];
+            struct conf_port *leader;
+
+            if (leader_slot == INVALID_SLOT) {
+                conf->fanout_tab[h] = i;
+                break;
+            }
+
+            leader = conf->ports[leader_slot];
+            if (conf->fanout_hash[leader_slot] == conf->fanout_hash[i] &&
+                leader->transmitter_cnt == cport->transmitter_cnt &&
+                leader->tx_adj_level == cport->tx_adj_level)
+            {
+                cport->fanout_leader = leader_slot;
+                break;
+            }
+
+            h = (h + 1) & conf->fanout_tab_mask;
+        }
+    }
+
+    /* Don't trust the hash alone: every transmitter of a member must also
+     * transmit to the leader with the same level. Since both have the same
+     * number of transmitters, they then have the same connections.
+     */
+    for (i = 0; i < conf->max_ports; ++i) {
+        struct conf_port *src = conf->ports[i];
+
+        if (!src || src->listener_cnt == 0)
+            continue;
+
+        for (j = 0; j < src->listener_cnt; ++j) {
+            conf->fanout_mark[src->listener_slots[j]] =
+                src->listener_adj_level[j] + 1;
+        }
+
+        for (j = 0; j < src->listener_cnt; ++j) {
+            struct conf_port *listener = conf->ports[src->listener_slots[j]];
+
+            if (listener->fanout_leader != INVALID_SLOT &&
+                conf->fanout_mark[listener->fanout_leader] !=
+                    src->listener_adj_level[j] + 1)
+            {
+                listener->fanout_leader = INVALID_SLOT;
+            }
+        }
+
+        for (j = 0; j < src->listener_cnt; ++j)
+            conf->fanout_mark[src->listener_slots[j]] = 0;
+    }
+
+    /* Link the members to their leader */
+    for (i = 0; i < conf->max_ports; ++i) {
+        struct conf_port *cport = conf->ports[i];
+        struct conf_port *leader;
+
+        if (!cport || cport->fanout_leader == INVALID_SLOT)
+            continue;
+
+        leader = conf->ports[cport->fanout_leader];
+        if (leader->fanout_next == INVALID_SLOT)
+            ++ngroup;
+        cport->fanout_next = leader->fanout_next;
+        leader->fanout_next = i;
+        ++nmember;
+    }
+
+    PJ_LOG(5,(THIS_FILE, "Fan-out: %d ports share the mix of %d ports",
+              nmember, ngroup));
+}
+
+/*
+ * Get the stream of a stream port, if it is one.
+ */
+static pjmedia_stream *fanout_get_stream(const struct conf_port *cport)
+{
+    if (cport->port->info.signature != PJMEDIA_SIG_PORT_STREAM)
+        return NULL;
+    return (pjmedia_stream*)cport->port->port_data.pdata;
+}
+
+/* Number of different encodings tracked per group */
+#define FANOUT_MAX_ENC      8
+
+/*
+ * Send the frame just written to the group leader to the group members.
+ * Streams reuse the payload of the first stream in the group that encoded
+ * the frame the same way.
+ */
+static void write_fanout(pjmedia_conf *conf, struct conf_port *leader,
+                         const pj_timestamp *timestamp,
+                         pjmedia_frame_type frm_type)
+{
+    pjmedia_stream *enc_strm[FANOUT_MAX_ENC];
+    unsigned enc_cnt = 0;
+    SLOT_TYPE slot;
+
+    if (frm_type == PJMEDIA_FRAME_TYPE_AUDIO) {
+        enc_strm[0] = fanout_get_stream(leader);
+        if (enc_strm[0])
+            enc_cnt = 1;
+    }
+
+    slot = leader->fanout_next;
+    while (slot != INVALID_SLOT) {
+        struct conf_port *member = conf->ports[slot];
+        pjmedia_stream *strm, *enc_src = NULL;
+        pjmedia_frame frame;
+        unsigned k;
+
+        slot = member->fanout_next;
+
+        /* The setting may have changed since the groups were built, such
+         * port doesn't need the mixed signal.
+         */
+        if (member->tx_setting != PJMEDIA_PORT_ENABLE) {
+            pjmedia_frame_type type;
+
+            write_port(conf, member, timestamp, &type);
+            continue;
+        }
+
+        pj_bzero(&frame, sizeof(frame));
+        frame.timestamp = *timestamp;
+
+        /* The leader has nothing to transmit, send heart-beat */
+        if (frm_type != PJMEDIA_FRAME_TYPE_AUDIO) {
+            member->tx_level = 0;
+            frame.type = PJMEDIA_FRAME_TYPE_NONE;
+            pjmedia_port_put_frame(member->port, &frame);
+            continue;
+        }
+
+        member->tx_heart_beat = 0;
+        member->tx_level = leader->tx_level;
+
+        frame.type = PJMEDIA_FRAME_TYPE_AUDIO;
+        frame.buf = leader->mix_buf;
+        frame.size = conf->samples_per_frame * BYTES_PER_SAMPLE;
+
+        strm = fanout_get_stream(member);
+        if (!strm) {
+            pjmedia_port_put_frame(member->port, &frame);
+            continue;
+        }
+
+        for (k = 0; k < enc_cnt; ++k) {
+            if (pjmedia_stream_is_enc_compatible(enc_strm[k], strm)) {
+                enc_src = enc_strm[k];
+                break;
+            }
+        }
+        if (!enc_src && enc_cnt < FANOUT_MAX_ENC)
+            enc_strm[enc_cnt++] = strm;
+
+        pjmedia_stream_put_frame_from(strm, &frame, enc_src);
+    }
+}
+
 /*
  * Player callback.
  */
@@ -2600,7 +3165,7 @@ static pj_status_t get_frame(pjmedia_port *this_port,
 {
     pjmedia_conf *conf = (pjmedia_conf*) this_port->port_data.pdata;
     pjmedia_frame_type speaker_frame_type = PJMEDIA_FRAME_TYPE_NONE;
-    unsigned ci, cj, i, j;
+    unsigned ci, cj, i;
     pj_int16_t *p_in;
     
     TRACE_((THIS_FILE, "- clock -"));
@@ -2618,6 +3183,10 @@ static pj_status_t get_frame(pjmedia_port *this_port,
         pj_log_pop_indent();
     }
 
+    /* Rebuild the fan-out groups after the connections have changed */
+    if (conf->fanout_tab && conf->fanout_dirty)
+        update_fanout(conf);
+
     /* No mutex from this point! Otherwise it may cause deadlock as
      * put_frame()/get_frame() may invoke callback.
      *
@@ -2646,12 +3215,16 @@ static pj_status_t get_frame(pjmedia_port *this_port,
          * reset auto adjustment level for mixed signal.
          */
         conf_port->mix_adj = NORMAL_LEVEL;
-        if (conf_port->transmitter_cnt) {
+        if (conf_port->transmitter_cnt && !conf->max_speakers &&
+            conf_port->fanout_leader == INVALID_SLOT)
+        {
             pj_bzero(conf_port->mix_buf,
                      conf->samples_per_frame*sizeof(conf_port->mix_buf[0]));
         }
     }
 
+    conf->spk_cnt = 0;
+
     /* Get frames from all ports, and "mix" the signal 
      * to mix_buf of all listeners of the port.
      */
@@ -2734,42 +3307,29 @@ static pj_status_t get_frame(pjmedia_port *this_port,
          * and calculate the average level at the same time.
          */
         if (conf_port->rx_adj_level != NORMAL_LEVEL) {
-            for (j=0; j<conf->samples_per_frame; ++j) {
-                /* For the level adjustment, we need to store the sample to
-                 * a temporary 32bit integer value to avoid overflowing the
-                 * 16bit sample storage.
-                 */
-                pj_int32_t itemp;
-
-                itemp = p_in[j];
-                /*itemp = itemp * adj / NORMAL_LEVEL;*/
-                /* bad code (signed/unsigned badness):
-                 *  itemp = (itemp * conf_port->rx_adj_level) >> 7;
-                 */
-                itemp *= conf_port->rx_adj_level;
-                itemp >>= 7;
-
-                /* Clip the signal if it's too loud */
-                if (itemp > MAX_LEVEL) itemp = MAX_LEVEL;
-                else if (itemp < MIN_LEVEL) itemp = MIN_LEVEL;
-
-                p_in[j] = (pj_int16_t) itemp;
-                level += (p_in[j]>=0? p_in[j] : -p_in[j]);
-            }
+            level = pjmedia_mix_adjust(p_in, p_in, conf->samples_per_frame,
+                                       conf_port->rx_adj_level);
         } else {
-            for (j=0; j<conf->samples_per_frame; ++j) {
-                level += (p_in[j]>=0? p_in[j] : -p_in[j]);
-            }
+            level = pjmedia_mix_level(p_in, conf->samples_per_frame);
         }
 
         level /= conf->samples_per_frame;
 
+        /* In active speaker mode the frame is only mixed if the port is
+         * selected, after all ports have been read.
+         */
+        if (conf->max_speakers)
+            speaker_offer(conf, (SLOT_TYPE)i, p_in, level);
+
         /* Convert level to 8bit complement ulaw */
         level = pjmedia_linear2ulaw(level) ^ 0xff;
 
         /* Put this level to port's last RX level. */
         conf_port->rx_level = level;
 
+        if (conf->max_speakers)
+            continue;
+
         // Ticket #671: Skipping very low audio signal may cause noise 
         // to be generated in the remote end by some hardphones.
         /* Skip processing frame if level is zero */
@@ -2785,36 +3345,22 @@ static pj_status_t get_frame(pjmedia_port *this_port,
 
             listener = conf->ports[conf_port->listener_slots[cj]];
 
-            /* Skip if this listener doesn't want to receive audio */
-            if (listener->tx_setting != PJMEDIA_PORT_ENABLE)
+            /* Skip if this listener doesn't want to receive audio, or
+             * if it gets the signal of its fan-out group leader.
+             */
+            if (listener->tx_setting != PJMEDIA_PORT_ENABLE ||
+                listener->fanout_leader != INVALID_SLOT)
+            {
                 continue;
+            }
 
             mix_buf = listener->mix_buf;
 
             /* apply connection level, if not normal */
             if (conf_port->listener_adj_level[cj] != NORMAL_LEVEL) {
-                unsigned k = 0;
-                for (; k < conf->samples_per_frame; ++k) {
-                    /* For the level adjustment, we need to store the sample to
-                     * a temporary 32bit integer value to avoid overflowing the
-                     * 16bit sample storage.
-                     */
-                    pj_int32_t itemp;
-
-                    itemp = p_in[k];
-                    /*itemp = itemp * adj / NORMAL_LEVEL;*/
-                    /* bad code (signed/unsigned badness):
-                     *  itemp = (itemp * conf_port->listsener_adj_level) >> 7;
-                     */
-                    itemp *= conf_port->listener_adj_level[cj];
-                    itemp >>= 7;
-
-                    /* Clip the signal if it's too loud */
-                    if (itemp > MAX_LEVEL) itemp = MAX_LEVEL;
-                    else if (itemp < MIN_LEVEL) itemp = MIN_LEVEL;
-
-                    conf_port->adj_level_buf[k] = (pj_int16_t)itemp;
-                }
+                pjmedia_mix_adjust(conf_port->adj_level_buf, p_in,
+                                   conf->samples_per_frame,
+                                   conf_port->listener_adj_level[cj]);
 
                 /* take the leveled frame */
                 p_in_conn_leveled = conf_port->adj_level_buf;
@@ -2828,17 +3374,12 @@ static pj_status_t get_frame(pjmedia_port *this_port,
                  * and calculate appropriate level adjustment if there is
                  * any overflowed level in the mixed signal.
                  */
-                unsigned k, samples_per_frame = conf->samples_per_frame;
-                pj_int32_t mix_buf_min = 0;
-                pj_int32_t mix_buf_max = 0;
-
-                for (k = 0; k < samples_per_frame; ++k) {
-                    mix_buf[k] += p_in_conn_leveled[k];
-                    if (mix_buf[k] < mix_buf_min)
-                        mix_buf_min = mix_buf[k];
-                    if (mix_buf[k] > mix_buf_max)
-                        mix_buf_max = mix_buf[k];
-                }
+                pj_int32_t mix_buf_min;
+                pj_int32_t mix_buf_max;
+
+                pjmedia_mix_add(mix_buf, p_in_conn_leveled,
+                                conf->samples_per_frame,
+                                &mix_buf_min, &mix_buf_max);
 
                 /* Check if normalization adjustment needed. */
                 if (mix_buf_min < MIN_LEVEL || mix_buf_max > MAX_LEVEL) {
@@ -2857,15 +3398,34 @@ static pj_status_t get_frame(pjmedia_port *this_port,
                  * just copy the samples to the mix buffer
                  * no mixing and level adjustment needed
                  */
-                unsigned k, samples_per_frame = conf->samples_per_frame;
-
-                for (k = 0; k < samples_per_frame; ++k) {
-                    mix_buf[k] = p_in_conn_leveled[k];
-                }
+                pjmedia_mix_copy(mix_buf, p_in_conn_leveled,
+                                 conf->samples_per_frame);
             }
         } /* loop the listeners of conf port */
     } /* loop of all conf ports */
 
+    /* Active speaker mode: mix the selected speakers once, then derive
+     * the signal of each listener from it.
+     */
+    if (conf->max_speakers) {
+        speaker_mix_bus(conf);
+
+        for (i=0, ci=0; i<conf->max_ports && ci<conf->port_cnt; ++i) {
+            struct conf_port *conf_port = conf->ports[i];
+
+            if (!conf_port || conf_port->is_new)
+                continue;
+            ++ci;
+
+            if (conf_port->tx_setting == PJMEDIA_PORT_ENABLE &&
+                conf_port->transmitter_cnt &&
+                conf_port->fanout_leader == INVALID_SLOT)
+            {
+                speaker_mix_listener(conf, conf_port, (SLOT_TYPE)i);
+            }
+        }
+    }
+
     /* Time for all ports to transmit whetever they have in their
      * buffer. 
      */
@@ -2880,8 +3440,16 @@ static pj_status_t get_frame(pjmedia_port *this_port,
         /* Var "ci" is to count how many ports have been visited. */
         ++ci;
 
+        /* Fan-out group members are written along with their leader */
+        if (conf_port->fanout_leader != INVALID_SLOT)
+            continue;
+
         status = write_port( conf, conf_port, &frame->timestamp,
                              &frm_type);
+
+        if (conf_port->fanout_next != INVALID_SLOT)
+            write_fanout(conf, conf_port, &frame->timestamp, frm_type);
+
         if (status != PJ_SUCCESS) {
             /* bennylp: why do we need this????
                One thing for sure, put_frame()/write_port() may return
@@ -27,6 +27,7 @@
 #include <pj/log.h>
 #include <pj/math.h>
 #include <pj/pool.h>
+#include <pj/ring.h>
 
 
 #if 0
@@ -82,6 +83,12 @@ struct pjmedia_delay_buf
 
     /* Drift handler */
     pjmedia_wsola   *wsola;             /**< Drift handler                   */
+
+    /* Simple FIFO */
+    pj_ring_t       *fifo;              /**< Ring of frames, used instead of
+                                             circ_buf and lock when WSOLA is
+                                             not used.                       */
+    unsigned         max_frames;        /**< Maximum frames in the fifo      */
 };
 
 
@@ -118,10 +125,24 @@ PJ_DEF(pj_status_t) pjmedia_delay_buf_create( pj_pool_t *pool,
     b->eff_cnt = b->max_cnt >> 1;
     b->recalc_timer = RECALC_TIME;
 
-    /* Create circular buffer */
-    status = pjmedia_circ_buf_create(pool, b->max_cnt, &b->circ_buf);
-    if (status != PJ_SUCCESS)
-        return status;
+    if (options & PJMEDIA_DELAY_BUF_SIMPLE_FIFO) {
+        /* Without WSOLA, samples are only moved a frame at a time, so the
+         * producer and consumer threads can share a lock-free ring of
+         * frames. A multi-consumer ring lets put() drop the eldest frame
+         * and reset() clear the buffer from any thread.
+         */
+        b->max_frames = PJ_MAX(b->max_cnt / samples_per_frame, 1);
+        status = pj_ring_create(pool, PJ_RING_MPMC, b->max_frames,
+                                samples_per_frame * sizeof(pj_int16_t),
+                                &b->fifo);
+        if (status != PJ_SUCCESS)
+            return status;
+    } else {
+        /* Create circular buffer */
+        status = pjmedia_circ_buf_create(pool, b->max_cnt, &b->circ_buf);
+        if (status != PJ_SUCCESS)
+            return status;
+    }
 
     if (!(options & PJMEDIA_DELAY_BUF_SIMPLE_FIFO)) {
         /* Create WSOLA */
@@ -166,6 +187,11 @@ PJ_DEF(pj_status_t) pjmedia_delay_buf_destroy(pjmedia_delay_buf *b)
     pj_lock_destroy(b->lock);
     b->lock = NULL;
 
+    if (b->fifo) {
+        pj_ring_destroy(b->fifo);
+        b->fifo = NULL;
+    }
+
     return status;
 }
 
@@ -259,6 +285,30 @@ static void update(pjmedia_delay_buf *b, enum OP op)
     }
 }
 
+/* Simple FIFO put, the eldest frames are dropped when the buffer is full */
+static void fifo_put(pjmedia_delay_buf *b, const pj_int16_t frame[])
+{
+    unsigned drop_cnt = 0;
+
+    while (pj_ring_size(b->fifo) >= b->max_frames &&
+           pj_ring_pop(b->fifo, NULL) == PJ_SUCCESS)
+    {
+        ++drop_cnt;
+    }
+
+    /* The ring may still be full if other thread has just put a frame */
+    while (pj_ring_push(b->fifo, frame) != PJ_SUCCESS) {
+        if (pj_ring_pop(b->fifo, NULL) == PJ_SUCCESS)
+            ++drop_cnt;
+    }
+
+    if (drop_cnt) {
+        PJ_LOG(4,(b->obj_name,"Dropping %d eldest samples, buf_cnt=%d",
+                  drop_cnt * b->samples_per_frame,
+                  pj_ring_size(b->fifo) * b->samples_per_frame));
+    }
+}
+
 PJ_DEF(pj_status_t) pjmedia_delay_buf_put(pjmedia_delay_buf *b,
                                            pj_int16_t frame[])
 {
@@ -266,6 +316,11 @@ PJ_DEF(pj_status_t) pjmedia_delay_buf_put(pjmedia_delay_buf *b,
 
     PJ_ASSERT_RETURN(b && frame, PJ_EINVAL);
 
+    if (b->fifo) {
+        fifo_put(b, frame);
+        return PJ_SUCCESS;
+    }
+
     pj_lock_acquire(b->lock);
 
     if (b->wsola) {
@@ -324,6 +379,15 @@ PJ_DEF(pj_status_t) pjmedia_delay_buf_get( pjmedia_delay_buf *b,
 
     PJ_ASSERT_RETURN(b && frame, PJ_EINVAL);
 
+    if (b->fifo) {
+        if (pj_ring_pop(b->fifo, frame) != PJ_SUCCESS) {
+            PJ_LOG(4,(b->obj_name,"Underflow, buf_cnt=0, will generate "
+                      "1 frame"));
+            pjmedia_zero_samples(frame, b->samples_per_frame);
+        }
+        return PJ_SUCCESS;
+    }
+
     pj_lock_acquire(b->lock);
 
     if (b->wsola)
@@ -383,6 +447,13 @@ PJ_DEF(pj_status_t) pjmedia_delay_buf_reset(pjmedia_delay_buf *b)
 {
     PJ_ASSERT_RETURN(b, PJ_EINVAL);
 
+    if (b->fifo) {
+        while (pj_ring_pop_n(b->fifo, NULL, b->max_frames))
+            ;
+        PJ_LOG(5,(b->obj_name,"Delay buffer is reset"));
+        return PJ_SUCCESS;
+    }
+
     pj_lock_acquire(b->lock);
 
     b->recalc_timer = RECALC_TIME;
@@ -0,0 +1,780 @@
+/*
+ * Copyright (C) 2025 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <pjmedia/mix.h>
+#include <pjmedia/errno.h>
+#include <pj/assert.h>
+#include <pj/log.h>
+#include <pj/string.h>
+
+#define THIS_FILE       "mix.c"
+
+#define NORMAL_LEVEL    128
+#define MAX_LEVEL       (32767)
+#define MIN_LEVEL       (-32768)
+
+/* The 16bit SIMD multiplication needs the adjustment to fit in 16bit.
+ * Larger adjustments (which clip nearly everything anyway) go to the
+ * C implementation.
+ */
+#define MAX_SIMD_ADJ    32767
+
+
+typedef pj_uint32_t (*mix_adjust_func)(pj_int16_t *dst, const pj_int16_t *src,
+                                       unsigned count, unsigned adj);
+typedef pj_uint32_t (*mix_level_func)(const pj_int16_t *src, unsigned count);
+typedef void (*mix_copy_func)(pj_int32_t *mix_buf, const pj_int16_t *src,
+                              unsigned count);
+typedef void (*mix_add_func)(pj_int32_t *mix_buf, const pj_int16_t *src,
+                             unsigned count, pj_bool_t sub,
+                             pj_int32_t *p_min, pj_int32_t *p_max);
+typedef pj_uint32_t (*mix_clamp_func)(pj_int16_t *dst,
+                                      const pj_int32_t *mix_buf,
+                                      unsigned count, unsigned adj);
+
+struct mix_impl
+{
+    const char      *name;
+    mix_adjust_func  adjust;
+    mix_level_func   level;
+    mix_copy_func    copy;
+    mix_add_func     add;
+    mix_clamp_func   clamp;
+};
+
+
+/*
+ * Portable C implementation. The SIMD kernels use these for the samples
+ * left over after the last full vector.
+ *
+ * The multiplications are done in unsigned arithmetic so that overflow
+ * wraps around the same way as the SIMD instructions do.
+ */
+static pj_int16_t clip16(pj_int32_t v)
+{
+    if (v > MAX_LEVEL) return MAX_LEVEL;
+    if (v < MIN_LEVEL) return MIN_LEVEL;
+    return (pj_int16_t)v;
+}
+
+static pj_uint32_t adjust_c(pj_int16_t *dst, const pj_int16_t *src,
+                            unsigned count, unsigned adj)
+{
+    pj_uint32_t level = 0;
+    unsigned i;
+
+    for (i = 0; i < count; ++i) {
+        pj_int32_t itemp = (pj_int32_t)((pj_uint32_t)(pj_int32_t)src[i]*adj);
+
+        dst[i] = clip16(itemp >> 7);
+        level += (dst[i] >= 0 ? dst[i] : -dst[i]);
+    }
+    return level;
+}
+
+static pj_uint32_t level_c(const pj_int16_t *src, unsigned count)
+{
+    pj_uint32_t level = 0;
+    unsigned i;
+
+    for (i = 0; i < count; ++i)
+        level += (src[i] >= 0 ? src[i] : -src[i]);
+    return level;
+}
+
+static void copy_c(pj_int32_t *mix_buf, const pj_int16_t *src, unsigned count)
+{
+    unsigned i;
+
+    for (i = 0; i < count; ++i)
+        mix_buf[i] = src[i];
+}
+
+static void add_c(pj_int32_t *mix_buf, const pj_int16_t *src, unsigned count,
+                  pj_bool_t sub, pj_int32_t *p_min, pj_int32_t *p_max)
+{
+    pj_int32_t mn = 0, mx = 0;
+    unsigned i;
+
+    for (i = 0; i < count; ++i) {
+        if (sub)
+            mix_buf[i] -= src[i];
+        else
+            mix_buf[i] += src[i];
+        if (mix_buf[i] < mn) mn = mix_buf[i];
+        if (mix_buf[i] > mx) mx = mix_buf[i];
+    }
+    *p_min = mn;
+    *p_max = mx;
+}
+
+static pj_uint32_t clamp_c(pj_int16_t *dst, const pj_int32_t *mix_buf,
+                           unsigned count, unsigned adj)
+{
+    pj_uint32_t level = 0;
+    unsigned i;
+
+    for (i = 0; i < count; ++i) {
+        pj_int32_t itemp = mix_buf[i];
+
+        if (adj != NORMAL_LEVEL)
+            itemp = (pj_int32_t)((pj_uint32_t)itemp * adj) >> 7;
+
+        /* dst may alias mix_buf, mix_buf[i] has been read already */
+        dst[i] = clip16(itemp);
+        level += (dst[i] >= 0 ? dst[i] : -dst[i]);
+    }
+    return level;
+}
+
+static const struct mix_impl mix_c =
+{
+    "c", &adjust_c, &level_c, &copy_c, &add_c, &clamp_c
+};
+
+
+#if defined(PJMEDIA_MIX_USE_SIMD) && PJMEDIA_MIX_USE_SIMD != 0 && \
+    (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+
+#include <immintrin.h>
+
+#define MIX_HAS_SIMD    1
+
+/* Sum of absolute values of eight 16bit samples into four 32bit lanes.
+ * Multiplying by +1/-1 with pmaddwd gives |x| exactly, including -32768.
+ */
+__attribute__((target("sse2")))
+static __m128i abs_sum_sse2(__m128i acc, __m128i v)
+{
+    __m128i sign = _mm_or_si128(_mm_srai_epi16(v, 15), _mm_set1_epi16(1));
+    return _mm_add_epi32(acc, _mm_madd_epi16(v, sign));
+}
+
+__attribute__((target("sse2")))
+static pj_uint32_t hsum_sse2(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (pj_uint32_t)_mm_cvtsi128_si32(v);
+}
+
+/* (x * adj) >> 7 for eight 16bit samples, saturated to 16bit */
+__attribute__((target("sse2")))
+static __m128i mul_adj_sse2(__m128i v, __m128i vadj)
+{
+    __m128i lo = _mm_mullo_epi16(v, vadj);
+    __m128i hi = _mm_mulhi_epi16(v, vadj);
+    __m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 7);
+    __m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 7);
+    return _mm_packs_epi32(p0, p1);
+}
+
+/* Low 32bit of the 32x32 multiplication, SSE2 has no pmulld */
+__attribute__((target("sse2")))
+static __m128i mullo32_sse2(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0,0,2,0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0,0,2,0)));
+}
+
+__attribute__((target("sse2")))
+static __m128i min32_sse2(__m128i a, __m128i b)
+{
+    __m128i gt = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a));
+}
+
+__attribute__((target("sse2")))
+static __m128i max32_sse2(__m128i a, __m128i b)
+{
+    __m128i gt = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+}
+
+__attribute__((target("sse2")))
+static pj_uint32_t adjust_sse2(pj_int16_t *dst, const pj_int16_t *src,
+                               unsigned count, unsigned adj)
+{
+    const __m128i vadj = _mm_set1_epi16((short)adj);
+    __m128i acc = _mm_setzero_si128();
+    unsigned i;
+
+    if (adj > MAX_SIMD_ADJ)
+        return adjust_c(dst, src, count, adj);
+
+    for (i = 0; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        v = mul_adj_sse2(v, vadj);
+        _mm_storeu_si128((__m128i*)(dst + i), v);
+        acc = abs_sum_sse2(acc, v);
+    }
+    return hsum_sse2(acc) + adjust_c(dst + i, src + i, count - i, adj);
+}
+
+__attribute__((target("sse2")))
+static pj_uint32_t level_sse2(const pj_int16_t *src, unsigned count)
+{
+    __m128i acc = _mm_setzero_si128();
+    unsigned i;
+
+    for (i = 0; i + 8 <= count; i += 8) {
+        acc = abs_sum_sse2(acc, _mm_loadu_si128((const __m128i*)(src + i)));
+    }
+    return hsum_sse2(acc) + level_c(src + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void copy_sse2(pj_int32_t *mix_buf, const pj_int16_t *src,
+                      unsigned count)
+{
+    unsigned i;
+
+    for (i = 0; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(mix_buf + i),
+                         _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+        _mm_storeu_si128((__m128i*)(mix_buf + i + 4),
+                         _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+    }
+    copy_c(mix_buf + i, src + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void add_sse2(pj_int32_t *mix_buf, const pj_int16_t *src,
+                     unsigned count, pj_bool_t sub,
+                     pj_int32_t *p_min, pj_int32_t *p_max)
+{
+    __m128i vmin = _mm_setzero_si128();
+    __m128i vmax = _mm_setzero_si128();
+    pj_int32_t lanes[8];
+    unsigned i, j;
+
+    for (i = 0; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i m0 = _mm_loadu_si128((const __m128i*)(mix_buf + i));
+        __m128i m1 = _mm_loadu_si128((const __m128i*)(mix_buf + i + 4));
+
+        __m128i s0 = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i s1 = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+
+        if (sub) {
+            m0 = _mm_sub_epi32(m0, s0);
+            m1 = _mm_sub_epi32(m1, s1);
+        } else {
+            m0 = _mm_add_epi32(m0, s0);
+            m1 = _mm_add_epi32(m1, s1);
+        }
+        _mm_storeu_si128((__m128i*)(mix_buf + i), m0);
+        _mm_storeu_si128((__m128i*)(mix_buf + i + 4), m1);
+        vmin = min32_sse2(vmin, min32_sse2(m0, m1));
+        vmax = max32_sse2(vmax, max32_sse2(m0, m1));
+    }
+
+    add_c(mix_buf + i, src + i, count - i, sub, p_min, p_max);
+
+    _mm_storeu_si128((__m128i*)lanes, vmin);
+    _mm_storeu_si128((__m128i*)(lanes + 4), vmax);
+    for (j = 0; j < 4; ++j) {
+        if (lanes[j] < *p_min) *p_min = lanes[j];
+        if (lanes[j + 4] > *p_max) *p_max = lanes[j + 4];
+    }
+}
+
+__attribute__((target("sse2")))
+static pj_uint32_t clamp_sse2(pj_int16_t *dst, const pj_int32_t *mix_buf,
+                              unsigned count, unsigned adj)
+{
+    const __m128i vadj = _mm_set1_epi32((int)adj);
+    __m128i acc = _mm_setzero_si128();
+    unsigned i;
+
+    /* When converting in place, the eight samples stored by an iteration
+     * never reach the 32bit samples that are not loaded yet.
+     */
+    for (i = 0; i + 8 <= count; i += 8) {
+        __m128i m0 = _mm_loadu_si128((const __m128i*)(mix_buf + i));
+        __m128i m1 = _mm_loadu_si128((const __m128i*)(mix_buf + i + 4));
+        __m128i v;
+
+        if (adj != NORMAL_LEVEL) {
+            m0 = _mm_srai_epi32(mullo32_sse2(m0, vadj), 7);
+            m1 = _mm_srai_epi32(mullo32_sse2(m1, vadj), 7);
+        }
+        v = _mm_packs_epi32(m0, m1);
+        _mm_storeu_si128((__m128i*)(dst + i), v);
+        acc = abs_sum_sse2(acc, v);
+    }
+    return hsum_sse2(acc) + clamp_c(dst + i, mix_buf + i, count - i, adj);
+}
+
+static const struct mix_impl mix_sse2 =
+{
+    "sse2", &adjust_sse2, &level_sse2, &copy_sse2, &add_sse2, &clamp_sse2
+};
+
+
+__attribute__((target("avx2")))
+static __m256i abs_sum_avx2(__m256i acc, __m256i v)
+{
+    __m256i sign = _mm256_or_si256(_mm256_srai_epi16(v, 15),
+                                   _mm256_set1_epi16(1));
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(v, sign));
+}
+
+__attribute__((target("avx2")))
+static pj_uint32_t hsum_avx2(__m256i v)
+{
+    return hsum_sse2(_mm_add_epi32(_mm256_castsi256_si128(v),
+                                   _mm256_extracti128_si256(v, 1)));
+}
+
+__attribute__((target("avx2")))
+static pj_uint32_t adjust_avx2(pj_int16_t *dst, const pj_int16_t *src,
+                               unsigned count, unsigned adj)
+{
+    const __m256i vadj = _mm256_set1_epi16((short)adj);
+    __m256i acc = _mm256_setzero_si256();
+    unsigned i;
+
+    if (adj > MAX_SIMD_ADJ)
+        return adjust_c(dst, src, count, adj);
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i lo = _mm256_mullo_epi16(v, vadj);
+        __m256i hi = _mm256_mulhi_epi16(v, vadj);
+
+        /* Unpack and pack both work within 128bit lanes, so the samples
+         * come out in their original order.
+         */
+        v = _mm256_packs_epi32(
+                _mm256_srai_epi32(_mm256_unpacklo_epi16(lo, hi), 7),
+                _mm256_srai_epi32(_mm256_unpackhi_epi16(lo, hi), 7));
+        _mm256_storeu_si256((__m256i*)(dst + i), v);
+        acc = abs_sum_avx2(acc, v);
+    }
+    return hsum_avx2(acc) + adjust_sse2(dst + i, src + i, count - i, adj);
+}
+
+__attribute__((target("avx2")))
+static pj_uint32_t level_avx2(const pj_int16_t *src, unsigned count)
+{
+    __m256i acc = _mm256_setzero_si256();
+    unsigned i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        acc = abs_sum_avx2(acc,
+                           _mm256_loadu_si256((const __m256i*)(src + i)));
+    }
+    return hsum_avx2(acc) + level_sse2(src + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void copy_avx2(pj_int32_t *mix_buf, const pj_int16_t *src,
+                      unsigned count)
+{
+    unsigned i;
+
+    for (i = 0; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(mix_buf + i),
+                            _mm256_cvtepi16_epi32(v));
+    }
+    copy_c(mix_buf + i, src + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void add_avx2(pj_int32_t *mix_buf, const pj_int16_t *src,
+                     unsigned count, pj_bool_t sub,
+                     pj_int32_t *p_min, pj_int32_t *p_max)
+{
+    __m256i vmin = _mm256_setzero_si256();
+    __m256i vmax = _mm256_setzero_si256();
+    pj_int32_t lanes[16];
+    unsigned i, j;
+
+    for (i = 0; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        __m256i m = _mm256_loadu_si256((const __m256i*)(mix_buf + i));
+
+        if (sub)
+            m = _mm256_sub_epi32(m, _mm256_cvtepi16_epi32(v));
+        else
+            m = _mm256_add_epi32(m, _mm256_cvtepi16_epi32(v));
+        _mm256_storeu_si256((__m256i*)(mix_buf + i), m);
+        vmin = _mm256_min_epi32(vmin, m);
+        vmax = _mm256_max_epi32(vmax, m);
+    }
+
+    add_c(mix_buf + i, src + i, count - i, sub, p_min, p_max);
+
+    _mm256_storeu_si256((__m256i*)lanes, vmin);
+    _mm256_storeu_si256((__m256i*)(lanes + 8), vmax);
+    for (j = 0; j < 8; ++j) {
+        if (lanes[j] < *p_min) *p_min = lanes[j];
+        if (lanes[j + 8] > *p_max) *p_max = lanes[j + 8];
+    }
+}
+
+__attribute__((target("avx2")))
+static pj_uint32_t clamp_avx2(pj_int16_t *dst, const pj_int32_t *mix_buf,
+                              unsigned count, unsigned adj)
+{
+    const __m256i vadj = _mm256_set1_epi32((int)adj);
+    __m256i acc = _mm256_setzero_si256();
+    unsigned i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        __m256i m0 = _mm256_loadu_si256((const __m256i*)(mix_buf + i));
+        __m256i m1 = _mm256_loadu_si256((const __m256i*)(mix_buf + i + 8));
+        __m256i v;
+
+        if (adj != NORMAL_LEVEL) {
+            m0 = _mm256_srai_epi32(_mm256_mullo_epi32(m0, vadj), 7);
+            m1 = _mm256_srai_epi32(_mm256_mullo_epi32(m1, vadj), 7);
+        }
+        /* packs interleaves the 128bit lanes of both operands */
+        v = _mm256_permute4x64_epi64(_mm256_packs_epi32(m0, m1),
+                                     _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i*)(dst + i), v);
+        acc = abs_sum_avx2(acc, v);
+    }
+    return hsum_avx2(acc) + clamp_sse2(dst + i, mix_buf + i, count - i, adj);
+}
+
+static const struct mix_impl mix_avx2 =
+{
+    "avx2", &adjust_avx2, &level_avx2, &copy_avx2, &add_avx2, &clamp_avx2
+};
+
+#define MIX_MAX_SIMD    2
+
+/* Get the SIMD implementations supported by the CPU, best first */
+static unsigned mix_enum_simd(const struct mix_impl *impl[])
+{
+    unsigned cnt = 0;
+
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        impl[cnt++] = &mix_avx2;
+    if (__builtin_cpu_supports("sse2"))
+        impl[cnt++] = &mix_sse2;
+    return cnt;
+}
+
+
+#elif defined(PJMEDIA_MIX_USE_SIMD) && PJMEDIA_MIX_USE_SIMD != 0 && \
+      defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+
+#include <arm_neon.h>
+
+#define MIX_HAS_SIMD    1
+
+/* vabsq_s16() wraps -32768 to itself, which is 32768 when read as
+ * unsigned, so the pairwise accumulation is exact.
+ */
+static uint32x4_t abs_sum_neon(uint32x4_t acc, int16x8_t v)
+{
+    return vpadalq_u16(acc, vreinterpretq_u16_s16(vabsq_s16(v)));
+}
+
+static int16x8_t mul_adj_neon(int16x8_t v, int32x4_t vadj)
+{
+    int32x4_t p0 = vmulq_s32(vmovl_s16(vget_low_s16(v)), vadj);
+    int32x4_t p1 = vmulq_s32(vmovl_s16(vget_high_s16(v)), vadj);
+    return vcombine_s16(vqmovn_s32(vshrq_n_s32(p0, 7)),
+                        vqmovn_s32(vshrq_n_s32(p1, 7)));
+}
+
+static pj_uint32_t adjust_neon(pj_int16_t *dst, const pj_int16_t *src,
+                               unsigned count, unsigned adj)
+{
+    const int32x4_t vadj = vdupq_n_s32((int)adj);
+    uint32x4_t acc = vdupq_n_u32(0);
+    unsigned i;
+
+    for (i = 0; i + 8 <= count; i += 8) {
+        int16x8_t v = mul_adj_neon(vld1q_s16(src + i), vadj);
+        vst1q_s16(dst + i, v);
+        acc = abs_sum_neon(acc, v);
+    }
+    return vaddvq_u32(acc) + adjust_c(dst + i, src + i, count - i, adj);
+}
+
+static pj_uint32_t level_neon(const pj_int16_t *src, unsigned count)
+{
+    uint32x4_t acc = vdupq_n_u32(0);
+    unsigned i;
+
+    for (i = 0; i + 8 <= count; i += 8)
+        acc = abs_sum_neon(acc, vld1q_s16(src + i));
+    return vaddvq_u32(acc) + level_c(src + i, count - i);
+}
+
+static void copy_neon(pj_int32_t *mix_buf, const pj_int16_t *src,
+                      unsigned count)
+{
+    unsigned i;
+
+    for (i = 0; i + 8 <= count; i += 8) {
+        int16x8_t v = vld1q_s16(src + i);
+        vst1q_s32(mix_buf + i, vmovl_s16(vget_low_s16(v)));
+        vst1q_s32(mix_buf + i + 4, vmovl_s16(vget_high_s16(v)));
+    }
+    copy_c(mix_buf + i, src + i, count - i);
+}
+
+static void add_neon(pj_int32_t *mix_buf, const pj_int16_t *src,
+                     unsigned count, pj_bool_t sub,
+                     pj_int32_t *p_min, pj_int32_t *p_max)
+{
+    int32x4_t vmin = vdupq_n_s32(0);
+    int32x4_t vmax = vdupq_n_s32(0);
+    pj_int32_t mn, mx;
+    unsigned i;
+
+    for (i = 0; i + 8 <= count; i += 8) {
+        int16x8_t v = vld1q_s16(src + i);
+        int32x4_t m0 = vld1q_s32(mix_buf + i);
+        int32x4_t m1 = vld1q_s32(mix_buf + i + 4);
+
+        if (sub) {
+            m0 = vsubw_s16(m0, vget_low_s16(v));
+            m1 = vsubw_s16(m1, vget_high_s16(v));
+        } else {
+            m0 = vaddw_s16(m0, vget_low_s16(v));
+            m1 = vaddw_s16(m1, vget_high_s16(v));
+        }
+
+        vst1q_s32(mix_buf + i, m0);
+        vst1q_s32(mix_buf + i + 4, m1);
+        vmin = vminq_s32(vmin, vminq_s32(m0, m1));
+        vmax = vmaxq_s32(vmax, vmaxq_s32(m0, m1));
+    }
+
+    add_c(mix_buf + i, src + i, count - i, sub, p_min, p_max);
+
+    mn = vminvq_s32(vmin);
+    mx = vmaxvq_s32(vmax);
+    if (mn < *p_min) *p_min = mn;
+    if (mx > *p_max) *p_max = mx;
+}
+
+static pj_uint32_t clamp_neon(pj_int16_t *dst, const pj_int32_t *mix_buf,
+                              unsigned count, unsigned adj)
+{
+    const int32x4_t vadj = vdupq_n_s32((int)adj);
+    uint32x4_t acc = vdupq_n_u32(0);
+    unsigned i;
+
+    for (i = 0; i + 8 <= count; i += 8) {
+        int32x4_t m0 = vld1q_s32(mix_buf + i);
+        int32x4_t m1 = vld1q_s32(mix_buf + i + 4);
+        int16x8_t v;
+
+        if (adj != NORMAL_LEVEL) {
+            m0 = vshrq_n_s32(vmulq_s32(m0, vadj), 7);
+            m1 = vshrq_n_s32(vmulq_s32(m1, vadj), 7);
+        }
+        v = vcombine_s16(vqmovn_s32(m0), vqmovn_s32(m1));
+        vst1q_s16(dst + i, v);
+        acc = abs_sum_neon(acc, v);
+    }
+    return vaddvq_u32(acc) + clamp_c(dst + i, mix_buf + i, count - i, adj);
+}
+
+static const struct mix_impl mix_neon =
+{
+    "neon", &adjust_neon, &level_neon, &copy_neon, &add_neon, &clamp_neon
+};
+
+#define MIX_MAX_SIMD    1
+
+static unsigned mix_enum_simd(const struct mix_impl *impl[])
+{
+    /* NEON is mandatory on ARM64 */
+    impl[0] = &mix_neon;
+    return 1;
+}
+
+
+#else
+
+#define MIX_HAS_SIMD    0
+#define MIX_MAX_SIMD    0
+
+static unsigned mix_enum_simd(const struct mix_impl *impl[])
+{
+    PJ_UNUSED_ARG(impl);
+    return 0;
+}
+
+#endif
+
+
+/* Get all the implementations that can run on this CPU, best first */
+static unsigned mix_enum(const struct mix_impl *impl[MIX_MAX_SIMD+1])
+{
+    unsigned cnt = mix_enum_simd(impl);
+
+    impl[cnt++] = &mix_c;
+    return cnt;
+}
+
+/* Get the best SIMD implementation, or NULL if there is none */
+static const struct mix_impl *mix_select(void)
+{
+    const struct mix_impl *impl[MIX_MAX_SIMD+1];
+
+    return mix_enum(impl) > 1 ? impl[0] : NULL;
+}
+
+
+/* The implementation in use. This starts with the C implementation and
+ * is switched to the SIMD one on first use, unless the application has
+ * chosen explicitly with pjmedia_mix_enable_simd().
+ */
+static const struct mix_impl *mix = &mix_c;
+static pj_bool_t mix_initialized;
+
+static void mix_init(void)
+{
+    const struct mix_impl *impl = mix_select();
+
+    if (impl)
+        mix = impl;
+    mix_initialized = PJ_TRUE;
+}
+
+#define MIX_INIT()      if (!mix_initialized) mix_init()
+
+
+PJ_DEF(pj_status_t) pjmedia_mix_enable_simd(pj_bool_t enable)
+{
+    const struct mix_impl *impl = enable ? mix_select() : &mix_c;
+
+    if (!impl)
+        return PJ_ENOTSUP;
+
+    mix = impl;
+    mix_initialized = PJ_TRUE;
+
+    PJ_LOG(4,(THIS_FILE, "Audio mixing uses %s implementation", mix->name));
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(pj_status_t) pjmedia_mix_enum_impl(unsigned *count,
+                                          const char *names[])
+{
+    const struct mix_impl *impl[MIX_MAX_SIMD+1];
+    unsigned i, cnt;
+
+    PJ_ASSERT_RETURN(count && names, PJ_EINVAL);
+
+    cnt = mix_enum(impl);
+    if (cnt > *count)
+        cnt = *count;
+    for (i = 0; i < cnt; ++i)
+        names[i] = impl[i]->name;
+    *count = cnt;
+
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(pj_status_t) pjmedia_mix_set_impl(const char *name)
+{
+    const struct mix_impl *impl[MIX_MAX_SIMD+1];
+    unsigned i, cnt;
+
+    PJ_ASSERT_RETURN(name, PJ_EINVAL);
+
+    cnt = mix_enum(impl);
+    for (i = 0; i < cnt; ++i) {
+        if (pj_ansi_stricmp(impl[i]->name, name) == 0)
+            break;
+    }
+    if (i == cnt)
+        return PJ_ENOTSUP;
+
+    mix = impl[i];
+    mix_initialized = PJ_TRUE;
+
+    PJ_LOG(4,(THIS_FILE, "Audio mixing uses %s implementation", mix->name));
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(const char*) pjmedia_mix_get_impl_name(void)
+{
+    MIX_INIT();
+    return mix->name;
+}
+
+PJ_DEF(pj_uint32_t) pjmedia_mix_adjust(pj_int16_t *dst,
+                                       const pj_int16_t *src,
+                                       unsigned count,
+                                       unsigned adj)
+{
+    MIX_INIT();
+    return (*mix->adjust)(dst, src, count, adj);
+}
+
+PJ_DEF(pj_uint32_t) pjmedia_mix_level(const pj_int16_t *src,
+                                      unsigned count)
+{
+    MIX_INIT();
+    return (*mix->level)(src, count);
+}
+
+PJ_DEF(void) pjmedia_mix_copy(pj_int32_t *mix_buf,
+                              const pj_int16_t *src,
+                              unsigned count)
+{
+    MIX_INIT();
+    (*mix->copy)(mix_buf, src, count);
+}
+
+PJ_DEF(void) pjmedia_mix_add(pj_int32_t *mix_buf,
+                             const pj_int16_t *src,
+                             unsigned count,
+                             pj_int32_t *p_min,
+                             pj_int32_t *p_max)
+{
+    MIX_INIT();
+    (*mix->add)(mix_buf, src, count, PJ_FALSE, p_min, p_max);
+}
+
+PJ_DEF(void) pjmedia_mix_sub(pj_int32_t *mix_buf,
+                             const pj_int16_t *src,
+                             unsigned count,
+                             pj_int32_t *p_min,
+                             pj_int32_t *p_max)
+{
+    MIX_INIT();
+    (*mix->add)(mix_buf, src, count, PJ_TRUE, p_min, p_max);
+}
+
+PJ_DEF(pj_uint32_t) pjmedia_mix_clamp(pj_int16_t *dst,
+                                      const pj_int32_t *mix_buf,
+                                      unsigned count,
+                                      unsigned adj)
+{
+    MIX_INIT();
+    return (*mix->clamp)(dst, mix_buf, count, adj);
+}
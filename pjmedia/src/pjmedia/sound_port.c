@@ -391,7 +391,10 @@ static pj_status_t start_sound_device( pj_pool_t *pool,
     if ((snd_port->options & PJMEDIA_SND_PORT_USE_SW_CLOCK) &&
         (snd_port->aud_param.ext_fmt.id == PJMEDIA_FORMAT_L16))
     {
-        unsigned ptime;
+        unsigned ptime, dbuf_opt = 0;
+
+        if (snd_port->options & PJMEDIA_SND_PORT_SW_CLOCK_SIMPLE_FIFO)
+            dbuf_opt |= PJMEDIA_DELAY_BUF_SIMPLE_FIFO;
 
         status = pjmedia_clock_create(pool,
                                       snd_port->clock_rate,
@@ -411,7 +414,7 @@ static pj_status_t start_sound_device( pj_pool_t *pool,
                                           snd_port->samples_per_frame,
                                           snd_port->channel_count,
                                           PJMEDIA_SOUND_BUFFER_COUNT * ptime,
-                                          0, /* options */
+                                          dbuf_opt,
                                           &snd_port->play_dbuf);
         if (status != PJ_SUCCESS)
             goto on_error;
@@ -421,7 +424,7 @@ static pj_status_t start_sound_device( pj_pool_t *pool,
                                           snd_port->samples_per_frame,
                                           snd_port->channel_count,
                                           PJMEDIA_SOUND_BUFFER_COUNT * ptime,
-                                          0, /* options */
+                                          dbuf_opt,
                                           &snd_port->cap_dbuf);
         if (status != PJ_SUCCESS)
             goto on_error;
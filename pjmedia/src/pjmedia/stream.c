@@ -134,6 +134,15 @@ struct pjmedia_stream
 
     pj_int16_t              *zero_frame;    /**< Zero frame buffer.         */
 
+    /* Encoded payload sharing, see pjmedia_stream_put_frame_from() */
+    pjmedia_stream          *enc_src;       /**< Stream to take the payload
+                                                 of the current frame from. */
+    const void              *enc_last_in;   /**< Input of the last encoded
+                                                 frame, or NULL.            */
+    pj_uint64_t              enc_last_ts;   /**< Its timestamp.             */
+    const void              *enc_last_out;  /**< Its encoded payload.       */
+    pj_size_t                enc_last_size; /**< Size of the payload.       */
+
     /* RFC 2833 DTMF transmission queue: */
     unsigned                 dtmf_duration; /**< DTMF duration(in timestamp)*/
     int                      tx_event_pt;   /**< Outgoing pt for dtmf.      */
@@ -1017,6 +1026,9 @@ static pj_status_t put_frame_imp( pjmedia_port *port,
     /* Increment transmit duration */
     stream->tx_duration += ts_len;
 
+    /* Forget the last encoded frame until this one is encoded */
+    stream->enc_last_in = NULL;
+
     /* Init frame_out buffer. */
     frame_out.buf = ((char*)channel->buf) + sizeof(pjmedia_rtp_hdr);
     frame_out.size = 0;
@@ -1098,15 +1110,37 @@ static pj_status_t put_frame_imp( pjmedia_port *port,
                 frame->buf != NULL) ||
                (frame->type == PJMEDIA_FRAME_TYPE_EXTENDED))
     {
-        /* Encode! */
-        status = pjmedia_codec_encode( stream->codec, frame,
-                                       channel->buf_size -
-                                       sizeof(pjmedia_rtp_hdr),
-                                       &frame_out);
-        if (status != PJ_SUCCESS) {
-            LOGERR_((c_strm->port.info.name.ptr, status,
-                    "Codec encode() error"));
-            return status;
+        pjmedia_stream *src = stream->enc_src;
+
+        if (src && frame->type == PJMEDIA_FRAME_TYPE_AUDIO &&
+            src->enc_last_in == frame->buf &&
+            src->enc_last_ts == frame->timestamp.u64 &&
+            src->enc_last_size <= channel->buf_size -
+                                  sizeof(pjmedia_rtp_hdr))
+        {
+            /* The other stream has just encoded this frame, take its
+             * payload.
+             */
+            pj_memcpy(frame_out.buf, src->enc_last_out, src->enc_last_size);
+            frame_out.size = src->enc_last_size;
+        } else {
+            /* Encode! */
+            status = pjmedia_codec_encode( stream->codec, frame,
+                                           channel->buf_size -
+                                           sizeof(pjmedia_rtp_hdr),
+                                           &frame_out);
+            if (status != PJ_SUCCESS) {
+                LOGERR_((c_strm->port.info.name.ptr, status,
+                        "Codec encode() error"));
+                return status;
+            }
+        }
+
+        if (frame->type == PJMEDIA_FRAME_TYPE_AUDIO) {
+            stream->enc_last_in = frame->buf;
+            stream->enc_last_ts = frame->timestamp.u64;
+            stream->enc_last_out = frame_out.buf;
+            stream->enc_last_size = frame_out.size;
         }
 
         /* Encapsulate. */
@@ -1496,14 +1530,20 @@ static pj_status_t on_stream_rx_rtp(pjmedia_stream_common *c_strm,
             goto on_return;
         }
 
+        /* The DTMF callback must not be called with jb_mutex held */
+        rx_batch_unlock(c_strm);
         handle_incoming_dtmf(stream, &ts, payload, payloadlen);
         goto on_return;
     }
 
     /* Put "good" packet to jitter buffer, or reset the jitter buffer
-     * when RTP session is restarted.
+     * when RTP session is restarted. When handling a batch of packets,
+     * the lock is kept for the next packets.
      */
-    pj_mutex_lock( c_strm->jb_mutex );
+    if (!c_strm->rx_batch_locked) {
+        pj_mutex_lock( c_strm->jb_mutex );
+        c_strm->rx_batch_locked = c_strm->rx_batch;
+    }
     if (seq_st.status.flag.restart) {
         status = pjmedia_jbuf_reset(c_strm->jb);
         PJ_LOG(4,(c_strm->port.info.name.ptr, "Jitter buffer reset"));
@@ -1671,7 +1711,8 @@ static pj_status_t on_stream_rx_rtp(pjmedia_stream_common *c_strm,
 #endif
 
     }
-    pj_mutex_unlock( c_strm->jb_mutex );
+    if (!c_strm->rx_batch_locked)
+        pj_mutex_unlock( c_strm->jb_mutex );
 
 
     /* Check if now is the time to transmit RTCP SR/RR report.
@@ -1680,6 +1721,7 @@ static pj_status_t on_stream_rx_rtp(pjmedia_stream_common *c_strm,
      * because otherwise check_tx_rtcp() will be handled by put_frame()
      */
     if (c_strm->dir == PJMEDIA_DIR_DECODING || c_strm->enc->paused) {
+        rx_batch_unlock(c_strm);
         check_tx_rtcp(stream, pj_ntohl(hdr->ts));
     }
 
@@ -1694,6 +1736,31 @@ on_return:
     return status;
 }
 
+/*
+ * This callback is called by stream transport with several packets
+ * received at once. The packets go through the same processing as in
+ * on_rx_rtp(), but jb_mutex is locked once for the batch rather than
+ * once per packet.
+ */
+static void on_rx_rtp_batch(pjmedia_tp_cb_param *param, unsigned count)
+{
+    pjmedia_stream_common *c_strm = (pjmedia_stream_common *)
+                                    param[0].user_data;
+    unsigned i;
+
+    /* Add ref counter to avoid premature destroy from callbacks */
+    pj_grp_lock_add_ref(c_strm->grp_lock);
+
+    c_strm->rx_batch = PJ_TRUE;
+    for (i = 0; i < count; ++i)
+        on_rx_rtp(&param[i]);
+    c_strm->rx_batch = PJ_FALSE;
+    rx_batch_unlock(c_strm);
+
+    pj_grp_lock_dec_ref(c_strm->grp_lock);
+}
+
+
 /*
  * Handle events.
  */
@@ -2204,6 +2271,7 @@ PJ_DEF(pj_status_t) pjmedia_stream_create( pjmedia_endpt *endpt,
     }
     att_param.addr_len = pj_sockaddr_get_len(&info->rem_addr);
     att_param.rtp_cb2 = &on_rx_rtp;
+    att_param.rtp_batch_cb = &on_rx_rtp_batch;
     att_param.rtcp_cb = &on_rx_rtcp;
 
     /* Create group lock & attach handler */
@@ -2516,6 +2584,88 @@ PJ_DEF(pj_status_t) pjmedia_stream_get_port( pjmedia_stream *stream,
 }
 
 
+/*
+ * Check whether two streams encode audio the same way.
+ */
+PJ_DEF(pj_bool_t) pjmedia_stream_is_enc_compatible(
+                                        const pjmedia_stream *stream1,
+                                        const pjmedia_stream *stream2)
+{
+    const pjmedia_codec_param *p1, *p2;
+    const pjmedia_codec_fmtp *fmtp1, *fmtp2;
+    unsigned i;
+
+    PJ_ASSERT_RETURN(stream1 && stream2, PJ_FALSE);
+
+    if (stream1 == stream2)
+        return PJ_TRUE;
+
+    if (pj_stricmp(&stream1->si.fmt.encoding_name,
+                   &stream2->si.fmt.encoding_name) != 0 ||
+        stream1->si.fmt.clock_rate != stream2->si.fmt.clock_rate ||
+        stream1->si.fmt.channel_cnt != stream2->si.fmt.channel_cnt)
+    {
+        return PJ_FALSE;
+    }
+
+    /* Streams that rebuffer the frames don't encode the frame they are
+     * given.
+     */
+    if (stream1->base.enc_buf || stream2->base.enc_buf ||
+        stream1->enc_samples_per_pkt != stream2->enc_samples_per_pkt)
+    {
+        return PJ_FALSE;
+    }
+
+    p1 = &stream1->codec_param;
+    p2 = &stream2->codec_param;
+    if (p1->setting.frm_per_pkt != p2->setting.frm_per_pkt ||
+        p1->setting.vad != p2->setting.vad ||
+        p1->setting.cng != p2->setting.cng)
+    {
+        return PJ_FALSE;
+    }
+
+    fmtp1 = &p1->setting.enc_fmtp;
+    fmtp2 = &p2->setting.enc_fmtp;
+    if (fmtp1->cnt != fmtp2->cnt)
+        return PJ_FALSE;
+    for (i = 0; i < fmtp1->cnt; ++i) {
+        if (pj_stricmp(&fmtp1->param[i].name, &fmtp2->param[i].name) != 0 ||
+            pj_strcmp(&fmtp1->param[i].val, &fmtp2->param[i].val) != 0)
+        {
+            return PJ_FALSE;
+        }
+    }
+
+    return PJ_TRUE;
+}
+
+
+/*
+ * Transmit a frame, reusing the payload encoded by another stream.
+ */
+PJ_DEF(pj_status_t) pjmedia_stream_put_frame_from(pjmedia_stream *stream,
+                                                  pjmedia_frame *frame,
+                                                  pjmedia_stream *enc_stream)
+{
+    pjmedia_port *port;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(stream && frame, PJ_EINVAL);
+
+    port = &stream->base.port;
+    if (!port->put_frame)
+        return PJ_EINVALIDOP;
+
+    stream->enc_src = (enc_stream != stream ? enc_stream : NULL);
+    status = (*port->put_frame)(port, frame);
+    stream->enc_src = NULL;
+
+    return status;
+}
+
+
 /*
  * Get the transport object
  */
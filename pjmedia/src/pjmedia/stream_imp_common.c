@@ -392,6 +392,20 @@ static void on_rx_rtcp( void *data,
     }
 }
 
+/*
+ * Release the jitter buffer lock that is kept over a batch of incoming
+ * RTP packets. This must be called before the receive path calls out of
+ * the stream (sending RTCP, application callbacks), so that the lock
+ * is never held there.
+ */
+static void rx_batch_unlock(pjmedia_stream_common *c_strm)
+{
+    if (c_strm->rx_batch_locked) {
+        c_strm->rx_batch_locked = PJ_FALSE;
+        pj_mutex_unlock(c_strm->jb_mutex);
+    }
+}
+
 /*
  * This callback is called by stream transport on receipt of packets
  * in the RTP socket.
@@ -447,6 +461,7 @@ static void on_rx_rtp( pjmedia_tp_cb_param *param)
 
     /* Check if multiplexing is allowed and the payload indicates RTCP. */
     if (c_strm->si->rtcp_mux && hdr->pt >= 64 && hdr->pt <= 95) {
+        rx_batch_unlock(c_strm);
         on_rx_rtcp(c_strm, pkt, bytes_read);
         return;
     }
@@ -612,6 +627,7 @@ on_return:
         }
 
         /* Send it immediately */
+        rx_batch_unlock(c_strm);
         status = send_rtcp(c_strm, !c_strm->rtcp_sdes_bye_disabled,
                            PJ_FALSE, PJ_FALSE, PJ_TRUE, PJ_FALSE, PJ_FALSE);
         if (status != PJ_SUCCESS) {
@@ -624,6 +640,7 @@ on_return:
 
     /* Send RTCP RR and SDES after we receive some RTP packets */
     if (c_strm->rtcp.received >= 10 && !c_strm->initial_rr) {
+        rx_batch_unlock(c_strm);
         status = send_rtcp(c_strm, !c_strm->rtcp_sdes_bye_disabled,
                            PJ_FALSE, PJ_FALSE, PJ_FALSE, PJ_FALSE, PJ_FALSE);
         if (status != PJ_SUCCESS) {
@@ -231,6 +231,7 @@ static pj_status_t transport_attach2(pjmedia_transport *tp,
 
     att_param->rtp_cb2 = &transport_rtp_cb2;
     att_param->rtp_cb = NULL;    
+    att_param->rtp_batch_cb = NULL;
     att_param->rtcp_cb = &transport_rtcp_cb;
     att_param->user_data = adapter;
         
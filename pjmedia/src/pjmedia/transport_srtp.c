@@ -1325,6 +1325,7 @@ static pj_status_t transport_attach2(pjmedia_transport *tp,
     member_param.user_data = srtp;
     member_param.rtp_cb = NULL;
     member_param.rtp_cb2 = &srtp_rtp_cb;
+    member_param.rtp_batch_cb = NULL;
     member_param.rtcp_cb = &srtp_rtcp_cb;
     status = pjmedia_transport_attach2(srtp->member_tp, &member_param);
     if (status != PJ_SUCCESS) {
@@ -73,6 +73,8 @@ struct transport_udp
                         void*,
                         pj_ssize_t);
     void  (*rtp_cb2)(pjmedia_tp_cb_param*); /**< To report incoming RTP.    */
+    void  (*rtp_batch_cb)(pjmedia_tp_cb_param*, /**< To report batches of */
+                          unsigned);            /**< incoming RTP.        */
     void  (*rtcp_cb)(   void*,          /**< To report incoming RTCP.       */
                         void*,
                         pj_ssize_t);
@@ -90,6 +92,10 @@ struct transport_udp
     pj_sockaddr         rtp_src_addr;   /**< Actual packet src addr.        */
     int                 rtp_addrlen;    /**< Address length.                */
     char                rtp_pkt[RTP_LEN];/**< Incoming RTP packet buffer    */
+    char               *rtp_batch_buf;  /**< Buffers for the rest of a batch*/
+    pj_sockaddr        *rtp_batch_addr; /**< Src addresses of the batch.    */
+    pj_sock_mmsg       *rtp_batch_msg;  /**< recvmmsg() descriptors.        */
+    pjmedia_tp_cb_param *rtp_batch_param;/**< Batch callback parameters.    */
 
     pj_bool_t           enable_rtcp_mux;/**< Enable RTP & RTCP multiplexing?*/
     pj_bool_t           use_rtcp_mux;   /**< Use RTP & RTCP multiplexing?   */
@@ -531,6 +537,120 @@ static void call_rtcp_cb(struct transport_udp *udp, pj_ssize_t bytes_read)
         (*cb)(user_data, udp->rtcp_pkt, bytes_read);
 }
 
+#if defined(PJMEDIA_TRANSPORT_SWITCH_REMOTE_ADDR) && \
+    (PJMEDIA_TRANSPORT_SWITCH_REMOTE_ADDR == 1)
+/* Switch remote RTP address to the source address of a packet, as
+ * requested by the RTP callback.
+ */
+static void switch_rtp_rem_addr(struct transport_udp *udp,
+                                const pj_sockaddr *src_addr)
+{
+    char addr_text[PJ_INET6_ADDRSTRLEN+10];
+
+    if (udp->options & PJMEDIA_UDP_NO_SRC_ADDR_CHECKING)
+        return;
+
+    /* Set remote RTP address to source address */
+    pj_sockaddr_cp(&udp->rem_rtp_addr, src_addr);
+
+    PJ_LOG(4,(udp->base.name,
+              "Remote RTP address switched to %s",
+              pj_sockaddr_print(src_addr, addr_text,
+                                sizeof(addr_text), 3)));
+
+    if (udp->use_rtcp_mux) {
+        pj_sockaddr_cp(&udp->rem_rtcp_addr, &udp->rem_rtp_addr);
+        pj_sockaddr_cp(&udp->rtcp_src_addr, &udp->rem_rtcp_addr);
+    } else if (!pj_sockaddr_has_addr(&udp->rtcp_src_addr)) {
+        /* Also update remote RTCP address if actual RTCP source
+         * address is not heard yet.
+         */
+        pj_uint16_t port;
+
+        pj_sockaddr_cp(&udp->rem_rtcp_addr, &udp->rem_rtp_addr);
+        port = (pj_uint16_t)
+               (pj_sockaddr_get_port(&udp->rem_rtp_addr)+1);
+        pj_sockaddr_set_port(&udp->rem_rtcp_addr, port);
+
+        pj_sockaddr_cp(&udp->rtcp_src_addr, &udp->rem_rtcp_addr);
+
+        PJ_LOG(4,(udp->base.name,
+                  "Remote RTCP address switched to predicted"
+                  " address %s",
+                  pj_sockaddr_print(&udp->rtcp_src_addr, addr_text,
+                                    sizeof(addr_text), 3)));
+    }
+}
+#endif
+
+/* Read the RTP packets that are already queued on the socket after the
+ * one in rtp_pkt, and report them all with a single call to the batch
+ * callback. Returns PJ_TRUE if the batch was full, i.e: more packets
+ * may be waiting.
+ */
+static pj_bool_t call_rtp_batch_cb(struct transport_udp *udp,
+                                   pj_ssize_t bytes_read)
+{
+    enum { N = PJMEDIA_TRANSPORT_UDP_RX_BATCH };
+    void (*cb)(pjmedia_tp_cb_param*, unsigned);
+    pjmedia_tp_cb_param *param = udp->rtp_batch_param;
+    pj_sock_mmsg *msg = udp->rtp_batch_msg;
+    unsigned i, cnt, param_cnt;
+
+    cb = udp->rtp_batch_cb;
+
+    for (i = 0; i < N - 1; ++i) {
+        msg[i].buf = udp->rtp_batch_buf + i * RTP_LEN;
+        msg[i].len = RTP_LEN;
+        msg[i].addr = &udp->rtp_batch_addr[i];
+        msg[i].addrlen = sizeof(pj_sockaddr);
+    }
+    cnt = N - 1;
+    if (pj_sock_recvmmsg(udp->rtp_sock, msg, &cnt, 0) != PJ_SUCCESS)
+        cnt = 0;
+
+    param[0].user_data = udp->user_data;
+    param[0].pkt = udp->rtp_pkt;
+    param[0].size = bytes_read;
+    param[0].src_addr = &udp->rtp_src_addr;
+    param[0].rem_switch = PJ_FALSE;
+    param_cnt = 1;
+
+    for (i = 0; i < cnt; ++i) {
+        /* Simulate packet lost on RX direction */
+        if (udp->rx_drop_pct &&
+            (pj_rand() % 100) <= (int)udp->rx_drop_pct)
+        {
+            PJ_LOG(5,(udp->base.name,
+                      "RX RTP packet dropped because of pkt lost "
+                      "simulation"));
+            continue;
+        }
+
+        param[param_cnt].user_data = udp->user_data;
+        param[param_cnt].pkt = msg[i].buf;
+        param[param_cnt].size = msg[i].len;
+        param[param_cnt].src_addr = (pj_sockaddr*)msg[i].addr;
+        param[param_cnt].rem_switch = PJ_FALSE;
+        ++param_cnt;
+    }
+
+    (*cb)(param, param_cnt);
+
+    /* Transport may be destroyed from the callback! */
+    if (!udp->rtp_key || !udp->started)
+        return PJ_FALSE;
+
+#if defined(PJMEDIA_TRANSPORT_SWITCH_REMOTE_ADDR) && \
+    (PJMEDIA_TRANSPORT_SWITCH_REMOTE_ADDR == 1)
+    for (i = 0; i < param_cnt; ++i) {
+        if (param[i].rem_switch)
+            switch_rtp_rem_addr(udp, param[i].src_addr);
+    }
+#endif
+
+    return cnt == N - 1;
+}
 /* Notification from ioqueue about incoming RTP packet */
 static void on_rx_rtp(pj_ioqueue_key_t *key,
                       pj_ioqueue_op_key_t *op_key,
@@ -542,6 +662,7 @@ static void on_rx_rtp(pj_ioqueue_key_t *key,
     pj_bool_t transport_restarted = PJ_FALSE;
     unsigned num_err = 0;
     pj_status_t last_err = PJ_SUCCESS;
+    pj_uint32_t read_flags;
 
     PJ_UNUSED_ARG(op_key);
 
@@ -567,6 +688,8 @@ static void on_rx_rtp(pj_ioqueue_key_t *key,
     do {
         pj_bool_t discard = PJ_FALSE;
 
+        read_flags = 0;
+
         /* Simulate packet lost on RX direction */
         if (udp->rx_drop_pct) {
             if ((pj_rand() % 100) <= (int)udp->rx_drop_pct) {
@@ -578,7 +701,15 @@ static void on_rx_rtp(pj_ioqueue_key_t *key,
         }
 
         //if (!discard && udp->attached && cb)
-        if (!discard && 
+        if (!discard && udp->rtp_batch_cb && bytes_read > 0) {
+            /* Read the packets queued behind this one and report them
+             * together. When the socket has been drained, the next read
+             * can go straight to the ioqueue.
+             */
+            if (!call_rtp_batch_cb(udp, bytes_read))
+                read_flags = PJ_IOQUEUE_ALWAYS_ASYNC;
+            rem_switch = PJ_FALSE;
+        } else if (!discard && 
             (-bytes_read != PJ_STATUS_FROM_OS(PJ_BLOCKING_ERROR_VAL))) 
         {
             call_rtp_cb(udp, bytes_read, &rem_switch);
@@ -590,48 +721,14 @@ static void on_rx_rtp(pj_ioqueue_key_t *key,
 
 #if defined(PJMEDIA_TRANSPORT_SWITCH_REMOTE_ADDR) && \
     (PJMEDIA_TRANSPORT_SWITCH_REMOTE_ADDR == 1)
-        if (rem_switch &&
-            (udp->options & PJMEDIA_UDP_NO_SRC_ADDR_CHECKING)==0)
-        {
-            char addr_text[PJ_INET6_ADDRSTRLEN+10];
-
-            /* Set remote RTP address to source address */
-            pj_sockaddr_cp(&udp->rem_rtp_addr, &udp->rtp_src_addr);
-
-            PJ_LOG(4,(udp->base.name,
-                      "Remote RTP address switched to %s",
-                      pj_sockaddr_print(&udp->rtp_src_addr, addr_text,
-                                        sizeof(addr_text), 3)));
-
-            if (udp->use_rtcp_mux) {
-                pj_sockaddr_cp(&udp->rem_rtcp_addr, &udp->rem_rtp_addr);
-                pj_sockaddr_cp(&udp->rtcp_src_addr, &udp->rem_rtcp_addr);
-            } else if (!pj_sockaddr_has_addr(&udp->rtcp_src_addr)) {
-                /* Also update remote RTCP address if actual RTCP source
-                 * address is not heard yet.
-                 */
-                pj_uint16_t port;
-
-                pj_sockaddr_cp(&udp->rem_rtcp_addr, &udp->rem_rtp_addr);
-                port = (pj_uint16_t)
-                       (pj_sockaddr_get_port(&udp->rem_rtp_addr)+1);
-                pj_sockaddr_set_port(&udp->rem_rtcp_addr, port);
-
-                pj_sockaddr_cp(&udp->rtcp_src_addr, &udp->rem_rtcp_addr);
-
-                PJ_LOG(4,(udp->base.name,
-                          "Remote RTCP address switched to predicted"
-                          " address %s",
-                          pj_sockaddr_print(&udp->rtcp_src_addr, addr_text,
-                                            sizeof(addr_text), 3)));
-            }
-        }
+        if (rem_switch)
+            switch_rtp_rem_addr(udp, &udp->rtp_src_addr);
 #endif
 
         bytes_read = sizeof(udp->rtp_pkt);
         udp->rtp_addrlen = sizeof(udp->rtp_src_addr);
         status = pj_ioqueue_recvfrom(udp->rtp_key, &udp->rtp_read_op,
-                                     udp->rtp_pkt, &bytes_read, 0,
+                                     udp->rtp_pkt, &bytes_read, read_flags,
                                      &udp->rtp_src_addr,
                                      &udp->rtp_addrlen);
 
@@ -840,6 +937,9 @@ static pj_status_t tp_attach          (pjmedia_transport *tp,
                                                       void*,
                                                       pj_ssize_t),
                                        void (*rtp_cb2)(pjmedia_tp_cb_param*),
+                                       void (*rtp_batch_cb)(
+                                                  pjmedia_tp_cb_param*,
+                                                  unsigned),
                                        void (*rtcp_cb)(void*,
                                                        void*,
                                                        pj_ssize_t))
@@ -907,9 +1007,31 @@ static pj_status_t tp_attach          (pjmedia_transport *tp,
         pj_sockaddr_set_port(&udp->rem_rtcp_addr, (pj_uint16_t)rtcp_port);
     }
 
+    /* Allocate the batch buffers the first time a stream wants them.
+     * A batch also uses rtp_pkt, so there is one buffer less.
+     */
+    if (rtp_batch_cb && rtp_cb2 && PJMEDIA_TRANSPORT_UDP_RX_BATCH > 1 &&
+        !udp->rtp_batch_buf)
+    {
+        enum { N = PJMEDIA_TRANSPORT_UDP_RX_BATCH };
+
+        udp->rtp_batch_param = (pjmedia_tp_cb_param*)
+                               pj_pool_calloc(udp->pool, N,
+                                              sizeof(pjmedia_tp_cb_param));
+        udp->rtp_batch_msg = (pj_sock_mmsg*)
+                             pj_pool_calloc(udp->pool, N - 1,
+                                            sizeof(pj_sock_mmsg));
+        udp->rtp_batch_addr = (pj_sockaddr*)
+                              pj_pool_calloc(udp->pool, N - 1,
+                                             sizeof(pj_sockaddr));
+        udp->rtp_batch_buf = (char*)pj_pool_alloc(udp->pool,
+                                                  (N - 1) * RTP_LEN);
+    }
+
     /* Save the callbacks */
     udp->rtp_cb = rtp_cb;
     udp->rtp_cb2 = rtp_cb2;
+    udp->rtp_batch_cb = udp->rtp_batch_buf && rtp_cb2 ? rtp_batch_cb : NULL;
     udp->rtcp_cb = rtcp_cb;
     udp->user_data = user_data;
 
@@ -990,7 +1112,7 @@ static pj_status_t transport_attach(   pjmedia_transport *tp,
                                                        pj_ssize_t))
 {
     return tp_attach(tp, user_data, rem_addr, rem_rtcp, addr_len,
-                     rtp_cb, NULL, rtcp_cb);
+                     rtp_cb, NULL, NULL, rtcp_cb);
 }
 
 
@@ -1002,6 +1124,7 @@ static pj_status_t transport_attach2(pjmedia_transport *tp,
                             (pj_sockaddr_t*)&att_param->rem_rtcp, 
                             att_param->addr_len, att_param->rtp_cb,
                             att_param->rtp_cb2, 
+                            att_param->rtp_batch_cb,
                             att_param->rtcp_cb);
 }
 
@@ -1039,6 +1162,7 @@ static void transport_detach( pjmedia_transport *tp,
         /* Clear up application infos from transport */
         udp->rtp_cb = NULL;
         udp->rtp_cb2 = NULL;
+        udp->rtp_batch_cb = NULL;
         udp->rtcp_cb = NULL;
         udp->user_data = NULL;
 
@@ -405,18 +405,13 @@ static pj_status_t file_put_frame(pjmedia_port *this_port,
     if (fport->fmt_tag == PJMEDIA_WAVE_FMT_TAG_PCM) {
         pj_memcpy(fport->writepos, frame->buf, frame->size);
     } else {
-        unsigned i;
-        pj_int16_t *src = (pj_int16_t*)frame->buf;
+        const pj_int16_t *src = (const pj_int16_t*)frame->buf;
         pj_uint8_t *dst = (pj_uint8_t*)fport->writepos;
 
         if (fport->fmt_tag == PJMEDIA_WAVE_FMT_TAG_ULAW) {
-            for (i = 0; i < frame_size; ++i) {
-                *dst++ = pjmedia_linear2ulaw(*src++);
-            }
+            pjmedia_ulaw_encode(dst, src, frame_size);
         } else {
-            for (i = 0; i < frame_size; ++i) {
-                *dst++ = pjmedia_linear2alaw(*src++);
-            }
+            pjmedia_alaw_encode(dst, src, frame_size);
         }
 
     }
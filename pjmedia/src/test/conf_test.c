@@ -0,0 +1,377 @@
+/*
+ * Copyright (C) 2025 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+#define THIS_FILE       "conf_test.c"
+
+#define CLOCK_RATE      8000
+#define SPF             160
+#define PORT_CNT        5
+#define FRAME_CNT       10
+
+/* Each participant transmits a constant signal to the bridge, and keeps
+ * the last frame the bridge sent to it, so the expected mix is simply the
+ * sum of the signals it should hear.
+ */
+struct member
+{
+    pjmedia_port        base;
+    pj_int16_t          signal;
+    unsigned            slot;
+    pjmedia_frame_type  last_type;
+    const void         *last_buf;
+    pj_int16_t          last_frame[SPF];
+};
+
+static pj_status_t member_get_frame(pjmedia_port *this_port,
+                                    pjmedia_frame *frame)
+{
+    struct member *m = (struct member*)this_port;
+    pj_int16_t *samples = (pj_int16_t*)frame->buf;
+    unsigned i;
+
+    for (i = 0; i < SPF; ++i)
+        samples[i] = m->signal;
+    frame->size = SPF * 2;
+    frame->type = PJMEDIA_FRAME_TYPE_AUDIO;
+    return PJ_SUCCESS;
+}
+
+static pj_status_t member_put_frame(pjmedia_port *this_port,
+                                    pjmedia_frame *frame)
+{
+    struct member *m = (struct member*)this_port;
+
+    m->last_type = frame->type;
+    m->last_buf = frame->buf;
+    if (frame->type == PJMEDIA_FRAME_TYPE_AUDIO)
+        pj_memcpy(m->last_frame, frame->buf, SPF * 2);
+    return PJ_SUCCESS;
+}
+
+/* Loud to silent, the last one is below the speaker threshold */
+static const pj_int16_t signals[PORT_CNT] = { 3000, 2000, 1000, 500, 0 };
+
+static int check_member(const struct member *m, pj_int32_t expected)
+{
+    unsigned i;
+
+    PJ_TEST_EQ(m->last_type, PJMEDIA_FRAME_TYPE_AUDIO, NULL, return -1);
+    for (i = 0; i < SPF; ++i) {
+        PJ_TEST_EQ(m->last_frame[i], expected, NULL, return -2);
+    }
+    return 0;
+}
+
+static pj_status_t add_member(pj_pool_t *pool, pjmedia_conf *conf,
+                              unsigned idx, pj_int16_t signal,
+                              struct member **p_member)
+{
+    struct member *m;
+    char name[16];
+    pj_str_t port_name;
+
+    m = PJ_POOL_ZALLOC_T(pool, struct member);
+    pj_ansi_snprintf(name, sizeof(name), "member%d", idx);
+    pj_strdup2(pool, &port_name, name);
+    pjmedia_port_info_init(&m->base.info, &port_name,
+                           PJMEDIA_SIG_CLASS_PORT_AUD('T','M'),
+                           CLOCK_RATE, 1, 16, SPF);
+    m->base.get_frame = &member_get_frame;
+    m->base.put_frame = &member_put_frame;
+    m->signal = signal;
+
+    *p_member = m;
+    return pjmedia_conf_add_port(conf, pool, &m->base, NULL, &m->slot);
+}
+
+static int run_frames(pjmedia_port *master, pj_int16_t *buf)
+{
+    pjmedia_frame frame;
+    unsigned i;
+
+    for (i = 0; i < FRAME_CNT; ++i) {
+        pj_bzero(&frame, sizeof(frame));
+        frame.buf = buf;
+        frame.size = SPF * 2;
+        frame.timestamp.u64 = i * SPF;
+        PJ_TEST_SUCCESS(pjmedia_port_get_frame(master, &frame), NULL,
+                        return -1);
+    }
+    return 0;
+}
+
+/* Every member is connected to every other member. In active speaker mode
+ * with two speakers, the two loudest members hear each other, and the rest
+ * hear the sum of both. Otherwise everybody hears everybody else.
+ */
+static int conf_mix_test(unsigned max_speakers)
+{
+    pj_pool_t *pool;
+    pjmedia_conf_param param;
+    pjmedia_conf *conf = NULL;
+    pjmedia_port *master;
+    struct member *members[PORT_CNT];
+    pj_int16_t buf[SPF];
+    pj_int32_t total = 0;
+    unsigned i, j;
+    int rc = 0;
+
+    pool = pj_pool_create(mem, "conftest", 4000, 4000, NULL);
+
+    pjmedia_conf_param_default(&param);
+    param.max_slots = PORT_CNT + 1;
+    param.sampling_rate = CLOCK_RATE;
+    param.channel_count = 1;
+    param.samples_per_frame = SPF;
+    param.bits_per_sample = 16;
+    param.options = PJMEDIA_CONF_NO_DEVICE;
+    param.max_speakers = max_speakers;
+
+    PJ_TEST_SUCCESS(pjmedia_conf_create2(pool, &param, &conf), NULL,
+                    { rc = -10; goto on_return; });
+    master = pjmedia_conf_get_master_port(conf);
+
+    for (i = 0; i < PORT_CNT; ++i) {
+        PJ_TEST_SUCCESS(add_member(pool, conf, i, signals[i], &members[i]),
+                        NULL, { rc = -11; goto on_return; });
+        total += signals[i];
+    }
+
+    for (i = 0; i < PORT_CNT; ++i) {
+        for (j = 0; j < PORT_CNT; ++j) {
+            if (i == j)
+                continue;
+            PJ_TEST_SUCCESS(pjmedia_conf_connect_port(conf, members[i]->slot,
+                                                      members[j]->slot, 0),
+                            NULL, { rc = -12; goto on_return; });
+        }
+    }
+
+    rc = run_frames(master, buf);
+    if (rc != 0) {
+        rc -= 20;
+        goto on_return;
+    }
+
+    for (i = 0; i < PORT_CNT; ++i) {
+        pj_int32_t expected;
+
+        if (max_speakers == 0)
+            expected = total - signals[i];
+        else if (i < 2)
+            expected = signals[0] + signals[1] - signals[i];
+        else
+            expected = signals[0] + signals[1];
+
+        rc = check_member(members[i], expected);
+        if (rc != 0) {
+            PJ_LOG(3,(THIS_FILE, "  member%d: got %d, expecting %d",
+                      i, members[i]->last_frame[0], expected));
+            rc -= 30;
+            goto on_return;
+        }
+    }
+
+    /* Halve the loudest member for the third one only. In active speaker
+     * mode this makes the third member mix the speakers itself instead of
+     * taking them from the shared bus.
+     */
+    PJ_TEST_SUCCESS(pjmedia_conf_adjust_conn_level(conf, members[0]->slot,
+                                                   members[2]->slot, -64),
+                    NULL, { rc = -40; goto on_return; });
+
+    rc = run_frames(master, buf);
+    if (rc != 0) {
+        rc -= 50;
+        goto on_return;
+    }
+
+    for (i = 0; i < PORT_CNT; ++i) {
+        pj_int32_t expected;
+
+        if (max_speakers == 0)
+            expected = total - signals[i];
+        else if (i < 2)
+            expected = signals[0] + signals[1] - signals[i];
+        else
+            expected = signals[0] + signals[1];
+
+        if (i == 2)
+            expected -= signals[0] / 2;
+
+        rc = check_member(members[i], expected);
+        if (rc != 0) {
+            PJ_LOG(3,(THIS_FILE, "  member%d: got %d, expecting %d",
+                      i, members[i]->last_frame[0], expected));
+            rc -= 60;
+            goto on_return;
+        }
+    }
+
+on_return:
+    if (conf)
+        pjmedia_conf_destroy(conf);
+    pj_pool_release(pool);
+    return rc;
+}
+
+/* Two talkers broadcast to a number of passive listeners. The listeners
+ * with the same connections share one mix, so they are given the very same
+ * frame buffer, while the listener that hears the first talker at half
+ * level gets its own mix.
+ */
+#define TALKER_CNT      2
+#define LISTENER_CNT    4
+
+static int conf_fanout_test(unsigned max_speakers)
+{
+    pj_pool_t *pool;
+    pjmedia_conf_param param;
+    pjmedia_conf *conf = NULL;
+    pjmedia_port *master;
+    struct member *talkers[TALKER_CNT];
+    struct member *listeners[LISTENER_CNT];
+    pj_int16_t buf[SPF];
+    unsigned i, j;
+    int rc = 0;
+
+    pool = pj_pool_create(mem, "conffanout", 4000, 4000, NULL);
+
+    pjmedia_conf_param_default(&param);
+    param.max_slots = TALKER_CNT + LISTENER_CNT + 1;
+    param.sampling_rate = CLOCK_RATE;
+    param.channel_count = 1;
+    param.samples_per_frame = SPF;
+    param.bits_per_sample = 16;
+    param.options = PJMEDIA_CONF_NO_DEVICE | PJMEDIA_CONF_FANOUT;
+    param.max_speakers = max_speakers;
+
+    PJ_TEST_SUCCESS(pjmedia_conf_create2(pool, &param, &conf), NULL,
+                    { rc = -10; goto on_return; });
+    master = pjmedia_conf_get_master_port(conf);
+
+    for (i = 0; i < TALKER_CNT; ++i) {
+        PJ_TEST_SUCCESS(add_member(pool, conf, i, signals[i], &talkers[i]),
+                        NULL, { rc = -11; goto on_return; });
+    }
+    for (i = 0; i < LISTENER_CNT; ++i) {
+        PJ_TEST_SUCCESS(add_member(pool, conf, TALKER_CNT + i, 0,
+                                   &listeners[i]),
+                        NULL, { rc = -12; goto on_return; });
+    }
+
+    for (i = 0; i < TALKER_CNT; ++i) {
+        for (j = 0; j < LISTENER_CNT; ++j) {
+            int adj = (i == 0 && j == LISTENER_CNT - 1) ? -64 : 0;
+
+            PJ_TEST_SUCCESS(pjmedia_conf_connect_port(conf, talkers[i]->slot,
+                                                      listeners[j]->slot,
+                                                      adj),
+                            NULL, { rc = -13; goto on_return; });
+        }
+    }
+
+    rc = run_frames(master, buf);
+    if (rc != 0) {
+        rc -= 20;
+        goto on_return;
+    }
+
+    for (j = 0; j < LISTENER_CNT; ++j) {
+        pj_int32_t expected = signals[0] + signals[1];
+
+        if (j == LISTENER_CNT - 1)
+            expected -= signals[0] / 2;
+
+        rc = check_member(listeners[j], expected);
+        if (rc != 0) {
+            PJ_LOG(3,(THIS_FILE, "  listener%d: got %d, expecting %d",
+                      j, listeners[j]->last_frame[0], expected));
+            rc -= 30;
+            goto on_return;
+        }
+    }
+
+    for (j = 1; j < LISTENER_CNT - 1; ++j) {
+        PJ_TEST_EQ(listeners[j]->last_buf, listeners[0]->last_buf, NULL,
+                   { rc = -40; goto on_return; });
+    }
+    PJ_TEST_TRUE(listeners[LISTENER_CNT-1]->last_buf !=
+                 listeners[0]->last_buf, NULL,
+                 { rc = -41; goto on_return; });
+
+    /* The second listener stops hearing the second talker, so it has to
+     * leave the group.
+     */
+    PJ_TEST_SUCCESS(pjmedia_conf_disconnect_port(conf, talkers[1]->slot,
+                                                 listeners[1]->slot),
+                    NULL, { rc = -50; goto on_return; });
+
+    rc = run_frames(master, buf);
+    if (rc != 0) {
+        rc -= 60;
+        goto on_return;
+    }
+
+    rc = check_member(listeners[0], signals[0] + signals[1]);
+    if (rc == 0)
+        rc = check_member(listeners[1], signals[0]);
+    if (rc == 0)
+        rc = check_member(listeners[2], signals[0] + signals[1]);
+    if (rc != 0) {
+        rc -= 70;
+        goto on_return;
+    }
+    PJ_TEST_EQ(listeners[2]->last_buf, listeners[0]->last_buf, NULL,
+               { rc = -80; goto on_return; });
+    PJ_TEST_TRUE(listeners[1]->last_buf != listeners[0]->last_buf, NULL,
+                 { rc = -81; goto on_return; });
+
+on_return:
+    if (conf)
+        pjmedia_conf_destroy(conf);
+    pj_pool_release(pool);
+    return rc;
+}
+
+int conf_test(void)
+{
+    int rc;
+
+    PJ_LOG(3,(THIS_FILE, "  mixing all ports"));
+    rc = conf_mix_test(0);
+    if (rc != 0)
+        return rc - 100;
+
+    PJ_LOG(3,(THIS_FILE, "  mixing active speakers"));
+    rc = conf_mix_test(2);
+    if (rc != 0)
+        return rc - 200;
+
+    PJ_LOG(3,(THIS_FILE, "  sharing the mix of identical listeners"));
+    rc = conf_fanout_test(0);
+    if (rc != 0)
+        return rc - 300;
+
+    rc = conf_fanout_test(2);
+    if (rc != 0)
+        return rc - 400;
+
+    return 0;
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2025 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+#include <pjmedia/alaw_ulaw.h>
+#include <pj/rand.h>
+
+#define THIS_FILE   "g711_test.c"
+
+/* Long enough for the 32 samples AVX2 loop, the 16 samples loop and the
+ * scalar tail. The counts are tried from 0 up to MAX_COUNT.
+ */
+#define MAX_COUNT   71
+#define ROUNDS      20
+
+/* Every 16bit value, and every 8bit code twice */
+#define PCM_COUNT   65536
+#define CODE_COUNT  512
+
+static pj_int16_t pcm[PCM_COUNT];
+static pj_int16_t pcm_out[PCM_COUNT];
+static pj_uint8_t enc[PCM_COUNT];
+
+/* Compare the bulk functions over all inputs against the per-sample
+ * conversion.
+ */
+static int check_all_values(void)
+{
+    pj_uint8_t codes[CODE_COUNT], out[CODE_COUNT];
+    unsigned i;
+
+    for (i = 0; i < PCM_COUNT; ++i)
+        pcm[i] = (pj_int16_t)(i - 32768);
+    for (i = 0; i < CODE_COUNT; ++i)
+        codes[i] = (pj_uint8_t)i;
+
+    pjmedia_ulaw_encode(enc, pcm, PCM_COUNT);
+    for (i = 0; i < PCM_COUNT; ++i)
+        PJ_TEST_EQ(enc[i], pjmedia_linear2ulaw(pcm[i]), NULL, return -10);
+
+    pjmedia_alaw_encode(enc, pcm, PCM_COUNT);
+    for (i = 0; i < PCM_COUNT; ++i)
+        PJ_TEST_EQ(enc[i], pjmedia_linear2alaw(pcm[i]), NULL, return -11);
+
+    pjmedia_ulaw_decode(pcm_out, codes, CODE_COUNT);
+    for (i = 0; i < CODE_COUNT; ++i)
+        PJ_TEST_EQ(pcm_out[i], (pj_int16_t)pjmedia_ulaw2linear(codes[i]),
+                   NULL, return -12);
+
+    pjmedia_alaw_decode(pcm_out, codes, CODE_COUNT);
+    for (i = 0; i < CODE_COUNT; ++i)
+        PJ_TEST_EQ(pcm_out[i], (pj_int16_t)pjmedia_alaw2linear(codes[i]),
+                   NULL, return -13);
+
+    pjmedia_alaw_to_ulaw(out, codes, CODE_COUNT);
+    for (i = 0; i < CODE_COUNT; ++i)
+        PJ_TEST_EQ(out[i], pjmedia_alaw2ulaw(codes[i]), NULL, return -14);
+
+    pjmedia_ulaw_to_alaw(out, codes, CODE_COUNT);
+    for (i = 0; i < CODE_COUNT; ++i)
+        PJ_TEST_EQ(out[i], pjmedia_ulaw2alaw(codes[i]), NULL, return -15);
+
+#if defined(PJMEDIA_HAS_ALAW_ULAW_TABLE) && PJMEDIA_HAS_ALAW_ULAW_TABLE!=0
+    /* The transcoding tables must match decoding and encoding again */
+    for (i = 0; i < 256; ++i) {
+        PJ_TEST_EQ(pjmedia_alaw2ulaw(i),
+                   pjmedia_linear2ulaw(pjmedia_alaw2linear(i)),
+                   NULL, return -16);
+        PJ_TEST_EQ(pjmedia_ulaw2alaw(i),
+                   pjmedia_linear2alaw(pjmedia_ulaw2linear(i)),
+                   NULL, return -17);
+    }
+#endif
+
+    return 0;
+}
+
+/* Short and unaligned buffers, checking that nothing is written past
+ * the end.
+ */
+static int check_lengths(void)
+{
+    pj_int16_t src16[MAX_COUNT + 1], dst16[MAX_COUNT + 2];
+    pj_uint8_t src8[MAX_COUNT + 1], dst8[MAX_COUNT + 2];
+    unsigned round, count, i;
+
+    for (round = 0; round < ROUNDS; ++round) {
+        for (count = 0; count <= MAX_COUNT; ++count) {
+            for (i = 0; i <= count; ++i) {
+                src16[i] = (pj_int16_t)pj_rand();
+                src8[i] = (pj_uint8_t)pj_rand();
+            }
+
+            dst8[count + 1] = 0xA5;
+            pjmedia_ulaw_encode(dst8 + 1, src16 + 1, count);
+            for (i = 0; i < count; ++i)
+                PJ_TEST_EQ(dst8[i + 1], pjmedia_linear2ulaw(src16[i + 1]),
+                           NULL, return -20);
+            PJ_TEST_EQ(dst8[count + 1], 0xA5, NULL, return -21);
+
+            pjmedia_alaw_encode(dst8 + 1, src16 + 1, count);
+            for (i = 0; i < count; ++i)
+                PJ_TEST_EQ(dst8[i + 1], pjmedia_linear2alaw(src16[i + 1]),
+                           NULL, return -22);
+            PJ_TEST_EQ(dst8[count + 1], 0xA5, NULL, return -23);
+
+            dst16[count + 1] = 0x5A5A;
+            pjmedia_ulaw_decode(dst16 + 1, src8 + 1, count);
+            for (i = 0; i < count; ++i)
+                PJ_TEST_EQ(dst16[i + 1],
+                           (pj_int16_t)pjmedia_ulaw2linear(src8[i + 1]),
+                           NULL, return -24);
+            PJ_TEST_EQ(dst16[count + 1], 0x5A5A, NULL, return -25);
+
+            pjmedia_alaw_decode(dst16 + 1, src8 + 1, count);
+            for (i = 0; i < count; ++i)
+                PJ_TEST_EQ(dst16[i + 1],
+                           (pj_int16_t)pjmedia_alaw2linear(src8[i + 1]),
+                           NULL, return -26);
+            PJ_TEST_EQ(dst16[count + 1], 0x5A5A, NULL, return -27);
+
+            pjmedia_alaw_to_ulaw(dst8 + 1, src8 + 1, count);
+            for (i = 0; i < count; ++i)
+                PJ_TEST_EQ(dst8[i + 1], pjmedia_alaw2ulaw(src8[i + 1]),
+                           NULL, return -28);
+            PJ_TEST_EQ(dst8[count + 1], 0xA5, NULL, return -29);
+        }
+    }
+
+    return 0;
+}
+
+static int check_impl(void)
+{
+    int rc;
+
+    rc = check_all_values();
+    if (rc != 0)
+        return rc;
+
+    return check_lengths();
+}
+
+int g711_test(void)
+{
+    const char *names[8];
+    unsigned i, count = PJ_ARRAY_SIZE(names);
+    int rc = 0;
+
+    /* Every implementation the CPU can run, not only the best one */
+    PJ_TEST_SUCCESS(pjmedia_g711_enum_impl(&count, names), NULL, return -1);
+    PJ_TEST_GT(count, 0, NULL, return -2);
+
+    for (i = 0; i < count; ++i) {
+        PJ_TEST_SUCCESS(pjmedia_g711_set_impl(names[i]), NULL,
+                        {rc = -3; break;});
+        PJ_LOG(3,(THIS_FILE, "  testing %s implementation", names[i]));
+        rc = check_impl();
+        if (rc != 0) {
+            rc -= 100 * i;
+            break;
+        }
+    }
+
+    pjmedia_g711_set_impl(names[0]);
+    return rc;
+}
@@ -854,6 +854,48 @@ static pjmedia_port* g711_encode_decode(  pj_pool_t *pool,
                                clock_rate, channel_count,
                                samples_per_frame, flags, te);
 }
+
+static pjmedia_port* g711a_encode_decode( pj_pool_t *pool,
+                                          unsigned clock_rate,
+                                          unsigned channel_count,
+                                          unsigned samples_per_frame,
+                                          unsigned flags,
+                                          struct test_entry *te)
+{
+    return codec_encode_decode(pool, "pcma", &pjmedia_codec_g711_init, 
+                               &pjmedia_codec_g711_deinit,
+                               clock_rate, channel_count,
+                               samples_per_frame, flags, te);
+}
+
+/* G.711 with the portable C companding, to compare with the SIMD one */
+static void g711_c_custom_deinit(struct test_entry *te)
+{
+    pjmedia_port_destroy((pjmedia_port*)te->pdata[0]);
+    pjmedia_g711_enable_simd(PJ_TRUE);
+}
+
+static pjmedia_port* g711_c_encode_decode(pj_pool_t *pool,
+                                          unsigned clock_rate,
+                                          unsigned channel_count,
+                                          unsigned samples_per_frame,
+                                          unsigned flags,
+                                          struct test_entry *te)
+{
+    pjmedia_port *port;
+
+    pjmedia_g711_enable_simd(PJ_FALSE);
+    port = g711_encode_decode(pool, clock_rate, channel_count,
+                              samples_per_frame, flags, te);
+    if (!port) {
+        pjmedia_g711_enable_simd(PJ_TRUE);
+        return NULL;
+    }
+
+    te->pdata[0] = port;
+    te->custom_deinit = &g711_c_custom_deinit;
+    return port;
+}
 #endif
 
 /* GSM benchmark */
@@ -2507,6 +2549,8 @@ int mips_test(void)
         { "tone generator with dual freq", OP_GET, K8|K16, &create_tonegen2},
 #if PJMEDIA_HAS_G711_CODEC
         { "codec encode/decode - G.711", OP_PUT, K8, &g711_encode_decode},
+        { "codec encode/decode - G.711 (C)", OP_PUT, K8, &g711_c_encode_decode},
+        { "codec encode/decode - G.711 A-law", OP_PUT, K8, &g711a_encode_decode},
 #endif
 #if PJMEDIA_HAS_G722_CODEC
         { "codec encode/decode - G.722", OP_PUT, K16, &g722_encode_decode},
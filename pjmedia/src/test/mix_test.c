@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2025 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+#include <pjmedia/mix.h>
+#include <pj/os.h>
+#include <pj/rand.h>
+
+#define THIS_FILE   "mix_test.c"
+
+/* Long enough for the 16 samples SIMD loop, the 8 samples loop and the
+ * scalar tail. The counts are tried from 0 up to MAX_COUNT.
+ */
+#define MAX_COUNT   53
+#define ROUNDS      20
+
+static const unsigned adj_levels[] = { 0, 1, 64, 127, 129, 200, 255,
+                                       1000, 40000 };
+
+/* Random samples, with some full scale values to exercise saturation */
+static void fill_samples(pj_int16_t *buf, unsigned count)
+{
+    unsigned i;
+
+    for (i = 0; i < count; ++i) {
+        switch (pj_rand() % 8) {
+        case 0:  buf[i] = -32768; break;
+        case 1:  buf[i] = 32767; break;
+        default: buf[i] = (pj_int16_t)pj_rand(); break;
+        }
+    }
+}
+
+static pj_int16_t clip16(pj_int32_t v)
+{
+    return (pj_int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+}
+
+static pj_uint32_t ref_level(const pj_int16_t *buf, unsigned count)
+{
+    pj_uint32_t level = 0;
+    unsigned i;
+
+    for (i = 0; i < count; ++i)
+        level += (buf[i] >= 0 ? buf[i] : -buf[i]);
+    return level;
+}
+
+static int check_kernels(void)
+{
+    pj_int16_t src[MAX_COUNT], dst[MAX_COUNT], exp16[MAX_COUNT];
+    pj_int32_t mix_buf[MAX_COUNT], exp32[MAX_COUNT];
+    pj_int32_t mix_copy[MAX_COUNT];
+    unsigned round, count, a, i;
+
+    for (round = 0; round < ROUNDS; ++round) {
+        for (count = 0; count <= MAX_COUNT; ++count) {
+            pj_int32_t mn, mx, exp_mn, exp_mx;
+
+            fill_samples(src, count);
+
+            /* Level */
+            PJ_TEST_EQ(pjmedia_mix_level(src, count),
+                       ref_level(src, count), NULL, return -10);
+
+            /* Adjust, both to another buffer and in place */
+            for (a = 0; a < PJ_ARRAY_SIZE(adj_levels); ++a) {
+                unsigned adj = adj_levels[a];
+                pj_uint32_t level;
+
+                for (i = 0; i < count; ++i)
+                    exp16[i] = clip16((pj_int32_t)src[i] * (pj_int32_t)adj
+                                      >> 7);
+
+                level = pjmedia_mix_adjust(dst, src, count, adj);
+                PJ_TEST_EQ(level, ref_level(exp16, count), NULL, return -20);
+                PJ_TEST_EQ(pj_memcmp(dst, exp16, count * 2), 0, NULL,
+                           return -21);
+
+                pj_memcpy(dst, src, count * 2);
+                pjmedia_mix_adjust(dst, dst, count, adj);
+                PJ_TEST_EQ(pj_memcmp(dst, exp16, count * 2), 0, NULL,
+                           return -22);
+            }
+
+            /* Copy and add */
+            pjmedia_mix_copy(mix_buf, src, count);
+            for (i = 0; i < count; ++i)
+                PJ_TEST_EQ(mix_buf[i], src[i], NULL, return -30);
+
+            fill_samples(src, count);
+            exp_mn = exp_mx = 0;
+            for (i = 0; i < count; ++i) {
+                exp32[i] = mix_buf[i] + src[i];
+                if (exp32[i] < exp_mn) exp_mn = exp32[i];
+                if (exp32[i] > exp_mx) exp_mx = exp32[i];
+            }
+            pjmedia_mix_add(mix_buf, src, count, &mn, &mx);
+            PJ_TEST_EQ(pj_memcmp(mix_buf, exp32, count * 4), 0, NULL,
+                       return -31);
+            PJ_TEST_EQ(mn, exp_mn, NULL, return -32);
+            PJ_TEST_EQ(mx, exp_mx, NULL, return -33);
+
+            /* Subtracting the same samples gives back the first frame */
+            pj_memcpy(mix_copy, mix_buf, count * 4);
+            exp_mn = exp_mx = 0;
+            for (i = 0; i < count; ++i) {
+                exp32[i] = mix_copy[i] - src[i];
+                if (exp32[i] < exp_mn) exp_mn = exp32[i];
+                if (exp32[i] > exp_mx) exp_mx = exp32[i];
+            }
+            pjmedia_mix_sub(mix_buf, src, count, &mn, &mx);
+            PJ_TEST_EQ(pj_memcmp(mix_buf, exp32, count * 4), 0, NULL,
+                       return -34);
+            PJ_TEST_EQ(mn, exp_mn, NULL, return -35);
+            PJ_TEST_EQ(mx, exp_mx, NULL, return -36);
+
+            /* Clamp, to another buffer and in place over the mixing
+             * buffer as the conference bridge does.
+             */
+            for (i = 0; i < count; ++i)
+                mix_buf[i] *= (pj_rand() % 4) + 1;
+            pj_memcpy(mix_copy, mix_buf, count * 4);
+
+            for (a = 0; a < PJ_ARRAY_SIZE(adj_levels); ++a) {
+                unsigned adj = adj_levels[a];
+                pj_uint32_t level;
+
+                if (adj > 255)
+                    continue;
+
+                for (i = 0; i < count; ++i) {
+                    exp16[i] = clip16(adj == 128 ? mix_copy[i] :
+                                      mix_copy[i] * (pj_int32_t)adj >> 7);
+                }
+
+                level = pjmedia_mix_clamp(dst, mix_copy, count, adj);
+                PJ_TEST_EQ(level, ref_level(exp16, count), NULL, return -40);
+                PJ_TEST_EQ(pj_memcmp(dst, exp16, count * 2), 0, NULL,
+                           return -41);
+
+                pj_memcpy(mix_buf, mix_copy, count * 4);
+                pjmedia_mix_clamp((pj_int16_t*)mix_buf, mix_buf, count, adj);
+                PJ_TEST_EQ(pj_memcmp(mix_buf, exp16, count * 2), 0, NULL,
+                           return -42);
+            }
+        }
+    }
+
+    return 0;
+}
+
+int mix_test(void)
+{
+    const char *names[8];
+    unsigned i, count = PJ_ARRAY_SIZE(names);
+    int rc = 0;
+
+    /* Every implementation the CPU can run, not only the best one */
+    PJ_TEST_SUCCESS(pjmedia_mix_enum_impl(&count, names), NULL, return -1);
+    PJ_TEST_GT(count, 0, NULL, return -2);
+
+    for (i = 0; i < count; ++i) {
+        PJ_TEST_SUCCESS(pjmedia_mix_set_impl(names[i]), NULL,
+                        {rc = -3; break;});
+        PJ_LOG(3,(THIS_FILE, "  testing %s implementation", names[i]));
+        rc = check_kernels();
+        if (rc != 0) {
+            rc -= 100 * i;
+            break;
+        }
+    }
+
+    pjmedia_mix_set_impl(names[0]);
+    return rc;
+}
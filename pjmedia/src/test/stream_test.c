@@ -0,0 +1,378 @@
+/*
+ * Copyright (C) 2025 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+#define THIS_FILE       "stream_test.c"
+
+#define SPF             160
+#define AUDIO_CNT       20
+#define DTMF_PT         101
+#define DTMF_DIGIT      5
+#define CNAME           "stream-test"
+
+/* Position of the DTMF and RTCP packets in the burst, i.e. after that
+ * many audio packets. They are sent in the middle of a batch of
+ * PJMEDIA_TRANSPORT_UDP_RX_BATCH packets, so that the stream has to
+ * release the jitter buffer lock and take it again for the next packets.
+ */
+#define DTMF_POS        5
+#define RTCP_POS        12
+
+struct stream_test
+{
+    pj_pool_t          *pool;
+    pjmedia_stream     *strm;
+    pj_sem_t           *sem;
+    pj_thread_t        *thread;
+    unsigned            dtmf_cnt;
+    char                dtmf_digit;
+    unsigned            dtmf_jb_size;
+    pj_bool_t           dtmf_unlocked;
+};
+
+/* Take the jitter buffer lock, which pjmedia_stream_get_dtmf() uses */
+static int lock_jb_thread(void *arg)
+{
+    struct stream_test *test = (struct stream_test*)arg;
+    char digits[4];
+    unsigned cnt = PJ_ARRAY_SIZE(digits);
+
+    pjmedia_stream_get_dtmf(test->strm, digits, &cnt);
+    pj_sem_post(test->sem);
+    return 0;
+}
+
+static void on_dtmf(pjmedia_stream *strm, void *user_data, int digit)
+{
+    struct stream_test *test = (struct stream_test*)user_data;
+    pjmedia_jb_state jb_state;
+    unsigned i;
+
+    /* The audio packets received before the DTMF packet must be in the
+     * jitter buffer by now.
+     */
+    pjmedia_stream_get_stat_jbuf(strm, &jb_state);
+    test->dtmf_jb_size = jb_state.size;
+    test->dtmf_digit = (char)digit;
+    ++test->dtmf_cnt;
+
+    /* The jitter buffer lock must not be held during the callback. Check
+     * it from another thread, so that the test fails instead of
+     * deadlocking if it is.
+     */
+    if (test->thread ||
+        pj_thread_create(test->pool, "jblock", &lock_jb_thread, test, 0, 0,
+                         &test->thread) != PJ_SUCCESS)
+    {
+        return;
+    }
+    for (i = 0; i < 100 && !test->dtmf_unlocked; ++i) {
+        if (pj_sem_trywait(test->sem) == PJ_SUCCESS)
+            test->dtmf_unlocked = PJ_TRUE;
+        else
+            pj_thread_sleep(10);
+    }
+}
+
+/* The PCMU byte of the payload of the n-th audio packet */
+static pj_uint8_t audio_payload(unsigned n)
+{
+    return pjmedia_linear2ulaw((n + 1) * 1000);
+}
+
+static int send_pkt(pj_sock_t sock, const pj_sockaddr *dst,
+                    const void *pkt, pj_ssize_t len)
+{
+    pj_ssize_t sent = len;
+
+    PJ_TEST_SUCCESS(pj_sock_sendto(sock, pkt, &sent, 0, dst,
+                                   pj_sockaddr_get_len(dst)),
+                    NULL, return -10);
+    PJ_TEST_EQ(sent, len, NULL, return -11);
+    return 0;
+}
+
+/* Send the audio packets with a DTMF event and a multiplexed RTCP SR+SDES
+ * in between, all at once.
+ */
+static int send_burst(pj_sock_t sock, const pj_sockaddr *dst)
+{
+    pjmedia_rtp_session rtp;
+    pjmedia_rtcp_session rtcp;
+    pjmedia_rtcp_sdes sdes;
+    pj_uint8_t pkt[PJMEDIA_MAX_MTU];
+    const void *hdr;
+    int hdrlen;
+    unsigned i;
+    int rc;
+
+    pjmedia_rtp_session_init(&rtp, 0, 0x1234);
+    pjmedia_rtcp_init(&rtcp, "rtcp", 8000, SPF, 0x1234);
+
+    for (i = 0; i < AUDIO_CNT; ++i) {
+        if (i == DTMF_POS) {
+            pjmedia_rtp_dtmf_event *ev;
+
+            pjmedia_rtp_encode_rtp(&rtp, DTMF_PT, 1, 4, 0, &hdr, &hdrlen);
+            pj_memcpy(pkt, hdr, hdrlen);
+            ev = (pjmedia_rtp_dtmf_event*)(pkt + hdrlen);
+            ev->event = DTMF_DIGIT;
+            ev->e_vol = PJMEDIA_RTP_DTMF_EVENT_END_MASK | 10;
+            ev->duration = pj_htons(SPF);
+            rc = send_pkt(sock, dst, pkt, hdrlen + 4);
+            if (rc != 0)
+                return rc;
+        }
+
+        if (i == RTCP_POS) {
+            void *sr;
+            int len;
+            pj_size_t sdes_len;
+
+            pjmedia_rtcp_build_rtcp(&rtcp, &sr, &len);
+            pj_memcpy(pkt, sr, len);
+
+            pj_bzero(&sdes, sizeof(sdes));
+            sdes.cname = pj_str(CNAME);
+            sdes_len = sizeof(pkt) - len;
+            PJ_TEST_SUCCESS(pjmedia_rtcp_build_rtcp_sdes(&rtcp, pkt + len,
+                                                         &sdes_len, &sdes),
+                            NULL, return -20);
+            rc = send_pkt(sock, dst, pkt, len + sdes_len);
+            if (rc != 0)
+                return rc;
+        }
+
+        pjmedia_rtp_encode_rtp(&rtp, 0, 0, SPF, SPF, &hdr, &hdrlen);
+        pj_memcpy(pkt, hdr, hdrlen);
+        pj_memset(pkt + hdrlen, audio_payload(i), SPF);
+        rc = send_pkt(sock, dst, pkt, hdrlen + SPF);
+        if (rc != 0)
+            return rc;
+    }
+
+    return 0;
+}
+
+static pj_status_t create_transport(pjmedia_endpt *endpt,
+                                    pjmedia_transport **p_tp)
+{
+    pj_uint16_t port = (pj_uint16_t)(40000 + (pj_rand() % 5000) * 2);
+    pj_status_t status = PJ_EUNKNOWN;
+    unsigned i;
+
+    for (i = 0; i < 10 && status != PJ_SUCCESS; ++i, port += 2) {
+        status = pjmedia_transport_udp_create(endpt, "stream-test", port,
+                                              0, p_tp);
+    }
+    return status;
+}
+
+int stream_test(void)
+{
+    struct stream_test test;
+    pjmedia_endpt *endpt = NULL;
+    pjmedia_transport *tp = NULL;
+    pjmedia_transport_info tpinfo;
+    pj_pool_t *pool = NULL;
+    pj_sock_t sock = PJ_INVALID_SOCKET;
+    pj_str_t loopback = { "127.0.0.1", 9 };
+    pj_sockaddr addr, dst;
+    int addr_len;
+    pjmedia_stream_info si;
+    const pjmedia_codec_info *ci;
+    pjmedia_codec_param param;
+    pjmedia_port *port;
+    pjmedia_rtcp_stat stat;
+    pjmedia_jb_state jb_state;
+    pj_time_val timeout;
+    pj_int16_t samples[SPF];
+    unsigned spf, frm_per_pkt;
+    unsigned i, j;
+    int rc = 0;
+
+    pj_bzero(&test, sizeof(test));
+
+    PJ_TEST_SUCCESS(pjmedia_endpt_create(mem, NULL, 0, &endpt), NULL,
+                    return -100);
+    pool = pjmedia_endpt_create_pool(endpt, "stream-test", 4000, 4000);
+    test.pool = pool;
+    PJ_TEST_SUCCESS(pj_sem_create(pool, "stream-test", 0, 1, &test.sem),
+                    NULL, {rc = -105; goto on_return;});
+    PJ_TEST_SUCCESS(pjmedia_codec_g711_init(endpt), NULL,
+                    {rc = -110; goto on_return;});
+    PJ_TEST_SUCCESS(create_transport(endpt, &tp), NULL,
+                    {rc = -120; goto on_return;});
+
+    /* The "remote" endpoint, which sends everything from one socket */
+    PJ_TEST_SUCCESS(pj_sock_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0, &sock),
+                    NULL, {rc = -130; goto on_return;});
+    pj_sockaddr_init(pj_AF_INET(), &addr, &loopback, 0);
+    PJ_TEST_SUCCESS(pj_sock_bind(sock, &addr, pj_sockaddr_get_len(&addr)),
+                    NULL, {rc = -131; goto on_return;});
+    addr_len = sizeof(addr);
+    PJ_TEST_SUCCESS(pj_sock_getsockname(sock, &addr, &addr_len), NULL,
+                    {rc = -132; goto on_return;});
+
+    pjmedia_transport_info_init(&tpinfo);
+    PJ_TEST_SUCCESS(pjmedia_transport_get_info(tp, &tpinfo), NULL,
+                    {rc = -133; goto on_return;});
+    pj_sockaddr_init(pj_AF_INET(), &dst, &loopback,
+                     pj_sockaddr_get_port(&tpinfo.sock_info.rtp_addr_name));
+
+    /* PCMU stream with RTCP multiplexing. Decoding only streams send
+     * RTCP from the RTP callback, which releases the jitter buffer lock
+     * after each packet, so use both directions to keep it for the batch.
+     */
+    pj_bzero(&si, sizeof(si));
+    si.type = PJMEDIA_TYPE_AUDIO;
+    si.proto = PJMEDIA_TP_PROTO_RTP_AVP;
+    si.dir = PJMEDIA_DIR_ENCODING_DECODING;
+    PJ_TEST_SUCCESS(pjmedia_codec_mgr_get_codec_info(
+                        pjmedia_endpt_get_codec_mgr(endpt), 0, &ci),
+                    NULL, {rc = -140; goto on_return;});
+    si.fmt = *ci;
+
+    /* The codec splits the packets into frames of frm_ptime in the jitter
+     * buffer.
+     */
+    PJ_TEST_SUCCESS(pjmedia_codec_mgr_get_default_param(
+                        pjmedia_endpt_get_codec_mgr(endpt), ci, &param),
+                    NULL, {rc = -141; goto on_return;});
+    frm_per_pkt = SPF * 1000 / ci->clock_rate / param.info.frm_ptime;
+
+    /* PLC delays the decoded audio, which would complicate the check */
+    param.setting.plc = 0;
+    si.param = &param;
+    si.tx_pt = si.rx_pt = 0;
+    si.rx_event_pt = DTMF_PT;
+    si.tx_event_pt = -1;
+    si.ssrc = 0x5678;
+    si.jb_init = si.jb_min_pre = si.jb_max_pre = -1;
+    si.jb_max = AUDIO_CNT * 2 * 20;
+    si.jb_discard_algo = PJMEDIA_JB_DISCARD_NONE;
+    si.rtcp_mux = PJ_TRUE;
+    pj_sockaddr_cp(&si.rem_addr, &addr);
+    pj_sockaddr_cp(&si.rem_rtcp, &addr);
+
+    PJ_TEST_SUCCESS(pjmedia_stream_create(endpt, pool, &si, tp, NULL,
+                                          &test.strm),
+                    NULL, {rc = -150; goto on_return;});
+    PJ_TEST_SUCCESS(pjmedia_stream_set_dtmf_callback(test.strm, &on_dtmf,
+                                                     &test),
+                    NULL, {rc = -151; goto on_return;});
+    PJ_TEST_SUCCESS(pjmedia_transport_media_start(tp, pool, NULL, NULL, 0),
+                    NULL, {rc = -152; goto on_return;});
+    PJ_TEST_SUCCESS(pjmedia_stream_start(test.strm), NULL,
+                    {rc = -153; goto on_return;});
+
+    PJ_TEST_SUCCESS(pjmedia_stream_get_port(test.strm, &port), NULL,
+                    {rc = -154; goto on_return;});
+    spf = PJMEDIA_PIA_SPF(&port->info);
+
+    /* Get past the soft start, which resets the jitter buffer */
+    for (i = 0; i <= PJMEDIA_STREAM_SOFT_START; ++i) {
+        pjmedia_frame frame;
+
+        frame.buf = samples;
+        frame.size = spf * 2;
+        pjmedia_port_get_frame(port, &frame);
+    }
+
+    /* Send everything before polling, so the transport gets the packets
+     * in batches.
+     */
+    rc = send_burst(sock, &dst);
+    if (rc != 0)
+        goto on_return;
+
+    for (i = 0; i < 100; ++i) {
+        timeout.sec = 0;
+        timeout.msec = 10;
+        pj_ioqueue_poll(pjmedia_endpt_get_ioqueue(endpt), &timeout);
+
+        pjmedia_stream_get_stat(test.strm, &stat);
+        if (stat.rx.pkt == AUDIO_CNT + 1 && stat.peer_sdes.cname.slen)
+            break;
+    }
+
+    /* RX statistics count every RTP packet, and the RTCP one is not
+     * mistaken for RTP.
+     */
+    PJ_TEST_EQ(stat.rx.pkt, AUDIO_CNT + 1, NULL,
+               {rc = -200; goto on_return;});
+    PJ_TEST_EQ(stat.rx.bytes, AUDIO_CNT * SPF + 4, NULL,
+               {rc = -201; goto on_return;});
+    PJ_TEST_EQ(stat.rx.loss, 0, NULL, {rc = -202; goto on_return;});
+    PJ_TEST_EQ(stat.rx.reorder, 0, NULL, {rc = -203; goto on_return;});
+    PJ_TEST_EQ(stat.rx.dup, 0, NULL, {rc = -204; goto on_return;});
+    PJ_TEST_EQ(stat.rx.discard, 0, NULL, {rc = -205; goto on_return;});
+    PJ_TEST_EQ(pj_strcmp2(&stat.peer_sdes.cname, CNAME), 0, NULL,
+               {rc = -206; goto on_return;});
+
+    /* The DTMF event is reported once, outside the jitter buffer lock */
+    PJ_TEST_EQ(test.dtmf_cnt, 1, NULL, {rc = -210; goto on_return;});
+    PJ_TEST_EQ(test.dtmf_digit, '0' + DTMF_DIGIT, NULL,
+               {rc = -211; goto on_return;});
+    PJ_TEST_EQ(test.dtmf_jb_size, DTMF_POS * frm_per_pkt, NULL,
+               {rc = -212; goto on_return;});
+    PJ_TEST_TRUE(test.dtmf_unlocked, NULL, {rc = -213; goto on_return;});
+
+    /* Every audio packet is in the jitter buffer, in order */
+    PJ_TEST_SUCCESS(pjmedia_stream_get_stat_jbuf(test.strm, &jb_state), NULL,
+                    {rc = -220; goto on_return;});
+    PJ_TEST_EQ(jb_state.size, AUDIO_CNT * frm_per_pkt, NULL,
+               {rc = -221; goto on_return;});
+    PJ_TEST_EQ(jb_state.discard, 0, NULL, {rc = -222; goto on_return;});
+
+    for (i = 0; i < AUDIO_CNT * SPF / spf; ++i) {
+        pjmedia_frame frame;
+        pj_int16_t expected = (pj_int16_t)
+                              pjmedia_ulaw2linear(audio_payload(i * spf / SPF));
+
+        frame.buf = samples;
+        frame.size = spf * 2;
+        PJ_TEST_SUCCESS(pjmedia_port_get_frame(port, &frame), NULL,
+                        {rc = -231; goto on_return;});
+        PJ_TEST_EQ(frame.type, PJMEDIA_FRAME_TYPE_AUDIO, NULL,
+                   {rc = -232; goto on_return;});
+        for (j = 0; j < spf; ++j) {
+            PJ_TEST_EQ(samples[j], expected, NULL,
+                       {rc = -233; goto on_return;});
+        }
+    }
+
+on_return:
+    if (test.thread) {
+        pj_thread_join(test.thread);
+        pj_thread_destroy(test.thread);
+    }
+    if (test.sem)
+        pj_sem_destroy(test.sem);
+    if (test.strm)
+        pjmedia_stream_destroy(test.strm);
+    if (tp)
+        pjmedia_transport_close(tp);
+    if (sock != PJ_INVALID_SOCKET)
+        pj_sock_close(sock);
+    if (pool)
+        pj_pool_release(pool);
+    if (endpt)
+        pjmedia_endpt_destroy(endpt);
+    return rc;
+}
@@ -108,6 +108,18 @@ int test_main(int argc, char *argv[])
 #if HAS_JBUF_TEST
     UT_ADD_TEST(&test_app.ut_app, jbuf_test, 0);
 #endif
+#if HAS_MIX_TEST
+    UT_ADD_TEST(&test_app.ut_app, mix_test, 0);
+#endif
+#if HAS_G711_TEST
+    UT_ADD_TEST(&test_app.ut_app, g711_test, 0);
+#endif
+#if HAS_CONF_TEST
+    UT_ADD_TEST(&test_app.ut_app, conf_test, 0);
+#endif
+#if HAS_STREAM_TEST
+    UT_ADD_TEST(&test_app.ut_app, stream_test, 0);
+#endif
 #if HAS_CODEC_VECTOR_TEST
     UT_ADD_TEST(&test_app.ut_app, codec_test_vectors, 0);
 #endif
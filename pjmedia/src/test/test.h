@@ -37,6 +37,10 @@
 #define HAS_JBUF_TEST           1
 #define HAS_MIPS_TEST           WITH_BENCHMARK
 #define HAS_CODEC_VECTOR_TEST   1
+#define HAS_MIX_TEST            1
+#define HAS_G711_TEST           1
+#define HAS_CONF_TEST           1
+#define HAS_STREAM_TEST         PJMEDIA_HAS_G711_CODEC
 
 int session_test(void);
 int rtp_test(void);
@@ -44,6 +48,10 @@ int sdp_test(void);
 int jbuf_test(void);
 int sdp_neg_test(void);
 int mips_test(void);
+int mix_test(void);
+int g711_test(void);
+int conf_test(void);
+int stream_test(void);
 int codec_test_vectors(void);
 int vid_codec_test(void);
 int vid_dev_test(void);
@@ -20,6 +20,7 @@ SAMPLES := auddemo \
 	   aviplay \
 	   aectest \
 	   clidemo \
+	   confbench \
 	   confsample \
 	   encdec \
 	   httpdemo \
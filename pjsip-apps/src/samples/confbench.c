@@ -21,8 +21,10 @@
 /**
  * \page page_pjmedia_samples_confbench_c Samples: Benchmarking Conference Bridge
  *
- * Benchmarking pjmedia (conference bridge+resample). For my use only,
- * and it only works in Win32.
+ * Benchmarking pjmedia (conference bridge+resample). The bridge is
+ * driven directly, as fast as possible, once with the portable C mixing
+ * kernels and once with the SIMD ones, and the average cost of a frame
+ * is reported in total, per port and per connection.
  *
  * This file is pjsip-apps/src/samples/confbench.c
  *
@@ -35,7 +37,6 @@
 #include <pjlib.h>
 #include <stdlib.h>     /* atoi() */
 #include <stdio.h>
-#include <windows.h>
 
 /* For logging purpose. */
 #define THIS_FILE   "confsample.c"
@@ -45,9 +46,12 @@
  *   LARGE_SET will create in total of about 232 ports.
  *   HAS_RESAMPLE will activate resampling on about half
  *     the port.
+ *   MAX_SPEAKERS limits the mixing to the loudest ports,
+ *     see pjmedia_conf_param.max_speakers.
  */
 #define TEST_SET            LARGE_SET
 #define HAS_RESAMPLE        0
+#define MAX_SPEAKERS        0
 
 
 #define SMALL_SET           16
@@ -63,7 +67,7 @@
 #  define SINE_CLOCK        CLOCK_RATE
 #endif
 #define SINE_PTIME          20
-#define DURATION            10
+#define FRAME_COUNT         2000
 
 #define SINE_COUNT          TEST_SET
 #define NULL_COUNT          TEST_SET
@@ -79,53 +83,45 @@ static void app_perror(const char *sender, const char *title, pj_status_t status
 }
 
 
-struct Times
-{
-    FILETIME        kernel_time;
-    ULARGE_INTEGER  u_kernel_time;
-    FILETIME        user_time;
-    ULARGE_INTEGER  u_user_time;
-    ULARGE_INTEGER  u_total;
-};
-
-static void process(struct Times *t)
-{
-    pj_memcpy(&t->u_kernel_time, &t->kernel_time, sizeof(FILETIME));
-    pj_memcpy(&t->u_user_time, &t->user_time, sizeof(FILETIME));
-    t->u_total.QuadPart = t->u_kernel_time.QuadPart + t->u_user_time.QuadPart;
-}
-
-static void benchmark(void)
+/*
+ * Drive the bridge for FRAME_COUNT frames with the mixing kernels
+ * selected by simd, and print the average cost.
+ */
+static void benchmark(pjmedia_port *conf_port, pj_bool_t simd,
+                      unsigned port_cnt, unsigned conn_cnt)
 {
-    FILETIME creation_time, exit_time;
-    struct Times start, end;
-    DWORD ts, te;
-    LARGE_INTEGER elapsed;
-    BOOL rc;
-    int i;
-    double pct;
-
-    puts("Test started!"); fflush(stdout);
+    pj_int16_t buf[SAMPLES_PER_FRAME];
+    pj_timestamp t0, t1;
+    double frame_usec, core_pct;
+    unsigned i;
 
-    ts = GetTickCount();
-    rc = GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time,
-                         &start.kernel_time, &start.user_time);
-    for (i=DURATION; i>0; --i) {
-        printf("\r%d ", i); fflush(stdout);
-        pj_thread_sleep(1000);
+    if (pjmedia_mix_enable_simd(simd) != PJ_SUCCESS) {
+        printf("No SIMD mixing kernels for this CPU\n");
+        return;
     }
-    rc = GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time,
-                         &end.kernel_time, &end.user_time);
-    te = GetTickCount();
-
-    process(&start);
-    process(&end);
 
-    elapsed.QuadPart = end.u_total.QuadPart - start.u_total.QuadPart;
+    pj_get_timestamp(&t0);
+    for (i=0; i<FRAME_COUNT; ++i) {
+        pjmedia_frame frame;
 
-    pct = elapsed.QuadPart * 100.0 / ((te-ts)*10000.0);
-
-    printf("CPU usage=%6.4f%%\n", pct); fflush(stdout);
+        frame.buf = buf;
+        frame.size = sizeof(buf);
+        frame.timestamp.u64 = (pj_uint64_t)i * SAMPLES_PER_FRAME;
+        frame.type = PJMEDIA_FRAME_TYPE_AUDIO;
+        pjmedia_port_get_frame(conf_port, &frame);
+    }
+    pj_get_timestamp(&t1);
+
+    frame_usec = pj_elapsed_usec(&t0, &t1) * 1.0 / FRAME_COUNT;
+    core_pct = frame_usec * 100.0 / (SAMPLES_PER_FRAME * 1000000.0 /
+                                     CLOCK_RATE);
+
+    printf("%-5s mixing: %8.2f usec/frame, %6.3f usec/port, "
+           "%6.4f usec/connection, %5.2f%% of a core (~%u ports/core)\n",
+           pjmedia_mix_get_impl_name(), frame_usec,
+           frame_usec / port_cnt, frame_usec / conn_cnt, core_pct,
+           (unsigned)(port_cnt * 100.0 / core_pct));
+    fflush(stdout);
 }
 
 
@@ -230,12 +226,14 @@ int main()
     pj_caching_pool cp;
     pjmedia_endpt *med_endpt;
     pj_pool_t *pool;
+    pjmedia_conf_param conf_param;
     pjmedia_conf *conf;
     int i;
-    pjmedia_port *sine_port[SINE_COUNT], *null_port, *conf_port;
+    pjmedia_port *sine_port[SINE_COUNT], *conf_port;
     pjmedia_port *nulls[NULL_COUNT];
     unsigned null_slots[NULL_COUNT];
-    pjmedia_master_port *master_port;
+    pjmedia_frame frame;
+    pj_int16_t buf[SAMPLES_PER_FRAME];
     pj_status_t status;
 
 
@@ -257,18 +255,24 @@ int main()
 
 
 
-    status = pjmedia_conf_create( pool,
-                                  PORT_COUNT,
-                                  CLOCK_RATE,
-                                  1, SAMPLES_PER_FRAME, 16,
-                                  PJMEDIA_CONF_NO_DEVICE,
-                                  &conf);
+    pjmedia_conf_param_default(&conf_param);
+    conf_param.max_slots = PORT_COUNT;
+    conf_param.sampling_rate = CLOCK_RATE;
+    conf_param.channel_count = 1;
+    conf_param.samples_per_frame = SAMPLES_PER_FRAME;
+    conf_param.bits_per_sample = 16;
+    conf_param.options = PJMEDIA_CONF_NO_DEVICE;
+    conf_param.max_speakers = MAX_SPEAKERS;
+
+    status = pjmedia_conf_create2(pool, &conf_param, &conf);
     if (status != PJ_SUCCESS) {
         app_perror(THIS_FILE, "Unable to create conference bridge", status);
         return 1;
     }
 
     printf("Resampling is %s\n", (HAS_RESAMPLE?"active":"disabled"));
+    if (MAX_SPEAKERS)
+        printf("Mixing the %d loudest ports only\n", MAX_SPEAKERS);
 
     /* Create Null ports */
     printf("Creating %d null ports..\n", NULL_COUNT);
@@ -320,27 +324,30 @@ int main()
         PJ_ASSERT_RETURN(status == PJ_SUCCESS, 1);
     }
 
-    /* Create null port */
-    status = pjmedia_null_port_create(pool, CLOCK_RATE, 1, SAMPLES_PER_FRAME, 16,
-                                      &null_port);
-    PJ_ASSERT_RETURN(status == PJ_SUCCESS, 1);
-
     conf_port = pjmedia_conf_get_master_port(conf);
 
-    /* Create master port */
-    status = pjmedia_master_port_create(pool, null_port, conf_port, 0, &master_port);
+    /* Run one frame so that the new ports and connections are applied */
+    frame.buf = buf;
+    frame.size = sizeof(buf);
+    frame.timestamp.u64 = 0;
+    frame.type = PJMEDIA_FRAME_TYPE_AUDIO;
+    pjmedia_port_get_frame(conf_port, &frame);
 
-
-    pjmedia_master_port_start(master_port);
-
-    puts("Waiting to settle.."); fflush(stdout);
-    pj_thread_sleep(5000);
-
-
-    benchmark();
+    /* The idle ports are in the bridge but take no part in the mixing.
+     * The main port (slot 0) listens to all sine ports.
+     */
+    benchmark(conf_port, PJ_FALSE, SINE_COUNT + NULL_COUNT + 1,
+              SINE_COUNT * (NULL_COUNT + 1));
+    benchmark(conf_port, PJ_TRUE, SINE_COUNT + NULL_COUNT + 1,
+              SINE_COUNT * (NULL_COUNT + 1));
 
 
     /* Done. */
+    pjmedia_conf_destroy(conf);
+    pj_pool_release(pool);
+    pjmedia_endpt_destroy(med_endpt);
+    pj_caching_pool_destroy(&cp);
+    pj_shutdown();
     return 0;
 }
 
@@ -48,6 +48,19 @@
  *    Also for every call, server will limit the call duration to
  *    10 seconds, on which the call will be terminated if the client
  *    doesn't hangup the call.
+ *
+ * The server can also be started with overload control (see
+ * \ref PJSIP_OVERLOAD), to see how it keeps its goodput when it's
+ * offered more requests than it can handle. For example, to offer five
+ * times the admitted rate of new requests:
+ *  - server: <tt>pjsip-perf --overload-rate=1000</tt>
+ *  - client: <tt>pjsip-perf --rate=5000 --count=20000 --stateless
+ *    sip:0\@server-addr</tt>
+ *
+ * The client reports the rate of 2xx responses (the goodput) separately
+ * from the 503 responses of the requests that were shed. With stateful
+ * requests (sip:1), the server also sheds requests when its transaction
+ * table is nearly full.
  *    
  *
  *
@@ -122,6 +135,7 @@ struct app
     pj_caching_pool      cp;
     pj_pool_t           *pool;
     pj_bool_t            use_tcp;
+    unsigned             udp_sock_cnt;
     pj_str_t             local_addr;
     int                  local_port;
     pjsip_endpoint      *sip_endpt;
@@ -145,6 +159,8 @@ struct app
         pj_str_t             dst_uri;
         pj_bool_t            stateless;
         unsigned             timeout;
+        unsigned             rate;
+        pj_timestamp         start_ts;
         unsigned             job_count,
                              job_submitted, 
                              job_finished,
@@ -161,6 +177,8 @@ struct app
         pj_bool_t send_trying;
         pj_bool_t send_ringing;
         unsigned delay;
+        unsigned overload_rate;
+        pj_bool_t overload_drop;
         struct srv_state prev_state;
         struct srv_state cur_state;
     } server;
@@ -790,12 +808,17 @@ static pj_status_t init_sip()
             }
 #endif
         } else {
+            pjsip_udp_transport_cfg cfg;
             pjsip_transport *tp;
 
             transport_type = "udp";
-            status = pjsip_udp_transport_start(app.sip_endpt, &addr, 
-                                               (app.local_addr.slen ? &addrname:NULL),
-                                               app.thread_count, &tp);
+            pjsip_udp_transport_cfg_default(&cfg, pj_AF_INET());
+            pj_sockaddr_cp(&cfg.bind_addr, &addr);
+            if (app.local_addr.slen)
+                cfg.addr_name = addrname;
+            cfg.async_cnt = app.thread_count;
+            cfg.sock_cnt = app.udp_sock_cnt;
+            status = pjsip_udp_transport_start2(app.sip_endpt, &cfg, &tp);
             if (status == PJ_SUCCESS) {
                 app.local_addr = tp->local_name.host;
                 app.local_port = tp->local_name.port;
@@ -870,6 +893,19 @@ static pj_status_t init_sip()
     status = pjsip_endpt_register_module( app.sip_endpt, &mod_call_server);
     PJ_ASSERT_RETURN(status == PJ_SUCCESS, status);
 
+    /* Shed new requests above the configured rate */
+    if (app.server.overload_rate) {
+        pjsip_overload_param ovl_prm;
+
+        pjsip_overload_param_default(&ovl_prm);
+        ovl_prm.max_rate = app.server.overload_rate;
+        if (app.server.overload_drop)
+            ovl_prm.action = PJSIP_OVERLOAD_DROP;
+
+        status = pjsip_overload_init_module(app.sip_endpt, &ovl_prm);
+        PJ_ASSERT_RETURN(status == PJ_SUCCESS, status);
+    }
+
 
     /* Done */
     return PJ_SUCCESS;
@@ -1135,6 +1171,8 @@ static void usage(void)
         "                           [default: stateful]\n"
         "   --timeout=SEC, -t       Set client timeout [default=60 sec]\n"
         "   --window=COUNT, -w      Set maximum outstanding job [default: %d]\n"
+        "   --rate=N                Send new requests at N per second, e.g. to\n"
+        "                           overload the server [default: no limit]\n"
         "\n"
         "SDP options (client and server):\n"
         "   --real-sdp              Generate real SDP from pjmedia, and also perform\n"
@@ -1146,9 +1184,15 @@ static void usage(void)
         "                           client, you must add ;transport=tcp parameter to URL\n"
         "                           [default: no]\n"
         "   --thread-count=N        Set number of worker threads [default=1]\n"
+        "   --udp-sockets=N         Receive with N UDP sockets bound to the local\n"
+        "                           port with SO_REUSEPORT [default=1]\n"
         "   --trying                Send 100/Trying response (server, default no)\n"
         "   --ringing               Send 180/Ringing response (server, default no)\n"
         "   --delay=MS, -d          Delay answering call by MS (server, default no)\n"
+        "   --overload-rate=N       Shed new requests above N per second with 503\n"
+        "                           (server, default no)\n"
+        "   --overload-drop         Drop shed requests instead of sending 503\n"
+        "                           (server, default no)\n"
         "\n"
         "Misc options:\n"
         "   --help, -h              Display this screen\n"
@@ -1171,7 +1215,8 @@ static int my_atoi(const char *s)
 
 static pj_status_t init_options(int argc, char *argv[])
 {
-    enum { OPT_THREAD_COUNT = 1, OPT_REAL_SDP, OPT_TRYING, OPT_RINGING };
+    enum { OPT_THREAD_COUNT = 1, OPT_REAL_SDP, OPT_TRYING, OPT_RINGING,
+           OPT_RATE, OPT_OVERLOAD_RATE, OPT_OVERLOAD_DROP, OPT_UDP_SOCKETS };
     struct pj_getopt_option long_options[] = {
         { "local-port",     1, 0, 'p' },
         { "count",          1, 0, 'c' },
@@ -1187,6 +1232,10 @@ static pj_status_t init_options(int argc, char *argv[])
         { "delay",          1, 0, 'd' },
         { "trying",         0, 0, OPT_TRYING},
         { "ringing",        0, 0, OPT_RINGING},
+        { "rate",           1, 0, OPT_RATE},
+        { "overload-rate",  1, 0, OPT_OVERLOAD_RATE},
+        { "overload-drop",  0, 0, OPT_OVERLOAD_DROP},
+        { "udp-sockets",    1, 0, OPT_UDP_SOCKETS},
         { NULL, 0, 0, 0 },
     };
     int c;
@@ -1195,6 +1244,7 @@ static pj_status_t init_options(int argc, char *argv[])
     /* Init default application configs */
     app.local_port = 5060;
     app.thread_count = 1;
+    app.udp_sock_cnt = 1;
     app.client.job_count = DEFAULT_COUNT;
     app.client.method = *pjsip_get_options_method();
     app.client.job_window = c = JOB_WINDOW;
@@ -1293,6 +1343,26 @@ static pj_status_t init_options(int argc, char *argv[])
             app.server.send_ringing = 1;
             break;
 
+        case OPT_RATE:
+            app.client.rate = my_atoi(pj_optarg);
+            break;
+
+        case OPT_OVERLOAD_RATE:
+            app.server.overload_rate = my_atoi(pj_optarg);
+            break;
+
+        case OPT_OVERLOAD_DROP:
+            app.server.overload_drop = PJ_TRUE;
+            break;
+
+        case OPT_UDP_SOCKETS:
+            app.udp_sock_cnt = my_atoi(pj_optarg);
+            if (app.udp_sock_cnt < 1 || app.udp_sock_cnt > 16) {
+                PJ_LOG(3,(THIS_FILE, "Invalid --udp-sockets %s", pj_optarg));
+                return -1;
+            }
+            break;
+
         default:
             PJ_LOG(1,(THIS_FILE, 
                       "Invalid argument. Use --help to see help"));
@@ -1432,6 +1502,7 @@ static int client_thread(void *arg)
 
     if (app.client.first_request.sec == 0) {
         pj_gettimeofday(&app.client.first_request);
+        pj_get_timestamp(&app.client.start_ts);
     }
 
     /* Submit all jobs */
@@ -1466,6 +1537,20 @@ static int client_thread(void *arg)
         }
 
 
+        /* Pace the jobs when sending at a fixed rate */
+        if (app.client.rate) {
+            pj_uint64_t due = (pj_uint64_t)app.client.job_submitted *
+                              1000000 / app.client.rate;
+            pj_timestamp ts_now;
+
+            for (;;) {
+                pj_get_timestamp(&ts_now);
+                if (pj_elapsed_usec(&app.client.start_ts, &ts_now) >= due)
+                    break;
+                pjsip_endpt_handle_events2(app.sip_endpt, &timeout, NULL);
+            }
+        }
+
         /* Submit one job */
         if (app.client.method.id == PJSIP_INVITE_METHOD) {
             status = make_call(&app.client.dst_uri);
@@ -1624,10 +1709,20 @@ static int server_thread(void *arg)
                 good_number(str_call, sizeof(str_call),
                             app.server.cur_state.call_cnt);
 
-                printf("Total(rate): stateless:%s (%d/s), statefull:%s (%d/s), call:%s (%d/s)       \r",
+                printf("Total(rate): stateless:%s (%d/s), statefull:%s (%d/s), call:%s (%d/s)",
                        str_stateless, stateless*1000/msec,
                        str_stateful, stateful*1000/msec,
                        str_call, call*1000/msec);
+
+                if (app.server.overload_rate) {
+                    pjsip_overload_stat stat;
+
+                    pjsip_overload_get_stat(&stat, PJ_TRUE);
+                    printf(", shed: %d/s",
+                           (stat.rejected + stat.dropped)*1000/msec);
+                }
+
+                printf("       \r");
                 fflush(stdout);
 
                 app.server.prev_state = app.server.cur_state;
@@ -1798,6 +1893,19 @@ int main(int argc, char *argv[])
 
         write_report(report);
 
+        /* Successful responses (goodput) */
+        {
+            unsigned ok_cnt = 0;
+
+            for (i=200; i<300; ++i)
+                ok_cnt += app.client.response_codes[i];
+
+            pj_ansi_snprintf(report, sizeof(report),
+                             " 2xx responses:    %7d (goodput=%d/sec)\n",
+                             ok_cnt, ok_cnt*1000/msec_res);
+            write_report(report);
+        }
+
         pj_ansi_snprintf(report, sizeof(report),
                         "Maximum outstanding job: %d", 
                         app.client.stat_max_window);
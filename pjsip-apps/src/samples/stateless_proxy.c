@@ -77,7 +77,8 @@ static pj_bool_t on_rx_request( pjsip_rx_data *rdata )
      * Request looks sane, next clone the request to create transmit data.
      */
     status = pjsip_endpt_create_request_fwd(global.endpt, rdata, NULL,
-                                            NULL, 0, &tdata);
+                                            NULL, PJSIP_FWD_RAW_HDR,
+                                            &tdata);
     if (status != PJ_SUCCESS) {
         pjsip_endpt_respond_stateless(global.endpt, rdata,
                                       PJSIP_SC_INTERNAL_SERVER_ERROR, NULL, 
@@ -121,7 +122,8 @@ static pj_bool_t on_rx_response( pjsip_rx_data *rdata )
     pj_status_t status;
 
     /* Create response to be forwarded upstream (Via will be stripped here) */
-    status = pjsip_endpt_create_response_fwd(global.endpt, rdata, 0, &tdata);
+    status = pjsip_endpt_create_response_fwd(global.endpt, rdata,
+                                             PJSIP_FWD_RAW_HDR, &tdata);
     if (status != PJ_SUCCESS) {
         app_perror("Error creating response", status);
         return PJ_TRUE;
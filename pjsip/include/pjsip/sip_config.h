@@ -188,6 +188,26 @@ typedef struct pjsip_cfg_t
          */
         pj_bool_t keep_inv_after_tsx_timeout;
 
+        /**
+         * Parse incoming messages lazily. When enabled, only the headers
+         * that are needed to route and match the message to a transaction
+         * (Via, From, To, Call-ID, CSeq, Max-Forwards, Route, Record-Route,
+         * Content-Type, Content-Length, Require and Supported), and the
+         * headers that the stack walks the header list for (Contact,
+         * Expires, WWW-Authenticate, Proxy-Authenticate, Authorization
+         * and Proxy-Authorization) are parsed when the message is
+         * received. The other headers are kept
+         * unparsed, and are parsed the first time they are looked up with
+         * #pjsip_msg_find_hdr() and friends. Until then they appear as
+         * generic string headers (PJSIP_H_OTHER) to code that walks the
+         * header list directly. Syntax errors in these headers are only
+         * detected when they are parsed, in which case the header is kept
+         * as generic string header instead of failing the message.
+         *
+         * Default is PJSIP_LAZY_PARSE_HDR.
+         */
+        pj_bool_t lazy_parse_hdr;
+
     } endpt;
 
     /** Transaction layer settings. */
@@ -261,6 +281,44 @@ typedef struct pjsip_cfg_t
          */
         long keep_alive_interval;
 
+        /**
+         * Maximum size of a coalesced write. Messages which are sent while
+         * a previous write on the connection is still in progress are
+         * queued, and written together with one send() up to this size.
+         * Zero disables write coalescing. The value is read when the
+         * transport is created.
+         *
+         * Default is PJSIP_TCP_COALESCE_MAX_SIZE.
+         */
+        unsigned coalesce_max_size;
+
+        /**
+         * Time to wait for more messages before writing, in milliseconds.
+         * Zero means a message is written immediately if the connection
+         * is not busy.
+         *
+         * Default is PJSIP_TCP_COALESCE_DELAY.
+         */
+        unsigned coalesce_delay;
+
+        /**
+         * Maximum number of bytes waiting to be sent on a connection.
+         * Sending a message which would exceed this fails with PJ_EBUSY.
+         * Zero means no limit.
+         *
+         * Default is PJSIP_TCP_MAX_PENDING_TX.
+         */
+        pj_size_t max_pending_tx;
+
+        /**
+         * Release the receive pool of a connection whenever all received
+         * data has been processed, and create it again when more data
+         * arrives. This reduces the memory held by idle connections.
+         *
+         * Default is PJSIP_TCP_RELEASE_IDLE_RX_POOL.
+         */
+        pj_bool_t release_idle_rx_pool;
+
     } tcp;
 
     /** TLS transport settings */
@@ -273,6 +331,44 @@ typedef struct pjsip_cfg_t
          */
         long keep_alive_interval;
 
+        /**
+         * Maximum size of a coalesced write. Messages which are sent while
+         * a previous write on the connection is still in progress are
+         * queued, and encrypted together as one TLS record up to this
+         * size. Zero disables write coalescing. The value is read when
+         * the transport is created.
+         *
+         * Default is PJSIP_TLS_COALESCE_MAX_SIZE.
+         */
+        unsigned coalesce_max_size;
+
+        /**
+         * Time to wait for more messages before writing, in milliseconds.
+         * Zero means a message is written immediately if the connection
+         * is not busy.
+         *
+         * Default is PJSIP_TLS_COALESCE_DELAY.
+         */
+        unsigned coalesce_delay;
+
+        /**
+         * Maximum number of bytes waiting to be sent on a connection.
+         * Sending a message which would exceed this fails with PJ_EBUSY.
+         * Zero means no limit.
+         *
+         * Default is PJSIP_TLS_MAX_PENDING_TX.
+         */
+        pj_size_t max_pending_tx;
+
+        /**
+         * Release the receive pool of a connection whenever all received
+         * data has been processed, and create it again when more data
+         * arrives. This reduces the memory held by idle connections.
+         *
+         * Default is PJSIP_TLS_RELEASE_IDLE_RX_POOL.
+         */
+        pj_bool_t release_idle_rx_pool;
+
     } tls;
 
 } pjsip_cfg_t;
@@ -339,7 +435,8 @@ PJ_INLINE(pjsip_cfg_t*) pjsip_cfg(void)
 
 
 /**
- * Transport manager hash table size (must be 2^n-1). 
+ * Initial size of the transport manager hash table. The table grows as
+ * transports are added, so this is only a hint.
  * See also PJSIP_MAX_TRANSPORTS
  */
 #ifndef PJSIP_TPMGR_HTABLE_SIZE
@@ -454,6 +551,23 @@ PJ_INLINE(pjsip_cfg_t*) pjsip_cfg(void)
 #endif
 
 
+/**
+ * Specify whether incoming messages should be parsed lazily, i.e. only the
+ * headers needed by the transaction layer are parsed upon receipt and the
+ * rest are parsed when they are first looked up. This saves parsing time
+ * and memory for applications such as proxies, which only look at a few
+ * headers of the messages they forward.
+ *
+ * This option can also be controlled at run-time by the
+ * \a lazy_parse_hdr setting in pjsip_cfg_t.
+ *
+ * Default is PJ_FALSE.
+ */
+#ifndef PJSIP_LAZY_PARSE_HDR
+#   define PJSIP_LAZY_PARSE_HDR                     PJ_FALSE
+#endif
+
+
 /**
  * Specify whether "alias" param should be added to the Via header
  * in any outgoing request with connection oriented transport.
@@ -661,6 +775,54 @@ PJ_INLINE(pjsip_cfg_t*) pjsip_cfg(void)
 #endif
 
 
+/**
+ * Default number of processing threads of the incoming message dispatch
+ * stage, see #pjsip_endpt_start_dispatch().
+ *
+ * Default: 4
+ */
+#ifndef PJSIP_DISPATCH_THREAD_CNT
+#   define PJSIP_DISPATCH_THREAD_CNT    4
+#endif
+
+
+/**
+ * Default maximum number of incoming messages waiting in the queue of
+ * each dispatch thread, see #pjsip_endpt_start_dispatch(). When a queue
+ * is full, the receiving thread waits until there is room.
+ *
+ * Default: 256
+ */
+#ifndef PJSIP_DISPATCH_QUEUE_SIZE
+#   define PJSIP_DISPATCH_QUEUE_SIZE    256
+#endif
+
+
+/**
+ * Default maximum time, in milliseconds, that an incoming request may
+ * have waited between being received by the transport and reaching the
+ * overload control module before new requests are shed, see
+ * #pjsip_overload_param.
+ *
+ * Default: 500
+ */
+#ifndef PJSIP_OVERLOAD_MAX_LATENCY
+#   define PJSIP_OVERLOAD_MAX_LATENCY   500
+#endif
+
+
+/**
+ * Default value of the Retry-After header, in seconds, of the 503
+ * responses sent by the overload control module, see
+ * #pjsip_overload_param.
+ *
+ * Default: 5
+ */
+#ifndef PJSIP_OVERLOAD_RETRY_AFTER
+#   define PJSIP_OVERLOAD_RETRY_AFTER   5
+#endif
+
+
 /**
  * Idle timeout interval to be applied to outgoing transports (i.e. client
  * side) with no usage before the transport is destroyed. Value is in
@@ -723,7 +885,10 @@ PJ_INLINE(pjsip_cfg_t*) pjsip_cfg(void)
 
 
 /**
- * The TCP incoming connection backlog number to be set in accept().
+ * The TCP incoming connection backlog number to be set in listen(). This
+ * constant will be used as the default value for the "backlog" field in
+ * the pjsip_tcp_transport_cfg structure. Servers expecting a large number
+ * of clients connecting at once should use a much larger value.
  *
  * Default: 5
  *
@@ -818,6 +983,74 @@ PJ_INLINE(pjsip_cfg_t*) pjsip_cfg(void)
 #endif
 
 
+/**
+ * Maximum size of a coalesced TCP write. When a message is sent while a
+ * previous write on the same connection is still in progress, it is
+ * queued, and the queued messages are written together with one send()
+ * once the connection can take more data. This cuts the number of
+ * system calls on busy connections such as trunks carrying many dialogs.
+ * Set to zero to send every message with its own send().
+ *
+ * This option can be changed in run-time by settting
+ * \a tcp.coalesce_max_size field of pjsip_cfg().
+ *
+ * Default: 16384 (bytes)
+ */
+#ifndef PJSIP_TCP_COALESCE_MAX_SIZE
+#   define PJSIP_TCP_COALESCE_MAX_SIZE      16384
+#endif
+
+
+/**
+ * Time to hold a message to be written on an idle TCP connection, so
+ * that messages sent shortly after it are coalesced into the same write.
+ * The value is in milliseconds. With zero, coalescing only happens while
+ * a write is in progress, so no latency is added.
+ *
+ * This option can be changed in run-time by settting
+ * \a tcp.coalesce_delay field of pjsip_cfg().
+ *
+ * Default: 0
+ */
+#ifndef PJSIP_TCP_COALESCE_DELAY
+#   define PJSIP_TCP_COALESCE_DELAY         0
+#endif
+
+
+/**
+ * Maximum number of bytes waiting to be written on a TCP connection.
+ * Once the limit is reached, sending more messages on the connection
+ * fails with PJ_EBUSY until the peer reads the data. Set to zero for
+ * no limit.
+ *
+ * This option can be changed in run-time by settting
+ * \a tcp.max_pending_tx field of pjsip_cfg().
+ *
+ * Default: 0 (no limit)
+ */
+#ifndef PJSIP_TCP_MAX_PENDING_TX
+#   define PJSIP_TCP_MAX_PENDING_TX         0
+#endif
+
+
+/**
+ * Specify whether the receive pool of a TCP connection is released when
+ * there is no unprocessed data left on the connection. The pool is
+ * created again when more data arrives, so an idle connection only holds
+ * the memory of the transport itself. This is useful for servers with a
+ * large number of mostly idle connections (e.g. registrations over TCP),
+ * at the cost of creating a pool for each received burst.
+ *
+ * This option can be changed in run-time by settting
+ * \a tcp.release_idle_rx_pool field of pjsip_cfg().
+ *
+ * Default: 0 (no)
+ */
+#ifndef PJSIP_TCP_RELEASE_IDLE_RX_POOL
+#   define PJSIP_TCP_RELEASE_IDLE_RX_POOL   0
+#endif
+
+
 /**
  * The initial timeout interval for incoming TCP transports
  * (i.e. server side) in the event that no valid SIP message is received
@@ -865,6 +1098,65 @@ PJ_INLINE(pjsip_cfg_t*) pjsip_cfg(void)
 #endif
 
 
+/**
+ * Maximum size of a coalesced TLS write. This is the TLS counterpart of
+ * PJSIP_TCP_COALESCE_MAX_SIZE: besides saving system calls, the queued
+ * messages are encrypted into one TLS record instead of one record per
+ * message. Set to zero to disable.
+ *
+ * This option can be changed in run-time by settting
+ * \a tls.coalesce_max_size field of pjsip_cfg().
+ *
+ * Default: 16384 (bytes)
+ */
+#ifndef PJSIP_TLS_COALESCE_MAX_SIZE
+#   define PJSIP_TLS_COALESCE_MAX_SIZE      16384
+#endif
+
+
+/**
+ * Time to hold a message to be written on an idle TLS connection, in
+ * milliseconds. See PJSIP_TCP_COALESCE_DELAY.
+ *
+ * This option can be changed in run-time by settting
+ * \a tls.coalesce_delay field of pjsip_cfg().
+ *
+ * Default: 0
+ */
+#ifndef PJSIP_TLS_COALESCE_DELAY
+#   define PJSIP_TLS_COALESCE_DELAY         0
+#endif
+
+
+/**
+ * Maximum number of bytes waiting to be written on a TLS connection.
+ * See PJSIP_TCP_MAX_PENDING_TX.
+ *
+ * This option can be changed in run-time by settting
+ * \a tls.max_pending_tx field of pjsip_cfg().
+ *
+ * Default: 0 (no limit)
+ */
+#ifndef PJSIP_TLS_MAX_PENDING_TX
+#   define PJSIP_TLS_MAX_PENDING_TX         0
+#endif
+
+
+/**
+ * Specify whether the receive pool of a TLS connection is released when
+ * there is no unprocessed data left on the connection. See
+ * PJSIP_TCP_RELEASE_IDLE_RX_POOL.
+ *
+ * This option can be changed in run-time by settting
+ * \a tls.release_idle_rx_pool field of pjsip_cfg().
+ *
+ * Default: 0 (no)
+ */
+#ifndef PJSIP_TLS_RELEASE_IDLE_RX_POOL
+#   define PJSIP_TLS_RELEASE_IDLE_RX_POOL   0
+#endif
+
+
 /**
  * This macro specifies whether full DNS resolution should be used.
  * When enabled, #pjsip_resolve() will perform asynchronous DNS SRV and
@@ -998,6 +1290,17 @@ PJ_INLINE(pjsip_cfg_t*) pjsip_cfg(void)
 #   define PJSIP_POOL_RDATA_INC         4000
 #endif
 
+/**
+ * Initial memory block for the pool of each receive buffer of UDP
+ * transport. The rdata itself is not allocated from this pool, so the
+ * whole block is available for parsing the message. Making it large
+ * enough for the typical messages avoids allocating and releasing pool
+ * blocks for every packet received.
+ */
+#ifndef PJSIP_POOL_UDP_RDATA_LEN
+#   define PJSIP_POOL_UDP_RDATA_LEN     12000
+#endif
+
 /**
  * Initial memory block for SIP transport.
  */
@@ -1091,6 +1394,21 @@ PJ_INLINE(pjsip_cfg_t*) pjsip_cfg(void)
 #   define PJSIP_POOL_TSX_LAYER_INC     512
 #endif
 
+/**
+ * Number of stripes in the transaction table. The transaction layer
+ * splits its hash tables into this many sub-tables, each protected by its
+ * own mutex, and picks the stripe from the hash of the transaction key.
+ * This lets worker threads that handle different transactions look up,
+ * register, and unregister transactions without serializing on a single
+ * lock. The value must be a power of two; set it to 1 to use a single
+ * table.
+ *
+ * Default: 16
+ */
+#ifndef PJSIP_TSX_LAYER_STRIPES
+#   define PJSIP_TSX_LAYER_STRIPES      16
+#endif
+
 /**
  * Initial memory size for a SIP transaction object.
  */
@@ -323,6 +323,77 @@ PJ_DECL(pj_status_t) pjsip_endpt_process_rx_data(pjsip_endpoint *endpt,
                                                  pjsip_process_rdata_param *p,
                                                  pj_bool_t *p_handled);
 
+/**
+ * This describes the parameters of the incoming message dispatch stage,
+ * see #pjsip_endpt_start_dispatch(). Application MUST call
+ * pjsip_dispatch_param_default() to initialize this structure.
+ */
+typedef struct pjsip_dispatch_param
+{
+    /**
+     * Number of processing threads.
+     *
+     * Default: PJSIP_DISPATCH_THREAD_CNT
+     */
+    unsigned thread_cnt;
+
+    /**
+     * Maximum number of messages waiting in the queue of each processing
+     * thread. When the queue is full, the thread that received the message
+     * waits until there is room, so that the messages of a dialog are
+     * never reordered or dropped.
+     *
+     * Default: PJSIP_DISPATCH_QUEUE_SIZE
+     */
+    unsigned queue_size;
+
+} pjsip_dispatch_param;
+
+/**
+ * Initialize with default.
+ *
+ * @param p     The param.
+ */
+PJ_DECL(void) pjsip_dispatch_param_default(pjsip_dispatch_param *p);
+
+/**
+ * Start the incoming message dispatch stage. By default, incoming messages
+ * are distributed to the modules by the thread that receives them from
+ * the network (i.e. the thread polling the ioqueue), so a slow module
+ * callback holds up the socket. With the dispatch stage, the receiving
+ * thread only parses the message, then it clones the rdata and queues it
+ * to one of the processing threads, which distributes it to the modules.
+ *
+ * The processing thread is selected by the hash of the Call-ID, so the
+ * messages of a dialog (and of its transactions) are always processed by
+ * the same thread, in the order they were received, while different
+ * dialogs are processed in parallel. Messages that fail to parse are
+ * still reported by the receiving thread.
+ *
+ * The queue depth and latency of each processing thread are printed by
+ * #pjsip_endpt_dump().
+ *
+ * @param endpt         The endpoint instance.
+ * @param prm           Optional parameters, or NULL to use the default.
+ *
+ * @return              PJ_SUCCESS on success, or PJ_EEXISTS if the
+ *                      dispatch stage is already running.
+ */
+PJ_DECL(pj_status_t) pjsip_endpt_start_dispatch(pjsip_endpoint *endpt,
+                                                const pjsip_dispatch_param *prm);
+
+/**
+ * Stop the incoming message dispatch stage. The messages already queued
+ * are processed before the threads are stopped, and subsequent messages
+ * are processed by the receiving threads again. This is called
+ * automatically when the endpoint is destroyed.
+ *
+ * @param endpt         The endpoint instance.
+ *
+ * @return              PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjsip_endpt_stop_dispatch(pjsip_endpoint *endpt);
+
 /**
  * Create pool from the endpoint. All SIP components should allocate their
  * memory pool by calling this function, to make sure that the pools are
@@ -458,6 +529,55 @@ PJ_DECL(pjsip_tpmgr*) pjsip_endpt_get_tpmgr(pjsip_endpoint *endpt);
  */
 PJ_DECL(pj_ioqueue_t*) pjsip_endpt_get_ioqueue(pjsip_endpoint *endpt);
 
+/**
+ * Set the ioqueue group (shards) to be used by the SIP transports for
+ * their sockets. When a group is set, TCP connections and the sockets of
+ * a UDP socket group (see \a sock_cnt in #pjsip_udp_transport_cfg) are
+ * registered to one of the shards (see #pjsip_endpt_get_ioqueue_shard())
+ * instead of the endpoint's ioqueue, so that several worker threads, each
+ * polling its own shard, can process network events without contending
+ * on a single ioqueue. A UDP transport with a single socket stays on the
+ * endpoint's ioqueue.
+ *
+ * The group must be set before the transports are created, and the
+ * application is responsible for polling all shards (the endpoint's
+ * #pjsip_endpt_handle_events() only polls the endpoint's own ioqueue) and
+ * for destroying the group after the endpoint has been destroyed.
+ *
+ * @param endpt     The endpoint.
+ * @param grp       The ioqueue group, or NULL to stop using the group
+ *                  for new transports.
+ *
+ * @return          PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjsip_endpt_set_ioqueue_group(pjsip_endpoint *endpt,
+                                                   pj_ioqueue_group_t *grp);
+
+/**
+ * Get the ioqueue group that has been set with
+ * #pjsip_endpt_set_ioqueue_group().
+ *
+ * @param endpt     The endpoint.
+ *
+ * @return          The ioqueue group, or NULL if none is set.
+ */
+PJ_DECL(pj_ioqueue_group_t*) pjsip_endpt_get_ioqueue_group(
+                                                pjsip_endpoint *endpt);
+
+/**
+ * Get the ioqueue where a transport socket should be registered. If an
+ * ioqueue group has been set, this returns the shard selected by the
+ * hash value, otherwise this returns the endpoint's ioqueue.
+ *
+ * @param endpt     The endpoint.
+ * @param hash      Hash value used to select the shard, for example the
+ *                  socket descriptor.
+ *
+ * @return          The ioqueue.
+ */
+PJ_DECL(pj_ioqueue_t*) pjsip_endpt_get_ioqueue_shard(pjsip_endpoint *endpt,
+                                                     pj_uint32_t hash);
+
 /**
  * Find a SIP transport suitable for sending SIP message to the specified
  * address. If transport selector ("sel") is set, then the function will
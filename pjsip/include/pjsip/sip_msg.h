@@ -361,6 +361,73 @@ PJ_DECL(void*) pjsip_hdr_shallow_clone( pj_pool_t *pool, const void *hdr );
  */
 PJ_DECL(int) pjsip_hdr_print_on( void *hdr, char *buf, pj_size_t len);
 
+/**
+ * Opaque declaration of header template. A header template holds a header
+ * together with its pre-rendered text, so that headers which are sent
+ * often but rarely change (such as User-Agent, Allow, or Supported) don't
+ * need to be printed from their structures every time a message is
+ * printed.
+ */
+typedef struct pjsip_hdr_tpl pjsip_hdr_tpl;
+
+/**
+ * Create a header template from the specified header. The header is
+ * deep-cloned into the pool and printed once. Subsequent changes to the
+ * original header will not be reflected in the template.
+ *
+ * Note that the header is rendered according to the current value of
+ * PJSIP_ENCODE_SHORT_HNAME, thus changing the setting afterwards won't
+ * affect headers instantiated from the template.
+ *
+ * @param pool      Pool to allocate the template. The pool must remain
+ *                  valid as long as the template and any of its instances
+ *                  are in use.
+ * @param hdr       The header.
+ * @param p_tpl     Pointer to receive the template.
+ *
+ * @return          PJ_SUCCESS, or PJSIP_EMSGTOOLONG if the header is too
+ *                  long to be rendered.
+ */
+PJ_DECL(pj_status_t) pjsip_hdr_tpl_create( pj_pool_t *pool,
+                                           const void *hdr,
+                                           pjsip_hdr_tpl **p_tpl);
+
+/**
+ * Create a header instance from a header template. The instance is a
+ * shallow clone of the template's header, which can be inspected and
+ * looked up just like the original header, but is printed by copying the
+ * pre-rendered text. The instance must therefore not be modified; deep
+ * cloning the instance with #pjsip_hdr_clone() yields a regular header
+ * that can be modified.
+ *
+ * @param pool      The pool to allocate memory from.
+ * @param tpl       The header template.
+ *
+ * @return          A new header instance.
+ */
+PJ_DECL(void*) pjsip_hdr_tpl_instance( pj_pool_t *pool,
+                                       const pjsip_hdr_tpl *tpl);
+
+/**
+ * If the header is an instance of a header template, turn it into a
+ * regular header which is printed from its structure, so that it can be
+ * modified. As with other shallow clones, the values that the header
+ * refers to are still shared with the template. If the header is not an
+ * instance of a template, this function does nothing.
+ *
+ * @param hdr       The header.
+ */
+PJ_DECL(void) pjsip_hdr_tpl_detach( void *hdr);
+
+/**
+ * Get the header of the header template.
+ *
+ * @param tpl       The header template.
+ *
+ * @return          The header.
+ */
+PJ_DECL(const void*) pjsip_hdr_tpl_get_hdr( const pjsip_hdr_tpl *tpl);
+
 /**
  * Find a header in a header list by the header type.
  *
@@ -914,7 +981,9 @@ PJ_DECL(pjsip_msg*) pjsip_msg_clone( pj_pool_t *pool, const pjsip_msg *msg);
  *                  specified header.
  *
  * @return          The header field, or NULL if no header with the specified 
- *                  type is found.
+ *                  type is found. If the matching header has not been parsed
+ *                  yet (see #pjsip_lazy_hdr_create()), it is parsed now and
+ *                  replaced in the message.
  */
 PJ_DECL(void*)  pjsip_msg_find_hdr( const pjsip_msg *msg, 
                                     pjsip_hdr_e type, const void *start);
@@ -1133,6 +1202,27 @@ PJ_DECL(void) pjsip_generic_string_hdr_init2(pjsip_generic_string_hdr *h,
                                              pj_str_t *hvalue);
 
 
+/**
+ * Create a header which value is kept unparsed until the header is looked
+ * up with #pjsip_hdr_find(), #pjsip_msg_find_hdr() or their by-name
+ * variants, at which point it is parsed with #pjsip_parse_hdr() and
+ * replaced with the parsed header(s) in the header list. Until then, the
+ * header can be used as generic string header (PJSIP_H_OTHER type).
+ *
+ * The parser creates such headers when \a lazy_parse_hdr setting in
+ * pjsip_cfg_t is enabled.
+ *
+ * @param pool      The pool, which will also be used to parse the header.
+ * @param hname     The header name. The string is not copied.
+ * @param hvalue    Optional header value. The string is not copied.
+ *
+ * @return          The header.
+ */
+PJ_DECL(pjsip_generic_string_hdr*) pjsip_lazy_hdr_create(pj_pool_t *pool,
+                                                  const pj_str_t *hname,
+                                                  const pj_str_t *hvalue);
+
+
 /* **************************************************************************/
 
 /**
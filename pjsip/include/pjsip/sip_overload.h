@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2025 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef __PJSIP_SIP_OVERLOAD_H__
+#define __PJSIP_SIP_OVERLOAD_H__
+
+/**
+ * @file sip_overload.h
+ * @brief SIP Overload Control
+ */
+
+#include <pjsip/sip_types.h>
+
+PJ_BEGIN_DECL
+
+/**
+ * @defgroup PJSIP_OVERLOAD Overload Control
+ * @ingroup PJSIP_CORE
+ * @brief Shed new requests when the endpoint is overloaded.
+ * @{
+ *
+ * The overload control module sits just before the transaction layer and
+ * sheds new out-of-dialog requests when the endpoint can't keep up, before
+ * any transaction or dialog state is created for them. A request is shed
+ * when any of the following is exceeded:
+ *  - the rate of new out-of-dialog requests,
+ *  - the number of active transactions, or
+ *  - the time the request has waited between being received by the
+ *    transport and reaching the module, e.g. in the dispatch queue (see
+ *    #pjsip_endpt_start_dispatch()) or in the socket buffer.
+ *
+ * Shed requests are either answered statelessly with 503 (Service
+ * Unavailable) and a Retry-After header, or silently dropped.
+ *
+ * Responses, ACK, CANCEL, requests inside a dialog (i.e. with a To tag),
+ * and retransmissions of requests that already have a transaction are
+ * never shed, so that work that has been accepted can complete and the
+ * goodput is kept while new work is turned away.
+ *
+ * Application enables the module with #pjsip_overload_init_module().
+ */
+
+/**
+ * What to do with requests that are shed.
+ */
+typedef enum pjsip_overload_action
+{
+    /** Respond statelessly with 503 and Retry-After header. */
+    PJSIP_OVERLOAD_REJECT,
+
+    /** Drop the request silently. */
+    PJSIP_OVERLOAD_DROP
+
+} pjsip_overload_action;
+
+
+/**
+ * Overload control settings.
+ */
+typedef struct pjsip_overload_param
+{
+    /**
+     * Maximum rate of new out-of-dialog requests to accept, per second.
+     * Up to one second worth of requests may be accepted in a burst.
+     * Zero disables the rate check.
+     *
+     * Default: 0 (disabled)
+     */
+    unsigned                max_rate;
+
+    /**
+     * Maximum number of active transactions, as reported by
+     * #pjsip_tsx_layer_get_tsx_count(). Zero disables the check.
+     *
+     * Default: 90% of pjsip_cfg()->tsx.max_count
+     */
+    unsigned                max_tsx_cnt;
+
+    /**
+     * Maximum time, in milliseconds, a request may have waited since it
+     * was received by the transport. Zero disables the check.
+     *
+     * Default: PJSIP_OVERLOAD_MAX_LATENCY
+     */
+    unsigned                max_latency;
+
+    /**
+     * What to do with requests that are shed.
+     *
+     * Default: PJSIP_OVERLOAD_REJECT
+     */
+    pjsip_overload_action   action;
+
+    /**
+     * Value of the Retry-After header of the 503 response, in seconds.
+     * Zero omits the header.
+     *
+     * Default: PJSIP_OVERLOAD_RETRY_AFTER
+     */
+    unsigned                retry_after;
+
+} pjsip_overload_param;
+
+
+/**
+ * Overload control statistics.
+ */
+typedef struct pjsip_overload_stat
+{
+    /** Number of new out-of-dialog requests accepted. */
+    unsigned    accepted;
+
+    /** Number of requests shed because of the request rate. */
+    unsigned    shed_rate;
+
+    /** Number of requests shed because of the transaction count. */
+    unsigned    shed_tsx;
+
+    /** Number of requests shed because of the latency. */
+    unsigned    shed_latency;
+
+    /** Number of 503 responses sent. */
+    unsigned    rejected;
+
+    /** Number of requests dropped. */
+    unsigned    dropped;
+
+} pjsip_overload_stat;
+
+
+/**
+ * Initialize the overload control settings with the default values.
+ *
+ * @param prm       The settings.
+ */
+PJ_DECL(void) pjsip_overload_param_default(pjsip_overload_param *prm);
+
+/**
+ * Create and register the overload control module to the endpoint.
+ *
+ * @param endpt     The endpoint.
+ * @param prm       The settings, or NULL for the default.
+ *
+ * @return          PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjsip_overload_init_module(pjsip_endpoint *endpt,
+                                        const pjsip_overload_param *prm);
+
+/**
+ * Get the overload control module instance.
+ *
+ * @return          The module, or NULL if it's not initialized.
+ */
+PJ_DECL(pjsip_module*) pjsip_overload_instance(void);
+
+/**
+ * Change the overload control settings at run-time.
+ *
+ * @param prm       The new settings.
+ *
+ * @return          PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjsip_overload_set_param(const pjsip_overload_param *prm);
+
+/**
+ * Get the overload control statistics.
+ *
+ * @param stat      To receive the statistics.
+ * @param reset     Reset the statistics after retrieving them.
+ *
+ * @return          PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjsip_overload_get_stat(pjsip_overload_stat *stat,
+                                             pj_bool_t reset);
+
+/**
+ * @}
+ */
+
+PJ_END_DECL
+
+#endif  /* __PJSIP_SIP_OVERLOAD_H__ */
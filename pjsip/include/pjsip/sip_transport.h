@@ -936,6 +936,16 @@ struct pjsip_transport
      */
     pj_status_t (*destroy)(pjsip_transport *transport);
 
+    /**
+     * Optional function to get the amount of memory currently held by
+     * the transport, in bytes. It is used by pjsip_tpmgr_dump_transports().
+     *
+     * @param transport     The transport.
+     *
+     * @return              Memory usage, in bytes.
+     */
+    pj_size_t (*get_mem_usage)(pjsip_transport *transport);
+
     /*
      * Application may extend this structure..
      */
@@ -86,6 +86,25 @@ typedef struct pjsip_tcp_transport_cfg
      */
     unsigned           async_cnt;
 
+    /**
+     * The backlog of pending incoming connections for the listener socket,
+     * i.e. the argument of listen(). Servers expecting many clients to
+     * connect at once (e.g. after a restart) should use a large value.
+     *
+     * Default value is PJSIP_TCP_TRANSPORT_BACKLOG.
+     */
+    int                 backlog;
+
+    /**
+     * Maximum number of incoming connections to be accepted each time the
+     * listener reports a new connection. When it is greater than one, the
+     * connections already waiting in the backlog are accepted right away
+     * instead of waiting for another event for each of them.
+     *
+     * Default: 1
+     */
+    unsigned            accept_batch;
+
     /**
      * QoS traffic type to be set on this transport. When application wants
      * to apply QoS tagging to the transport, it's preferable to set this
@@ -236,6 +255,19 @@ PJ_DECL(pj_status_t) pjsip_tcp_transport_start3(
  */
 PJ_DECL(pj_sock_t) pjsip_tcp_transport_get_socket(pjsip_transport *transport);
 
+/**
+ * Get the number of bytes which have been submitted to the TCP transport
+ * for sending and have not been written to the socket yet. This includes
+ * the messages queued while the connection is being established or while
+ * a previous write is in progress. See PJSIP_TCP_MAX_PENDING_TX.
+ *
+ * @param transport     The TCP transport.
+ *
+ * @return              The number of pending bytes.
+ */
+PJ_DECL(pj_size_t) pjsip_tcp_transport_get_pending_tx(
+                                                pjsip_transport *transport);
+
 /**
  * Start the TCP listener, if the listener is not started yet. This is useful
  * to start the listener manually, if listener was not started when 
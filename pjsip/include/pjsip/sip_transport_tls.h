@@ -651,6 +651,19 @@ PJ_DECL(pj_status_t) pjsip_tls_transport_restart(pjsip_tpfactory *factory,
                                                 const pj_sockaddr *local,
                                                 const pjsip_host_port *a_name);
 
+/**
+ * Get the number of bytes which have been submitted to the TLS transport
+ * for sending and have not been written to the secure socket yet. This
+ * includes the messages queued while the connection is being established
+ * or while a previous write is in progress. See PJSIP_TLS_MAX_PENDING_TX.
+ *
+ * @param transport     The TLS transport.
+ *
+ * @return              The number of pending bytes.
+ */
+PJ_DECL(pj_size_t) pjsip_tls_transport_get_pending_tx(
+                                                pjsip_transport *transport);
+
 PJ_END_DECL
 
 /**
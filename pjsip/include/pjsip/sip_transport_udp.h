@@ -94,6 +94,31 @@ typedef struct pjsip_udp_transport_cfg
      */
     unsigned            async_cnt;
 
+    /**
+     * Number of sockets to create for the transport. When this is more
+     * than one, the sockets are all bound to the same address with
+     * SO_REUSEPORT so that the kernel distributes the incoming packets
+     * among them, and each socket has its own \a async_cnt pending read
+     * operations. The sockets are presented to the transport manager as
+     * one transport, and outgoing messages are always sent with the
+     * first socket.
+     *
+     * If an ioqueue group has been set to the endpoint (see
+     * #pjsip_endpt_set_ioqueue_group()), the sockets are registered to
+     * different shards, so that each socket is read by the thread polling
+     * its shard. This lets the receive processing of a busy transport to
+     * scale over several CPU cores. A transport with a single socket is
+     * not moved to a shard.
+     *
+     * Starting the transport fails with PJ_ENOTSUP if the platform does
+     * not support SO_REUSEPORT. Note that if the transport is restarted
+     * with an application supplied socket, that socket must have
+     * SO_REUSEPORT set for the other sockets to be recreated.
+     *
+     * Default: 1
+     */
+    unsigned            sock_cnt;
+
     /**
      * QoS traffic type to be set on this transport. When application wants
      * to apply QoS tagging to the transport, it's preferable to set this
@@ -235,6 +260,10 @@ PJ_DECL(pj_status_t) pjsip_udp_transport_attach2(pjsip_endpoint *endpt,
  * wants to make use of this socket, it should temporarily pause the
  * transport.
  *
+ * If the transport has a socket group (see \a sock_cnt in
+ * #pjsip_udp_transport_cfg), this returns the first socket, which is the
+ * one used for sending.
+ *
  * @param transport     The UDP transport.
  *
  * @return              The socket handle, or PJ_INVALID_SOCKET if no socket
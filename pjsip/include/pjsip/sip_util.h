@@ -803,6 +803,28 @@ PJ_DECL(pj_status_t) pjsip_endpt_send_request( pjsip_endpoint *endpt,
  * @{
  */
 
+/**
+ * Options for #pjsip_endpt_create_request_fwd() and
+ * #pjsip_endpt_create_response_fwd().
+ */
+typedef enum pjsip_fwd_option
+{
+    /**
+     * Instead of cloning every header, copy the received packet once
+     * and keep the headers which the proxy doesn't need to modify as
+     * unparsed spans of that copy, to be printed as they were received.
+     * Via, Max-Forwards, Route and Record-Route are still parsed, and
+     * the other headers are parsed on demand when they are looked up
+     * with #pjsip_msg_find_hdr() and friends. A text body also stays
+     * in the copy.
+     *
+     * This saves most of the cloning and printing cost for proxies
+     * that forward messages largely untouched.
+     */
+    PJSIP_FWD_RAW_HDR = 1
+
+} pjsip_fwd_option;
+
 /**
  * Create new request message to be forwarded upstream to new destination URI 
  * in uri. The new request is a full/deep clone of the request received in 
@@ -823,7 +845,8 @@ PJ_DECL(pj_status_t) pjsip_endpt_send_request( pjsip_endpoint *endpt,
  *                  detection. If the branch parameter is not specified,
  *                  this function will generate its own by calling 
  *                  #pjsip_calculate_branch_id() function.
- * @param options   Optional option flags when duplicating the message.
+ * @param options   Optional option flags when duplicating the message,
+ *                  bitmask combination of #pjsip_fwd_option.
  * @param tdata     The result.
  *
  * @return          PJ_SUCCESS on success.
@@ -847,7 +870,8 @@ PJ_DECL(pj_status_t) pjsip_endpt_create_request_fwd(pjsip_endpoint *endpt,
  *
  * @param endpt     The endpoint instance.
  * @param rdata     The incoming response message.
- * @param options   Optional option flags when duplicate the message.
+ * @param options   Optional option flags when duplicate the message,
+ *                  bitmask combination of #pjsip_fwd_option.
  * @param tdata     The result
  *
  * @return          PJ_SUCCESS on success.
@@ -408,6 +408,39 @@ typedef struct pj_stun_resolve_result pj_stun_resolve_result;
 #endif
 
 
+/**
+ * Maximum number of worker threads. The value of pjsua_config.thread_cnt
+ * will be capped to this value. With pjsua_config.shard_ioqueue, this
+ * also limits the number of ioqueue shards (see there), so it should not
+ * be lower than the number of cores the application wants to use.
+ *
+ * Default: 64
+ */
+#ifndef PJSUA_MAX_WORKER_THREADS
+#   define PJSUA_MAX_WORKER_THREADS             64
+#endif
+
+
+/**
+ * Default value for pjsua_config.shard_ioqueue setting.
+ *
+ * Default: 0 (disabled)
+ */
+#ifndef PJSUA_DEFAULT_SHARD_IOQUEUE
+#   define PJSUA_DEFAULT_SHARD_IOQUEUE          0
+#endif
+
+
+/**
+ * Default value for pjsua_config.dispatch_thread_cnt setting.
+ *
+ * Default: 0 (disabled)
+ */
+#ifndef PJSUA_DEFAULT_DISPATCH_THREAD_CNT
+#   define PJSUA_DEFAULT_DISPATCH_THREAD_CNT    0
+#endif
+
+
 /**
  * Specify whether pjsua should disable automatically sending initial
  * answer 100/Trying for incoming calls. If disabled, application can
@@ -2299,6 +2332,51 @@ typedef struct pjsua_config
      */
     unsigned        thread_cnt;
 
+    /**
+     * Give each worker thread its own ioqueue (shard) for the SIP transport
+     * sockets, instead of having all worker threads poll the endpoint's
+     * single ioqueue. TCP connections are distributed over the shards by
+     * hash, and each shard is polled by one worker thread, so the threads
+     * don't contend on one polling set and network processing can scale
+     * with the number of threads.
+     *
+     * UDP transports created by #pjsua_transport_create() have a single
+     * socket, which stays on the endpoint's ioqueue since moving it to a
+     * shard would only hand its whole load to one thread. To spread UDP
+     * receive processing over the shards, create the transport with
+     * #pjsip_udp_transport_start2() and a \a sock_cnt of more than one
+     * (see #pjsip_udp_transport_cfg), which opens SO_REUSEPORT sockets
+     * that are registered to different shards, and register it with
+     * #pjsua_transport_register().
+     *
+     * The first worker thread (the first two if
+     * PJSUA_SEPARATE_WORKER_FOR_TIMER is enabled) keeps polling the
+     * endpoint's ioqueue for the remaining sockets (e.g. UDP transports,
+     * TCP/TLS listeners, TLS connections, DNS resolver), and the rest of
+     * the threads each poll a shard. This setting is ignored if there are
+     * not enough worker threads for at least one shard.
+     *
+     * Since thread_cnt is capped to PJSUA_MAX_WORKER_THREADS, there are
+     * at most PJSUA_MAX_WORKER_THREADS - 1 shards (PJSUA_MAX_WORKER_THREADS
+     * - 2 with PJSUA_SEPARATE_WORKER_FOR_TIMER). Raise
+     * PJSUA_MAX_WORKER_THREADS at compile time to use more shards.
+     *
+     * Default: PJSUA_DEFAULT_SHARD_IOQUEUE (0)
+     */
+    pj_bool_t       shard_ioqueue;
+
+    /**
+     * Number of threads in the endpoint's dispatch stage. When non-zero,
+     * incoming messages are handed from the transport threads to this
+     * many dispatch threads, so that the modules and transactions process
+     * them in parallel. Messages with the same Call-ID are always handled
+     * by the same thread, in order. See #pjsip_endpt_start_dispatch() for
+     * more info.
+     *
+     * Default: PJSUA_DEFAULT_DISPATCH_THREAD_CNT (0)
+     */
+    unsigned        dispatch_thread_cnt;
+
     /**
      * Number of nameservers. If no name server is configured, the SIP SRV
      * resolution would be disabled, and domain will be resolved with
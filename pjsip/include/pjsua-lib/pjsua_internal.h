@@ -549,7 +549,9 @@ struct pjsua_data
 
     /* Threading: */
     pj_bool_t            thread_quit_flag;  /**< Thread quit flag.      */
-    pj_thread_t         *thread[4];         /**< Array of threads.      */
+    pj_thread_t         *thread[PJSUA_MAX_WORKER_THREADS];
+                                            /**< Array of threads.      */
+    pj_ioqueue_group_t  *ioq_grp;           /**< Ioqueue shards.        */
 
     /* STUN and resolver */
     pj_stun_config       stun_cfg;  /**< Global STUN settings.          */
@@ -579,6 +581,7 @@ struct pjsua_data
 
     /* Calls: */
     pjsua_config         ua_cfg;                /**< UA config.         */
+    pjsip_hdr_tpl       *ua_hdr_tpl;            /**< User-Agent template*/
     unsigned             call_cnt;              /**< Call counter.      */
     pjsua_call           calls[PJSUA_MAX_CALLS];/**< Calls array.       */
     pjsua_call_id        next_call_id;          /**< Next call id to use*/
@@ -762,6 +765,11 @@ PJ_INLINE(void) PJSUA_RELOCK(unsigned num_locks)
 /* Core */
 void pjsua_set_state(pjsua_state new_state);
 
+/* Create User-Agent header from the pre-rendered template, or return NULL
+ * if User-Agent is not configured.
+ */
+pjsip_hdr* pjsua_create_ua_hdr(pj_pool_t *pool);
+
 /******
  * STUN resolution
  */
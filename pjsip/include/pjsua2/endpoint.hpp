@@ -873,6 +873,22 @@ struct UaConfig : public PersistentObject
      */
     unsigned            threadCnt;
 
+    /**
+     * Give each worker thread its own ioqueue shard for the SIP transport
+     * sockets. See pjsua_config.shard_ioqueue for more info.
+     *
+     * Default: PJSUA_DEFAULT_SHARD_IOQUEUE (false)
+     */
+    bool                shardIoqueue;
+
+    /**
+     * Number of threads in the endpoint's dispatch stage for incoming
+     * messages. See pjsua_config.dispatch_thread_cnt for more info.
+     *
+     * Default: PJSUA_DEFAULT_DISPATCH_THREAD_CNT (0)
+     */
+    unsigned            dispatchThreadCnt;
+
     /**
      * When this flag is non-zero, all callbacks that come from thread
      * other than main thread will be posted to the main thread and
@@ -2060,6 +2060,10 @@ static void remove_val_from_array_hdr(pjsip_generic_array_hdr *arr_hdr,
     unsigned i;
     for (i=0; i<arr_hdr->count; ++i) {
         if (pj_stricmp(&arr_hdr->values[i], val)==0) {
+            /* The header may be an instance of the endpoint's capability
+             * template, which prints the pre-rendered text.
+             */
+            pjsip_hdr_tpl_detach(arr_hdr);
             pj_array_erase(arr_hdr->values, sizeof(arr_hdr->values[0]),
                            arr_hdr->count, i);
             --arr_hdr->count;
@@ -634,7 +634,7 @@ PJ_DEF(pj_status_t) pjsip_regc_register(pjsip_regc *regc, pj_bool_t autoreg,
     h_allow = pjsip_endpt_get_capability(regc->endpt, PJSIP_H_ALLOW, NULL);
     if (h_allow) {
         pjsip_msg_add_hdr(msg, (pjsip_hdr*)
-                               pjsip_hdr_clone(tdata->pool, h_allow));
+                               pjsip_hdr_shallow_clone(tdata->pool, h_allow));
 
     }
 
@@ -39,7 +39,8 @@ pjsip_cfg_t pjsip_sip_cfg_var =
        0,
        PJSIP_ENCODE_SHORT_HNAME,
        PJSIP_ACCEPT_MULTIPLE_SDP_ANSWERS,
-       0
+       0,
+       PJSIP_LAZY_PARSE_HDR
     },
 
     /* Transaction settings */
@@ -58,12 +59,20 @@ pjsip_cfg_t pjsip_sip_cfg_var =
 
     /* TCP transport settings */
     {
-        PJSIP_TCP_KEEP_ALIVE_INTERVAL
+        PJSIP_TCP_KEEP_ALIVE_INTERVAL,
+        PJSIP_TCP_COALESCE_MAX_SIZE,
+        PJSIP_TCP_COALESCE_DELAY,
+        PJSIP_TCP_MAX_PENDING_TX,
+        PJSIP_TCP_RELEASE_IDLE_RX_POOL
     },
 
     /* TLS transport settings */
     {
-        PJSIP_TLS_KEEP_ALIVE_INTERVAL
+        PJSIP_TLS_KEEP_ALIVE_INTERVAL,
+        PJSIP_TLS_COALESCE_MAX_SIZE,
+        PJSIP_TLS_COALESCE_DELAY,
+        PJSIP_TLS_MAX_PENDING_TX,
+        PJSIP_TLS_RELEASE_IDLE_RX_POOL
     }
 };
 
@@ -86,6 +95,8 @@ PJ_DEF(void) pjsip_dump_config(void)
                PJSIP_HANDLE_EVENTS_HAS_SLEEP_ON_ERR));
     PJ_LOG(3, (id, " PJSIP_ACCEPT_MULTIPLE_SDP_ANSWERS                  : %d", 
                PJSIP_ACCEPT_MULTIPLE_SDP_ANSWERS));
+    PJ_LOG(3, (id, " PJSIP_LAZY_PARSE_HDR                               : %d", 
+               PJSIP_LAZY_PARSE_HDR));
     PJ_LOG(3, (id, " PJSIP_UDP_SIZE_THRESHOLD                           : %d", 
                PJSIP_UDP_SIZE_THRESHOLD));
     PJ_LOG(3, (id, " PJSIP_INCLUDE_ALLOW_HDR_IN_DLG                     : %d", 
@@ -118,6 +129,12 @@ PJ_DEF(void) pjsip_dump_config(void)
                PJSIP_TLS_TRANSPORT_DONT_CREATE_LISTENER));
     PJ_LOG(3, (id, " PJSIP_TCP_KEEP_ALIVE_INTERVAL                      : %d", 
                PJSIP_TCP_KEEP_ALIVE_INTERVAL));
+    PJ_LOG(3, (id, " PJSIP_TCP_COALESCE_MAX_SIZE                        : %d", 
+               PJSIP_TCP_COALESCE_MAX_SIZE));
+    PJ_LOG(3, (id, " PJSIP_TCP_COALESCE_DELAY                           : %d", 
+               PJSIP_TCP_COALESCE_DELAY));
+    PJ_LOG(3, (id, " PJSIP_TCP_RELEASE_IDLE_RX_POOL                     : %d", 
+               PJSIP_TCP_RELEASE_IDLE_RX_POOL));
     PJ_LOG(3, (id, " PJSIP_POOL_INC_TRANSPORT                           : %d", 
                PJSIP_POOL_INC_TRANSPORT));
     PJ_LOG(3, (id, " PJSIP_POOL_LEN_TDATA                               : %d", 
@@ -238,6 +255,8 @@ PJ_DEF(void) pjsip_dump_config(void)
                pjsip_cfg()->endpt.accept_multiple_sdp_answers));
     PJ_LOG(3, (id, " pjsip_cfg()->endpt.keep_inv_after_tsx_timeout      : %d", 
                pjsip_cfg()->endpt.keep_inv_after_tsx_timeout));
+    PJ_LOG(3, (id, " pjsip_cfg()->endpt.lazy_parse_hdr                  : %d", 
+               pjsip_cfg()->endpt.lazy_parse_hdr));
     PJ_LOG(3, (id, " pjsip_cfg()->tsx.max_count                         : %d", 
                pjsip_cfg()->tsx.max_count));
     PJ_LOG(3, (id, " pjsip_cfg()->tsx.t1                                : %d", 
@@ -34,6 +34,7 @@
 #include <pj/errno.h>
 #include <pj/lock.h>
 #include <pj/math.h>
+#include <pj/ring.h>
 
 #define PJSIP_EX_NO_MEMORY  pj_NO_MEMORY_EXCEPTION()
 #define THIS_FILE           "sip_endpoint.c"
@@ -49,6 +50,33 @@ typedef struct exit_cb
 } exit_cb;
 
 
+/* Incoming message queued to a dispatch thread. */
+typedef struct dispatch_item
+{
+    pjsip_rx_data       *rdata;
+    pj_timestamp         rx_ts;
+} dispatch_item;
+
+/* Dispatch thread, see pjsip_endpt_start_dispatch(). */
+typedef struct dispatch_worker
+{
+    pjsip_endpoint      *endpt;
+    pj_thread_t         *thread;
+    pj_sem_t            *sem;
+    pj_ring_t           *queue;
+    pj_bool_t            quit;
+
+    /* Statistics. The max_depth and full_cnt are updated by the receiving
+     * threads without locking, so they are only approximate.
+     */
+    unsigned             max_depth;
+    unsigned             full_cnt;
+    pj_uint32_t          processed;
+    pj_uint64_t          total_latency;
+    pj_uint32_t          max_latency;
+} dispatch_worker;
+
+
 /**
  * The SIP endpoint.
  */
@@ -75,6 +103,9 @@ struct pjsip_endpoint
     /** Ioqueue. */
     pj_ioqueue_t        *ioqueue;
 
+    /** Optional ioqueue shards for transport sockets. */
+    pj_ioqueue_group_t  *ioqueue_grp;
+
     /** Last ioqueue err */
     pj_status_t          ioq_last_err;
 
@@ -98,6 +129,18 @@ struct pjsip_endpoint
 
     /** List of exit callback. */
     exit_cb              exit_cb_list;
+
+    /** Lock for starting/stopping the dispatch stage. */
+    pj_rwmutex_t        *dispatch_mutex;
+
+    /** Pool for the dispatch stage. */
+    pj_pool_t           *dispatch_pool;
+
+    /** Number of dispatch threads, zero if the dispatch stage is off. */
+    unsigned             dispatch_cnt;
+
+    /** Dispatch threads. */
+    dispatch_worker     *dispatch;
 };
 
 
@@ -365,7 +408,10 @@ PJ_DEF(pj_status_t) pjsip_endpt_add_capability( pjsip_endpoint *endpt,
                                                 const pj_str_t tags[])
 {
     pjsip_generic_array_hdr *hdr;
+    pjsip_hdr_tpl *tpl;
+    pjsip_hdr *inst;
     unsigned i;
+    pj_status_t status;
 
     PJ_UNUSED_ARG(mod);
 
@@ -409,6 +455,18 @@ PJ_DEF(pj_status_t) pjsip_endpt_add_capability( pjsip_endpoint *endpt,
         ++hdr->count;
     }
 
+    /* Capability headers are copied to many outgoing messages, so replace
+     * the header with an instance of a pre-rendered template to save
+     * printing it every time.
+     */
+    status = pjsip_hdr_tpl_create(endpt->pool, hdr, &tpl);
+    if (status != PJ_SUCCESS)
+        return status;
+
+    inst = (pjsip_hdr*) pjsip_hdr_tpl_instance(endpt->pool, tpl);
+    pj_list_insert_before(hdr, inst);
+    pj_list_erase(hdr);
+
     /* Done. */
     return PJ_SUCCESS;
 }
@@ -467,6 +525,11 @@ PJ_DEF(pj_status_t) pjsip_endpt_create(pj_pool_factory *pf,
     if (status != PJ_SUCCESS)
         goto on_error;
 
+    /* Create R/W mutex for the dispatch stage. */
+    status = pj_rwmutex_create(endpt->pool, "epd%p", &endpt->dispatch_mutex);
+    if (status != PJ_SUCCESS)
+        goto on_error;
+
     /* Init parser. */
     init_sip_parser();
 
@@ -566,6 +629,10 @@ on_error:
         pj_rwmutex_destroy(endpt->mod_mutex);
         endpt->mod_mutex = NULL;
     }
+    if (endpt->dispatch_mutex) {
+        pj_rwmutex_destroy(endpt->dispatch_mutex);
+        endpt->dispatch_mutex = NULL;
+    }
     pj_pool_release( endpt->pool );
 
     PJ_PERROR(4, (THIS_FILE, status, "Error creating endpoint"));
@@ -582,6 +649,9 @@ PJ_DEF(void) pjsip_endpt_destroy(pjsip_endpoint *endpt)
 
     PJ_LOG(5, (THIS_FILE, "Destroying endpoint instance.."));
 
+    /* Process the queued messages while the modules are still there */
+    pjsip_endpt_stop_dispatch(endpt);
+
     /* Phase 1: stop all modules */
     mod = endpt->module_list.prev;
     while (mod != &endpt->module_list) {
@@ -631,6 +701,9 @@ PJ_DEF(void) pjsip_endpt_destroy(pjsip_endpoint *endpt)
     /* Delete module's mutex */
     pj_rwmutex_destroy(endpt->mod_mutex);
 
+    /* Delete dispatch mutex */
+    pj_rwmutex_destroy(endpt->dispatch_mutex);
+
     /* Finally destroy pool. */
     pj_pool_release(endpt->pool);
 
@@ -959,6 +1032,281 @@ on_return:
     return status;
 }
 
+/* Distribute incoming message to the modules. */
+static void distribute_rx_msg(pjsip_endpoint *endpt, pjsip_rx_data *rdata)
+{
+    pjsip_process_rdata_param proc_prm;
+    pj_bool_t handled = PJ_FALSE;
+
+    pjsip_process_rdata_param_default(&proc_prm);
+    proc_prm.silent = PJ_TRUE;
+
+    pjsip_endpt_process_rx_data(endpt, rdata, &proc_prm, &handled);
+
+    /* No module is able to handle the message */
+    if (!handled) {
+        PJ_LOG(4,(THIS_FILE, "%s from %s:%d was dropped/unhandled by"
+                             " any modules",
+                             pjsip_rx_data_get_info(rdata),
+                             rdata->pkt_info.src_name,
+                             rdata->pkt_info.src_port));
+    }
+
+    /* Must clear mod_data before returning rdata to transport, since
+     * rdata may be reused.
+     */
+    pj_bzero(&rdata->endpt_info, sizeof(rdata->endpt_info));
+}
+
+/* Dispatch thread. */
+static int dispatch_thread(void *arg)
+{
+    dispatch_worker *w = (dispatch_worker*)arg;
+    pjsip_endpoint *endpt = w->endpt;
+
+    for (;;) {
+        dispatch_item item;
+        pj_timestamp now;
+        pj_uint32_t latency;
+
+        pj_sem_wait(w->sem);
+
+        if (pj_ring_pop(w->queue, &item) != PJ_SUCCESS) {
+            /* Only woken up without message when stopping */
+            if (w->quit)
+                break;
+            continue;
+        }
+
+        pj_get_timestamp(&now);
+        latency = pj_elapsed_usec(&item.rx_ts, &now);
+        w->total_latency += latency;
+        if (latency > w->max_latency)
+            w->max_latency = latency;
+        ++w->processed;
+
+        pj_log_push_indent();
+        distribute_rx_msg(endpt, item.rdata);
+        pj_log_pop_indent();
+
+        pjsip_rx_data_free_cloned(item.rdata);
+    }
+
+    return 0;
+}
+
+/* Check if this is one of the dispatch threads. */
+static pj_bool_t is_dispatch_thread(pjsip_endpoint *endpt)
+{
+    pj_thread_t *this_thread = pj_thread_this();
+    unsigned i;
+
+    for (i = 0; i < endpt->dispatch_cnt; ++i) {
+        if (endpt->dispatch[i].thread == this_thread)
+            return PJ_TRUE;
+    }
+    return PJ_FALSE;
+}
+
+/* Queue incoming message to the dispatch thread for its Call-ID. Returns
+ * PJ_FALSE if the message should be processed by the calling thread.
+ */
+static pj_bool_t dispatch_rx_msg(pjsip_endpoint *endpt, pjsip_rx_data *rdata)
+{
+    const pj_str_t *call_id = &rdata->msg_info.cid->id;
+    pj_uint32_t hval = pj_hash_calc(0, call_id->ptr, (unsigned)call_id->slen);
+    pjsip_rx_data *clone = NULL;
+    pj_bool_t queued = PJ_FALSE;
+
+    for (;;) {
+        dispatch_worker *w;
+        dispatch_item item;
+        unsigned depth;
+
+        pj_rwmutex_lock_read(endpt->dispatch_mutex);
+
+        /* A module callback polling the endpoint from a dispatch thread
+         * must not wait for its own queue.
+         */
+        if (endpt->dispatch_cnt == 0 || is_dispatch_thread(endpt))
+            break;
+
+        if (!clone && pjsip_rx_data_clone(rdata, 0, &clone) != PJ_SUCCESS) {
+            clone = NULL;
+            break;
+        }
+
+        w = &endpt->dispatch[hval % endpt->dispatch_cnt];
+        item.rdata = clone;
+        pj_get_timestamp(&item.rx_ts);
+
+        if (pj_ring_push(w->queue, &item) == PJ_SUCCESS) {
+            pj_sem_post(w->sem);
+            queued = PJ_TRUE;
+
+            depth = pj_ring_size(w->queue);
+            if (depth > w->max_depth)
+                w->max_depth = depth;
+            break;
+        }
+
+        /* The queue is full, wait for the thread to catch up. The lock
+         * is released meanwhile so that the dispatch stage can be stopped.
+         */
+        ++w->full_cnt;
+        pj_rwmutex_unlock_read(endpt->dispatch_mutex);
+        pj_thread_sleep(1);
+    }
+
+    pj_rwmutex_unlock_read(endpt->dispatch_mutex);
+
+    if (!queued && clone)
+        pjsip_rx_data_free_cloned(clone);
+
+    return queued;
+}
+
+/* Init with default */
+PJ_DEF(void) pjsip_dispatch_param_default(pjsip_dispatch_param *p)
+{
+    pj_bzero(p, sizeof(*p));
+    p->thread_cnt = PJSIP_DISPATCH_THREAD_CNT;
+    p->queue_size = PJSIP_DISPATCH_QUEUE_SIZE;
+}
+
+/*
+ * Start the dispatch threads.
+ */
+PJ_DEF(pj_status_t) pjsip_endpt_start_dispatch(pjsip_endpoint *endpt,
+                                               const pjsip_dispatch_param *prm)
+{
+    pjsip_dispatch_param def_prm;
+    dispatch_worker *workers;
+    pj_pool_t *pool;
+    unsigned i;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(endpt, PJ_EINVAL);
+
+    if (!prm) {
+        pjsip_dispatch_param_default(&def_prm);
+        prm = &def_prm;
+    }
+    PJ_ASSERT_RETURN(prm->thread_cnt && prm->queue_size, PJ_EINVAL);
+
+    pj_rwmutex_lock_write(endpt->dispatch_mutex);
+
+    if (endpt->dispatch_cnt) {
+        pj_rwmutex_unlock_write(endpt->dispatch_mutex);
+        return PJ_EEXISTS;
+    }
+
+    pool = pjsip_endpt_create_pool(endpt, "epdisp%p", 512, 512);
+    if (!pool) {
+        pj_rwmutex_unlock_write(endpt->dispatch_mutex);
+        return PJ_ENOMEM;
+    }
+
+    workers = (dispatch_worker*)
+              pj_pool_calloc(pool, prm->thread_cnt, sizeof(dispatch_worker));
+    endpt->dispatch_pool = pool;
+    endpt->dispatch = workers;
+
+    for (i = 0; i < prm->thread_cnt; ++i) {
+        dispatch_worker *w = &workers[i];
+        char name[PJ_MAX_OBJ_NAME];
+
+        w->endpt = endpt;
+
+        status = pj_ring_create(pool, PJ_RING_MPMC, prm->queue_size,
+                                sizeof(dispatch_item), &w->queue);
+        if (status != PJ_SUCCESS)
+            goto on_error;
+
+        status = pj_sem_create(pool, NULL, 0, prm->queue_size + 1, &w->sem);
+        if (status != PJ_SUCCESS)
+            goto on_error;
+
+        pj_ansi_snprintf(name, sizeof(name), "sipdisp%d", i);
+        status = pj_thread_create(pool, name, &dispatch_thread, w, 0, 0,
+                                  &w->thread);
+        if (status != PJ_SUCCESS)
+            goto on_error;
+    }
+
+    endpt->dispatch_cnt = prm->thread_cnt;
+    pj_rwmutex_unlock_write(endpt->dispatch_mutex);
+
+    PJ_LOG(4, (THIS_FILE, "Incoming messages are dispatched to %d threads",
+               prm->thread_cnt));
+    return PJ_SUCCESS;
+
+on_error:
+    for (i = 0; i < prm->thread_cnt; ++i) {
+        dispatch_worker *w = &workers[i];
+        if (w->thread) {
+            w->quit = PJ_TRUE;
+            pj_sem_post(w->sem);
+            pj_thread_join(w->thread);
+            pj_thread_destroy(w->thread);
+        }
+        if (w->sem)
+            pj_sem_destroy(w->sem);
+        if (w->queue)
+            pj_ring_destroy(w->queue);
+    }
+    endpt->dispatch = NULL;
+    endpt->dispatch_pool = NULL;
+    pjsip_endpt_release_pool(endpt, pool);
+    pj_rwmutex_unlock_write(endpt->dispatch_mutex);
+    return status;
+}
+
+/*
+ * Stop the dispatch threads.
+ */
+PJ_DEF(pj_status_t) pjsip_endpt_stop_dispatch(pjsip_endpoint *endpt)
+{
+    dispatch_worker *workers;
+    pj_pool_t *pool;
+    unsigned i, cnt;
+
+    PJ_ASSERT_RETURN(endpt, PJ_EINVAL);
+
+    /* Stop queueing. The threads are not joined with the lock held, since
+     * the modules may receive messages while processing the remaining
+     * ones (e.g. with the loop transport).
+     */
+    pj_rwmutex_lock_write(endpt->dispatch_mutex);
+
+    cnt = endpt->dispatch_cnt;
+    workers = endpt->dispatch;
+    pool = endpt->dispatch_pool;
+    endpt->dispatch_cnt = 0;
+    endpt->dispatch = NULL;
+    endpt->dispatch_pool = NULL;
+    for (i = 0; i < cnt; ++i)
+        workers[i].quit = PJ_TRUE;
+
+    pj_rwmutex_unlock_write(endpt->dispatch_mutex);
+
+    /* The threads process the remaining messages before quitting */
+    for (i = 0; i < cnt; ++i) {
+        dispatch_worker *w = &workers[i];
+
+        pj_sem_post(w->sem);
+        pj_thread_join(w->thread);
+        pj_thread_destroy(w->thread);
+        pj_sem_destroy(w->sem);
+        pj_ring_destroy(w->queue);
+    }
+
+    if (pool)
+        pjsip_endpt_release_pool(endpt, pool);
+
+    return PJ_SUCCESS;
+}
+
 /*
  * This is the callback that is called by the transport manager when it 
  * receives a message from the network.
@@ -968,8 +1316,6 @@ static void endpt_on_rx_msg( pjsip_endpoint *endpt,
                              pjsip_rx_data *rdata )
 {
     pjsip_msg *msg = rdata->msg_info.msg;
-    pjsip_process_rdata_param proc_prm;
-    pj_bool_t handled = PJ_FALSE;
 
     PJ_UNUSED_ARG(msg);
 
@@ -1078,24 +1424,9 @@ static void endpt_on_rx_msg( pjsip_endpoint *endpt,
     }
 #endif
 
-    pjsip_process_rdata_param_default(&proc_prm);
-    proc_prm.silent = PJ_TRUE;
-
-    pjsip_endpt_process_rx_data(endpt, rdata, &proc_prm, &handled);
-
-    /* No module is able to handle the message */
-    if (!handled) {
-        PJ_LOG(4,(THIS_FILE, "%s from %s:%d was dropped/unhandled by"
-                             " any modules",
-                             pjsip_rx_data_get_info(rdata),
-                             rdata->pkt_info.src_name,
-                             rdata->pkt_info.src_port));
-    }
-
-    /* Must clear mod_data before returning rdata to transport, since
-     * rdata may be reused.
-     */
-    pj_bzero(&rdata->endpt_info, sizeof(rdata->endpt_info));
+    /* Hand the message to a dispatch thread, if any */
+    if (endpt->dispatch_cnt == 0 || !dispatch_rx_msg(endpt, rdata))
+        distribute_rx_msg(endpt, rdata);
 
     pj_log_pop_indent();
 }
@@ -1221,6 +1552,37 @@ PJ_DEF(pj_ioqueue_t*) pjsip_endpt_get_ioqueue(pjsip_endpoint *endpt)
     return endpt->ioqueue;
 }
 
+/*
+ * Set ioqueue group.
+ */
+PJ_DEF(pj_status_t) pjsip_endpt_set_ioqueue_group(pjsip_endpoint *endpt,
+                                                  pj_ioqueue_group_t *grp)
+{
+    PJ_ASSERT_RETURN(endpt, PJ_EINVAL);
+    endpt->ioqueue_grp = grp;
+    return PJ_SUCCESS;
+}
+
+/*
+ * Get ioqueue group.
+ */
+PJ_DEF(pj_ioqueue_group_t*) pjsip_endpt_get_ioqueue_group(
+                                                pjsip_endpoint *endpt)
+{
+    return endpt->ioqueue_grp;
+}
+
+/*
+ * Get ioqueue for a transport socket.
+ */
+PJ_DEF(pj_ioqueue_t*) pjsip_endpt_get_ioqueue_shard(pjsip_endpoint *endpt,
+                                                    pj_uint32_t hash)
+{
+    if (endpt->ioqueue_grp)
+        return pj_ioqueue_group_select(endpt->ioqueue_grp, hash);
+    return endpt->ioqueue;
+}
+
 /*
  * Find/create transport.
  */
@@ -1306,6 +1668,8 @@ PJ_DEF(void) pjsip_endpt_log_error(  pjsip_endpoint *endpt,
 PJ_DEF(void) pjsip_endpt_dump( pjsip_endpoint *endpt, pj_bool_t detail )
 {
 #if PJ_LOG_MAX_LEVEL >= 3
+    unsigned i;
+
     PJ_LOG(5, (THIS_FILE, "pjsip_endpt_dump()"));
 
     /* Lock mutex. */
@@ -1340,6 +1704,22 @@ PJ_DEF(void) pjsip_endpt_dump( pjsip_endpoint *endpt, pj_bool_t detail )
               (unsigned long)pj_timer_heap_count(endpt->timer_heap)));
 #endif
 
+    /* Dispatch threads. */
+    pj_rwmutex_lock_read(endpt->dispatch_mutex);
+    for (i = 0; i < endpt->dispatch_cnt; ++i) {
+        dispatch_worker *w = &endpt->dispatch[i];
+
+        PJ_LOG(3,(THIS_FILE, " Dispatch thread %d: queue=%u (max %u, "
+                             "full %u), processed=%u, latency avg=%uus "
+                             "max=%uus",
+                  i, pj_ring_size(w->queue), w->max_depth, w->full_cnt,
+                  w->processed,
+                  w->processed ?
+                    (unsigned)(w->total_latency / w->processed) : 0,
+                  w->max_latency));
+    }
+    pj_rwmutex_unlock_read(endpt->dispatch_mutex);
+
     /* Unlock mutex. */
     pj_mutex_unlock(endpt->mutex);
 #else
@@ -148,6 +148,9 @@ const pjsip_hdr_name_info_t pjsip_hdr_names[] =
 static pj_str_t status_phrase[710];
 static int print_media_type(char *buf, unsigned len,
                             const pjsip_media_type *media);
+static pj_bool_t is_lazy_hdr(const pjsip_hdr *hdr);
+static pj_bool_t lazy_hdr_has_type(const pjsip_hdr *hdr, pjsip_hdr_e type);
+static pjsip_hdr* parse_lazy_hdr(const pjsip_hdr *hdr);
 
 static int init_status_phrase()
 {
@@ -367,6 +370,15 @@ PJ_DEF(void*)  pjsip_hdr_find( const void *hdr_list,
     for (; hdr!=end; hdr = hdr->next) {
         if (hdr->type == hdr_type)
             return (void*)hdr;
+
+        if (is_lazy_hdr(hdr) && lazy_hdr_has_type(hdr, hdr_type)) {
+            pjsip_hdr *parsed = parse_lazy_hdr(hdr);
+            if (parsed) {
+                if (parsed->type == hdr_type)
+                    return parsed;
+                hdr = parsed;
+            }
+        }
     }
     return NULL;
 }
@@ -381,6 +393,14 @@ PJ_DEF(void*)  pjsip_hdr_find_by_name( const void *hdr_list,
         hdr = end->next;
     }
     for (; hdr!=end; hdr = hdr->next) {
+        /* Compact names of unparsed headers are only known to the parser */
+        if (is_lazy_hdr(hdr) &&
+            (hdr->name.slen == 1 || pj_stricmp(&hdr->name, name) == 0))
+        {
+            pjsip_hdr *parsed = parse_lazy_hdr(hdr);
+            if (parsed)
+                hdr = parsed;
+        }
         if (pj_stricmp(&hdr->name, name) == 0)
             return (void*)hdr;
     }
@@ -398,6 +418,14 @@ PJ_DEF(void*)  pjsip_hdr_find_by_names( const void *hdr_list,
         hdr = end->next;
     }
     for (; hdr!=end; hdr = hdr->next) {
+        if (is_lazy_hdr(hdr) &&
+            (hdr->name.slen == 1 || pj_stricmp(&hdr->name, name) == 0 ||
+             pj_stricmp(&hdr->name, sname) == 0))
+        {
+            pjsip_hdr *parsed = parse_lazy_hdr(hdr);
+            if (parsed)
+                hdr = parsed;
+        }
         if (pj_stricmp(&hdr->name, name) == 0)
             return (void*)hdr;
         if (pj_stricmp(&hdr->name, sname) == 0)
@@ -629,6 +657,125 @@ PJ_DEF(int) pjsip_hdr_print_on( void *hdr_ptr, char *buf, pj_size_t len)
     return (*hdr->vptr->print_on)(hdr_ptr, buf, len);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+/*
+ * Header template.
+ *
+ * Instances of a template are shallow clones of the template's header
+ * with the vptr pointing to the template's own vptr, which must be the
+ * first member of the template so that the template can be reached from
+ * the instance.
+ */
+struct pjsip_hdr_tpl
+{
+    pjsip_hdr_vptr           vptr;      /* Must be the first member.    */
+    const pjsip_hdr_vptr    *hdr_vptr;  /* The header's original vptr.  */
+    pjsip_hdr               *hdr;       /* The header.                  */
+    pj_str_t                 text;      /* Pre-rendered header.         */
+};
+
+static void* hdr_tpl_clone(pj_pool_t *pool, const void *hdr_ptr)
+{
+    const pjsip_hdr_tpl *tpl = (const pjsip_hdr_tpl*)
+                               ((const pjsip_hdr*)hdr_ptr)->vptr;
+    pjsip_hdr *hdr;
+
+    /* Deep clone yields a regular header which may be modified */
+    hdr = (pjsip_hdr*) (*tpl->hdr_vptr->clone)(pool, hdr_ptr);
+    hdr->vptr = (pjsip_hdr_vptr*) tpl->hdr_vptr;
+    return hdr;
+}
+
+static void* hdr_tpl_shallow_clone(pj_pool_t *pool, const void *hdr_ptr)
+{
+    const pjsip_hdr_tpl *tpl = (const pjsip_hdr_tpl*)
+                               ((const pjsip_hdr*)hdr_ptr)->vptr;
+    pjsip_hdr *hdr;
+
+    hdr = (pjsip_hdr*) (*tpl->hdr_vptr->shallow_clone)(pool, hdr_ptr);
+    hdr->vptr = (pjsip_hdr_vptr*) &tpl->vptr;
+    return hdr;
+}
+
+static int hdr_tpl_print(void *hdr_ptr, char *buf, pj_size_t len)
+{
+    const pjsip_hdr_tpl *tpl = (const pjsip_hdr_tpl*)
+                               ((pjsip_hdr*)hdr_ptr)->vptr;
+
+    if ((pj_ssize_t)len < tpl->text.slen)
+        return -1;
+
+    pj_memcpy(buf, tpl->text.ptr, tpl->text.slen);
+    return (int)tpl->text.slen;
+}
+
+PJ_DEF(pj_status_t) pjsip_hdr_tpl_create( pj_pool_t *pool,
+                                          const void *hdr_ptr,
+                                          pjsip_hdr_tpl **p_tpl)
+{
+    const pjsip_hdr *hdr = (const pjsip_hdr*) hdr_ptr;
+    pjsip_hdr_tpl *tpl;
+    pj_size_t size = 256;
+    int len;
+
+    PJ_ASSERT_RETURN(pool && hdr && p_tpl, PJ_EINVAL);
+
+    tpl = PJ_POOL_ZALLOC_T(pool, pjsip_hdr_tpl);
+    tpl->hdr = (pjsip_hdr*) pjsip_hdr_clone(pool, hdr);
+    tpl->hdr_vptr = tpl->hdr->vptr;
+    tpl->vptr.clone = &hdr_tpl_clone;
+    tpl->vptr.shallow_clone = &hdr_tpl_shallow_clone;
+    tpl->vptr.print_on = &hdr_tpl_print;
+
+    /* Render the header, growing the buffer as necessary. The header's
+     * print function doesn't append the CRLF, so neither does the text.
+     */
+    for (;;) {
+        char *buf = (char*) pj_pool_alloc(pool, size);
+
+        len = pjsip_hdr_print_on(tpl->hdr, buf, size);
+        if (len >= 0) {
+            tpl->text.ptr = buf;
+            tpl->text.slen = len;
+            break;
+        }
+        if (size >= PJSIP_MAX_PKT_LEN)
+            return PJSIP_EMSGTOOLONG;
+        size <<= 1;
+    }
+
+    *p_tpl = tpl;
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(void*) pjsip_hdr_tpl_instance( pj_pool_t *pool,
+                                      const pjsip_hdr_tpl *tpl)
+{
+    pjsip_hdr *hdr;
+
+    PJ_ASSERT_RETURN(pool && tpl, NULL);
+
+    hdr = (pjsip_hdr*) (*tpl->hdr_vptr->shallow_clone)(pool, tpl->hdr);
+    hdr->vptr = (pjsip_hdr_vptr*) &tpl->vptr;
+    return hdr;
+}
+
+PJ_DEF(void) pjsip_hdr_tpl_detach( void *hdr_ptr)
+{
+    pjsip_hdr *hdr = (pjsip_hdr*) hdr_ptr;
+
+    if (hdr->vptr->print_on == &hdr_tpl_print) {
+        const pjsip_hdr_tpl *tpl = (const pjsip_hdr_tpl*) hdr->vptr;
+        hdr->vptr = (pjsip_hdr_vptr*) tpl->hdr_vptr;
+    }
+}
+
+PJ_DEF(const void*) pjsip_hdr_tpl_get_hdr( const pjsip_hdr_tpl *tpl)
+{
+    PJ_ASSERT_RETURN(tpl, NULL);
+    return tpl->hdr;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 /*
  * Status/Reason Phrase
@@ -833,6 +980,120 @@ static pjsip_generic_string_hdr* pjsip_generic_string_hdr_shallow_clone( pj_pool
     return hdr;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+/*
+ * Lazy header, i.e. a generic string header which value is parsed when
+ * the header is looked up.
+ */
+
+typedef struct lazy_hdr
+{
+    pjsip_generic_string_hdr    base;
+    pj_pool_t                  *pool;   /**< Pool to parse the value with. */
+} lazy_hdr;
+
+static lazy_hdr* lazy_hdr_clone( pj_pool_t *pool, const lazy_hdr *rhs);
+static lazy_hdr* lazy_hdr_shallow_clone( pj_pool_t *pool, const lazy_hdr *rhs);
+
+static pjsip_hdr_vptr lazy_hdr_vptr = 
+{
+    (pjsip_hdr_clone_fptr) &lazy_hdr_clone,
+    (pjsip_hdr_clone_fptr) &lazy_hdr_shallow_clone,
+    (pjsip_hdr_print_fptr) &pjsip_generic_string_hdr_print,
+};
+
+PJ_DEF(pjsip_generic_string_hdr*) pjsip_lazy_hdr_create(pj_pool_t *pool,
+                                                  const pj_str_t *hname,
+                                                  const pj_str_t *hvalue)
+{
+    lazy_hdr *hdr = PJ_POOL_ALLOC_T(pool, lazy_hdr);
+
+    pjsip_generic_string_hdr_init2(&hdr->base, (pj_str_t*)hname,
+                                   (pj_str_t*)hvalue);
+    hdr->base.vptr = &lazy_hdr_vptr;
+    hdr->pool = pool;
+    return &hdr->base;
+}
+
+static lazy_hdr* lazy_hdr_clone( pj_pool_t *pool, const lazy_hdr *rhs)
+{
+    lazy_hdr *hdr = PJ_POOL_ALLOC_T(pool, lazy_hdr);
+
+    pjsip_generic_string_hdr_init(pool, &hdr->base, &rhs->base.name,
+                                  &rhs->base.hvalue);
+    pj_strdup(pool, &hdr->base.sname, &rhs->base.sname);
+    hdr->base.vptr = &lazy_hdr_vptr;
+    hdr->pool = pool;
+    return hdr;
+}
+
+static lazy_hdr* lazy_hdr_shallow_clone( pj_pool_t *pool, const lazy_hdr *rhs)
+{
+    lazy_hdr *hdr = PJ_POOL_ALLOC_T(pool, lazy_hdr);
+
+    pj_memcpy(hdr, rhs, sizeof(*hdr));
+    hdr->pool = pool;
+    return hdr;
+}
+
+static pj_bool_t is_lazy_hdr(const pjsip_hdr *hdr)
+{
+    return hdr->vptr == &lazy_hdr_vptr;
+}
+
+/* Check if the unparsed header would be of the specified type once parsed,
+ * by comparing its name with the standard header names.
+ */
+static pj_bool_t lazy_hdr_has_type(const pjsip_hdr *hdr, pjsip_hdr_e type)
+{
+    const pjsip_hdr_name_info_t *info;
+    pj_str_t name;
+
+    if ((unsigned)type >= PJSIP_H_OTHER)
+        return PJ_FALSE;
+
+    info = &pjsip_hdr_names[type];
+    if (hdr->name.slen == 1) {
+        return info->sname &&
+               pj_tolower(hdr->name.ptr[0]) == pj_tolower(info->sname[0]);
+    }
+
+    name.ptr = info->name;
+    name.slen = info->name_len;
+    return pj_stricmp(&hdr->name, &name) == 0;
+}
+
+/* Parse the unparsed header, and replace it with the result in the header
+ * list. Returns the first parsed header, or NULL if the value can't be
+ * parsed, in which case the header is turned into plain generic string
+ * header so that it won't be parsed again.
+ */
+static pjsip_hdr* parse_lazy_hdr(const pjsip_hdr *h)
+{
+    lazy_hdr *hdr = (lazy_hdr*)h;
+    pjsip_hdr *parsed;
+    pj_str_t hvalue;
+
+    /* The parser needs NULL terminated input */
+    pj_strdup_with_null(hdr->pool, &hvalue, &hdr->base.hvalue);
+
+    parsed = (pjsip_hdr*) pjsip_parse_hdr(hdr->pool, &hdr->base.name,
+                                          hvalue.ptr, hvalue.slen, NULL);
+    if (!parsed) {
+        hdr->base.vptr = &generic_hdr_vptr;
+        return NULL;
+    }
+
+    /* The header may be in a list which the caller only has a const
+     * pointer to, e.g. pjsip_msg_find_hdr(), but replacing the header
+     * doesn't change the meaning of the list.
+     */
+    pj_list_insert_nodes_before(hdr, parsed);
+    pj_list_erase(hdr);
+
+    return parsed;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 /*
  * Generic pjsip_hdr_names/integer value header.
@@ -0,0 +1,362 @@
+/*
+ * Copyright (C) 2025 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <pjsip/sip_overload.h>
+#include <pjsip/sip_endpoint.h>
+#include <pjsip/sip_module.h>
+#include <pjsip/sip_transaction.h>
+#include <pjsip/sip_util.h>
+#include <pjsip/sip_errno.h>
+#include <pj/assert.h>
+#include <pj/lock.h>
+#include <pj/log.h>
+#include <pj/os.h>
+#include <pj/pool.h>
+#include <pj/string.h>
+
+#define THIS_FILE       "sip_overload.c"
+
+/* Interval to sample the number of transactions, in usec. Counting the
+ * transactions takes the lock of every stripe of the transaction table,
+ * so it's not done for every request.
+ */
+#define TSX_CNT_INTERVAL        10000
+
+static pj_status_t mod_ovl_unload(void);
+static pj_bool_t   mod_ovl_on_rx_request(pjsip_rx_data *rdata);
+
+/* Overload control module definition. */
+static struct mod_overload
+{
+    pjsip_module            mod;
+    pjsip_endpoint         *endpt;
+    pj_pool_t              *pool;
+    pj_lock_t              *lock;
+    pjsip_overload_param    prm;
+
+    /* Token bucket for the request rate, in millionths of a request */
+    pj_uint64_t             tokens;
+    pj_timestamp            last_refill;
+
+    /* Last sampled number of transactions */
+    unsigned                tsx_cnt;
+    pj_timestamp            last_tsx_cnt;
+
+    /* Whether the last request was shed, to log state changes */
+    pj_bool_t               shedding;
+
+    pjsip_overload_stat     stat;
+} mod_overload =
+{
+    {
+        NULL, NULL,                         /* prev, next.          */
+        { "mod-overload", 12 },             /* Name.                */
+        -1,                                 /* Id                   */
+        PJSIP_MOD_PRIORITY_TSX_LAYER-1,     /* Priority             */
+        NULL,                               /* load()               */
+        NULL,                               /* start()              */
+        NULL,                               /* stop()               */
+        &mod_ovl_unload,                    /* unload()             */
+        &mod_ovl_on_rx_request,             /* on_rx_request()      */
+        NULL,                               /* on_rx_response()     */
+        NULL,                               /* on_tx_request.       */
+        NULL,                               /* on_tx_response()     */
+        NULL,                               /* on_tsx_state()       */
+    }
+};
+
+
+PJ_DEF(void) pjsip_overload_param_default(pjsip_overload_param *prm)
+{
+    pj_bzero(prm, sizeof(*prm));
+    prm->max_tsx_cnt = pjsip_cfg()->tsx.max_count / 10 * 9;
+    prm->max_latency = PJSIP_OVERLOAD_MAX_LATENCY;
+    prm->action = PJSIP_OVERLOAD_REJECT;
+    prm->retry_after = PJSIP_OVERLOAD_RETRY_AFTER;
+}
+
+
+PJ_DEF(pj_status_t) pjsip_overload_init_module(pjsip_endpoint *endpt,
+                                        const pjsip_overload_param *prm)
+{
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(endpt, PJ_EINVAL);
+    PJ_ASSERT_RETURN(mod_overload.endpt == NULL, PJ_EINVALIDOP);
+
+    if (prm)
+        pj_memcpy(&mod_overload.prm, prm, sizeof(*prm));
+    else
+        pjsip_overload_param_default(&mod_overload.prm);
+
+    mod_overload.pool = pjsip_endpt_create_pool(endpt, "overload", 256, 256);
+    if (!mod_overload.pool)
+        return PJ_ENOMEM;
+
+    status = pj_lock_create_simple_mutex(mod_overload.pool, "overload",
+                                         &mod_overload.lock);
+    if (status != PJ_SUCCESS)
+        goto on_error;
+
+    /* Start with a full bucket */
+    mod_overload.tokens = (pj_uint64_t)mod_overload.prm.max_rate * 1000000;
+    pj_get_timestamp(&mod_overload.last_refill);
+    mod_overload.last_tsx_cnt = mod_overload.last_refill;
+    mod_overload.tsx_cnt = 0;
+    mod_overload.shedding = PJ_FALSE;
+    pj_bzero(&mod_overload.stat, sizeof(mod_overload.stat));
+
+    mod_overload.endpt = endpt;
+    status = pjsip_endpt_register_module(endpt, &mod_overload.mod);
+    if (status != PJ_SUCCESS)
+        goto on_error;
+
+    return PJ_SUCCESS;
+
+on_error:
+    if (mod_overload.lock) {
+        pj_lock_destroy(mod_overload.lock);
+        mod_overload.lock = NULL;
+    }
+    pjsip_endpt_release_pool(endpt, mod_overload.pool);
+    mod_overload.pool = NULL;
+    mod_overload.endpt = NULL;
+    return status;
+}
+
+
+PJ_DEF(pjsip_module*) pjsip_overload_instance(void)
+{
+    return mod_overload.endpt ? &mod_overload.mod : NULL;
+}
+
+
+PJ_DEF(pj_status_t) pjsip_overload_set_param(const pjsip_overload_param *prm)
+{
+    PJ_ASSERT_RETURN(prm, PJ_EINVAL);
+    PJ_ASSERT_RETURN(mod_overload.endpt, PJ_EINVALIDOP);
+
+    pj_lock_acquire(mod_overload.lock);
+    pj_memcpy(&mod_overload.prm, prm, sizeof(*prm));
+    if (mod_overload.tokens > (pj_uint64_t)prm->max_rate * 1000000)
+        mod_overload.tokens = (pj_uint64_t)prm->max_rate * 1000000;
+    pj_lock_release(mod_overload.lock);
+
+    return PJ_SUCCESS;
+}
+
+
+PJ_DEF(pj_status_t) pjsip_overload_get_stat(pjsip_overload_stat *stat,
+                                            pj_bool_t reset)
+{
+    PJ_ASSERT_RETURN(stat, PJ_EINVAL);
+    PJ_ASSERT_RETURN(mod_overload.endpt, PJ_EINVALIDOP);
+
+    pj_lock_acquire(mod_overload.lock);
+    pj_memcpy(stat, &mod_overload.stat, sizeof(*stat));
+    if (reset)
+        pj_bzero(&mod_overload.stat, sizeof(mod_overload.stat));
+    pj_lock_release(mod_overload.lock);
+
+    return PJ_SUCCESS;
+}
+
+
+static pj_status_t mod_ovl_unload(void)
+{
+    pj_lock_destroy(mod_overload.lock);
+    mod_overload.lock = NULL;
+    pjsip_endpt_release_pool(mod_overload.endpt, mod_overload.pool);
+    mod_overload.pool = NULL;
+    mod_overload.endpt = NULL;
+
+    return PJ_SUCCESS;
+}
+
+
+/* Requests that are never shed: ACK and CANCEL, which belong to a
+ * transaction that has been accepted, and requests inside a dialog.
+ */
+static pj_bool_t is_exempted(pjsip_rx_data *rdata)
+{
+    const pjsip_method *method = &rdata->msg_info.msg->line.req.method;
+
+    return method->id == PJSIP_ACK_METHOD ||
+           method->id == PJSIP_CANCEL_METHOD ||
+           rdata->msg_info.to->tag.slen != 0;
+}
+
+
+/* Check whether the request is a retransmission of a request that already
+ * has a transaction. This is only done before shedding a request, to keep
+ * the normal path from looking up the transaction table twice.
+ */
+static pj_bool_t is_retransmission(pjsip_rx_data *rdata)
+{
+    pj_str_t key;
+
+    if (pjsip_tsx_layer_instance()->id == -1)
+        return PJ_FALSE;
+
+    return pjsip_tsx_create_key(rdata->tp_info.pool, &key, PJSIP_ROLE_UAS,
+                                &rdata->msg_info.msg->line.req.method,
+                                rdata) == PJ_SUCCESS &&
+           pjsip_tsx_layer_find_tsx(&key, PJ_FALSE) != NULL;
+}
+
+
+/* Get the time elapsed between two timestamps in usec, clamped to one
+ * second. pj_elapsed_usec() alone would wrap after about 71 minutes
+ * without requests.
+ */
+static pj_uint32_t elapsed_usec(const pj_timestamp *start,
+                                const pj_timestamp *stop)
+{
+    pj_time_val elapsed = pj_elapsed_time(start, stop);
+
+    if (elapsed.sec < 0)
+        return 0;
+    if (elapsed.sec >= 1)
+        return 1000000;
+    return pj_elapsed_usec(start, stop);
+}
+
+
+/* Admit a new out-of-dialog request, or return the counter of the reason
+ * to shed it. Must be called with the lock held.
+ */
+static unsigned *check_overload(pjsip_rx_data *rdata)
+{
+    const pjsip_overload_param *prm = &mod_overload.prm;
+    pj_timestamp now;
+
+    pj_get_timestamp(&now);
+
+    if (prm->max_latency) {
+        pj_time_val wait;
+
+        pj_gettimeofday(&wait);
+        if (PJ_TIME_VAL_GT(wait, rdata->pkt_info.timestamp)) {
+            PJ_TIME_VAL_SUB(wait, rdata->pkt_info.timestamp);
+            if (PJ_TIME_VAL_MSEC(wait) > (long)prm->max_latency)
+                return &mod_overload.stat.shed_latency;
+        }
+    }
+
+    if (prm->max_tsx_cnt && pjsip_tsx_layer_instance()->id != -1) {
+        if (elapsed_usec(&mod_overload.last_tsx_cnt, &now) >=
+                TSX_CNT_INTERVAL)
+        {
+            mod_overload.tsx_cnt = pjsip_tsx_layer_get_tsx_count();
+            mod_overload.last_tsx_cnt = now;
+        }
+        if (mod_overload.tsx_cnt >= prm->max_tsx_cnt)
+            return &mod_overload.stat.shed_tsx;
+    }
+
+    if (prm->max_rate) {
+        pj_uint64_t max_tokens = (pj_uint64_t)prm->max_rate * 1000000;
+        pj_uint32_t elapsed;
+
+        /* Refill the bucket, up to one second worth of requests */
+        elapsed = elapsed_usec(&mod_overload.last_refill, &now);
+        mod_overload.last_refill = now;
+        mod_overload.tokens += (pj_uint64_t)elapsed * prm->max_rate;
+        if (mod_overload.tokens > max_tokens)
+            mod_overload.tokens = max_tokens;
+
+        if (mod_overload.tokens < 1000000)
+            return &mod_overload.stat.shed_rate;
+        mod_overload.tokens -= 1000000;
+    }
+
+    return NULL;
+}
+
+
+static pj_bool_t mod_ovl_on_rx_request(pjsip_rx_data *rdata)
+{
+    pjsip_overload_action action;
+    unsigned retry_after;
+    unsigned *reason;
+    pj_bool_t state_changed;
+
+    if (is_exempted(rdata))
+        return PJ_FALSE;
+
+    pj_lock_acquire(mod_overload.lock);
+    reason = check_overload(rdata);
+    if (!reason) {
+        ++mod_overload.stat.accepted;
+        state_changed = mod_overload.shedding;
+        mod_overload.shedding = PJ_FALSE;
+        pj_lock_release(mod_overload.lock);
+
+        if (state_changed) {
+            PJ_LOG(4,(THIS_FILE, "Overload cleared, accepting new requests"));
+        }
+        return PJ_FALSE;
+    }
+    pj_lock_release(mod_overload.lock);
+
+    if (is_retransmission(rdata))
+        return PJ_FALSE;
+
+    pj_lock_acquire(mod_overload.lock);
+    ++(*reason);
+    action = mod_overload.prm.action;
+    retry_after = mod_overload.prm.retry_after;
+    if (action == PJSIP_OVERLOAD_REJECT)
+        ++mod_overload.stat.rejected;
+    else
+        ++mod_overload.stat.dropped;
+    state_changed = !mod_overload.shedding;
+    mod_overload.shedding = PJ_TRUE;
+    pj_lock_release(mod_overload.lock);
+
+    if (state_changed) {
+        PJ_LOG(3,(THIS_FILE, "Overloaded (%s), shedding new requests",
+                  (reason == &mod_overload.stat.shed_rate ? "request rate" :
+                   (reason == &mod_overload.stat.shed_tsx ?
+                    "transaction count" : "latency"))));
+    }
+
+    if (action == PJSIP_OVERLOAD_REJECT) {
+        pjsip_hdr hdr_list;
+        pj_status_t status;
+
+        pj_list_init(&hdr_list);
+        if (retry_after) {
+            pjsip_retry_after_hdr *ra;
+
+            ra = pjsip_retry_after_hdr_create(rdata->tp_info.pool,
+                                              retry_after);
+            pj_list_push_back(&hdr_list, ra);
+        }
+
+        status = pjsip_endpt_respond_stateless(mod_overload.endpt, rdata,
+                                               PJSIP_SC_SERVICE_UNAVAILABLE,
+                                               NULL, &hdr_list, NULL);
+        if (status != PJ_SUCCESS) {
+            PJ_PERROR(4,(THIS_FILE, status,
+                         "Error sending 503 response to %s",
+                         pjsip_rx_data_get_info(rdata)));
+        }
+    }
+
+    return PJ_TRUE;
+}
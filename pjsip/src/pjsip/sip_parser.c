@@ -791,6 +791,62 @@ PJ_DEF(pj_status_t) pjsip_register_uri_parser( char *scheme,
     return PJ_SUCCESS;
 }
 
+/* Headers that are always parsed when the message is received, even in
+ * lazy parsing mode, since they are needed to process the message and
+ * are referenced by rdata->msg_info, or because the stack walks the
+ * header list looking for them by type (Contact, Expires and the
+ * authentication headers).
+ */
+static pj_bool_t is_eager_hdr(pjsip_parse_hdr_func *func,
+                              const pj_str_t *hname)
+{
+    static pjsip_parse_hdr_func *const eager_hdr[] =
+    {
+        &parse_hdr_via, &parse_hdr_call_id, &parse_hdr_cseq,
+        &parse_hdr_from, &parse_hdr_to, &parse_hdr_max_forwards,
+        &parse_hdr_route, &parse_hdr_rr, &parse_hdr_content_type,
+        &parse_hdr_content_len, &parse_hdr_require, &parse_hdr_supported,
+        &parse_hdr_contact, &parse_hdr_expires
+    };
+    /* The authentication header parsers are registered by
+     * sip_auth_parser.c, so match them by name.
+     */
+    static const pj_str_t eager_hname[] =
+    {
+        { "Authorization", 13 }, { "Proxy-Authorization", 19 },
+        { "WWW-Authenticate", 16 }, { "Proxy-Authenticate", 18 }
+    };
+    unsigned i;
+
+    for (i = 0; i < PJ_ARRAY_SIZE(eager_hdr); ++i) {
+        if (func == eager_hdr[i])
+            return PJ_TRUE;
+    }
+    for (i = 0; i < PJ_ARRAY_SIZE(eager_hname); ++i) {
+        if (pj_stricmp(hname, &eager_hname[i]) == 0)
+            return PJ_TRUE;
+    }
+    return PJ_FALSE;
+}
+
+/* Get the header value as is, including continuation lines, so that it
+ * can be parsed later.
+ */
+static void get_raw_hvalue(pj_scanner *scanner, pj_str_t *hvalue)
+{
+    char *start = scanner->curptr, *end = start;
+
+    while (!pj_scan_is_eof(scanner) && !IS_NEWLINE(*scanner->curptr)) {
+        pj_str_t line;
+
+        pj_scan_get_until_chr(scanner, "\r\n", &line);
+        end = line.ptr + line.slen;
+    }
+    pj_strset3(hvalue, start, end);
+
+    parse_hdr_end(scanner);
+}
+
 /* Public function to parse SIP message. */
 PJ_DEF(pjsip_msg*) pjsip_parse_msg( pj_pool_t *pool, 
                                     char *buf, pj_size_t size,
@@ -1025,6 +1081,7 @@ static pjsip_msg *int_parse_msg( pjsip_parse_ctx *ctx,
     volatile pj_bool_t parsing_headers;
     pjsip_msg *volatile msg = NULL;
     pjsip_ctype_hdr *volatile ctype_hdr = NULL;
+    pj_bool_t lazy = (ctx->rdata && pjsip_cfg()->endpt.lazy_parse_hdr);
 
     pj_str_t hname;
     pj_scanner *scanner = ctx->scanner;
@@ -1085,8 +1142,17 @@ parse_headers:
             /* Call the handler if found.
              * If no handler is found, then treat the header as generic
              * hname/hvalue pair.
+             * In lazy mode, keep the value of the header unparsed unless
+             * it's needed right away.
              */
-            if (func) {
+            if (func && lazy && !is_eager_hdr(func, &hname)) {
+                pj_str_t hvalue;
+
+                get_raw_hvalue(scanner, &hvalue);
+                hdr = (pjsip_hdr*) pjsip_lazy_hdr_create(pool, &hname,
+                                                         &hvalue);
+
+            } else if (func) {
                 hdr = (*func)(ctx);
 
                 /* Note:
@@ -66,16 +66,29 @@ static pj_status_t mod_tsx_layer_unload(void);
 static pj_bool_t   mod_tsx_layer_on_rx_request(pjsip_rx_data *rdata);
 static pj_bool_t   mod_tsx_layer_on_rx_response(pjsip_rx_data *rdata);
 
+/* One stripe of the transaction table. A transaction is registered in
+ * the stripe selected by the hash of its key, and to the htable2 of the
+ * stripe selected by the hash of its secondary key. Each stripe has its
+ * own pool since the tables allocate when they grow.
+ */
+typedef struct tsx_stripe
+{
+    pj_pool_t           *pool;
+    pj_mutex_t          *mutex;
+    pj_hash_table_t     *htable;
+    pj_hash_table_t     *htable2;
+} tsx_stripe;
+
 /* Transaction layer module definition. */
 static struct mod_tsx_layer
 {
     struct pjsip_module  mod;
     pj_pool_t           *pool;
     pjsip_endpoint      *endpt;
-    pj_mutex_t          *mutex;
-    pj_hash_table_t     *htable;
-    pj_hash_table_t     *htable2;
-} mod_tsx_layer = 
+    unsigned             stripe_cnt;
+    unsigned             stripe_shift;
+    tsx_stripe          *stripes;
+} mod_tsx_layer =
 {   {
         NULL, NULL,                     /* List's prev and next.    */
         { "mod-tsx-layer", 13 },        /* Module name.             */
@@ -495,16 +508,58 @@ PJ_DEF(void) pjsip_tsx_set_max_retransmit_count(int max)
  **
  *****************************************************************************
  **/
+/*
+ * Get the stripe of the transaction table for the hash value of a key.
+ * The tables index their slots with the low bits of the hash, so the
+ * stripe is taken from the high bits of a multiplicative mix to keep
+ * the keys evenly spread within each stripe.
+ */
+static tsx_stripe *get_stripe(pj_uint32_t hval)
+{
+    if (mod_tsx_layer.stripe_cnt == 1)
+        return &mod_tsx_layer.stripes[0];
+
+    return &mod_tsx_layer.stripes[(pj_uint32_t)(hval * 2654435761U) >>
+                                  mod_tsx_layer.stripe_shift];
+}
+
+
+/*
+ * Destroy the stripes of the transaction table.
+ */
+static void destroy_stripes(void)
+{
+    unsigned i;
+
+    for (i = 0; i < mod_tsx_layer.stripe_cnt; ++i) {
+        tsx_stripe *stripe = &mod_tsx_layer.stripes[i];
+
+        if (stripe->mutex) {
+            pj_mutex_destroy(stripe->mutex);
+            stripe->mutex = NULL;
+        }
+        if (stripe->pool) {
+            pjsip_endpt_release_pool(mod_tsx_layer.endpt, stripe->pool);
+            stripe->pool = NULL;
+        }
+    }
+}
+
+
 /*
  * Create transaction layer module and registers it to the endpoint.
  */
 PJ_DEF(pj_status_t) pjsip_tsx_layer_init_module(pjsip_endpoint *endpt)
 {
     pj_pool_t *pool;
+    unsigned i, table_size;
     pj_status_t status;
 
 
     PJ_ASSERT_RETURN(mod_tsx_layer.endpt==NULL, PJ_EINVALIDOP);
+    PJ_ASSERT_RETURN(PJSIP_TSX_LAYER_STRIPES > 0 &&
+                     (PJSIP_TSX_LAYER_STRIPES &
+                      (PJSIP_TSX_LAYER_STRIPES-1)) == 0, PJ_EINVAL);
 
     /* Initialize timer values */
     pjsip_tsx_initialize_timer_values();
@@ -527,32 +582,54 @@ PJ_DEF(pj_status_t) pjsip_tsx_layer_init_module(pjsip_endpoint *endpt)
     /* Initialize some attributes. */
     mod_tsx_layer.pool = pool;
     mod_tsx_layer.endpt = endpt;
+    mod_tsx_layer.stripe_cnt = PJSIP_TSX_LAYER_STRIPES;
+    mod_tsx_layer.stripe_shift = 32;
+    for (i = PJSIP_TSX_LAYER_STRIPES; i > 1; i >>= 1)
+        --mod_tsx_layer.stripe_shift;
+    mod_tsx_layer.stripes = (tsx_stripe*)
+                            pj_pool_calloc(pool, mod_tsx_layer.stripe_cnt,
+                                           sizeof(tsx_stripe));
+
+
+    /* Create the stripes. Open addressing tables grow with the number of
+     * transactions, and keep lookups short even when there are many more
+     * transactions than tsx.max_count. Each table only allocates from its
+     * stripe's pool, while holding the stripe's mutex.
+     */
+    table_size = (pjsip_cfg()->tsx.max_count + mod_tsx_layer.stripe_cnt - 1) /
+                 mod_tsx_layer.stripe_cnt;
+    for (i = 0; i < mod_tsx_layer.stripe_cnt; ++i) {
+        tsx_stripe *stripe = &mod_tsx_layer.stripes[i];
+
+        stripe->pool = pjsip_endpt_create_pool(endpt, "tsxstripe",
+                                               PJSIP_POOL_TSX_LAYER_LEN,
+                                               PJSIP_POOL_TSX_LAYER_INC);
+        if (!stripe->pool) {
+            status = PJ_ENOMEM;
+            goto on_error;
+        }
 
+        stripe->htable = pj_hash_create2(stripe->pool, table_size,
+                                         PJ_HASH_OPEN_ADDRESSING);
+        stripe->htable2 = pj_hash_create2(stripe->pool, table_size,
+                                          PJ_HASH_OPEN_ADDRESSING);
+        if (!stripe->htable || !stripe->htable2) {
+            status = PJ_ENOMEM;
+            goto on_error;
+        }
 
-    /* Create hash table. */
-    mod_tsx_layer.htable = pj_hash_create( pool, pjsip_cfg()->tsx.max_count );
-    mod_tsx_layer.htable2 = pj_hash_create(pool, pjsip_cfg()->tsx.max_count);
-    if (!mod_tsx_layer.htable || !mod_tsx_layer.htable2) {
-        pjsip_endpt_release_pool(endpt, pool);
-        return PJ_ENOMEM;
-    }
-
-    /* Create group lock. */
-    status = pj_mutex_create_recursive(pool, "tsxlayer", &mod_tsx_layer.mutex);
-    if (status != PJ_SUCCESS) {
-        pjsip_endpt_release_pool(endpt, pool);
-        return status;
+        status = pj_mutex_create_recursive(stripe->pool, "tsxlayer",
+                                           &stripe->mutex);
+        if (status != PJ_SUCCESS)
+            goto on_error;
     }
 
     /*
      * Register transaction layer module to endpoint.
      */
     status = pjsip_endpt_register_module( endpt, &mod_tsx_layer.mod );
-    if (status != PJ_SUCCESS) {
-        pj_mutex_destroy(mod_tsx_layer.mutex);
-        pjsip_endpt_release_pool(endpt, pool);
-        return status;
-    }
+    if (status != PJ_SUCCESS)
+        goto on_error;
 
     /* Register mod_stateful_util module (sip_util_statefull.c) */
     status = pjsip_endpt_register_module(endpt, &mod_stateful_util);
@@ -561,6 +638,12 @@ PJ_DEF(pj_status_t) pjsip_tsx_layer_init_module(pjsip_endpoint *endpt)
     }
 
     return PJ_SUCCESS;
+
+on_error:
+    destroy_stripes();
+    pjsip_endpt_release_pool(endpt, pool);
+    mod_tsx_layer.endpt = NULL;
+    return status;
 }
 
 
@@ -594,21 +677,35 @@ PJ_DEF(pj_status_t) pjsip_tsx_layer_destroy(void)
  */
 static pj_status_t mod_tsx_layer_register_tsx( pjsip_transaction *tsx)
 {
+    pj_uint32_t hval, hval2 = 0;
+    tsx_stripe *stripe;
+
     pj_assert(tsx->transaction_key.slen != 0);
 
-    /* Lock hash table mutex. */
-    pj_mutex_lock(mod_tsx_layer.mutex);
+#ifdef PRECALC_HASH
+    hval = tsx->hashed_key;
+    if (tsx->role == PJSIP_ROLE_UAS)
+        hval2 = tsx->hashed_key2;
+#else
+    hval = pj_hash_calc_tolower(0, NULL, &tsx->transaction_key);
+    if (tsx->role == PJSIP_ROLE_UAS)
+        hval2 = pj_hash_calc_tolower(0, NULL, &tsx->transaction_key2);
+#endif
+
+    /* Lock the stripe of the key. */
+    stripe = get_stripe(hval);
+    pj_mutex_lock(stripe->mutex);
 
     /* Check if no transaction with the same key exists. 
      * Do not use PJ_ASSERT_RETURN since it evaluates the expression
      * twice!
      */
-    if(pj_hash_get_lower(mod_tsx_layer.htable, 
+    if(pj_hash_get_lower(stripe->htable, 
                          tsx->transaction_key.ptr,
                          (unsigned)tsx->transaction_key.slen, 
-                         NULL))
+                         &hval))
     {
-        pj_mutex_unlock(mod_tsx_layer.mutex);
+        pj_mutex_unlock(stripe->mutex);
         PJ_LOG(2,(THIS_FILE, 
                   "Unable to register %.*s transaction (key exists)",
                   (int)tsx->method.name.slen,
@@ -618,37 +715,31 @@ static pj_status_t mod_tsx_layer_register_tsx( pjsip_transaction *tsx)
 
     TSX_TRACE_((THIS_FILE, 
                 "Transaction %p registered with hkey=0x%p and key=%.*s",
-                tsx, tsx->hashed_key, tsx->transaction_key.slen,
+                tsx, hval, tsx->transaction_key.slen,
                 tsx->transaction_key.ptr));
 
     /* Register the transaction to the hash tables. We register the tsx
      * to the secondary hash table only if it's UAS, for the purpose of
-     * detecting merged requests.
+     * detecting merged requests. The secondary key may belong to another
+     * stripe.
      */
-#ifdef PRECALC_HASH
-    pj_hash_set_lower( tsx->pool, mod_tsx_layer.htable,
+    pj_hash_set_lower( tsx->pool, stripe->htable,
                        tsx->transaction_key.ptr,
                        (unsigned)tsx->transaction_key.slen, 
-                       tsx->hashed_key, tsx);
+                       hval, tsx);
+
+    /* Unlock mutex. */
+    pj_mutex_unlock(stripe->mutex);
+
     if (tsx->role == PJSIP_ROLE_UAS) {
-        pj_hash_set_lower( tsx->pool, mod_tsx_layer.htable2,
+        stripe = get_stripe(hval2);
+        pj_mutex_lock(stripe->mutex);
+        pj_hash_set_lower( tsx->pool, stripe->htable2,
                            tsx->transaction_key2.ptr,
                            (unsigned)tsx->transaction_key2.slen,
-                           tsx->hashed_key2, tsx);
-    }
-#else
-    pj_hash_set_lower( tsx->pool, mod_tsx_layer.htable,
-                       tsx->transaction_key.ptr,
-                       tsx->transaction_key.slen, 0, tsx);
-    if (tsx->role == PJSIP_ROLE_UAS) {
-        pj_hash_set_lower( tsx->pool, mod_tsx_layer.htable2,
-                           tsx->transaction_key2.ptr,
-                           tsx->transaction_key2.slen, 0, tsx);
+                           hval2, tsx);
+        pj_mutex_unlock(stripe->mutex);
     }
-#endif
-
-    /* Unlock mutex. */
-    pj_mutex_unlock(mod_tsx_layer.mutex);
 
     return PJ_SUCCESS;
 }
@@ -659,6 +750,9 @@ static pj_status_t mod_tsx_layer_register_tsx( pjsip_transaction *tsx)
  */
 static void mod_tsx_layer_unregister_tsx( pjsip_transaction *tsx)
 {
+    pj_uint32_t hval, hval2 = 0;
+    tsx_stripe *stripe;
+
     if (mod_tsx_layer.mod.id == -1) {
         /* The transaction layer has been unregistered. This could happen
          * if the transaction was pending on transport and the application
@@ -671,37 +765,37 @@ static void mod_tsx_layer_unregister_tsx( pjsip_transaction *tsx)
     pj_assert(tsx->transaction_key.slen != 0);
     //pj_assert(tsx->state != PJSIP_TSX_STATE_NULL);
 
-    /* Lock hash table mutex. */
-    pj_mutex_lock(mod_tsx_layer.mutex);
+#ifdef PRECALC_HASH
+    hval = tsx->hashed_key;
+    if (tsx->role == PJSIP_ROLE_UAS)
+        hval2 = tsx->hashed_key2;
+#else
+    hval = pj_hash_calc_tolower(0, NULL, &tsx->transaction_key);
+    if (tsx->role == PJSIP_ROLE_UAS)
+        hval2 = pj_hash_calc_tolower(0, NULL, &tsx->transaction_key2);
+#endif
 
     /* Unregister the transaction from the hash tables. */
-#ifdef PRECALC_HASH
-    pj_hash_set_lower( NULL, mod_tsx_layer.htable, tsx->transaction_key.ptr,
-                       (unsigned)tsx->transaction_key.slen, tsx->hashed_key,
-                       NULL);
+    stripe = get_stripe(hval);
+    pj_mutex_lock(stripe->mutex);
+    pj_hash_set_lower( NULL, stripe->htable, tsx->transaction_key.ptr,
+                       (unsigned)tsx->transaction_key.slen, hval, NULL);
+    pj_mutex_unlock(stripe->mutex);
+
     if (tsx->role == PJSIP_ROLE_UAS) {
-        pj_hash_set_lower(NULL, mod_tsx_layer.htable2,
+        stripe = get_stripe(hval2);
+        pj_mutex_lock(stripe->mutex);
+        pj_hash_set_lower(NULL, stripe->htable2,
                           tsx->transaction_key2.ptr,
                           (unsigned)tsx->transaction_key2.slen,
-                          tsx->hashed_key2, NULL);
-    }
-#else
-    pj_hash_set_lower( NULL, mod_tsx_layer.htable, tsx->transaction_key.ptr,
-                       tsx->transaction_key.slen, 0, NULL);
-    if (tsx->role == PJSIP_ROLE_UAS) {
-        pj_hash_set_lower(NULL, mod_tsx_layer.htable2,
-                          tsx->transaction_key2.ptr,
-                          tsx->transaction_key2.slen, 0, NULL);
+                          hval2, NULL);
+        pj_mutex_unlock(stripe->mutex);
     }
-#endif
 
     TSX_TRACE_((THIS_FILE, 
                 "Transaction %p unregistered, hkey=0x%p and key=%.*s",
-                tsx, tsx->hashed_key, tsx->transaction_key.slen,
+                tsx, hval, tsx->transaction_key.slen,
                 tsx->transaction_key.ptr));
-
-    /* Unlock mutex. */
-    pj_mutex_unlock(mod_tsx_layer.mutex);
 }
 
 
@@ -711,14 +805,18 @@ static void mod_tsx_layer_unregister_tsx( pjsip_transaction *tsx)
  */
 PJ_DEF(unsigned) pjsip_tsx_layer_get_tsx_count(void)
 {
-    unsigned count;
+    unsigned i, count = 0;
 
     /* Are we registered? */
     PJ_ASSERT_RETURN(mod_tsx_layer.endpt!=NULL, 0);
 
-    pj_mutex_lock(mod_tsx_layer.mutex);
-    count = pj_hash_count(mod_tsx_layer.htable);
-    pj_mutex_unlock(mod_tsx_layer.mutex);
+    for (i = 0; i < mod_tsx_layer.stripe_cnt; ++i) {
+        tsx_stripe *stripe = &mod_tsx_layer.stripes[i];
+
+        pj_mutex_lock(stripe->mutex);
+        count += pj_hash_count(stripe->htable);
+        pj_mutex_unlock(stripe->mutex);
+    }
 
     return count;
 }
@@ -731,11 +829,15 @@ static pjsip_transaction* find_tsx( const pj_str_t *key, pj_bool_t lock,
                                     pj_bool_t add_ref )
 {
     pjsip_transaction *tsx;
-    pj_uint32_t hval = 0;
+    pj_uint32_t hval;
+    tsx_stripe *stripe;
 
-    pj_mutex_lock(mod_tsx_layer.mutex);
+    hval = pj_hash_calc_tolower(0, NULL, key);
+    stripe = get_stripe(hval);
+
+    pj_mutex_lock(stripe->mutex);
     tsx = (pjsip_transaction*)
-          pj_hash_get_lower( mod_tsx_layer.htable, key->ptr, 
+          pj_hash_get_lower( stripe->htable, key->ptr, 
                              (unsigned)key->slen, &hval );
     
     /* Prevent the transaction to get deleted before we have chance to lock it.
@@ -743,7 +845,7 @@ static pjsip_transaction* find_tsx( const pj_str_t *key, pj_bool_t lock,
     if (tsx)
         pj_grp_lock_add_ref(tsx->grp_lock);
     
-    pj_mutex_unlock(mod_tsx_layer.mutex);
+    pj_mutex_unlock(stripe->mutex);
 
     TSX_TRACE_((THIS_FILE, 
                 "Finding tsx with hkey=0x%p and key=%.*s: found %p",
@@ -803,26 +905,31 @@ static pj_status_t mod_tsx_layer_start(void)
 static pj_status_t mod_tsx_layer_stop(void)
 {
     pj_hash_iterator_t it_buf, *it;
+    unsigned i;
 
     PJ_LOG(4,(THIS_FILE, "Stopping transaction layer module"));
 
-    pj_mutex_lock(mod_tsx_layer.mutex);
-
     /* Destroy all transactions. */
-    it = pj_hash_first(mod_tsx_layer.htable, &it_buf);
-    while (it) {
-        pjsip_transaction *tsx = (pjsip_transaction*) 
-                                 pj_hash_this(mod_tsx_layer.htable, it);
-        pj_hash_iterator_t *next = pj_hash_next(mod_tsx_layer.htable, it);
-        if (tsx) {
-            pjsip_tsx_terminate(tsx, PJSIP_SC_SERVICE_UNAVAILABLE);
-            mod_tsx_layer_unregister_tsx(tsx);
-            tsx_shutdown(tsx);
+    for (i = 0; i < mod_tsx_layer.stripe_cnt; ++i) {
+        tsx_stripe *stripe = &mod_tsx_layer.stripes[i];
+
+        pj_mutex_lock(stripe->mutex);
+
+        it = pj_hash_first(stripe->htable, &it_buf);
+        while (it) {
+            pjsip_transaction *tsx = (pjsip_transaction*) 
+                                     pj_hash_this(stripe->htable, it);
+            pj_hash_iterator_t *next = pj_hash_next(stripe->htable, it);
+            if (tsx) {
+                pjsip_tsx_terminate(tsx, PJSIP_SC_SERVICE_UNAVAILABLE);
+                mod_tsx_layer_unregister_tsx(tsx);
+                tsx_shutdown(tsx);
+            }
+            it = next;
         }
-        it = next;
-    }
 
-    pj_mutex_unlock(mod_tsx_layer.mutex);
+        pj_mutex_unlock(stripe->mutex);
+    }
 
     PJ_LOG(4,(THIS_FILE, "Stopped transaction layer module"));
 
@@ -835,8 +942,8 @@ static void tsx_layer_destroy(pjsip_endpoint *endpt)
 {
     PJ_UNUSED_ARG(endpt);
 
-    /* Destroy mutex. */
-    pj_mutex_destroy(mod_tsx_layer.mutex);
+    /* Destroy the stripes' mutexes and pools. */
+    destroy_stripes();
 
     /* Release pool. */
     pjsip_endpt_release_pool(mod_tsx_layer.endpt, mod_tsx_layer.pool);
@@ -853,13 +960,18 @@ static void tsx_layer_destroy(pjsip_endpoint *endpt)
  */
 static pj_status_t mod_tsx_layer_unload(void)
 {
+    unsigned i, count = 0;
+
+    for (i = 0; i < mod_tsx_layer.stripe_cnt; ++i)
+        count += pj_hash_count(mod_tsx_layer.stripes[i].htable);
+
     /* Only self destroy when there's no transaction in the table.
      * Transaction may refuse to destroy when it has pending
      * transmission. If we destroy the module now, application will
      * crash when the pending transaction finally got error response
      * from transport and when it tries to unregister itself.
      */
-    if (pj_hash_count(mod_tsx_layer.htable) != 0) {
+    if (count != 0) {
         pj_status_t status;
         status = pjsip_endpt_atexit(mod_tsx_layer.endpt, &tsx_layer_destroy);
         if (status != PJ_SUCCESS) {
@@ -880,7 +992,8 @@ PJ_DEF(pjsip_transaction *)
 pjsip_tsx_detect_merged_requests(pjsip_rx_data *rdata)
 {
     pj_str_t key, key2;
-    pj_uint32_t hval = 0;
+    pj_uint32_t hval;
+    tsx_stripe *stripe;
     pjsip_transaction *tsx = NULL;
     pj_status_t status;
 
@@ -897,17 +1010,18 @@ pjsip_tsx_detect_merged_requests(pjsip_rx_data *rdata)
     if (status != PJ_SUCCESS)
         return NULL;
 
-    pj_mutex_lock( mod_tsx_layer.mutex );
-
     /* This request must not match any transaction in our primary hash
      * table.
      */
-    if (pj_hash_get_lower(mod_tsx_layer.htable, key.ptr, (unsigned)key.slen,
-                          &hval) != NULL)
-    {
-        pj_mutex_unlock( mod_tsx_layer.mutex);
+    hval = pj_hash_calc_tolower(0, NULL, &key);
+    stripe = get_stripe(hval);
+    pj_mutex_lock( stripe->mutex );
+    tsx = pj_hash_get_lower(stripe->htable, key.ptr, (unsigned)key.slen,
+                            &hval);
+    pj_mutex_unlock( stripe->mutex );
+
+    if (tsx != NULL)
         return NULL;
-    }
 
     /* Now check it against our secondary hash table, based on a key that
      * consists of From tag, CSeq, and Call-ID.
@@ -915,16 +1029,15 @@ pjsip_tsx_detect_merged_requests(pjsip_rx_data *rdata)
     status = create_tsx_key_2543(rdata->tp_info.pool, &key2, PJSIP_ROLE_UAS,
                                  &rdata->msg_info.cseq->method, rdata,
                                  PJ_FALSE);
-    if (status != PJ_SUCCESS) {
-        pj_mutex_unlock( mod_tsx_layer.mutex);
+    if (status != PJ_SUCCESS)
         return NULL;
-    }
 
-    hval = 0;
-    tsx = pj_hash_get_lower(mod_tsx_layer.htable2, key2.ptr,
+    hval = pj_hash_calc_tolower(0, NULL, &key2);
+    stripe = get_stripe(hval);
+    pj_mutex_lock( stripe->mutex );
+    tsx = pj_hash_get_lower(stripe->htable2, key2.ptr,
                             (unsigned)key2.slen, &hval);
-
-    pj_mutex_unlock( mod_tsx_layer.mutex);
+    pj_mutex_unlock( stripe->mutex );
 
     return tsx;
 }
@@ -935,17 +1048,20 @@ pjsip_tsx_detect_merged_requests(pjsip_rx_data *rdata)
 static pj_bool_t mod_tsx_layer_on_rx_request(pjsip_rx_data *rdata)
 {
     pj_str_t key;
-    pj_uint32_t hval = 0;
+    pj_uint32_t hval;
+    tsx_stripe *stripe;
     pjsip_transaction *tsx;
 
     pjsip_tsx_create_key(rdata->tp_info.pool, &key, PJSIP_ROLE_UAS,
                          &rdata->msg_info.cseq->method, rdata);
 
     /* Find transaction. */
-    pj_mutex_lock( mod_tsx_layer.mutex );
+    hval = pj_hash_calc_tolower(0, NULL, &key);
+    stripe = get_stripe(hval);
+    pj_mutex_lock( stripe->mutex );
 
     tsx = (pjsip_transaction*) 
-          pj_hash_get_lower( mod_tsx_layer.htable, key.ptr, (unsigned)key.slen, 
+          pj_hash_get_lower( stripe->htable, key.ptr, (unsigned)key.slen, 
                              &hval );
 
 
@@ -959,7 +1075,7 @@ static pj_bool_t mod_tsx_layer_on_rx_request(pjsip_rx_data *rdata)
          * Reject the request so that endpoint passes the request to
          * upper layer modules.
          */
-        pj_mutex_unlock( mod_tsx_layer.mutex);
+        pj_mutex_unlock( stripe->mutex);
         return PJ_FALSE;
     }
 
@@ -971,7 +1087,7 @@ static pj_bool_t mod_tsx_layer_on_rx_request(pjsip_rx_data *rdata)
         tsx->method.id == PJSIP_INVITE_METHOD &&
         tsx->status_code/100 == 2)
     {
-        pj_mutex_unlock( mod_tsx_layer.mutex);
+        pj_mutex_unlock( stripe->mutex);
         return PJ_FALSE;
     }
 
@@ -981,7 +1097,7 @@ static pj_bool_t mod_tsx_layer_on_rx_request(pjsip_rx_data *rdata)
     pj_grp_lock_add_ref(tsx->grp_lock);
     
     /* Unlock hash table. */
-    pj_mutex_unlock( mod_tsx_layer.mutex );
+    pj_mutex_unlock( stripe->mutex );
 
     /* Simulate race condition! */
     PJ_RACE_ME(5);
@@ -1001,17 +1117,20 @@ static pj_bool_t mod_tsx_layer_on_rx_request(pjsip_rx_data *rdata)
 static pj_bool_t mod_tsx_layer_on_rx_response(pjsip_rx_data *rdata)
 {
     pj_str_t key;
-    pj_uint32_t hval = 0;
+    pj_uint32_t hval;
+    tsx_stripe *stripe;
     pjsip_transaction *tsx;
 
     pjsip_tsx_create_key(rdata->tp_info.pool, &key, PJSIP_ROLE_UAC,
                          &rdata->msg_info.cseq->method, rdata);
 
     /* Find transaction. */
-    pj_mutex_lock( mod_tsx_layer.mutex );
+    hval = pj_hash_calc_tolower(0, NULL, &key);
+    stripe = get_stripe(hval);
+    pj_mutex_lock( stripe->mutex );
 
     tsx = (pjsip_transaction*) 
-          pj_hash_get_lower( mod_tsx_layer.htable, key.ptr, (unsigned)key.slen, 
+          pj_hash_get_lower( stripe->htable, key.ptr, (unsigned)key.slen, 
                              &hval );
 
 
@@ -1025,7 +1144,7 @@ static pj_bool_t mod_tsx_layer_on_rx_response(pjsip_rx_data *rdata)
          * Reject the request so that endpoint passes the request to
          * upper layer modules.
          */
-        pj_mutex_unlock( mod_tsx_layer.mutex);
+        pj_mutex_unlock( stripe->mutex);
         return PJ_FALSE;
     }
 
@@ -1035,7 +1154,7 @@ static pj_bool_t mod_tsx_layer_on_rx_response(pjsip_rx_data *rdata)
     pj_grp_lock_add_ref(tsx->grp_lock);
 
     /* Unlock hash table. */
-    pj_mutex_unlock( mod_tsx_layer.mutex );
+    pj_mutex_unlock( stripe->mutex );
 
     /* Simulate race condition! */
     PJ_RACE_ME(5);
@@ -1066,38 +1185,45 @@ PJ_DEF(void) pjsip_tsx_layer_dump(pj_bool_t detail)
 {
 #if PJ_LOG_MAX_LEVEL >= 3
     pj_hash_iterator_t itbuf, *it;
-
-    /* Lock mutex. */
-    pj_mutex_lock(mod_tsx_layer.mutex);
+    unsigned i, count = 0;
 
     PJ_LOG(3, (THIS_FILE, "Dumping transaction table:"));
-    PJ_LOG(3, (THIS_FILE, " Total %d transactions", 
-                          pj_hash_count(mod_tsx_layer.htable)));
+    PJ_LOG(3, (THIS_FILE, " Total %d transactions in %d stripes", 
+                          pjsip_tsx_layer_get_tsx_count(),
+                          mod_tsx_layer.stripe_cnt));
 
-    if (detail) {
-        it = pj_hash_first(mod_tsx_layer.htable, &itbuf);
-        if (it == NULL) {
-            PJ_LOG(3, (THIS_FILE, " - none - "));
-        } else {
-            while (it != NULL) {
-                pjsip_transaction *tsx = (pjsip_transaction*) 
-                                         pj_hash_this(mod_tsx_layer.htable,it);
-
-                PJ_LOG(3, (THIS_FILE, " %s %s|%d|%s",
-                           tsx->obj_name,
-                           (tsx->last_tx? 
-                                pjsip_tx_data_get_info(tsx->last_tx): 
-                                "none"),
-                           tsx->status_code,
-                           pjsip_tsx_state_str(tsx->state)));
-
-                it = pj_hash_next(mod_tsx_layer.htable, it);
-            }
+    if (!detail)
+        return;
+
+    for (i = 0; i < mod_tsx_layer.stripe_cnt; ++i) {
+        tsx_stripe *stripe = &mod_tsx_layer.stripes[i];
+
+        /* Lock mutex. */
+        pj_mutex_lock(stripe->mutex);
+
+        it = pj_hash_first(stripe->htable, &itbuf);
+        while (it != NULL) {
+            pjsip_transaction *tsx = (pjsip_transaction*) 
+                                     pj_hash_this(stripe->htable, it);
+
+            PJ_LOG(3, (THIS_FILE, " %s %s|%d|%s",
+                       tsx->obj_name,
+                       (tsx->last_tx? 
+                            pjsip_tx_data_get_info(tsx->last_tx): 
+                            "none"),
+                       tsx->status_code,
+                       pjsip_tsx_state_str(tsx->state)));
+
+            ++count;
+            it = pj_hash_next(stripe->htable, it);
         }
+
+        /* Unlock mutex. */
+        pj_mutex_unlock(stripe->mutex);
     }
 
-    /* Unlock mutex. */
-    pj_mutex_unlock(mod_tsx_layer.mutex);
+    if (count == 0)
+        PJ_LOG(3, (THIS_FILE, " - none - "));
 #endif
 }
 
@@ -144,6 +144,13 @@ struct pjsip_tpmgr
 {
     pj_hash_table_t *table;
     pj_lock_t       *lock;
+
+    /* Read/write lock of the transport table. Modifying the table requires
+     * both the manager lock and the write lock, while looking up needs
+     * only one of them, so that transports can be acquired without taking
+     * the manager lock.
+     */
+    pj_rwmutex_t    *table_lock;
     pjsip_endpoint  *endpt;
     pjsip_tpfactory  factory_list;
     pj_pool_t       *pool;
@@ -1108,12 +1115,15 @@ static void transport_idle_callback(pj_timer_heap_t *timer_heap,
     entry->id = PJ_FALSE;
 
     /* Set is_destroying flag under transport manager mutex to avoid
-     * race condition with pjsip_tpmgr_acquire_transport2().
+     * race condition with pjsip_tpmgr_acquire_transport2(). The table
+     * write lock excludes the lookups which don't take the mutex.
      */
     pj_lock_acquire(tp->tpmgr->lock);
+    pj_rwmutex_lock_write(tp->tpmgr->table_lock);
 
     if (pj_atomic_get(tp->ref_cnt) == 0) {
         tp->is_destroying = PJ_TRUE;
+        pj_rwmutex_unlock_write(tp->tpmgr->table_lock);
         PJ_LOG(4, (THIS_FILE, "Transport %s is being destroyed "
                   "due to timeout in %s timer", tp->obj_name, 
                   (entry_id == IDLE_TIMER_ID)?"idle":"initial"));
@@ -1129,6 +1139,7 @@ static void transport_idle_callback(pj_timer_heap_t *timer_heap,
             }
         }
     } else {
+        pj_rwmutex_unlock_write(tp->tpmgr->table_lock);
         pj_lock_release(tp->tpmgr->lock);
         return;
     }
@@ -1318,6 +1329,7 @@ PJ_DEF(pj_status_t) pjsip_transport_register( pjsip_tpmgr *mgr,
     tp_add->tp = tp;
     pj_list_erase(tp_add);
 
+    pj_rwmutex_lock_write(mgr->table_lock);
     if (tp_ref) {
         /* There'a already a transport list from the hash table. Add the 
          * new transport to the list.
@@ -1332,6 +1344,7 @@ PJ_DEF(pj_status_t) pjsip_transport_register( pjsip_tpmgr *mgr,
         TRACE_((THIS_FILE, "Remote address not registered, "
                            "added the transport to the hash"));
     }
+    pj_rwmutex_unlock_write(mgr->table_lock);
 
     /* Add ref transport group lock, if any */
     if (tp->grp_lock)
@@ -1379,6 +1392,7 @@ static pj_status_t destroy_transport( pjsip_tpmgr *mgr,
      */
     key_len = sizeof(tp->key.type) + tp->addr_len;
     hval = 0;
+    pj_rwmutex_lock_write(mgr->table_lock);
     entry = pj_hash_get(mgr->table, &tp->key, key_len, &hval);
     if (entry) {
         transport *tp_ref = (transport *)entry;
@@ -1427,6 +1441,7 @@ static pj_status_t destroy_transport( pjsip_tpmgr *mgr,
         PJ_LOG(3, (THIS_FILE, "Warning: transport %s being destroyed is "
                               "not found in the hash table", tp->obj_name));
     }
+    pj_rwmutex_unlock_write(mgr->table_lock);
 
     pj_lock_release(mgr->lock);
     pj_lock_release(tp->lock);
@@ -1655,7 +1670,11 @@ PJ_DEF(pj_status_t) pjsip_tpmgr_create( pj_pool_t *pool,
     pj_list_init(&mgr->tdata_list);
     pj_list_init(&mgr->tp_entry_freelist);
 
-    mgr->table = pj_hash_create(mgr->pool, PJSIP_TPMGR_HTABLE_SIZE);
+    /* The table grows as transports are added, so that the lookup stays
+     * fast with a large number of connections.
+     */
+    mgr->table = pj_hash_create2(mgr->pool, PJSIP_TPMGR_HTABLE_SIZE,
+                                 PJ_HASH_OPEN_ADDRESSING);
     if (!mgr->table)
         return PJ_ENOMEM;
 
@@ -1663,6 +1682,12 @@ PJ_DEF(pj_status_t) pjsip_tpmgr_create( pj_pool_t *pool,
     if (status != PJ_SUCCESS)
         return status;
 
+    status = pj_rwmutex_create(mgr->pool, "tmgr%p", &mgr->table_lock);
+    if (status != PJ_SUCCESS) {
+        pj_lock_destroy(mgr->lock);
+        return status;
+    }
+
     for (; i < PJSIP_TRANSPORT_ENTRY_ALLOC_CNT; ++i) {
         transport *tp_add = NULL;
 
@@ -1676,6 +1701,7 @@ PJ_DEF(pj_status_t) pjsip_tpmgr_create( pj_pool_t *pool,
 #if defined(PJ_DEBUG) && PJ_DEBUG!=0
     status = pj_atomic_create(mgr->pool, 0, &mgr->tdata_counter);
     if (status != PJ_SUCCESS) {
+        pj_rwmutex_destroy(mgr->table_lock);
         pj_lock_destroy(mgr->lock);
         return status;
     }
@@ -2013,6 +2039,7 @@ PJ_DEF(pj_status_t) pjsip_tpmgr_destroy( pjsip_tpmgr *mgr )
     pj_atomic_destroy(mgr->tdata_counter);
 #endif
 
+    pj_rwmutex_destroy(mgr->table_lock);
     pj_lock_destroy(mgr->lock);
 
     /* Unregister mod_msg_print. */
@@ -2446,6 +2473,151 @@ PJ_DEF(pj_status_t) pjsip_tpmgr_acquire_transport(pjsip_tpmgr *mgr,
 }
 
 
+/*
+ * Find a usable transport to the destination in the transport table,
+ * matching the listener in the selector if it is specified. The caller
+ * must hold either the transport manager lock or the table read lock.
+ */
+static pjsip_transport *find_transport(pjsip_tpmgr *mgr,
+                                       const pjsip_transport_key *key,
+                                       int key_len,
+                                       const pjsip_tpselector *sel,
+                                       const pjsip_tx_data *tdata)
+{
+    unsigned flag = pjsip_transport_get_flag_from_type(key->type);
+    pjsip_transport *tp_ref = NULL;
+    transport *tp_entry;
+    transport *tp_iter;
+
+    tp_entry = (transport *)pj_hash_get(mgr->table, key, key_len, NULL);
+    if (!tp_entry)
+        return NULL;
+
+    TRACE_((THIS_FILE, "Found one, checking further (e.g: "
+                       "destroying, verify hostname, etc).."));
+
+    tp_iter = tp_entry;
+    do {
+        /* Don't use transport being shutdown/destroyed */
+        if (!tp_iter->tp->is_shutdown && !tp_iter->tp->is_destroying) {
+            if ((flag & PJSIP_TRANSPORT_SECURE) && tdata) {
+                /* For secure transport, make sure tdata's
+                 * destination host matches the transport's
+                 * remote host.
+                 */
+                if (pj_stricmp(&tdata->dest_info.name,
+                               &tp_iter->tp->remote_name.host))
+                {
+                    TRACE_((THIS_FILE, "Skipping secure transport "
+                                       "with different hostname"));
+                    tp_iter = tp_iter->next;
+                    continue;
+                }
+            }
+
+            if (sel && sel->type == PJSIP_TPSELECTOR_LISTENER &&
+                sel->u.listener)
+            {
+                /* Match listener if selector is set */
+                if (tp_iter->tp->factory == sel->u.listener) {
+                    tp_ref = tp_iter->tp;
+                    break;
+                }
+                TRACE_((THIS_FILE, "Skipping transport "
+                                   "with different listener"));
+            } else {
+                tp_ref = tp_iter->tp;
+                break;
+            }
+        }
+        tp_iter = tp_iter->next;
+    } while (tp_iter != tp_entry);
+
+    TRACE_((THIS_FILE, "Search by remote address found %s",
+                       tp_ref? "one" : "none"));
+
+    return tp_ref;
+}
+
+
+/*
+ * Look up an existing transport to the destination without taking the
+ * transport manager lock, so that sending requests over established
+ * connections doesn't contend on it. Only the common cases are handled
+ * here, everything else is left to pjsip_tpmgr_acquire_transport2().
+ */
+static pjsip_transport *fast_acquire_transport(pjsip_tpmgr *mgr,
+                                               pjsip_transport_type_e type,
+                                               const pj_sockaddr_t *remote,
+                                               int addr_len,
+                                               const pjsip_tpselector *sel,
+                                               const pjsip_tx_data *tdata)
+{
+    unsigned flag = pjsip_transport_get_flag_from_type(type);
+    pjsip_transport_key key;
+    int key_len;
+    pjsip_transport *tp_ref;
+    pj_bool_t was_idle = PJ_FALSE;
+
+    if (sel && sel->type != PJSIP_TPSELECTOR_NONE &&
+        (sel->type != PJSIP_TPSELECTOR_LISTENER || !sel->u.listener ||
+         sel->u.listener->type != type))
+    {
+        return NULL;
+    }
+    if (sel && sel->disable_connection_reuse)
+        return NULL;
+    if (type == PJSIP_TRANSPORT_LOOP || type == PJSIP_TRANSPORT_LOOP_DGRAM)
+        return NULL;
+
+    pj_bzero(&key, sizeof(key));
+    key_len = sizeof(key.type) + addr_len;
+    key.type = type;
+    pj_memcpy(&key.rem_addr, remote, addr_len);
+
+    pj_rwmutex_lock_read(mgr->table_lock);
+
+    tp_ref = find_transport(mgr, &key, key_len, sel, tdata);
+
+    /* Datagram transports are registered with zero address */
+    if (!tp_ref && (flag & PJSIP_TRANSPORT_DATAGRAM) &&
+        (!sel || sel->type == PJSIP_TPSELECTOR_NONE))
+    {
+        const pj_sockaddr *remote_addr = (const pj_sockaddr*)remote;
+
+        pj_bzero(&key.rem_addr, addr_len);
+        key.rem_addr.addr.sa_family = remote_addr->addr.sa_family;
+        tp_ref = find_transport(mgr, &key, key_len, NULL, NULL);
+    }
+
+    /* The reference must be added while the table is locked, so that the
+     * idle timer (which marks the transport as being destroyed with the
+     * table locked for writing) either sees it or is seen above.
+     */
+    if (tp_ref) {
+        if (tp_ref->grp_lock)
+            pj_grp_lock_add_ref(tp_ref->grp_lock);
+        was_idle = (pj_atomic_inc_and_get(tp_ref->ref_cnt) == 1);
+    }
+
+    pj_rwmutex_unlock_read(mgr->table_lock);
+
+    /* The transport was idle, stop the idle timer as
+     * pjsip_transport_add_ref() does.
+     */
+    if (was_idle) {
+        pj_lock_acquire(mgr->lock);
+        if (tp_ref->idle_timer.id != PJ_FALSE) {
+            tp_ref->idle_timer.id = PJ_FALSE;
+            pjsip_endpt_cancel_timer(mgr->endpt, &tp_ref->idle_timer);
+        }
+        pj_lock_release(mgr->lock);
+    }
+
+    return tp_ref;
+}
+
+
 /*
  * pjsip_tpmgr_acquire_transport2()
  *
@@ -2472,6 +2644,12 @@ PJ_DEF(pj_status_t) pjsip_tpmgr_acquire_transport2(pjsip_tpmgr *mgr,
                        tdata? tdata->dest_info.name.slen : 10,
                        tdata? tdata->dest_info.name.ptr  : "-no tdata-"));
 
+    *tp = fast_acquire_transport(mgr, type, remote, addr_len, sel, tdata);
+    if (*tp) {
+        TRACE_((THIS_FILE, "Transport %s acquired", (*tp)->obj_name));
+        return PJ_SUCCESS;
+    }
+
     pj_lock_acquire(mgr->lock);
 
     TRACE_((THIS_FILE, "Acquiring transport got the lock"));
@@ -2560,55 +2738,7 @@ PJ_DEF(pj_status_t) pjsip_tpmgr_acquire_transport2(pjsip_tpmgr *mgr,
             key.type = type;
             pj_memcpy(&key.rem_addr, remote, addr_len);
 
-            tp_entry = (transport *)pj_hash_get(mgr->table, &key, key_len,
-                                                NULL);
-            if (tp_entry) {
-                transport *tp_iter = tp_entry;
-
-                TRACE_((THIS_FILE, "Found one, checking further (e.g: "
-                                   "destroying, verify hostname, etc).."));
-
-                do {
-                    /* Don't use transport being shutdown/destroyed */
-                    if (!tp_iter->tp->is_shutdown &&
-                        !tp_iter->tp->is_destroying)
-                    {
-                        if ((flag & PJSIP_TRANSPORT_SECURE) && tdata) {
-                            /* For secure transport, make sure tdata's
-                             * destination host matches the transport's
-                             * remote host.
-                             */
-                            if (pj_stricmp(&tdata->dest_info.name,
-                                           &tp_iter->tp->remote_name.host))
-                            {
-                                TRACE_((THIS_FILE, "Skipping secure transport "
-                                                   "with different hostname"));
-                                tp_iter = tp_iter->next;
-                                continue;
-                            }
-                        }
-
-                        if (sel && sel->type == PJSIP_TPSELECTOR_LISTENER &&
-                            sel->u.listener)
-                        {
-                            /* Match listener if selector is set */
-                            if (tp_iter->tp->factory == sel->u.listener) {
-                                tp_ref = tp_iter->tp;
-                                break;
-                            }
-                            TRACE_((THIS_FILE, "Skipping transport "
-                                               "with different listener"));
-                        } else {
-                            tp_ref = tp_iter->tp;
-                            break;
-                        }
-                    }
-                    tp_iter = tp_iter->next;
-                } while (tp_iter != tp_entry);
-
-                TRACE_((THIS_FILE, "Search by remote address found %s",
-                                   tp_ref? "one" : "none"));
-            }
+            tp_ref = find_transport(mgr, &key, key_len, sel, tdata);
         }
 
         if (tp_ref == NULL &&
@@ -2771,6 +2901,8 @@ PJ_DEF(void) pjsip_tpmgr_dump_transports(pjsip_tpmgr *mgr)
     pj_hash_iterator_t itr_val;
     pj_hash_iterator_t *itr;
     pjsip_tpfactory *factory;
+    unsigned tp_cnt = 0;
+    pj_size_t total_mem = 0;
 
     pj_lock_acquire(mgr->lock);
 
@@ -2802,14 +2934,26 @@ PJ_DEF(void) pjsip_tpmgr_dump_transports(pjsip_tpmgr *mgr)
 
                 do {
                     pjsip_transport *tp_ref = tp_iter->tp;
+                    char mem_info[32];
 
-                    PJ_LOG(3, (THIS_FILE, "  %s %s%s%s%s(refcnt=%ld%s)",
+                    mem_info[0] = '\0';
+                    if (tp_ref->get_mem_usage) {
+                        pj_size_t mem = (*tp_ref->get_mem_usage)(tp_ref);
+
+                        pj_ansi_snprintf(mem_info, sizeof(mem_info),
+                                         " mem=%lu", (unsigned long)mem);
+                        total_mem += mem;
+                    }
+                    ++tp_cnt;
+
+                    PJ_LOG(3, (THIS_FILE, "  %s %s%s%s%s(refcnt=%ld%s%s)",
                                tp_ref->obj_name,
                                tp_ref->info,
                                (tp_ref->factory)?" listener[":"",
                                (tp_ref->factory)?tp_ref->factory->obj_name:"",
                                (tp_ref->factory)?"]":"",
                                pj_atomic_get(tp_ref->ref_cnt),
+                               mem_info,
                                (tp_ref->idle_timer.id ? " [idle]" : "")));
 
                     tp_iter = tp_iter->next;
@@ -2817,6 +2961,9 @@ PJ_DEF(void) pjsip_tpmgr_dump_transports(pjsip_tpmgr *mgr)
             }
             itr = pj_hash_next(mgr->table, itr);
         } while (itr);
+
+        PJ_LOG(3, (THIS_FILE, " Total: %u transport(s), %lu bytes of memory "
+                              "reported", tp_cnt, (unsigned long)total_mem));
     }
 
     pj_lock_release(mgr->lock);
@@ -63,6 +63,9 @@ struct tcp_listener
     pj_bool_t                reuse_addr;        
     unsigned                 async_cnt;    
     unsigned                 initial_timeout;
+    int                      backlog;
+    unsigned                 accept_batch;
+    pj_sock_t                sock;
 
     /* Group lock to be used by TCP listener and ioqueue key */
     pj_grp_lock_t           *grp_lock;
@@ -118,9 +121,31 @@ struct tcp_transport
      */
     pjsip_rx_data            rdata;
 
+    /* Capacity of the rdata pool, which is only created when data is
+     * received (see PJSIP_TCP_RELEASE_IDLE_RX_POOL).
+     */
+    pj_size_t                rx_pool_size;
+
     /* Pending transmission list. */
     struct delayed_tdata     delayed_list;
 
+    /* Write coalescing, see PJSIP_TCP_COALESCE_MAX_SIZE. Messages sent
+     * while tx_inflight is set are put in tx_queue, and written together
+     * from tx_buf when the write in progress completes. The messages of
+     * the write in progress from tx_buf are kept in tx_batch. The buffer
+     * is only allocated when the first batch is written.
+     */
+    char                    *tx_buf;
+    unsigned                 tx_buf_size;
+    pj_ioqueue_op_key_t      tx_op_key;
+    pj_ioqueue_op_key_t     *tx_inflight;
+    struct delayed_tdata     tx_queue;
+    struct delayed_tdata     tx_batch;
+    pj_timer_entry           tx_timer;
+
+    /* Number of bytes accepted by tcp_send_msg() and not yet sent. */
+    pj_size_t                tx_pending;
+
     /* Group lock to be used by TCP transport and ioqueue key */
     pj_grp_lock_t           *grp_lock;
 
@@ -233,6 +258,8 @@ PJ_DEF(void) pjsip_tcp_transport_cfg_default(pjsip_tcp_transport_cfg *cfg,
     pj_sockaddr_init(cfg->af, &cfg->bind_addr, NULL, 0);
     cfg->async_cnt = 1;
     cfg->reuse_addr = PJSIP_TCP_TRANSPORT_REUSEADDR;
+    cfg->backlog = PJSIP_TCP_TRANSPORT_BACKLOG;
+    cfg->accept_batch = 1;
     cfg->initial_timeout = (PJSIP_TCP_INITIAL_TIMEOUT!=0)?
               PJSIP_TCP_INITIAL_TIMEOUT:PJSIP_TRANSPORT_SERVER_IDLE_TIME_FIRST;
 }
@@ -400,6 +427,9 @@ PJ_DEF(pj_status_t) pjsip_tcp_transport_start3(
     listener->reuse_addr = cfg->reuse_addr;
     listener->async_cnt = cfg->async_cnt;
     listener->initial_timeout = cfg->initial_timeout;
+    listener->backlog = cfg->backlog;
+    listener->accept_batch = cfg->accept_batch;
+    listener->sock = PJ_INVALID_SOCKET;
     pj_memcpy(&listener->qos_params, &cfg->qos_params,
               sizeof(cfg->qos_params));
     pj_sockopt_params_clone(pool, &listener->sockopt_params,
@@ -535,6 +565,7 @@ static void lis_close(struct tcp_listener *listener)
     }
 
     if (listener->asock) {
+        listener->sock = PJ_INVALID_SOCKET;
         pj_activesock_close(listener->asock);
         listener->asock = NULL;
     }
@@ -582,6 +613,9 @@ static pj_status_t tcp_shutdown(pjsip_transport *transport);
 /* Called by transport manager to destroy transport */
 static pj_status_t tcp_destroy_transport(pjsip_transport *transport);
 
+/* Called by transport manager to get memory usage */
+static pj_size_t tcp_get_mem_usage(pjsip_transport *transport);
+
 /* Utility to destroy transport */
 static pj_status_t tcp_destroy(pjsip_transport *transport,
                                pj_status_t reason);
@@ -605,6 +639,9 @@ static pj_bool_t on_connect_complete(pj_activesock_t *asock,
 /* TCP keep-alive timer callback */
 static void tcp_keep_alive_timer(pj_timer_heap_t *th, pj_timer_entry *e);
 
+/* Write coalescing delay timer callback */
+static void tcp_tx_timer(pj_timer_heap_t *th, pj_timer_entry *e);
+
 /* Clean up TCP resources */
 static void tcp_on_destroy(void *arg);
 
@@ -645,6 +682,8 @@ static pj_status_t tcp_create( struct tcp_listener *listener,
     tcp->sock = sock;
     /*tcp->listener = listener;*/
     pj_list_init(&tcp->delayed_list);
+    pj_list_init(&tcp->tx_queue);
+    pj_list_init(&tcp->tx_batch);
     tcp->base.pool = pool;
 
     pj_ansi_snprintf(tcp->base.obj_name, PJ_MAX_OBJ_NAME, 
@@ -688,6 +727,7 @@ static pj_status_t tcp_create( struct tcp_listener *listener,
     tcp->base.send_msg = &tcp_send_msg;
     tcp->base.do_shutdown = &tcp_shutdown;
     tcp->base.destroy = &tcp_destroy_transport;
+    tcp->base.get_mem_usage = &tcp_get_mem_usage;
     tcp->base.factory = &listener->factory;
     tcp->base.initial_timeout = listener->initial_timeout;
 
@@ -711,7 +751,8 @@ static pj_status_t tcp_create( struct tcp_listener *listener,
     tcp_callback.on_data_sent = &on_data_sent;
     tcp_callback.on_connect_complete = &on_connect_complete;
 
-    ioqueue = pjsip_endpt_get_ioqueue(listener->endpt);
+    ioqueue = pjsip_endpt_get_ioqueue_shard(listener->endpt,
+                                            (pj_uint32_t)sock);
     status = pj_activesock_create(pool, sock, pj_SOCK_STREAM(), &asock_cfg,
                                   ioqueue, &tcp_callback, tcp, &tcp->asock);
     if (status != PJ_SUCCESS) {
@@ -732,6 +773,12 @@ static pj_status_t tcp_create( struct tcp_listener *listener,
     pj_ioqueue_op_key_init(&tcp->ka_op_key.key, sizeof(pj_ioqueue_op_key_t));
     pj_strdup(tcp->base.pool, &tcp->ka_pkt, &ka_pkt);
 
+    /* Initialize write coalescing */
+    tcp->tx_buf_size = pjsip_cfg()->tcp.coalesce_max_size;
+    pj_ioqueue_op_key_init(&tcp->tx_op_key, sizeof(pj_ioqueue_op_key_t));
+    tcp->tx_timer.user_data = (void*)tcp;
+    tcp->tx_timer.cb = &tcp_tx_timer;
+
     if (is_server && listener->initial_timeout) {
         /* Initialize initial timer. */
         pjsip_transport_add_ref(&tcp->base);
@@ -756,6 +803,136 @@ on_error:
 }
 
 
+/* Get the size of the transmit data of a pending transmission. */
+#define TDATA_SIZE(tdata_op_key) \
+            ((tdata_op_key)->tdata->buf.cur - (tdata_op_key)->tdata->buf.start)
+
+
+/* Called when a coalesced write completes, to notify the sender of each
+ * message in the write. The flush argument tells whether the queue should
+ * be flushed afterwards, which is only done when called by ioqueue.
+ */
+static pj_bool_t on_batch_sent(struct tcp_transport *tcp,
+                               pj_ssize_t bytes_sent,
+                               pj_bool_t flush);
+
+
+/* Write the messages in the coalescing queue, as long as the writes
+ * complete immediately. Must be called with the transport lock held.
+ */
+static void tcp_flush_tx_queue(struct tcp_transport *tcp)
+{
+    while (tcp->tx_inflight == NULL && !pj_list_empty(&tcp->tx_queue) &&
+           !tcp->is_closing)
+    {
+        struct delayed_tdata *pending_tx = tcp->tx_queue.next;
+        pj_ssize_t size = TDATA_SIZE(pending_tx->tdata_op_key);
+        pj_status_t status;
+
+        if (pending_tx->next == &tcp->tx_queue ||
+            size + TDATA_SIZE(pending_tx->next->tdata_op_key) >
+                tcp->tx_buf_size)
+        {
+            /* Nothing to coalesce with, send the message as it is. */
+            pj_ioqueue_op_key_t *op_key;
+
+            pj_list_erase(pending_tx);
+            op_key = (pj_ioqueue_op_key_t*)pending_tx->tdata_op_key;
+
+            status = pj_activesock_send(tcp->asock, op_key,
+                                        pending_tx->tdata_op_key->tdata->
+                                            buf.start,
+                                        &size, 0);
+            if (status == PJ_EPENDING) {
+                tcp->tx_inflight = op_key;
+            } else {
+                pj_lock_release(tcp->base.lock);
+                on_data_sent(tcp->asock, op_key,
+                             status==PJ_SUCCESS ? size : -status);
+                pj_lock_acquire(tcp->base.lock);
+                if (status != PJ_SUCCESS)
+                    break;
+            }
+
+        } else {
+            /* Copy as many messages as fit in the coalescing buffer. */
+            pj_size_t total = 0;
+
+            if (!tcp->tx_buf) {
+                tcp->tx_buf = (char*) pj_pool_alloc(tcp->base.pool,
+                                                    tcp->tx_buf_size);
+            }
+
+            do {
+                pjsip_tx_data *tdata;
+
+                pending_tx = tcp->tx_queue.next;
+                tdata = pending_tx->tdata_op_key->tdata;
+                size = tdata->buf.cur - tdata->buf.start;
+                if (total + size > tcp->tx_buf_size)
+                    break;
+
+                pj_memcpy(tcp->tx_buf + total, tdata->buf.start, size);
+                total += size;
+                pj_list_erase(pending_tx);
+                pj_list_push_back(&tcp->tx_batch, pending_tx);
+            } while (!pj_list_empty(&tcp->tx_queue));
+
+            size = (pj_ssize_t)total;
+            status = pj_activesock_send(tcp->asock, &tcp->tx_op_key,
+                                        tcp->tx_buf, &size, 0);
+            if (status == PJ_EPENDING) {
+                tcp->tx_inflight = &tcp->tx_op_key;
+            } else {
+                pj_lock_release(tcp->base.lock);
+                on_batch_sent(tcp, status==PJ_SUCCESS ? size : -status,
+                              PJ_FALSE);
+                pj_lock_acquire(tcp->base.lock);
+                if (status != PJ_SUCCESS)
+                    break;
+            }
+        }
+    }
+}
+
+
+/* Write coalescing delay timer callback */
+static void tcp_tx_timer(pj_timer_heap_t *th, pj_timer_entry *e)
+{
+    struct tcp_transport *tcp = (struct tcp_transport*) e->user_data;
+
+    PJ_UNUSED_ARG(th);
+
+    pj_lock_acquire(tcp->base.lock);
+    tcp->tx_timer.id = PJ_FALSE;
+    tcp_flush_tx_queue(tcp);
+    pj_lock_release(tcp->base.lock);
+}
+
+
+/* Fail all transmissions in the list. */
+static void tcp_cancel_tx_list(struct tcp_transport *tcp,
+                               struct delayed_tdata *list,
+                               pj_status_t reason)
+{
+    pj_lock_acquire(tcp->base.lock);
+    while (!pj_list_empty(list)) {
+        struct delayed_tdata *pending_tx;
+        pj_ioqueue_op_key_t *op_key;
+
+        pending_tx = list->next;
+        pj_list_erase(pending_tx);
+
+        op_key = (pj_ioqueue_op_key_t*)pending_tx->tdata_op_key;
+
+        pj_lock_release(tcp->base.lock);
+        on_data_sent(tcp->asock, op_key, -reason);
+        pj_lock_acquire(tcp->base.lock);
+    }
+    pj_lock_release(tcp->base.lock);
+}
+
+
 /* Flush all delayed transmision once the socket is connected. */
 static void tcp_flush_pending_tx(struct tcp_transport *tcp)
 {
@@ -785,6 +962,12 @@ static void tcp_flush_pending_tx(struct tcp_transport *tcp)
             continue;
         }
 
+        /* Let the messages be coalesced if enabled */
+        if (tcp->tx_buf_size) {
+            pj_list_push_back(&tcp->tx_queue, pending_tx);
+            continue;
+        }
+
         /* send! */
         size = tdata->buf.cur - tdata->buf.start;
         status = pj_activesock_send(tcp->asock, op_key, tdata->buf.start, 
@@ -796,6 +979,7 @@ static void tcp_flush_pending_tx(struct tcp_transport *tcp)
         }
 
     }
+    tcp_flush_tx_queue(tcp);
     pj_lock_release(tcp->base.lock);
 }
 
@@ -842,19 +1026,20 @@ static pj_status_t tcp_destroy(pjsip_transport *transport,
         tcp->ka_timer.id = PJ_FALSE;
     }
 
-    /* Cancel all delayed transmits */
-    while (!pj_list_empty(&tcp->delayed_list)) {
-        struct delayed_tdata *pending_tx;
-        pj_ioqueue_op_key_t *op_key;
-
-        pending_tx = tcp->delayed_list.next;
-        pj_list_erase(pending_tx);
-
-        op_key = (pj_ioqueue_op_key_t*)pending_tx->tdata_op_key;
-
-        on_data_sent(tcp->asock, op_key, -reason);
+    /* Stop write coalescing timer. */
+    if (tcp->tx_timer.id) {
+        pjsip_endpt_cancel_timer(tcp->base.endpt, &tcp->tx_timer);
+        tcp->tx_timer.id = PJ_FALSE;
     }
 
+    /* Cancel all delayed and queued transmits, and the coalesced write in
+     * progress since its completion may not be reported once the socket
+     * is closed.
+     */
+    tcp_cancel_tx_list(tcp, &tcp->delayed_list, reason);
+    tcp_cancel_tx_list(tcp, &tcp->tx_queue, reason);
+    tcp_cancel_tx_list(tcp, &tcp->tx_batch, reason);
+
     if (tcp->asock) {
         pj_activesock_close(tcp->asock);
         tcp->asock = NULL;
@@ -925,24 +1110,12 @@ static void tcp_on_destroy(void *arg)
  */
 static pj_status_t tcp_start_read(struct tcp_transport *tcp)
 {
-    pj_pool_t *pool;
     pj_uint32_t size;
     pj_sockaddr *rem_addr;
     void *readbuf[1];
     pj_status_t status;
 
-    /* Init rdata */
-    pool = pjsip_endpt_create_pool(tcp->base.endpt,
-                                   "rtd%p",
-                                   PJSIP_POOL_RDATA_LEN,
-                                   PJSIP_POOL_RDATA_INC);
-    if (!pool) {
-        tcp_perror(tcp->base.obj_name, "Unable to create pool", PJ_ENOMEM);
-        return PJ_ENOMEM;
-    }
-
-    tcp->rdata.tp_info.pool = pool;
-
+    /* Init rdata. The pool is created when data is received. */
     tcp->rdata.tp_info.transport = &tcp->base;
     tcp->rdata.tp_info.tp_data = tcp;
     tcp->rdata.tp_info.op_key.rdata = &tcp->rdata;
@@ -1114,15 +1287,12 @@ static pj_status_t lis_create_transport(pjsip_tpfactory *factory,
 
 
 /*
- * This callback is called by active socket when pending accept() operation
- * has completed.
+ * Create TCP transport for a newly accepted socket.
  */
-static pj_bool_t on_accept_complete(pj_activesock_t *asock,
-                                    pj_sock_t sock,
-                                    const pj_sockaddr_t *src_addr,
-                                    int src_addr_len)
+static void lis_accept_sock(struct tcp_listener *listener,
+                            pj_sock_t sock,
+                            const pj_sockaddr_t *src_addr)
 {
-    struct tcp_listener *listener;
     struct tcp_transport *tcp;
     char addr[PJ_INET6_ADDRSTRLEN+10];
     pjsip_tp_state_callback state_cb;
@@ -1131,15 +1301,6 @@ static pj_bool_t on_accept_complete(pj_activesock_t *asock,
     pj_status_t status;
     char addr_buf[PJ_INET6_ADDRSTRLEN+10];    
 
-    PJ_UNUSED_ARG(src_addr_len);
-
-    listener = (struct tcp_listener*) pj_activesock_get_user_data(asock);
-
-    PJ_ASSERT_RETURN(sock != PJ_INVALID_SOCKET, PJ_TRUE);
-
-    if (!listener->is_registered)
-        return PJ_FALSE;
-
     PJ_LOG(4,(listener->factory.obj_name, 
               "TCP listener %s: got incoming TCP connection "
               "from %s, sock=%ld",
@@ -1197,7 +1358,7 @@ static pj_bool_t on_accept_complete(pj_activesock_t *asock,
         }
 
         if (tcp->base.is_shutdown || tcp->base.is_destroying) {
-            return PJ_TRUE;
+            return;
         }
 
         /* Start keep-alive timer */
@@ -1217,6 +1378,50 @@ static pj_bool_t on_accept_complete(pj_activesock_t *asock,
             tcp_destroy(&tcp->base, status);
         }
     }
+}
+
+
+/*
+ * This callback is called by active socket when pending accept() operation
+ * has completed.
+ */
+static pj_bool_t on_accept_complete(pj_activesock_t *asock,
+                                    pj_sock_t sock,
+                                    const pj_sockaddr_t *src_addr,
+                                    int src_addr_len)
+{
+    struct tcp_listener *listener;
+    unsigned i;
+
+    PJ_UNUSED_ARG(src_addr_len);
+
+    listener = (struct tcp_listener*) pj_activesock_get_user_data(asock);
+
+    PJ_ASSERT_RETURN(sock != PJ_INVALID_SOCKET, PJ_TRUE);
+
+    if (!listener->is_registered)
+        return PJ_FALSE;
+
+    lis_accept_sock(listener, sock, src_addr);
+
+    /* Also accept the connections already waiting in the backlog, up to
+     * the configured batch size, instead of waiting for another event
+     * for each of them.
+     */
+    for (i = 1; i < listener->accept_batch && listener->is_registered; ++i) {
+        pj_sockaddr rem_addr;
+        int rem_addr_len = sizeof(rem_addr);
+        pj_sock_t newsock;
+
+        if (listener->sock == PJ_INVALID_SOCKET ||
+            pj_sock_accept(listener->sock, &newsock, &rem_addr,
+                           &rem_addr_len) != PJ_SUCCESS)
+        {
+            break;
+        }
+
+        lis_accept_sock(listener, newsock, &rem_addr);
+    }
 
     return PJ_TRUE;
 }
@@ -1233,10 +1438,20 @@ static pj_bool_t on_data_sent(pj_activesock_t *asock,
                                 pj_activesock_get_user_data(asock);
     pjsip_tx_data_op_key *tdata_op_key = (pjsip_tx_data_op_key*)op_key;
 
+    /* Coalesced write */
+    if (op_key == &tcp->tx_op_key)
+        return on_batch_sent(tcp, bytes_sent, PJ_TRUE);
+
     /* Note that op_key may be the op_key from keep-alive, thus
      * it will not have tdata etc.
      */
 
+    if (tdata_op_key->tdata) {
+        pj_lock_acquire(tcp->base.lock);
+        tcp->tx_pending -= TDATA_SIZE(tdata_op_key);
+        pj_lock_release(tcp->base.lock);
+    }
+
     tdata_op_key->tdata = NULL;
 
     if (tdata_op_key->callback) {
@@ -1268,6 +1483,60 @@ static pj_bool_t on_data_sent(pj_activesock_t *asock,
         return PJ_FALSE;
     }
 
+    /* Write the messages queued while this one was being written */
+    if (tcp->tx_buf_size) {
+        pj_lock_acquire(tcp->base.lock);
+        if (op_key == tcp->tx_inflight) {
+            tcp->tx_inflight = NULL;
+            tcp_flush_tx_queue(tcp);
+        }
+        pj_lock_release(tcp->base.lock);
+    }
+
+    return PJ_TRUE;
+}
+
+
+static pj_bool_t on_batch_sent(struct tcp_transport *tcp,
+                               pj_ssize_t bytes_sent,
+                               pj_bool_t flush)
+{
+    struct delayed_tdata batch;
+
+    pj_list_init(&batch);
+
+    pj_lock_acquire(tcp->base.lock);
+    pj_list_merge_last(&batch, &tcp->tx_batch);
+    if (tcp->tx_inflight == &tcp->tx_op_key)
+        tcp->tx_inflight = NULL;
+    pj_lock_release(tcp->base.lock);
+
+    /* A stream write either completes or fails as a whole, report the
+     * size of each message to its sender.
+     */
+    while (!pj_list_empty(&batch)) {
+        struct delayed_tdata *pending_tx = batch.next;
+        pjsip_tx_data_op_key *tdata_op_key = pending_tx->tdata_op_key;
+
+        pj_list_erase(pending_tx);
+        if (bytes_sent <= 0) {
+            on_data_sent(tcp->asock, (pj_ioqueue_op_key_t*)tdata_op_key,
+                         bytes_sent);
+        } else {
+            on_data_sent(tcp->asock, (pj_ioqueue_op_key_t*)tdata_op_key,
+                         TDATA_SIZE(tdata_op_key));
+        }
+    }
+
+    if (bytes_sent <= 0)
+        return PJ_FALSE;
+
+    if (flush) {
+        pj_lock_acquire(tcp->base.lock);
+        tcp_flush_tx_queue(tcp);
+        pj_lock_release(tcp->base.lock);
+    }
+
     return PJ_TRUE;
 }
 
@@ -1283,7 +1552,8 @@ static pj_status_t tcp_send_msg(pjsip_transport *transport,
                                 pjsip_transport_callback callback)
 {
     struct tcp_transport *tcp = (struct tcp_transport*)transport;
-    pj_ssize_t size;
+    pj_ssize_t size, tdata_size;
+    pj_size_t max_pending;
     pj_bool_t delayed = PJ_FALSE;
     pj_status_t status = PJ_SUCCESS;
 
@@ -1298,6 +1568,24 @@ static pj_status_t tcp_send_msg(pjsip_transport *transport,
                                   addr_len==sizeof(pj_sockaddr_in6)),
                      PJ_EINVAL);
 
+    /* Account the message to the bytes waiting to be sent, refusing it if
+     * the connection has too much data pending already.
+     */
+    tdata_size = tdata->buf.cur - tdata->buf.start;
+    max_pending = pjsip_cfg()->tcp.max_pending_tx;
+    pj_lock_acquire(tcp->base.lock);
+    if (max_pending && tcp->tx_pending &&
+        tcp->tx_pending + tdata_size > max_pending)
+    {
+        pj_lock_release(tcp->base.lock);
+        PJ_LOG(4,(tcp->base.obj_name, "Unable to send %s: %lu bytes are "
+                  "pending on the connection", pjsip_tx_data_get_info(tdata),
+                  (unsigned long)tcp->tx_pending));
+        return PJ_EBUSY;
+    }
+    tcp->tx_pending += tdata_size;
+    pj_lock_release(tcp->base.lock);
+
     /* Init op key. */
     tdata->op_key.tdata = tdata;
     tdata->op_key.token = token;
@@ -1345,20 +1633,70 @@ static pj_status_t tcp_send_msg(pjsip_transport *transport,
         pj_lock_release(tcp->base.lock);
     } 
     
+    if (!delayed && tcp->tx_buf_size) {
+        /*
+         * With write coalescing, the message is queued if a write is in
+         * progress or if writes are to be delayed. It will be written
+         * together with other messages once the write completes or the
+         * delay expires.
+         */
+        pj_lock_acquire(tcp->base.lock);
+
+        if (tcp->tx_inflight || !pj_list_empty(&tcp->tx_queue) ||
+            pjsip_cfg()->tcp.coalesce_delay)
+        {
+            struct delayed_tdata *pending_tx;
+
+            pending_tx = PJ_POOL_ZALLOC_T(tdata->pool, struct delayed_tdata);
+            pending_tx->tdata_op_key = &tdata->op_key;
+            pj_list_push_back(&tcp->tx_queue, pending_tx);
+
+            if (!tcp->tx_inflight && !tcp->tx_timer.id) {
+                pj_time_val delay;
+
+                delay.sec = 0;
+                delay.msec = pjsip_cfg()->tcp.coalesce_delay;
+                pj_time_val_normalize(&delay);
+                pjsip_endpt_schedule_timer(tcp->base.endpt, &tcp->tx_timer,
+                                           &delay);
+                tcp->tx_timer.id = PJ_TRUE;
+            }
+
+            status = PJ_EPENDING;
+            delayed = PJ_TRUE;
+
+            pj_lock_release(tcp->base.lock);
+        }
+
+        /* Otherwise the lock is released below, after the write is
+         * recorded as being in progress.
+         */
+    }
+
     if (!delayed) {
         /*
          * Transport is ready to go. Send the packet to ioqueue to be
          * sent asynchronously.
          */
-        size = tdata->buf.cur - tdata->buf.start;
+        size = tdata_size;
         status = pj_activesock_send(tcp->asock, 
                                     (pj_ioqueue_op_key_t*)&tdata->op_key,
                                     tdata->buf.start, &size, 0);
 
+        if (tcp->tx_buf_size) {
+            if (status == PJ_EPENDING)
+                tcp->tx_inflight = (pj_ioqueue_op_key_t*)&tdata->op_key;
+            pj_lock_release(tcp->base.lock);
+        }
+
         if (status != PJ_EPENDING) {
             /* Not pending (could be immediate success or error) */
             tdata->op_key.tdata = NULL;
 
+            pj_lock_acquire(tcp->base.lock);
+            tcp->tx_pending -= tdata_size;
+            pj_lock_release(tcp->base.lock);
+
             /* Shutdown transport on closure/errors */
             if (size <= 0) {
 
@@ -1394,6 +1732,18 @@ static pj_status_t tcp_shutdown(pjsip_transport *transport)
 }
 
 
+/* 
+ * This callback is called by transport manager to get the amount of
+ * memory held by the transport.
+ */
+static pj_size_t tcp_get_mem_usage(pjsip_transport *transport)
+{
+    struct tcp_transport *tcp = (struct tcp_transport*)transport;
+
+    return pj_pool_get_capacity(tcp->base.pool) + tcp->rx_pool_size;
+}
+
+
 /* 
  * Callback from ioqueue that an incoming data is received from the socket.
  */
@@ -1429,6 +1779,20 @@ static pj_bool_t on_data_read(pj_activesock_t *asock,
 
         pj_assert((void*)rdata->pkt_info.packet == data);
 
+        /* Create the pool for parsing, if it has been released */
+        if (!rdata->tp_info.pool) {
+            rdata->tp_info.pool = pjsip_endpt_create_pool(tcp->base.endpt,
+                                                          "rtd%p",
+                                                          PJSIP_POOL_RDATA_LEN,
+                                                          PJSIP_POOL_RDATA_INC);
+            if (!rdata->tp_info.pool) {
+                tcp_perror(tcp->base.obj_name, "Unable to create pool",
+                           PJ_ENOMEM);
+                tcp_init_shutdown(tcp, PJ_ENOMEM);
+                return PJ_FALSE;
+            }
+        }
+
         /* Init pkt_info part. */
         rdata->pkt_info.len = size;
         rdata->pkt_info.zero = 0;
@@ -1463,8 +1827,15 @@ static pj_bool_t on_data_read(pj_activesock_t *asock,
 
     }
 
-    /* Reset pool. */
-    pj_pool_reset(rdata->tp_info.pool);
+    /* Reset pool, or release it if there is no more data to process. */
+    if (*remainder == 0 && pjsip_cfg()->tcp.release_idle_rx_pool) {
+        pj_pool_release(rdata->tp_info.pool);
+        rdata->tp_info.pool = NULL;
+        tcp->rx_pool_size = 0;
+    } else {
+        pj_pool_reset(rdata->tp_info.pool);
+        tcp->rx_pool_size = pj_pool_get_capacity(rdata->tp_info.pool);
+    }
 
     return PJ_TRUE;
 }
@@ -1636,6 +2007,22 @@ static void tcp_keep_alive_timer(pj_timer_heap_t *th, pj_timer_entry *e)
 }
 
 
+PJ_DEF(pj_size_t) pjsip_tcp_transport_get_pending_tx(
+                                                pjsip_transport *transport)
+{
+    struct tcp_transport *tcp = (struct tcp_transport*)transport;
+    pj_size_t pending;
+
+    PJ_ASSERT_RETURN(transport, 0);
+
+    pj_lock_acquire(tcp->base.lock);
+    pending = tcp->tx_pending;
+    pj_lock_release(tcp->base.lock);
+
+    return pending;
+}
+
+
 PJ_DEF(pj_sock_t) pjsip_tcp_transport_get_socket(pjsip_transport *transport)
 {
     struct tcp_transport *tcp = (struct tcp_transport*)transport;
@@ -1712,10 +2099,12 @@ PJ_DEF(pj_status_t) pjsip_tcp_transport_lis_start(pjsip_tpfactory *factory,
         goto on_error;
 
     /* Start listening to the address */
-    status = pj_sock_listen(sock, PJSIP_TCP_TRANSPORT_BACKLOG);
+    status = pj_sock_listen(sock, listener->backlog);
     if (status != PJ_SUCCESS)
         goto on_error;
 
+    listener->sock = sock;
+
 
     /* Create active socket */
     pj_activesock_cfg_default(&asock_cfg);
@@ -108,9 +108,31 @@ struct tls_transport
      */
     pjsip_rx_data            rdata;
 
+    /* Capacity of the rdata pool, which is only created when data is
+     * received (see PJSIP_TLS_RELEASE_IDLE_RX_POOL).
+     */
+    pj_size_t                rx_pool_size;
+
     /* Pending transmission list. */
     struct delayed_tdata     delayed_list;
 
+    /* Write coalescing, see PJSIP_TLS_COALESCE_MAX_SIZE. Messages sent
+     * while tx_inflight is set are put in tx_queue, and written together
+     * from tx_buf when the write in progress completes. The messages of
+     * the write in progress from tx_buf are kept in tx_batch. The buffer
+     * is only allocated when the first batch is written.
+     */
+    char                    *tx_buf;
+    unsigned                 tx_buf_size;
+    pj_ioqueue_op_key_t      tx_op_key;
+    pj_ioqueue_op_key_t     *tx_inflight;
+    struct delayed_tdata     tx_queue;
+    struct delayed_tdata     tx_batch;
+    pj_timer_entry           tx_timer;
+
+    /* Number of bytes accepted by tls_send_msg() and not yet sent. */
+    pj_size_t                tx_pending;
+
     /* Group lock to be used by TLS transport and ioqueue key */
     pj_grp_lock_t           *grp_lock;
 
@@ -832,6 +854,9 @@ static pj_status_t tls_shutdown(pjsip_transport *transport);
 /* Called by transport manager to destroy transport */
 static pj_status_t tls_destroy_transport(pjsip_transport *transport);
 
+/* Called by transport manager to get memory usage */
+static pj_size_t tls_get_mem_usage(pjsip_transport *transport);
+
 /* Utility to destroy transport */
 static pj_status_t tls_destroy(pjsip_transport *transport,
                                pj_status_t reason);
@@ -843,6 +868,9 @@ static pj_bool_t on_connect_complete(pj_ssl_sock_t *ssock,
 /* TLS keep-alive timer callback */
 static void tls_keep_alive_timer(pj_timer_heap_t *th, pj_timer_entry *e);
 
+/* Write coalescing delay timer callback */
+static void tls_tx_timer(pj_timer_heap_t *th, pj_timer_entry *e);
+
 /*
  * Common function to create TLS transport, called when pending accept() and
  * pending connect() complete.
@@ -880,6 +908,8 @@ static pj_status_t tls_create( struct tls_listener *listener,
     tls->is_server = is_server;
     tls->verify_server = listener->tls_setting.verify_server;
     pj_list_init(&tls->delayed_list);
+    pj_list_init(&tls->tx_queue);
+    pj_list_init(&tls->tx_batch);
     tls->base.pool = pool;
 
     pj_ansi_snprintf(tls->base.obj_name, PJ_MAX_OBJ_NAME, 
@@ -948,6 +978,7 @@ static pj_status_t tls_create( struct tls_listener *listener,
     tls->base.send_msg = &tls_send_msg;
     tls->base.do_shutdown = &tls_shutdown;
     tls->base.destroy = &tls_destroy_transport;
+    tls->base.get_mem_usage = &tls_get_mem_usage;
     tls->base.factory = &listener->factory;
     tls->base.initial_timeout = listener->tls_setting.initial_timeout;
 
@@ -972,6 +1003,12 @@ static pj_status_t tls_create( struct tls_listener *listener,
     tls->ka_timer.cb = &tls_keep_alive_timer;
     pj_ioqueue_op_key_init(&tls->ka_op_key.key, sizeof(pj_ioqueue_op_key_t));
     pj_strdup(tls->base.pool, &tls->ka_pkt, &ka_pkt);
+
+    /* Initialize write coalescing */
+    tls->tx_buf_size = pjsip_cfg()->tls.coalesce_max_size;
+    pj_ioqueue_op_key_init(&tls->tx_op_key, sizeof(pj_ioqueue_op_key_t));
+    tls->tx_timer.user_data = (void*)tls;
+    tls->tx_timer.cb = &tls_tx_timer;
     
     /* Done setting up basic transport. */
     *p_tls = tls;
@@ -991,6 +1028,136 @@ on_error:
 }
 
 
+/* Get the size of the transmit data of a pending transmission. */
+#define TDATA_SIZE(tdata_op_key) \
+            ((tdata_op_key)->tdata->buf.cur - (tdata_op_key)->tdata->buf.start)
+
+
+/* Called when a coalesced write completes, to notify the sender of each
+ * message in the write. The flush argument tells whether the queue should
+ * be flushed afterwards, which is only done when called by ioqueue.
+ */
+static pj_bool_t on_batch_sent(struct tls_transport *tls,
+                               pj_ssize_t bytes_sent,
+                               pj_bool_t flush);
+
+
+/* Write the messages in the coalescing queue, as long as the writes
+ * complete immediately. Must be called with the transport lock held.
+ */
+static void tls_flush_tx_queue(struct tls_transport *tls)
+{
+    while (tls->tx_inflight == NULL && !pj_list_empty(&tls->tx_queue) &&
+           !tls->is_closing)
+    {
+        struct delayed_tdata *pending_tx = tls->tx_queue.next;
+        pj_ssize_t size = TDATA_SIZE(pending_tx->tdata_op_key);
+        pj_status_t status;
+
+        if (pending_tx->next == &tls->tx_queue ||
+            size + TDATA_SIZE(pending_tx->next->tdata_op_key) >
+                tls->tx_buf_size)
+        {
+            /* Nothing to coalesce with, send the message as it is. */
+            pj_ioqueue_op_key_t *op_key;
+
+            pj_list_erase(pending_tx);
+            op_key = (pj_ioqueue_op_key_t*)pending_tx->tdata_op_key;
+
+            status = pj_ssl_sock_send(tls->ssock, op_key,
+                                      pending_tx->tdata_op_key->tdata->
+                                          buf.start,
+                                      &size, 0);
+            if (status == PJ_EPENDING) {
+                tls->tx_inflight = op_key;
+            } else {
+                pj_lock_release(tls->base.lock);
+                on_data_sent(tls->ssock, op_key,
+                             status==PJ_SUCCESS ? size : -status);
+                pj_lock_acquire(tls->base.lock);
+                if (status != PJ_SUCCESS)
+                    break;
+            }
+
+        } else {
+            /* Copy as many messages as fit in the coalescing buffer. */
+            pj_size_t total = 0;
+
+            if (!tls->tx_buf) {
+                tls->tx_buf = (char*) pj_pool_alloc(tls->base.pool,
+                                                    tls->tx_buf_size);
+            }
+
+            do {
+                pjsip_tx_data *tdata;
+
+                pending_tx = tls->tx_queue.next;
+                tdata = pending_tx->tdata_op_key->tdata;
+                size = tdata->buf.cur - tdata->buf.start;
+                if (total + size > tls->tx_buf_size)
+                    break;
+
+                pj_memcpy(tls->tx_buf + total, tdata->buf.start, size);
+                total += size;
+                pj_list_erase(pending_tx);
+                pj_list_push_back(&tls->tx_batch, pending_tx);
+            } while (!pj_list_empty(&tls->tx_queue));
+
+            size = (pj_ssize_t)total;
+            status = pj_ssl_sock_send(tls->ssock, &tls->tx_op_key,
+                                      tls->tx_buf, &size, 0);
+            if (status == PJ_EPENDING) {
+                tls->tx_inflight = &tls->tx_op_key;
+            } else {
+                pj_lock_release(tls->base.lock);
+                on_batch_sent(tls, status==PJ_SUCCESS ? size : -status,
+                              PJ_FALSE);
+                pj_lock_acquire(tls->base.lock);
+                if (status != PJ_SUCCESS)
+                    break;
+            }
+        }
+    }
+}
+
+
+/* Write coalescing delay timer callback */
+static void tls_tx_timer(pj_timer_heap_t *th, pj_timer_entry *e)
+{
+    struct tls_transport *tls = (struct tls_transport*) e->user_data;
+
+    PJ_UNUSED_ARG(th);
+
+    pj_lock_acquire(tls->base.lock);
+    tls->tx_timer.id = PJ_FALSE;
+    tls_flush_tx_queue(tls);
+    pj_lock_release(tls->base.lock);
+}
+
+
+/* Fail all transmissions in the list. */
+static void tls_cancel_tx_list(struct tls_transport *tls,
+                               struct delayed_tdata *list,
+                               pj_status_t reason)
+{
+    pj_lock_acquire(tls->base.lock);
+    while (!pj_list_empty(list)) {
+        struct delayed_tdata *pending_tx;
+        pj_ioqueue_op_key_t *op_key;
+
+        pending_tx = list->next;
+        pj_list_erase(pending_tx);
+
+        op_key = (pj_ioqueue_op_key_t*)pending_tx->tdata_op_key;
+
+        pj_lock_release(tls->base.lock);
+        on_data_sent(tls->ssock, op_key, -reason);
+        pj_lock_acquire(tls->base.lock);
+    }
+    pj_lock_release(tls->base.lock);
+}
+
+
 /* Flush all delayed transmision once the socket is connected. */
 static void tls_flush_pending_tx(struct tls_transport *tls)
 {
@@ -1020,6 +1187,12 @@ static void tls_flush_pending_tx(struct tls_transport *tls)
             continue;
         }
 
+        /* Let the messages be coalesced if enabled */
+        if (tls->tx_buf_size) {
+            pj_list_push_back(&tls->tx_queue, pending_tx);
+            continue;
+        }
+
         /* send! */
         size = tdata->buf.cur - tdata->buf.start;
         status = pj_ssl_sock_send(tls->ssock, op_key, tdata->buf.start, 
@@ -1031,6 +1204,7 @@ static void tls_flush_pending_tx(struct tls_transport *tls)
             pj_lock_acquire(tls->base.lock);
         }
     }
+    tls_flush_tx_queue(tls);
     pj_lock_release(tls->base.lock);
 }
 
@@ -1115,19 +1289,20 @@ static pj_status_t tls_destroy(pjsip_transport *transport,
         tls->ka_timer.id = PJ_FALSE;
     }
 
-    /* Cancel all delayed transmits */
-    while (!pj_list_empty(&tls->delayed_list)) {
-        struct delayed_tdata *pending_tx;
-        pj_ioqueue_op_key_t *op_key;
-
-        pending_tx = tls->delayed_list.next;
-        pj_list_erase(pending_tx);
-
-        op_key = (pj_ioqueue_op_key_t*)pending_tx->tdata_op_key;
-
-        on_data_sent(tls->ssock, op_key, -reason);
+    /* Stop write coalescing timer. */
+    if (tls->tx_timer.id) {
+        pjsip_endpt_cancel_timer(tls->base.endpt, &tls->tx_timer);
+        tls->tx_timer.id = PJ_FALSE;
     }
 
+    /* Cancel all delayed and queued transmits, and the coalesced write in
+     * progress since its completion may not be reported once the socket
+     * is closed.
+     */
+    tls_cancel_tx_list(tls, &tls->delayed_list, reason);
+    tls_cancel_tx_list(tls, &tls->tx_queue, reason);
+    tls_cancel_tx_list(tls, &tls->tx_batch, reason);
+
     if (tls->ssock) {
         pj_ssl_sock_close(tls->ssock);
         tls->ssock = NULL;
@@ -1151,25 +1326,12 @@ static pj_status_t tls_destroy(pjsip_transport *transport,
  */
 static pj_status_t tls_start_read(struct tls_transport *tls)
 {
-    pj_pool_t *pool;
     pj_uint32_t size;
     pj_sockaddr *rem_addr;
     void *readbuf[1];
     pj_status_t status;
 
-    /* Init rdata */
-    pool = pjsip_endpt_create_pool(tls->base.endpt,
-                                   "rtd%p",
-                                   PJSIP_POOL_RDATA_LEN,
-                                   PJSIP_POOL_RDATA_INC);
-    if (!pool) {
-        tls_perror(tls->base.obj_name, "Unable to create pool", PJ_ENOMEM,
-                   NULL);
-        return PJ_ENOMEM;
-    }
-
-    tls->rdata.tp_info.pool = pool;
-
+    /* Init rdata. The pool is created when data is received. */
     tls->rdata.tp_info.transport = &tls->base;
     tls->rdata.tp_info.tp_data = tls;
     tls->rdata.tp_info.op_key.rdata = &tls->rdata;
@@ -1620,10 +1782,20 @@ static pj_bool_t on_data_sent(pj_ssl_sock_t *ssock,
                                 pj_ssl_sock_get_user_data(ssock);
     pjsip_tx_data_op_key *tdata_op_key = (pjsip_tx_data_op_key*)op_key;
 
+    /* Coalesced write */
+    if (op_key == &tls->tx_op_key)
+        return on_batch_sent(tls, bytes_sent, PJ_TRUE);
+
     /* Note that op_key may be the op_key from keep-alive, thus
      * it will not have tdata etc.
      */
 
+    if (tdata_op_key->tdata) {
+        pj_lock_acquire(tls->base.lock);
+        tls->tx_pending -= TDATA_SIZE(tdata_op_key);
+        pj_lock_release(tls->base.lock);
+    }
+
     tdata_op_key->tdata = NULL;
 
     if (tdata_op_key->callback) {
@@ -1654,7 +1826,61 @@ static pj_bool_t on_data_sent(pj_ssl_sock_t *ssock,
 
         return PJ_FALSE;
     }
-    
+
+    /* Write the messages queued while this one was being written */
+    if (tls->tx_buf_size) {
+        pj_lock_acquire(tls->base.lock);
+        if (op_key == tls->tx_inflight) {
+            tls->tx_inflight = NULL;
+            tls_flush_tx_queue(tls);
+        }
+        pj_lock_release(tls->base.lock);
+    }
+
+    return PJ_TRUE;
+}
+
+
+static pj_bool_t on_batch_sent(struct tls_transport *tls,
+                               pj_ssize_t bytes_sent,
+                               pj_bool_t flush)
+{
+    struct delayed_tdata batch;
+
+    pj_list_init(&batch);
+
+    pj_lock_acquire(tls->base.lock);
+    pj_list_merge_last(&batch, &tls->tx_batch);
+    if (tls->tx_inflight == &tls->tx_op_key)
+        tls->tx_inflight = NULL;
+    pj_lock_release(tls->base.lock);
+
+    /* A stream write either completes or fails as a whole, report the
+     * size of each message to its sender.
+     */
+    while (!pj_list_empty(&batch)) {
+        struct delayed_tdata *pending_tx = batch.next;
+        pjsip_tx_data_op_key *tdata_op_key = pending_tx->tdata_op_key;
+
+        pj_list_erase(pending_tx);
+        if (bytes_sent <= 0) {
+            on_data_sent(tls->ssock, (pj_ioqueue_op_key_t*)tdata_op_key,
+                         bytes_sent);
+        } else {
+            on_data_sent(tls->ssock, (pj_ioqueue_op_key_t*)tdata_op_key,
+                         TDATA_SIZE(tdata_op_key));
+        }
+    }
+
+    if (bytes_sent <= 0)
+        return PJ_FALSE;
+
+    if (flush) {
+        pj_lock_acquire(tls->base.lock);
+        tls_flush_tx_queue(tls);
+        pj_lock_release(tls->base.lock);
+    }
+
     return PJ_TRUE;
 }
 
@@ -1707,7 +1933,8 @@ static pj_status_t tls_send_msg(pjsip_transport *transport,
                                 pjsip_transport_callback callback)
 {
     struct tls_transport *tls = (struct tls_transport*)transport;
-    pj_ssize_t size;
+    pj_ssize_t size, tdata_size;
+    pj_size_t max_pending;
     pj_bool_t delayed = PJ_FALSE;
     pj_status_t status = PJ_SUCCESS;
 
@@ -1722,6 +1949,24 @@ static pj_status_t tls_send_msg(pjsip_transport *transport,
                                   addr_len==sizeof(pj_sockaddr_in6)),
                      PJ_EINVAL);
 
+    /* Account the message to the bytes waiting to be sent, refusing it if
+     * the connection has too much data pending already.
+     */
+    tdata_size = tdata->buf.cur - tdata->buf.start;
+    max_pending = pjsip_cfg()->tls.max_pending_tx;
+    pj_lock_acquire(tls->base.lock);
+    if (max_pending && tls->tx_pending &&
+        tls->tx_pending + tdata_size > max_pending)
+    {
+        pj_lock_release(tls->base.lock);
+        PJ_LOG(4,(tls->base.obj_name, "Unable to send %s: %lu bytes are "
+                  "pending on the connection", pjsip_tx_data_get_info(tdata),
+                  (unsigned long)tls->tx_pending));
+        return PJ_EBUSY;
+    }
+    tls->tx_pending += tdata_size;
+    pj_lock_release(tls->base.lock);
+
     /* Init op key. */
     tdata->op_key.tdata = tdata;
     tdata->op_key.token = token;
@@ -1769,20 +2014,70 @@ static pj_status_t tls_send_msg(pjsip_transport *transport,
         pj_lock_release(tls->base.lock);
     } 
     
+    if (!delayed && tls->tx_buf_size) {
+        /*
+         * With write coalescing, the message is queued if a write is in
+         * progress or if writes are to be delayed. It will be written
+         * together with other messages once the write completes or the
+         * delay expires.
+         */
+        pj_lock_acquire(tls->base.lock);
+
+        if (tls->tx_inflight || !pj_list_empty(&tls->tx_queue) ||
+            pjsip_cfg()->tls.coalesce_delay)
+        {
+            struct delayed_tdata *pending_tx;
+
+            pending_tx = PJ_POOL_ZALLOC_T(tdata->pool, struct delayed_tdata);
+            pending_tx->tdata_op_key = &tdata->op_key;
+            pj_list_push_back(&tls->tx_queue, pending_tx);
+
+            if (!tls->tx_inflight && !tls->tx_timer.id) {
+                pj_time_val delay;
+
+                delay.sec = 0;
+                delay.msec = pjsip_cfg()->tls.coalesce_delay;
+                pj_time_val_normalize(&delay);
+                pjsip_endpt_schedule_timer(tls->base.endpt, &tls->tx_timer,
+                                           &delay);
+                tls->tx_timer.id = PJ_TRUE;
+            }
+
+            status = PJ_EPENDING;
+            delayed = PJ_TRUE;
+
+            pj_lock_release(tls->base.lock);
+        }
+
+        /* Otherwise the lock is released below, after the write is
+         * recorded as being in progress.
+         */
+    }
+
     if (!delayed) {
         /*
          * Transport is ready to go. Send the packet to ioqueue to be
          * sent asynchronously.
          */
-        size = tdata->buf.cur - tdata->buf.start;
+        size = tdata_size;
         status = pj_ssl_sock_send(tls->ssock, 
                                     (pj_ioqueue_op_key_t*)&tdata->op_key,
                                     tdata->buf.start, &size, 0);
 
+        if (tls->tx_buf_size) {
+            if (status == PJ_EPENDING)
+                tls->tx_inflight = (pj_ioqueue_op_key_t*)&tdata->op_key;
+            pj_lock_release(tls->base.lock);
+        }
+
         if (status != PJ_EPENDING) {
             /* Not pending (could be immediate success or error) */
             tdata->op_key.tdata = NULL;
 
+            pj_lock_acquire(tls->base.lock);
+            tls->tx_pending -= tdata_size;
+            pj_lock_release(tls->base.lock);
+
             /* Shutdown transport on closure/errors */
             if (size <= 0) {
 
@@ -1818,6 +2113,19 @@ static pj_status_t tls_shutdown(pjsip_transport *transport)
 }
 
 
+/* 
+ * This callback is called by transport manager to get the amount of
+ * memory held by the transport. The memory used by the TLS library for
+ * the connection is not included.
+ */
+static pj_size_t tls_get_mem_usage(pjsip_transport *transport)
+{
+    struct tls_transport *tls = (struct tls_transport*)transport;
+
+    return pj_pool_get_capacity(tls->base.pool) + tls->rx_pool_size;
+}
+
+
 /* 
  * Callback from ioqueue that an incoming data is received from the socket.
  */
@@ -1853,6 +2161,20 @@ static pj_bool_t on_data_read(pj_ssl_sock_t *ssock,
 
         pj_assert((void*)rdata->pkt_info.packet == data);
 
+        /* Create the pool for parsing, if it has been released */
+        if (!rdata->tp_info.pool) {
+            rdata->tp_info.pool = pjsip_endpt_create_pool(tls->base.endpt,
+                                                          "rtd%p",
+                                                          PJSIP_POOL_RDATA_LEN,
+                                                          PJSIP_POOL_RDATA_INC);
+            if (!rdata->tp_info.pool) {
+                tls_perror(tls->base.obj_name, "Unable to create pool",
+                           PJ_ENOMEM, NULL);
+                tls_init_shutdown(tls, PJ_ENOMEM);
+                return PJ_FALSE;
+            }
+        }
+
         /* Init pkt_info part. */
         rdata->pkt_info.len = size;
         rdata->pkt_info.zero = 0;
@@ -1887,8 +2209,14 @@ static pj_bool_t on_data_read(pj_ssl_sock_t *ssock,
 
     }
 
-    /* Reset pool. */
-    pj_pool_reset(rdata->tp_info.pool);
+    /* Reset pool, or release it if there is no more data to process. */
+    if (*remainder == 0 && pjsip_cfg()->tls.release_idle_rx_pool) {
+        pj_pool_secure_release(&rdata->tp_info.pool);
+        tls->rx_pool_size = 0;
+    } else {
+        pj_pool_reset(rdata->tp_info.pool);
+        tls->rx_pool_size = pj_pool_get_capacity(rdata->tp_info.pool);
+    }
 
     return PJ_TRUE;
 }
@@ -2197,6 +2525,22 @@ static void wipe_buf(pj_str_t *buf)
 /*
  * Wipe out certificates and keys in the TLS setting buffer.
  */
+PJ_DEF(pj_size_t) pjsip_tls_transport_get_pending_tx(
+                                                pjsip_transport *transport)
+{
+    struct tls_transport *tls = (struct tls_transport*)transport;
+    pj_size_t pending;
+
+    PJ_ASSERT_RETURN(transport, 0);
+
+    pj_lock_acquire(tls->base.lock);
+    pending = tls->tx_pending;
+    pj_lock_release(tls->base.lock);
+
+    return pending;
+}
+
+
 PJ_DEF(void) pjsip_tls_setting_wipe_keys(pjsip_tls_setting *opt)
 {
     wipe_buf(&opt->ca_list_file);
@@ -65,14 +65,30 @@
 #endif
 
 
+/* Additional socket of a transport socket group, bound to the same
+ * address as the transport's main socket with SO_REUSEPORT.
+ */
+struct udp_group_sock
+{
+    pj_sock_t           sock;
+    pj_ioqueue_t       *ioqueue;
+    pj_ioqueue_key_t   *key;
+};
+
 /* Struct udp_transport "inherits" struct pjsip_transport */
 struct udp_transport
 {
     pjsip_transport     base;
     pj_sock_t           sock;
+    pj_ioqueue_t       *ioqueue;
     pj_ioqueue_key_t   *key;
     int                 rdata_cnt;
-    pjsip_rx_data     **rdata;
+    pjsip_rx_data      *rdata;          /* Slab of rdata_cnt rdata.     */
+    int                 async_cnt;      /* Number of rdata per socket.  */
+    unsigned            extra_cnt;      /* Number of group sockets.     */
+    struct udp_group_sock *extra;       /* Group sockets, the rdata of
+                                           extra[i] start at index
+                                           (i+1)*async_cnt.             */
     int                 is_closing;
     pj_bool_t           is_paused;
     int                 read_loop_spin;
@@ -83,18 +99,15 @@ struct udp_transport
 
 
 /*
- * Initialize transport's receive buffer from the specified pool.
+ * Initialize transport's receive buffer. The rdata lives in the transport's
+ * slab of receive buffers, the pool is only used for parsing the messages.
  */
 static void init_rdata(struct udp_transport *tp, unsigned rdata_index,
-                       pj_pool_t *pool, pjsip_rx_data **p_rdata)
+                       pj_pool_t *pool)
 {
-    pjsip_rx_data *rdata;
-
-    /* Reset pool. */
-    //note: already done by caller
-    //pj_pool_reset(pool);
+    pjsip_rx_data *rdata = &tp->rdata[rdata_index];
 
-    rdata = PJ_POOL_ZALLOC_T(pool, pjsip_rx_data);
+    pj_bzero(rdata, sizeof(*rdata));
 
     /* Init tp_info part. */
     rdata->tp_info.pool = pool;
@@ -103,11 +116,31 @@ static void init_rdata(struct udp_transport *tp, unsigned rdata_index,
     rdata->tp_info.op_key.rdata = rdata;
     pj_ioqueue_op_key_init(&rdata->tp_info.op_key.op_key, 
                            sizeof(pj_ioqueue_op_key_t));
+}
 
-    tp->rdata[rdata_index] = rdata;
+/*
+ * Reset the receive buffer for the next packet. Only the parts filled in
+ * for each message are cleared, the packet buffer is left as it is, and
+ * the pool normally has only the first block to reset as the rdata is not
+ * allocated from it.
+ */
+static void reset_rdata(pjsip_rx_data *rdata)
+{
+    pj_pool_reset(rdata->tp_info.pool);
+    pj_bzero(&rdata->msg_info, sizeof(rdata->msg_info));
+    pj_bzero(&rdata->endpt_info, sizeof(rdata->endpt_info));
+    pj_ioqueue_op_key_init(&rdata->tp_info.op_key.op_key, 
+                           sizeof(pj_ioqueue_op_key_t));
+}
+
+
+/* Get the ioqueue key of the socket that reads the specified rdata. */
+static pj_ioqueue_key_t *get_rdata_key(struct udp_transport *tp,
+                                       int rdata_index)
+{
+    unsigned sock_idx = rdata_index / tp->async_cnt;
 
-    if (p_rdata)
-        *p_rdata = rdata;
+    return sock_idx == 0 ? tp->key : tp->extra[sock_idx-1].key;
 }
 
 
@@ -221,31 +254,19 @@ static void udp_on_read_complete( pj_ioqueue_key_t *key,
         if (i >= MAX_IMMEDIATE_PACKET) {
             /* Force ioqueue_recvfrom() to return PJ_EPENDING */
             flags = PJ_IOQUEUE_ALWAYS_ASYNC;
+#if PJ_IOQUEUE_DGRAM_BATCH > 1
+        } else if (tp->rdata_cnt > 1) {
+            /* Keep all rdata pending so that the ioqueue can fill them
+             * with one recvmmsg() on the next readiness event.
+             */
+            flags = PJ_IOQUEUE_ALWAYS_ASYNC;
+#endif
         } else {
             flags = 0;
         }
 
-        /* Reset pool. 
-         * Need to copy rdata fields to temp variable because they will
-         * be invalid after pj_pool_reset().
-         */
-        {
-            pj_pool_t *rdata_pool = rdata->tp_info.pool;
-            struct udp_transport *rdata_tp ;
-            unsigned rdata_index;
-
-            rdata_tp = (struct udp_transport*)rdata->tp_info.transport;
-            rdata_index = (unsigned)(unsigned long)(pj_ssize_t)
-                          rdata->tp_info.tp_data;
-
-            pj_pool_reset(rdata_pool);
-            init_rdata(rdata_tp, rdata_index, rdata_pool, &rdata);
-
-            /* Change some vars to point to new location after
-             * pool reset.
-             */
-            op_key = &rdata->tp_info.op_key.op_key;
-        }
+        /* Reset rdata for the next packet. */
+        reset_rdata(rdata);
 
         /* Only read next packet if transport is not being paused. This
          * check handles the case where transport is paused while endpoint
@@ -412,6 +433,26 @@ static pj_status_t udp_send_msg( pjsip_transport *transport,
 }
 
 
+/* Close the group sockets, if any. */
+static void close_group_socks(struct udp_transport *tp)
+{
+    unsigned i;
+
+    for (i=0; i<tp->extra_cnt; ++i) {
+        struct udp_group_sock *gs = &tp->extra[i];
+
+        if (gs->key) {
+            /* This implicitly closes the socket */
+            pj_ioqueue_unregister(gs->key);
+            gs->key = NULL;
+        } else if (gs->sock != PJ_INVALID_SOCKET) {
+            pj_sock_close(gs->sock);
+        }
+        gs->sock = PJ_INVALID_SOCKET;
+    }
+}
+
+
 /* Clean up UDP resources */
 static void udp_on_destroy(void *arg)
 {
@@ -420,7 +461,7 @@ static void udp_on_destroy(void *arg)
 
     /* Destroy rdata */
     for (i=0; i<tp->rdata_cnt; ++i) {
-        pj_pool_release(tp->rdata[i]->tp_info.pool);
+        pj_pool_release(tp->rdata[i].tp_info.pool);
     }
 
     /* Destroy reference counter. */
@@ -460,7 +501,7 @@ static pj_status_t udp_destroy( pjsip_transport *transport )
      *
     for (i=0; i<tp->rdata_cnt; ++i) {
         pj_ioqueue_post_completion(tp->key, 
-                                   &tp->rdata[i]->tp_info.op_key.op_key, -1);
+                                   &tp->rdata[i].tp_info.op_key.op_key, -1);
     }
     */
 
@@ -475,17 +516,22 @@ static pj_status_t udp_destroy( pjsip_transport *transport )
             tp->sock = PJ_INVALID_SOCKET;
         }
     }
+    close_group_socks(tp);
 
     /* Must poll ioqueue because IOCP calls the callback when socket
      * is closed. We poll the ioqueue until all pending callbacks 
      * have been called.
      */
-    for (i=0; i<50 && tp->is_closing < 1+tp->rdata_cnt; ++i) {
+    for (i=0; tp->ioqueue && i<50 && tp->is_closing < 1+tp->rdata_cnt; ++i) {
         int cnt;
+        unsigned j;
         pj_time_val timeout = {0, 1};
 
-        cnt = pj_ioqueue_poll(pjsip_endpt_get_ioqueue(transport->endpt), 
-                              &timeout);
+        cnt = pj_ioqueue_poll(tp->ioqueue, &timeout);
+        for (j=0; j<tp->extra_cnt; ++j) {
+            if (tp->extra[j].ioqueue && tp->extra[j].ioqueue != tp->ioqueue)
+                cnt += pj_ioqueue_poll(tp->extra[j].ioqueue, &timeout);
+        }
         if (cnt == 0)
             break;
     }
@@ -524,9 +570,13 @@ static pj_status_t udp_shutdown(pjsip_transport *transport)
 }
 
 
-/* Create socket */
+/* Create socket. If reuse_port is set, the socket is created with
+ * SO_REUSEPORT so that the other sockets of the group can be bound to
+ * the same address.
+ */
 static pj_status_t create_socket(int af, const pj_sockaddr_t *local_a,
-                                 int addr_len, pj_sock_t *p_sock)
+                                 int addr_len, pj_bool_t reuse_port,
+                                 pj_sock_t *p_sock)
 {
     pj_sock_t sock;
     pj_sockaddr_in tmp_addr;
@@ -537,6 +587,17 @@ static pj_status_t create_socket(int af, const pj_sockaddr_t *local_a,
     if (status != PJ_SUCCESS)
         return status;
 
+    if (reuse_port) {
+        int enabled = 1;
+
+        status = pj_sock_setsockopt(sock, pj_SOL_SOCKET(), pj_SO_REUSEPORT(),
+                                    &enabled, sizeof(enabled));
+        if (status != PJ_SUCCESS) {
+            pj_sock_close(sock);
+            return status;
+        }
+    }
+
     if (local_a == NULL) {
         if (af == pj_AF_INET6()) {
             pj_bzero(&tmp_addr6, sizeof(tmp_addr6));
@@ -697,13 +758,54 @@ static void udp_set_socket(struct udp_transport *tp,
     udp_set_pub_name(tp, a_name);
 }
 
+/* Get the ioqueue for the socket at the specified index of the group.
+ * When ioqueue shards are used, the sockets of a group are spread over
+ * the shards so that each socket is read by a different worker thread.
+ * A transport with a single socket stays on the endpoint's ioqueue, as
+ * it would only move its whole load to the one thread polling the shard.
+ */
+static pj_ioqueue_t *get_sock_ioqueue(struct udp_transport *tp,
+                                      unsigned sock_idx)
+{
+    pj_ioqueue_group_t *grp = pjsip_endpt_get_ioqueue_group(tp->base.endpt);
+
+    if (grp && tp->extra_cnt) {
+        return pj_ioqueue_group_get(grp,
+                                    sock_idx % pj_ioqueue_group_get_count(grp));
+    }
+    return pjsip_endpt_get_ioqueue(tp->base.endpt);
+}
+
 /* Register socket to ioqueue */
 static pj_status_t register_to_ioqueue(struct udp_transport *tp)
 {
     pj_ioqueue_t *ioqueue;
     pj_ioqueue_callback ioqueue_cb;
+    unsigned i;
     pj_status_t status;
 
+    pj_memset(&ioqueue_cb, 0, sizeof(ioqueue_cb));
+    ioqueue_cb.on_read_complete = &udp_on_read_complete;
+    ioqueue_cb.on_write_complete = &udp_on_write_complete;
+
+    /* Register the group sockets which are not registered yet. They
+     * share the transport's group lock, which has been created when the
+     * main socket was registered.
+     */
+    for (i=0; tp->grp_lock && i<tp->extra_cnt; ++i) {
+        struct udp_group_sock *gs = &tp->extra[i];
+
+        if (gs->key != NULL || gs->sock == PJ_INVALID_SOCKET)
+            continue;
+
+        gs->ioqueue = get_sock_ioqueue(tp, i+1);
+        status = pj_ioqueue_register_sock2(tp->base.pool, gs->ioqueue,
+                                           gs->sock, tp->grp_lock, tp,
+                                           &ioqueue_cb, &gs->key);
+        if (status != PJ_SUCCESS)
+            return status;
+    }
+
     /* Ignore if already registered */
     if (tp->key != NULL)
         return PJ_SUCCESS;
@@ -721,14 +823,54 @@ static pj_status_t register_to_ioqueue(struct udp_transport *tp)
         tp->base.grp_lock = tp->grp_lock;
     }
     
-    /* Register to ioqueue. */
-    ioqueue = pjsip_endpt_get_ioqueue(tp->base.endpt);
-    pj_memset(&ioqueue_cb, 0, sizeof(ioqueue_cb));
-    ioqueue_cb.on_read_complete = &udp_on_read_complete;
-    ioqueue_cb.on_write_complete = &udp_on_write_complete;
+    /* Register to ioqueue (or one of the shards, if configured). */
+    ioqueue = get_sock_ioqueue(tp, 0);
+    tp->ioqueue = ioqueue;
+    status = pj_ioqueue_register_sock2(tp->base.pool, ioqueue, tp->sock,
+                                       tp->grp_lock, tp, &ioqueue_cb,
+                                       &tp->key);
+    if (status != PJ_SUCCESS)
+        return status;
+
+    /* Now the group sockets, if any */
+    return register_to_ioqueue(tp);
+}
+
+/* Create the sockets of the transport's socket group, bound to the same
+ * address as the main socket (which must have been created with
+ * SO_REUSEPORT). The QoS and socket options are applied if cfg is
+ * specified.
+ */
+static pj_status_t create_group_socks(struct udp_transport *tp,
+                                      const pjsip_udp_transport_cfg *cfg)
+{
+    unsigned i;
+    pj_status_t status;
+
+    for (i=0; i<tp->extra_cnt; ++i) {
+        struct udp_group_sock *gs = &tp->extra[i];
+
+        if (gs->sock != PJ_INVALID_SOCKET)
+            continue;
+
+        status = create_socket(tp->base.local_addr.addr.sa_family,
+                               &tp->base.local_addr,
+                               pj_sockaddr_get_len(&tp->base.local_addr),
+                               PJ_TRUE, &gs->sock);
+        if (status != PJ_SUCCESS) {
+            gs->sock = PJ_INVALID_SOCKET;
+            return status;
+        }
 
-    return pj_ioqueue_register_sock2(tp->base.pool, ioqueue, tp->sock,
-                                     tp->grp_lock, tp, &ioqueue_cb, &tp->key);
+        if (cfg) {
+            pj_sock_apply_qos2(gs->sock, cfg->qos_type, &cfg->qos_params,
+                               2, THIS_FILE, "SIP UDP transport");
+            if (cfg->sockopt_params.cnt)
+                pj_sock_setsockopt_params(gs->sock, &cfg->sockopt_params);
+        }
+    }
+
+    return PJ_SUCCESS;
 }
 
 /* Start ioqueue asynchronous reading to all rdata */
@@ -739,19 +881,24 @@ static pj_status_t start_async_read(struct udp_transport *tp)
 
     /* Start reading the ioqueue. */
     for (i=0; i<tp->rdata_cnt; ++i) {
+        pj_ioqueue_key_t *key = get_rdata_key(tp, i);
         pj_ssize_t size;
 
-        size = sizeof(tp->rdata[i]->pkt_info.packet);
-        tp->rdata[i]->pkt_info.src_addr_len = sizeof(tp->rdata[i]->pkt_info.src_addr);
-        status = pj_ioqueue_recvfrom(tp->key, 
-                                     &tp->rdata[i]->tp_info.op_key.op_key,
-                                     tp->rdata[i]->pkt_info.packet,
+        /* Skip group socket which failed to be (re)created */
+        if (key == NULL)
+            continue;
+
+        size = sizeof(tp->rdata[i].pkt_info.packet);
+        tp->rdata[i].pkt_info.src_addr_len = sizeof(tp->rdata[i].pkt_info.src_addr);
+        status = pj_ioqueue_recvfrom(key, 
+                                     &tp->rdata[i].tp_info.op_key.op_key,
+                                     tp->rdata[i].pkt_info.packet,
                                      &size, PJ_IOQUEUE_ALWAYS_ASYNC,
-                                     &tp->rdata[i]->pkt_info.src_addr,
-                                     &tp->rdata[i]->pkt_info.src_addr_len);
+                                     &tp->rdata[i].pkt_info.src_addr,
+                                     &tp->rdata[i].pkt_info.src_addr_len);
         if (status == PJ_SUCCESS) {
             pj_assert(!"Shouldn't happen because PJ_IOQUEUE_ALWAYS_ASYNC!");
-            udp_on_read_complete(tp->key, &tp->rdata[i]->tp_info.op_key.op_key,
+            udp_on_read_complete(key, &tp->rdata[i].tp_info.op_key.op_key,
                                  size);
         } else if (status != PJ_EPENDING) {
             /* Error! */
@@ -773,6 +920,7 @@ static pj_status_t transport_attach( pjsip_endpoint *endpt,
                                      pj_sock_t sock,
                                      const pjsip_host_port *a_name,
                                      unsigned async_cnt,
+                                     const pjsip_udp_transport_cfg *cfg,
                                      pjsip_transport **p_transport)
 {
     pj_pool_t *pool;
@@ -866,6 +1014,21 @@ static pj_status_t transport_attach( pjsip_endpoint *endpt,
     /* Attach socket and assign name. */
     udp_set_socket(tp, sock, a_name);
 
+    /* Create the rest of the socket group, if configured. */
+    tp->async_cnt = async_cnt;
+    if (cfg && cfg->sock_cnt > 1) {
+        tp->extra_cnt = cfg->sock_cnt - 1;
+        tp->extra = (struct udp_group_sock*)
+                    pj_pool_calloc(pool, tp->extra_cnt,
+                                   sizeof(struct udp_group_sock));
+        for (i=0; i<tp->extra_cnt; ++i)
+            tp->extra[i].sock = PJ_INVALID_SOCKET;
+
+        status = create_group_socks(tp, cfg);
+        if (status != PJ_SUCCESS)
+            goto on_error;
+    }
+
     /* Register to ioqueue */
     status = register_to_ioqueue(tp);
     if (status != PJ_SUCCESS)
@@ -888,14 +1051,17 @@ static pj_status_t transport_attach( pjsip_endpoint *endpt,
      */
     pjsip_transport_add_ref(&tp->base);
 
-    /* Create rdata and put it in the array. */
+    /* Create the slab of rdata, which are reused for every packet
+     * received for as long as the transport lives. Each socket of the
+     * group gets async_cnt of them.
+     */
     tp->rdata_cnt = 0;
-    tp->rdata = (pjsip_rx_data**)
-                pj_pool_calloc(tp->base.pool, async_cnt, 
-                               sizeof(pjsip_rx_data*));
-    for (i=0; i<async_cnt; ++i) {
+    tp->rdata = (pjsip_rx_data*)
+                pj_pool_calloc(tp->base.pool, async_cnt * (1+tp->extra_cnt),
+                               sizeof(pjsip_rx_data));
+    for (i=0; i<async_cnt * (1+tp->extra_cnt); ++i) {
         pj_pool_t *rdata_pool = pjsip_endpt_create_pool(endpt, "rtd%p", 
-                                                        PJSIP_POOL_RDATA_LEN,
+                                                        PJSIP_POOL_UDP_RDATA_LEN,
                                                         PJSIP_POOL_RDATA_INC);
         if (!rdata_pool) {
             pj_atomic_set(tp->base.ref_cnt, 0);
@@ -903,7 +1069,7 @@ static pj_status_t transport_attach( pjsip_endpoint *endpt,
             return PJ_ENOMEM;
         }
 
-        init_rdata(tp, i, rdata_pool, NULL);
+        init_rdata(tp, i, rdata_pool);
         tp->rdata_cnt++;
     }
 
@@ -919,13 +1085,15 @@ static pj_status_t transport_attach( pjsip_endpoint *endpt,
         *p_transport = &tp->base;
     
     PJ_LOG(4,(tp->base.obj_name, 
-              "SIP %s started, published address is %s%.*s%s:%d",
+              "SIP %s started, published address is %s%.*s%s:%d, "
+              "%d socket(s)",
               pjsip_transport_get_type_desc((pjsip_transport_type_e)tp->base.key.type),
               ipv6_quoteb,
               (int)tp->base.local_name.host.slen,
               tp->base.local_name.host.ptr,
               ipv6_quotee,
-              tp->base.local_name.port));
+              tp->base.local_name.port,
+              1+tp->extra_cnt));
 
     return PJ_SUCCESS;
 
@@ -942,7 +1110,7 @@ PJ_DEF(pj_status_t) pjsip_udp_transport_attach( pjsip_endpoint *endpt,
                                                 pjsip_transport **p_transport)
 {
     return transport_attach(endpt, PJSIP_TRANSPORT_UDP, sock, a_name,
-                            async_cnt, p_transport);
+                            async_cnt, NULL, p_transport);
 }
 
 PJ_DEF(pj_status_t) pjsip_udp_transport_attach2( pjsip_endpoint *endpt,
@@ -953,7 +1121,7 @@ PJ_DEF(pj_status_t) pjsip_udp_transport_attach2( pjsip_endpoint *endpt,
                                                  pjsip_transport **p_transport)
 {
     return transport_attach(endpt, type, sock, a_name,
-                            async_cnt, p_transport);
+                            async_cnt, NULL, p_transport);
 }
 
 
@@ -967,6 +1135,7 @@ PJ_DEF(void) pjsip_udp_transport_cfg_default(pjsip_udp_transport_cfg *cfg,
     cfg->af = af;
     pj_sockaddr_init(cfg->af, &cfg->bind_addr, NULL, 0);
     cfg->async_cnt = 1;
+    cfg->sock_cnt = 1;
 }
 
 
@@ -990,6 +1159,10 @@ PJ_DEF(pj_status_t) pjsip_udp_transport_start2(
 
     PJ_ASSERT_RETURN(endpt && cfg && cfg->async_cnt, PJ_EINVAL);
 
+    /* Socket group needs SO_REUSEPORT */
+    if (cfg->sock_cnt > 1 && pj_SO_REUSEPORT() == 0xFFFF)
+        return PJ_ENOTSUP;
+
     if (cfg->bind_addr.addr.sa_family == pj_AF_INET()) {
         af = pj_AF_INET();
         transport_type = PJSIP_TRANSPORT_UDP;
@@ -1000,7 +1173,8 @@ PJ_DEF(pj_status_t) pjsip_udp_transport_start2(
         addr_len = sizeof(pj_sockaddr_in6);
     }
 
-    status = create_socket(af, &cfg->bind_addr, addr_len, &sock);
+    status = create_socket(af, &cfg->bind_addr, addr_len,
+                           cfg->sock_cnt > 1, &sock);
     if (status != PJ_SUCCESS)
         return status;
 
@@ -1026,9 +1200,8 @@ PJ_DEF(pj_status_t) pjsip_udp_transport_start2(
         addr_name = cfg->addr_name;
     }
 
-    return pjsip_udp_transport_attach2(endpt, transport_type, sock,
-                                       &addr_name, cfg->async_cnt,
-                                       p_transport);
+    return transport_attach(endpt, transport_type, sock, &addr_name,
+                            cfg->async_cnt, cfg, p_transport);
 }
 
 /*
@@ -1119,8 +1292,13 @@ PJ_DEF(pj_status_t) pjsip_udp_transport_pause(pjsip_transport *transport,
 
     /* Cancel the ioqueue operation. */
     for (i=0; i<(unsigned)tp->rdata_cnt; ++i) {
-        pj_ioqueue_post_completion(tp->key, 
-                                   &tp->rdata[i]->tp_info.op_key.op_key, -1);
+        pj_ioqueue_key_t *key = get_rdata_key(tp, i);
+
+        if (key) {
+            pj_ioqueue_post_completion(key,
+                                       &tp->rdata[i].tp_info.op_key.op_key,
+                                       -1);
+        }
     }
 
     /* Destroy the socket? */
@@ -1137,7 +1315,7 @@ PJ_DEF(pj_status_t) pjsip_udp_transport_pause(pjsip_transport *transport,
             }
         }
         tp->sock = PJ_INVALID_SOCKET;
-        
+        close_group_socks(tp);
     }
 
     PJ_LOG(4,(tp->base.obj_name, "SIP UDP transport paused"));
@@ -1207,12 +1385,13 @@ PJ_DEF(pj_status_t) pjsip_udp_transport_restart2(pjsip_transport *transport,
             }
         }
         tp->sock = PJ_INVALID_SOCKET;
+        close_group_socks(tp);
 
         /* Create the socket if it's not specified */
         if (sock == PJ_INVALID_SOCKET) {
             status = create_socket(local?local->addr.sa_family:pj_AF_UNSPEC(), 
                                    local, local?pj_sockaddr_get_len(local):0, 
-                                   &sock);
+                                   tp->extra_cnt != 0, &sock);
             if (status != PJ_SUCCESS)
                 return status;
         }
@@ -1242,6 +1421,18 @@ PJ_DEF(pj_status_t) pjsip_udp_transport_restart2(pjsip_transport *transport,
         /* Assign the socket and published address to transport. */
         udp_set_socket(tp, sock, a_name);
 
+        /* Recreate the socket group. This fails if the application
+         * supplied a socket without SO_REUSEPORT, in which case the
+         * transport continues with the main socket only.
+         */
+        if (tp->extra_cnt) {
+            status = create_group_socks(tp, NULL);
+            if (status != PJ_SUCCESS) {
+                PJ_PERROR(2,(tp->base.obj_name, status,
+                             "Unable to recreate UDP socket group"));
+            }
+        }
+
     } else {
 
         /* For KEEP_SOCKET, transport must have been paused before */
@@ -1265,7 +1456,7 @@ PJ_DEF(pj_status_t) pjsip_udp_transport_restart2(pjsip_transport *transport,
 
     /* Re-init op_key. */
     for (i = 0; i < tp->rdata_cnt; ++i) {
-        pj_ioqueue_op_key_init(&tp->rdata[i]->tp_info.op_key.op_key,
+        pj_ioqueue_op_key_init(&tp->rdata[i].tp_info.op_key.op_key,
                                sizeof(pj_ioqueue_op_key_t));
     }
 
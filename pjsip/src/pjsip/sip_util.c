@@ -1134,6 +1134,12 @@ static void stateless_send_transport_cb( void *token,
     PJ_UNUSED_ARG(tdata);
     pj_assert(tdata == stateless_data->tdata);
 
+    /* The message may have been modified since it was last sent, so it
+     * needs to be printed again on the first attempt.
+     */
+    if (sent == -PJ_EPENDING)
+        pjsip_tx_data_invalidate_msg(tdata);
+
     for (;;) {
         pj_status_t status;
         pj_bool_t cont;
@@ -1143,6 +1149,8 @@ static void stateless_send_transport_cb( void *token,
         int cur_addr_len;
 
         pjsip_via_hdr *via;
+        pjsip_via_hdr old_via;
+        unsigned old_param_cnt;
 
         if (sent == -PJ_EPENDING) {
             /* This is the initial process.
@@ -1229,6 +1237,12 @@ static void stateless_send_transport_cb( void *token,
             pjsip_msg_insert_first_hdr(tdata->msg, (pjsip_hdr*)via);
         }
 
+        /* Remember the Via, to see whether the message needs to be
+         * printed again for this transport.
+         */
+        old_via = *via;
+        old_param_cnt = (unsigned) pj_list_size(&via->other_param);
+
         if (tdata->msg->line.req.method.id == PJSIP_CANCEL_METHOD) {
             if (via->sent_by.host.slen > 0) {
                 /* Don't update Via header on a CANCEL request if the sent-by
@@ -1298,7 +1312,20 @@ static void stateless_send_transport_cb( void *token,
             }
         }
 
-        pjsip_tx_data_invalidate_msg(tdata);
+        /* The message only needs to be printed again when the Via has
+         * changed. Otherwise, e.g. when failing over to the next address
+         * over the same transport, the buffer from the previous attempt
+         * can be used as is.
+         */
+        if (pj_strcmp(&via->transport, &old_via.transport) ||
+            pj_strcmp(&via->sent_by.host, &old_via.sent_by.host) ||
+            via->sent_by.port != old_via.sent_by.port ||
+            via->rport_param != old_via.rport_param ||
+            pj_strcmp(&via->branch_param, &old_via.branch_param) ||
+            pj_list_size(&via->other_param) != old_param_cnt)
+        {
+            pjsip_tx_data_invalidate_msg(tdata);
+        }
 
         /* Send message using this transport. */
         status = pjsip_transport_send( stateless_data->cur_transport,
@@ -29,6 +29,17 @@
 #include <pjlib-util/md5.h>
 
 
+#define IS_NEWLINE(c)   ((c)=='\r' || (c)=='\n')
+#define IS_SPACE(c)     ((c)==' ' || (c)=='\t')
+
+static const pj_str_t STR_VIA = { "Via", 3 };
+static const pj_str_t STR_MAX_FORWARDS = { "Max-Forwards", 12 };
+static const pj_str_t STR_ROUTE = { "Route", 5 };
+static const pj_str_t STR_RECORD_ROUTE = { "Record-Route", 12 };
+static const pj_str_t STR_CONTENT_LENGTH = { "Content-Length", 14 };
+static const pj_str_t STR_CONTENT_TYPE = { "Content-Type", 12 };
+
+
 /**
  * Clone the incoming SIP request or response message. A forwarding proxy
  * typically would need to clone the incoming SIP message before processing
@@ -66,6 +77,228 @@ PJ_DEF(pj_status_t) pjsip_endpt_clone_msg( pjsip_endpoint *endpt,
 */
 
 
+/* Skip whitespaces, including line folding. */
+static char *skip_raw_ws(char *p, const char *end)
+{
+    for (;;) {
+        char *q;
+
+        while (p != end && IS_SPACE(*p))
+            ++p;
+
+        q = p;
+        if (q != end && *q == '\r')
+            ++q;
+        if (q != end && *q == '\n')
+            ++q;
+        if (q == p || q == end || !IS_SPACE(*q))
+            return p;
+        p = q;
+    }
+}
+
+/* Find the end of the line, i.e. the first CR or LF. */
+static char *find_eol(char *p, const char *end)
+{
+    char *lf, *cr;
+
+    lf = (char*) pj_memchr(p, '\n', end - p);
+    if (!lf)
+        lf = (char*) end;
+    cr = (char*) pj_memchr(p, '\r', lf - p);
+    return cr ? cr : lf;
+}
+
+/* Get the next header line in a received packet which has been parsed
+ * successfully. Returns the start of the next line, or NULL at the end
+ * of the headers.
+ */
+static char *get_raw_hdr(char *p, const char *end, pj_str_t *hname,
+                         pj_str_t *hvalue)
+{
+    char *s;
+
+    if (p == end || IS_NEWLINE(*p))
+        return NULL;
+
+    for (s = p; s != end && *s != ':' && !IS_NEWLINE(*s); ++s)
+        ;
+    if (s == end || *s != ':')
+        return NULL;
+
+    hname->ptr = p;
+    hname->slen = s - p;
+    while (hname->slen && IS_SPACE(p[hname->slen-1]))
+        --hname->slen;
+
+    /* The value, including continuation lines */
+    s = skip_raw_ws(s+1, end);
+    hvalue->ptr = s;
+    for (;;) {
+        s = find_eol(s, end);
+        hvalue->slen = s - hvalue->ptr;
+        if (s != end && *s == '\r')
+            ++s;
+        if (s != end && *s == '\n')
+            ++s;
+        if (s == end || !IS_SPACE(*s))
+            break;
+    }
+
+    return s;
+}
+
+static pj_bool_t is_hname(const pj_str_t *hname, const pj_str_t *name,
+                          char sname)
+{
+    if (hname->slen == 1)
+        return sname && pj_tolower(hname->ptr[0]) == sname;
+    return hname->slen == name->slen && pj_stricmp(hname, name) == 0;
+}
+
+/* Clone the parsed headers of the specified type in the received message,
+ * except the one to skip.
+ */
+static void clone_hdrs(pj_pool_t *pool, pjsip_msg *dst, const pjsip_msg *src,
+                       pjsip_hdr_e type, const void *skip)
+{
+    const pjsip_hdr *hsrc;
+
+    for (hsrc = src->hdr.next; hsrc != &src->hdr; hsrc = hsrc->next) {
+        if (hsrc->type == type && hsrc != skip) {
+            pjsip_msg_add_hdr(dst,
+                              (pjsip_hdr*)pjsip_hdr_clone(pool, hsrc));
+        }
+    }
+}
+
+/* Create our Via header for the forwarded request. */
+static pjsip_via_hdr *create_fwd_via(pjsip_tx_data *tdata,
+                                     pjsip_rx_data *rdata,
+                                     const pj_str_t *branch)
+{
+    pjsip_via_hdr *hvia;
+
+    hvia = pjsip_via_hdr_create(tdata->pool);
+    if (branch)
+        pj_strdup(tdata->pool, &hvia->branch_param, branch);
+    else {
+        pj_str_t new_branch = pjsip_calculate_branch_id(rdata);
+        pj_strdup(tdata->pool, &hvia->branch_param, &new_branch);
+    }
+    return hvia;
+}
+
+/* Add the headers of the received message to the forwarded message,
+ * keeping them as spans of a single copy of the packet (see
+ * PJSIP_FWD_RAW_HDR). The headers which a proxy modifies are cloned from
+ * the parsed message instead, at the position of their first line, since
+ * only the order of headers with the same name matters. new_via is our
+ * Via for a request, or NULL for a response.
+ */
+static void add_raw_hdrs(pjsip_tx_data *tdata, pjsip_rx_data *rdata,
+                         pjsip_via_hdr *new_via)
+{
+    const pjsip_msg *src = rdata->msg_info.msg;
+    pjsip_msg *dst = tdata->msg;
+    pj_pool_t *pool = tdata->pool;
+    pj_bool_t has_via = PJ_FALSE, has_route = PJ_FALSE, has_rr = PJ_FALSE;
+    char *buf, *p, *end;
+    pj_str_t hname, hvalue;
+
+    /* Copy the packet once */
+    buf = (char*) pj_pool_alloc(pool, rdata->msg_info.len);
+    pj_memcpy(buf, rdata->msg_info.msg_buf, rdata->msg_info.len);
+    end = buf + rdata->msg_info.len;
+
+    /* Skip the request or status line */
+    for (p = buf; p != end && IS_NEWLINE(*p); ++p)
+        ;
+    p = find_eol(p, end);
+    if (p != end && *p == '\r')
+        ++p;
+    if (p != end && *p == '\n')
+        ++p;
+
+    while ((p = get_raw_hdr(p, end, &hname, &hvalue)) != NULL) {
+
+        if (is_hname(&hname, &STR_VIA, 'v')) {
+            if (new_via) {
+                /* Request: our Via goes on top. The others come from the
+                 * parsed message, since the transport may have added
+                 * received and rport to the top one.
+                 */
+                if (!has_via) {
+                    pjsip_msg_add_hdr(dst, (pjsip_hdr*)new_via);
+                    clone_hdrs(pool, dst, src, PJSIP_H_VIA, NULL);
+                }
+                has_via = PJ_TRUE;
+                continue;
+            } else {
+                /* Response: remove the first Via, which may share the
+                 * line with the others.
+                 */
+                if (!has_via) {
+                    clone_hdrs(pool, dst, src, PJSIP_H_VIA,
+                               rdata->msg_info.via);
+                }
+                has_via = PJ_TRUE;
+                continue;
+            }
+
+        } else if (new_via && rdata->msg_info.max_fwd &&
+                   is_hname(&hname, &STR_MAX_FORWARDS, 0))
+        {
+            pjsip_max_fwd_hdr *hmaxfwd;
+
+            hmaxfwd = (pjsip_max_fwd_hdr*)
+                      pjsip_hdr_clone(pool, rdata->msg_info.max_fwd);
+            --hmaxfwd->ivalue;
+            pjsip_msg_add_hdr(dst, (pjsip_hdr*)hmaxfwd);
+            continue;
+
+        } else if (is_hname(&hname, &STR_ROUTE, 0)) {
+            if (!has_route)
+                clone_hdrs(pool, dst, src, PJSIP_H_ROUTE, NULL);
+            has_route = PJ_TRUE;
+            continue;
+
+        } else if (is_hname(&hname, &STR_RECORD_ROUTE, 0)) {
+            if (!has_rr)
+                clone_hdrs(pool, dst, src, PJSIP_H_RECORD_ROUTE, NULL);
+            has_rr = PJ_TRUE;
+            continue;
+
+        } else if (is_hname(&hname, &STR_CONTENT_LENGTH, 'l') ||
+                   is_hname(&hname, &STR_CONTENT_TYPE, 'c'))
+        {
+            /* Generated when the message is printed */
+            continue;
+        }
+
+        pjsip_msg_add_hdr(dst, (pjsip_hdr*)
+                          pjsip_lazy_hdr_create(pool, &hname, &hvalue));
+    }
+
+    /* The body is in the copy too */
+    if (src->body && src->body->print_body == &pjsip_print_text_body &&
+        (char*)src->body->data >= rdata->msg_info.msg_buf &&
+        (char*)src->body->data + src->body->len <=
+            rdata->msg_info.msg_buf + rdata->msg_info.len)
+    {
+        pjsip_msg_body *body = PJ_POOL_ZALLOC_T(pool, pjsip_msg_body);
+
+        pjsip_media_type_cp(pool, &body->content_type,
+                            &src->body->content_type);
+        body->data = buf + ((char*)src->body->data - rdata->msg_info.msg_buf);
+        body->len = src->body->len;
+        body->print_body = &pjsip_print_text_body;
+        body->clone_data = &pjsip_clone_text_data;
+        dst->body = body;
+    }
+}
+
+
 /*
  * Create new request message to be forwarded upstream to new destination URI 
  * in uri. 
@@ -86,9 +319,6 @@ PJ_DEF(pj_status_t) pjsip_endpt_create_request_fwd(pjsip_endpoint *endpt,
     PJ_ASSERT_RETURN(rdata->msg_info.msg->type == PJSIP_REQUEST_MSG, 
                      PJSIP_ENOTREQUESTMSG);
 
-    PJ_UNUSED_ARG(options);
-
-
     /* Request forwarding rule in RFC 3261 section 16.6:
      *
      * For each target, the proxy forwards the request following these
@@ -138,8 +368,14 @@ PJ_DEF(pj_status_t) pjsip_endpt_create_request_fwd(pjsip_endpoint *endpt,
                                pjsip_uri_clone(tdata->pool, src->line.req.uri);
         }
 
+        if (options & PJSIP_FWD_RAW_HDR) {
+            add_raw_hdrs(tdata, rdata, create_fwd_via(tdata, rdata, branch));
+            hsrc = &src->hdr;
+        } else {
+            hsrc = src->hdr.next;
+        }
+
         /* Clone ALL headers */
-        hsrc = src->hdr.next;
         while (hsrc != &src->hdr) {
 
             pjsip_hdr *hdst;
@@ -148,15 +384,8 @@ PJ_DEF(pj_status_t) pjsip_endpt_create_request_fwd(pjsip_endpoint *endpt,
              * cloning the header.
              */
             if (hsrc == (pjsip_hdr*)rdata->msg_info.via) {
-                pjsip_via_hdr *hvia;
-                hvia = pjsip_via_hdr_create(tdata->pool);
-                if (branch)
-                    pj_strdup(tdata->pool, &hvia->branch_param, branch);
-                else {
-                    pj_str_t new_branch = pjsip_calculate_branch_id(rdata);
-                    pj_strdup(tdata->pool, &hvia->branch_param, &new_branch);
-                }
-                pjsip_msg_add_hdr(dst, (pjsip_hdr*)hvia);
+                pjsip_msg_add_hdr(dst, (pjsip_hdr*)
+                                  create_fwd_via(tdata, rdata, branch));
 
             }
             /* Skip Content-Type and Content-Length as these would be 
@@ -223,7 +452,7 @@ PJ_DEF(pj_status_t) pjsip_endpt_create_request_fwd(pjsip_endpoint *endpt,
         }
 
         /* Clone request body */
-        if (src->body) {
+        if (src->body && !dst->body) {
             dst->body = pjsip_msg_body_clone(tdata->pool, src->body);
         }
 
@@ -254,8 +483,6 @@ PJ_DEF(pj_status_t) pjsip_endpt_create_response_fwd( pjsip_endpoint *endpt,
     pj_status_t status;
     PJ_USE_EXCEPTION;
 
-    PJ_UNUSED_ARG(options);
-
     status = pjsip_endpt_create_tdata(endpt, &tdata);
     if (status != PJ_SUCCESS)
         return status;
@@ -275,8 +502,14 @@ PJ_DEF(pj_status_t) pjsip_endpt_create_response_fwd( pjsip_endpoint *endpt,
         pj_strdup(tdata->pool, &dst->line.status.reason, 
                   &src->line.status.reason);
 
+        if (options & PJSIP_FWD_RAW_HDR) {
+            add_raw_hdrs(tdata, rdata, NULL);
+            hsrc = &src->hdr;
+        } else {
+            hsrc = src->hdr.next;
+        }
+
         /* Duplicate all headers */
-        hsrc = src->hdr.next;
         while (hsrc != &src->hdr) {
             
             /* Skip Content-Type and Content-Length as these would be 
@@ -303,7 +536,7 @@ PJ_DEF(pj_status_t) pjsip_endpt_create_response_fwd( pjsip_endpoint *endpt,
         }
 
         /* Clone message body */
-        if (src->body)
+        if (src->body && !dst->body)
             dst->body = pjsip_msg_body_clone(tdata->pool, src->body);
 
 
@@ -171,13 +171,19 @@ static void init_outbound_setting(pjsua_acc *acc)
     pjsua_acc_config *acc_cfg = &acc->cfg;
     if (acc_cfg->rfc5626_instance_id.slen == 0) {
         const pj_str_t *hostname;
-        pj_uint32_t hval;
+        pj_uint32_t hval = 0;
         pj_size_t pos;
+        pj_ssize_t i;
         char instprm[] = ";+sip.instance=\"<urn:uuid:00000000-0000-0000-0000-0000CCDDEEFF>\"";
 
         hostname = pj_gethostname();
         pos = pj_ansi_strlen(instprm) - 10;
-        hval = pj_hash_calc(0, hostname->ptr, (unsigned)hostname->slen);
+        /* The instance ID must stay the same across restarts, so don't use
+         * pj_hash_calc() which is keyed per process. This is the hash it
+         * used to calculate.
+         */
+        for (i = 0; i < hostname->slen; ++i)
+            hval = hval * 33 + (pj_uint8_t)hostname->ptr[i];
         pj_val_to_hex_digit(((char*)&hval)[0], instprm + pos + 0);
         pj_val_to_hex_digit(((char*)&hval)[1], instprm + pos + 2);
         pj_val_to_hex_digit(((char*)&hval)[2], instprm + pos + 4);
@@ -1587,8 +1593,8 @@ PJ_DEF(pj_status_t) pjsua_acc_send_request(pjsua_acc_id acc_id,
 
     cap_hdr = pjsip_endpt_get_capability(pjsua_var.endpt, PJSIP_H_ACCEPT, NULL);
     if (cap_hdr) {
-        pjsip_msg_add_hdr(tdata->msg,
-                          (pjsip_hdr*) pjsip_hdr_clone(tdata->pool, cap_hdr));
+        pjsip_msg_add_hdr(tdata->msg, (pjsip_hdr*)
+                          pjsip_hdr_shallow_clone(tdata->pool, cap_hdr));
     }
 
     status = pjsip_endpt_send_request(pjsua_var.endpt, tdata, -1, request_data, &on_send_request);
@@ -2862,14 +2868,9 @@ static pj_status_t pjsua_regc_init(int acc_id)
     /* Add other request headers. */
     if (pjsua_var.ua_cfg.user_agent.slen) {
         pjsip_hdr hdr_list;
-        const pj_str_t STR_USER_AGENT = { "User-Agent", 10 };
-        pjsip_generic_string_hdr *h;
 
         pj_list_init(&hdr_list);
-
-        h = pjsip_generic_string_hdr_create(pool, &STR_USER_AGENT, 
-                                            &pjsua_var.ua_cfg.user_agent);
-        pj_list_push_back(&hdr_list, (pjsip_hdr*)h);
+        pj_list_push_back(&hdr_list, pjsua_create_ua_hdr(pool));
 
         status = pjsip_regc_add_headers(acc->regc, &hdr_list);
         if (status != PJ_SUCCESS) {
@@ -24,6 +24,9 @@
 
 #define DEFAULT_RTP_PORT        4000
 
+/* Index of the first worker thread that polls an ioqueue shard */
+#define SHARD_FIRST_THREAD      (PJSUA_SEPARATE_WORKER_FOR_TIMER? 2 : 1)
+
 
 /* Internal prototypes */
 static void resolve_stun_entry(pjsua_stun_resolve *sess);
@@ -114,6 +117,8 @@ PJ_DEF(void) pjsua_config_default(pjsua_config *cfg)
 
     cfg->max_calls = PJSUA_MAX_CALLS;
     cfg->thread_cnt = PJSUA_SEPARATE_WORKER_FOR_TIMER? 2 : 1;
+    cfg->shard_ioqueue = PJSUA_DEFAULT_SHARD_IOQUEUE;
+    cfg->dispatch_thread_cnt = PJSUA_DEFAULT_DISPATCH_THREAD_CNT;
     cfg->nat_type_in_sdp = 1;
     cfg->stun_ignore_failure = PJ_TRUE;
     cfg->force_lr = PJ_TRUE;
@@ -578,22 +583,22 @@ static pj_bool_t options_on_rx_request(pjsip_rx_data *rdata)
     /* Add Allow header */
     cap_hdr = pjsip_endpt_get_capability(pjsua_var.endpt, PJSIP_H_ALLOW, NULL);
     if (cap_hdr) {
-        pjsip_msg_add_hdr(tdata->msg, 
-                          (pjsip_hdr*) pjsip_hdr_clone(tdata->pool, cap_hdr));
+        pjsip_msg_add_hdr(tdata->msg, (pjsip_hdr*)
+                          pjsip_hdr_shallow_clone(tdata->pool, cap_hdr));
     }
 
     /* Add Accept header */
     cap_hdr = pjsip_endpt_get_capability(pjsua_var.endpt, PJSIP_H_ACCEPT, NULL);
     if (cap_hdr) {
-        pjsip_msg_add_hdr(tdata->msg, 
-                          (pjsip_hdr*) pjsip_hdr_clone(tdata->pool, cap_hdr));
+        pjsip_msg_add_hdr(tdata->msg, (pjsip_hdr*)
+                          pjsip_hdr_shallow_clone(tdata->pool, cap_hdr));
     }
 
     /* Add Supported header */
     cap_hdr = pjsip_endpt_get_capability(pjsua_var.endpt, PJSIP_H_SUPPORTED, NULL);
     if (cap_hdr) {
-        pjsip_msg_add_hdr(tdata->msg, 
-                          (pjsip_hdr*) pjsip_hdr_clone(tdata->pool, cap_hdr));
+        pjsip_msg_add_hdr(tdata->msg, (pjsip_hdr*)
+                          pjsip_hdr_shallow_clone(tdata->pool, cap_hdr));
     }
 
     /* Add Allow-Events header from the evsub module */
@@ -605,13 +610,7 @@ static pj_bool_t options_on_rx_request(pjsip_rx_data *rdata)
 
     /* Add User-Agent header */
     if (pjsua_var.ua_cfg.user_agent.slen) {
-        const pj_str_t USER_AGENT = { "User-Agent", 10};
-        pjsip_hdr *h;
-
-        h = (pjsip_hdr*) pjsip_generic_string_hdr_create(tdata->pool,
-                                                         &USER_AGENT,
-                                                         &pjsua_var.ua_cfg.user_agent);
-        pjsip_msg_add_hdr(tdata->msg, h);
+        pjsip_msg_add_hdr(tdata->msg, pjsua_create_ua_hdr(tdata->pool));
     }
 
     /* Get media socket info, make sure transport is ready */
@@ -894,6 +893,31 @@ static int worker_thread_ioqueue(void *arg)
 
 #endif
 
+/* Ioqueue shard worker thread function. */
+static int worker_thread_shard(void *arg)
+{
+    enum { TIMEOUT = 10 };
+    pj_ioqueue_t *ioq;
+#if !PJSUA_SEPARATE_WORKER_FOR_TIMER
+    pj_timer_heap_t *th = pjsip_endpt_get_timer_heap(pjsua_var.endpt);
+#endif
+
+    ioq = pj_ioqueue_group_get(pjsua_var.ioq_grp,
+                               (unsigned)(pj_ssize_t)arg);
+    while (!pjsua_var.thread_quit_flag) {
+        pj_time_val timeout = {0, TIMEOUT};
+
+        if (pj_ioqueue_poll(ioq, &timeout) < 0)
+            pj_thread_sleep(TIMEOUT);
+
+#if !PJSUA_SEPARATE_WORKER_FOR_TIMER
+        /* Share the timer load with the other worker threads */
+        pj_timer_heap_poll(th, NULL);
+#endif
+    }
+    return 0;
+}
+
 PJ_DEF(void) pjsua_stop_worker_threads(void)
 {
     unsigned i;
@@ -1243,6 +1267,19 @@ PJ_DEF(pj_status_t) pjsua_init( const pjsua_config *ua_cfg,
     if (status != PJ_SUCCESS)
         goto on_error;
 
+    /* Pre-render User-Agent header, which is added to most requests */
+    if (pjsua_var.ua_cfg.user_agent.slen) {
+        const pj_str_t STR_USER_AGENT = { "User-Agent", 10 };
+        pjsip_generic_string_hdr *h;
+
+        h = pjsip_generic_string_hdr_create(pjsua_var.pool, &STR_USER_AGENT,
+                                            &pjsua_var.ua_cfg.user_agent);
+        status = pjsip_hdr_tpl_create(pjsua_var.pool, h,
+                                      &pjsua_var.ua_hdr_tpl);
+        if (status != PJ_SUCCESS)
+            goto on_error;
+    }
+
     /* Convert deprecated STUN settings */
     if (pjsua_var.ua_cfg.stun_srv_cnt==0) {
         if (pjsua_var.ua_cfg.stun_domain.slen) {
@@ -1336,19 +1373,46 @@ PJ_DEF(pj_status_t) pjsua_init( const pjsua_config *ua_cfg,
     if (pjsua_var.ua_cfg.thread_cnt) {
         unsigned ii;
 
-        if (pjsua_var.ua_cfg.thread_cnt > PJ_ARRAY_SIZE(pjsua_var.thread))
+        if (pjsua_var.ua_cfg.thread_cnt > PJ_ARRAY_SIZE(pjsua_var.thread)) {
+            PJ_LOG(3,(THIS_FILE, "Worker thread count capped to %d "
+                      "(PJSUA_MAX_WORKER_THREADS)",
+                      (int)PJ_ARRAY_SIZE(pjsua_var.thread)));
             pjsua_var.ua_cfg.thread_cnt = PJ_ARRAY_SIZE(pjsua_var.thread);
+        }
 
 #if PJSUA_SEPARATE_WORKER_FOR_TIMER
         if (pjsua_var.ua_cfg.thread_cnt < 2)
             pjsua_var.ua_cfg.thread_cnt = 2;
 #endif
 
+        /* Create ioqueue shards for the rest of the threads, after the
+         * thread(s) that poll the endpoint's ioqueue and timer heap.
+         */
+        if (pjsua_var.ua_cfg.shard_ioqueue &&
+            pjsua_var.ua_cfg.thread_cnt > SHARD_FIRST_THREAD)
+        {
+            status = pj_ioqueue_group_create(
+                            pjsua_var.pool,
+                            pjsua_var.ua_cfg.thread_cnt - SHARD_FIRST_THREAD,
+                            PJSIP_MAX_TRANSPORTS, NULL, &pjsua_var.ioq_grp);
+            if (status != PJ_SUCCESS)
+                goto on_error;
+
+            pjsip_endpt_set_ioqueue_group(pjsua_var.endpt, pjsua_var.ioq_grp);
+        }
+
         for (ii=0; ii<pjsua_var.ua_cfg.thread_cnt; ++ii) {
             char tname[16];
             
             pj_ansi_snprintf(tname, sizeof(tname), "pjsua_%d", ii);
 
+            if (pjsua_var.ioq_grp && ii >= SHARD_FIRST_THREAD) {
+                status = pj_thread_create(pjsua_var.pool, tname,
+                                          &worker_thread_shard,
+                                          (void*)(pj_ssize_t)
+                                          (ii - SHARD_FIRST_THREAD),
+                                          0, 0, &pjsua_var.thread[ii]);
+            } else
 #if PJSUA_SEPARATE_WORKER_FOR_TIMER
             if (ii == 0) {
                 status = pj_thread_create(pjsua_var.pool, tname,
@@ -1372,6 +1436,18 @@ PJ_DEF(pj_status_t) pjsua_init( const pjsua_config *ua_cfg,
         PJ_LOG(4,(THIS_FILE, "No SIP worker threads created"));
     }
 
+    /* Start the dispatch stage for incoming messages */
+    if (pjsua_var.ua_cfg.dispatch_thread_cnt) {
+        pjsip_dispatch_param disp_prm;
+
+        pjsip_dispatch_param_default(&disp_prm);
+        disp_prm.thread_cnt = pjsua_var.ua_cfg.dispatch_thread_cnt;
+
+        status = pjsip_endpt_start_dispatch(pjsua_var.endpt, &disp_prm);
+        if (status != PJ_SUCCESS)
+            goto on_error;
+    }
+
     /* Done! */
 
     PJ_LOG(3,(THIS_FILE, "pjsua version %s for %s initialized", 
@@ -2137,6 +2213,12 @@ PJ_DEF(pj_status_t) pjsua_destroy2(unsigned flags)
         pjsip_endpt_destroy(pjsua_var.endpt);
         pjsua_var.endpt = NULL;
 
+        /* Transports are gone, the ioqueue shards can be destroyed now */
+        if (pjsua_var.ioq_grp) {
+            pj_ioqueue_group_destroy(pjsua_var.ioq_grp);
+            pjsua_var.ioq_grp = NULL;
+        }
+
         /* Destroy pool in the buddy object */
         for (i=0; i<(int)PJ_ARRAY_SIZE(pjsua_var.buddy); ++i) {
             if (pjsua_var.buddy[i].pool) {
@@ -2178,6 +2260,7 @@ PJ_DEF(pj_status_t) pjsua_destroy2(unsigned flags)
         pjsua_var.timer_pool = NULL;
     }
     if (pjsua_var.pool) {
+        pjsua_var.ua_hdr_tpl = NULL;
         pj_pool_release(pjsua_var.pool);
         pjsua_var.pool = NULL;
         pj_caching_pool_destroy(&pjsua_var.cp);
@@ -2633,7 +2716,9 @@ PJ_DEF(pj_status_t) pjsua_transport_create( pjsip_transport_type_e type,
         addr_name.host = pj_str(hostbuf);
         addr_name.port = pj_sockaddr_get_port(&pub_addr);
 
-        /* Create UDP transport */
+        /* Create UDP transport. Being a single socket, it stays on the
+         * endpoint's ioqueue even with pjsua_config.shard_ioqueue.
+         */
         status = pjsip_udp_transport_attach2(pjsua_var.endpt, type, sock,
                                              &addr_name, 1, &tp);
         if (status != PJ_SUCCESS) {
@@ -3137,6 +3222,17 @@ PJ_DEF(pj_status_t) pjsua_transport_lis_start(pjsua_transport_id id,
 }
 
 
+/*
+ * Create User-Agent header.
+ */
+pjsip_hdr* pjsua_create_ua_hdr(pj_pool_t *pool)
+{
+    if (!pjsua_var.ua_hdr_tpl)
+        return NULL;
+
+    return (pjsip_hdr*) pjsip_hdr_tpl_instance(pool, pjsua_var.ua_hdr_tpl);
+}
+
 /*
  * Add additional headers etc in msg_data specified by application
  * when sending requests.
@@ -3151,12 +3247,7 @@ void pjsua_process_msg_data(pjsip_tx_data *tdata,
     if (pjsua_var.ua_cfg.user_agent.slen && 
         tdata->msg->type == PJSIP_REQUEST_MSG) 
     {
-        const pj_str_t STR_USER_AGENT = { "User-Agent", 10 };
-        pjsip_hdr *h;
-        h = (pjsip_hdr*)pjsip_generic_string_hdr_create(tdata->pool, 
-                                                        &STR_USER_AGENT, 
-                                                        &pjsua_var.ua_cfg.user_agent);
-        pjsip_msg_add_hdr(tdata->msg, h);
+        pjsip_msg_add_hdr(tdata->msg, pjsua_create_ua_hdr(tdata->pool));
     }
 
     if (!msg_data)
@@ -314,6 +314,8 @@ void UaConfig::fromPj(const pjsua_config &ua_cfg)
 
     this->maxCalls = ua_cfg.max_calls;
     this->threadCnt = ua_cfg.thread_cnt;
+    this->shardIoqueue = PJ2BOOL(ua_cfg.shard_ioqueue);
+    this->dispatchThreadCnt = ua_cfg.dispatch_thread_cnt;
     this->userAgent = pj2Str(ua_cfg.user_agent);
 
     for (i=0; i<ua_cfg.nameserver_count; ++i) {
@@ -344,6 +346,8 @@ pjsua_config UaConfig::toPj() const
 
     pua_cfg.max_calls = this->maxCalls;
     pua_cfg.thread_cnt = this->threadCnt;
+    pua_cfg.shard_ioqueue = this->shardIoqueue;
+    pua_cfg.dispatch_thread_cnt = this->dispatchThreadCnt;
     pua_cfg.user_agent = str2Pj(this->userAgent);
 
     for (i=0; i<this->nameserver.size() && i<PJ_ARRAY_SIZE(pua_cfg.nameserver);
@@ -393,6 +397,8 @@ void UaConfig::readObject(const ContainerNode &node) PJSUA2_THROW(Error)
     NODE_READ_BOOL    ( this_node, mwiUnsolicitedEnabled);
     NODE_READ_BOOL    ( this_node, enableUpnp);
     NODE_READ_STRING  ( this_node, upnpIfName);
+    NODE_READ_BOOL    ( this_node, shardIoqueue);
+    NODE_READ_UNSIGNED( this_node, dispatchThreadCnt);
 }
 
 void UaConfig::writeObject(ContainerNode &node) const PJSUA2_THROW(Error)
@@ -411,6 +417,8 @@ void UaConfig::writeObject(ContainerNode &node) const PJSUA2_THROW(Error)
     NODE_WRITE_BOOL    ( this_node, mwiUnsolicitedEnabled);
     NODE_WRITE_BOOL    ( this_node, enableUpnp);
     NODE_WRITE_STRING  ( this_node, upnpIfName);
+    NODE_WRITE_BOOL    ( this_node, shardIoqueue);
+    NODE_WRITE_UNSIGNED( this_node, dispatchThreadCnt);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
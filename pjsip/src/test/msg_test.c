@@ -848,8 +848,639 @@ static pj_status_t simple_test(void)
     return PJ_SUCCESS;
 }
 
+/*****************************************************************************/
+/* Lazy header parsing */
+
+static pjsip_msg *parse_rdata(pj_pool_t *pool, struct test_msg *entry,
+                              pj_bool_t lazy, pjsip_rx_data *rdata)
+{
+    pj_bool_t saved_lazy = pjsip_cfg()->endpt.lazy_parse_hdr;
+    pjsip_msg *msg;
+
+    if (entry->len==0)
+        entry->len = pj_ansi_strlen(entry->msg);
+
+    pj_bzero(rdata, sizeof(*rdata));
+    rdata->tp_info.pool = pool;
+    pj_list_init(&rdata->msg_info.parse_err);
+
+    pjsip_cfg()->endpt.lazy_parse_hdr = lazy;
+    msg = pjsip_parse_rdata(entry->msg, entry->len, rdata);
+    pjsip_cfg()->endpt.lazy_parse_hdr = saved_lazy;
+
+    return msg;
+}
+
+static unsigned count_hdr(const pjsip_msg *msg, pjsip_hdr_e type)
+{
+    const pjsip_hdr *h;
+    unsigned cnt = 0;
+
+    for (h = msg->hdr.next; h != &msg->hdr; h = h->next) {
+        if (h->type == type)
+            ++cnt;
+    }
+    return cnt;
+}
+
+/* Compare the headers of two messages by printing them. */
+static int cmp_hdr_list(const pjsip_msg *msg1, const pjsip_msg *msg2)
+{
+    char buf1[512], buf2[512];
+    const pjsip_hdr *h1 = msg1->hdr.next, *h2 = msg2->hdr.next;
+
+    while (h1 != &msg1->hdr && h2 != &msg2->hdr) {
+        int len1, len2;
+
+        PJ_TEST_EQ(h1->type, h2->type, NULL, return -200);
+
+        len1 = pjsip_hdr_print_on((void*)h1, buf1, sizeof(buf1));
+        len2 = pjsip_hdr_print_on((void*)h2, buf2, sizeof(buf2));
+        PJ_TEST_GT(len1, 0, NULL, return -210);
+        PJ_TEST_EQ(len1, len2, NULL, return -220);
+        PJ_TEST_EQ(pj_memcmp(buf1, buf2, len1), 0, NULL, return -230);
+
+        h1 = h1->next;
+        h2 = h2->next;
+    }
+
+    PJ_TEST_EQ(h1, &msg1->hdr, NULL, return -240);
+    PJ_TEST_EQ(h2, &msg2->hdr, NULL, return -250);
+    return 0;
+}
+
+static int lazy_test_entry(pj_pool_t *pool, struct test_msg *entry)
+{
+    pjsip_rx_data eager_rdata, lazy_rdata;
+    pjsip_msg *eager, *lazy, *clone;
+    pjsip_hdr *h;
+    unsigned type;
+
+    eager = parse_rdata(pool, entry, PJ_FALSE, &eager_rdata);
+    lazy = parse_rdata(pool, entry, PJ_TRUE, &lazy_rdata);
+    PJ_TEST_NOT_NULL(eager, NULL, return -300);
+    PJ_TEST_NOT_NULL(lazy, NULL, return -310);
+
+    /* Headers needed by the transaction layer are always parsed */
+    PJ_TEST_EQ(!lazy_rdata.msg_info.via, !eager_rdata.msg_info.via,
+               NULL, return -320);
+    PJ_TEST_EQ(!lazy_rdata.msg_info.cid, !eager_rdata.msg_info.cid,
+               NULL, return -321);
+    PJ_TEST_EQ(!lazy_rdata.msg_info.cseq, !eager_rdata.msg_info.cseq,
+               NULL, return -322);
+    PJ_TEST_EQ(!lazy_rdata.msg_info.from, !eager_rdata.msg_info.from,
+               NULL, return -323);
+    PJ_TEST_EQ(!lazy_rdata.msg_info.to, !eager_rdata.msg_info.to,
+               NULL, return -324);
+    PJ_TEST_EQ(!lazy_rdata.msg_info.ctype, !eager_rdata.msg_info.ctype,
+               NULL, return -325);
+    PJ_TEST_EQ(!lazy->body, !eager->body, NULL, return -326);
+
+    /* Contact is too, since the stack walks the list looking for it */
+    PJ_TEST_EQ(count_hdr(lazy, PJSIP_H_CONTACT),
+               count_hdr(eager, PJSIP_H_CONTACT), NULL, return -327);
+
+    /* Allow is not, until it's looked up (also in a clone) */
+    if (count_hdr(eager, PJSIP_H_ALLOW)) {
+        PJ_TEST_EQ(count_hdr(lazy, PJSIP_H_ALLOW), 0, NULL, return -330);
+
+        clone = pjsip_msg_clone(pool, lazy);
+        h = (pjsip_hdr*)pjsip_msg_find_hdr(clone, PJSIP_H_ALLOW, NULL);
+        PJ_TEST_NOT_NULL(h, NULL, return -331);
+        PJ_TEST_EQ(h->type, PJSIP_H_ALLOW, NULL, return -332);
+        PJ_TEST_EQ(count_hdr(lazy, PJSIP_H_ALLOW), 0, NULL, return -333);
+    }
+
+    /* Look up every header type, which parses all the lazy headers */
+    for (type = 0; type < PJSIP_H_OTHER; ++type) {
+        h = NULL;
+        do {
+            h = (pjsip_hdr*)pjsip_msg_find_hdr(lazy, (pjsip_hdr_e)type,
+                                               h ? h->next : NULL);
+        } while (h);
+    }
+
+    /* Now the message must look the same as the eagerly parsed one */
+    return cmp_hdr_list(lazy, eager);
+}
+
+static int lazy_parse_test(void)
+{
+    static char msg[] =
+        "NOTIFY sip:user@example.com SIP/2.0\r\n"
+        "Via: SIP/2.0/UDP host.example.com;branch=z9hG4bK1234\r\n"
+        "m: <sip:c1@example.com>;expires=30, <sip:c2@example.com>\r\n"
+        "To: <sip:user@example.com>\r\n"
+        "f: <sip:peer@example.com>;tag=abc\r\n"
+        "Call-ID: lazy@example.com\r\n"
+        "CSeq: 1 NOTIFY\r\n"
+        "Expires: 60\r\n"
+        "Allow: NOTIFY, BYE\r\n"
+        "Proxy-Authenticate: Digest realm=\"example.com\", nonce=\"abc\"\r\n"
+        "Retry-After: bad value\r\n"
+        "Content-Length: 0\r\n"
+        "\r\n";
+    const pj_str_t STR_CONTACT = { "Contact", 7 };
+    const pj_str_t STR_RETRY_AFTER = { "Retry-After", 11 };
+    struct test_msg entry;
+    pjsip_rx_data rdata;
+    pj_pool_t *pool;
+    pjsip_msg *lazy;
+    pjsip_hdr *h;
+    unsigned i;
+    int rc = 0;
+
+    PJ_LOG(3,(THIS_FILE, "  lazy header parsing test.."));
+
+    pool = pjsip_endpt_create_pool(endpt, NULL, POOL_SIZE, POOL_SIZE);
+
+    for (i=0; i<PJ_ARRAY_SIZE(test_array); ++i) {
+        if (test_array[i].expected_status != 0)
+            continue;
+        rc = lazy_test_entry(pool, &test_array[i]);
+        if (rc != 0) {
+            PJ_LOG(3,(THIS_FILE, "   error: test_array[%d] failed", i));
+            goto on_return;
+        }
+        pj_pool_reset(pool);
+    }
+
+    /* Compact names, by-name lookup and header with invalid value */
+    pj_bzero(&entry, sizeof(entry));
+    pj_ansi_strxcpy(entry.msg, msg, sizeof(entry.msg));
+    lazy = parse_rdata(pool, &entry, PJ_TRUE, &rdata);
+    PJ_TEST_NOT_NULL(lazy, NULL, {rc=-400; goto on_return;});
+    PJ_TEST_NOT_NULL(rdata.msg_info.from, NULL, {rc=-401; goto on_return;});
+
+    /* Headers which are looked for by walking the list are parsed */
+    PJ_TEST_EQ(count_hdr(lazy, PJSIP_H_CONTACT), 2, NULL,
+               {rc=-402; goto on_return;});
+    PJ_TEST_EQ(count_hdr(lazy, PJSIP_H_EXPIRES), 1, NULL,
+               {rc=-403; goto on_return;});
+    PJ_TEST_EQ(count_hdr(lazy, PJSIP_H_PROXY_AUTHENTICATE), 1, NULL,
+               {rc=-404; goto on_return;});
+    PJ_TEST_EQ(count_hdr(lazy, PJSIP_H_ALLOW), 0, NULL,
+               {rc=-405; goto on_return;});
+
+    h = (pjsip_hdr*)pjsip_msg_find_hdr_by_name(lazy, &STR_CONTACT, NULL);
+    PJ_TEST_NOT_NULL(h, NULL, {rc=-410; goto on_return;});
+    PJ_TEST_EQ(h->type, PJSIP_H_CONTACT, NULL, {rc=-411; goto on_return;});
+    PJ_TEST_EQ(count_hdr(lazy, PJSIP_H_CONTACT), 2, NULL,
+               {rc=-412; goto on_return;});
+
+    h = (pjsip_hdr*)pjsip_msg_find_hdr(lazy, PJSIP_H_EXPIRES, NULL);
+    PJ_TEST_NOT_NULL(h, NULL, {rc=-420; goto on_return;});
+    PJ_TEST_EQ(((pjsip_expires_hdr*)h)->ivalue, 60, NULL,
+               {rc=-421; goto on_return;});
+
+    /* Invalid header stays as generic string header */
+    h = (pjsip_hdr*)pjsip_msg_find_hdr(lazy, PJSIP_H_RETRY_AFTER, NULL);
+    PJ_TEST_EQ(h, NULL, NULL, {rc=-430; goto on_return;});
+    h = (pjsip_hdr*)pjsip_msg_find_hdr_by_name(lazy, &STR_RETRY_AFTER, NULL);
+    PJ_TEST_NOT_NULL(h, NULL, {rc=-431; goto on_return;});
+    PJ_TEST_EQ(h->type, PJSIP_H_OTHER, NULL, {rc=-432; goto on_return;});
+
+on_return:
+    pjsip_endpt_release_pool(endpt, pool);
+    return rc;
+}
+
+
+/*****************************************************************************/
+/* Forwarding with PJSIP_FWD_RAW_HDR */
+
+static pjsip_tx_data *create_fwd(pjsip_rx_data *rdata, unsigned options)
+{
+    static const pj_str_t branch = { "z9hG4bKfwdtest", 14 };
+    pjsip_tx_data *tdata = NULL;
+
+    if (rdata->msg_info.msg->type == PJSIP_REQUEST_MSG) {
+        pjsip_endpt_create_request_fwd(endpt, rdata, NULL, &branch, options,
+                                       &tdata);
+    } else {
+        pjsip_endpt_create_response_fwd(endpt, rdata, options, &tdata);
+    }
+    return tdata;
+}
+
+/* Compare the headers of two messages, where only the order of headers
+ * of the same type matters.
+ */
+static int cmp_hdr_by_type(pj_pool_t *pool, const pjsip_msg *msg1,
+                           const pjsip_msg *msg2)
+{
+    const pjsip_msg *src[2] = { msg1, msg2 };
+    pjsip_msg *dst[2];
+    unsigned type, i;
+    int rc;
+
+    dst[0] = pjsip_msg_create(pool, msg1->type);
+    dst[1] = pjsip_msg_create(pool, msg2->type);
+
+    for (type = 0; type <= PJSIP_H_OTHER; ++type) {
+        for (i = 0; i < 2; ++i) {
+            const pjsip_hdr *h;
+
+            pj_list_init(&dst[i]->hdr);
+            for (h = src[i]->hdr.next; h != &src[i]->hdr; h = h->next) {
+                if (h->type == type) {
+                    pjsip_msg_add_hdr(dst[i], (pjsip_hdr*)
+                                      pjsip_hdr_shallow_clone(pool, h));
+                }
+            }
+        }
+
+        rc = cmp_hdr_list(dst[0], dst[1]);
+        if (rc != 0)
+            return rc;
+    }
+
+    return 0;
+}
+
+/* Forward the message both ways and check that they end up the same. */
+static int fwd_test_entry(pj_pool_t *pool, struct test_msg *entry)
+{
+    pjsip_rx_data rdata;
+    pjsip_tx_data *deep = NULL, *raw = NULL;
+    pjsip_max_fwd_hdr *max_fwd;
+    pjsip_msg *msg, *msg2;
+    char buf[PJSIP_MAX_PKT_LEN], buf2[PJSIP_MAX_PKT_LEN];
+    pj_ssize_t len;
+    unsigned type;
+    int rc = 0;
+
+    msg = parse_rdata(pool, entry, PJ_FALSE, &rdata);
+    PJ_TEST_NOT_NULL(msg, NULL, return -500);
+    rdata.msg_info.msg_buf = entry->msg;
+    rdata.msg_info.len = (int)entry->len;
+
+    deep = create_fwd(&rdata, 0);
+    raw = create_fwd(&rdata, PJSIP_FWD_RAW_HDR);
+    PJ_TEST_NOT_NULL(deep, NULL, {rc=-510; goto on_return;});
+    PJ_TEST_NOT_NULL(raw, NULL, {rc=-511; goto on_return;});
+
+    /* Max-Forwards is decremented without being looked up */
+    if (msg->type == PJSIP_REQUEST_MSG && rdata.msg_info.max_fwd) {
+        max_fwd = (pjsip_max_fwd_hdr*)
+                  pjsip_msg_find_hdr(raw->msg, PJSIP_H_MAX_FORWARDS, NULL);
+        PJ_TEST_NOT_NULL(max_fwd, NULL, {rc=-520; goto on_return;});
+        PJ_TEST_EQ(max_fwd->ivalue, rdata.msg_info.max_fwd->ivalue - 1,
+                   NULL, {rc=-521; goto on_return;});
+    }
+
+    if (deep->msg->body) {
+        PJ_TEST_NOT_NULL(raw->msg->body, NULL, {rc=-540; goto on_return;});
+        PJ_TEST_EQ(raw->msg->body->len, deep->msg->body->len, NULL,
+                   {rc=-541; goto on_return;});
+        PJ_TEST_EQ(pj_memcmp(raw->msg->body->data, deep->msg->body->data,
+                             deep->msg->body->len), 0, NULL,
+                   {rc=-542; goto on_return;});
+    }
+
+    /* Look up every header type, then both must print the same headers,
+     * except for the line folding which is kept as received, and the
+     * position of the headers that were cloned.
+     */
+    for (type = 0; type < PJSIP_H_OTHER; ++type) {
+        pjsip_hdr *h = NULL;
+        do {
+            h = (pjsip_hdr*)pjsip_msg_find_hdr(raw->msg, (pjsip_hdr_e)type,
+                                               h ? h->next : NULL);
+        } while (h);
+    }
+
+    len = pjsip_msg_print(raw->msg, buf, sizeof(buf)-1);
+    PJ_TEST_GT(len, 0, NULL, {rc=-530; goto on_return;});
+    msg = pjsip_parse_msg(pool, buf, len, NULL);
+    PJ_TEST_NOT_NULL(msg, NULL, {rc=-531; goto on_return;});
+
+    len = pjsip_msg_print(deep->msg, buf2, sizeof(buf2)-1);
+    PJ_TEST_GT(len, 0, NULL, {rc=-532; goto on_return;});
+    msg2 = pjsip_parse_msg(pool, buf2, len, NULL);
+    PJ_TEST_NOT_NULL(msg2, NULL, {rc=-533; goto on_return;});
+
+    rc = cmp_hdr_by_type(pool, msg, msg2);
+
+on_return:
+    if (deep)
+        pjsip_tx_data_dec_ref(deep);
+    if (raw)
+        pjsip_tx_data_dec_ref(raw);
+    return rc;
+}
+
+/* The received and rport that the transport sets on the top Via of a
+ * request must be kept when forwarding.
+ */
+static int fwd_via_test(pj_pool_t *pool)
+{
+    static char request[] =
+        "INVITE sip:user@example.com SIP/2.0\r\n"
+        "Via: SIP/2.0/UDP ua.example.com;branch=z9hG4bKua;rport\r\n"
+        "Via: SIP/2.0/TCP first.example.com;branch=z9hG4bKf\r\n"
+        "Max-Forwards: 70\r\n"
+        "To: <sip:user@example.com>\r\n"
+        "From: <sip:peer@example.com>;tag=abc\r\n"
+        "Call-ID: fwdvia@example.com\r\n"
+        "CSeq: 1 INVITE\r\n"
+        "Content-Length: 0\r\n"
+        "\r\n";
+    static const pj_str_t recvd = { "192.0.2.99", 10 };
+    struct test_msg entry;
+    pjsip_rx_data rdata;
+    pjsip_tx_data *raw = NULL;
+    pjsip_via_hdr *via;
+    pjsip_msg *msg;
+    char buf[PJSIP_MAX_PKT_LEN];
+    pj_ssize_t len;
+    int rc = 0;
+
+    pj_bzero(&entry, sizeof(entry));
+    pj_ansi_strxcpy(entry.msg, request, sizeof(entry.msg));
+    msg = parse_rdata(pool, &entry, PJ_FALSE, &rdata);
+    PJ_TEST_NOT_NULL(msg, NULL, return -550);
+    rdata.msg_info.msg_buf = entry.msg;
+    rdata.msg_info.len = (int)entry.len;
+
+    /* What the transport does on receipt */
+    rdata.msg_info.via->recvd_param = recvd;
+    rdata.msg_info.via->rport_param = 5070;
+
+    raw = create_fwd(&rdata, PJSIP_FWD_RAW_HDR);
+    PJ_TEST_NOT_NULL(raw, NULL, return -551);
+
+    PJ_TEST_EQ(count_hdr(raw->msg, PJSIP_H_VIA), 3, NULL,
+               {rc=-552; goto on_return;});
+
+    /* Ours on top, then the received one with its parameters */
+    via = (pjsip_via_hdr*) pjsip_msg_find_hdr(raw->msg, PJSIP_H_VIA, NULL);
+    PJ_TEST_EQ(pj_strcmp2(&via->branch_param, "z9hG4bKfwdtest"), 0, NULL,
+               {rc=-553; goto on_return;});
+    via = (pjsip_via_hdr*) pjsip_msg_find_hdr(raw->msg, PJSIP_H_VIA,
+                                              via->next);
+    PJ_TEST_EQ(pj_strcmp2(&via->branch_param, "z9hG4bKua"), 0, NULL,
+               {rc=-554; goto on_return;});
+    PJ_TEST_EQ(pj_strcmp(&via->recvd_param, &recvd), 0, NULL,
+               {rc=-555; goto on_return;});
+    PJ_TEST_EQ(via->rport_param, 5070, NULL, {rc=-556; goto on_return;});
+
+    len = pjsip_msg_print(raw->msg, buf, sizeof(buf)-1);
+    PJ_TEST_GT(len, 0, NULL, {rc=-557; goto on_return;});
+    buf[len] = '\0';
+    PJ_TEST_NOT_NULL(pj_ansi_strstr(buf, "received=192.0.2.99"), NULL,
+                     {rc=-558; goto on_return;});
+    PJ_TEST_NOT_NULL(pj_ansi_strstr(buf, "rport=5070"), NULL,
+                     {rc=-559; goto on_return;});
+
+on_return:
+    pjsip_tx_data_dec_ref(raw);
+    return rc;
+}
+
+static int fwd_raw_test(void)
+{
+    static char response[] =
+        "SIP/2.0 200 OK\r\n"
+        "v: SIP/2.0/UDP proxy.example.com;branch=z9hG4bKp1,\r\n"
+        "   SIP/2.0/TCP ua.example.com;branch=z9hG4bKua\r\n"
+        "Via: SIP/2.0/UDP first.example.com;branch=z9hG4bKf\r\n"
+        "To: <sip:user@example.com>;tag=xyz\r\n"
+        "From: <sip:peer@example.com>;tag=abc\r\n"
+        "Call-ID: fwd@example.com\r\n"
+        "CSeq: 1 INVITE\r\n"
+        "Contact: <sip:user@192.0.2.1>\r\n"
+        "Record-Route: <sip:proxy.example.com;lr>\r\n"
+        "Content-Type: text/plain\r\n"
+        "Content-Length: 5\r\n"
+        "\r\n"
+        "Hello";
+    struct test_msg entry;
+    pj_pool_t *pool;
+    unsigned i;
+    int rc = 0;
+
+    PJ_LOG(3,(THIS_FILE, "  raw header forwarding test.."));
+
+    pool = pjsip_endpt_create_pool(endpt, NULL, POOL_SIZE, POOL_SIZE);
+
+    for (i=0; i<PJ_ARRAY_SIZE(test_array); ++i) {
+        if (test_array[i].expected_status != 0)
+            continue;
+        rc = fwd_test_entry(pool, &test_array[i]);
+        if (rc != 0) {
+            PJ_LOG(3,(THIS_FILE, "   error: test_array[%d] failed", i));
+            goto on_return;
+        }
+        pj_pool_reset(pool);
+    }
+
+    /* Response, with the first Via line carrying two values */
+    pj_bzero(&entry, sizeof(entry));
+    pj_ansi_strxcpy(entry.msg, response, sizeof(entry.msg));
+    rc = fwd_test_entry(pool, &entry);
+    if (rc != 0)
+        goto on_return;
+    pj_pool_reset(pool);
+
+    rc = fwd_via_test(pool);
+
+on_return:
+    pjsip_endpt_release_pool(endpt, pool);
+    return rc;
+}
+
+/* Headers that are typically added to every outgoing request and are
+ * candidates for header templates.
+ */
+static struct
+{
+    const char *hname;
+    const char *hvalue;
+} tpl_hdrs[] =
+{
+    { "Contact", "\"Alice\" <sip:alice@192.0.2.10:5060;transport=udp;ob>"
+                 ";+sip.instance=\"<urn:uuid:00000000-0000-0000-0000-"
+                 "0000da2b8f13>\";expires=600" },
+    { "Allow", "PRACK, INVITE, ACK, BYE, CANCEL, UPDATE, INFO, SUBSCRIBE, "
+               "NOTIFY, REFER, MESSAGE, OPTIONS" },
+    { "Supported", "replaces, 100rel, timer, norefersub, trickle-ice" },
+    { "User-Agent", "PJSUA v2.15 Linux-6.1/x86_64/glibc-2.36" },
+};
+
+static pjsip_hdr *parse_tpl_hdr(pj_pool_t *pool, unsigned i)
+{
+    pj_str_t hname = pj_str((char*)tpl_hdrs[i].hname);
+    char *buf = pj_pool_alloc(pool, 256);
+    pj_size_t len = pj_ansi_strxcpy(buf, tpl_hdrs[i].hvalue, 256);
+
+    return (pjsip_hdr*)pjsip_parse_hdr(pool, &hname, buf, len, NULL);
+}
+
+static int hdr_tpl_test(void)
+{
+    char buf1[512], buf2[512];
+    pj_pool_t *pool;
+    unsigned i;
+    int len1, len2, rc = 0;
+
+    PJ_LOG(3,(THIS_FILE, "  header template test.."));
+
+    pool = pjsip_endpt_create_pool(endpt, NULL, POOL_SIZE, POOL_SIZE);
+
+    for (i=0; i<PJ_ARRAY_SIZE(tpl_hdrs); ++i) {
+        pjsip_msg *msg;
+        pjsip_hdr *hdr, *inst, *h;
+        pjsip_hdr_tpl *tpl;
+
+        hdr = parse_tpl_hdr(pool, i);
+        PJ_TEST_NOT_NULL(hdr, NULL, {rc=-600; goto on_return;});
+        PJ_TEST_SUCCESS(pjsip_hdr_tpl_create(pool, hdr, &tpl), NULL,
+                        {rc=-610; goto on_return;});
+
+        /* Instance prints the same as the header */
+        len1 = pjsip_hdr_print_on(hdr, buf1, sizeof(buf1));
+        inst = (pjsip_hdr*)pjsip_hdr_tpl_instance(pool, tpl);
+        PJ_TEST_NOT_NULL(inst, NULL, {rc=-620; goto on_return;});
+        len2 = pjsip_hdr_print_on(inst, buf2, sizeof(buf2));
+        PJ_TEST_GT(len1, 0, NULL, {rc=-621; goto on_return;});
+        PJ_TEST_EQ(len1, len2, NULL, {rc=-622; goto on_return;});
+        PJ_TEST_EQ(pj_memcmp(buf1, buf2, len1), 0, NULL,
+                   {rc=-623; goto on_return;});
+
+        /* Not enough buffer */
+        PJ_TEST_EQ(pjsip_hdr_print_on(inst, buf2, len1-1), -1, NULL,
+                   {rc=-624; goto on_return;});
+
+        /* Instance can be found in the message like any other header */
+        msg = pjsip_msg_create(pool, PJSIP_REQUEST_MSG);
+        pjsip_msg_add_hdr(msg, inst);
+        h = (pjsip_hdr*)pjsip_msg_find_hdr_by_name(msg, &hdr->name, NULL);
+        PJ_TEST_EQ(h, inst, NULL, {rc=-630; goto on_return;});
+        PJ_TEST_EQ(h->type, hdr->type, NULL, {rc=-631; goto on_return;});
+
+        /* Shallow clone of an instance is still an instance */
+        h = (pjsip_hdr*)pjsip_hdr_shallow_clone(pool, inst);
+        PJ_TEST_EQ(h->vptr, inst->vptr, NULL, {rc=-640; goto on_return;});
+
+        /* Deep clone is a regular header which prints the same */
+        h = (pjsip_hdr*)pjsip_hdr_clone(pool, inst);
+        PJ_TEST_EQ(h->vptr, hdr->vptr, NULL, {rc=-650; goto on_return;});
+        len2 = pjsip_hdr_print_on(h, buf2, sizeof(buf2));
+        PJ_TEST_EQ(len1, len2, NULL, {rc=-651; goto on_return;});
+        PJ_TEST_EQ(pj_memcmp(buf1, buf2, len1), 0, NULL,
+                   {rc=-652; goto on_return;});
+
+        /* Detached instance is printed from its structure */
+        if (hdr->type == PJSIP_H_ALLOW || hdr->type == PJSIP_H_SUPPORTED) {
+            pjsip_generic_array_hdr *arr = (pjsip_generic_array_hdr*)inst;
+
+            pjsip_hdr_tpl_detach(inst);
+            PJ_TEST_EQ(inst->vptr, hdr->vptr, NULL,
+                       {rc=-660; goto on_return;});
+            --arr->count;
+            len2 = pjsip_hdr_print_on(inst, buf2, sizeof(buf2));
+            PJ_TEST_LT(len2, len1, NULL, {rc=-661; goto on_return;});
+
+            /* The template is not affected */
+            inst = (pjsip_hdr*)pjsip_hdr_tpl_instance(pool, tpl);
+            len2 = pjsip_hdr_print_on(inst, buf2, sizeof(buf2));
+            PJ_TEST_EQ(len1, len2, NULL, {rc=-662; goto on_return;});
+        }
+    }
+
+on_return:
+    pjsip_endpt_release_pool(endpt, pool);
+    return rc;
+}
+
 
 #if INCLUDE_BENCHMARKS
+/* Compare printing a request with the typical static headers as regular
+ * headers and as header template instances.
+ */
+static int hdr_tpl_benchmark(unsigned *p_plain, unsigned *p_tpl)
+{
+    static char request[] =
+        "INVITE sip:bob@example.com SIP/2.0\r\n"
+        "Via: SIP/2.0/UDP 192.0.2.10:5060;rport;branch=z9hG4bKPj5f1e2d\r\n"
+        "Max-Forwards: 70\r\n"
+        "From: \"Alice\" <sip:alice@example.com>;tag=9f2e0c1a\r\n"
+        "To: <sip:bob@example.com>\r\n"
+        "Call-ID: 7d1c5b6e-8f3a-4c2b-9a0d-1e2f3a4b5c6d\r\n"
+        "CSeq: 4711 INVITE\r\n"
+        "Content-Length: 0\r\n"
+        "\r\n";
+    enum { PRINT_LOOP = LOOP };
+    pj_pool_t *pool;
+    pjsip_msg *msg[2];
+    pjsip_hdr_tpl *tpl[PJ_ARRAY_SIZE(tpl_hdrs)];
+    pj_timestamp elapsed[2];
+    unsigned i, j, k, rate[2];
+    char *buf;
+    int len[2] = { 0, 0 };
+    int rc = 0;
+
+    pool = pjsip_endpt_create_pool(endpt, NULL, 4*POOL_SIZE, POOL_SIZE);
+    buf = pj_pool_alloc(pool, PJSIP_MAX_PKT_LEN);
+
+    for (k=0; k<2; ++k) {
+        msg[k] = pjsip_parse_msg(pool, request, sizeof(request)-1, NULL);
+        PJ_TEST_NOT_NULL(msg[k], NULL, {rc=-700; goto on_return;});
+    }
+
+    for (i=0; i<PJ_ARRAY_SIZE(tpl_hdrs); ++i) {
+        pjsip_hdr *hdr = parse_tpl_hdr(pool, i);
+
+        PJ_TEST_NOT_NULL(hdr, NULL, {rc=-710; goto on_return;});
+        PJ_TEST_SUCCESS(pjsip_hdr_tpl_create(pool, hdr, &tpl[i]), NULL,
+                        {rc=-711; goto on_return;});
+        pjsip_msg_add_hdr(msg[0], (pjsip_hdr*)pjsip_hdr_clone(pool, hdr));
+        pjsip_msg_add_hdr(msg[1], (pjsip_hdr*)
+                          pjsip_hdr_tpl_instance(pool, tpl[i]));
+    }
+
+    for (k=0; k<2; ++k) {
+        pj_timestamp t1, t2;
+
+        pj_get_timestamp(&t1);
+        for (j=0; j<PRINT_LOOP; ++j) {
+            len[k] = (int)pjsip_msg_print(msg[k], buf, PJSIP_MAX_PKT_LEN);
+        }
+        pj_get_timestamp(&t2);
+        PJ_TEST_GT(len[k], 0, NULL, {rc=-720; goto on_return;});
+
+        pj_sub_timestamp(&t2, &t1);
+        elapsed[k] = t2;
+    }
+
+    /* Both print the same message */
+    PJ_TEST_EQ(len[0], len[1], NULL, {rc=-730; goto on_return;});
+
+    for (k=0; k<2; ++k) {
+        pj_timestamp zero;
+        pj_highprec_t usec;
+
+        zero.u64 = 0;
+        usec = pj_elapsed_usec(&zero, &elapsed[k]);
+        if (usec == 0)
+            usec = 1;
+        rate[k] = (unsigned)((pj_highprec_t)PRINT_LOOP * 1000000 / usec);
+    }
+
+    PJ_LOG(3,(THIS_FILE, "    %d bytes request printed %u/sec with regular "
+              "headers, %u/sec with header templates (%d%% faster)",
+              len[0], rate[0], rate[1],
+              rate[0] ? (int)((pj_int64_t)rate[1]*100/rate[0]) - 100 : 0));
+
+    *p_plain = rate[0];
+    *p_tpl = rate[1];
+
+on_return:
+    pjsip_endpt_release_pool(endpt, pool);
+    return rc;
+}
+
 static int msg_benchmark(unsigned *p_detect, unsigned *p_parse, 
                          unsigned *p_print)
 {
@@ -2012,6 +2643,18 @@ int msg_test(void)
     if (status != PJ_SUCCESS)
         return status;
 
+    status = lazy_parse_test();
+    if (status != PJ_SUCCESS)
+        return status;
+
+    status = fwd_raw_test();
+    if (status != PJ_SUCCESS)
+        return status;
+
+    status = hdr_tpl_test();
+    if (status != PJ_SUCCESS)
+        return status;
+
 #if INCLUDE_BENCHMARKS
     for (i=0; i<COUNT; ++i) {
         PJ_LOG(3,(THIS_FILE, "  benchmarking (%d of %d)..", i+1, COUNT));
@@ -2083,6 +2726,26 @@ int msg_test(void)
                 "SIP messages printed per second). "
                 "The value is derived from msg-print-per-sec above.");
 
+    /* Printing with header templates */
+    PJ_LOG(3,(THIS_FILE, "  benchmarking header templates.."));
+    {
+        unsigned plain, tpl;
+
+        status = hdr_tpl_benchmark(&plain, &tpl);
+        if (status != PJ_SUCCESS)
+            return status;
+
+        report_ival("msg-print-plain-hdr-per-sec", plain, "msg/sec",
+                    "Number of INVITE requests with Contact, Allow, "
+                    "Supported, and User-Agent headers that can be printed "
+                    "by <tt>pjsip_msg_print()</tt> per second");
+        report_ival("msg-print-hdr-tpl-per-sec", tpl, "msg/sec",
+                    "Same as msg-print-plain-hdr-per-sec, with the Contact, "
+                    "Allow, Supported, and User-Agent headers added as "
+                    "instances of pre-rendered header templates "
+                    "(see <tt>pjsip_hdr_tpl_create()</tt>)");
+    }
+
 #endif  /* INCLUDE_BENCHMARKS */
 
     return PJ_SUCCESS;
@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2025 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+#include <pjsip.h>
+#include <pjlib.h>
+
+#define THIS_FILE   "overload_test.c"
+
+#define MAX_RATE        20
+#define RETRY_AFTER     7
+
+static pj_bool_t ovl_on_rx_request(pjsip_rx_data *rdata);
+static pj_bool_t ovl_on_rx_response(pjsip_rx_data *rdata);
+
+/* Answers the test requests with 200 and counts the responses. It must
+ * see the requests before the user agent layer, if it's registered by
+ * other tests, which would answer the in-dialog requests with 481.
+ */
+static pjsip_module ovl_tester_mod =
+{
+    NULL, NULL,                         /* prev and next        */
+    { "overload_test", 13},             /* Name.                */
+    -1,                                 /* Id                   */
+    PJSIP_MOD_PRIORITY_UA_PROXY_LAYER-1,/* Priority             */
+    NULL,                               /* load()               */
+    NULL,                               /* start()              */
+    NULL,                               /* stop()               */
+    NULL,                               /* unload()             */
+    &ovl_on_rx_request,                 /* on_rx_request()      */
+    &ovl_on_rx_response,                /* on_rx_response()     */
+    NULL,                               /* on_tx_request()      */
+    NULL,                               /* on_tx_response()     */
+    NULL,                               /* on_tsx_state()       */
+};
+
+static struct
+{
+    int         status;
+    unsigned    ok_cnt;
+    unsigned    rejected_cnt;
+} ovl_test;
+
+static pj_bool_t ovl_on_rx_request(pjsip_rx_data *rdata)
+{
+#define ERR(rc__)   {ovl_test.status=rc__; return PJ_TRUE; }
+    if (!is_user_equal(rdata->msg_info.from, "overload_test"))
+        return PJ_FALSE;
+
+    PJ_TEST_SUCCESS(pjsip_endpt_respond_stateless(endpt, rdata, PJSIP_SC_OK,
+                                                  NULL, NULL, NULL),
+                    NULL, ERR(-100));
+    return PJ_TRUE;
+#undef ERR
+}
+
+static pj_bool_t ovl_on_rx_response(pjsip_rx_data *rdata)
+{
+#define ERR(rc__)   {ovl_test.status=rc__; return PJ_TRUE; }
+    pjsip_msg *msg = rdata->msg_info.msg;
+
+    if (!is_user_equal(rdata->msg_info.from, "overload_test"))
+        return PJ_FALSE;
+
+    if (msg->line.status.code == PJSIP_SC_OK) {
+        ++ovl_test.ok_cnt;
+    } else {
+        pjsip_retry_after_hdr *ra;
+
+        PJ_TEST_EQ(msg->line.status.code, PJSIP_SC_SERVICE_UNAVAILABLE,
+                   NULL, ERR(-110));
+        ra = (pjsip_retry_after_hdr*)
+             pjsip_msg_find_hdr(msg, PJSIP_H_RETRY_AFTER, NULL);
+        PJ_TEST_NOT_NULL(ra, NULL, ERR(-120));
+        PJ_TEST_EQ(ra->ivalue, RETRY_AFTER, NULL, ERR(-130));
+        ++ovl_test.rejected_cnt;
+    }
+    return PJ_TRUE;
+#undef ERR
+}
+
+/* Send count OPTIONS requests over the loop transport, inside a dialog
+ * if to_tag is set, and wait until the expected number of responses
+ * have been received.
+ */
+static int send_requests(pjsip_transport *loop, unsigned count,
+                         const char *to_tag, unsigned expected_rsp)
+{
+    pjsip_tpselector tp_sel;
+    pj_str_t url;
+    pj_time_val timeout, now;
+    unsigned i;
+
+    pj_bzero(&tp_sel, sizeof(tp_sel));
+    tp_sel.type = PJSIP_TPSELECTOR_TRANSPORT;
+    tp_sel.u.transport = loop;
+    url = pj_str("sip:overload_test@127.0.0.1");
+
+    ovl_test.ok_cnt = ovl_test.rejected_cnt = 0;
+
+    for (i = 0; i < count; ++i) {
+        pjsip_tx_data *tdata;
+
+        PJ_TEST_SUCCESS(pjsip_endpt_create_request(endpt,
+                                                   &pjsip_options_method,
+                                                   &url, &url, &url, NULL,
+                                                   NULL, -1, NULL, &tdata),
+                        NULL, return -10);
+        if (to_tag) {
+            pjsip_to_hdr *to;
+
+            to = (pjsip_to_hdr*)pjsip_msg_find_hdr(tdata->msg, PJSIP_H_TO,
+                                                   NULL);
+            pj_strdup2(tdata->pool, &to->tag, to_tag);
+        }
+        PJ_TEST_SUCCESS(pjsip_tx_data_set_transport(tdata, &tp_sel),
+                        NULL, return -20);
+        PJ_TEST_SUCCESS(pjsip_endpt_send_request_stateless(endpt, tdata,
+                                                           NULL, NULL),
+                        NULL, return -30);
+    }
+
+    pj_gettimeofday(&timeout);
+    now = timeout;
+    timeout.sec += 2;
+
+    while (ovl_test.ok_cnt + ovl_test.rejected_cnt < expected_rsp &&
+           ovl_test.status == 0 && PJ_TIME_VAL_LT(now, timeout))
+    {
+        flush_events(50);
+        pj_gettimeofday(&now);
+    }
+    /* Catch unexpected responses too */
+    flush_events(100);
+
+    PJ_TEST_EQ(ovl_test.status, 0, NULL, return ovl_test.status);
+    return 0;
+}
+
+int overload_test(void)
+{
+#define ERR(rc__)   { rc=rc__; goto on_return; }
+    enum { NEW_REQ = 5 * MAX_RATE };
+    pjsip_transport *loop = NULL;
+    pjsip_overload_param prm;
+    pjsip_overload_stat stat;
+    int rc;
+
+    pj_bzero(&ovl_test, sizeof(ovl_test));
+
+    PJ_TEST_EQ(pjsip_overload_instance(), NULL, NULL, return -1);
+    PJ_TEST_SUCCESS(pjsip_endpt_register_module(endpt, &ovl_tester_mod),
+                    NULL, return -2);
+
+    pjsip_overload_param_default(&prm);
+    prm.max_rate = MAX_RATE;
+    prm.max_tsx_cnt = 0;
+    prm.max_latency = 0;
+    prm.retry_after = RETRY_AFTER;
+    PJ_TEST_SUCCESS(pjsip_overload_init_module(endpt, &prm), NULL, ERR(-3));
+    PJ_TEST_NOT_NULL(pjsip_overload_instance(), NULL, ERR(-4));
+
+    PJ_TEST_SUCCESS(pjsip_loop_start(endpt, &loop), NULL, ERR(-5));
+    pjsip_transport_add_ref(loop);
+
+    /* 5x burst of new requests: about one second worth of requests is
+     * accepted, the rest gets 503 with Retry-After.
+     */
+    PJ_LOG(3,(THIS_FILE, "  sending %d new requests at %d/s limit",
+              NEW_REQ, MAX_RATE));
+    rc = send_requests(loop, NEW_REQ, NULL, NEW_REQ);
+    if (rc != 0)
+        goto on_return;
+
+    PJ_TEST_EQ(ovl_test.ok_cnt + ovl_test.rejected_cnt, NEW_REQ, NULL,
+               ERR(-200));
+    PJ_TEST_GTE(ovl_test.ok_cnt, MAX_RATE, NULL, ERR(-210));
+    PJ_TEST_LT(ovl_test.ok_cnt, 2 * MAX_RATE, NULL, ERR(-220));
+
+    PJ_TEST_SUCCESS(pjsip_overload_get_stat(&stat, PJ_TRUE), NULL, ERR(-230));
+    PJ_TEST_EQ(stat.accepted, ovl_test.ok_cnt, NULL, ERR(-240));
+    PJ_TEST_EQ(stat.shed_rate, ovl_test.rejected_cnt, NULL, ERR(-250));
+    PJ_TEST_EQ(stat.rejected, ovl_test.rejected_cnt, NULL, ERR(-260));
+    PJ_TEST_EQ(stat.dropped, 0, NULL, ERR(-270));
+
+    /* Requests inside a dialog are never shed, even while overloaded */
+    PJ_LOG(3,(THIS_FILE, "  sending in-dialog requests"));
+    rc = send_requests(loop, NEW_REQ, "ovltag", NEW_REQ);
+    if (rc != 0)
+        goto on_return;
+
+    PJ_TEST_EQ(ovl_test.ok_cnt, NEW_REQ, NULL, ERR(-300));
+    PJ_TEST_EQ(ovl_test.rejected_cnt, 0, NULL, ERR(-310));
+
+    PJ_TEST_SUCCESS(pjsip_overload_get_stat(&stat, PJ_TRUE), NULL, ERR(-320));
+    PJ_TEST_EQ(stat.accepted, 0, NULL, ERR(-330));
+
+    /* Drop instead of reject */
+    PJ_LOG(3,(THIS_FILE, "  dropping new requests"));
+    prm.max_rate = 1;
+    prm.action = PJSIP_OVERLOAD_DROP;
+    PJ_TEST_SUCCESS(pjsip_overload_set_param(&prm), NULL, ERR(-400));
+
+    rc = send_requests(loop, MAX_RATE, NULL, 0);
+    if (rc != 0)
+        goto on_return;
+
+    PJ_TEST_EQ(ovl_test.rejected_cnt, 0, NULL, ERR(-410));
+    PJ_TEST_LTE(ovl_test.ok_cnt, 2, NULL, ERR(-420));
+
+    PJ_TEST_SUCCESS(pjsip_overload_get_stat(&stat, PJ_TRUE), NULL, ERR(-430));
+    PJ_TEST_EQ(stat.accepted, ovl_test.ok_cnt, NULL, ERR(-440));
+    PJ_TEST_EQ(stat.dropped, MAX_RATE - ovl_test.ok_cnt, NULL, ERR(-450));
+    PJ_TEST_EQ(stat.rejected, 0, NULL, ERR(-460));
+
+    rc = 0;
+
+on_return:
+    if (loop) {
+        pjsip_transport_shutdown(loop);
+        pjsip_transport_dec_ref(loop);
+    }
+    if (pjsip_overload_instance())
+        pjsip_endpt_unregister_module(endpt, pjsip_overload_instance());
+    pjsip_endpt_unregister_module(endpt, &ovl_tester_mod);
+    flush_events(500);
+
+    if (rc == 0)
+        PJ_TEST_EQ(pjsip_overload_instance(), NULL, NULL, rc = -500);
+    return rc;
+#undef ERR
+}
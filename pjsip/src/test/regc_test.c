@@ -1029,6 +1029,7 @@ int regc_test(void)
     pj_uint16_t port; 
     char registrar_uri_buf[80];
     pj_str_t registrar_uri;
+    pj_bool_t saved_lazy = pjsip_cfg()->endpt.lazy_parse_hdr;
     int rc = 0;
 
     pj_sockaddr_in_init(&addr, 0, 0);
@@ -1138,6 +1139,37 @@ int regc_test(void)
         pj_thread_sleep(1000);
     }
 
+    /* Repeat the tests which get a response from the registrar, including
+     * the authentication challenge, with lazy header parsing.
+     */
+    pjsip_cfg()->endpt.lazy_parse_hdr = PJ_TRUE;
+    for (i=0; i<PJ_ARRAY_SIZE(test_rec); ++i) {
+        struct test_rec *t = &test_rec[i];
+        unsigned j;
+        pj_str_t contacts[8];
+        char new_title[200];
+
+        if (t->alt_registrar || !t->server_cfg.respond)
+            continue;
+
+        for (j=0; j<t->contact_cnt; ++j) {
+            contacts[j] = pj_str(t->contacts[j]);
+        }
+
+        pjsip_cfg()->regc.check_contact = (t->check_contact & ON) != 0;
+        pjsip_cfg()->regc.add_xuid_param = (t->add_xuid_param & ON) != 0;
+        t->client_cfg.destroy_on_cb = PJ_FALSE;
+
+        pj_ansi_snprintf(new_title, sizeof(new_title),
+                         "%s [lazy parsing]", t->title);
+        rc = do_test(new_title, &t->server_cfg, &t->client_cfg,
+                     &registrar_uri, t->contact_cnt, contacts,
+                     t->expires, PJ_FALSE, NULL);
+        if (rc != 0)
+            goto on_return;
+    }
+    pjsip_cfg()->endpt.lazy_parse_hdr = saved_lazy;
+
     /* keep-alive test */
     rc = keep_alive_test(&registrar_uri);
     if (rc != 0)
@@ -1169,6 +1201,7 @@ int regc_test(void)
         goto on_return;
 
 on_return:
+    pjsip_cfg()->endpt.lazy_parse_hdr = saved_lazy;
     if (registrar.mod.id != -1) {
         pjsip_endpt_unregister_module(endpt, &registrar.mod);
     }
@@ -383,6 +383,20 @@ int test_main(int argc, char *argv[])
                 PJ_TEST_EXCLUSIVE | PJ_TEST_KEEP_LAST);
 #endif
 
+    /* Exclusive, since it changes how the endpoint processes incoming
+     * messages.
+     */
+#if INCLUDE_LOOP_TEST
+    UT_ADD_TEST(&test_app.ut_app, transport_loop_dispatch_test,
+                PJ_TEST_EXCLUSIVE | PJ_TEST_KEEP_LAST);
+#endif
+
+    /* Exclusive, since it sheds the requests of other tests */
+#if INCLUDE_OVERLOAD_TEST
+    UT_ADD_TEST(&test_app.ut_app, overload_test,
+                PJ_TEST_EXCLUSIVE | PJ_TEST_KEEP_LAST);
+#endif
+
     /*
      * Better be last because it recreates the endpt
      */
@@ -71,6 +71,7 @@ extern pj_caching_pool caching_pool;
 #define INCLUDE_RESOLVE_TEST    INCLUDE_TRANSPORT_GROUP
 #define INCLUDE_TSX_TEST        INCLUDE_TSX_GROUP
 #define INCLUDE_TSX_DESTROY_TEST INCLUDE_TSX_GROUP
+#define INCLUDE_OVERLOAD_TEST   INCLUDE_TSX_GROUP
 #define INCLUDE_INV_OA_TEST     INCLUDE_INV_GROUP
 #define INCLUDE_REGC_TEST       INCLUDE_REGC_GROUP
 
@@ -87,10 +88,12 @@ int transport_udp_test(void);
 int transport_loop_test(void);
 int transport_loop_multi_test(void);
 int transport_loop_resolve_error_test(void);
+int transport_loop_dispatch_test(void);
 int transport_tcp_test(void);
 int resolve_test(void);
 int regc_test(void);
 int inv_offer_answer_test(void);
+int overload_test(void);
 
 #define MAX_TSX_TESTS   10
 
@@ -175,6 +175,167 @@ on_return:
 #undef ERR
 }
 
+/*
+ * Dispatch stage test: messages must be processed by the dispatch
+ * threads, with all messages of a Call-ID on the same thread and in
+ * order.
+ */
+#define DISP_CALLS  4
+#define DISP_MSGS   50
+
+static pj_bool_t disp_on_rx_request(pjsip_rx_data *rdata);
+
+static pjsip_module disp_tester_mod =
+{
+    NULL, NULL,                         /* prev and next        */
+    { "transport_loop_disp_test", 24},  /* Name.                */
+    -1,                                 /* Id                   */
+    PJSIP_MOD_PRIORITY_UA_PROXY_LAYER-1,/* Priority             */
+    NULL,                               /* load()               */
+    NULL,                               /* start()              */
+    NULL,                               /* stop()               */
+    NULL,                               /* unload()             */
+    &disp_on_rx_request,                /* on_rx_request()      */
+    NULL,                               /* on_rx_response()     */
+    NULL,                               /* on_tx_request()      */
+    NULL,                               /* on_tx_response()     */
+    NULL,                               /* on_tsx_state()       */
+};
+
+static struct
+{
+    pj_thread_t     *main_thread;
+    pj_atomic_t     *rx_cnt;
+    int              status;
+    struct {
+        pj_thread_t *thread;
+        int          last_cseq;
+    } call[DISP_CALLS];
+} disp_test;
+
+static pj_bool_t disp_on_rx_request(pjsip_rx_data *rdata)
+{
+#define ERR(rc__)   {disp_test.status=rc__; return PJ_TRUE; }
+    const pj_str_t *cid = &rdata->msg_info.cid->id;
+    pj_thread_t *this_thread = pj_thread_this();
+    unsigned idx;
+
+    if (!is_user_equal(rdata->msg_info.from, "transport_loop_disp_test"))
+        return PJ_FALSE;
+
+    PJ_TEST_EQ(cid->slen, 6, NULL, ERR(-200));
+    idx = cid->ptr[5] - '0';
+    PJ_TEST_LT(idx, DISP_CALLS, NULL, ERR(-210));
+
+    PJ_TEST_NEQ(this_thread, disp_test.main_thread, NULL, ERR(-220));
+    if (disp_test.call[idx].thread == NULL)
+        disp_test.call[idx].thread = this_thread;
+    PJ_TEST_EQ(disp_test.call[idx].thread, this_thread, NULL, ERR(-230));
+
+    PJ_TEST_EQ(rdata->msg_info.cseq->cseq,
+               disp_test.call[idx].last_cseq + 1, NULL, ERR(-240));
+    disp_test.call[idx].last_cseq = rdata->msg_info.cseq->cseq;
+
+    pj_atomic_inc(disp_test.rx_cnt);
+    return PJ_TRUE;
+#undef ERR
+}
+
+int transport_loop_dispatch_test(void)
+{
+#define ERR(rc__)   { rc=rc__; goto on_return; }
+    enum { TIMEOUT = 5000 };
+    pjsip_transport *loop = NULL;
+    pj_pool_t *pool;
+    pjsip_dispatch_param prm;
+    pjsip_tpselector tp_sel;
+    pj_str_t url;
+    pj_time_val timeout, now;
+    pj_bool_t started = PJ_FALSE;
+    int i, rc;
+
+    pj_bzero(&disp_test, sizeof(disp_test));
+    disp_test.main_thread = pj_thread_this();
+
+    pool = pjsip_endpt_create_pool(endpt, NULL, 256, 256);
+    PJ_TEST_SUCCESS(pj_atomic_create(pool, 0, &disp_test.rx_cnt),
+                    NULL, ERR(-5));
+    PJ_TEST_SUCCESS(pjsip_endpt_register_module(endpt, &disp_tester_mod),
+                    NULL, ERR(-10));
+
+    /* Small queues so that the receiving thread has to wait sometimes */
+    pjsip_dispatch_param_default(&prm);
+    prm.thread_cnt = 3;
+    prm.queue_size = 4;
+    PJ_TEST_SUCCESS(pjsip_endpt_start_dispatch(endpt, &prm), NULL, ERR(-20));
+    started = PJ_TRUE;
+    PJ_TEST_EQ(pjsip_endpt_start_dispatch(endpt, &prm), PJ_EEXISTS, NULL,
+               ERR(-25));
+
+    PJ_TEST_SUCCESS(pjsip_loop_start(endpt, &loop), NULL, ERR(-30));
+    pjsip_transport_add_ref(loop);
+
+    pj_bzero(&tp_sel, sizeof(tp_sel));
+    tp_sel.type = PJSIP_TPSELECTOR_TRANSPORT;
+    tp_sel.u.transport = loop;
+    url = pj_str("sip:transport_loop_disp_test@127.0.0.1");
+
+    for (i = 0; i < DISP_CALLS * DISP_MSGS; ++i) {
+        char cid_buf[8];
+        pj_str_t cid;
+        pjsip_tx_data *tdata;
+
+        pj_ansi_snprintf(cid_buf, sizeof(cid_buf), "disp-%d", i % DISP_CALLS);
+        cid = pj_str(cid_buf);
+
+        PJ_TEST_SUCCESS(pjsip_endpt_create_request(endpt,
+                                                   &pjsip_options_method,
+                                                   &url, &url, &url, NULL,
+                                                   &cid, i / DISP_CALLS + 1,
+                                                   NULL, &tdata),
+                        NULL, ERR(-40));
+        PJ_TEST_SUCCESS(pjsip_tx_data_set_transport(tdata, &tp_sel),
+                        NULL, ERR(-50));
+        PJ_TEST_SUCCESS(pjsip_endpt_send_request_stateless(endpt, tdata,
+                                                           NULL, NULL),
+                        NULL, ERR(-60));
+    }
+
+    pj_gettimeofday(&timeout);
+    now = timeout;
+    timeout.msec += TIMEOUT;
+    pj_time_val_normalize(&timeout);
+
+    while (pj_atomic_get(disp_test.rx_cnt) < DISP_CALLS * DISP_MSGS &&
+           disp_test.status == 0 && PJ_TIME_VAL_LT(now, timeout))
+    {
+        flush_events(100);
+        pj_gettimeofday(&now);
+    }
+
+    PJ_TEST_EQ(disp_test.status, 0, NULL, ERR(disp_test.status));
+    PJ_TEST_EQ(pj_atomic_get(disp_test.rx_cnt), DISP_CALLS * DISP_MSGS,
+               "test has timed-out", ERR(-70));
+
+    rc = 0;
+
+on_return:
+    if (started)
+        pjsip_endpt_stop_dispatch(endpt);
+    if (loop) {
+        pjsip_transport_shutdown(loop);
+        pjsip_transport_dec_ref(loop);
+    }
+    if (disp_tester_mod.id != -1)
+        pjsip_endpt_unregister_module(endpt, &disp_tester_mod);
+    if (disp_test.rx_cnt)
+        pj_atomic_destroy(disp_test.rx_cnt);
+    pjsip_endpt_release_pool(endpt, pool);
+    flush_events(500);
+    return rc;
+#undef ERR
+}
+
 static void send_cb(pjsip_send_state *st, pj_ssize_t sent, pj_bool_t *cont)
 {
     int *loop_resolve_status = (int*)st->token;
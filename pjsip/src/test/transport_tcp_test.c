@@ -147,6 +147,296 @@ static pj_status_t multi_listener_test(pjsip_tpfactory *factory[],
     return PJ_SUCCESS;
 }
 
+/*
+ * Write coalescing test: a burst of messages sent while writes are being
+ * delayed must be received completely and in order, and the pending
+ * bytes limit must refuse messages once reached.
+ */
+static pj_bool_t coalesce_on_rx_request(pjsip_rx_data *rdata);
+
+static pjsip_module coalesce_mod =
+{
+    NULL, NULL,                         /* prev and next        */
+    { "tcp_coalesce_test", 17},         /* Name.                */
+    -1,                                 /* Id                   */
+    PJSIP_MOD_PRIORITY_TSX_LAYER-1,     /* Priority             */
+    NULL,                               /* load()               */
+    NULL,                               /* start()              */
+    NULL,                               /* stop()               */
+    NULL,                               /* unload()             */
+    &coalesce_on_rx_request,            /* on_rx_request()      */
+    NULL,                               /* on_rx_response()     */
+    NULL,                               /* on_tx_request()      */
+    NULL,                               /* on_tx_response()     */
+    NULL,                               /* on_tsx_state()       */
+};
+
+static struct
+{
+    unsigned    rx_cnt;
+    unsigned    out_of_order;
+} coalesce_test_var;
+
+static pj_bool_t coalesce_on_rx_request(pjsip_rx_data *rdata)
+{
+    if (!is_user_equal(rdata->msg_info.from, "tcp_coalesce_test"))
+        return PJ_FALSE;
+
+    if (rdata->msg_info.cseq->cseq != (int)coalesce_test_var.rx_cnt)
+        ++coalesce_test_var.out_of_order;
+    ++coalesce_test_var.rx_cnt;
+    return PJ_TRUE;
+}
+
+static pj_status_t coalesce_send(pjsip_transport *tp, int cseq)
+{
+    pj_str_t target = pj_str("sip:tcp_coalesce_test@127.0.0.1");
+    pjsip_tx_data *tdata;
+    pjsip_via_hdr *via;
+    pj_status_t status;
+
+    status = pjsip_endpt_create_request(endpt, &pjsip_options_method,
+                                        &target, &target, &target, NULL,
+                                        NULL, cseq, NULL, &tdata);
+    if (status != PJ_SUCCESS)
+        return status;
+
+    /* Fill in the Via, since the message bypasses the transaction layer */
+    via = (pjsip_via_hdr*)pjsip_msg_find_hdr(tdata->msg, PJSIP_H_VIA, NULL);
+    via->transport = pj_str("TCP");
+    via->sent_by.host = pj_str("127.0.0.1");
+    via->sent_by.port = 5060;
+    via->branch_param = pj_str("z9hG4bKtcp_coalesce_test");
+
+    status = pjsip_transport_send(tp, tdata, &tp->key.rem_addr,
+                                  tp->addr_len, NULL, NULL);
+    pjsip_tx_data_dec_ref(tdata);
+    return status;
+}
+
+static void coalesce_wait_rx(unsigned count)
+{
+    unsigned i;
+
+    for (i=0; i<40 && coalesce_test_var.rx_cnt < count; ++i)
+        flush_events(50);
+}
+
+static int coalesce_test(pjsip_transport *tp)
+{
+#define ERR(rc__)   { rc=rc__; goto on_return; }
+    enum { COUNT = 100 };
+    pjsip_cfg_t *cfg = pjsip_cfg();
+    unsigned old_delay = cfg->tcp.coalesce_delay;
+    pj_size_t old_max_pending = cfg->tcp.max_pending_tx;
+    unsigned i, sent;
+    int rc;
+
+    PJ_LOG(3,(THIS_FILE, "  write coalescing test"));
+
+    pj_bzero(&coalesce_test_var, sizeof(coalesce_test_var));
+    PJ_TEST_SUCCESS(pjsip_endpt_register_module(endpt, &coalesce_mod), NULL,
+                    return -500);
+
+    /* Delay the writes so that the whole burst is coalesced */
+    cfg->tcp.coalesce_delay = 20;
+    for (i=0; i<COUNT; ++i) {
+        PJ_TEST_EQ(coalesce_send(tp, i), PJ_EPENDING, NULL, ERR(-510));
+    }
+    PJ_TEST_GT(pjsip_tcp_transport_get_pending_tx(tp), 0, NULL, ERR(-520));
+
+    coalesce_wait_rx(COUNT);
+    PJ_TEST_EQ(coalesce_test_var.rx_cnt, COUNT, NULL, ERR(-530));
+    PJ_TEST_EQ(coalesce_test_var.out_of_order, 0, NULL, ERR(-540));
+    PJ_TEST_EQ(pjsip_tcp_transport_get_pending_tx(tp), 0, NULL, ERR(-550));
+
+    /* Pending bytes limit */
+    coalesce_test_var.rx_cnt = 0;
+    cfg->tcp.max_pending_tx = 2000;
+    for (i=0; i<COUNT; ++i) {
+        pj_status_t status = coalesce_send(tp, i);
+        if (status == PJ_EBUSY)
+            break;
+        PJ_TEST_EQ(status, PJ_EPENDING, NULL, ERR(-560));
+    }
+    sent = i;
+    PJ_TEST_GT(sent, 0, NULL, ERR(-570));
+    PJ_TEST_LT(sent, COUNT, NULL, ERR(-580));
+    PJ_TEST_LTE(pjsip_tcp_transport_get_pending_tx(tp), 2000, NULL,
+                ERR(-590));
+
+    coalesce_wait_rx(sent);
+    PJ_TEST_EQ(coalesce_test_var.rx_cnt, sent, NULL, ERR(-600));
+    PJ_TEST_EQ(coalesce_test_var.out_of_order, 0, NULL, ERR(-610));
+    PJ_TEST_EQ(pjsip_tcp_transport_get_pending_tx(tp), 0, NULL, ERR(-620));
+
+    rc = 0;
+
+on_return:
+    cfg->tcp.coalesce_delay = old_delay;
+    cfg->tcp.max_pending_tx = old_max_pending;
+    pjsip_endpt_unregister_module(endpt, &coalesce_mod);
+    return rc;
+#undef ERR
+}
+
+/* Receive messages with the rdata pool released after each message */
+static int idle_rx_pool_test(pjsip_transport *tp)
+{
+#define ERR(rc__)   { rc=rc__; goto on_return; }
+    enum { COUNT = 10 };
+    pjsip_cfg_t *cfg = pjsip_cfg();
+    pj_bool_t old_release = cfg->tcp.release_idle_rx_pool;
+    unsigned i;
+    int rc;
+
+    PJ_LOG(3,(THIS_FILE, "  idle receive pool test"));
+
+    pj_bzero(&coalesce_test_var, sizeof(coalesce_test_var));
+    PJ_TEST_SUCCESS(pjsip_endpt_register_module(endpt, &coalesce_mod), NULL,
+                    return -700);
+
+    cfg->tcp.release_idle_rx_pool = PJ_TRUE;
+    for (i=0; i<COUNT; ++i) {
+        pj_status_t status = coalesce_send(tp, i);
+        if (status != PJ_SUCCESS)
+            PJ_TEST_EQ(status, PJ_EPENDING, NULL, ERR(-710));
+        coalesce_wait_rx(i+1);
+    }
+    PJ_TEST_EQ(coalesce_test_var.rx_cnt, COUNT, NULL, ERR(-720));
+    PJ_TEST_EQ(coalesce_test_var.out_of_order, 0, NULL, ERR(-730));
+
+    PJ_TEST_NOT_NULL(tp->get_mem_usage, NULL, ERR(-740));
+    PJ_TEST_GT((*tp->get_mem_usage)(tp), 0, NULL, ERR(-750));
+    pjsip_tpmgr_dump_transports(pjsip_endpt_get_tpmgr(endpt));
+
+    rc = 0;
+
+on_return:
+    cfg->tcp.release_idle_rx_pool = old_release;
+    pjsip_endpt_unregister_module(endpt, &coalesce_mod);
+    return rc;
+#undef ERR
+}
+
+#define ACCEPT_TEST_COUNT   32
+
+static struct
+{
+    pjsip_tpfactory *factory;
+    unsigned         connected;
+    unsigned         disconnected;
+    pjsip_transport *tp[ACCEPT_TEST_COUNT];
+} accept_test_var;
+
+static void accept_test_on_state(pjsip_transport *tp,
+                                 pjsip_transport_state state,
+                                 const pjsip_transport_state_info *info)
+{
+    PJ_UNUSED_ARG(info);
+
+    if (tp->factory != accept_test_var.factory ||
+        tp->dir != PJSIP_TP_DIR_INCOMING)
+    {
+        return;
+    }
+
+    if (state == PJSIP_TP_STATE_CONNECTED &&
+        accept_test_var.connected < ACCEPT_TEST_COUNT)
+    {
+        accept_test_var.tp[accept_test_var.connected++] = tp;
+    }
+    else if (state == PJSIP_TP_STATE_DISCONNECTED)
+        ++accept_test_var.disconnected;
+}
+
+/* Accept a burst of connections with a large backlog and accept batch,
+ * then look up each of them from the transport table.
+ */
+static int accept_batch_test(void)
+{
+#define ERR(rc__)   { rc=rc__; goto on_return; }
+    enum { COUNT = ACCEPT_TEST_COUNT };
+    pjsip_tpmgr *tpmgr = pjsip_endpt_get_tpmgr(endpt);
+    pjsip_tp_state_callback old_state_cb = pjsip_tpmgr_get_state_cb(tpmgr);
+    pjsip_tcp_transport_cfg cfg;
+    pj_sock_t sock[COUNT];
+    pj_sockaddr_in addr;
+    unsigned i;
+    int rc;
+
+    PJ_LOG(3,(THIS_FILE, "  accept batch test"));
+
+    for (i=0; i<COUNT; ++i)
+        sock[i] = PJ_INVALID_SOCKET;
+
+    pj_bzero(&accept_test_var, sizeof(accept_test_var));
+    pjsip_tcp_transport_cfg_default(&cfg, pj_AF_INET());
+    cfg.backlog = 2 * COUNT;
+    cfg.accept_batch = 8;
+    PJ_TEST_SUCCESS(pjsip_tcp_transport_start3(endpt, &cfg,
+                                               &accept_test_var.factory),
+                    NULL, return -800);
+    pjsip_tpmgr_set_state_cb(tpmgr, &accept_test_on_state);
+
+    PJ_TEST_SUCCESS(pj_sockaddr_in_init(&addr,
+                        &accept_test_var.factory->addr_name.host,
+                        (pj_uint16_t)accept_test_var.factory->addr_name.port),
+                    NULL, ERR(-810));
+
+    /* Connect all clients before the listener gets to accept them */
+    for (i=0; i<COUNT; ++i) {
+        PJ_TEST_SUCCESS(pj_sock_socket(pj_AF_INET(), pj_SOCK_STREAM(), 0,
+                                       &sock[i]), NULL, ERR(-820));
+        PJ_TEST_SUCCESS(pj_sock_connect(sock[i], &addr, sizeof(addr)), NULL,
+                        ERR(-830));
+    }
+
+    for (i=0; i<40 && accept_test_var.connected < COUNT; ++i)
+        flush_events(50);
+    PJ_TEST_EQ(accept_test_var.connected, COUNT, NULL, ERR(-840));
+
+    /* The accepted transports are idle, acquiring them must find the
+     * same transport and stop its idle timer.
+     */
+    for (i=0; i<COUNT; ++i) {
+        pjsip_transport *tp = accept_test_var.tp[i];
+        pjsip_transport *found = NULL;
+
+        PJ_TEST_SUCCESS(pjsip_endpt_acquire_transport(endpt, tp->key.type,
+                                                      &tp->key.rem_addr,
+                                                      tp->addr_len, NULL,
+                                                      &found),
+                        NULL, ERR(-850));
+        PJ_TEST_EQ(found, tp, NULL, ERR(-860));
+        PJ_TEST_EQ(pj_atomic_get(tp->ref_cnt), 1, NULL,
+                   { pjsip_transport_dec_ref(found); ERR(-870); });
+        PJ_TEST_EQ(tp->idle_timer.id, PJ_FALSE, NULL,
+                   { pjsip_transport_dec_ref(found); ERR(-880); });
+        pjsip_transport_dec_ref(found);
+    }
+
+    rc = 0;
+
+on_return:
+    for (i=0; i<COUNT; ++i) {
+        if (sock[i] != PJ_INVALID_SOCKET)
+            pj_sock_close(sock[i]);
+    }
+
+    /* Wait until the server side of the connections are closed */
+    for (i=0; i<40 && accept_test_var.disconnected <
+                      accept_test_var.connected; ++i)
+    {
+        flush_events(50);
+    }
+
+    pjsip_tpmgr_set_state_cb(tpmgr, old_state_cb);
+    (*accept_test_var.factory->destroy)(accept_test_var.factory);
+    return rc;
+#undef ERR
+}
+
 int transport_tcp_test(void)
 {
     enum { SEND_RECV_LOOP = 8 };
@@ -216,6 +506,19 @@ int transport_tcp_test(void)
     if (pkt_lost != 0)
         PJ_LOG(3,(THIS_FILE, "   note: %d packet(s) was lost", pkt_lost));
 
+    /* Write coalescing test */
+    status = coalesce_test(tcp[0]);
+    if (status == 0)
+        status = idle_rx_pool_test(tcp[0]);
+    if (status == 0)
+        status = accept_batch_test();
+    if (status != 0) {
+        for (i = 0; i < num_tp ; ++i) {
+            pjsip_transport_dec_ref(tcp[i]);
+        }
+        return status;
+    }
+
     /* Load test */
     if ((status=transport_load_test(PJSIP_TRANSPORT_TCP,
                                     host_port_param)) != 0)
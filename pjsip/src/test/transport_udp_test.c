@@ -118,6 +118,149 @@ on_return:
 #undef ERR
 }
 
+/*
+ * Socket group test: requests sent from different source ports to a
+ * transport with several SO_REUSEPORT sockets must all be received by the
+ * same logical transport, and should be spread over the sockets.
+ */
+#define GRP_SOCK_CNT    4
+#define GRP_SENDER_CNT  16
+
+static pj_bool_t grp_on_rx_request(pjsip_rx_data *rdata);
+
+static pjsip_module grp_mod =
+{
+    NULL, NULL,                         /* prev and next        */
+    { "udp_group_test", 14},            /* Name.                */
+    -1,                                 /* Id                   */
+    PJSIP_MOD_PRIORITY_TSX_LAYER-1,     /* Priority             */
+    NULL,                               /* load()               */
+    NULL,                               /* start()              */
+    NULL,                               /* stop()               */
+    NULL,                               /* unload()             */
+    &grp_on_rx_request,                 /* on_rx_request()      */
+    NULL,                               /* on_rx_response()     */
+    NULL,                               /* on_tx_request()      */
+    NULL,                               /* on_tx_response()     */
+    NULL,                               /* on_tsx_state()       */
+};
+
+static struct
+{
+    pjsip_transport    *tp;
+    unsigned            rx_cnt;
+    unsigned            wrong_tp_cnt;
+    unsigned            sock_rx_cnt[GRP_SOCK_CNT];
+} grp_test;
+
+static pj_bool_t grp_on_rx_request(pjsip_rx_data *rdata)
+{
+    unsigned idx;
+
+    if (!is_user_equal(rdata->msg_info.from, "udp_group_test"))
+        return PJ_FALSE;
+
+    /* With async_cnt 1, the rdata index is the socket index */
+    idx = (unsigned)(pj_ssize_t)rdata->tp_info.tp_data;
+    if (rdata->tp_info.transport != grp_test.tp || idx >= GRP_SOCK_CNT)
+        ++grp_test.wrong_tp_cnt;
+    else
+        ++grp_test.sock_rx_cnt[idx];
+    ++grp_test.rx_cnt;
+    return PJ_TRUE;
+}
+
+static int sock_group_test(void)
+{
+#define ERR(rc__)   { rc=rc__; goto on_return; }
+    pjsip_udp_transport_cfg cfg;
+    pjsip_transport *tp = NULL;
+    pj_sock_t sender[GRP_SENDER_CNT];
+    pj_str_t s;
+    unsigned i, used_cnt;
+    int rc;
+
+    for (i=0; i<GRP_SENDER_CNT; ++i)
+        sender[i] = PJ_INVALID_SOCKET;
+    pj_bzero(&grp_test, sizeof(grp_test));
+
+    PJ_TEST_SUCCESS(pjsip_endpt_register_module(endpt, &grp_mod), NULL,
+                    return -300);
+
+    pjsip_udp_transport_cfg_default(&cfg, pj_AF_INET());
+    pj_sockaddr_init(pj_AF_INET(), &cfg.bind_addr, pj_cstr(&s, "127.0.0.1"),
+                     0);
+    cfg.sock_cnt = GRP_SOCK_CNT;
+
+    if (pj_SO_REUSEPORT() == 0xFFFF) {
+        PJ_TEST_EQ(pjsip_udp_transport_start2(endpt, &cfg, &tp), PJ_ENOTSUP,
+                   NULL, ERR(-305));
+        PJ_LOG(3,(THIS_FILE, "   SO_REUSEPORT is not supported, skipping "
+                             "socket group test"));
+        rc = 0;
+        goto on_return;
+    }
+
+    PJ_TEST_SUCCESS(pjsip_udp_transport_start2(endpt, &cfg, &tp), NULL,
+                    ERR(-310));
+    grp_test.tp = tp;
+
+    for (i=0; i<GRP_SENDER_CNT; ++i) {
+        char msg[512];
+        pj_ssize_t len;
+
+        PJ_TEST_SUCCESS(pj_sock_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0,
+                                       &sender[i]),
+                        NULL, ERR(-320));
+
+        len = pj_ansi_snprintf(msg, sizeof(msg),
+                "OPTIONS sip:udp_group_test@127.0.0.1 SIP/2.0\r\n"
+                "Via: SIP/2.0/UDP 127.0.0.1:5060;branch=z9hG4bKgrp%u\r\n"
+                "From: <sip:udp_group_test@127.0.0.1>;tag=%u\r\n"
+                "To: <sip:udp_group_test@127.0.0.1>\r\n"
+                "Call-ID: udp_group_test%u\r\n"
+                "CSeq: 1 OPTIONS\r\n"
+                "Content-Length: 0\r\n"
+                "\r\n", i, i, i);
+        PJ_TEST_SUCCESS(pj_sock_sendto(sender[i], msg, &len, 0,
+                                       &tp->local_addr,
+                                       pj_sockaddr_get_len(&tp->local_addr)),
+                        NULL, ERR(-330));
+    }
+
+    for (i=0; i<20 && grp_test.rx_cnt < GRP_SENDER_CNT; ++i)
+        flush_events(50);
+
+    PJ_TEST_EQ(grp_test.rx_cnt, GRP_SENDER_CNT, NULL, ERR(-340));
+    PJ_TEST_EQ(grp_test.wrong_tp_cnt, 0, NULL, ERR(-350));
+
+    /* The kernel distributes the packets by hashing the source address,
+     * the chance of sixteen ports hashing to one socket is negligible.
+     */
+    for (i=0, used_cnt=0; i<GRP_SOCK_CNT; ++i) {
+        if (grp_test.sock_rx_cnt[i])
+            ++used_cnt;
+    }
+    PJ_LOG(3,(THIS_FILE, "   %d requests received on %d of %d sockets",
+              grp_test.rx_cnt, used_cnt, GRP_SOCK_CNT));
+    PJ_TEST_GT(used_cnt, 1, NULL, ERR(-360));
+
+    rc = 0;
+
+on_return:
+    for (i=0; i<GRP_SENDER_CNT; ++i) {
+        if (sender[i] != PJ_INVALID_SOCKET)
+            pj_sock_close(sender[i]);
+    }
+    if (tp) {
+        pjsip_transport_dec_ref(tp);
+        pjsip_transport_destroy(tp);
+    }
+    pjsip_endpt_unregister_module(endpt, &grp_mod);
+    return rc;
+#undef ERR
+}
+
 /*
  * UDP transport test.
  */
@@ -180,6 +323,10 @@ int transport_udp_test(void)
             return -90;
     }
 
+    status = sock_group_test();
+    if (status != 0)
+        return status;
+
     /* Flush events. */
     PJ_LOG(3,(THIS_FILE, "   Flushing events, 1 second..."));
     flush_events(1000);
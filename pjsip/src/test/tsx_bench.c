@@ -191,9 +191,148 @@ on_error:
 
 
 
+/* Multi-threaded benchmark: each thread creates its share of UAC
+ * transactions with its own request, then looks each of them up in the
+ * transaction layer, the way incoming responses are matched. This
+ * measures how well the transaction layer scales when several worker
+ * threads use it at the same time.
+ */
+enum { MT_LOOKUP_REPEAT = 4 };
+
+typedef struct mt_bench_arg
+{
+    pjsip_tx_data        *request;
+    unsigned              working_set;
+    pjsip_transaction   **tsx;
+    int                   rc;
+} mt_bench_arg;
+
+static int mt_bench_thread(void *p)
+{
+    mt_bench_arg *arg = (mt_bench_arg*)p;
+    pjsip_via_hdr *via;
+    unsigned i, j;
+
+    via = (pjsip_via_hdr*) pjsip_msg_find_hdr(arg->request->msg, PJSIP_H_VIA,
+                                              NULL);
+
+    for (i=0; i<arg->working_set; ++i) {
+        PJ_TEST_SUCCESS(pjsip_tsx_create_uac(&mod_tsx_user, arg->request,
+                                             &arg->tsx[i]),
+                        NULL, {arg->rc=-310; return arg->rc;});
+
+        /* Reset branch param */
+        via->branch_param.slen = 0;
+    }
+
+    for (j=0; j<MT_LOOKUP_REPEAT; ++j) {
+        for (i=0; i<arg->working_set; ++i) {
+            pjsip_transaction *tsx;
+
+            tsx = pjsip_tsx_layer_find_tsx2(&arg->tsx[i]->transaction_key,
+                                            PJ_FALSE);
+            PJ_TEST_EQ(tsx, arg->tsx[i], NULL,
+                       {arg->rc=-320; return arg->rc;});
+        }
+    }
+
+    return 0;
+}
+
+static int mt_tsx_bench(unsigned thread_cnt, unsigned working_set,
+                        pj_timestamp *p_elapsed)
+{
+    pj_pool_t *pool;
+    pj_thread_t **threads;
+    mt_bench_arg *args;
+    pj_timestamp t1, t2;
+    unsigned i, j;
+    int rc = 0;
+
+    /* Create the requests first. */
+    pj_str_t str_target = pj_str("sip:someuser@someprovider.com");
+    pj_str_t str_from = pj_str("\"Local User\" <sip:tsx_bench@serviceprovider.com>");
+    pj_str_t str_to = pj_str("\"Remote User\" <sip:remoteuser@serviceprovider.com>");
+    pj_str_t str_contact = str_from;
+
+    pool = pjsip_endpt_create_pool(endpt, "tsxbench", 4000, 4000);
+    PJ_TEST_NOT_NULL(pool, NULL, return -300);
+
+    threads = (pj_thread_t**) pj_pool_calloc(pool, thread_cnt,
+                                             sizeof(pj_thread_t*));
+    args = (mt_bench_arg*) pj_pool_calloc(pool, thread_cnt,
+                                          sizeof(mt_bench_arg));
+
+    pj_bzero(&mod_tsx_user, sizeof(mod_tsx_user));
+    mod_tsx_user.id = -1;
+
+    for (i=0; i<thread_cnt; ++i) {
+        PJ_TEST_SUCCESS(pjsip_endpt_create_request(endpt,
+                                        &pjsip_invite_method,
+                                        &str_target, &str_from, &str_to,
+                                        &str_contact, NULL, -1, NULL,
+                                        &args[i].request),
+                        NULL, {rc=-301; goto on_error;});
+        args[i].working_set = working_set / thread_cnt;
+        args[i].tsx = (pjsip_transaction**)
+                      pj_pool_calloc(pool, args[i].working_set,
+                                     sizeof(pjsip_transaction*));
+
+        PJ_TEST_SUCCESS(pj_thread_create(pool, "tsxbench", &mt_bench_thread,
+                                         &args[i], 0, PJ_THREAD_SUSPENDED,
+                                         &threads[i]),
+                        NULL, {rc=-302; goto on_error;});
+    }
+
+    /* Benchmark */
+    pj_get_timestamp(&t1);
+    for (i=0; i<thread_cnt; ++i)
+        pj_thread_resume(threads[i]);
+    for (i=0; i<thread_cnt; ++i) {
+        pj_thread_join(threads[i]);
+        pj_thread_destroy(threads[i]);
+        threads[i] = NULL;
+    }
+    pj_get_timestamp(&t2);
+    pj_sub_timestamp(&t2, &t1);
+    p_elapsed->u64 = t2.u64;
+
+    for (i=0; i<thread_cnt; ++i) {
+        if (args[i].rc != 0 && rc == 0)
+            rc = args[i].rc;
+    }
+
+on_error:
+    for (i=0; i<thread_cnt; ++i) {
+        if (threads[i]) {
+            pj_thread_resume(threads[i]);
+            pj_thread_join(threads[i]);
+            pj_thread_destroy(threads[i]);
+        }
+        for (j=0; args[i].tsx && j<args[i].working_set; ++j) {
+            if (args[i].tsx[j]) {
+                pj_timer_heap_t *th;
+
+                pjsip_tsx_terminate(args[i].tsx[j], 601);
+                args[i].tsx[j] = NULL;
+
+                th = pjsip_endpt_get_timer_heap(endpt);
+                pj_timer_heap_poll(th, NULL);
+            }
+        }
+        if (args[i].request)
+            pjsip_tx_data_dec_ref(args[i].request);
+    }
+    pjsip_endpt_release_pool(endpt, pool);
+    flush_events(2000);
+    return rc;
+}
+
+
+
 int tsx_bench(void)
 {
-    enum { WORKING_SET=10000, REPEAT = 4 };
+    enum { WORKING_SET=10000, REPEAT = 4, MT_THREAD_CNT = 4 };
     unsigned i, speed;
     pj_timestamp usec[REPEAT], min, freq;
     char desc[250];
@@ -286,6 +425,49 @@ int tsx_bench(void)
     report_ival("create-uas-tsx-per-sec", 
                 speed, "tsx/sec", desc);
 
+
+
+    /*
+     * Benchmark UAC with multiple threads
+     */
+    PJ_LOG(3,(THIS_FILE, "   benchmarking UAC transaction creation and "
+                         "lookup with %d threads:", MT_THREAD_CNT));
+    for (i=0; i<REPEAT; ++i) {
+        PJ_LOG(3,(THIS_FILE, "    test %d of %d..",
+                  i+1, REPEAT));
+        status = mt_tsx_bench(MT_THREAD_CNT, WORKING_SET, &usec[i]);
+        if (status != PJ_SUCCESS)
+            return status;
+    }
+
+    min.u64 = PJ_UINT64(0xFFFFFFFFFFFFFFF);
+    for (i=0; i<REPEAT; ++i) {
+        if (usec[i].u64 < min.u64) min.u64 = usec[i].u64;
+    }
+
+
+    /* Report time */
+    pj_ansi_snprintf(desc, sizeof(desc), 
+                          "Time for %d threads to create %d UAC transactions "
+                          "and look each up %d times, in miliseconds",
+                          MT_THREAD_CNT, WORKING_SET, MT_LOOKUP_REPEAT);
+    report_ival("mt-uac-time", (unsigned)(min.u64 * 1000 / freq.u64), "msec", desc);
+
+
+    /* Write speed */
+    speed = (unsigned)(freq.u64 * WORKING_SET / min.u64);
+    PJ_LOG(3,(THIS_FILE, "    UAC created and looked up at %d tsx/sec "
+                         "with %d threads", speed, MT_THREAD_CNT));
+
+    pj_ansi_snprintf(desc, sizeof(desc), 
+                          "Number of UAC transactions that can be created "
+                          "and looked up %d times per second by %d threads "
+                          "concurrently.",
+                          MT_LOOKUP_REPEAT, MT_THREAD_CNT);
+
+    report_ival("mt-uac-tsx-per-sec", 
+                speed, "tsx/sec", desc);
+
     return PJ_SUCCESS;
 }
 